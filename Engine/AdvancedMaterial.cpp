@@ -11,7 +11,8 @@ Spectrum AdvancedMaterial::SampleTexture(const std::shared_ptr<Texture>& texture
     
     // Simple texture sampling - in a real implementation this would use proper filtering
     // For now, return a placeholder spectrum
-    return Spectrum::FromRGB(glm::vec3(0.5f, 0.5f, 0.5f));
+    static const Spectrum PLACEHOLDER = Spectrum::FromRGB(glm::vec3(0.5f, 0.5f, 0.5f));
+    return PLACEHOLDER;
 }
 
 glm::vec3 AdvancedMaterial::SampleNormalMap(const std::shared_ptr<Texture>& normalMap, const glm::vec2& uv,
@@ -72,8 +73,8 @@ void DisneyMaterial::ComputeScatteringFunctions(SurfaceInteraction* si) const {
         si->bsdf = std::make_unique<MicrofacetTransmission>(albedo, std::move(distribution), 1.0f, ior);
     } else if (metal > 0.5f) {
         // Metallic material
-        Spectrum eta = Spectrum::FromRGB(glm::vec3(0.2f, 0.9f, 1.5f)); // Simplified metal IOR
-        Spectrum k = Spectrum::FromRGB(glm::vec3(3.1f, 2.3f, 1.9f));   // Simplified absorption
+        static const Spectrum eta = Spectrum::FromRGB(glm::vec3(0.2f, 0.9f, 1.5f)); // Simplified metal IOR
+        static const Spectrum k = Spectrum::FromRGB(glm::vec3(3.1f, 2.3f, 1.9f));   // Simplified absorption
         auto fresnel = std::make_unique<FresnelConductor>(Spectrum(1.0f), eta, k);
         auto distribution = std::make_unique<TrowbridgeReitzDistribution>(rough, rough);
         si->bsdf = std::make_unique<MicrofacetReflection>(albedo, std::move(distribution), std::move(fresnel));
@@ -162,8 +163,14 @@ GlassMaterial::GlassMaterial(const Spectrum& kr, const Spectrum& kt, float eta,
 void GlassMaterial::ComputeScatteringFunctions(SurfaceInteraction* si) const {
     float currentEta = eta;
     if (dispersive) {
-        // Use wavelength-dependent IOR for dispersion
-        currentEta = GetIORForWavelength(550.0f); // Use green wavelength as base
+        // Use wavelength-dependent IOR for dispersion. A hero-wavelength path refracts at its
+        // hero wavelength alone; otherwise use green as the base
+        if (si->wavelengths) {
+            si->wavelengths->TerminateSecondary();
+            currentEta = GetIORForWavelength(si->wavelengths->lambda[0]);
+        } else {
+            currentEta = GetIORForWavelength(550.0f);
+        }
     }
     
     auto fresnel = std::make_unique<FresnelDielectric>(1.0f, currentEta);
@@ -353,6 +360,10 @@ void HDRTexture::LoadHDR(const std::string& filename) {
     height = 128;
     pixels.resize(width * height);
     
+    // Uplifted once rather than per texel
+    const Spectrum skyTint = Spectrum::FromRGB(glm::vec3(0.5f, 0.7f, 1.0f));
+    const Spectrum sunColor = Spectrum::FromRGB(glm::vec3(10.0f, 8.0f, 6.0f));
+    
     for (int y = 0; y < height; ++y) {
         for (int x = 0; x < width; ++x) {
             float u = static_cast<float>(x) / (width - 1);
@@ -360,13 +371,13 @@ void HDRTexture::LoadHDR(const std::string& filename) {
             
             // Create a simple sky gradient
             float skyIntensity = std::pow(1.0f - v, 2.0f) * 3.0f; // Brighter at horizon
-            Spectrum skyColor = Spectrum::FromRGB(glm::vec3(0.5f, 0.7f, 1.0f)) * skyIntensity;
+            Spectrum skyColor = skyTint * skyIntensity;
             
             // Add a bright sun
             float sunU = 0.75f, sunV = 0.8f;
             float sunDist = std::sqrt((u - sunU) * (u - sunU) + (v - sunV) * (v - sunV));
             if (sunDist < 0.05f) {
-                skyColor = skyColor + Spectrum::FromRGB(glm::vec3(10.0f, 8.0f, 6.0f));
+                skyColor = skyColor + sunColor;
             }
             
             pixels[y * width + x] = skyColor;
@@ -1,15 +1,21 @@
 #include "App.hpp"
 #include "AdvancedMaterial.hpp" // Add this include for advanced materials
+#include "JobSystem.hpp"
+#include "ProgramBinaryCache.hpp"
+#include "Profiler.hpp"
+#include "ResourceCache.hpp"
+#include "RGBToSpectrumTable.hpp"
 #include <iostream>
 
+extern HWND hWndGlobal;
+
 namespace Engine
 {
 	Engine::App* app = nullptr;
 	
-	bool Init(){
+	bool Init(const BenchmarkSettings& settings){
 		app = new Engine::App();
-		app->Init();
-		return true;
+		return app->Init(settings);
 	}
 	void Release(){
 		if (app) {
@@ -20,41 +26,82 @@ namespace Engine
 	}
 }
 
-Engine::App::App() : window(nullptr) {
+Engine::App::App() : window(nullptr), progressiveView(false), progressiveKeyDown(false),
+	overlayKeyDown(false), traceKeyDown(false), cameraKeyDown(false), cameraPathStart(-1.0f), benchmarkPassed(true) {
 }
 
 Engine::App::~App() {
+	// The next frame's jobs read the camera and meshes
+	framePipeline.Flush();
+	
+	if (progressiveRenderer) {
+		progressiveRenderer->Stop();
+	}
+	
 	// Clean up window if allocated
 	delete window;
 	window = nullptr;
+	
+	JobSystem::Get().Shutdown();
 }
 
-bool Engine::App::Init() {
+bool Engine::App::Init(const BenchmarkSettings& settings) {
+	benchmarkSettings = settings;
+	if (benchmarkSettings.enabled) {
+		if (!sceneConfig.Load(benchmarkSettings.scene)) {
+			return false;
+		}
+		benchmarkSettings.ApplyOverrides(sceneConfig);
+	}
+	
 	window = new WindowWin();
 	openGl = new OpenGL();
 
-	if (!window->Init()) {
+	if (!window->Init(!(benchmarkSettings.enabled && benchmarkSettings.headless))) {
 		return false;
 	}
 	if (!openGl->Init()) {
 		return false;
 	}
 	
+	// Simulation and animation step by the scene's timestep and the path poses the camera, so
+	// every run renders the same frames regardless of how fast they are drawn
+	if (benchmarkSettings.enabled) {
+		openGl->SetFixedTimestep(sceneConfig.timestep);
+		benchmark = std::make_unique<Benchmark>(benchmarkSettings, sceneConfig);
+	}
+	
+	// Vsync is off, so interactive runs are held to the display's rate rather than drawing
+	// frames it never shows; benchmarks run flat out
+	window->SetFrameRateLimit(benchmark ? 0.0 : window->GetDisplayRefreshRate());
+	
+	if (!JobSystem::Get().Init()) {
+		std::cerr << "Job system unavailable; frames are simulated on the render thread" << std::endl;
+	}
+	
+	// Materials uplift their colours while loading; a failed cache write only costs a refit next run
+	if (!RGBToSpectrumTable::Initialize()) {
+		std::cerr << "Failed to cache the RGB to spectrum table" << std::endl;
+	}
+	
 	if (!LoadAssets()) {
 		return false;
 	}
 	
-	// Start main loop
+	// Start main loop; a benchmark ends it once its measured frames are done
 	window->Tick();
-	return true;
+	return benchmarkPassed;
 }
 
 bool Engine::App::LoadAssets() {
+	// Programs compile on the driver's threads while meshes and textures load
+	Shader::BeginParallelCompile();
+	
 	// Create camera
 	camera = std::make_unique<Camera>();
 	
 	// Load meshes (they will create their own materials)
-	if (!LoadMeshes()) {
+	if (sceneConfig.meshes && !LoadMeshes()) {
 		return false;
 	}
 	
@@ -67,11 +114,40 @@ bool Engine::App::LoadAssets() {
 	// SetupClouds();
 	
 	// Computer Graphics book-based systems:
-	SetupOceanCG();
-	SetupCloudsCG();
+	if (sceneConfig.oceanCG) {
+		SetupOceanCG();
+	}
+	if (sceneConfig.cloudsCG) {
+		SetupCloudsCG();
+	}
 	
 	// FFT-based ocean system:
-	//SetupOceanFFT();
+	if (sceneConfig.oceanFFT) {
+		SetupOceanFFT();
+	}
+	
+	// Every material's permutation is compiled during loading rather than on its first draw
+	for (const auto& mesh : meshes) {
+		for (size_t i = 0; i < mesh->getMaterialCount(); ++i) {
+			mesh->getMaterial(i)->getShader();
+		}
+	}
+	// Deferred links only report failures here, so materials left without a program fall back now
+	if (Shader::FinishPendingLinks() > 0) {
+		for (const auto& mesh : meshes) {
+			for (size_t i = 0; i < mesh->getMaterialCount(); ++i) {
+				Material* material = mesh->getMaterial(i);
+				if (!material->getShader().shaderProgram && !material->initFallbackShader()) {
+					std::cerr << "ERROR::MATERIAL:: No shader links for a material of a loaded mesh" << std::endl;
+				}
+			}
+		}
+	}
+	ProgramBinaryCache::Get().Save();
+	ProgramBinaryCache::Get().PrintReport();
+	
+	// Shared textures/programs and what they cost; textures may still be streaming at this point
+	ResourceCache::Get().PrintReport();
 	
 	return true;
 }
@@ -106,9 +182,9 @@ bool Engine::App::LoadMeshes() {
 			}
 			
 			// Log material info from loaded file
-			if (mesh->getMaterial()) {
-				auto* material = mesh->getMaterial();
-				std::cout << "=== MATERIAL LOADED FROM " << meshFiles[i] << " ===" << std::endl;
+			for (size_t m = 0; m < mesh->getMaterialCount(); ++m) {
+				auto* material = mesh->getMaterial(m);
+				std::cout << "=== MATERIAL " << m << " LOADED FROM " << meshFiles[i] << " ===" << std::endl;
 				std::cout << "Albedo: (" << material->getAlbedo().r << ", " << material->getAlbedo().g << ", " << material->getAlbedo().b << ")" << std::endl;
 				std::cout << "Metallic: " << material->getMetallic() << std::endl;
 				std::cout << "Roughness: " << material->getRoughness() << std::endl;
@@ -127,15 +203,18 @@ bool Engine::App::LoadMeshes() {
 }
 
 void Engine::App::ConfigureAdvancedSceneMaterial(Mesh* mesh) {
-	if (!mesh || !mesh->getMaterial()) return;
+	if (!mesh) return;
 	
-	Material* material = mesh->getMaterial();
+	for (size_t i = 0; i < mesh->getMaterialCount(); ++i) {
+		ConfigureAdvancedSceneMaterial(mesh->getMaterial(i));
+	}
+}
+
+void Engine::App::ConfigureAdvancedSceneMaterial(Material* material) {
+	if (!material) return;
 	
 	std::cout << "Configuring Advanced Scene Material..." << std::endl;
 	
-	// Use advanced PBR shader for realistic rendering with material type support
-	material->InitWithShader("shaders/pbr_shadows.vert", "shaders/pbr_shadows_reflections.frag");
-	
 	// CHOOSE MATERIAL TYPE: Comment/uncomment to switch between different materials
 	// Option 1: Disney BRDF Material (currently active)
 	//ConfigureDisneyTerrainMaterial(material);
@@ -152,9 +231,15 @@ void Engine::App::ConfigureAdvancedSceneMaterial(Mesh* mesh) {
 	std::cout << "2. Subsurface - Realistic organic material" << std::endl;
 	std::cout << "3. Basic PBR - Standard metallic/roughness workflow" << std::endl;
 	
-	// Load ALL available textures for the scene
-	std::cout << "Loading ALL available scene textures..." << std::endl;
-	LoadAllSceneTextures(material);
+	// Materials that found their own textures in the file keep them; the rest get the terrain set
+	if (!material->hasDiffuseTexture()) {
+		std::cout << "Loading ALL available scene textures..." << std::endl;
+		LoadAllSceneTextures(material);
+	}
+	
+	// Use advanced PBR shader for realistic rendering with material type support. Chosen once the
+	// type and textures are final, so only the permutation that gets drawn is compiled.
+	material->InitWithShader("shaders/pbr_shadows.vert", "shaders/pbr_shadows_reflections.frag");
 	
 	std::cout << "Advanced Scene material configuration complete." << std::endl;
 	std::cout << "- Material Type: " << GetMaterialTypeName(material->getMaterialType()) << std::endl;
@@ -168,15 +253,18 @@ void Engine::App::ConfigureAdvancedSceneMaterial(Mesh* mesh) {
 }
 
 void Engine::App::ConfigureAdvancedCavalryMaterial(Mesh* mesh) {
-	if (!mesh || !mesh->getMaterial()) return;
+	if (!mesh) return;
 	
-	Material* material = mesh->getMaterial();
+	for (size_t i = 0; i < mesh->getMaterialCount(); ++i) {
+		ConfigureAdvancedCavalryMaterial(mesh->getMaterial(i));
+	}
+}
+
+void Engine::App::ConfigureAdvancedCavalryMaterial(Material* material) {
+	if (!material) return;
 	
 	std::cout << "Configuring Advanced Cavalry Material..." << std::endl;
 	
-	// Use advanced PBR shader for realistic rendering with material type support
-	material->InitWithShader("shaders/pbr.vert", "shaders/pbr_shadows_reflections.frag");
-	
 	// CHOOSE MATERIAL TYPE: Comment/uncomment to switch between different materials
 	// Option 1: Metal Material (Realistic metal properties) (currently active)
 	//ConfigureMetalArmorMaterial(material);
@@ -187,6 +275,9 @@ void Engine::App::ConfigureAdvancedCavalryMaterial(Mesh* mesh) {
 	// Option 3: Basic PBR Material
 	 ConfigureBasicPBRArmorMaterial(material);
 	
+	// Use advanced PBR shader for realistic rendering with material type support, after the type is set
+	material->InitWithShader("shaders/pbr.vert", "shaders/pbr_shadows_reflections.frag");
+	
 	std::cout << "\n=== CAVALRY ARMOR MATERIAL OPTIONS ===" << std::endl;
 	std::cout << "To switch materials, edit App.cpp lines 152-158:" << std::endl;
 	std::cout << "1. Metal Material - Realistic gold with complex IOR (ACTIVE)" << std::endl;
@@ -431,24 +522,145 @@ void Engine::App::SetupLights() {
 }
 
 bool Engine::App::Tick() {
-	// Get actual delta time from OpenGL for frame-rate independent animation
-	float deltaTime = openGl->getDeltaTime();
-	// UpdateEnvironmentalSystems(deltaTime);  // Original systems
-	UpdateCGSystems(deltaTime);  // Book-based systems
+	// The simulation's GPU work belongs to the frame it is rendered in
+	Profiler& profiler = Profiler::Get();
+	profiler.BeginFrame();
+	
+	// The first frame has no simulation running ahead of it
+	if (!framePipeline.IsInFlight()) {
+		KickSimulation();
+	}
+	FrameSnapshot& frame = framePipeline.Acquire();
 	
-	return Render();
+	// Poses the camera for the next frame's simulation, or ends the run; after the profiler
+	// has folded in the previous frame, so the totals cover exactly the measured frames
+	if (benchmark && !benchmark->BeginFrame(*camera, openGl->IsStreaming())) {
+		benchmarkPassed = benchmark->Finish();
+		return false;
+	}
+	
+	if (!benchmark) {
+		bool progressiveKey = (GetAsyncKeyState('P') & 0x8000) != 0;
+		if (progressiveKey && !progressiveKeyDown) {
+			ToggleProgressiveView(frame.camera);
+		}
+		progressiveKeyDown = progressiveKey;
+		
+		// O shows the profiler overlay, T writes the recorded frames as a Chrome trace
+		bool overlayKey = (GetAsyncKeyState('O') & 0x8000) != 0;
+		if (overlayKey && !overlayKeyDown) {
+			profiler.SetOverlayVisible(!profiler.IsOverlayVisible());
+		}
+		overlayKeyDown = overlayKey;
+		
+		bool traceKey = (GetAsyncKeyState('T') & 0x8000) != 0;
+		if (traceKey && !traceKeyDown) {
+			profiler.ExportChromeTrace();
+		}
+		traceKeyDown = traceKey;
+		
+		bool cameraKey = (GetAsyncKeyState('K') & 0x8000) != 0;
+		if (cameraKey && !cameraKeyDown) {
+			RecordCameraKey(frame.camera);
+		}
+		cameraKeyDown = cameraKey;
+	}
+	
+	// The next frame simulates and culls on the job system while this one is drawn
+	KickSimulation();
+	
+	// The systems' own updates stay on the render thread: the FFT ocean dispatches compute,
+	// and the rest hold state their draws read
+	profiler.BeginCPU("Simulation");
+	// UpdateEnvironmentalSystems(frame.deltaTime);  // Original systems
+	UpdateCGSystems(frame.deltaTime);  // Book-based systems
+	profiler.EndCPU();
+	
+	bool result = Render(frame);
+	if (benchmark) {
+		benchmark->EndFrame();
+	}
+	return result;
 }
 
-bool Engine::App::Render() {
+void Engine::App::KickSimulation() {
+	// Read here, on the render thread, so the job never touches OpenGL's frame timing;
+	// benchmarks use the fixed step from the first frame on
+	float deltaTime = benchmark ? sceneConfig.timestep : openGl->getDeltaTime();
+	bool takeInput = !benchmark && !progressiveView;
+	
+	framePipeline.Kick([this, deltaTime, takeInput](FrameSnapshot& frame) {
+		if (takeInput) {
+			camera->processKeyboard(deltaTime);
+			camera->processMouseMovement(hWndGlobal);
+		}
+		frame.camera = *camera;
+		frame.deltaTime = deltaTime;
+		openGl->PrepareFrame(frame, meshes);
+	});
+}
+
+void Engine::App::RecordCameraKey(const Camera& view) {
+	float now = openGl->getElapsedTime();
+	if (cameraPathStart < 0.0f) {
+		cameraPathStart = now;
+	}
+	
+	CameraKey key;
+	key.time = now - cameraPathStart;
+	key.position = view.getPosition();
+	key.yaw = view.getYaw();
+	key.pitch = view.getPitch();
+	if (WriteCameraKey(CAMERA_PATH_RECORDING, key)) {
+		std::cout << "Camera key " << key.time << " s written to " << CAMERA_PATH_RECORDING << std::endl;
+	}
+}
+
+bool Engine::App::Render(FrameSnapshot& frame) {
+	if (progressiveView) {
+		openGl->RenderProgressive(*progressiveRenderer);
+		return true;
+	}
+	
 	// Choose rendering approach
 	// Original systems:
-	// openGl->Render(camera.get(), meshes, lights, ocean.get(), cloudSystem.get());
+	// openGl->Render(frame, meshes, lights, ocean.get(), cloudSystem.get());
 	
 	// Book-based systems with FFT ocean:
-	openGl->Render(camera.get(), meshes, lights, nullptr, nullptr, oceanCG.get(), cloudsCG.get(), oceanFFT.get());
+	openGl->Render(frame, meshes, lights, nullptr, nullptr, oceanCG.get(), cloudsCG.get(), oceanFFT.get());
 	return true;
 }
 
+void Engine::App::ToggleProgressiveView(const Camera& view) {
+	if (progressiveView) {
+		progressiveRenderer->Stop();
+		progressiveView = false;
+		return;
+	}
+	
+	// Built on first use: the BVH copies the meshes as they are placed now
+	if (!rayScene) {
+		rayScene = std::make_unique<BVHScene>(meshes, lights);
+		pathIntegrator = std::make_unique<PathIntegrator>();
+		progressiveRenderer = std::make_unique<ProgressiveRenderer>();
+	}
+	
+	RECT client;
+	GetClientRect(hWndGlobal, &client);
+	
+	ProgressiveRenderer::Settings settings;
+	settings.width = client.right - client.left;
+	settings.height = client.bottom - client.top;
+	settings.cameraToWorld = glm::inverse(view.getViewMatrix());
+	settings.fov = view.getZoom();
+	
+	const PathIntegrator* integrator = pathIntegrator.get();
+	const Scene* scene = rayScene.get();
+	progressiveView = progressiveRenderer->Start([integrator, scene](const Ray& ray, Sampler& sampler) {
+		return integrator->Li(ray, *scene, sampler);
+	}, settings);
+}
+
 void Engine::App::SetupOcean() {
 	std::cout << "\n=== SETTING UP REALISTIC OCEAN SYSTEM ===" << std::endl;
 	
@@ -486,6 +698,7 @@ void Engine::App::SetupClouds() {
 	cloudConfig.cloudCoverage = 0.3f;         // Partly cloudy
 	cloudConfig.numSteps = 48;                // Good quality vs performance
 	cloudConfig.numLightSteps = 4;            // Faster light sampling
+	cloudConfig.enableTemporalReprojection = true; // Quarter-res march, reconstructed over 16 frames
 	
 	// Set wind for realistic movement
 	cloudConfig.windDirection = glm::vec3(1.0f, 0.1f, 0.5f);
@@ -604,6 +817,9 @@ void Engine::App::SetupCloudsCG() {
 		// Set sun direction (matching the lighting)
 		cloudsCG->SetLightDirection(glm::vec3(-0.3f, -0.7f, -0.2f));
 		
+		// Bake the sky into a cubemap (one face per frame) that also feeds reflections
+		cloudsCG->EnableSkyCache(128, 1);
+		
 		std::cout << "☁️ Clouds (CG Book) initialized successfully!" << std::endl;
 		std::cout << "- Skybox technique from the book" << std::endl;
 		std::cout << "- 3D procedural noise (Perlin-like)" << std::endl;
@@ -628,6 +844,7 @@ void Engine::App::UpdateCGSystems(float deltaTime) {
 	
 	// Update FFT ocean system
 	if (oceanFFT && oceanFFT->IsInitialized()) {
+		PROFILE_PASS("Ocean FFT");
 		oceanFFT->Update(deltaTime);
 	}
 }
\ No newline at end of file
@@ -9,6 +9,10 @@
 #include "OceanCG.hpp"
 #include "CloudsCG.hpp"
 #include "OceanFFT.hpp"
+#include "BVHScene.hpp"
+#include "ProgressiveRenderer.hpp"
+#include "Benchmark.hpp"
+#include "FramePipeline.hpp"
 #include <vector>
 #include <memory>
 
@@ -34,15 +38,45 @@ namespace Engine {
 		
 		// FFT-based ocean system
 		std::unique_ptr<OceanFFT> oceanFFT;
+		
+		// Path-traced view of the same scene, toggled with P; the renderer is declared last so
+		// it stops before the scene it traces is destroyed
+		std::unique_ptr<BVHScene> rayScene;
+		std::unique_ptr<PathIntegrator> pathIntegrator;
+		std::unique_ptr<ProgressiveRenderer> progressiveRenderer;
+		bool progressiveView;
+		bool progressiveKeyDown;
+		
+		// Profiler overlay (O) and trace export (T) keys, edge-triggered like P
+		bool overlayKeyDown;
+		bool traceKeyDown;
+		
+		// K appends the current camera pose to CAMERA_PATH_RECORDING for benchmark paths, timed
+		// from the first key recorded this run
+		bool cameraKeyDown;
+		float cameraPathStart;
+		
+		// Which systems load; the interactive default unless a benchmark names a scene
+		SceneConfig sceneConfig;
+		BenchmarkSettings benchmarkSettings;
+		std::unique_ptr<Benchmark> benchmark;
+		bool benchmarkPassed;
+		
+		// Frame N+1's camera, transforms and culling run as jobs while frame N renders. Declared
+		// after everything its jobs read, so it is destroyed (and waits for them) first.
+		FramePipeline framePipeline;
 
 	public:
 		App();
 		~App();
-		bool Init();
+		// False when loading fails or a benchmark run does not pass
+		bool Init(const BenchmarkSettings& settings);
 		bool Tick();
 
 	private:
-		bool Render();
+		bool Render(FrameSnapshot& frame);
+		void KickSimulation();
+		void RecordCameraKey(const Camera& view);
 		bool LoadAssets();
 		bool LoadMeshes();
 		void SetupLights();
@@ -53,7 +87,9 @@ namespace Engine {
 		
 		// Advanced material configuration methods
 		void ConfigureAdvancedSceneMaterial(Mesh* mesh);
+		void ConfigureAdvancedSceneMaterial(Material* material);
 		void ConfigureAdvancedCavalryMaterial(Mesh* mesh);
+		void ConfigureAdvancedCavalryMaterial(Material* material);
 		
 		// Material preset creation utilities
 		std::shared_ptr<AdvancedMaterial> CreateTerrainMaterial();
@@ -81,6 +117,9 @@ namespace Engine {
 		void SetupCloudsCG();
 		void UpdateCGSystems(float deltaTime);
 		
+		// Starts a progressive path trace from the given camera, or returns to the raster view
+		void ToggleProgressiveView(const Camera& view);
+		
 		// Helper methods
 		std::string GetMaterialTypeName(MaterialType type);
 		void LoadAllSceneTextures(Material* material);
@@ -93,7 +132,7 @@ namespace Engine {
 
 	extern Engine::App* app;
 
-	bool Init();
+	bool Init(const BenchmarkSettings& settings);
 	void Release();
 }
 
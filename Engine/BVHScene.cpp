@@ -0,0 +1,823 @@
+#include "BVHScene.hpp"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <immintrin.h>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+namespace {
+    // Traversal stacks hold one entry per level, so the build keeps leaves above this depth
+    const int MAX_TRAVERSAL_DEPTH = 64;
+    // From here on nodes take median splits: 17 halvings bring any 32-bit primitive count
+    // under the 16-bit leaf limit by the last level MAX_TRAVERSAL_DEPTH allows
+    const int FORCED_SPLIT_DEPTH = MAX_TRAVERSAL_DEPTH - 1 - 17;
+    const int PACKET_SIZE = 4;
+
+    // Widens the slab test's far distance so rounding cannot miss a box a ray grazes
+    const float BOX_EXIT_SCALE = 1.0f + 2.0f * 3.0f * 0.5f * std::numeric_limits<float>::epsilon();
+
+    float SurfaceArea(const AABB& box)
+    {
+        glm::vec3 d = box.maxPoint - box.minPoint;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    bool IntersectBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec3& origin,
+                      const glm::vec3& invDirection, float tMin, float tMax)
+    {
+        glm::vec3 t0 = (boundsMin - origin) * invDirection;
+        glm::vec3 t1 = (boundsMax - origin) * invDirection;
+        glm::vec3 tNear = (glm::min)(t0, t1);
+        glm::vec3 tFar = (glm::max)(t0, t1);
+        float enter = (std::max)((std::max)(tNear.x, tNear.y), (std::max)(tNear.z, tMin));
+        float exit = (std::min)((std::min)(tFar.x, tFar.y), (std::min)(tFar.z, tMax)) * BOX_EXIT_SCALE;
+        return enter <= exit;
+    }
+
+    // Moller-Trumbore; b1 and b2 are the barycentrics of v1 and v2
+    bool IntersectTriangle(const glm::vec3& v0, const glm::vec3& edge1, const glm::vec3& edge2, const Ray& ray,
+                           float tMax, float& t, float& b1, float& b2)
+    {
+        glm::vec3 p = glm::cross(ray.direction, edge2);
+        float det = glm::dot(edge1, p);
+        if (std::abs(det) < 1e-12f) return false;
+        float invDet = 1.0f / det;
+
+        glm::vec3 toOrigin = ray.origin - v0;
+        b1 = glm::dot(toOrigin, p) * invDet;
+        if (b1 < 0.0f || b1 > 1.0f) return false;
+
+        glm::vec3 q = glm::cross(toOrigin, edge1);
+        b2 = glm::dot(ray.direction, q) * invDet;
+        if (b2 < 0.0f || b1 + b2 > 1.0f) return false;
+
+        t = glm::dot(edge2, q) * invDet;
+        return t > ray.tMin && t < tMax;
+    }
+}
+
+// One SSE lane per ray; lanes past the end of the stream get an empty [tMin, tMax] and never hit
+struct BVHScene::RayPacket {
+    __m128 ox, oy, oz;
+    __m128 dx, dy, dz;
+    __m128 invDx, invDy, invDz;
+    __m128 tMin, tMax;
+    int lanes;                      // Bit per lane holding a ray
+    bool directionIsNegative[3];    // Shared by every lane, so one near-first order suits them all
+};
+
+namespace {
+    __m128 Select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    // IntersectBox for every lane against one node; returns the lanes that hit
+    int IntersectBoxPacket(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const __m128& ox,
+                           const __m128& oy, const __m128& oz, const __m128& invDx, const __m128& invDy,
+                           const __m128& invDz, const __m128& tMin, const __m128& tMax)
+    {
+        __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.x), ox), invDx);
+        __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.y), oy), invDy);
+        __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.z), oz), invDz);
+        __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMax.x), ox), invDx);
+        __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMax.y), oy), invDy);
+        __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMax.z), oz), invDz);
+
+        __m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)),
+                                  _mm_max_ps(_mm_min_ps(t0z, t1z), tMin));
+        __m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)),
+                                 _mm_min_ps(_mm_max_ps(t0z, t1z), tMax));
+        exit = _mm_mul_ps(exit, _mm_set1_ps(BOX_EXIT_SCALE));
+        return _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+    }
+
+    // IntersectTriangle for every lane against one triangle; returns the mask of lanes that hit
+    // before their tMax, with t, b1 and b2 filled in for those lanes
+    __m128 IntersectTrianglePacket(const glm::vec3& v0, const glm::vec3& edge1, const glm::vec3& edge2,
+                                   const __m128& ox, const __m128& oy, const __m128& oz, const __m128& dx,
+                                   const __m128& dy, const __m128& dz, const __m128& tMin, const __m128& tMax,
+                                   __m128& t, __m128& b1, __m128& b2)
+    {
+        __m128 e1x = _mm_set1_ps(edge1.x), e1y = _mm_set1_ps(edge1.y), e1z = _mm_set1_ps(edge1.z);
+        __m128 e2x = _mm_set1_ps(edge2.x), e2y = _mm_set1_ps(edge2.y), e2z = _mm_set1_ps(edge2.z);
+
+        // p = cross(direction, edge2)
+        __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(e2y, dz));
+        __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(e2z, dx));
+        __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(e2x, dy));
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+        __m128 valid = _mm_cmpge_ps(absDet, _mm_set1_ps(1e-12f));
+        __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+        __m128 tox = _mm_sub_ps(ox, _mm_set1_ps(v0.x));
+        __m128 toy = _mm_sub_ps(oy, _mm_set1_ps(v0.y));
+        __m128 toz = _mm_sub_ps(oz, _mm_set1_ps(v0.z));
+        b1 = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tox, px), _mm_mul_ps(toy, py)), _mm_mul_ps(toz, pz)), invDet);
+        valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(b1, _mm_setzero_ps()), _mm_cmple_ps(b1, _mm_set1_ps(1.0f))));
+
+        // q = cross(toOrigin, edge1)
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(toy, e1z), _mm_mul_ps(e1y, toz));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(toz, e1x), _mm_mul_ps(e1z, tox));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(tox, e1y), _mm_mul_ps(e1x, toy));
+        b2 = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+        valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(b2, _mm_setzero_ps()),
+                                             _mm_cmple_ps(_mm_add_ps(b1, b2), _mm_set1_ps(1.0f))));
+
+        t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+        return _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(t, tMin), _mm_cmplt_ps(t, tMax)));
+    }
+}
+
+struct BVHScene::BuildPrimitive {
+    AABB bounds;
+    glm::vec3 centroid;
+    uint32_t index;
+};
+
+struct BVHScene::BuildNode {
+    AABB bounds;
+    std::unique_ptr<BuildNode> children[2];
+    uint32_t start = 0;
+    uint32_t count = 0;      // Non-zero for leaves
+    int axis = 0;
+};
+
+BVHScene::BVHScene(const std::vector<std::unique_ptr<Mesh>>& sceneMeshes,
+                   const std::vector<std::unique_ptr<Light>>& sceneLights,
+                   const BuildSettings& settings)
+    : buildSettings(settings)
+{
+    for (const auto& light : sceneLights) {
+        if (light && light->enabled) {
+            lights.push_back(light.get());
+            lightEmission.push_back(Spectrum::FromRGB(light->color * light->intensity));
+        }
+    }
+
+    for (const auto& mesh : sceneMeshes) {
+        if (!mesh || !mesh->isValid()) continue;
+        const std::vector<Vertex>& vertices = mesh->getVertices();
+        const std::vector<unsigned int>& indices = mesh->getIndices();
+        if (vertices.empty() || indices.empty()) continue;
+
+        // Instanced meshes contribute one copy per instance, as they are drawn
+        glm::mat4 model = mesh->getModelMatrix();
+        std::vector<glm::mat4> worldMatrices;
+        if (mesh->isInstanced()) {
+            for (const Transform& instance : mesh->getInstanceBuffer()->GetTransforms()) {
+                worldMatrices.push_back(model * instance.getModelMatrix());
+            }
+        } else {
+            worldMatrices.push_back(model);
+        }
+
+        for (const glm::mat4& world : worldMatrices) {
+            glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(world)));
+
+            for (const SubMesh& subMesh : mesh->getSubMeshes()) {
+                const Material* material = mesh->getMaterial(subMesh.materialIndex);
+
+                for (unsigned int i = 0; i + 2 < subMesh.indexCount; i += 3) {
+                    const Vertex& a = vertices[indices[subMesh.firstIndex + i + 0] + subMesh.baseVertex];
+                    const Vertex& b = vertices[indices[subMesh.firstIndex + i + 1] + subMesh.baseVertex];
+                    const Vertex& c = vertices[indices[subMesh.firstIndex + i + 2] + subMesh.baseVertex];
+
+                    Triangle triangle;
+                    triangle.v0 = glm::vec3(world * glm::vec4(a.position, 1.0f));
+                    triangle.edge1 = glm::vec3(world * glm::vec4(b.position, 1.0f)) - triangle.v0;
+                    triangle.edge2 = glm::vec3(world * glm::vec4(c.position, 1.0f)) - triangle.v0;
+
+                    // Zero-area triangles can never be hit, but would still cost a test
+                    if (glm::dot(glm::cross(triangle.edge1, triangle.edge2), glm::cross(triangle.edge1, triangle.edge2)) == 0.0f) continue;
+
+                    TriangleShading triangleShading;
+                    triangleShading.n0 = normalMatrix * a.normal;
+                    triangleShading.n1 = normalMatrix * b.normal;
+                    triangleShading.n2 = normalMatrix * c.normal;
+                    triangleShading.uv0 = a.texCoords;
+                    triangleShading.uv1 = b.texCoords;
+                    triangleShading.uv2 = c.texCoords;
+                    triangleShading.material = material;
+
+                    triangles.push_back(triangle);
+                    shading.push_back(triangleShading);
+                }
+            }
+        }
+    }
+
+    Build();
+}
+
+BVHScene::~BVHScene()
+{
+}
+
+void BVHScene::Build()
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    std::vector<BuildPrimitive> primitives(triangles.size());
+    sceneBounds = AABB();
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        const Triangle& triangle = triangles[i];
+        BuildPrimitive& primitive = primitives[i];
+        primitive.bounds = AABB();
+        primitive.bounds.expand(triangle.v0);
+        primitive.bounds.expand(triangle.v0 + triangle.edge1);
+        primitive.bounds.expand(triangle.v0 + triangle.edge2);
+        primitive.centroid = primitive.bounds.center();
+        primitive.index = static_cast<uint32_t>(i);
+        sceneBounds.expand(primitive.bounds);
+    }
+
+    nodes.clear();
+    if (primitives.empty()) {
+        std::cout << "BVH scene is empty" << std::endl;
+        return;
+    }
+
+    // Enough levels of parallel subtrees to give every thread a couple of them
+    unsigned threadCount = buildSettings.threadCount ? buildSettings.threadCount : (std::max)(1u, std::thread::hardware_concurrency());
+    int parallelDepth = 0;
+    while ((1u << parallelDepth) < threadCount * 2) {
+        ++parallelDepth;
+    }
+
+    std::unique_ptr<BuildNode> root = BuildRecursive(primitives, 0, primitives.size(), 0, parallelDepth);
+
+    // Leaves index contiguous ranges of the partitioned primitive list
+    std::vector<Triangle> orderedTriangles(triangles.size());
+    std::vector<TriangleShading> orderedShading(shading.size());
+    for (size_t i = 0; i < primitives.size(); ++i) {
+        orderedTriangles[i] = triangles[primitives[i].index];
+        orderedShading[i] = shading[primitives[i].index];
+    }
+    triangles.swap(orderedTriangles);
+    shading.swap(orderedShading);
+
+    nodes.reserve(primitives.size() * 2);
+    Flatten(*root);
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    std::cout << "BVH built: " << triangles.size() << " triangles, " << nodes.size() << " nodes in "
+              << std::chrono::duration<double, std::milli>(endTime - startTime).count() << " ms" << std::endl;
+}
+
+std::unique_ptr<BVHScene::BuildNode> BVHScene::BuildRecursive(std::vector<BuildPrimitive>& primitives, size_t start, size_t end,
+                                                              int depth, int parallelDepth) const
+{
+    std::unique_ptr<BuildNode> node(new BuildNode());
+    for (size_t i = start; i < end; ++i) {
+        node->bounds.expand(primitives[i].bounds);
+    }
+
+    size_t count = end - start;
+    auto makeLeaf = [&]() {
+        node->start = static_cast<uint32_t>(start);
+        node->count = static_cast<uint32_t>(count);
+        return std::move(node);
+    };
+    if (count <= 1 || (depth >= MAX_TRAVERSAL_DEPTH - 1 && count <= 0xFFFF)) {
+        return makeLeaf();
+    }
+
+    AABB centroidBounds;
+    for (size_t i = start; i < end; ++i) {
+        centroidBounds.expand(primitives[i].centroid);
+    }
+    glm::vec3 extent = centroidBounds.maxPoint - centroidBounds.minPoint;
+    int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+    size_t mid = start;
+    if (extent[axis] <= 0.0f) {
+        // Coincident centroids cannot be separated by any plane; only split them when the
+        // leaf would overflow its 16-bit triangle count
+        if (count <= 0xFFFF) {
+            return makeLeaf();
+        }
+        mid = start + count / 2;
+        node->axis = axis;
+        node->children[0] = BuildRecursive(primitives, start, mid, depth + 1, 0);
+        node->children[1] = BuildRecursive(primitives, mid, end, depth + 1, 0);
+        return node;
+    }
+
+    int binCount = (std::max)(2, buildSettings.binCount);
+    float axisMin = centroidBounds.minPoint[axis];
+    float binScale = binCount / extent[axis];
+    auto binOf = [&](const BuildPrimitive& primitive) {
+        return (std::min)(binCount - 1, static_cast<int>((primitive.centroid[axis] - axisMin) * binScale));
+    };
+
+    // Bin centroids, then sweep from both sides to cost every split in O(bins)
+    std::vector<int> binCounts(binCount, 0);
+    std::vector<AABB> binBounds(binCount);
+    for (size_t i = start; i < end; ++i) {
+        int bin = binOf(primitives[i]);
+        ++binCounts[bin];
+        binBounds[bin].expand(primitives[i].bounds);
+    }
+
+    std::vector<float> leftArea(binCount - 1);
+    std::vector<int> leftCount(binCount - 1);
+    AABB sweep;
+    int sweepCount = 0;
+    for (int i = 0; i < binCount - 1; ++i) {
+        if (binCounts[i] > 0) sweep.expand(binBounds[i]);
+        sweepCount += binCounts[i];
+        leftArea[i] = sweepCount > 0 ? SurfaceArea(sweep) : 0.0f;
+        leftCount[i] = sweepCount;
+    }
+
+    // Cost in units of one triangle test, with a node traversal costing 1/8 of one
+    float parentArea = SurfaceArea(node->bounds);
+    float bestCost = std::numeric_limits<float>::infinity();
+    int bestSplit = -1;
+    sweep = AABB();
+    sweepCount = 0;
+    for (int i = binCount - 1; i > 0; --i) {
+        if (binCounts[i] > 0) sweep.expand(binBounds[i]);
+        sweepCount += binCounts[i];
+        if (leftCount[i - 1] == 0 || sweepCount == 0) continue;
+        float cost = 0.125f + (leftCount[i - 1] * leftArea[i - 1] + sweepCount * SurfaceArea(sweep)) / parentArea;
+        if (cost < bestCost) {
+            bestCost = cost;
+            bestSplit = i - 1;
+        }
+    }
+
+    // Degenerate or tightly clustered geometry can run deep; past FORCED_SPLIT_DEPTH only small
+    // leaves and median splits are left
+    if (depth < FORCED_SPLIT_DEPTH && bestSplit >= 0 && (count > static_cast<size_t>(buildSettings.maxLeafPrimitives) || bestCost < static_cast<float>(count))) {
+        mid = std::partition(primitives.begin() + start, primitives.begin() + end,
+                             [&](const BuildPrimitive& primitive) { return binOf(primitive) <= bestSplit; }) - primitives.begin();
+    } else if (count <= static_cast<size_t>(buildSettings.maxLeafPrimitives) && count <= 0xFFFF) {
+        return makeLeaf();
+    }
+
+    // Every centroid landed in one bin, or the tree is too deep: fall back to a median split
+    if (mid == start || mid == end) {
+        mid = start + count / 2;
+        std::nth_element(primitives.begin() + start, primitives.begin() + mid, primitives.begin() + end,
+                         [axis](const BuildPrimitive& a, const BuildPrimitive& b) { return a.centroid[axis] < b.centroid[axis]; });
+    }
+
+    node->axis = axis;
+    if (parallelDepth > 0 && count >= buildSettings.parallelThreshold) {
+        // The two halves touch disjoint ranges of primitives, so they can be built concurrently
+        std::future<std::unique_ptr<BuildNode>> left = std::async(std::launch::async, [&, start, mid]() {
+            return BuildRecursive(primitives, start, mid, depth + 1, parallelDepth - 1);
+        });
+        node->children[1] = BuildRecursive(primitives, mid, end, depth + 1, parallelDepth - 1);
+        node->children[0] = left.get();
+    } else {
+        node->children[0] = BuildRecursive(primitives, start, mid, depth + 1, 0);
+        node->children[1] = BuildRecursive(primitives, mid, end, depth + 1, 0);
+    }
+    return node;
+}
+
+int32_t BVHScene::Flatten(const BuildNode& node)
+{
+    int32_t index = static_cast<int32_t>(nodes.size());
+    LinearNode linear;
+    linear.boundsMin = node.bounds.minPoint;
+    linear.boundsMax = node.bounds.maxPoint;
+    linear.axis = static_cast<uint8_t>(node.axis);
+    linear.padding = 0;
+    linear.offset = 0;
+    linear.triangleCount = 0;
+    nodes.push_back(linear);
+
+    if (node.count > 0) {
+        nodes[index].offset = static_cast<int32_t>(node.start);
+        nodes[index].triangleCount = static_cast<uint16_t>(node.count);
+        return index;
+    }
+
+    // First child directly follows its parent; only the second needs an offset
+    Flatten(*node.children[0]);
+    int32_t secondChild = Flatten(*node.children[1]);
+    nodes[index].offset = secondChild;
+    return index;
+}
+
+int32_t BVHScene::FindClosest(const Ray& ray, float& tHit, float& b1, float& b2) const
+{
+    if (nodes.empty()) return -1;
+
+    glm::vec3 invDirection = 1.0f / ray.direction;
+    bool directionIsNegative[3] = { invDirection.x < 0.0f, invDirection.y < 0.0f, invDirection.z < 0.0f };
+
+    float tMax = ray.tMax;
+    int32_t hit = -1;
+    int32_t stack[MAX_TRAVERSAL_DEPTH];
+    int stackSize = 0;
+    int32_t current = 0;
+
+    for (;;) {
+        const LinearNode& node = nodes[current];
+        if (IntersectBox(node.boundsMin, node.boundsMax, ray.origin, invDirection, ray.tMin, tMax)) {
+            if (node.triangleCount > 0) {
+                for (int32_t i = node.offset; i < node.offset + node.triangleCount; ++i) {
+                    const Triangle& triangle = triangles[i];
+                    float t, u, v;
+                    if (IntersectTriangle(triangle.v0, triangle.edge1, triangle.edge2, ray, tMax, t, u, v)) {
+                        tMax = t;
+                        hit = i;
+                        b1 = u;
+                        b2 = v;
+                    }
+                }
+                if (stackSize == 0) break;
+                current = stack[--stackSize];
+            } else if (directionIsNegative[node.axis]) {
+                // Visit the child on the ray's side of the split first, so tMax shrinks sooner
+                assert(stackSize < MAX_TRAVERSAL_DEPTH);
+                stack[stackSize++] = current + 1;
+                current = node.offset;
+            } else {
+                assert(stackSize < MAX_TRAVERSAL_DEPTH);
+                stack[stackSize++] = node.offset;
+                current = current + 1;
+            }
+        } else {
+            if (stackSize == 0) break;
+            current = stack[--stackSize];
+        }
+    }
+
+    tHit = tMax;
+    return hit;
+}
+
+bool BVHScene::Intersect(const Ray& ray, SurfaceInteraction* isect) const
+{
+    float tHit, b1 = 0.0f, b2 = 0.0f;
+    int32_t hit = FindClosest(ray, tHit, b1, b2);
+    if (hit < 0) return false;
+    if (isect) FillInteraction(ray, hit, tHit, b1, b2, isect);
+    return true;
+}
+
+void BVHScene::FillInteraction(const Ray& ray, int32_t hit, float tHit, float b1, float b2,
+                               SurfaceInteraction* isect) const
+{
+    const Triangle& triangle = triangles[hit];
+    const TriangleShading& s = shading[hit];
+    float b0 = 1.0f - b1 - b2;
+
+    isect->t = tHit;
+    isect->p = ray(tHit);
+    isect->wo = -glm::normalize(ray.direction);
+    isect->uv = s.uv0 * b0 + s.uv1 * b1 + s.uv2 * b2;
+    isect->material = s.material;
+
+    glm::vec3 geometricNormal = glm::normalize(glm::cross(triangle.edge1, triangle.edge2));
+    glm::vec3 n = s.n0 * b0 + s.n1 * b1 + s.n2 * b2;
+    n = glm::dot(n, n) > 0.0f ? glm::normalize(n) : geometricNormal;
+    // Face the viewer, so SpawnRay's offset along n leaves on the side the ray arrived from
+    if (glm::dot(n, ray.direction) > 0.0f) n = -n;
+    isect->n = n;
+
+    // Tangents from the uv parameterisation, or any frame around n when it is degenerate
+    glm::vec2 duv02 = s.uv0 - s.uv2;
+    glm::vec2 duv12 = s.uv1 - s.uv2;
+    glm::vec3 dp02 = -triangle.edge2;
+    glm::vec3 dp12 = triangle.edge1 - triangle.edge2;
+    float determinant = duv02.x * duv12.y - duv02.y * duv12.x;
+    if (std::abs(determinant) < 1e-9f) {
+        SpectralUtils::CoordinateSystem(n, &isect->dpdu, &isect->dpdv);
+    } else {
+        float invDeterminant = 1.0f / determinant;
+        isect->dpdu = (duv12.y * dp02 - duv02.y * dp12) * invDeterminant;
+        isect->dpdv = (-duv12.x * dp02 + duv02.x * dp12) * invDeterminant;
+    }
+    isect->dndu = glm::vec3(0.0f);
+    isect->dndv = glm::vec3(0.0f);
+}
+
+bool BVHScene::IntersectP(const Ray& ray) const
+{
+    if (nodes.empty()) return false;
+
+    glm::vec3 invDirection = 1.0f / ray.direction;
+    bool directionIsNegative[3] = { invDirection.x < 0.0f, invDirection.y < 0.0f, invDirection.z < 0.0f };
+
+    int32_t stack[MAX_TRAVERSAL_DEPTH];
+    int stackSize = 0;
+    int32_t current = 0;
+
+    // Any hit ends the search, so there is no tMax to shrink
+    for (;;) {
+        const LinearNode& node = nodes[current];
+        if (IntersectBox(node.boundsMin, node.boundsMax, ray.origin, invDirection, ray.tMin, ray.tMax)) {
+            if (node.triangleCount > 0) {
+                for (int32_t i = node.offset; i < node.offset + node.triangleCount; ++i) {
+                    const Triangle& triangle = triangles[i];
+                    float t, u, v;
+                    if (IntersectTriangle(triangle.v0, triangle.edge1, triangle.edge2, ray, ray.tMax, t, u, v)) {
+                        return true;
+                    }
+                }
+                if (stackSize == 0) break;
+                current = stack[--stackSize];
+            } else if (directionIsNegative[node.axis]) {
+                assert(stackSize < MAX_TRAVERSAL_DEPTH);
+                stack[stackSize++] = current + 1;
+                current = node.offset;
+            } else {
+                assert(stackSize < MAX_TRAVERSAL_DEPTH);
+                stack[stackSize++] = node.offset;
+                current = current + 1;
+            }
+        } else {
+            if (stackSize == 0) break;
+            current = stack[--stackSize];
+        }
+    }
+    return false;
+}
+
+bool BVHScene::LoadPacket(const RayStream& rays, size_t first, int count, RayPacket& packet) const
+{
+    alignas(16) float o[3][PACKET_SIZE], d[3][PACKET_SIZE], range[2][PACKET_SIZE];
+    for (int lane = 0; lane < PACKET_SIZE; ++lane) {
+        // Missing lanes repeat the first ray with tMax below tMin, so every test fails for them
+        size_t i = first + (lane < count ? lane : 0);
+        o[0][lane] = rays.ox[i];
+        o[1][lane] = rays.oy[i];
+        o[2][lane] = rays.oz[i];
+        d[0][lane] = rays.dx[i];
+        d[1][lane] = rays.dy[i];
+        d[2][lane] = rays.dz[i];
+        range[0][lane] = rays.tMin[i];
+        range[1][lane] = lane < count ? rays.tMax[i] : -std::numeric_limits<float>::infinity();
+    }
+
+    packet.ox = _mm_load_ps(o[0]);
+    packet.oy = _mm_load_ps(o[1]);
+    packet.oz = _mm_load_ps(o[2]);
+    packet.dx = _mm_load_ps(d[0]);
+    packet.dy = _mm_load_ps(d[1]);
+    packet.dz = _mm_load_ps(d[2]);
+    packet.invDx = _mm_div_ps(_mm_set1_ps(1.0f), packet.dx);
+    packet.invDy = _mm_div_ps(_mm_set1_ps(1.0f), packet.dy);
+    packet.invDz = _mm_div_ps(_mm_set1_ps(1.0f), packet.dz);
+    packet.tMin = _mm_load_ps(range[0]);
+    packet.tMax = _mm_load_ps(range[1]);
+    packet.lanes = (1 << count) - 1;
+
+    // Same sign test as the single-ray traversal, on 1 / d so that -0 counts as negative
+    const __m128* inverse[3] = { &packet.invDx, &packet.invDy, &packet.invDz };
+    for (int axis = 0; axis < 3; ++axis) {
+        int negative = _mm_movemask_ps(_mm_cmplt_ps(*inverse[axis], _mm_setzero_ps())) & packet.lanes;
+        if (negative != 0 && negative != packet.lanes) return false;
+        packet.directionIsNegative[axis] = negative != 0;
+    }
+    return true;
+}
+
+void BVHScene::FindClosestPacket(const RayPacket& packet, int32_t* hit, float* tHit, float* b1, float* b2) const
+{
+    __m128 tMax = packet.tMax;
+    __m128i hitIndex = _mm_set1_epi32(-1);
+    __m128 hitB1 = _mm_setzero_ps();
+    __m128 hitB2 = _mm_setzero_ps();
+
+    int32_t stack[MAX_TRAVERSAL_DEPTH];
+    int stackSize = 0;
+    int32_t current = 0;
+
+    // A node is entered while any lane still reaches it; lanes that miss ride along masked out
+    for (;;) {
+        const LinearNode& node = nodes[current];
+        int active = IntersectBoxPacket(node.boundsMin, node.boundsMax, packet.ox, packet.oy, packet.oz,
+                                        packet.invDx, packet.invDy, packet.invDz, packet.tMin, tMax) & packet.lanes;
+        if (active) {
+            if (node.triangleCount > 0) {
+                for (int32_t i = node.offset; i < node.offset + node.triangleCount; ++i) {
+                    const Triangle& triangle = triangles[i];
+                    __m128 t, u, v;
+                    __m128 mask = IntersectTrianglePacket(triangle.v0, triangle.edge1, triangle.edge2, packet.ox,
+                                                          packet.oy, packet.oz, packet.dx, packet.dy, packet.dz,
+                                                          packet.tMin, tMax, t, u, v);
+                    if (_mm_movemask_ps(mask) == 0) continue;
+                    tMax = Select(mask, t, tMax);
+                    hitB1 = Select(mask, u, hitB1);
+                    hitB2 = Select(mask, v, hitB2);
+                    __m128i maskBits = _mm_castps_si128(mask);
+                    hitIndex = _mm_or_si128(_mm_and_si128(maskBits, _mm_set1_epi32(i)), _mm_andnot_si128(maskBits, hitIndex));
+                }
+                if (stackSize == 0) break;
+                current = stack[--stackSize];
+            } else if (packet.directionIsNegative[node.axis]) {
+                assert(stackSize < MAX_TRAVERSAL_DEPTH);
+                stack[stackSize++] = current + 1;
+                current = node.offset;
+            } else {
+                assert(stackSize < MAX_TRAVERSAL_DEPTH);
+                stack[stackSize++] = node.offset;
+                current = current + 1;
+            }
+        } else {
+            if (stackSize == 0) break;
+            current = stack[--stackSize];
+        }
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(hit), hitIndex);
+    _mm_storeu_ps(tHit, tMax);
+    _mm_storeu_ps(b1, hitB1);
+    _mm_storeu_ps(b2, hitB2);
+}
+
+int BVHScene::FindAnyPacket(const RayPacket& packet) const
+{
+    // Occluded lanes are retired by pulling their tMax below tMin
+    __m128 tMax = packet.tMax;
+    int occluded = 0;
+
+    int32_t stack[MAX_TRAVERSAL_DEPTH];
+    int stackSize = 0;
+    int32_t current = 0;
+
+    for (;;) {
+        const LinearNode& node = nodes[current];
+        int active = IntersectBoxPacket(node.boundsMin, node.boundsMax, packet.ox, packet.oy, packet.oz,
+                                        packet.invDx, packet.invDy, packet.invDz, packet.tMin, tMax) &
+                     packet.lanes & ~occluded;
+        if (active) {
+            if (node.triangleCount > 0) {
+                for (int32_t i = node.offset; i < node.offset + node.triangleCount; ++i) {
+                    const Triangle& triangle = triangles[i];
+                    __m128 t, u, v;
+                    __m128 mask = IntersectTrianglePacket(triangle.v0, triangle.edge1, triangle.edge2, packet.ox,
+                                                          packet.oy, packet.oz, packet.dx, packet.dy, packet.dz,
+                                                          packet.tMin, tMax, t, u, v);
+                    int hits = _mm_movemask_ps(mask);
+                    if (hits == 0) continue;
+                    occluded |= hits;
+                    if ((occluded & packet.lanes) == packet.lanes) return occluded & packet.lanes;
+                    tMax = Select(mask, _mm_set1_ps(-std::numeric_limits<float>::infinity()), tMax);
+                }
+                if (stackSize == 0) break;
+                current = stack[--stackSize];
+            } else if (packet.directionIsNegative[node.axis]) {
+                assert(stackSize < MAX_TRAVERSAL_DEPTH);
+                stack[stackSize++] = current + 1;
+                current = node.offset;
+            } else {
+                assert(stackSize < MAX_TRAVERSAL_DEPTH);
+                stack[stackSize++] = node.offset;
+                current = current + 1;
+            }
+        } else {
+            if (stackSize == 0) break;
+            current = stack[--stackSize];
+        }
+    }
+    return occluded & packet.lanes;
+}
+
+void BVHScene::IntersectN(const RayStream& rays, SurfaceInteraction* isects, uint8_t* hits) const
+{
+    size_t count = rays.Size();
+    for (size_t first = 0; first < count; first += PACKET_SIZE) {
+        int lanes = static_cast<int>((std::min)(count - first, static_cast<size_t>(PACKET_SIZE)));
+        int32_t hit[PACKET_SIZE];
+        float tHit[PACKET_SIZE], b1[PACKET_SIZE], b2[PACKET_SIZE];
+
+        RayPacket packet;
+        if (!nodes.empty() && LoadPacket(rays, first, lanes, packet)) {
+            FindClosestPacket(packet, hit, tHit, b1, b2);
+        } else {
+            for (int lane = 0; lane < lanes; ++lane) {
+                b1[lane] = b2[lane] = 0.0f;
+                hit[lane] = FindClosest(rays.Get(first + lane), tHit[lane], b1[lane], b2[lane]);
+            }
+        }
+
+        for (int lane = 0; lane < lanes; ++lane) {
+            hits[first + lane] = hit[lane] >= 0 ? 1 : 0;
+            if (hit[lane] >= 0) {
+                FillInteraction(rays.Get(first + lane), hit[lane], tHit[lane], b1[lane], b2[lane], &isects[first + lane]);
+            }
+        }
+    }
+}
+
+void BVHScene::OccludedN(const RayStream& rays, uint8_t* occluded) const
+{
+    size_t count = rays.Size();
+    for (size_t first = 0; first < count; first += PACKET_SIZE) {
+        int lanes = static_cast<int>((std::min)(count - first, static_cast<size_t>(PACKET_SIZE)));
+
+        RayPacket packet;
+        if (!nodes.empty() && LoadPacket(rays, first, lanes, packet)) {
+            int mask = FindAnyPacket(packet);
+            for (int lane = 0; lane < lanes; ++lane) {
+                occluded[first + lane] = (mask >> lane) & 1;
+            }
+        } else {
+            for (int lane = 0; lane < lanes; ++lane) {
+                occluded[first + lane] = IntersectP(rays.Get(first + lane)) ? 1 : 0;
+            }
+        }
+    }
+}
+
+Spectrum BVHScene::SampleLight(const glm::vec2& u, LightSample* sample) const
+{
+    if (lights.empty()) {
+        sample->pdf = 0.0f;
+        sample->Li = Spectrum(0.0f);
+        return Spectrum(0.0f);
+    }
+
+    size_t index = (std::min)(static_cast<size_t>(u.x * lights.size()), lights.size() - 1);
+    const Light* light = lights[index];
+
+    // The engine's lights are all delta lights; wi for point and spot lights depends on the
+    // receiving point, so callers take it from sample->p
+    sample->Li = lightEmission[index];
+    sample->pdf = 1.0f / static_cast<float>(lights.size());
+    sample->isDelta = true;
+    if (light->getType() == LightType::DIRECTIONAL) {
+        sample->wi = -light->getDirection();
+        // A point beyond the scene along the light, so SpawnRayTo works for shadow rays
+        float sceneRadius = sceneBounds.isValid() ? glm::length(sceneBounds.extents()) : 1.0f;
+        glm::vec3 centre = sceneBounds.isValid() ? sceneBounds.center() : glm::vec3(0.0f);
+        sample->p = centre + sample->wi * (2.0f * sceneRadius + 1.0f);
+    } else {
+        sample->p = light->getPosition();
+        sample->wi = glm::vec3(0.0f);
+    }
+    return sample->Li;
+}
+
+float BVHScene::LightPdf(const LightSample& sample) const
+{
+    return lights.empty() ? 0.0f : 1.0f / static_cast<float>(lights.size());
+}
+
+bool BVHScene::SampleLightEmission(float uLight, const glm::vec2& uPosition, const glm::vec2& uDirection,
+                                   Ray* ray, Spectrum* power) const
+{
+    if (lights.empty()) {
+        return false;
+    }
+
+    size_t index = (std::min)(static_cast<size_t>(uLight * lights.size()), lights.size() - 1);
+    const Light* light = lights[index];
+    float selection = static_cast<float>(lights.size());
+    const Spectrum& intensity = lightEmission[index];
+    const float PI = 3.14159265f;
+
+    if (light->getType() == LightType::DIRECTIONAL) {
+        // A disk covering the scene, perpendicular to the light and outside the bounds
+        glm::vec3 direction = light->getDirection();
+        float sceneRadius = sceneBounds.isValid() ? glm::length(sceneBounds.extents()) : 1.0f;
+        glm::vec3 centre = sceneBounds.isValid() ? sceneBounds.center() : glm::vec3(0.0f);
+        glm::vec3 tangent, bitangent;
+        SpectralUtils::CoordinateSystem(direction, &tangent, &bitangent);
+
+        float r = sceneRadius * std::sqrt(uPosition.x);
+        float phi = 2.0f * PI * uPosition.y;
+        glm::vec3 origin = centre - direction * (2.0f * sceneRadius + 1.0f) +
+                           r * (std::cos(phi) * tangent + std::sin(phi) * bitangent);
+        *ray = Ray(origin, direction);
+        *power = intensity * (PI * sceneRadius * sceneRadius * selection);
+        return true;
+    }
+
+    if (light->getType() == LightType::SPOT) {
+        // Uniform over the outer cone, weighted by the same falloff the raster shaders use
+        const SpotLight* spot = static_cast<const SpotLight*>(light);
+        glm::vec3 axis = spot->getDirection();
+        glm::vec3 tangent, bitangent;
+        SpectralUtils::CoordinateSystem(axis, &tangent, &bitangent);
+
+        float cosTheta = 1.0f - uDirection.x * (1.0f - spot->outerCone);
+        float sinTheta = std::sqrt((std::max)(0.0f, 1.0f - cosTheta * cosTheta));
+        float phi = 2.0f * PI * uDirection.y;
+        glm::vec3 direction = cosTheta * axis + sinTheta * (std::cos(phi) * tangent + std::sin(phi) * bitangent);
+
+        float epsilon = (std::max)(1e-4f, spot->innerCone - spot->outerCone);
+        float falloff = glm::clamp((cosTheta - spot->outerCone) / epsilon, 0.0f, 1.0f);
+        float solidAngle = 2.0f * PI * (1.0f - spot->outerCone);
+        *ray = Ray(light->getPosition(), glm::normalize(direction));
+        *power = intensity * (falloff * solidAngle * selection);
+        return falloff > 0.0f;
+    }
+
+    *ray = Ray(light->getPosition(), MonteCarlo::UniformSampleSphere(uDirection));
+    *power = intensity * (4.0f * PI * selection);
+    return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "Integrator.hpp"
+#include "Bounds.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Scene over the engine's meshes for the offline integrators: world-space triangles in a
+// binned-SAH BVH, flattened depth-first into one node array. The meshes and lights are only
+// read while the constructor runs, apart from the Material and Light pointers kept for shading;
+// light colours are uplifted to spectra there too, so later colour changes need a new scene.
+class BVHScene : public Scene {
+public:
+    struct BuildSettings {
+        int maxLeafPrimitives = 4;
+        int binCount = 12;
+        unsigned threadCount = 0;            // 0 uses every hardware thread
+        size_t parallelThreshold = 16384;   // Smaller subtrees are built on the thread that reached them
+    };
+
+    BVHScene(const std::vector<std::unique_ptr<Mesh>>& sceneMeshes,
+             const std::vector<std::unique_ptr<Light>>& sceneLights,
+             const BuildSettings& settings = BuildSettings{});
+    ~BVHScene();
+
+    bool Intersect(const Ray& ray, SurfaceInteraction* isect) const override;
+    bool IntersectP(const Ray& ray) const override;
+
+    // Traverse four rays at a time with SSE; packets whose rays point into different octants
+    // would visit the union of their subtrees, so those go ray by ray instead
+    void IntersectN(const RayStream& rays, SurfaceInteraction* isects, uint8_t* hits) const override;
+    void OccludedN(const RayStream& rays, uint8_t* occluded) const override;
+
+    Spectrum SampleLight(const glm::vec2& u, LightSample* sample) const override;
+    float LightPdf(const LightSample& sample) const override;
+    bool SampleLightEmission(float uLight, const glm::vec2& uPosition, const glm::vec2& uDirection,
+                             Ray* ray, Spectrum* power) const override;
+
+    size_t GetTriangleCount() const { return triangles.size(); }
+    size_t GetNodeCount() const { return nodes.size(); }
+    const AABB& GetBounds() const { return sceneBounds; }
+
+private:
+    // Only what the hit test reads, so a leaf's triangles share cache lines
+    struct Triangle {
+        glm::vec3 v0, edge1, edge2;
+    };
+
+    // Fetched once, for the closest hit
+    struct TriangleShading {
+        glm::vec3 n0, n1, n2;
+        glm::vec2 uv0, uv1, uv2;
+        const Material* material;
+    };
+
+    // 32 bytes: two nodes per cache line
+    struct LinearNode {
+        glm::vec3 boundsMin;
+        int32_t offset;             // First triangle for a leaf, second child for an interior node
+        glm::vec3 boundsMax;
+        uint16_t triangleCount;     // 0 for interior nodes
+        uint8_t axis;               // Split axis, so traversal can visit the nearer child first
+        uint8_t padding;
+    };
+
+    struct BuildPrimitive;
+    struct BuildNode;
+    struct RayPacket;
+
+    std::vector<Triangle> triangles;
+    std::vector<TriangleShading> shading;
+    std::vector<LinearNode> nodes;
+    std::vector<const Light*> lights;
+    std::vector<Spectrum> lightEmission;    // color * intensity per light, as a spectrum
+    AABB sceneBounds;
+    BuildSettings buildSettings;
+
+    void Build();
+    std::unique_ptr<BuildNode> BuildRecursive(std::vector<BuildPrimitive>& primitives, size_t start, size_t end,
+                                              int depth, int parallelDepth) const;
+    int32_t Flatten(const BuildNode& node);
+
+    // Closest hit up to tMax; returns the triangle index or -1
+    int32_t FindClosest(const Ray& ray, float& tHit, float& b1, float& b2) const;
+    void FillInteraction(const Ray& ray, int32_t hit, float tHit, float b1, float b2, SurfaceInteraction* isect) const;
+
+    // Packet forms over PACKET_SIZE lanes; LoadPacket fails when the rays' octants differ
+    bool LoadPacket(const RayStream& rays, size_t first, int count, RayPacket& packet) const;
+    void FindClosestPacket(const RayPacket& packet, int32_t* hit, float* tHit, float* b1, float* b2) const;
+    int FindAnyPacket(const RayPacket& packet) const;
+};
@@ -0,0 +1,439 @@
+#include "Benchmark.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace {
+    const float DEFAULT_TIMESTEP = 1.0f / 60.0f;
+    const int DEFAULT_WARMUP_FRAMES = 120;
+    const int DEFAULT_MEASURED_FRAMES = 600;
+    const float DEFAULT_TOLERANCE = 0.05f;
+
+    // Streaming that never settles should not hold the run forever
+    const int MAX_WARMUP_FACTOR = 10;
+
+    // Below this a relative change is noise, not a regression
+    const double MIN_COMPARED_MS = 0.05;
+
+    double Percentile(const std::vector<double>& sorted, double percentile)
+    {
+        if (sorted.empty()) {
+            return 0.0;
+        }
+        // Nearest rank
+        size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * sorted.size()));
+        return sorted[(std::min)((std::max)(rank, size_t(1)), sorted.size()) - 1];
+    }
+
+    glm::vec3 CatmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+    {
+        float t2 = t * t;
+        float t3 = t2 * t;
+        return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                       (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+    }
+
+    bool ParseInt(const char* text, int& value)
+    {
+        char* end = nullptr;
+        long parsed = std::strtol(text, &end, 10);
+        if (!end || *end != '\0' || parsed < 0) {
+            return false;
+        }
+        value = static_cast<int>(parsed);
+        return true;
+    }
+
+    bool ParseFloat(const char* text, float& value)
+    {
+        char* end = nullptr;
+        float parsed = std::strtof(text, &end);
+        if (!end || *end != '\0' || !(parsed >= 0.0f)) {
+            return false;
+        }
+        value = parsed;
+        return true;
+    }
+}
+
+CameraKey CameraPath::Sample(float time) const
+{
+    if (keys.empty()) {
+        CameraKey key = { 0.0f, glm::vec3(0.0f, 0.0f, 10.0f), -90.0f, 0.0f };
+        return key;
+    }
+    float duration = Duration();
+    if (keys.size() == 1 || duration <= 0.0f) {
+        return keys.front();
+    }
+
+    float t = std::fmod((std::max)(time, 0.0f), duration);
+    size_t segment = 0;
+    while (segment + 2 < keys.size() && keys[segment + 1].time <= t) {
+        ++segment;
+    }
+    const CameraKey& k0 = keys[segment > 0 ? segment - 1 : 0];
+    const CameraKey& k1 = keys[segment];
+    const CameraKey& k2 = keys[segment + 1];
+    const CameraKey& k3 = keys[(std::min)(segment + 2, keys.size() - 1)];
+
+    float span = k2.time - k1.time;
+    float u = span > 0.0f ? glm::clamp((t - k1.time) / span, 0.0f, 1.0f) : 0.0f;
+    glm::vec3 angles = CatmullRom(glm::vec3(k0.yaw, k0.pitch, 0.0f), glm::vec3(k1.yaw, k1.pitch, 0.0f),
+                                  glm::vec3(k2.yaw, k2.pitch, 0.0f), glm::vec3(k3.yaw, k3.pitch, 0.0f), u);
+
+    CameraKey key;
+    key.time = t;
+    key.position = CatmullRom(k0.position, k1.position, k2.position, k3.position, u);
+    key.yaw = angles.x;
+    key.pitch = angles.y;
+    return key;
+}
+
+bool WriteCameraKey(const std::string& path, const CameraKey& key)
+{
+    std::ofstream file(path, std::ios::app);
+    if (!file) {
+        std::cerr << "Cannot append to " << path << std::endl;
+        return false;
+    }
+    file << std::fixed << std::setprecision(3) << "key " << key.time << " " << key.position.x << " " << key.position.y
+         << " " << key.position.z << " " << key.yaw << " " << key.pitch << "\n";
+    return static_cast<bool>(file);
+}
+
+SceneConfig::SceneConfig()
+    : name("interactive"), meshes(true), oceanCG(true), cloudsCG(true), oceanFFT(false),
+      warmupFrames(DEFAULT_WARMUP_FRAMES), measuredFrames(DEFAULT_MEASURED_FRAMES), timestep(DEFAULT_TIMESTEP)
+{
+}
+
+bool SceneConfig::Load(const std::string& sceneName)
+{
+    std::string path = BENCHMARK_SCENE_DIRECTORY + sceneName + ".bench";
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Benchmark scene not found: " << path << std::endl;
+        return false;
+    }
+
+    *this = SceneConfig();
+    name = sceneName;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        std::istringstream fields(line);
+        std::string setting;
+        if (!(fields >> setting)) {
+            continue;
+        }
+
+        bool valid = true;
+        if (setting == "systems") {
+            meshes = oceanCG = cloudsCG = oceanFFT = false;
+            std::string system;
+            while (fields >> system) {
+                if (system == "meshes") meshes = true;
+                else if (system == "ocean_cg") oceanCG = true;
+                else if (system == "clouds_cg") cloudsCG = true;
+                else if (system == "ocean_fft") oceanFFT = true;
+                else valid = false;
+            }
+        } else if (setting == "warmup") {
+            valid = static_cast<bool>(fields >> warmupFrames) && warmupFrames >= 0;
+        } else if (setting == "frames") {
+            valid = static_cast<bool>(fields >> measuredFrames) && measuredFrames > 0;
+        } else if (setting == "timestep") {
+            valid = static_cast<bool>(fields >> timestep) && timestep > 0.0f;
+        } else if (setting == "key") {
+            CameraKey key;
+            valid = static_cast<bool>(fields >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.yaw >>
+                                      key.pitch) && (cameraPath.Empty() || key.time >= cameraPath.Duration());
+            if (valid) {
+                cameraPath.AddKey(key);
+            }
+        } else {
+            valid = false;
+        }
+
+        if (!valid) {
+            std::cerr << path << ":" << lineNumber << ": cannot read \"" << line << "\"" << std::endl;
+            return false;
+        }
+    }
+
+    if (cameraPath.Empty()) {
+        std::cerr << path << ": no camera keys; the camera stays at its default pose" << std::endl;
+    }
+    return true;
+}
+
+BenchmarkSettings::BenchmarkSettings()
+    : enabled(false), headless(false), scene("default"), warmupFrames(-1), measuredFrames(-1), timestep(0.0f),
+      tolerance(DEFAULT_TOLERANCE)
+{
+#ifdef ENGINE_BENCHMARK_BUILD
+    enabled = true;
+#endif
+}
+
+bool BenchmarkSettings::Parse(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool hasValue = value && value[0] != '-';
+
+        bool valid = true;
+        if (argument == "--benchmark") {
+            enabled = true;
+            if (hasValue) {
+                scene = argv[++i];
+            }
+        } else if (argument == "--headless") {
+            headless = true;
+        } else if (argument == "--warmup") {
+            valid = hasValue && ParseInt(argv[++i], warmupFrames);
+        } else if (argument == "--frames") {
+            valid = hasValue && ParseInt(argv[++i], measuredFrames) && measuredFrames > 0;
+        } else if (argument == "--timestep") {
+            valid = hasValue && ParseFloat(argv[++i], timestep) && timestep > 0.0f;
+        } else if (argument == "--output") {
+            valid = hasValue;
+            if (valid) outputPrefix = argv[++i];
+        } else if (argument == "--baseline") {
+            valid = hasValue;
+            if (valid) baselinePath = argv[++i];
+        } else if (argument == "--tolerance") {
+            valid = hasValue && ParseFloat(argv[++i], tolerance);
+        } else {
+            std::cerr << "Unknown argument: " << argument << std::endl;
+            return false;
+        }
+
+        if (!valid) {
+            std::cerr << "Missing or invalid value for " << argument << std::endl;
+            return false;
+        }
+    }
+
+    if (outputPrefix.empty()) {
+        outputPrefix = "benchmark_" + scene;
+    }
+    return true;
+}
+
+void BenchmarkSettings::ApplyOverrides(SceneConfig& config) const
+{
+    if (warmupFrames >= 0) config.warmupFrames = warmupFrames;
+    if (measuredFrames > 0) config.measuredFrames = measuredFrames;
+    if (timestep > 0.0f) config.timestep = timestep;
+}
+
+Benchmark::Benchmark(const BenchmarkSettings& benchmarkSettings, const SceneConfig& sceneConfig)
+    : settings(benchmarkSettings), scene(sceneConfig), measuring(false), warmupRendered(0), measuredStarted(0),
+      hasLastFrameEnd(false)
+{
+    frameTimes.reserve(scene.measuredFrames);
+
+    float measuredSeconds = scene.measuredFrames * scene.timestep;
+    if (!scene.cameraPath.Empty() && measuredSeconds + 1e-4f < scene.cameraPath.Duration()) {
+        std::cerr << "Benchmark: " << scene.measuredFrames << " frames cover " << measuredSeconds << " s of a "
+                  << scene.cameraPath.Duration() << " s camera path" << std::endl;
+    }
+    std::cout << "Benchmark \"" << scene.name << "\": " << scene.warmupFrames << " warm-up + " << scene.measuredFrames
+              << " measured frames at " << scene.timestep << " s per frame" << std::endl;
+}
+
+bool Benchmark::BeginFrame(Camera& camera, bool streaming)
+{
+    if (!measuring) {
+        bool warm = warmupRendered >= scene.warmupFrames && !streaming;
+        if (warm || warmupRendered >= scene.warmupFrames * MAX_WARMUP_FACTOR + 1) {
+            if (!warm) {
+                std::cerr << "Benchmark: textures still streaming after " << warmupRendered << " warm-up frames" << std::endl;
+            }
+            measuring = true;
+            Profiler::Get().ResetTotals();
+        }
+    }
+    if (measuring && measuredStarted >= scene.measuredFrames) {
+        return false;
+    }
+
+    float pathTime = measuring ? measuredStarted * scene.timestep : 0.0f;
+    CameraKey pose = scene.cameraPath.Sample(pathTime);
+    if (!scene.cameraPath.Empty()) {
+        camera.setPosition(pose.position);
+        camera.setOrientation(pose.yaw, pose.pitch);
+    }
+
+    if (measuring) {
+        ++measuredStarted;
+    } else {
+        ++warmupRendered;
+    }
+    return true;
+}
+
+void Benchmark::EndFrame()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (measuring && hasLastFrameEnd) {
+        frameTimes.push_back(std::chrono::duration<double, std::milli>(now - lastFrameEnd).count());
+    }
+    lastFrameEnd = now;
+    hasLastFrameEnd = true;
+}
+
+std::vector<Benchmark::Metric> Benchmark::CollectMetrics() const
+{
+    std::vector<double> sorted = frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (double time : sorted) {
+        sum += time;
+    }
+
+    std::vector<Metric> metrics;
+    metrics.push_back({ "frame_mean_ms", sorted.empty() ? 0.0 : sum / sorted.size(), true });
+    metrics.push_back({ "frame_min_ms", sorted.empty() ? 0.0 : sorted.front(), false });
+    metrics.push_back({ "frame_p50_ms", Percentile(sorted, 50.0), true });
+    metrics.push_back({ "frame_p95_ms", Percentile(sorted, 95.0), true });
+    metrics.push_back({ "frame_p99_ms", Percentile(sorted, 99.0), true });
+    metrics.push_back({ "frame_max_ms", sorted.empty() ? 0.0 : sorted.back(), false });
+
+    const Profiler& profiler = Profiler::Get();
+    metrics.push_back({ "gpu_frame_mean_ms", profiler.GetMeanGPUFrameTime(), true });
+    for (const Profiler::PassTotals& pass : profiler.GetPassTotals()) {
+        metrics.push_back({ "pass." + pass.name + ".cpu_ms", pass.cpuMs, true });
+        if (pass.gpuMs >= 0.0) {
+            metrics.push_back({ "pass." + pass.name + ".gpu_ms", pass.gpuMs, true });
+        }
+    }
+    return metrics;
+}
+
+bool Benchmark::WriteCSV(const std::string& path, const std::vector<Metric>& metrics) const
+{
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Benchmark: cannot write " << path << std::endl;
+        return false;
+    }
+    file << "metric,value\n" << std::fixed << std::setprecision(4);
+    for (const Metric& metric : metrics) {
+        file << metric.name << "," << metric.value << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+bool Benchmark::WriteJSON(const std::string& path, const std::vector<Metric>& metrics) const
+{
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Benchmark: cannot write " << path << std::endl;
+        return false;
+    }
+
+    file << std::fixed << std::setprecision(4);
+    file << "{\n  \"scene\": \"" << scene.name << "\",\n";
+    file << "  \"warmupFrames\": " << warmupRendered << ",\n";
+    file << "  \"measuredFrames\": " << frameTimes.size() << ",\n";
+    file << "  \"timestep\": " << scene.timestep << ",\n";
+    file << "  \"metrics\": {";
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        file << (i ? ",\n" : "\n") << "    \"" << metrics[i].name << "\": " << metrics[i].value;
+    }
+    file << "\n  },\n  \"passes\": [";
+    std::vector<Profiler::PassTotals> passes = Profiler::Get().GetPassTotals();
+    for (size_t i = 0; i < passes.size(); ++i) {
+        file << (i ? ",\n" : "\n") << "    { \"name\": \"" << passes[i].name << "\", \"depth\": " << passes[i].depth
+             << ", \"cpuMs\": " << passes[i].cpuMs;
+        if (passes[i].gpuMs >= 0.0) {
+            file << ", \"gpuMs\": " << passes[i].gpuMs;
+        }
+        file << " }";
+    }
+    file << "\n  ],\n  \"frameTimesMs\": [";
+    for (size_t i = 0; i < frameTimes.size(); ++i) {
+        file << (i ? (i % 10 ? ", " : ",\n    ") : "\n    ") << frameTimes[i];
+    }
+    file << "\n  ]\n}\n";
+    return static_cast<bool>(file);
+}
+
+bool Benchmark::CompareWithBaseline(const std::vector<Metric>& metrics) const
+{
+    std::ifstream file(settings.baselinePath);
+    if (!file) {
+        std::cerr << "Benchmark: cannot read baseline " << settings.baselinePath << std::endl;
+        return false;
+    }
+    std::map<std::string, double> baseline;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t comma = line.rfind(',');
+        if (comma == std::string::npos || line.compare(0, comma, "metric") == 0) {
+            continue;
+        }
+        baseline[line.substr(0, comma)] = std::atof(line.c_str() + comma + 1);
+    }
+
+    int compared = 0;
+    int regressions = 0;
+    for (const Metric& metric : metrics) {
+        std::map<std::string, double>::const_iterator it = baseline.find(metric.name);
+        if (!metric.compared || it == baseline.end() || it->second < MIN_COMPARED_MS) {
+            continue;
+        }
+        ++compared;
+        double change = metric.value / it->second - 1.0;
+        if (change > settings.tolerance) {
+            ++regressions;
+            char text[256];
+            snprintf(text, sizeof(text), "REGRESSION %s: %.3f -> %.3f ms (+%.1f%%)", metric.name.c_str(), it->second,
+                     metric.value, change * 100.0);
+            std::cout << text << std::endl;
+        }
+    }
+    std::cout << "Benchmark: " << regressions << " of " << compared << " metrics slower than "
+              << settings.baselinePath << " by more than " << settings.tolerance * 100.0f << "%" << std::endl;
+    return regressions == 0;
+}
+
+bool Benchmark::Finish()
+{
+    if (frameTimes.empty()) {
+        std::cerr << "Benchmark: no frames were measured" << std::endl;
+        return false;
+    }
+
+    std::vector<Metric> metrics = CollectMetrics();
+    std::cout << std::fixed << std::setprecision(4);
+    for (const Metric& metric : metrics) {
+        if (metric.name.compare(0, 6, "frame_") == 0 || metric.name == "gpu_frame_mean_ms") {
+            std::cout << "  " << metric.name << " = " << metric.value << std::endl;
+        }
+    }
+    std::cout.unsetf(std::ios::fixed);
+
+    bool written = WriteJSON(settings.outputPrefix + ".json", metrics) && WriteCSV(settings.outputPrefix + ".csv", metrics);
+    if (written) {
+        std::cout << "Benchmark: wrote " << settings.outputPrefix << ".json and .csv" << std::endl;
+    }
+    bool passed = settings.baselinePath.empty() || CompareWithBaseline(metrics);
+    return written && passed;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include "Camera.hpp"
+#include <glm/glm.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Scene files are benchmarks/<name>.bench, relative to the working directory like shaders/
+const char* const BENCHMARK_SCENE_DIRECTORY = "benchmarks/";
+
+// Where interactive runs append camera keys (K), in .bench syntax
+const char* const CAMERA_PATH_RECORDING = "camera_path.bench";
+
+// A camera pose at a point in time; orientation in Camera's yaw and pitch degrees
+struct CameraKey {
+    float time;
+    glm::vec3 position;
+    float yaw, pitch;
+};
+
+// Catmull-Rom through the keys, which must be in time order; wraps back to the first key
+// once past the last, so a path longer than the run is cut and a shorter one repeats
+class CameraPath {
+public:
+    void AddKey(const CameraKey& key) { keys.push_back(key); }
+    bool Empty() const { return keys.empty(); }
+    float Duration() const { return keys.empty() ? 0.0f : keys.back().time; }
+    CameraKey Sample(float time) const;
+
+private:
+    std::vector<CameraKey> keys;
+};
+
+// Appends "key <time> <x> <y> <z> <yaw> <pitch>" to path
+bool WriteCameraKey(const std::string& path, const CameraKey& key);
+
+// Which systems a scene loads and how a benchmark runs it. A .bench file is one setting per
+// line; '#' starts a comment:
+//   systems meshes ocean_cg clouds_cg ocean_fft
+//   warmup 120
+//   frames 600
+//   timestep 0.0166667
+//   key <time> <x> <y> <z> <yaw> <pitch>
+struct SceneConfig {
+    std::string name;
+    bool meshes;
+    bool oceanCG;
+    bool cloudsCG;
+    bool oceanFFT;
+    int warmupFrames;
+    int measuredFrames;
+    float timestep;         // Seconds of simulation per frame
+    CameraPath cameraPath;
+
+    // The interactive scene: meshes, book ocean and book clouds
+    SceneConfig();
+
+    bool Load(const std::string& sceneName);
+};
+
+// Command line of a benchmark run:
+//   --benchmark [scene]   run benchmarks/<scene>.bench ("default") and exit
+//   --warmup N            --frames M            --timestep seconds
+//   --output prefix       writes prefix.json and prefix.csv (benchmark_<scene>)
+//   --baseline file.csv   compares against an earlier run; regressions fail the exit code
+//   --tolerance fraction  slowdown counted as a regression (0.05)
+//   --headless            keeps the window hidden
+struct BenchmarkSettings {
+    bool enabled;
+    bool headless;
+    std::string scene;
+    int warmupFrames;           // Negative keeps the scene's
+    int measuredFrames;
+    float timestep;             // Zero keeps the scene's
+    std::string outputPrefix;
+    std::string baselinePath;
+    float tolerance;
+
+    // Benchmark builds (ENGINE_BENCHMARK_BUILD) start enabled on the default scene
+    BenchmarkSettings();
+
+    // False, with a message, on an unknown or incomplete argument
+    bool Parse(int argc, char** argv);
+    void ApplyOverrides(SceneConfig& config) const;
+};
+
+// Drives a benchmark run a frame at a time. Warm-up holds the camera on the path's first key
+// for at least warmupFrames and until texture streaming settles; each measured frame then
+// advances the path by one timestep and is timed from the end of the previous frame, so the
+// figures are the wall-clock frame period.
+class Benchmark {
+public:
+    Benchmark(const BenchmarkSettings& settings, const SceneConfig& scene);
+
+    // Poses the camera for the coming frame; false once every measured frame is done
+    bool BeginFrame(Camera& camera, bool streaming);
+    // After the frame is presented
+    void EndFrame();
+
+    // Writes the reports and checks the baseline; false when either fails
+    bool Finish();
+
+private:
+    struct Metric {
+        std::string name;
+        double value;
+        bool compared;          // Checked against the baseline
+    };
+
+    BenchmarkSettings settings;
+    SceneConfig scene;
+
+    bool measuring;
+    int warmupRendered;
+    int measuredStarted;
+    std::vector<double> frameTimes;
+    std::chrono::steady_clock::time_point lastFrameEnd;
+    bool hasLastFrameEnd;
+
+    std::vector<Metric> CollectMetrics() const;
+    bool WriteJSON(const std::string& path, const std::vector<Metric>& metrics) const;
+    bool WriteCSV(const std::string& path, const std::vector<Metric>& metrics) const;
+    bool CompareWithBaseline(const std::vector<Metric>& metrics) const;
+};
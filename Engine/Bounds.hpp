@@ -0,0 +1,60 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+struct BoundingSphere {
+    glm::vec3 center;
+    float radius;
+    
+    BoundingSphere() : center(0.0f), radius(0.0f) {}
+    BoundingSphere(const glm::vec3& c, float r) : center(c), radius(r) {}
+    
+    // Conservative under non-uniform scale: the radius grows by the largest axis scale
+    BoundingSphere transformed(const glm::mat4& m) const {
+        glm::vec3 worldCenter = glm::vec3(m * glm::vec4(center, 1.0f));
+        // (std::max) keeps windows.h's max macro from expanding here
+        float maxScale = (std::max)(glm::length(glm::vec3(m[0])), (std::max)(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+        return BoundingSphere(worldCenter, radius * maxScale);
+    }
+};
+
+struct AABB {
+    glm::vec3 minPoint;
+    glm::vec3 maxPoint;
+    
+    // Starts inverted so the first expand() defines the box
+    AABB() : minPoint(FLT_MAX), maxPoint(-FLT_MAX) {}
+    AABB(const glm::vec3& mn, const glm::vec3& mx) : minPoint(mn), maxPoint(mx) {}
+    
+    bool isValid() const { return minPoint.x <= maxPoint.x && minPoint.y <= maxPoint.y && minPoint.z <= maxPoint.z; }
+    glm::vec3 center() const { return (minPoint + maxPoint) * 0.5f; }
+    glm::vec3 extents() const { return (maxPoint - minPoint) * 0.5f; }
+    
+    void expand(const glm::vec3& p) {
+        minPoint = (glm::min)(minPoint, p);
+        maxPoint = (glm::max)(maxPoint, p);
+    }
+    
+    void expand(const AABB& other) {
+        minPoint = (glm::min)(minPoint, other.minPoint);
+        maxPoint = (glm::max)(maxPoint, other.maxPoint);
+    }
+    
+    // Box around the transformed box (Arvo's method)
+    AABB transformed(const glm::mat4& m) const {
+        glm::vec3 c = glm::vec3(m * glm::vec4(center(), 1.0f));
+        glm::vec3 e = extents();
+        glm::vec3 worldExtents(
+            std::abs(m[0][0]) * e.x + std::abs(m[1][0]) * e.y + std::abs(m[2][0]) * e.z,
+            std::abs(m[0][1]) * e.x + std::abs(m[1][1]) * e.y + std::abs(m[2][1]) * e.z,
+            std::abs(m[0][2]) * e.x + std::abs(m[1][2]) * e.y + std::abs(m[2][2]) * e.z);
+        return AABB(c - worldExtents, c + worldExtents);
+    }
+    
+    // Sphere through the box corners; cheap and good enough for culling
+    BoundingSphere boundingSphere() const {
+        return BoundingSphere(center(), glm::length(extents()));
+    }
+};
@@ -70,6 +70,13 @@ void Camera::processMouseMovement(HWND hWnd)
     SetCursorPos(center.x, center.y);
 }
 
+void Camera::setOrientation(float newYaw, float newPitch)
+{
+    yaw = newYaw;
+    pitch = glm::clamp(newPitch, -89.0f, 89.0f);
+    updateCameraVectors();
+}
+
 void Camera::updateCameraVectors()
 {
     glm::vec3 newFront;
@@ -3,6 +3,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <windows.h>
 
+// Clip planes of the scene camera's projection, shared with passes fitted to its frustum
+const float CAMERA_NEAR_PLANE = 0.1f;
+const float CAMERA_FAR_PLANE = 1000.0f;
+
 class Camera
 {
 private:
@@ -29,13 +33,18 @@ public:
            float pitch = 0.0f);
     
     glm::mat4 getViewMatrix() const;
-    glm::mat4 getProjectionMatrix(float aspect, float near = 0.1f, float far = 1000.0f) const;
+    glm::mat4 getProjectionMatrix(float aspect, float near = CAMERA_NEAR_PLANE, float far = CAMERA_FAR_PLANE) const;
     
     void processKeyboard(float deltaTime);
     void processMouseMovement(HWND hWnd);
     
     void setPosition(const glm::vec3& pos) { position = pos; }
     glm::vec3 getPosition() const { return position; }
+    // Degrees; pitch is clamped like mouse look
+    void setOrientation(float newYaw, float newPitch);
+    float getYaw() const { return yaw; }
+    float getPitch() const { return pitch; }
     glm::vec3 getFront() const { return front; }
+    float getZoom() const { return zoom; }  // Vertical field of view, degrees
 };
 
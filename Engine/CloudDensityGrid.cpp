@@ -0,0 +1,195 @@
+#include "CloudDensityGrid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+CloudDensityGrid::CloudDensityGrid() : buildRequested(false), buildFinished(false), stopping(false)
+{
+}
+
+CloudDensityGrid::~CloudDensityGrid()
+{
+    Stop();
+}
+
+void CloudDensityGrid::Start(NoiseFunction noiseFunction, const Settings& gridSettings)
+{
+    Stop();
+
+    noise = noiseFunction;
+    settings = gridSettings;
+    front = Grid();
+    building = Grid();
+    buildRequested = false;
+    buildFinished = false;
+    stopping = false;
+    worker = std::thread(&CloudDensityGrid::WorkerLoop, this);
+}
+
+void CloudDensityGrid::Stop()
+{
+    if (!worker.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    worker.join();
+}
+
+void CloudDensityGrid::Update(const glm::vec3& noiseCentre, float spacing, int verticalCells, int octaves)
+{
+    if (!IsRunning() || spacing <= 0.0f) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (buildRequested) {
+            return;
+        }
+        if (buildFinished) {
+            std::swap(front, building);
+            buildFinished = false;
+        }
+    }
+
+    // Keep the baked spacing while it stays within 2x of the wanted one, so only drift
+    // (not the smooth cloudScale changes of a weather transition) forces work
+    Grid target;
+    target.spacing = spacing;
+    if (!front.IsEmpty() && spacing >= front.spacing * 0.5f && spacing <= front.spacing * 2.0f) {
+        target.spacing = front.spacing;
+    }
+    int layerCells = static_cast<int>(std::ceil(verticalCells * spacing / target.spacing));
+    // Pad the layer so vertical wind drift has the same slack as the horizontal window
+    int verticalMargin = (std::max)(1, static_cast<int>(layerCells * settings.recentreFraction));
+    target.size = glm::ivec3(settings.horizontalCells, layerCells + 2 * verticalMargin, settings.horizontalCells);
+    target.origin = glm::ivec3(glm::floor(noiseCentre / target.spacing)) - target.size / 2;
+    target.octaves = octaves;
+
+    if (!NeedsRebuild(target)) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        building.origin = target.origin;
+        building.size = target.size;
+        building.spacing = target.spacing;
+        building.octaves = target.octaves;
+        buildRequested = true;
+    }
+    condition.notify_one();
+}
+
+bool CloudDensityGrid::NeedsRebuild(const Grid& target) const
+{
+    if (front.IsEmpty() || front.octaves != target.octaves || front.spacing != target.spacing ||
+        front.size != target.size) {
+        return true;
+    }
+
+    // The window is centred on the target, so drift eats into the margin on one side
+    for (int axis = 0; axis < 3; ++axis) {
+        int threshold = (std::max)(1, static_cast<int>(target.size[axis] * settings.recentreFraction));
+        if (std::abs(target.origin[axis] - front.origin[axis]) > threshold) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CloudDensityGrid::Sample(const glm::vec3& noisePos, int octaves, float& value) const
+{
+    if (front.IsEmpty() || front.octaves != octaves) {
+        return false;
+    }
+
+    glm::vec3 cell = noisePos / front.spacing - glm::vec3(front.origin);
+    glm::vec3 base = glm::floor(cell);
+    if (base.x < 0.0f || base.y < 0.0f || base.z < 0.0f ||
+        base.x >= front.size.x - 1 || base.y >= front.size.y - 1 || base.z >= front.size.z - 1) {
+        return false;
+    }
+
+    glm::vec3 f = cell - base;
+    int x = static_cast<int>(base.x);
+    int y = static_cast<int>(base.y);
+    int z = static_cast<int>(base.z);
+    const float* v = front.values.data();
+    size_t i000 = front.Index(x, y, z);
+    size_t i001 = front.Index(x, y, z + 1);
+    size_t i010 = front.Index(x, y + 1, z);
+    size_t i011 = front.Index(x, y + 1, z + 1);
+
+    float c00 = v[i000] + (v[i000 + 1] - v[i000]) * f.x;
+    float c01 = v[i001] + (v[i001 + 1] - v[i001]) * f.x;
+    float c10 = v[i010] + (v[i010 + 1] - v[i010]) * f.x;
+    float c11 = v[i011] + (v[i011 + 1] - v[i011]) * f.x;
+    float c0 = c00 + (c01 - c00) * f.z;
+    float c1 = c10 + (c11 - c10) * f.z;
+    value = c0 + (c1 - c0) * f.y;
+    return true;
+}
+
+void CloudDensityGrid::WorkerLoop()
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return stopping || buildRequested; });
+            if (stopping) {
+                return;
+            }
+        }
+
+        // front is not swapped while a build is requested, so it can be read without the lock
+        Build();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        buildRequested = false;
+        buildFinished = true;
+    }
+}
+
+void CloudDensityGrid::Build()
+{
+    building.values.resize(static_cast<size_t>(building.size.x) * building.size.y * building.size.z);
+
+    bool canReuse = !front.IsEmpty() && front.spacing == building.spacing && front.octaves == building.octaves;
+    glm::ivec3 offset = building.origin - front.origin;
+
+    // Overlapping x-range of each row, in the new grid's coordinates
+    int reuseBegin = canReuse ? (std::max)(0, -offset.x) : 0;
+    int reuseEnd = canReuse ? (std::min)(building.size.x, front.size.x - offset.x) : 0;
+
+    for (int y = 0; y < building.size.y; ++y) {
+        for (int z = 0; z < building.size.z; ++z) {
+            float* row = &building.values[building.Index(0, y, z)];
+            int frontY = y + offset.y;
+            int frontZ = z + offset.z;
+            bool rowOverlaps = canReuse && reuseBegin < reuseEnd &&
+                               frontY >= 0 && frontY < front.size.y && frontZ >= 0 && frontZ < front.size.z;
+
+            int copyBegin = rowOverlaps ? reuseBegin : building.size.x;
+            int copyEnd = rowOverlaps ? reuseEnd : building.size.x;
+            if (rowOverlaps) {
+                std::memcpy(row + copyBegin, &front.values[front.Index(copyBegin + offset.x, frontY, frontZ)],
+                            sizeof(float) * (copyEnd - copyBegin));
+            }
+
+            for (int x = 0; x < building.size.x; ++x) {
+                if (x == copyBegin) {
+                    x = copyEnd - 1;
+                    continue;
+                }
+                glm::vec3 noisePos = glm::vec3(building.origin + glm::ivec3(x, y, z)) * building.spacing;
+                row[x] = noise(noisePos, building.octaves);
+            }
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <functional>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Coarse cache of the cloud FBM for CPU-side density queries. The grid lives in noise
+// space (worldPos * cloudScale + wind offset), so wind advection and camera movement only
+// slide its window: when the wanted window drifts far enough, a worker thread builds the
+// shifted one, copying every cell that stays inside and evaluating only the newly exposed
+// slabs, and the next Update() swaps it in. Queries outside the window return false so the
+// caller can evaluate the noise directly.
+class CloudDensityGrid {
+public:
+    // Must be safe to call from the worker thread
+    using NoiseFunction = std::function<float(const glm::vec3& noisePos, int octaves)>;
+
+    struct Settings {
+        int horizontalCells = 128;        // Along x and z
+        float recentreFraction = 0.125f;  // Drift, as a fraction of the window, that triggers a rebuild
+    };
+
+private:
+    struct Grid {
+        glm::ivec3 origin;            // Lattice index of cell (0, 0, 0)
+        glm::ivec3 size;
+        float spacing;                // Cell size in noise units
+        int octaves;
+        std::vector<float> values;    // x fastest, then z, then y
+
+        Grid() : origin(0), size(0), spacing(0.0f), octaves(0) {}
+        bool IsEmpty() const { return values.empty(); }
+        size_t Index(int x, int y, int z) const { return (static_cast<size_t>(y) * size.z + z) * size.x + x; }
+    };
+
+    Settings settings;
+    NoiseFunction noise;
+
+    // front is read by the main thread; building is written by the worker while a build is in flight
+    Grid front;
+    Grid building;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool buildRequested;
+    bool buildFinished;
+    bool stopping;
+
+    void WorkerLoop();
+    void Build();
+    bool NeedsRebuild(const Grid& target) const;
+
+public:
+    CloudDensityGrid();
+    ~CloudDensityGrid();
+
+    CloudDensityGrid(const CloudDensityGrid&) = delete;
+    CloudDensityGrid& operator=(const CloudDensityGrid&) = delete;
+
+    void Start(NoiseFunction noiseFunction, const Settings& gridSettings = Settings{});
+    void Stop();
+
+    // Main thread, once per frame: swaps in a finished build, then schedules a new one when
+    // the window around noiseCentre has drifted, the spacing halved or doubled, or the octave
+    // count changed. verticalCells should span the cloud layer.
+    void Update(const glm::vec3& noiseCentre, float spacing, int verticalCells, int octaves);
+
+    // Main thread. Trilinear lookup; false when noisePos is outside the baked window or the
+    // grid was baked with a different octave count.
+    bool Sample(const glm::vec3& noisePos, int octaves, float& value) const;
+
+    bool IsRunning() const { return worker.joinable(); }
+    bool IsReady() const { return !front.IsEmpty(); }
+};
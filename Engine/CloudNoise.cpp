@@ -0,0 +1,251 @@
+#include "CloudNoise.hpp"
+#include "Shader.hpp"
+#include "MappedFile.hpp"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cstring>
+
+namespace {
+    // Compute dispatches use 8x8x8 workgroups (local_size in the cloud_noise_*.comp shaders)
+    const int NOISE_WORKGROUP_SIZE = 8;
+    const uint64_t SECTION_ALIGNMENT = 16;
+    
+    constexpr uint32_t UNIFORM_SIZE = HashUniformName("size");
+    constexpr uint32_t UNIFORM_FREQUENCY = HashUniformName("frequency");
+    constexpr uint32_t UNIFORM_SEED = HashUniformName("seed");
+    
+    uint64_t AlignSection(uint64_t offset)
+    {
+        return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+    }
+    
+    uint64_t GetVolumeBytes(int size)
+    {
+        return static_cast<uint64_t>(size) * size * size * 4;
+    }
+    
+    GLsizei GetMipLevelCount(int size)
+    {
+        GLsizei levels = 1;
+        while (size > 1) {
+            size >>= 1;
+            ++levels;
+        }
+        return levels;
+    }
+    
+    bool DispatchVolume(const std::string& shaderPath, GLuint texture, int size, int frequency, uint32_t seed)
+    {
+        Shader shader;
+        if (!shader.InitComputeFromFile(shaderPath)) {
+            return false;
+        }
+        
+        shader.use();
+        glUniform1i(shader.getUniformLocation(UNIFORM_SIZE), size);
+        glUniform1i(shader.getUniformLocation(UNIFORM_FREQUENCY), frequency);
+        glUniform1ui(shader.getUniformLocation(UNIFORM_SEED), seed);
+        
+        // A 3D texture has to be bound layered for the shader to see every slice
+        glBindImageTexture(0, texture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        GLuint groups = static_cast<GLuint>((size + NOISE_WORKGROUP_SIZE - 1) / NOISE_WORKGROUP_SIZE);
+        glDispatchCompute(groups, groups, groups);
+        return true;
+    }
+}
+
+CloudNoise::CloudNoise() : shapeTexture(0), detailTexture(0)
+{
+}
+
+CloudNoise::~CloudNoise()
+{
+    Cleanup();
+}
+
+std::string CloudNoise::GetCachePath(const Settings& noiseSettings)
+{
+    std::ostringstream path;
+    path << "cloud_noise_" << noiseSettings.shapeSize << "_" << noiseSettings.detailSize << "_"
+         << noiseSettings.shapeFrequency << "_" << noiseSettings.detailFrequency << "_"
+         << noiseSettings.seed << ".bin";
+    return path.str();
+}
+
+bool CloudNoise::Initialize(const Settings& noiseSettings)
+{
+    Cleanup();
+    settings = noiseSettings;
+    
+    if (settings.shapeSize < 1 || settings.detailSize < 1 ||
+        settings.shapeFrequency < 1 || settings.detailFrequency < 1) {
+        std::cerr << "Cloud noise: volume sizes and frequencies must be positive" << std::endl;
+        return false;
+    }
+    
+    std::string cachePath = GetCachePath(settings);
+    if (LoadCache(cachePath)) {
+        std::cout << "Loaded cloud noise volumes from " << cachePath << std::endl;
+        return true;
+    }
+    
+    if (!Shader::IsComputeSupported()) {
+        std::cerr << "Cloud noise: no cache at " << cachePath
+                  << " and compute shaders not supported (needs OpenGL 4.3)" << std::endl;
+        return false;
+    }
+    
+    if (!Generate()) {
+        Cleanup();
+        return false;
+    }
+    
+    // A failed write only costs the next launch another generation
+    SaveCache(cachePath);
+    return true;
+}
+
+void CloudNoise::Cleanup()
+{
+    if (shapeTexture != 0) glDeleteTextures(1, &shapeTexture);
+    if (detailTexture != 0) glDeleteTextures(1, &detailTexture);
+    shapeTexture = detailTexture = 0;
+}
+
+GLuint CloudNoise::CreateVolume(int size)
+{
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glTexStorage3D(GL_TEXTURE_3D, GetMipLevelCount(size), GL_RGBA8, size, size, size);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    return texture;
+}
+
+bool CloudNoise::Generate()
+{
+    std::cout << "Generating cloud noise volumes (" << settings.shapeSize << "^3 shape, "
+              << settings.detailSize << "^3 detail)..." << std::endl;
+    
+    shapeTexture = CreateVolume(settings.shapeSize);
+    detailTexture = CreateVolume(settings.detailSize);
+    
+    if (!DispatchVolume("shaders/cloud_noise_shape.comp", shapeTexture, settings.shapeSize,
+                        settings.shapeFrequency, settings.seed) ||
+        !DispatchVolume("shaders/cloud_noise_detail.comp", detailTexture, settings.detailSize,
+                        settings.detailFrequency, settings.seed)) {
+        std::cerr << "Cloud noise: failed to build the generator shaders" << std::endl;
+        return false;
+    }
+    
+    // Mip generation and the cache readback both read the image writes
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+    
+    glBindTexture(GL_TEXTURE_3D, shapeTexture);
+    glGenerateMipmap(GL_TEXTURE_3D);
+    glBindTexture(GL_TEXTURE_3D, detailTexture);
+    glGenerateMipmap(GL_TEXTURE_3D);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    return true;
+}
+
+bool CloudNoise::LoadCache(const std::string& path)
+{
+    MappedFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+    
+    if (file.Size() < sizeof(CloudNoiseHeader)) {
+        return false;
+    }
+    
+    const CloudNoiseHeader* header = reinterpret_cast<const CloudNoiseHeader*>(file.Data());
+    if (header->magic != CLOUD_NOISE_MAGIC || header->version != CLOUD_NOISE_VERSION) {
+        std::cout << "Cloud noise cache " << path << " has an old format, regenerating" << std::endl;
+        return false;
+    }
+    if (header->shapeSize != static_cast<uint32_t>(settings.shapeSize) ||
+        header->detailSize != static_cast<uint32_t>(settings.detailSize) ||
+        header->shapeFrequency != static_cast<uint32_t>(settings.shapeFrequency) ||
+        header->detailFrequency != static_cast<uint32_t>(settings.detailFrequency) ||
+        header->seed != settings.seed) {
+        std::cout << "Cloud noise cache " << path << " was built with other settings, regenerating" << std::endl;
+        return false;
+    }
+    
+    // Both volumes have to lie inside the mapping before anything is uploaded
+    if (header->shapeOffset + GetVolumeBytes(settings.shapeSize) > file.Size() ||
+        header->detailOffset + GetVolumeBytes(settings.detailSize) > file.Size()) {
+        std::cerr << "Cloud noise: truncated cache " << path << std::endl;
+        return false;
+    }
+    
+    shapeTexture = CreateVolume(settings.shapeSize);
+    detailTexture = CreateVolume(settings.detailSize);
+    
+    glBindTexture(GL_TEXTURE_3D, shapeTexture);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, settings.shapeSize, settings.shapeSize, settings.shapeSize,
+                    GL_RGBA, GL_UNSIGNED_BYTE, file.Data() + header->shapeOffset);
+    glGenerateMipmap(GL_TEXTURE_3D);
+    
+    glBindTexture(GL_TEXTURE_3D, detailTexture);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, settings.detailSize, settings.detailSize, settings.detailSize,
+                    GL_RGBA, GL_UNSIGNED_BYTE, file.Data() + header->detailOffset);
+    glGenerateMipmap(GL_TEXTURE_3D);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    return true;
+}
+
+// Startup-only: glGetTexImage stalls until the generator dispatches finish
+bool CloudNoise::SaveCache(const std::string& path) const
+{
+    std::vector<unsigned char> shapeTexels(static_cast<size_t>(GetVolumeBytes(settings.shapeSize)));
+    std::vector<unsigned char> detailTexels(static_cast<size_t>(GetVolumeBytes(settings.detailSize)));
+    
+    glBindTexture(GL_TEXTURE_3D, shapeTexture);
+    glGetTexImage(GL_TEXTURE_3D, 0, GL_RGBA, GL_UNSIGNED_BYTE, shapeTexels.data());
+    glBindTexture(GL_TEXTURE_3D, detailTexture);
+    glGetTexImage(GL_TEXTURE_3D, 0, GL_RGBA, GL_UNSIGNED_BYTE, detailTexels.data());
+    glBindTexture(GL_TEXTURE_3D, 0);
+    
+    CloudNoiseHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = CLOUD_NOISE_MAGIC;
+    header.version = CLOUD_NOISE_VERSION;
+    header.shapeSize = static_cast<uint32_t>(settings.shapeSize);
+    header.detailSize = static_cast<uint32_t>(settings.detailSize);
+    header.shapeFrequency = static_cast<uint32_t>(settings.shapeFrequency);
+    header.detailFrequency = static_cast<uint32_t>(settings.detailFrequency);
+    header.seed = settings.seed;
+    header.shapeOffset = AlignSection(sizeof(CloudNoiseHeader));
+    header.detailOffset = AlignSection(header.shapeOffset + shapeTexels.size());
+    
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Cloud noise: cannot write cache " << path << std::endl;
+        return false;
+    }
+    
+    static const char zeros[SECTION_ALIGNMENT] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(zeros, static_cast<std::streamsize>(header.shapeOffset - sizeof(header)));
+    out.write(reinterpret_cast<const char*>(shapeTexels.data()), static_cast<std::streamsize>(shapeTexels.size()));
+    out.write(zeros, static_cast<std::streamsize>(header.detailOffset - header.shapeOffset - shapeTexels.size()));
+    out.write(reinterpret_cast<const char*>(detailTexels.data()), static_cast<std::streamsize>(detailTexels.size()));
+    
+    if (!out) {
+        std::cerr << "Cloud noise: failed while writing cache " << path << std::endl;
+        return false;
+    }
+    
+    std::cout << "Cloud noise cache written: " << path << std::endl;
+    return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+
+// Tileable 3D noise volumes for the cloud shaders, generated once with compute
+// shaders and cached on disk so later launches only upload them:
+//   shape  (RGBA8, shapeSize^3):  r = Perlin-Worley, gba = Worley FBM at 2x/4x/8x frequency
+//   detail (RGBA8, detailSize^3): rgb = Worley FBM at 1x/2x/4x frequency
+// Cache layout: CloudNoiseHeader | shape texels | detail texels, both 16-byte aligned.
+// Bump CLOUD_NOISE_VERSION whenever the header or the cloud_noise_* shaders change.
+const uint32_t CLOUD_NOISE_MAGIC = 0x494F4E43u; // "CNOI"
+const uint32_t CLOUD_NOISE_VERSION = 1;
+
+struct CloudNoiseHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t shapeSize;
+    uint32_t detailSize;
+    uint32_t shapeFrequency;
+    uint32_t detailFrequency;
+    uint32_t seed;
+    uint32_t padding;
+    
+    uint64_t shapeOffset;
+    uint64_t detailOffset;
+};
+
+class CloudNoise {
+public:
+    struct Settings {
+        int shapeSize = 128;
+        int detailSize = 32;
+        int shapeFrequency = 4;     // Lattice cells per tile of the lowest shape octave
+        int detailFrequency = 4;    // Lattice cells per tile of the lowest detail octave
+        uint32_t seed = 1337;
+    };
+    
+private:
+    Settings settings;
+    GLuint shapeTexture;
+    GLuint detailTexture;
+    
+    static GLuint CreateVolume(int size);
+    bool LoadCache(const std::string& path);
+    bool SaveCache(const std::string& path) const;
+    bool Generate();
+    
+public:
+    CloudNoise();
+    ~CloudNoise();
+    
+    CloudNoise(const CloudNoise&) = delete;
+    CloudNoise& operator=(const CloudNoise&) = delete;
+    
+    // Loads the cache matching these settings, or generates and writes it. Fails only
+    // when there is no cache and compute shaders are unavailable.
+    bool Initialize(const Settings& noiseSettings = Settings{});
+    void Cleanup();
+    
+    // Cache files live in the working directory, named after the settings they hold
+    static std::string GetCachePath(const Settings& noiseSettings);
+    
+    bool IsReady() const { return shapeTexture != 0 && detailTexture != 0; }
+    GLuint GetShapeTexture() const { return shapeTexture; }
+    GLuint GetDetailTexture() const { return detailTexture; }
+    const Settings& GetSettings() const { return settings; }
+};
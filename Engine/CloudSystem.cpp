@@ -1,7 +1,7 @@
 #include "CloudSystem.hpp"
 #include <iostream>
 #include <cmath>
-#include <random>
+#include <algorithm>
 
 // Helper functions for math operations
 float fract(float x) {
@@ -12,9 +12,25 @@ glm::vec3 fract(const glm::vec3& v) {
     return glm::vec3(fract(v.x), fract(v.y), fract(v.z));
 }
 
+namespace {
+    // Pixel of each 4x4 block marched on frame i: the 4x4 Bayer matrix in rank order,
+    // so consecutive frames land far apart and every 16 frames cover the whole block
+    const glm::ivec2 BAYER_SEQUENCE[16] = {
+        {0, 0}, {2, 2}, {2, 0}, {0, 2},
+        {1, 1}, {3, 3}, {3, 1}, {1, 3},
+        {1, 0}, {3, 2}, {3, 0}, {1, 2},
+        {0, 1}, {2, 3}, {2, 1}, {0, 3}
+    };
+    
+    const int MARCH_DOWNSCALE = 4;
+}
+
 CloudSystem::CloudSystem() 
     : skyboxVAO(0), skyboxVBO(0), time(0.0f), isInitialized(false),
-      noise3DTexture(0), worleyTexture(0), weatherTexture(0) {
+      weatherTexture(0), fullscreenVAO(0), marchFramebuffer(0), marchTexture(0),
+      historyFramebuffers{0, 0}, historyTextures{0, 0}, historyIndex(0),
+      targetWidth(0), targetHeight(0), frameIndex(0),
+      previousViewProjection(1.0f), historyValid(false), densityGridCentre(0.0f) {
 }
 
 CloudSystem::~CloudSystem() {
@@ -45,6 +61,17 @@ bool CloudSystem::Initialize(const CloudConfig& cfg) {
     SetupVertexData();
     CreateNoiseTextures();
     
+    // FractionalBrownianMotion only reads its arguments, so the grid worker can call it directly
+    densityGrid.Start([this](const glm::vec3& noisePos, int octaves) {
+        return FractionalBrownianMotion(noisePos, octaves);
+    });
+    UpdateDensityGrid();
+    
+    if (config.enableTemporalReprojection && !InitializeTemporalShaders()) {
+        std::cerr << "Temporal cloud shaders failed, rendering at full resolution" << std::endl;
+        config.enableTemporalReprojection = false;
+    }
+    
     isInitialized = true;
     std::cout << "Cloud system initialized successfully!" << std::endl;
     
@@ -52,6 +79,8 @@ bool CloudSystem::Initialize(const CloudConfig& cfg) {
 }
 
 void CloudSystem::Cleanup() {
+    densityGrid.Stop();
+    
     if (skyboxVAO != 0) {
         glDeleteVertexArrays(1, &skyboxVAO);
         skyboxVAO = 0;
@@ -61,19 +90,21 @@ void CloudSystem::Cleanup() {
         skyboxVBO = 0;
     }
     
-    if (noise3DTexture != 0) {
-        glDeleteTextures(1, &noise3DTexture);
-        noise3DTexture = 0;
-    }
-    if (worleyTexture != 0) {
-        glDeleteTextures(1, &worleyTexture);
-        worleyTexture = 0;
-    }
+    noiseVolumes.Cleanup();
     if (weatherTexture != 0) {
         glDeleteTextures(1, &weatherTexture);
         weatherTexture = 0;
     }
     
+    DestroyTemporalTargets();
+    if (fullscreenVAO != 0) {
+        glDeleteVertexArrays(1, &fullscreenVAO);
+        fullscreenVAO = 0;
+    }
+    marchShader.reset();
+    reprojectShader.reset();
+    compositeShader.reset();
+    
     cloudShader.reset();
     isInitialized = false;
 }
@@ -85,6 +116,15 @@ void CloudSystem::Update(float deltaTime) {
     // Update weather effects
     weather.windVelocity += glm::vec3(sin(time * 0.1f), 0.0f, cos(time * 0.15f)) * 0.1f;
     weather.turbulence = 0.3f + 0.2f * sin(time * 0.05f);
+    
+    UpdateDensityGrid();
+}
+
+void CloudSystem::UpdateDensityGrid() {
+    glm::vec3 layerCentre(densityGridCentre.x, config.cloudHeight, densityGridCentre.z);
+    glm::vec3 noiseCentre = layerCentre * config.cloudScale + GetNoiseOffset();
+    int verticalCells = static_cast<int>(std::ceil(config.cloudThickness / config.densityGridCellSize)) + 1;
+    densityGrid.Update(noiseCentre, config.densityGridCellSize * config.cloudScale, verticalCells, config.octaves);
 }
 
 void CloudSystem::Render(const glm::mat4& view, const glm::mat4& projection, 
@@ -92,6 +132,13 @@ void CloudSystem::Render(const glm::mat4& view, const glm::mat4& projection,
                          const glm::vec3& lightColor, const glm::vec3& skyColor) {
     if (!isInitialized) return;
     
+    densityGridCentre = viewPos;
+    
+    if (config.enableTemporalReprojection && marchShader) {
+        RenderTemporal(view, projection, viewPos, lightDir, lightColor, skyColor);
+        return;
+    }
+    
     // Enable blending for transparent clouds
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -122,8 +169,16 @@ void CloudSystem::Render(const glm::mat4& view, const glm::mat4& projection,
     glUniform1f(glGetUniformLocation(cloudShader->shaderProgram, "u_cloudHeight"), config.cloudHeight);
     glUniform1f(glGetUniformLocation(cloudShader->shaderProgram, "u_cloudThickness"), config.cloudThickness);
     
-    // Skip texture binding for now - use procedural noise in shaders
-    // This prevents flickering from missing/invalid textures
+    // Tileable shape noise replaces the per-pixel procedural octaves when it is available
+    bool hasNoiseVolumes = noiseVolumes.IsReady();
+    glUniform1i(glGetUniformLocation(cloudShader->shaderProgram, "u_hasNoiseVolumes"), hasNoiseVolumes);
+    if (hasNoiseVolumes) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_3D, noiseVolumes.GetShapeTexture());
+        glUniform1i(glGetUniformLocation(cloudShader->shaderProgram, "u_shapeNoise"), 0);
+        glUniform1f(glGetUniformLocation(cloudShader->shaderProgram, "u_shapeNoiseFrequency"),
+                    static_cast<float>(noiseVolumes.GetSettings().shapeFrequency));
+    }
     
     // Render skybox mesh
     glBindVertexArray(skyboxVAO);
@@ -137,6 +192,222 @@ void CloudSystem::Render(const glm::mat4& view, const glm::mat4& projection,
 
 void CloudSystem::SetConfig(const CloudConfig& cfg) {
     config = cfg;
+    
+    if (isInitialized && config.enableTemporalReprojection && !marchShader && !InitializeTemporalShaders()) {
+        config.enableTemporalReprojection = false;
+    }
+}
+
+bool CloudSystem::InitializeTemporalShaders() {
+    marchShader = std::make_unique<Shader>();
+    reprojectShader = std::make_unique<Shader>();
+    compositeShader = std::make_unique<Shader>();
+    if (!marchShader->InitFromFiles("shaders/fullscreen.vert", "shaders/clouds.frag", "CLOUDS_FULLSCREEN") ||
+        !reprojectShader->InitFromFiles("shaders/fullscreen.vert", "shaders/clouds_reproject.frag") ||
+        !compositeShader->InitFromFiles("shaders/fullscreen.vert", "shaders/clouds_composite.frag")) {
+        marchShader.reset();
+        reprojectShader.reset();
+        compositeShader.reset();
+        return false;
+    }
+    
+    if (fullscreenVAO == 0) {
+        glGenVertexArrays(1, &fullscreenVAO);
+    }
+    historyValid = false;
+    return true;
+}
+
+bool CloudSystem::CreateTemporalTargets(int width, int height) {
+    DestroyTemporalTargets();
+    
+    // Half floats: the reconstruction accumulates across frames and 8 bits bands in gradients
+    auto createTarget = [](GLuint& framebuffer, GLuint& texture, int w, int h, GLint filter) {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, w, h);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    };
+    
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    
+    int marchWidth = (width + MARCH_DOWNSCALE - 1) / MARCH_DOWNSCALE;
+    int marchHeight = (height + MARCH_DOWNSCALE - 1) / MARCH_DOWNSCALE;
+    bool complete = createTarget(marchFramebuffer, marchTexture, marchWidth, marchHeight, GL_NEAREST);
+    for (int i = 0; i < 2; i++) {
+        complete = createTarget(historyFramebuffers[i], historyTextures[i], width, height, GL_LINEAR) && complete;
+    }
+    
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    
+    if (!complete) {
+        std::cerr << "ERROR::CLOUDS::FRAMEBUFFER:: Temporal cloud targets not complete!" << std::endl;
+        DestroyTemporalTargets();
+        return false;
+    }
+    
+    targetWidth = width;
+    targetHeight = height;
+    historyValid = false;
+    std::cout << "Cloud temporal targets: " << marchWidth << "x" << marchHeight
+              << " march, " << width << "x" << height << " history" << std::endl;
+    return true;
+}
+
+void CloudSystem::DestroyTemporalTargets() {
+    if (marchFramebuffer != 0) {
+        glDeleteFramebuffers(1, &marchFramebuffer);
+        marchFramebuffer = 0;
+    }
+    if (marchTexture != 0) {
+        glDeleteTextures(1, &marchTexture);
+        marchTexture = 0;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (historyFramebuffers[i] != 0) {
+            glDeleteFramebuffers(1, &historyFramebuffers[i]);
+            historyFramebuffers[i] = 0;
+        }
+        if (historyTextures[i] != 0) {
+            glDeleteTextures(1, &historyTextures[i]);
+            historyTextures[i] = 0;
+        }
+    }
+    targetWidth = 0;
+    targetHeight = 0;
+    historyValid = false;
+}
+
+void CloudSystem::RenderTemporal(const glm::mat4& view, const glm::mat4& projection,
+                                 const glm::vec3& viewPos, const glm::vec3& lightDir,
+                                 const glm::vec3& lightColor, const glm::vec3& skyColor) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if ((viewport[2] != targetWidth || viewport[3] != targetHeight) &&
+        !CreateTemporalTargets(viewport[2], viewport[3])) {
+        return;
+    }
+    
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    
+    // Rotation only: the clouds are treated as infinitely far for reprojection
+    glm::mat4 viewProjection = projection * glm::mat4(glm::mat3(view));
+    glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+    glm::vec2 jitterOffset(BAYER_SEQUENCE[frameIndex % 16]);
+    glm::vec2 fullResolution(static_cast<float>(targetWidth), static_cast<float>(targetHeight));
+    
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glDepthMask(GL_FALSE);
+    glBindVertexArray(fullscreenVAO);
+    
+    // March one pixel of every 4x4 block
+    glBindFramebuffer(GL_FRAMEBUFFER, marchFramebuffer);
+    glViewport(0, 0, (targetWidth + MARCH_DOWNSCALE - 1) / MARCH_DOWNSCALE, (targetHeight + MARCH_DOWNSCALE - 1) / MARCH_DOWNSCALE);
+    marchShader->use();
+    SetVolumetricUniforms(viewPos, lightDir, lightColor, skyColor);
+    glUniformMatrix4fv(glGetUniformLocation(marchShader->shaderProgram, "u_inverseViewProjection"), 1, GL_FALSE, &inverseViewProjection[0][0]);
+    glUniform2fv(glGetUniformLocation(marchShader->shaderProgram, "u_fullResolution"), 1, &fullResolution[0]);
+    glUniform2fv(glGetUniformLocation(marchShader->shaderProgram, "u_jitterOffset"), 1, &jitterOffset[0]);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    
+    // Rebuild full resolution from the march and last frame's history
+    int previousHistory = historyIndex;
+    historyIndex = 1 - historyIndex;
+    glBindFramebuffer(GL_FRAMEBUFFER, historyFramebuffers[historyIndex]);
+    glViewport(0, 0, targetWidth, targetHeight);
+    reprojectShader->use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, marchTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, historyTextures[previousHistory]);
+    glUniform1i(glGetUniformLocation(reprojectShader->shaderProgram, "u_currentClouds"), 0);
+    glUniform1i(glGetUniformLocation(reprojectShader->shaderProgram, "u_history"), 1);
+    glUniformMatrix4fv(glGetUniformLocation(reprojectShader->shaderProgram, "u_inverseViewProjection"), 1, GL_FALSE, &inverseViewProjection[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(reprojectShader->shaderProgram, "u_previousViewProjection"), 1, GL_FALSE, &previousViewProjection[0][0]);
+    glUniform2fv(glGetUniformLocation(reprojectShader->shaderProgram, "u_jitterOffset"), 1, &jitterOffset[0]);
+    glUniform1i(glGetUniformLocation(reprojectShader->shaderProgram, "u_historyValid"), historyValid);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    
+    // Composite over the scene; the far-plane triangle only passes where no geometry was drawn
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    compositeShader->use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, historyTextures[historyIndex]);
+    glUniform1i(glGetUniformLocation(compositeShader->shaderProgram, "u_clouds"), 0);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    
+    // Restore render state
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    
+    previousViewProjection = viewProjection;
+    historyValid = true;
+    ++frameIndex;
+}
+
+void CloudSystem::SetVolumetricUniforms(const glm::vec3& viewPos, const glm::vec3& lightDir,
+                                        const glm::vec3& lightColor, const glm::vec3& skyColor) {
+    GLuint program = marchShader->shaderProgram;
+    glUniform1f(glGetUniformLocation(program, "u_time"), time);
+    glUniform3fv(glGetUniformLocation(program, "viewPos"), 1, &viewPos[0]);
+    glUniform3fv(glGetUniformLocation(program, "lightDirection"), 1, &lightDir[0]);
+    glUniform3fv(glGetUniformLocation(program, "lightColor"), 1, &lightColor[0]);
+    glUniform3fv(glGetUniformLocation(program, "skyColor"), 1, &skyColor[0]);
+    
+    glUniform1f(glGetUniformLocation(program, "u_cloudCoverage"), config.cloudCoverage);
+    glUniform1f(glGetUniformLocation(program, "u_cloudDensity"), config.cloudDensity);
+    glUniform1f(glGetUniformLocation(program, "u_cloudScale"), config.cloudScale);
+    glUniform1f(glGetUniformLocation(program, "u_cloudSpeed"), config.cloudSpeed);
+    glUniform1f(glGetUniformLocation(program, "u_cloudHeight"), config.cloudHeight);
+    glUniform1f(glGetUniformLocation(program, "u_cloudThickness"), config.cloudThickness);
+    glUniform3fv(glGetUniformLocation(program, "u_windDirection"), 1, &config.windDirection[0]);
+    glUniform3fv(glGetUniformLocation(program, "u_volumeSize"), 1, &config.volumeSize[0]);
+    
+    glUniform1i(glGetUniformLocation(program, "u_numSteps"), config.numSteps);
+    glUniform1i(glGetUniformLocation(program, "u_numLightSteps"), config.numLightSteps);
+    glUniform1f(glGetUniformLocation(program, "u_maxDistance"), config.maxDistance);
+    glUniform1f(glGetUniformLocation(program, "u_noiseScale"), config.noiseScale);
+    glUniform1f(glGetUniformLocation(program, "u_noiseStrength"), config.enableDetailNoise ? config.noiseStrength : 0.0f);
+    glUniform1i(glGetUniformLocation(program, "u_octaves"), config.octaves);
+    
+    bool hasNoiseVolumes = noiseVolumes.IsReady();
+    glUniform1i(glGetUniformLocation(program, "u_hasNoiseVolumes"), hasNoiseVolumes);
+    if (hasNoiseVolumes) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_3D, noiseVolumes.GetShapeTexture());
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_3D, noiseVolumes.GetDetailTexture());
+        glUniform1i(glGetUniformLocation(program, "u_shapeNoise"), 0);
+        glUniform1i(glGetUniformLocation(program, "u_detailNoise"), 1);
+        glUniform1f(glGetUniformLocation(program, "u_shapeNoiseFrequency"),
+                    static_cast<float>(noiseVolumes.GetSettings().shapeFrequency));
+        glUniform1f(glGetUniformLocation(program, "u_detailNoiseFrequency"),
+                    static_cast<float>(noiseVolumes.GetSettings().detailFrequency));
+    }
+    
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, weatherTexture);
+    glUniform1i(glGetUniformLocation(program, "u_weatherMap"), 2);
+    glActiveTexture(GL_TEXTURE0);
 }
 
 void CloudSystem::SetWeather(const WeatherData& weatherData) {
@@ -155,9 +426,75 @@ float CloudSystem::SampleCloudDensity(const glm::vec3& worldPos) const {
         return 0.0f;
     }
     
-    glm::vec3 samplePos = worldPos * config.cloudScale + config.windDirection * time * config.cloudSpeed;
-    float noise = FractionalBrownianMotion(samplePos, config.octaves);
+    glm::vec3 samplePos = worldPos * config.cloudScale + GetNoiseOffset();
+    float noise;
+    if (!densityGrid.Sample(samplePos, config.octaves, noise)) {
+        noise = FractionalBrownianMotion(samplePos, config.octaves);
+    }
+    
+    return DensityFromNoise(noise);
+}
+
+void CloudSystem::SampleCloudDensity(const glm::vec3* worldPositions, float* densities, size_t count) const {
+    float layerBottom = config.cloudHeight - config.cloudThickness * 0.5f;
+    float layerTop = config.cloudHeight + config.cloudThickness * 0.5f;
+    glm::vec3 noiseOffset = GetNoiseOffset();
     
+    for (size_t i = 0; i < count; i++) {
+        const glm::vec3& worldPos = worldPositions[i];
+        if (worldPos.y < layerBottom || worldPos.y > layerTop) {
+            densities[i] = 0.0f;
+            continue;
+        }
+        
+        glm::vec3 samplePos = worldPos * config.cloudScale + noiseOffset;
+        float noise;
+        if (!densityGrid.Sample(samplePos, config.octaves, noise)) {
+            noise = FractionalBrownianMotion(samplePos, config.octaves);
+        }
+        densities[i] = DensityFromNoise(noise);
+    }
+}
+
+float CloudSystem::IntegrateOpticalDepth(const glm::vec3& start, const glm::vec3& end) const {
+    // Clip the segment to the cloud layer first; outside it the density is zero
+    float layerBottom = config.cloudHeight - config.cloudThickness * 0.5f;
+    float layerTop = config.cloudHeight + config.cloudThickness * 0.5f;
+    glm::vec3 delta = end - start;
+    float tEnter = 0.0f;
+    float tExit = 1.0f;
+    if (std::abs(delta.y) > 1e-6f) {
+        float t0 = (layerBottom - start.y) / delta.y;
+        float t1 = (layerTop - start.y) / delta.y;
+        tEnter = (std::max)(tEnter, (std::min)(t0, t1));
+        tExit = (std::min)(tExit, (std::max)(t0, t1));
+    } else if (start.y < layerBottom || start.y > layerTop) {
+        return 0.0f;
+    }
+    if (tEnter >= tExit) {
+        return 0.0f;
+    }
+    
+    // Midpoint rule at half a grid cell, which is as fine as the baked data resolves
+    float length = glm::length(delta) * (tExit - tEnter);
+    int steps = (std::max)(1, static_cast<int>(std::ceil(length / (config.densityGridCellSize * 0.5f))));
+    float stepLength = length / steps;
+    glm::vec3 noiseOffset = GetNoiseOffset();
+    
+    float depth = 0.0f;
+    for (int i = 0; i < steps; i++) {
+        float t = tEnter + (tExit - tEnter) * ((i + 0.5f) / steps);
+        glm::vec3 samplePos = (start + delta * t) * config.cloudScale + noiseOffset;
+        float noise;
+        if (!densityGrid.Sample(samplePos, config.octaves, noise)) {
+            noise = FractionalBrownianMotion(samplePos, config.octaves);
+        }
+        depth += DensityFromNoise(noise) * stepLength;
+    }
+    return depth;
+}
+
+float CloudSystem::DensityFromNoise(float noise) const {
     return glm::clamp(noise - (1.0f - config.cloudCoverage), 0.0f, 1.0f) * config.cloudDensity;
 }
 
@@ -268,90 +605,15 @@ void CloudSystem::SetupVertexData() {
 void CloudSystem::CreateNoiseTextures() {
     std::cout << "Creating cloud noise textures..." << std::endl;
     
-    // Note: 3D texture creation requires significant memory and processing
-    // For now, we'll create placeholder textures or skip them
-    // In a production system, you'd want to pre-generate these or load them from files
-    
-    Generate3DNoise(64);      // Smaller size for performance
-    GenerateWorleyNoise(32);  // Even smaller for detail noise
+    // 128^3 shape and 32^3 detail volumes, loaded from the on-disk cache after the first run
+    if (!noiseVolumes.Initialize()) {
+        std::cerr << "Cloud noise volumes unavailable, using procedural noise" << std::endl;
+    }
     GenerateWeatherTexture(256); // 2D texture for weather patterns
     
     std::cout << "Cloud noise textures created" << std::endl;
 }
 
-void CloudSystem::Generate3DNoise(int size) {
-    // Create simple 3D noise texture
-    std::vector<unsigned char> noiseData(size * size * size);
-    
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
-    
-    for (int i = 0; i < size * size * size; i++) {
-        float noise = 0.0f;
-        float amplitude = 1.0f;
-        float frequency = 1.0f;
-        
-        // Simple FBM
-        for (int octave = 0; octave < 4; octave++) {
-            noise += amplitude * dis(gen);
-            amplitude *= 0.5f;
-            frequency *= 2.0f;
-        }
-        
-        noiseData[i] = static_cast<unsigned char>(glm::clamp(noise, 0.0f, 1.0f) * 255);
-    }
-    
-    glGenTextures(1, &noise3DTexture);
-    glBindTexture(GL_TEXTURE_3D, noise3DTexture);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, size, size, size, 0, GL_RED, GL_UNSIGNED_BYTE, noiseData.data());
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
-}
-
-void CloudSystem::GenerateWorleyNoise(int size) {
-    // Create Worley noise texture for cloud detail
-    std::vector<unsigned char> worleyData(size * size * size);
-    
-    // Simplified Worley noise generation
-    for (int z = 0; z < size; z++) {
-        for (int y = 0; y < size; y++) {
-            for (int x = 0; x < size; x++) {
-                float minDist = 10.0f;
-                
-                // Check surrounding cells for feature points
-                for (int oz = -1; oz <= 1; oz++) {
-                    for (int oy = -1; oy <= 1; oy++) {
-                        for (int ox = -1; ox <= 1; ox++) {
-                            glm::vec3 cellPos = glm::vec3(x + ox, y + oy, z + oz);
-                            float hash = Hash(cellPos.x + cellPos.y * 57.0f + cellPos.z * 113.0f);
-                            glm::vec3 featurePoint = cellPos + glm::vec3(hash, Hash(hash * 2.0f), Hash(hash * 3.0f));
-                            
-                            float dist = glm::distance(glm::vec3(x, y, z), featurePoint);
-                            minDist = glm::min(minDist, dist);
-                        }
-                    }
-                }
-                
-                int index = x + y * size + z * size * size;
-                worleyData[index] = static_cast<unsigned char>((1.0f - minDist / size) * 255);
-            }
-        }
-    }
-    
-    glGenTextures(1, &worleyTexture);
-    glBindTexture(GL_TEXTURE_3D, worleyTexture);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, size, size, size, 0, GL_RED, GL_UNSIGNED_BYTE, worleyData.data());
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
-}
-
 void CloudSystem::GenerateWeatherTexture(int size) {
     // Create 2D weather texture for large-scale cloud patterns
     std::vector<unsigned char> weatherData(size * size * 3);
@@ -5,6 +5,8 @@
 #include <memory>
 #include <vector>
 #include "Shader.hpp"
+#include "CloudNoise.hpp"
+#include "CloudDensityGrid.hpp"
 
 class CloudSystem {
 public:
@@ -36,6 +38,13 @@ public:
         bool enableDetailNoise = true;     // Use detail noise for cloud structure
         bool enableLightScattering = true; // Enable multiple scattering
         float lodDistance = 1000.0f;       // Distance for level-of-detail switching
+        
+        // Marches the full volumetric shader at 1/4 resolution, one pixel of every 4x4
+        // block per frame, and rebuilds the rest from the reprojected previous frame
+        bool enableTemporalReprojection = false;
+        
+        // CPU density queries
+        float densityGridCellSize = 50.0f; // Metres per cell of the baked density grid
     };
     
     // Weather system for dynamic clouds
@@ -63,9 +72,25 @@ private:
     bool isInitialized;
     
     // Noise textures for cloud generation
-    GLuint noise3DTexture;
-    GLuint worleyTexture;
+    CloudNoise noiseVolumes;    // Shape and detail volumes; the shader falls back to procedural noise without them
     GLuint weatherTexture;
+    
+    // Temporal mode (config.enableTemporalReprojection)
+    std::unique_ptr<Shader> marchShader;       // clouds.frag as a fullscreen pass
+    std::unique_ptr<Shader> reprojectShader;
+    std::unique_ptr<Shader> compositeShader;
+    GLuint fullscreenVAO;                      // Empty; fullscreen.vert builds its triangle from gl_VertexID
+    GLuint marchFramebuffer, marchTexture;     // 1/4 resolution per axis
+    GLuint historyFramebuffers[2], historyTextures[2];
+    int historyIndex;                          // History written this frame; the other one is last frame's
+    int targetWidth, targetHeight;             // Full resolution the targets were created for
+    unsigned int frameIndex;
+    glm::mat4 previousViewProjection;          // Rotation-only, like the matrices the passes use
+    bool historyValid;
+    
+    // Baked FBM around the last rendered camera position, for the CPU-side queries
+    CloudDensityGrid densityGrid;
+    glm::vec3 densityGridCentre;
 
 public:
     CloudSystem();
@@ -88,8 +113,13 @@ public:
     void SetWeather(const WeatherData& weatherData);
     const WeatherData& GetWeather() const { return weather; }
     
-    // Cloud density sampling (for gameplay/physics integration)
+    // Cloud density sampling (for gameplay/physics integration). Main thread; near the camera
+    // these read the baked density grid, elsewhere they fall back to evaluating the noise.
     float SampleCloudDensity(const glm::vec3& worldPos) const;
+    void SampleCloudDensity(const glm::vec3* worldPositions, float* densities, size_t count) const;
+    // Integral of density along the segment, in density-metres; transmittance is exp(-k * depth)
+    // for whatever extinction k the caller uses
+    float IntegrateOpticalDepth(const glm::vec3& start, const glm::vec3& end) const;
     glm::vec3 SampleCloudVelocity(const glm::vec3& worldPos) const;
     
     // Weather effects
@@ -108,11 +138,23 @@ private:
     void SetupVertexData();
     void CreateNoiseTextures();
     
+    // Temporal mode
+    bool InitializeTemporalShaders();
+    bool CreateTemporalTargets(int width, int height);
+    void DestroyTemporalTargets();
+    void RenderTemporal(const glm::mat4& view, const glm::mat4& projection,
+                        const glm::vec3& viewPos, const glm::vec3& lightDir,
+                        const glm::vec3& lightColor, const glm::vec3& skyColor);
+    void SetVolumetricUniforms(const glm::vec3& viewPos, const glm::vec3& lightDir,
+                               const glm::vec3& lightColor, const glm::vec3& skyColor);
+    
     // Noise generation
-    void Generate3DNoise(int size);
-    void GenerateWorleyNoise(int size);
     void GenerateWeatherTexture(int size);
     
+    glm::vec3 GetNoiseOffset() const { return config.windDirection * time * config.cloudSpeed; }
+    float DensityFromNoise(float noise) const;
+    void UpdateDensityGrid();
+    
     // Utility functions
     float Hash(float n) const;
     float Noise3D(const glm::vec3& pos) const;
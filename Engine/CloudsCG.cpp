@@ -1,8 +1,24 @@
 #include "CloudsCG.hpp"
 #include <iostream>
 
+namespace {
+    // Standard cubemap face orientation, in GL_TEXTURE_CUBE_MAP_POSITIVE_X + i order
+    const glm::vec3 CUBE_FACE_DIRECTIONS[6] = {
+        { 1.0f,  0.0f,  0.0f}, {-1.0f,  0.0f,  0.0f},
+        { 0.0f,  1.0f,  0.0f}, { 0.0f, -1.0f,  0.0f},
+        { 0.0f,  0.0f,  1.0f}, { 0.0f,  0.0f, -1.0f}
+    };
+    const glm::vec3 CUBE_FACE_UPS[6] = {
+        {0.0f, -1.0f,  0.0f}, {0.0f, -1.0f,  0.0f},
+        {0.0f,  0.0f,  1.0f}, {0.0f,  0.0f, -1.0f},
+        {0.0f, -1.0f,  0.0f}, {0.0f, -1.0f,  0.0f}
+    };
+}
+
 CloudsCG::CloudsCG() 
-    : vao(0), vbo(0), isInitialized(false) {
+    : vao(0), vbo(0), isInitialized(false),
+      skyCubemap(0), bakeFramebuffer(0), cacheFaceSize(0), cacheFacesPerFrame(0), nextCacheFace(0),
+      environmentVersion(0) {
     
     // Default parameters - more visible clouds
     params.coverage = 0.8f;
@@ -47,6 +63,8 @@ bool CloudsCG::Initialize() {
 }
 
 void CloudsCG::Cleanup() {
+    DisableSkyCache();
+    
     if (vao != 0) {
         glDeleteVertexArrays(1, &vao);
         vao = 0;
@@ -65,17 +83,28 @@ void CloudsCG::Update(float deltaTime) {
     params.time += deltaTime * params.speed;
 }
 
-void CloudsCG::RenderSkybox(const glm::mat4& viewMatrix, const glm::mat4& projMatrix) {
+void CloudsCG::RenderSkybox() {
     if (!isInitialized) return;
     
+    if (skyCubemap != 0) {
+        BakeSkyFaces(cacheFacesPerFrame);
+    }
+    
     // Skybox rendering setup from the book
     glDepthFunc(GL_LEQUAL);  // Change depth test for skybox
     glDisable(GL_CULL_FACE); // Disable face culling for skybox
     
-    cloudShader->use();
-    
-    // Set shader uniforms
-    SetShaderUniforms(viewMatrix, projMatrix);
+    if (skyCubemap != 0) {
+        cachedShader->use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, skyCubemap);
+        glUniform1i(glGetUniformLocation(cachedShader->shaderProgram, "skyCache"), 0);
+    } else {
+        cloudShader->use();
+        
+        // Set shader uniforms
+        SetShaderUniforms(*cloudShader);
+    }
     
     // Render skybox cube
     glBindVertexArray(vao);
@@ -86,6 +115,120 @@ void CloudsCG::RenderSkybox(const glm::mat4& viewMatrix, const glm::mat4& projMa
     glDepthFunc(GL_LESS);    // Restore normal depth testing
 }
 
+bool CloudsCG::EnableSkyCache(int faceSize, int facesPerFrame) {
+    if (!isInitialized) return false;
+    DisableSkyCache();
+    
+    bakeShader = std::make_unique<Shader>();
+    cachedShader = std::make_unique<Shader>();
+    if (!bakeShader->InitFromFiles("shaders/clouds_cg.vert", "shaders/clouds_cg.frag", "CLOUDS_CG_BAKE") ||
+        !cachedShader->InitFromFiles("shaders/clouds_cg.vert", "shaders/clouds_cg.frag", "CLOUDS_CG_CACHED")) {
+        std::cerr << "Failed to initialize sky cache shaders!" << std::endl;
+        bakeShader.reset();
+        cachedShader.reset();
+        return false;
+    }
+    
+    // Mipmapped so rough reflections can sample a blurrier level
+    GLsizei levels = 1;
+    for (int size = faceSize; size > 1; size >>= 1) {
+        ++levels;
+    }
+    glGenTextures(1, &skyCubemap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, skyCubemap);
+    glTexStorage2D(GL_TEXTURE_CUBE_MAP, levels, GL_RGBA8, faceSize, faceSize);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    
+    // Filter across face edges, which a low-resolution cache would otherwise show as seams
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    
+    glGenFramebuffers(1, &bakeFramebuffer);
+    cacheFaceSize = faceSize;
+    cacheFacesPerFrame = glm::clamp(facesPerFrame, 1, 6);
+    nextCacheFace = 0;
+    
+    // Fill every face once so the first frames do not show an empty cache
+    BakeSkyFaces(6);
+    
+    std::cout << "Sky cache enabled: " << faceSize << "x" << faceSize << " cubemap, "
+              << cacheFacesPerFrame << " face(s) per frame" << std::endl;
+    return true;
+}
+
+void CloudsCG::DisableSkyCache() {
+    if (bakeFramebuffer != 0) {
+        glDeleteFramebuffers(1, &bakeFramebuffer);
+        bakeFramebuffer = 0;
+    }
+    if (skyCubemap != 0) {
+        glDeleteTextures(1, &skyCubemap);
+        skyCubemap = 0;
+    }
+    bakeShader.reset();
+    cachedShader.reset();
+}
+
+void CloudsCG::BakeSkyFaces(int count) {
+    GLint previousFramebuffer = 0;
+    GLint viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, bakeFramebuffer);
+    glViewport(0, 0, cacheFaceSize, cacheFaceSize);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    
+    bakeShader->use();
+    SetShaderUniforms(*bakeShader);
+    GLint faceViewProjectionLoc = glGetUniformLocation(bakeShader->shaderProgram, "faceViewProjection");
+    glm::mat4 faceProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
+    
+    glBindVertexArray(vao);
+    for (int i = 0; i < count; i++) {
+        int face = nextCacheFace;
+        nextCacheFace = (nextCacheFace + 1) % 6;
+        
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, skyCubemap, 0);
+        glm::mat4 faceViewProjection = faceProjection * glm::lookAt(glm::vec3(0.0f), CUBE_FACE_DIRECTIONS[face], CUBE_FACE_UPS[face]);
+        glUniformMatrix4fv(faceViewProjectionLoc, 1, GL_FALSE, &faceViewProjection[0][0]);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
+    glBindVertexArray(0);
+    
+    glBindTexture(GL_TEXTURE_CUBE_MAP, skyCubemap);
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    ++environmentVersion;
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (depthTest) glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+}
+
+uint64_t CloudsCG::GetSkyKey() const {
+    const float values[] = {
+        params.coverage, params.density, params.speed, params.altitude,
+        skyColor.r, skyColor.g, skyColor.b, lightDirection.x, lightDirection.y, lightDirection.z,
+        static_cast<float>(cacheFaceSize)
+    };
+    
+    // FNV-1a over the bytes
+    uint64_t hash = 14695981039346656037ull;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+    for (size_t i = 0; i < sizeof(values); ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
 void CloudsCG::CreateSkyboxGeometry() {
     // Skybox cube vertices from the book (unit cube centered at origin)
     skyboxVertices = {
@@ -158,12 +301,9 @@ void CloudsCG::SetupSkyboxVertices() {
     std::cout << "Skybox geometry created: " << skyboxVertices.size()/3 << " vertices" << std::endl;
 }
 
-void CloudsCG::SetShaderUniforms(const glm::mat4& viewMatrix, const glm::mat4& projMatrix) {
-    GLuint shaderProgram = cloudShader->shaderProgram;
-    
-    // Matrix uniforms - following book's skybox approach
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "mv_matrix"), 1, GL_FALSE, &viewMatrix[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "proj_matrix"), 1, GL_FALSE, &projMatrix[0][0]);
+// View and projection come from the shared FrameData block
+void CloudsCG::SetShaderUniforms(const Shader& shader) {
+    GLuint shaderProgram = shader.shaderProgram;
     
     // Cloud parameters
     glUniform1f(glGetUniformLocation(shaderProgram, "time"), params.time);
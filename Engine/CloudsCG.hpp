@@ -1,5 +1,6 @@
 #pragma once
 #include <GL/glew.h>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <memory>
@@ -32,6 +33,16 @@ private:
     glm::vec3 lightDirection;
     
     bool isInitialized;
+    
+    // Sky cache (EnableSkyCache): the procedural sky baked into a cubemap by direction
+    std::unique_ptr<Shader> bakeShader;     // clouds_cg with CLOUDS_CG_BAKE
+    std::unique_ptr<Shader> cachedShader;   // clouds_cg with CLOUDS_CG_CACHED
+    GLuint skyCubemap;
+    GLuint bakeFramebuffer;
+    int cacheFaceSize;
+    int cacheFacesPerFrame;
+    int nextCacheFace;
+    uint32_t environmentVersion;
 
 public:
     CloudsCG();
@@ -42,7 +53,22 @@ public:
     void Cleanup();
     
     // Rendering with book's skybox technique
-    void RenderSkybox(const glm::mat4& viewMatrix, const glm::mat4& projMatrix);
+    void RenderSkybox();
+    
+    // Renders the sky into a faceSize^2 cubemap and from then on refreshes facesPerFrame faces
+    // per RenderSkybox in round-robin; the skybox itself only samples the cubemap. The clouds
+    // drift slowly, so a face that is a few frames old is not visible.
+    bool EnableSkyCache(int faceSize = 128, int facesPerFrame = 1);
+    void DisableSkyCache();
+    bool IsSkyCacheEnabled() const { return skyCubemap != 0; }
+    
+    // The cached sky, mipmapped, for environmentMap reflections; 0 while the cache is off
+    GLuint GetEnvironmentMap() const { return skyCubemap; }
+    // Changes whenever cached faces are re-rendered
+    uint32_t GetEnvironmentVersion() const { return environmentVersion; }
+    // Hash of the sky's look (parameters, colour, light) without the animation time, so bakes
+    // of the same sky can be cached between runs
+    uint64_t GetSkyKey() const;
     
     // Animation update
     void Update(float deltaTime);
@@ -61,7 +87,8 @@ private:
     // Skybox setup following book's method
     void CreateSkyboxGeometry();
     void SetupSkyboxVertices();
-    void SetShaderUniforms(const glm::mat4& viewMatrix, const glm::mat4& projMatrix);
+    void SetShaderUniforms(const Shader& shader);
+    void BakeSkyFaces(int count);
 };
 
 // Factory for creating cloud presets based on book's examples
@@ -0,0 +1,131 @@
+#include "ClusteredLighting.hpp"
+#include "Shadow.hpp"
+#include <cmath>
+#include <iostream>
+
+namespace {
+    // Clusters per compute group; must match CLUSTER_THREADS in light_cluster.comp
+    const int CLUSTER_THREADS = 128;
+    
+    // ClusterLights starts with the light count, padded to the light array's 16-byte alignment
+    struct BufferHeader {
+        uint32_t count;
+        uint32_t padding[3];
+    };
+}
+
+ClusteredLighting::ClusteredLighting()
+    : lightBuffer(0), gridBuffer(0), indexBuffer(0), depthScale(0.0f), depthBias(0.0f) {
+}
+
+ClusteredLighting::~ClusteredLighting() {
+    cleanup();
+}
+
+void ClusteredLighting::cleanup() {
+    GLuint buffers[] = { lightBuffer, gridBuffer, indexBuffer };
+    for (GLuint buffer : buffers) {
+        if (buffer) glDeleteBuffers(1, &buffer);
+    }
+    lightBuffer = gridBuffer = indexBuffer = 0;
+    cullShader.cleanup();
+    localLights.clear();
+}
+
+bool ClusteredLighting::Init(float nearPlane, float farPlane) {
+    cleanup();
+    
+    float logRatio = std::log(farPlane / nearPlane);
+    depthScale = CLUSTER_COUNT_Z / logRatio;
+    depthBias = -CLUSTER_COUNT_Z * std::log(nearPlane) / logRatio;
+    
+    // Created even without compute support: an empty grid still gives the lighting shaders
+    // valid, if unlit, buffers to read
+    BufferHeader noLights = {};
+    glGenBuffers(1, &lightBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(BufferHeader) + MAX_LIGHTS * sizeof(LocalLightData), nullptr,
+                 GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(noLights), &noLights);
+    
+    std::vector<uint32_t> emptyGrid(CLUSTER_COUNT * 2, 0);
+    glGenBuffers(1, &gridBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gridBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, emptyGrid.size() * sizeof(uint32_t), emptyGrid.data(), GL_DYNAMIC_COPY);
+    
+    glGenBuffers(1, &indexBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (1 + MAX_LIGHT_INDICES) * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_LIGHTS_BINDING, lightBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_GRID_BINDING, gridBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_INDICES_BINDING, indexBuffer);
+    
+    if (!cullShader.InitComputeFromFile("shaders/light_cluster.comp")) {
+        std::cerr << "ERROR::CLUSTERED_LIGHTING:: Failed to build the light culling shader" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Clustered lighting initialized: " << CLUSTER_COUNT_X << "x" << CLUSTER_COUNT_Y << "x"
+              << CLUSTER_COUNT_Z << " clusters, up to " << MAX_LIGHTS << " lights" << std::endl;
+    return true;
+}
+
+void ClusteredLighting::Update(const std::vector<std::unique_ptr<Light>>& lights, const ShadowAtlas* shadowAtlas) {
+    if (!IsInitialized() || !cullShader.shaderProgram) return;
+    
+    localLights.clear();
+    for (const auto& light : lights) {
+        if (!light->enabled || light->getType() == LightType::DIRECTIONAL) continue;
+        if (static_cast<int>(localLights.size()) >= MAX_LIGHTS) break;
+        
+        LocalLightData data = {};
+        data.position = light->getPosition();
+        data.color = light->color;
+        data.intensity = light->intensity;
+        data.shadowFace = shadowAtlas ? shadowAtlas->getFirstFace(light.get()) : -1;
+        if (light->getType() == LightType::POINT) {
+            const PointLight* point = static_cast<const PointLight*>(light.get());
+            data.range = point->getRange();
+            data.constant = point->constant;
+            data.linear = point->linear;
+            data.quadratic = point->quadratic;
+            data.type = LOCAL_LIGHT_POINT;
+        } else {
+            const SpotLight* spot = static_cast<const SpotLight*>(light.get());
+            data.range = spot->getRange();
+            data.direction = spot->getDirection();
+            data.innerCone = spot->innerCone;
+            data.outerCone = spot->outerCone;
+            data.constant = spot->constant;
+            data.linear = spot->linear;
+            data.quadratic = spot->quadratic;
+            data.type = LOCAL_LIGHT_SPOT;
+        }
+        localLights.push_back(data);
+    }
+    
+    BufferHeader header = {};
+    header.count = static_cast<uint32_t>(localLights.size());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(header), &header);
+    if (!localLights.empty()) {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(header), localLights.size() * sizeof(LocalLightData),
+                        localLights.data());
+    }
+    
+    // The cull pass appends every cluster's list to the shared index buffer
+    uint32_t noIndices = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(noIndices), &noIndices);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_LIGHTS_BINDING, lightBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_GRID_BINDING, gridBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_INDICES_BINDING, indexBuffer);
+    
+    cullShader.use();
+    glDispatchCompute((CLUSTER_COUNT + CLUSTER_THREADS - 1) / CLUSTER_THREADS, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include "Light.hpp"
+#include "Shader.hpp"
+
+class ShadowAtlas;
+
+// std430 mirrors of the storage blocks in shaders/clustered_lights.glsl
+struct LocalLightData {
+    glm::vec3 position;
+    float range;            // Cull radius, from Light::getRange
+    glm::vec3 color;
+    float intensity;
+    glm::vec3 direction;    // Spot lights only
+    float innerCone;
+    float outerCone;
+    float constant;
+    float linear;
+    float quadratic;
+    int type;               // LOCAL_LIGHT_POINT or LOCAL_LIGHT_SPOT
+    int shadowFace;         // ShadowAtlas face, -1 without shadows
+    int padding[2];
+};
+
+static_assert(sizeof(LocalLightData) == 80, "LocalLightData must match the std430 LocalLight layout");
+
+// Must match the defines in shaders/clustered_lights.glsl
+const int LOCAL_LIGHT_POINT = 0;
+const int LOCAL_LIGHT_SPOT = 1;
+const int CLUSTER_COUNT_X = 16;
+const int CLUSTER_COUNT_Y = 9;
+const int CLUSTER_COUNT_Z = 24;
+const int CLUSTER_COUNT = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z;
+
+// Clustered forward lighting: the view frustum is cut into screen tiles and exponentially
+// spaced depth slices, and a compute pass (light_cluster.comp) lists the point and spot
+// lights whose range sphere touches each cluster. Fragments shade only their cluster's list,
+// so the cost per pixel follows the lights nearby rather than the lights in the scene.
+class ClusteredLighting {
+public:
+    static const int MAX_LIGHTS = 1024;
+    static const int MAX_LIGHT_INDICES = CLUSTER_COUNT * 32;    // Shared by all clusters' lists
+    
+    ClusteredLighting();
+    ~ClusteredLighting();
+    
+    // nearPlane and farPlane are the camera's; the depth slices span them
+    bool Init(float nearPlane, float farPlane);
+    void cleanup();
+    bool IsInitialized() const { return lightBuffer != 0; }
+    
+    // Uploads the enabled point and spot lights and rebuilds the cluster lists. Reads the
+    // camera from the FrameData block, so call it after UniformBuffers::UpdateFrameData.
+    void Update(const std::vector<std::unique_ptr<Light>>& lights, const ShadowAtlas* shadowAtlas = nullptr);
+    
+    // Slice of a view depth is log(depth) * scale + bias; these go to the FrameData block
+    float getDepthScale() const { return depthScale; }
+    float getDepthBias() const { return depthBias; }
+    
+    int getLightCount() const { return static_cast<int>(localLights.size()); }
+    
+private:
+    GLuint lightBuffer;     // Light count, then LocalLightData
+    GLuint gridBuffer;      // Offset and count into the index list, per cluster
+    GLuint indexBuffer;     // Index count, then every cluster's light indices
+    Shader cullShader;
+    float depthScale;
+    float depthBias;
+    std::vector<LocalLightData> localLights;
+};
@@ -0,0 +1,355 @@
+#include "CompressedImage.hpp"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <sys/stat.h>
+
+namespace {
+    const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+    const uint32_t DDS_HEADER_SIZE = 124;
+    const uint32_t DDS_DX10_HEADER_SIZE = 20;
+    const uint32_t DDPF_FOURCC = 0x4;
+
+    const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    const size_t KTX2_HEADER_SIZE = 80;
+    const size_t KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+
+    // GL enums for the formats the engine accepts; sRGB variants load as UNORM
+    // because the shaders treat every texture as linear, same as the stb path
+    const GLenum FORMAT_BC1 = 0x83F0; // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    const GLenum FORMAT_BC1A = 0x83F1; // GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+    const GLenum FORMAT_BC3 = 0x83F3; // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+    const GLenum FORMAT_BC4 = GL_COMPRESSED_RED_RGTC1;
+    const GLenum FORMAT_BC5 = GL_COMPRESSED_RG_RGTC2;
+    const GLenum FORMAT_BC7 = GL_COMPRESSED_RGBA_BPTC_UNORM;
+
+    uint32_t MakeFourCC(char a, char b, char c, char d)
+    {
+        return static_cast<uint32_t>(static_cast<uint8_t>(a)) | (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8) |
+               (static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24);
+    }
+
+    uint32_t ReadU32(const unsigned char* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint64_t ReadU64(const unsigned char* p)
+    {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    size_t GetBlockSize(GLenum format)
+    {
+        return (format == FORMAT_BC1 || format == FORMAT_BC1A || format == FORMAT_BC4) ? 8 : 16;
+    }
+
+    size_t GetLevelSize(GLenum format, int levelWidth, int levelHeight)
+    {
+        size_t blocksX = static_cast<size_t>((std::max)(1, (levelWidth + 3) / 4));
+        size_t blocksY = static_cast<size_t>((std::max)(1, (levelHeight + 3) / 4));
+        return blocksX * blocksY * GetBlockSize(format);
+    }
+
+    // Length of a full mip chain, floor(log2(max(width, height))) + 1; more levels than this
+    // make glTexStorage2D fail and would shift by 32 or more in buildLevels
+    uint32_t GetMaxLevelCount(int levelWidth, int levelHeight)
+    {
+        uint32_t count = 1;
+        for (int size = (std::max)(levelWidth, levelHeight); size > 1; size >>= 1) {
+            ++count;
+        }
+        return count;
+    }
+
+    bool FileExists(const std::string& path)
+    {
+        struct stat fileInfo;
+        return stat(path.c_str(), &fileInfo) == 0;
+    }
+
+    bool HasExtension(const std::string& path, const char* extension)
+    {
+        size_t length = std::strlen(extension);
+        if (path.size() < length) return false;
+        std::string tail = path.substr(path.size() - length);
+        std::transform(tail.begin(), tail.end(), tail.begin(), [](char c) { return static_cast<char>(::tolower(c)); });
+        return tail == extension;
+    }
+}
+
+CompressedImage::CompressedImage() : internalFormat(0), width(0), height(0), channels(0)
+{
+}
+
+bool CompressedImage::Load(const std::string& path)
+{
+    Release();
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::streamsize fileSize = file.tellg();
+    file.seekg(0, std::ios::beg);
+    data.resize(static_cast<size_t>(fileSize));
+    if (fileSize <= 0 || !file.read(reinterpret_cast<char*>(data.data()), fileSize)) {
+        std::cerr << "ERROR::TEXTURE::COMPRESSED_READ_FAILED: " << path << std::endl;
+        Release();
+        return false;
+    }
+
+    bool parsed = false;
+    if (data.size() >= 4 && ReadU32(data.data()) == DDS_MAGIC) {
+        parsed = parseDDS(path);
+    } else if (data.size() >= sizeof(KTX2_IDENTIFIER) && std::memcmp(data.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+        parsed = parseKTX2(path);
+    } else {
+        std::cerr << "ERROR::TEXTURE::UNKNOWN_CONTAINER: " << path << std::endl;
+    }
+
+    if (!parsed) {
+        Release();
+    }
+    return parsed;
+}
+
+void CompressedImage::Release()
+{
+    internalFormat = 0;
+    width = height = channels = 0;
+    levels.clear();
+    data.clear();
+    data.shrink_to_fit();
+}
+
+void CompressedImage::setFormat(GLenum format, int channelCount)
+{
+    internalFormat = format;
+    channels = channelCount;
+}
+
+bool CompressedImage::parseDDS(const std::string& path)
+{
+    if (data.size() < 4 + DDS_HEADER_SIZE) {
+        std::cerr << "ERROR::TEXTURE::DDS_TRUNCATED: " << path << std::endl;
+        return false;
+    }
+
+    const unsigned char* header = data.data() + 4;
+    height = static_cast<int>(ReadU32(header + 8));
+    width = static_cast<int>(ReadU32(header + 12));
+    uint32_t mipCount = (std::max)(1u, ReadU32(header + 24));
+    uint32_t pixelFormatFlags = ReadU32(header + 76);
+    uint32_t fourCC = ReadU32(header + 80);
+    size_t dataOffset = 4 + DDS_HEADER_SIZE;
+
+    if (width <= 0 || height <= 0) {
+        std::cerr << "ERROR::TEXTURE::DDS_BAD_SIZE: " << path << std::endl;
+        return false;
+    }
+    mipCount = (std::min)(mipCount, GetMaxLevelCount(width, height));
+
+    if (!(pixelFormatFlags & DDPF_FOURCC)) {
+        std::cerr << "ERROR::TEXTURE::DDS_NOT_BLOCK_COMPRESSED: " << path << std::endl;
+        return false;
+    }
+
+    bool known = true;
+    if (fourCC == MakeFourCC('D', 'X', '1', '0')) {
+        if (data.size() < dataOffset + DDS_DX10_HEADER_SIZE) {
+            std::cerr << "ERROR::TEXTURE::DDS_TRUNCATED: " << path << std::endl;
+            return false;
+        }
+        const unsigned char* dx10 = data.data() + dataOffset;
+        uint32_t dxgiFormat = ReadU32(dx10);
+        uint32_t arraySize = ReadU32(dx10 + 12);
+        dataOffset += DDS_DX10_HEADER_SIZE;
+        if (arraySize > 1) {
+            std::cerr << "ERROR::TEXTURE::DDS_ARRAY_UNSUPPORTED: " << path << std::endl;
+            return false;
+        }
+        switch (dxgiFormat) {
+            case 71: case 72: setFormat(FORMAT_BC1A, 4); break; // DXGI_FORMAT_BC1_UNORM(_SRGB)
+            case 77: case 78: setFormat(FORMAT_BC3, 4); break;  // DXGI_FORMAT_BC3_UNORM(_SRGB)
+            case 80: setFormat(FORMAT_BC4, 1); break;           // DXGI_FORMAT_BC4_UNORM
+            case 83: setFormat(FORMAT_BC5, 2); break;           // DXGI_FORMAT_BC5_UNORM
+            case 98: case 99: setFormat(FORMAT_BC7, 4); break;  // DXGI_FORMAT_BC7_UNORM(_SRGB)
+            default: known = false; break;
+        }
+    } else if (fourCC == MakeFourCC('D', 'X', 'T', '1')) {
+        setFormat(FORMAT_BC1A, 4);
+    } else if (fourCC == MakeFourCC('D', 'X', 'T', '5')) {
+        setFormat(FORMAT_BC3, 4);
+    } else if (fourCC == MakeFourCC('A', 'T', 'I', '1') || fourCC == MakeFourCC('B', 'C', '4', 'U')) {
+        setFormat(FORMAT_BC4, 1);
+    } else if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U')) {
+        setFormat(FORMAT_BC5, 2);
+    } else {
+        known = false;
+    }
+
+    if (!known) {
+        std::cerr << "ERROR::TEXTURE::DDS_UNSUPPORTED_FORMAT: " << path << std::endl;
+        return false;
+    }
+
+    if (!buildLevels(dataOffset, data.size() - dataOffset, mipCount)) {
+        std::cerr << "ERROR::TEXTURE::DDS_TRUNCATED: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CompressedImage::parseKTX2(const std::string& path)
+{
+    if (data.size() < KTX2_HEADER_SIZE) {
+        std::cerr << "ERROR::TEXTURE::KTX2_TRUNCATED: " << path << std::endl;
+        return false;
+    }
+
+    const unsigned char* header = data.data() + sizeof(KTX2_IDENTIFIER);
+    uint32_t vkFormat = ReadU32(header);
+    width = static_cast<int>(ReadU32(header + 8));
+    height = static_cast<int>(ReadU32(header + 12));
+    uint32_t pixelDepth = ReadU32(header + 16);
+    uint32_t layerCount = ReadU32(header + 20);
+    uint32_t faceCount = ReadU32(header + 24);
+    uint32_t levelCount = (std::max)(1u, ReadU32(header + 28));
+    uint32_t supercompression = ReadU32(header + 32);
+
+    if (width <= 0 || height <= 0) {
+        std::cerr << "ERROR::TEXTURE::KTX2_BAD_SIZE: " << path << std::endl;
+        return false;
+    }
+    levelCount = (std::min)(levelCount, GetMaxLevelCount(width, height));
+
+    if (pixelDepth > 1 || layerCount > 1 || faceCount != 1) {
+        std::cerr << "ERROR::TEXTURE::KTX2_NOT_2D: " << path << std::endl;
+        return false;
+    }
+    if (supercompression != 0) {
+        std::cerr << "ERROR::TEXTURE::KTX2_SUPERCOMPRESSED: " << path << std::endl;
+        return false;
+    }
+
+    switch (vkFormat) {
+        case 131: case 132: setFormat(FORMAT_BC1, 3); break;  // VK_FORMAT_BC1_RGB_UNORM/SRGB_BLOCK
+        case 133: case 134: setFormat(FORMAT_BC1A, 4); break; // VK_FORMAT_BC1_RGBA_UNORM/SRGB_BLOCK
+        case 137: case 138: setFormat(FORMAT_BC3, 4); break;  // VK_FORMAT_BC3_UNORM/SRGB_BLOCK
+        case 139: setFormat(FORMAT_BC4, 1); break;            // VK_FORMAT_BC4_UNORM_BLOCK
+        case 141: setFormat(FORMAT_BC5, 2); break;            // VK_FORMAT_BC5_UNORM_BLOCK
+        case 145: case 146: setFormat(FORMAT_BC7, 4); break;  // VK_FORMAT_BC7_UNORM/SRGB_BLOCK
+        default:
+            std::cerr << "ERROR::TEXTURE::KTX2_UNSUPPORTED_FORMAT: " << vkFormat << " in " << path << std::endl;
+            return false;
+    }
+
+    // The level index follows the fixed header; level 0 is the full-size image
+    size_t indexOffset = KTX2_HEADER_SIZE;
+    if (data.size() < indexOffset + levelCount * KTX2_LEVEL_INDEX_ENTRY_SIZE) {
+        std::cerr << "ERROR::TEXTURE::KTX2_TRUNCATED: " << path << std::endl;
+        return false;
+    }
+
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        const unsigned char* entry = data.data() + indexOffset + level * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        CompressedMipLevel mip;
+        mip.offset = static_cast<size_t>(ReadU64(entry));
+        mip.size = static_cast<size_t>(ReadU64(entry + 8));
+        mip.width = (std::max)(1, width >> level);
+        mip.height = (std::max)(1, height >> level);
+        if (mip.size < GetLevelSize(internalFormat, mip.width, mip.height) || mip.offset + mip.size > data.size()) {
+            std::cerr << "ERROR::TEXTURE::KTX2_TRUNCATED: " << path << std::endl;
+            return false;
+        }
+        levels.push_back(mip);
+    }
+    return true;
+}
+
+bool CompressedImage::buildLevels(size_t dataOffset, size_t dataSize, unsigned levelCount)
+{
+    size_t offset = dataOffset;
+    for (unsigned level = 0; level < levelCount; ++level) {
+        CompressedMipLevel mip;
+        mip.width = (std::max)(1, width >> level);
+        mip.height = (std::max)(1, height >> level);
+        mip.size = GetLevelSize(internalFormat, mip.width, mip.height);
+        mip.offset = offset;
+        if (offset + mip.size > dataOffset + dataSize) {
+            return false;
+        }
+        offset += mip.size;
+        levels.push_back(mip);
+    }
+    return true;
+}
+
+GLuint CompressedImage::Upload(const unsigned char* source) const
+{
+    if (levels.empty() || !IsFormatSupported(internalFormat)) {
+        return 0;
+    }
+
+    GLuint textureID = 0;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(levels.size()), internalFormat, width, height);
+
+    for (size_t level = 0; level < levels.size(); ++level) {
+        const CompressedMipLevel& mip = levels[level];
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, mip.width, mip.height,
+                                  internalFormat, static_cast<GLsizei>(mip.size), source + mip.offset);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return textureID;
+}
+
+size_t CompressedImage::GetPayloadSize() const
+{
+    size_t total = 0;
+    for (const auto& mip : levels) {
+        total += mip.size;
+    }
+    return total;
+}
+
+std::string CompressedImage::FindCompressedVariant(const std::string& sourcePath)
+{
+    if (HasExtension(sourcePath, ".dds") || HasExtension(sourcePath, ".ktx2")) {
+        return FileExists(sourcePath) ? sourcePath : std::string();
+    }
+
+    size_t dot = sourcePath.find_last_of('.');
+    size_t slash = sourcePath.find_last_of("/\\");
+    std::string stem = (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+        ? sourcePath.substr(0, dot) : sourcePath;
+
+    if (FileExists(stem + ".ktx2")) return stem + ".ktx2";
+    if (FileExists(stem + ".dds")) return stem + ".dds";
+    return std::string();
+}
+
+bool CompressedImage::IsFormatSupported(GLenum format)
+{
+    if (format == FORMAT_BC1 || format == FORMAT_BC1A || format == FORMAT_BC3) {
+        return GLEW_EXT_texture_compression_s3tc != 0;
+    }
+    if (format == FORMAT_BC7) {
+        return GLEW_ARB_texture_compression_bptc != 0;
+    }
+    // RGTC is core since GL 3.0
+    return format == FORMAT_BC4 || format == FORMAT_BC5;
+}
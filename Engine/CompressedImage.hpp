@@ -0,0 +1,52 @@
+#pragma once
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+struct CompressedMipLevel {
+    size_t offset;
+    size_t size;
+    int width, height;
+};
+
+// Block-compressed image with a prebuilt mip chain, read from a DDS or KTX2
+// container. Only BC1/BC3/BC4/BC5/BC7 2D textures are accepted.
+// Rows are expected bottom-up like GL (TextureCooker flips before encoding),
+// so cooked files line up with the vertically flipped stb path.
+class CompressedImage {
+private:
+    GLenum internalFormat;
+    int width, height;
+    int channels;
+    std::vector<CompressedMipLevel> levels;
+    std::vector<unsigned char> data;
+
+    bool parseDDS(const std::string& path);
+    bool parseKTX2(const std::string& path);
+    void setFormat(GLenum format, int channelCount);
+    bool buildLevels(size_t dataOffset, size_t dataSize, unsigned levelCount);
+
+public:
+    CompressedImage();
+
+    bool Load(const std::string& path);
+    void Release();
+
+    // Creates an immutable texture and uploads every level from source + level offset.
+    // Pass nullptr with the image data bound to GL_PIXEL_UNPACK_BUFFER to upload from a PBO.
+    GLuint Upload(const unsigned char* source) const;
+
+    GLenum GetInternalFormat() const { return internalFormat; }
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+    int GetChannels() const { return channels; }
+    size_t GetLevelCount() const { return levels.size(); }
+    const unsigned char* GetData() const { return data.data(); }
+    size_t GetDataSize() const { return data.size(); }
+    size_t GetPayloadSize() const;
+
+    // Cooked sibling of a source image ("rock.png" -> "rock.ktx2" or "rock.dds"), or empty
+    static std::string FindCompressedVariant(const std::string& sourcePath);
+    static bool IsFormatSupported(GLenum format);
+};
@@ -0,0 +1,275 @@
+#include "CookedMesh.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <sys/stat.h>
+
+namespace {
+    const uint64_t SECTION_ALIGNMENT = 16;
+    
+    uint64_t AlignSection(uint64_t offset)
+    {
+        return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+    }
+    
+    void WritePadding(std::ofstream& out, uint64_t& offset)
+    {
+        static const char zeros[SECTION_ALIGNMENT] = {};
+        uint64_t aligned = AlignSection(offset);
+        out.write(zeros, static_cast<std::streamsize>(aligned - offset));
+        offset = aligned;
+    }
+    
+    bool InRange(uint64_t first, uint64_t count, uint64_t size)
+    {
+        return first <= size && count <= size - first;
+    }
+    
+    // count elements of elementSize bytes at offset, without overflowing on a hostile header
+    bool SectionInRange(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+    {
+        return count <= fileSize / elementSize && InRange(offset, count * elementSize, fileSize);
+    }
+    
+    // Indices are local to their submesh, so each has to stay below its vertexCount
+    bool IndicesInRange(const unsigned char* indexData, uint32_t indexSize, uint32_t first, uint32_t count, uint32_t vertexCount)
+    {
+        uint32_t largest = 0;
+        if (indexSize == sizeof(uint16_t)) {
+            const uint16_t* indices = reinterpret_cast<const uint16_t*>(indexData) + first;
+            for (uint32_t i = 0; i < count; ++i) {
+                largest = (std::max)(largest, static_cast<uint32_t>(indices[i]));
+            }
+        } else {
+            const uint32_t* indices = reinterpret_cast<const uint32_t*>(indexData) + first;
+            for (uint32_t i = 0; i < count; ++i) {
+                largest = (std::max)(largest, indices[i]);
+            }
+        }
+        return count == 0 || largest < vertexCount;
+    }
+    
+    // Ranges and indices of a record as loadCooked reads them, including the LOD it falls back to.
+    // indexData is the index section, already known to hold header.indexCount indices.
+    bool ValidSubMesh(const CookedSubMesh& record, const CookedMeshHeader& header, const unsigned char* indexData)
+    {
+        if (!InRange(record.firstIndex, record.indexCount, header.indexCount) ||
+            record.baseVertex < 0 || !InRange(static_cast<uint64_t>(record.baseVertex), record.vertexCount, header.vertexCount) ||
+            !IndicesInRange(indexData, header.indexSize, record.firstIndex, record.indexCount, record.vertexCount)) {
+            return false;
+        }
+        uint32_t lodCount = (std::max)(1u, (std::min)(record.lodCount, MAX_MESH_LODS));
+        for (uint32_t lod = 0; lod < lodCount; ++lod) {
+            const CookedSubMeshLod& range = record.lods[lod];
+            if (!InRange(range.firstIndex, range.indexCount, header.indexCount) ||
+                !IndicesInRange(indexData, header.indexSize, range.firstIndex, range.indexCount, record.vertexCount)) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+CookedMesh::CookedMesh() : header(nullptr)
+{
+}
+
+std::string CookedMesh::GetCookedPath(const std::string& sourcePath)
+{
+    return sourcePath + ".cmesh";
+}
+
+bool CookedMesh::GetSourceStamp(const std::string& path, uint64_t& size, int64_t& modifiedTime)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+    size = static_cast<uint64_t>(info.st_size);
+    modifiedTime = static_cast<int64_t>(info.st_mtime);
+    return true;
+}
+
+bool CookedMesh::Write(const std::string& cookedPath, const std::string& sourcePath,
+                       const std::vector<PackedVertex>& vertices, const VertexQuantization& quantization,
+                       const void* indexData, size_t indexCount, size_t indexSize,
+                       const std::vector<SubMesh>& subMeshes, const std::vector<CookedMaterial>& materials,
+                       const AABB& bounds)
+{
+    CookedMeshHeader fileHeader;
+    std::memset(&fileHeader, 0, sizeof(fileHeader));
+    fileHeader.magic = COOKED_MESH_MAGIC;
+    fileHeader.version = COOKED_MESH_VERSION;
+    fileHeader.vertexStride = sizeof(PackedVertex);
+    fileHeader.subMeshCount = static_cast<uint32_t>(subMeshes.size());
+    fileHeader.materialCount = static_cast<uint32_t>(materials.size());
+    fileHeader.indexSize = static_cast<uint32_t>(indexSize);
+    fileHeader.vertexCount = vertices.size();
+    fileHeader.indexCount = indexCount;
+    GetSourceStamp(sourcePath, fileHeader.sourceSize, fileHeader.sourceModifiedTime);
+    
+    fileHeader.subMeshOffset = AlignSection(sizeof(CookedMeshHeader));
+    fileHeader.materialOffset = AlignSection(fileHeader.subMeshOffset + subMeshes.size() * sizeof(CookedSubMesh));
+    fileHeader.vertexOffset = AlignSection(fileHeader.materialOffset + materials.size() * sizeof(CookedMaterial));
+    fileHeader.indexOffset = AlignSection(fileHeader.vertexOffset + vertices.size() * sizeof(PackedVertex));
+    
+    for (int axis = 0; axis < 3; ++axis) {
+        fileHeader.boundsMin[axis] = bounds.minPoint[axis];
+        fileHeader.boundsMax[axis] = bounds.maxPoint[axis];
+        fileHeader.positionOffset[axis] = quantization.positionOffset[axis];
+        fileHeader.positionScale[axis] = quantization.positionScale[axis];
+    }
+    for (int axis = 0; axis < 2; ++axis) {
+        fileHeader.texCoordOffset[axis] = quantization.texCoordOffset[axis];
+        fileHeader.texCoordScale[axis] = quantization.texCoordScale[axis];
+    }
+    
+    std::ofstream out(cookedPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "ERROR::COOKED_MESH:: Cannot write " << cookedPath << std::endl;
+        return false;
+    }
+    
+    uint64_t offset = 0;
+    out.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    offset += sizeof(fileHeader);
+    WritePadding(out, offset);
+    
+    for (const SubMesh& subMesh : subMeshes) {
+        CookedSubMesh record;
+        std::memset(&record, 0, sizeof(record));
+        record.firstIndex = subMesh.firstIndex;
+        record.indexCount = subMesh.indexCount;
+        record.baseVertex = subMesh.baseVertex;
+        record.vertexCount = subMesh.vertexCount;
+        record.materialIndex = subMesh.materialIndex;
+        record.lodCount = subMesh.lodCount;
+        for (int axis = 0; axis < 3; ++axis) {
+            record.boundsMin[axis] = subMesh.bounds.minPoint[axis];
+            record.boundsMax[axis] = subMesh.bounds.maxPoint[axis];
+        }
+        for (unsigned int lod = 0; lod < subMesh.lodCount; ++lod) {
+            record.lods[lod].firstIndex = subMesh.lods[lod].firstIndex;
+            record.lods[lod].indexCount = subMesh.lods[lod].indexCount;
+            record.lods[lod].error = subMesh.lods[lod].error;
+        }
+        out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        offset += sizeof(record);
+    }
+    WritePadding(out, offset);
+    
+    if (!materials.empty()) {
+        out.write(reinterpret_cast<const char*>(materials.data()), materials.size() * sizeof(CookedMaterial));
+        offset += materials.size() * sizeof(CookedMaterial);
+    }
+    WritePadding(out, offset);
+    
+    out.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(PackedVertex));
+    offset += vertices.size() * sizeof(PackedVertex);
+    WritePadding(out, offset);
+    
+    out.write(reinterpret_cast<const char*>(indexData), indexCount * indexSize);
+    
+    if (!out) {
+        std::cerr << "ERROR::COOKED_MESH:: Failed while writing " << cookedPath << std::endl;
+        return false;
+    }
+    
+    std::cout << "Cooked mesh written: " << cookedPath << std::endl;
+    return true;
+}
+
+bool CookedMesh::Open(const std::string& cookedPath, const std::string& sourcePath)
+{
+    Close();
+    
+    if (!file.Open(cookedPath)) {
+        return false;
+    }
+    
+    if (file.Size() < sizeof(CookedMeshHeader)) {
+        Close();
+        return false;
+    }
+    
+    const CookedMeshHeader* candidate = reinterpret_cast<const CookedMeshHeader*>(file.Data());
+    if (candidate->magic != COOKED_MESH_MAGIC || candidate->version != COOKED_MESH_VERSION ||
+        candidate->vertexStride != sizeof(PackedVertex)) {
+        std::cout << "Cooked mesh " << cookedPath << " has an old format, re-importing" << std::endl;
+        Close();
+        return false;
+    }
+    
+    uint64_t sourceSize = 0;
+    int64_t sourceTime = 0;
+    if (GetSourceStamp(sourcePath, sourceSize, sourceTime) &&
+        (sourceSize != candidate->sourceSize || sourceTime != candidate->sourceModifiedTime)) {
+        std::cout << "Cooked mesh " << cookedPath << " is older than its source, re-importing" << std::endl;
+        Close();
+        return false;
+    }
+    
+    // Every section has to lie inside the mapping before anything in it is dereferenced
+    const uint64_t fileSize = file.Size();
+    if (!SectionInRange(candidate->subMeshOffset, candidate->subMeshCount, sizeof(CookedSubMesh), fileSize) ||
+        !SectionInRange(candidate->materialOffset, candidate->materialCount, sizeof(CookedMaterial), fileSize) ||
+        (candidate->indexSize != sizeof(uint16_t) && candidate->indexSize != sizeof(uint32_t)) ||
+        !SectionInRange(candidate->vertexOffset, candidate->vertexCount, sizeof(PackedVertex), fileSize) ||
+        !SectionInRange(candidate->indexOffset, candidate->indexCount, candidate->indexSize, fileSize)) {
+        std::cerr << "ERROR::COOKED_MESH:: Truncated file " << cookedPath << std::endl;
+        Close();
+        return false;
+    }
+    
+    // The submesh records then have to stay inside the vertex and index sections, and so do
+    // the vertices their indices reach (BVHScene and the draws add baseVertex unchecked)
+    const CookedSubMesh* records = reinterpret_cast<const CookedSubMesh*>(file.Data() + candidate->subMeshOffset);
+    const unsigned char* indexData = file.Data() + candidate->indexOffset;
+    for (uint32_t i = 0; i < candidate->subMeshCount; ++i) {
+        if (!ValidSubMesh(records[i], *candidate, indexData)) {
+            std::cerr << "ERROR::COOKED_MESH:: Submesh " << i << " is out of range in " << cookedPath << std::endl;
+            Close();
+            return false;
+        }
+    }
+    
+    header = candidate;
+    return true;
+}
+
+void CookedMesh::Close()
+{
+    header = nullptr;
+    file.Close();
+}
+
+const CookedSubMesh* CookedMesh::GetSubMeshes() const
+{
+    return reinterpret_cast<const CookedSubMesh*>(file.Data() + header->subMeshOffset);
+}
+
+const CookedMaterial* CookedMesh::GetMaterials() const
+{
+    return reinterpret_cast<const CookedMaterial*>(file.Data() + header->materialOffset);
+}
+
+const PackedVertex* CookedMesh::GetVertices() const
+{
+    return reinterpret_cast<const PackedVertex*>(file.Data() + header->vertexOffset);
+}
+
+const void* CookedMesh::GetIndices() const
+{
+    return file.Data() + header->indexOffset;
+}
+
+VertexQuantization CookedMesh::GetQuantization() const
+{
+    VertexQuantization quantization;
+    quantization.positionOffset = glm::vec3(header->positionOffset[0], header->positionOffset[1], header->positionOffset[2]);
+    quantization.positionScale = glm::vec3(header->positionScale[0], header->positionScale[1], header->positionScale[2]);
+    quantization.texCoordOffset = glm::vec2(header->texCoordOffset[0], header->texCoordOffset[1]);
+    quantization.texCoordScale = glm::vec2(header->texCoordScale[0], header->texCoordScale[1]);
+    return quantization;
+}
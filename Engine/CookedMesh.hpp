@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Mesh.hpp"
+#include "MappedFile.hpp"
+
+// Versioned binary mesh format written after an Assimp import and loaded
+// with a memory mapping on later runs. Layout, all sections 16-byte aligned:
+//   CookedMeshHeader | CookedSubMesh[subMeshCount] | CookedMaterial[materialCount]
+//   | PackedVertex[vertexCount] | uint16 or uint32 index[indexCount]
+// Geometry is stored optimised and quantised, exactly as it is uploaded. Bump
+// COOKED_MESH_VERSION whenever any of these structs or PackedVertex change.
+const uint32_t COOKED_MESH_MAGIC = 0x48534D43u; // "CMSH"
+const uint32_t COOKED_MESH_VERSION = 2;
+const size_t COOKED_MESH_PATH_LENGTH = 260;
+
+struct CookedMeshHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexStride;
+    uint32_t subMeshCount;
+    uint32_t materialCount;
+    uint32_t indexSize;         // 2 or 4 bytes
+    
+    // Size and modification time of the source asset, used to detect stale files
+    uint64_t sourceSize;
+    int64_t sourceModifiedTime;
+    
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t subMeshOffset;
+    uint64_t materialOffset;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    
+    float boundsMin[3];
+    float boundsMax[3];
+    
+    // VertexQuantization of the packed vertices
+    float positionOffset[3];
+    float positionScale[3];
+    float texCoordOffset[2];
+    float texCoordScale[2];
+};
+
+struct CookedSubMeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;
+};
+
+struct CookedSubMesh {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t baseVertex;
+    uint32_t vertexCount;
+    uint32_t materialIndex;
+    uint32_t lodCount;
+    float boundsMin[3];
+    float boundsMax[3];
+    CookedSubMeshLod lods[MAX_MESH_LODS];
+};
+
+// Material parameters and resolved texture paths as loaded from the source file
+struct CookedMaterial {
+    float albedo[3];
+    float metallic;
+    float roughness;
+    float ao;
+    char diffuseTexture[COOKED_MESH_PATH_LENGTH];
+    char normalTexture[COOKED_MESH_PATH_LENGTH];
+};
+
+class CookedMesh {
+private:
+    MappedFile file;
+    const CookedMeshHeader* header;
+    
+public:
+    CookedMesh();
+    
+    // Cooked files live next to the source as "<source>.cmesh"
+    static std::string GetCookedPath(const std::string& sourcePath);
+    static bool GetSourceStamp(const std::string& path, uint64_t& size, int64_t& modifiedTime);
+    
+    static bool Write(const std::string& cookedPath, const std::string& sourcePath,
+                      const std::vector<PackedVertex>& vertices, const VertexQuantization& quantization,
+                      const void* indexData, size_t indexCount, size_t indexSize,
+                      const std::vector<SubMesh>& subMeshes, const std::vector<CookedMaterial>& materials,
+                      const AABB& bounds);
+    
+    // Maps and validates a cooked file. A missing source is accepted so deployments can ship
+    // cooked files alone; an existing source with a different stamp marks the file stale.
+    bool Open(const std::string& cookedPath, const std::string& sourcePath);
+    void Close();
+    
+    const CookedMeshHeader& GetHeader() const { return *header; }
+    const CookedSubMesh* GetSubMeshes() const;
+    const CookedMaterial* GetMaterials() const;
+    const PackedVertex* GetVertices() const;
+    const void* GetIndices() const;
+    VertexQuantization GetQuantization() const;
+};
@@ -0,0 +1,80 @@
+#include "FramePacer.hpp"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace {
+    // How long before the deadline the timer hands over to spinning, in seconds
+    const double HIGH_RESOLUTION_SPIN = 0.0005;
+    const double COARSE_SPIN = 0.002;
+
+    LONGLONG Now()
+    {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return counter.QuadPart;
+    }
+}
+
+FramePacer::FramePacer() : highResolution(true), targetRate(0.0), period(0), nextFrame(0)
+{
+    LARGE_INTEGER counterFrequency;
+    QueryPerformanceFrequency(&counterFrequency);
+    frequency = counterFrequency.QuadPart;
+
+    // High-resolution timers need Windows 10 1803; older systems get the coarse kind
+    timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!timer) {
+        highResolution = false;
+        timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+    }
+}
+
+FramePacer::~FramePacer()
+{
+    if (timer) {
+        CloseHandle(timer);
+    }
+}
+
+void FramePacer::SetTargetRate(double framesPerSecond)
+{
+    targetRate = framesPerSecond > 0.0 ? framesPerSecond : 0.0;
+    period = targetRate > 0.0 ? static_cast<LONGLONG>(frequency / targetRate) : 0;
+    nextFrame = Now();
+}
+
+bool FramePacer::WaitForNextFrame()
+{
+    if (period == 0) {
+        return true;
+    }
+
+    LONGLONG now = Now();
+    LONGLONG spin = static_cast<LONGLONG>(frequency * (highResolution ? HIGH_RESOLUTION_SPIN : COARSE_SPIN));
+    LONGLONG remaining = nextFrame - now;
+    if (timer && remaining > spin) {
+        // Relative due times are negative, in 100 ns units
+        LARGE_INTEGER due;
+        due.QuadPart = -((remaining - spin) * 10000000 / frequency);
+        if (SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE)) {
+            DWORD result = MsgWaitForMultipleObjects(1, &timer, FALSE, INFINITE, QS_ALLINPUT);
+            if (result == WAIT_OBJECT_0 + 1) {
+                return false;
+            }
+        }
+        now = Now();
+    }
+    while (now < nextFrame) {
+        YieldProcessor();
+        now = Now();
+    }
+
+    // A frame more than a period late starts a new schedule from now
+    nextFrame += period;
+    if (nextFrame < now) {
+        nextFrame = now + period;
+    }
+    return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <windows.h>
+
+// Frame limiter for the window loop. Frames are due a fixed period apart; the wait sleeps on a
+// high-resolution waitable timer and spins only for the last stretch, and it returns early
+// when a window message arrives so input is never held for a whole frame. A frame that runs
+// late moves the schedule instead of being followed by a burst of catch-up frames.
+class FramePacer {
+public:
+    FramePacer();
+    ~FramePacer();
+
+    // Zero or less leaves frames unpaced
+    void SetTargetRate(double framesPerSecond);
+    double GetTargetRate() const { return targetRate; }
+
+    // True once the next frame is due; false when a message arrived first, to be pumped
+    // before waiting again
+    bool WaitForNextFrame();
+
+private:
+    HANDLE timer;
+    bool highResolution;        // Coarse timers wake up to a scheduler tick late; spin longer
+    double targetRate;
+    LONGLONG frequency;
+    LONGLONG period;            // In performance counter ticks, 0 when unpaced
+    LONGLONG nextFrame;
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+};
@@ -0,0 +1,43 @@
+#include "FramePipeline.hpp"
+#include "Profiler.hpp"
+
+FramePipeline::FramePipeline() : writeIndex(0), inFlight(false)
+{
+}
+
+FramePipeline::~FramePipeline()
+{
+    Flush();
+}
+
+void FramePipeline::Kick(const Simulation& simulation)
+{
+    Flush();
+
+    FrameSnapshot* frame = &frames[writeIndex];
+    inFlight = true;
+    JobSystem::Get().Run([simulation, frame] {
+        PROFILE_SCOPE("Simulate frame");
+        simulation(*frame);
+    }, counter);
+}
+
+FrameSnapshot& FramePipeline::Acquire()
+{
+    Flush();
+
+    // The next Kick writes the other snapshot while this one is drawn
+    FrameSnapshot& frame = frames[writeIndex];
+    writeIndex = 1 - writeIndex;
+    return frame;
+}
+
+void FramePipeline::Flush()
+{
+    if (!inFlight) {
+        return;
+    }
+    PROFILE_SCOPE("Wait for simulation");
+    JobSystem::Get().Wait(counter);
+    inFlight = false;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "Camera.hpp"
+#include "Frustum.hpp"
+#include "JobSystem.hpp"
+#include <glm/glm.hpp>
+#include <functional>
+#include <vector>
+
+// Everything the render thread reads about one frame that the simulation would otherwise be
+// changing underneath it, written by that frame's simulation job
+struct FrameSnapshot {
+    Camera camera;                          // Pose after this frame's input or camera path
+    float deltaTime;                        // Seconds the frame's simulation advances by
+    std::vector<glm::mat4> meshModels;      // One per mesh, in the order the meshes are drawn
+    FrustumCuller culler;                   // Plain submeshes against this frame's frustum; empty
+                                            // while the GPU culls them
+
+    FrameSnapshot() : deltaTime(0.0f) {}
+};
+
+// Double-buffered frames: while the render thread builds and submits frame N from one
+// snapshot, frame N+1's simulation and culling jobs fill the other. Render thread only.
+class FramePipeline {
+public:
+    typedef std::function<void(FrameSnapshot&)> Simulation;
+
+    FramePipeline();
+    ~FramePipeline();
+
+    // Starts the next frame's simulation on the job system, into the snapshot not being drawn
+    void Kick(const Simulation& simulation);
+    bool IsInFlight() const { return inFlight; }
+
+    // Waits for the kicked frame, running jobs meanwhile; the snapshot stays as it is until
+    // the next Acquire
+    FrameSnapshot& Acquire();
+
+    // Waits without taking the frame, before anything the simulation reads is changed or freed
+    void Flush();
+
+private:
+    FrameSnapshot frames[2];
+    int writeIndex;
+    bool inFlight;
+    JobCounter counter;
+};
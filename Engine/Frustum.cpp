@@ -0,0 +1,123 @@
+#include "Frustum.hpp"
+#include "JobSystem.hpp"
+#include <emmintrin.h>
+#include <cmath>
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+    // glm is column-major: row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+    const glm::mat4& m = viewProjection;
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    
+    planes[PLANE_LEFT] = row3 + row0;
+    planes[PLANE_RIGHT] = row3 - row0;
+    planes[PLANE_BOTTOM] = row3 + row1;
+    planes[PLANE_TOP] = row3 - row1;
+    planes[PLANE_NEAR] = row3 + row2;
+    planes[PLANE_FAR] = row3 - row2;
+    
+    // Normalise so plane distances are in world units and sphere radii can be compared directly
+    for (int i = 0; i < PLANE_COUNT; ++i) {
+        float length = glm::length(glm::vec3(planes[i]));
+        if (length > 0.0f) {
+            planes[i] /= length;
+        }
+    }
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const
+{
+    for (int i = 0; i < PLANE_COUNT; ++i) {
+        if (glm::dot(glm::vec3(planes[i]), sphere.center) + planes[i].w < -sphere.radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersects(const AABB& box) const
+{
+    glm::vec3 c = box.center();
+    glm::vec3 e = box.extents();
+    for (int i = 0; i < PLANE_COUNT; ++i) {
+        glm::vec3 n = glm::vec3(planes[i]);
+        // Projected half-size of the box onto the plane normal
+        float r = e.x * std::abs(n.x) + e.y * std::abs(n.y) + e.z * std::abs(n.z);
+        if (glm::dot(n, c) + planes[i].w < -r) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FrustumCuller::Clear()
+{
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    radius.clear();
+    boxes.clear();
+    visible.clear();
+}
+
+uint32_t FrustumCuller::Add(const BoundingSphere& worldSphere, const AABB& worldBox)
+{
+    centerX.push_back(worldSphere.center.x);
+    centerY.push_back(worldSphere.center.y);
+    centerZ.push_back(worldSphere.center.z);
+    radius.push_back(worldSphere.radius);
+    boxes.push_back(worldBox);
+    return static_cast<uint32_t>(radius.size() - 1);
+}
+
+void FrustumCuller::Cull(const Frustum& frustum)
+{
+    visible.assign(radius.size(), 0);
+    
+    // Large batches split across the job system; the ranges write disjoint flags
+    JobSystem::Get().ParallelFor(radius.size(), CULL_GRAIN_SIZE, [this, &frustum](size_t begin, size_t end) {
+        CullRange(frustum, begin, end);
+    });
+}
+
+void FrustumCuller::CullRange(const Frustum& frustum, size_t begin, size_t end)
+{
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 cx = _mm_loadu_ps(&centerX[i]);
+        __m128 cy = _mm_loadu_ps(&centerY[i]);
+        __m128 cz = _mm_loadu_ps(&centerZ[i]);
+        __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&radius[i]));
+        
+        // All four lanes start inside; each plane can only clear lanes
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < Frustum::PLANE_COUNT; ++p) {
+            const glm::vec4& plane = frustum.planes[p];
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+                _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+        }
+        
+        int mask = _mm_movemask_ps(inside);
+        visible[i + 0] = static_cast<uint8_t>((mask >> 0) & 1);
+        visible[i + 1] = static_cast<uint8_t>((mask >> 1) & 1);
+        visible[i + 2] = static_cast<uint8_t>((mask >> 2) & 1);
+        visible[i + 3] = static_cast<uint8_t>((mask >> 3) & 1);
+    }
+    
+    for (; i < end; ++i) {
+        BoundingSphere sphere(glm::vec3(centerX[i], centerY[i], centerZ[i]), radius[i]);
+        visible[i] = frustum.intersects(sphere) ? 1 : 0;
+    }
+    
+    // Spheres are loose around long, flat submeshes; tighten the survivors with their boxes
+    for (size_t j = begin; j < end; ++j) {
+        if (visible[j] && !frustum.intersects(boxes[j])) {
+            visible[j] = 0;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "Bounds.hpp"
+
+// Six planes (left, right, bottom, top, near, far) with normals pointing inwards,
+// extracted from a combined projection * view matrix (Gribb/Hartmann).
+class Frustum {
+public:
+    enum { PLANE_LEFT = 0, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT };
+    
+    glm::vec4 planes[PLANE_COUNT];
+    
+    Frustum() {}
+    explicit Frustum(const glm::mat4& viewProjection);
+    
+    bool intersects(const BoundingSphere& sphere) const;
+    bool intersects(const AABB& box) const;
+};
+
+// Culls many world-space bounds against one frustum. Spheres are stored as
+// structure-of-arrays so the plane test runs four bounds per SSE instruction;
+// anything that survives is refined against its AABB.
+class FrustumCuller {
+public:
+    // Below this many bounds a batch is culled on the calling thread alone
+    static const size_t CULL_GRAIN_SIZE = 1024;
+
+private:
+    std::vector<float> centerX, centerY, centerZ, radius;
+    std::vector<AABB> boxes;
+    std::vector<uint8_t> visible;
+    
+    void CullRange(const Frustum& frustum, size_t begin, size_t end);
+    
+public:
+    void Clear();
+    
+    // Returns the index used to query the result after Cull()
+    uint32_t Add(const BoundingSphere& worldSphere, const AABB& worldBox);
+    void Cull(const Frustum& frustum);
+    
+    bool IsVisible(uint32_t index) const { return visible[index] != 0; }
+    size_t Size() const { return radius.size(); }
+};
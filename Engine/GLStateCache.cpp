@@ -0,0 +1,57 @@
+#include "GLStateCache.hpp"
+
+namespace {
+    // Sentinel that never matches a real GL name, so the first bind after Invalidate() always goes through
+    const GLuint UNKNOWN_BINDING = 0xFFFFFFFFu;
+}
+
+GLStateCache::GLStateCache()
+{
+    Invalidate();
+}
+
+void GLStateCache::Invalidate()
+{
+    program = UNKNOWN_BINDING;
+    vertexArray = UNKNOWN_BINDING;
+    activeTextureUnit = 0;
+    for (int i = 0; i < MAX_TEXTURE_UNITS; ++i) {
+        boundTextures2D[i] = UNKNOWN_BINDING;
+    }
+}
+
+bool GLStateCache::UseProgram(GLuint programID)
+{
+    if (program == programID) return false;
+    glUseProgram(programID);
+    program = programID;
+    return true;
+}
+
+bool GLStateCache::BindVertexArray(GLuint vao)
+{
+    if (vertexArray == vao) return false;
+    glBindVertexArray(vao);
+    vertexArray = vao;
+    return true;
+}
+
+bool GLStateCache::BindTexture2D(GLuint unit, GLuint textureID)
+{
+    if (unit >= static_cast<GLuint>(MAX_TEXTURE_UNITS)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        activeTextureUnit = GL_TEXTURE0 + unit;
+        return true;
+    }
+    
+    if (boundTextures2D[unit] == textureID) return false;
+    
+    if (activeTextureUnit != GL_TEXTURE0 + unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeTextureUnit = GL_TEXTURE0 + unit;
+    }
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    boundTextures2D[unit] = textureID;
+    return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <GL/glew.h>
+
+// Shadow copy of the GL binding state touched by the mesh pass.
+// Redundant binds are dropped on the CPU instead of reaching the driver.
+// Code outside the cache may change bindings, so call Invalidate() before
+// relying on it each frame.
+class GLStateCache {
+public:
+    static const int MAX_TEXTURE_UNITS = 16;
+    
+private:
+    GLuint program;
+    GLuint vertexArray;
+    GLenum activeTextureUnit;
+    GLuint boundTextures2D[MAX_TEXTURE_UNITS];
+    
+public:
+    GLStateCache();
+    
+    void Invalidate();
+    
+    // Each returns true when the binding actually changed
+    bool UseProgram(GLuint programID);
+    bool BindVertexArray(GLuint vao);
+    bool BindTexture2D(GLuint unit, GLuint textureID);
+    
+    GLuint GetProgram() const { return program; }
+};
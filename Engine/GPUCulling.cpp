@@ -0,0 +1,392 @@
+#include "GPUCulling.hpp"
+#include "Mesh.hpp"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+
+namespace {
+    constexpr uint32_t UNIFORM_VIEW_PROJECTION = HashUniformName("viewProjection");
+    constexpr uint32_t UNIFORM_HIZ_VIEW_PROJECTION = HashUniformName("hiZViewProjection");
+    constexpr uint32_t UNIFORM_OBJECT_COUNT = HashUniformName("objectCount");
+    constexpr uint32_t UNIFORM_USE_OCCLUSION = HashUniformName("useOcclusion");
+    constexpr uint32_t UNIFORM_COMPACT = HashUniformName("compact");
+    constexpr uint32_t UNIFORM_HIZ = HashUniformName("hiZ");
+    constexpr uint32_t UNIFORM_HIZ_LEVELS = HashUniformName("hiZLevels");
+    constexpr uint32_t UNIFORM_SCENE_DEPTH = HashUniformName("sceneDepth");
+    constexpr uint32_t UNIFORM_CAMERA_POSITION = HashUniformName("cameraPosition");
+    constexpr uint32_t UNIFORM_LOD_SCALE = HashUniformName("lodScale");
+    
+    // After the clustered lighting blocks (0-2), which stay bound for the whole frame;
+    // must match the bindings in gpu_cull.comp
+    const GLuint CULL_OBJECTS_BINDING = 3;
+    const GLuint CULL_GROUPS_BINDING = 4;
+    const GLuint CULL_SOURCE_COMMANDS_BINDING = 5;
+    const GLuint CULL_DRAW_COMMANDS_BINDING = 6;
+    const GLuint CULL_DRAW_COUNTS_BINDING = 7;
+    
+    // Must match local_size_x in gpu_cull.comp and local_size_x/y in hiz_build.comp
+    const GLuint CULL_GROUP_SIZE = 64;
+    const GLuint HIZ_GROUP_SIZE = 8;
+    
+    // Samplers of the compute passes; nothing else binds these units while they run
+    const GLuint HIZ_TEXTURE_UNIT = 0;
+}
+
+// HiZPyramid Implementation
+HiZPyramid::HiZPyramid()
+    : depthCopy(0), depthFramebuffer(0), pyramid(0), width(0), height(0), levelCount(0), viewProjection(1.0f),
+      valid(false) {
+}
+
+HiZPyramid::~HiZPyramid() {
+    cleanup();
+}
+
+void HiZPyramid::cleanup() {
+    if (depthFramebuffer) {
+        glDeleteFramebuffers(1, &depthFramebuffer);
+        depthFramebuffer = 0;
+    }
+    if (depthCopy) {
+        glDeleteTextures(1, &depthCopy);
+        depthCopy = 0;
+    }
+    if (pyramid) {
+        glDeleteTextures(1, &pyramid);
+        pyramid = 0;
+    }
+    copyShader.cleanup();
+    reduceShader.cleanup();
+    width = height = levelCount = 0;
+    valid = false;
+}
+
+bool HiZPyramid::Init() {
+    cleanup();
+    if (!copyShader.InitComputeFromFile("shaders/hiz_build.comp", "HIZ_COPY") ||
+        !reduceShader.InitComputeFromFile("shaders/hiz_build.comp")) {
+        std::cerr << "ERROR::HIZ:: Failed to build the pyramid shaders" << std::endl;
+        return false;
+    }
+    glGenFramebuffers(1, &depthFramebuffer);
+    return true;
+}
+
+void HiZPyramid::allocate(int newWidth, int newHeight) {
+    if (depthCopy) glDeleteTextures(1, &depthCopy);
+    if (pyramid) glDeleteTextures(1, &pyramid);
+    
+    width = newWidth;
+    height = newHeight;
+    levelCount = 1 + static_cast<int>(std::floor(std::log2(static_cast<float>((std::max)(width, height)))));
+    
+    // Same format as the default framebuffer's depth (24 bits, see WindowWin), which the blit requires
+    glGenTextures(1, &depthCopy);
+    glBindTexture(GL_TEXTURE_2D, depthCopy);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    
+    glGenTextures(1, &pyramid);
+    glBindTexture(GL_TEXTURE_2D, pyramid);
+    glTexStorage2D(GL_TEXTURE_2D, levelCount, GL_R32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, depthFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthCopy, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void HiZPyramid::Build(int newWidth, int newHeight, const glm::mat4& newViewProjection) {
+    if (!depthFramebuffer || newWidth <= 0 || newHeight <= 0) return;
+    if (newWidth != width || newHeight != height) {
+        allocate(newWidth, newHeight);
+    }
+    
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthFramebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    
+    // Level 0 from the depth copy, then each level from the one below
+    copyShader.use();
+    glActiveTexture(GL_TEXTURE0 + HIZ_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, depthCopy);
+    glUniform1i(copyShader.getUniformLocation(UNIFORM_SCENE_DEPTH), HIZ_TEXTURE_UNIT);
+    glBindImageTexture(1, pyramid, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute((width + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (height + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+    
+    reduceShader.use();
+    for (int level = 1; level < levelCount; ++level) {
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        int levelWidth = (std::max)(1, width >> level);
+        int levelHeight = (std::max)(1, height >> level);
+        glBindImageTexture(0, pyramid, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((levelWidth + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE,
+                          (levelHeight + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+    }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    viewProjection = newViewProjection;
+    valid = true;
+}
+
+// GPUCuller Implementation
+GPUCuller::GPUCuller()
+    : objectBuffer(0), groupBuffer(0), sourceCommandBuffer(0), drawCommandBuffer(0), drawCountBuffer(0),
+      compacting(false), objectCount(0) {
+}
+
+GPUCuller::~GPUCuller() {
+    cleanup();
+}
+
+bool GPUCuller::IsSupported() {
+    return Shader::IsComputeSupported() && (GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect);
+}
+
+void GPUCuller::cleanup() {
+    GLuint buffers[] = { objectBuffer, groupBuffer, sourceCommandBuffer, drawCommandBuffer, drawCountBuffer };
+    for (GLuint buffer : buffers) {
+        if (buffer) glDeleteBuffers(1, &buffer);
+    }
+    objectBuffer = groupBuffer = sourceCommandBuffer = drawCommandBuffer = drawCountBuffer = 0;
+    cullShader.cleanup();
+    hiZ.cleanup();
+    groups.clear();
+    groupModels.clear();
+    trackedMeshes.clear();
+    trackedMaterials.clear();
+    objectCount = 0;
+}
+
+bool GPUCuller::Init() {
+    cleanup();
+    if (!IsSupported()) {
+        std::cerr << "GPU culling needs compute shaders and multi-draw indirect" << std::endl;
+        return false;
+    }
+    
+    compacting = GLEW_VERSION_4_6 || GLEW_ARB_indirect_parameters;
+    if (!cullShader.InitComputeFromFile("shaders/gpu_cull.comp")) {
+        std::cerr << "ERROR::GPU_CULLING:: Failed to build the cull shader" << std::endl;
+        return false;
+    }
+    if (!hiZ.Init()) {
+        std::cerr << "Occlusion culling disabled" << std::endl;
+    }
+    
+    GLuint* buffers[] = { &objectBuffer, &groupBuffer, &sourceCommandBuffer, &drawCommandBuffer, &drawCountBuffer };
+    for (GLuint* buffer : buffers) {
+        glGenBuffers(1, buffer);
+    }
+    
+    std::cout << "GPU culling initialized" << (compacting ? " (compacted draw counts)" : " (zeroed commands)")
+              << std::endl;
+    return true;
+}
+
+bool GPUCuller::meshesChanged(const std::vector<std::unique_ptr<Mesh>>& meshes) const {
+    size_t meshIndex = 0;
+    size_t materialIndex = 0;
+    for (const auto& mesh : meshes) {
+        if (!mesh->isValid() || mesh->isInstanced()) continue;
+        if (meshIndex >= trackedMeshes.size() || trackedMeshes[meshIndex++] != mesh.get()) return true;
+        
+        for (const SubMesh& subMesh : mesh->getSubMeshes()) {
+            if (materialIndex >= trackedMaterials.size() ||
+                trackedMaterials[materialIndex++] != mesh->getMaterial(subMesh.materialIndex)) return true;
+        }
+    }
+    return meshIndex != trackedMeshes.size() || materialIndex != trackedMaterials.size();
+}
+
+void GPUCuller::rebuild(const std::vector<std::unique_ptr<Mesh>>& meshes) {
+    trackedMeshes.clear();
+    trackedMaterials.clear();
+    groups.clear();
+    
+    // One group per run of submeshes with the same material; submeshes are sorted by material
+    struct PendingObject {
+        const Mesh* mesh;
+        const SubMesh* subMesh;
+    };
+    std::vector<std::vector<PendingObject>> groupObjects;
+    for (const auto& mesh : meshes) {
+        if (!mesh->isValid() || mesh->isInstanced()) continue;
+        trackedMeshes.push_back(mesh.get());
+        
+        Material* current = nullptr;
+        for (const SubMesh& subMesh : mesh->getSubMeshes()) {
+            Material* material = mesh->getMaterial(subMesh.materialIndex);
+            trackedMaterials.push_back(material);
+            if (!material || !material->getShader().shaderProgram) continue;
+            
+            if (material != current || groups.empty() || groups.back().mesh != mesh.get()) {
+                DrawGroup group = { mesh.get(), material, 0, 0 };
+                groups.push_back(group);
+                groupObjects.emplace_back();
+                current = material;
+            }
+            PendingObject object = { mesh.get(), &subMesh };
+            groupObjects.back().push_back(object);
+        }
+    }
+    
+    // Ordered by program, then material, like the render queue's sort key
+    std::vector<size_t> order(groups.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        GLuint programA = groups[a].material->getShader().shaderProgram;
+        GLuint programB = groups[b].material->getShader().shaderProgram;
+        if (programA != programB) return programA < programB;
+        return std::less<const Material*>()(groups[a].material, groups[b].material);
+    });
+    
+    std::vector<DrawGroup> sortedGroups;
+    std::vector<CullObject> objects;
+    std::vector<DrawCommand> commands;
+    for (size_t index : order) {
+        DrawGroup group = groups[index];
+        group.firstCommand = static_cast<uint32_t>(objects.size());
+        group.commandCount = static_cast<uint32_t>(groupObjects[index].size());
+        
+        for (const PendingObject& pending : groupObjects[index]) {
+            const SubMesh& subMesh = *pending.subMesh;
+            CullObject object = {};
+            object.boundsMin = glm::vec4(subMesh.bounds.minPoint, 1.0f);
+            object.boundsMax = glm::vec4(subMesh.bounds.maxPoint, 1.0f);
+            object.sphere = glm::vec4(subMesh.sphere.center, subMesh.sphere.radius);
+            object.group = static_cast<uint32_t>(sortedGroups.size());
+            object.lodCount = subMesh.lodCount;
+            for (unsigned int lod = 0; lod < subMesh.lodCount; ++lod) {
+                object.lodErrors[lod] = subMesh.lods[lod].error;
+            }
+            objects.push_back(object);
+            
+            // Unused levels repeat the coarsest one, so every object has a fixed stride
+            for (unsigned int lod = 0; lod < MAX_MESH_LODS; ++lod) {
+                const SubMeshLod& range = subMesh.lods[(std::min)(lod, subMesh.lodCount - 1)];
+                DrawCommand command = { range.indexCount, 1, range.firstIndex, subMesh.baseVertex, 0 };
+                commands.push_back(command);
+            }
+        }
+        sortedGroups.push_back(group);
+    }
+    groups.swap(sortedGroups);
+    objectCount = objects.size();
+    
+    groupModels.assign(groups.size(), CullGroup());
+    for (size_t i = 0; i < groups.size(); ++i) {
+        groupModels[i].firstCommand = groups[i].firstCommand;
+        groupModels[i].commandCount = groups[i].commandCount;
+    }
+    
+    // Empty buffers cannot be bound to a storage block, so every buffer holds at least one element
+    size_t objectBytes = (std::max)(objects.size(), size_t(1)) * sizeof(CullObject);
+    size_t sourceCommandBytes = (std::max)(commands.size(), size_t(1)) * sizeof(DrawCommand);
+    size_t drawCommandBytes = (std::max)(objects.size(), size_t(1)) * sizeof(DrawCommand);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, objectBytes, nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, objects.size() * sizeof(CullObject), objects.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, groupBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (std::max)(groups.size(), size_t(1)) * sizeof(CullGroup), nullptr,
+                 GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sourceCommandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sourceCommandBytes, nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, commands.size() * sizeof(DrawCommand), commands.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawCommandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, drawCommandBytes, nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawCountBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (std::max)(groups.size(), size_t(1)) * sizeof(GLuint), nullptr,
+                 GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    
+    // The old pyramid may show meshes that are gone
+    hiZ.Invalidate();
+}
+
+void GPUCuller::Update(const std::vector<std::unique_ptr<Mesh>>& meshes) {
+    if (!IsInitialized()) return;
+    
+    if (meshesChanged(meshes)) {
+        rebuild(meshes);
+    }
+    if (groups.empty()) return;
+    
+    for (size_t i = 0; i < groups.size(); ++i) {
+        groupModels[i].model = groups[i].mesh->getModelMatrix();
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, groupBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, groupModels.size() * sizeof(CullGroup), groupModels.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GPUCuller::Cull(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float lodScale) {
+    if (!IsInitialized() || objectCount == 0) return;
+    
+    // Counts restart at zero; compaction appends to them
+    std::vector<GLuint> zeroCounts(groups.size(), 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawCountBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, zeroCounts.size() * sizeof(GLuint), zeroCounts.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_OBJECTS_BINDING, objectBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_GROUPS_BINDING, groupBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_SOURCE_COMMANDS_BINDING, sourceCommandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_DRAW_COMMANDS_BINDING, drawCommandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_DRAW_COUNTS_BINDING, drawCountBuffer);
+    
+    cullShader.use();
+    glUniformMatrix4fv(cullShader.getUniformLocation(UNIFORM_VIEW_PROJECTION), 1, GL_FALSE, glm::value_ptr(viewProjection));
+    glUniform1ui(cullShader.getUniformLocation(UNIFORM_OBJECT_COUNT), static_cast<GLuint>(objectCount));
+    glUniform1i(cullShader.getUniformLocation(UNIFORM_COMPACT), compacting);
+    glUniform3fv(cullShader.getUniformLocation(UNIFORM_CAMERA_POSITION), 1, glm::value_ptr(cameraPosition));
+    glUniform1f(cullShader.getUniformLocation(UNIFORM_LOD_SCALE), lodScale);
+    
+    bool useOcclusion = hiZ.IsValid();
+    glUniform1i(cullShader.getUniformLocation(UNIFORM_USE_OCCLUSION), useOcclusion);
+    if (useOcclusion) {
+        glActiveTexture(GL_TEXTURE0 + HIZ_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, hiZ.getTexture());
+        glUniform1i(cullShader.getUniformLocation(UNIFORM_HIZ), HIZ_TEXTURE_UNIT);
+        glUniform1i(cullShader.getUniformLocation(UNIFORM_HIZ_LEVELS), hiZ.getLevelCount());
+        glUniformMatrix4fv(cullShader.getUniformLocation(UNIFORM_HIZ_VIEW_PROJECTION), 1, GL_FALSE,
+                           glm::value_ptr(hiZ.getViewProjection()));
+    }
+    
+    glDispatchCompute((static_cast<GLuint>(objectCount) + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GPUCuller::BindDrawBuffers() const {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawCommandBuffer);
+    if (compacting) {
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, drawCountBuffer);
+    }
+}
+
+void GPUCuller::Draw(size_t group) const {
+    const DrawGroup& drawGroup = groups[group];
+    const void* commandOffset = reinterpret_cast<const void*>(
+        static_cast<uintptr_t>(drawGroup.firstCommand) * sizeof(DrawCommand));
+    if (compacting) {
+        glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, drawGroup.mesh->getIndexType(), commandOffset,
+                                            static_cast<GLintptr>(group * sizeof(GLuint)),
+                                            static_cast<GLsizei>(drawGroup.commandCount), 0);
+    } else {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, drawGroup.mesh->getIndexType(), commandOffset,
+                                    static_cast<GLsizei>(drawGroup.commandCount), 0);
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Shader.hpp"
+#include "Mesh.hpp"
+
+// Hierarchical depth: mip 0 is a copy of the scene depth and every level above keeps the
+// farthest depth of the texels below it, so a few fetches bound the depth behind any rect.
+class HiZPyramid {
+public:
+    HiZPyramid();
+    ~HiZPyramid();
+    
+    bool Init();
+    void cleanup();
+    
+    // Copies the bound draw framebuffer's depth (the default one) and reduces it. Sizes the
+    // pyramid to the viewport; viewProjection is what the depth was rendered with.
+    void Build(int width, int height, const glm::mat4& viewProjection);
+    void Invalidate() { valid = false; }
+    
+    bool IsValid() const { return valid; }
+    GLuint getTexture() const { return pyramid; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getLevelCount() const { return levelCount; }
+    const glm::mat4& getViewProjection() const { return viewProjection; }
+    
+private:
+    GLuint depthCopy;           // Blit target for the scene depth
+    GLuint depthFramebuffer;
+    GLuint pyramid;             // R32F with the full mip chain
+    Shader copyShader;
+    Shader reduceShader;
+    int width, height, levelCount;
+    glm::mat4 viewProjection;
+    bool valid;
+    
+    void allocate(int newWidth, int newHeight);
+};
+
+// GPU-driven submission for plain (non-instanced) meshes. Every submesh is one object with
+// a DrawElementsIndirect command per LOD; each frame gpu_cull.comp tests the objects against
+// the frustum and the previous frame's Hi-Z pyramid, picks each survivor's LOD and compacts
+// its command into the group's (one mesh, one material) range of the indirect buffer,
+// counting them on the GPU. The CPU then issues one multi-draw per group without knowing
+// how many objects survived.
+class GPUCuller {
+public:
+    // One multi-draw: a mesh's submeshes that share a material, as a range of commands
+    struct DrawGroup {
+        const Mesh* mesh;
+        Material* material;
+        uint32_t firstCommand;
+        uint32_t commandCount;
+    };
+    
+    GPUCuller();
+    ~GPUCuller();
+    
+    // Compute shaders and multi-draw indirect; without indirect parameters culled commands
+    // are zeroed in place instead of compacted
+    static bool IsSupported();
+    
+    bool Init();
+    void cleanup();
+    bool IsInitialized() const { return cullShader.shaderProgram != 0; }
+    
+    // Rebuilds the objects and groups when meshes or materials changed, and uploads the
+    // current model matrices
+    void Update(const std::vector<std::unique_ptr<Mesh>>& meshes);
+    
+    // Runs the cull pass for this frame's camera; occlusion uses the pyramid if it is valid.
+    // lodScale is as for SubMesh::selectLod, without the model scale.
+    void Cull(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float lodScale);
+    
+    // Call after the opaque pass with the default framebuffer bound; feeds next frame's Cull
+    void BuildHiZ(int width, int height, const glm::mat4& viewProjection) { hiZ.Build(width, height, viewProjection); }
+    
+    // Groups are sorted by program and material, so walking them in order keeps state changes low
+    const std::vector<DrawGroup>& getGroups() const { return groups; }
+    const glm::mat4& getGroupModel(size_t group) const { return groupModels[group].model; }
+    
+    // Binds the indirect and parameter buffers; call before Draw
+    void BindDrawBuffers() const;
+    // The caller binds the group's program, material, model and VAO
+    void Draw(size_t group) const;
+    
+    size_t getObjectCount() const { return objectCount; }
+    
+private:
+    // std430 mirrors of the gpu_cull.comp blocks
+    struct CullObject {
+        glm::vec4 boundsMin;    // Model-space AABB; w unused
+        glm::vec4 boundsMax;
+        glm::vec4 sphere;       // SubMesh::sphere, center in xyz and radius in w, for LOD selection
+        glm::vec4 lodErrors;    // SubMeshLod::error per level
+        uint32_t group;
+        uint32_t lodCount;
+        uint32_t padding[2];
+    };
+    static_assert(MAX_MESH_LODS == 4, "CullObject::lodErrors holds one vec4 of LOD errors");
+    struct CullGroup {
+        glm::mat4 model;
+        uint32_t firstCommand;
+        uint32_t commandCount;
+        uint32_t padding[2];
+    };
+    struct DrawCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+    
+    GLuint objectBuffer;
+    GLuint groupBuffer;
+    GLuint sourceCommandBuffer;     // MAX_MESH_LODS commands per object, as built
+    GLuint drawCommandBuffer;       // What the multi-draws read
+    GLuint drawCountBuffer;         // Survivors per group
+    Shader cullShader;
+    bool compacting;                // ARB_indirect_parameters present
+    
+    std::vector<DrawGroup> groups;
+    std::vector<CullGroup> groupModels;
+    std::vector<const Mesh*> trackedMeshes;
+    std::vector<const Material*> trackedMaterials;
+    size_t objectCount;
+    HiZPyramid hiZ;
+    
+    bool meshesChanged(const std::vector<std::unique_ptr<Mesh>>& meshes) const;
+    void rebuild(const std::vector<std::unique_ptr<Mesh>>& meshes);
+};
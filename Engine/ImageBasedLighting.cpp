@@ -0,0 +1,338 @@
+#include "ImageBasedLighting.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+    constexpr uint32_t UNIFORM_SOURCE_MAP = HashUniformName("sourceMap");
+    constexpr uint32_t UNIFORM_SOURCE_LOD = HashUniformName("sourceLod");
+    constexpr uint32_t UNIFORM_FACE_SIZE = HashUniformName("faceSize");
+    constexpr uint32_t UNIFORM_ROUGHNESS = HashUniformName("roughness");
+    constexpr uint32_t UNIFORM_SOURCE_TEXEL_SOLID_ANGLE = HashUniformName("sourceTexelSolidAngle");
+    constexpr uint32_t UNIFORM_SAMPLE_COUNT = HashUniformName("sampleCount");
+    
+    // Must match the binding in ibl_irradiance_sh.comp; shared with the GPU culler's object
+    // buffer, which is rebound before every cull dispatch
+    const GLuint IRRADIANCE_SH_BINDING = 3;
+    
+    // Must match local_size_x/y in ibl_prefilter.comp and ibl_brdf_lut.comp
+    const GLuint IBL_GROUP_SIZE = 8;
+    
+    // The SH pass reads the source level nearest this size
+    const int IRRADIANCE_FACE_SIZE = 32;
+    
+    const int PREFILTER_SAMPLE_COUNT = 64;
+    
+    // Sampler of the compute passes; nothing else binds this unit while they run
+    const GLuint SOURCE_TEXTURE_UNIT = 0;
+    
+    const uint32_t BRDF_LUT_MAGIC = 0x4C4C4249u;       // "IBLL"
+    const uint32_t ENVIRONMENT_MAGIC = 0x454C4249u;    // "IBLE"
+    const uint32_t IBL_CACHE_VERSION = 1;
+    
+    struct BRDFLUTHeader {
+        uint32_t magic;
+        uint32_t version;
+        int32_t size;
+        uint32_t padding;
+    };
+    
+    struct EnvironmentHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        int32_t size;
+        int32_t levels;
+    };
+    
+    size_t PrefilterLevelTexels(int level) {
+        size_t size = static_cast<size_t>((std::max)(ImageBasedLighting::PREFILTER_SIZE >> level, 1));
+        return size * size * 6;
+    }
+}
+
+ImageBasedLighting::ImageBasedLighting()
+    : prefilteredMap(0), brdfLUT(0), irradianceBuffer(0), ready(false), bakeStep(-1), bakingVersion(0),
+      bakedVersion(0), bakingKey(0), cachedKey(0) {
+}
+
+ImageBasedLighting::~ImageBasedLighting() {
+    cleanup();
+}
+
+void ImageBasedLighting::cleanup() {
+    if (prefilteredMap) {
+        glDeleteTextures(1, &prefilteredMap);
+        prefilteredMap = 0;
+    }
+    if (brdfLUT) {
+        glDeleteTextures(1, &brdfLUT);
+        brdfLUT = 0;
+    }
+    if (irradianceBuffer) {
+        glDeleteBuffers(1, &irradianceBuffer);
+        irradianceBuffer = 0;
+    }
+    irradianceShader.cleanup();
+    prefilterShader.cleanup();
+    brdfLUTShader.cleanup();
+    ready = false;
+    bakeStep = -1;
+    cachedKey = 0;
+}
+
+bool ImageBasedLighting::Init(const std::string& lutPath, const std::string& environmentPath) {
+    cleanup();
+    lutCachePath = lutPath;
+    environmentCachePath = environmentPath;
+    
+    if (!Shader::IsComputeSupported()) {
+        std::cerr << "Image-based lighting needs compute shaders" << std::endl;
+        return false;
+    }
+    if (!irradianceShader.InitComputeFromFile("shaders/ibl_irradiance_sh.comp") ||
+        !prefilterShader.InitComputeFromFile("shaders/ibl_prefilter.comp") ||
+        !brdfLUTShader.InitComputeFromFile("shaders/ibl_brdf_lut.comp")) {
+        std::cerr << "Failed to initialize IBL bake shaders" << std::endl;
+        cleanup();
+        return false;
+    }
+    
+    glGenTextures(1, &prefilteredMap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, prefilteredMap);
+    glTexStorage2D(GL_TEXTURE_CUBE_MAP, PREFILTER_LEVELS, GL_RGBA16F, PREFILTER_SIZE, PREFILTER_SIZE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, PREFILTER_LEVELS - 1);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    
+    glGenTextures(1, &brdfLUT);
+    glBindTexture(GL_TEXTURE_2D, brdfLUT);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RG16F, BRDF_LUT_SIZE, BRDF_LUT_SIZE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    // Written as a storage buffer by the SH pass and read as the IBLData uniform block
+    IBLDataBlock noIrradiance = {};
+    glGenBuffers(1, &irradianceBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, irradianceBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(IBLDataBlock), &noIrradiance, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, IBL_DATA_BINDING, irradianceBuffer);
+    
+    if (!loadBRDFLUT()) {
+        bakeBRDFLUT();
+        saveBRDFLUT();
+    }
+    
+    std::cout << "Image-based lighting initialized: " << PREFILTER_SIZE << "x" << PREFILTER_SIZE
+              << " prefiltered cubemap, " << PREFILTER_LEVELS << " roughness levels" << std::endl;
+    return true;
+}
+
+void ImageBasedLighting::Update(GLuint source, uint32_t sourceVersion, uint64_t sourceKey) {
+    if (!IsInitialized() || source == 0) return;
+    
+    // A cached bake stands in until the first one of this run is done
+    if (!ready && sourceKey != 0 && loadEnvironment(sourceKey)) {
+        ready = true;
+        cachedKey = sourceKey;
+    }
+    
+    if (bakeStep < 0) {
+        if (ready && sourceVersion == bakedVersion) return;
+        bakeStep = 0;
+        bakingVersion = sourceVersion;
+        bakingKey = sourceKey;
+    }
+    
+    // Nothing to show yet, so the first bake runs in one go; later ones are spread out
+    const int stepCount = 1 + PREFILTER_LEVELS;
+    int steps = ready ? 1 : stepCount - bakeStep;
+    for (int i = 0; i < steps; ++i) {
+        bakeStepFor(source, bakeStep++);
+    }
+    
+    if (bakeStep == stepCount) {
+        bakeStep = -1;
+        bakedVersion = bakingVersion;
+        ready = true;
+        if (bakingKey != 0 && bakingKey != cachedKey && saveEnvironment(bakingKey)) {
+            cachedKey = bakingKey;
+        }
+    }
+}
+
+void ImageBasedLighting::bakeStepFor(GLuint source, int step) {
+    glActiveTexture(GL_TEXTURE0 + SOURCE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, source);
+    GLint sourceSize = 0;
+    glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_WIDTH, &sourceSize);
+    sourceSize = (std::max)(sourceSize, 1);
+    
+    if (step == 0) {
+        int lod = 0;
+        while ((sourceSize >> lod) > IRRADIANCE_FACE_SIZE) {
+            ++lod;
+        }
+        
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, IRRADIANCE_SH_BINDING, irradianceBuffer);
+        irradianceShader.use();
+        glUniform1i(irradianceShader.getUniformLocation(UNIFORM_SOURCE_MAP), SOURCE_TEXTURE_UNIT);
+        glUniform1f(irradianceShader.getUniformLocation(UNIFORM_SOURCE_LOD), static_cast<float>(lod));
+        glUniform1i(irradianceShader.getUniformLocation(UNIFORM_FACE_SIZE), (std::max)(sourceSize >> lod, 1));
+        glDispatchCompute(1, 1, 1);
+        glMemoryBarrier(GL_UNIFORM_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    } else {
+        int level = step - 1;
+        int size = (std::max)(PREFILTER_SIZE >> level, 1);
+        float roughness = static_cast<float>(level) / static_cast<float>(PREFILTER_LEVELS - 1);
+        float texelSolidAngle = 4.0f * 3.14159265f / (6.0f * static_cast<float>(sourceSize) * static_cast<float>(sourceSize));
+        
+        glBindImageTexture(0, prefilteredMap, level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        prefilterShader.use();
+        glUniform1i(prefilterShader.getUniformLocation(UNIFORM_SOURCE_MAP), SOURCE_TEXTURE_UNIT);
+        glUniform1f(prefilterShader.getUniformLocation(UNIFORM_ROUGHNESS), roughness);
+        glUniform1f(prefilterShader.getUniformLocation(UNIFORM_SOURCE_TEXEL_SOLID_ANGLE), texelSolidAngle);
+        glUniform1i(prefilterShader.getUniformLocation(UNIFORM_SAMPLE_COUNT), PREFILTER_SAMPLE_COUNT);
+        GLuint groups = (size + IBL_GROUP_SIZE - 1) / IBL_GROUP_SIZE;
+        glDispatchCompute(groups, groups, 6);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+    }
+    
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+void ImageBasedLighting::bakeBRDFLUT() {
+    glBindImageTexture(0, brdfLUT, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+    brdfLUTShader.use();
+    GLuint groups = (BRDF_LUT_SIZE + IBL_GROUP_SIZE - 1) / IBL_GROUP_SIZE;
+    glDispatchCompute(groups, groups, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+}
+
+bool ImageBasedLighting::loadBRDFLUT() {
+    std::ifstream in(lutCachePath, std::ios::binary);
+    if (!in) return false;
+    
+    BRDFLUTHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != BRDF_LUT_MAGIC || header.version != IBL_CACHE_VERSION || header.size != BRDF_LUT_SIZE) {
+        return false;
+    }
+    
+    std::vector<GLhalf> texels(static_cast<size_t>(BRDF_LUT_SIZE) * BRDF_LUT_SIZE * 2);
+    in.read(reinterpret_cast<char*>(texels.data()), texels.size() * sizeof(GLhalf));
+    if (!in) return false;
+    
+    glBindTexture(GL_TEXTURE_2D, brdfLUT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, BRDF_LUT_SIZE, BRDF_LUT_SIZE, GL_RG, GL_HALF_FLOAT, texels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+bool ImageBasedLighting::saveBRDFLUT() const {
+    std::vector<GLhalf> texels(static_cast<size_t>(BRDF_LUT_SIZE) * BRDF_LUT_SIZE * 2);
+    glBindTexture(GL_TEXTURE_2D, brdfLUT);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_HALF_FLOAT, texels.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    std::ofstream out(lutCachePath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to write BRDF LUT cache: " << lutCachePath << std::endl;
+        return false;
+    }
+    BRDFLUTHeader header = { BRDF_LUT_MAGIC, IBL_CACHE_VERSION, BRDF_LUT_SIZE, 0 };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(texels.data()), texels.size() * sizeof(GLhalf));
+    return static_cast<bool>(out);
+}
+
+bool ImageBasedLighting::loadEnvironment(uint64_t key) {
+    std::ifstream in(environmentCachePath, std::ios::binary);
+    if (!in) return false;
+    
+    EnvironmentHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != ENVIRONMENT_MAGIC || header.version != IBL_CACHE_VERSION || header.key != key ||
+        header.size != PREFILTER_SIZE || header.levels != PREFILTER_LEVELS) {
+        return false;
+    }
+    
+    IBLDataBlock irradiance;
+    in.read(reinterpret_cast<char*>(&irradiance), sizeof(irradiance));
+    std::vector<std::vector<GLhalf>> levels(PREFILTER_LEVELS);
+    for (int level = 0; level < PREFILTER_LEVELS; ++level) {
+        levels[level].resize(PrefilterLevelTexels(level) * 4);
+        in.read(reinterpret_cast<char*>(levels[level].data()), levels[level].size() * sizeof(GLhalf));
+    }
+    if (!in) return false;
+    
+    glBindBuffer(GL_UNIFORM_BUFFER, irradianceBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(irradiance), &irradiance);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    
+    glBindTexture(GL_TEXTURE_CUBE_MAP, prefilteredMap);
+    for (int level = 0; level < PREFILTER_LEVELS; ++level) {
+        int size = (std::max)(PREFILTER_SIZE >> level, 1);
+        size_t faceValues = static_cast<size_t>(size) * size * 4;
+        for (int face = 0; face < 6; ++face) {
+            glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, 0, 0, size, size, GL_RGBA, GL_HALF_FLOAT,
+                            levels[level].data() + face * faceValues);
+        }
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    
+    std::cout << "Loaded image-based lighting from " << environmentCachePath << std::endl;
+    return true;
+}
+
+bool ImageBasedLighting::saveEnvironment(uint64_t key) const {
+    IBLDataBlock irradiance;
+    glBindBuffer(GL_UNIFORM_BUFFER, irradianceBuffer);
+    glGetBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(irradiance), &irradiance);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    
+    std::ofstream out(environmentCachePath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to write IBL cache: " << environmentCachePath << std::endl;
+        return false;
+    }
+    EnvironmentHeader header = { ENVIRONMENT_MAGIC, IBL_CACHE_VERSION, key, PREFILTER_SIZE, PREFILTER_LEVELS };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&irradiance), sizeof(irradiance));
+    
+    // Cube levels read back as their six faces in order
+    glBindTexture(GL_TEXTURE_CUBE_MAP, prefilteredMap);
+    std::vector<GLhalf> texels;
+    for (int level = 0; level < PREFILTER_LEVELS; ++level) {
+        int size = (std::max)(PREFILTER_SIZE >> level, 1);
+        size_t faceValues = static_cast<size_t>(size) * size * 4;
+        texels.resize(faceValues);
+        for (int face = 0; face < 6; ++face) {
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGBA, GL_HALF_FLOAT, texels.data());
+            out.write(reinterpret_cast<const char*>(texels.data()), texels.size() * sizeof(GLhalf));
+        }
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    
+    if (!out) {
+        std::cerr << "Failed while writing IBL cache: " << environmentCachePath << std::endl;
+        return false;
+    }
+    std::cout << "Saved image-based lighting to " << environmentCachePath << std::endl;
+    return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include "Shader.hpp"
+
+// Default cache locations, relative to the working directory like shaders/
+const char* const IBL_BRDF_LUT_CACHE_PATH = "ibl_brdf_lut.bin";
+const char* const IBL_ENVIRONMENT_CACHE_PATH = "ibl_environment.bin";
+
+// CPU mirror of the std140 IBLData block in shaders/ibl.glsl
+struct IBLDataBlock {
+    glm::vec4 irradianceSH[9];
+};
+static_assert(sizeof(IBLDataBlock) == 144, "IBLDataBlock must match the std140 IBLData layout");
+
+// Image-based lighting from a sky cubemap, baked with compute shaders: diffuse irradiance as
+// nine SH coefficients (ibl_irradiance_sh.comp), a specular cubemap prefiltered with one GGX
+// roughness per mip (ibl_prefilter.comp) and the split-sum BRDF LUT (ibl_brdf_lut.comp).
+// The LUT is baked once and cached on disk. The environment is cached on disk per source
+// key, and re-baked one step per frame (the SH, then one mip) whenever the source changes.
+class ImageBasedLighting {
+public:
+    static const int PREFILTER_SIZE = 64;
+    static const int PREFILTER_LEVELS = 6;      // 64 down to 2; roughness 0 to 1 across them
+    static const int BRDF_LUT_SIZE = 128;
+    
+    ImageBasedLighting();
+    ~ImageBasedLighting();
+    
+    // Needs compute shaders; without them IsReady() stays false
+    bool Init(const std::string& lutCachePath = IBL_BRDF_LUT_CACHE_PATH,
+              const std::string& environmentCachePath = IBL_ENVIRONMENT_CACHE_PATH);
+    void cleanup();
+    
+    // source is a mipmapped cubemap. sourceVersion changes whenever its contents change;
+    // sourceKey names what it shows for the disk cache, 0 to not cache it.
+    void Update(GLuint source, uint32_t sourceVersion, uint64_t sourceKey);
+    
+    // True once an environment has been baked or loaded
+    bool IsReady() const { return ready; }
+    bool IsInitialized() const { return prefilteredMap != 0; }
+    
+    // The IBLData block stays bound to IBL_DATA_BINDING; these are for the lit shaders'
+    // environmentMap and brdfLUT samplers
+    GLuint getPrefilteredMap() const { return prefilteredMap; }
+    GLuint getBRDFLUT() const { return brdfLUT; }
+    
+private:
+    GLuint prefilteredMap;      // RGBA16F cubemap, PREFILTER_LEVELS mips
+    GLuint brdfLUT;             // RG16F, BRDF_LUT_SIZE^2
+    GLuint irradianceBuffer;    // IBLDataBlock, written by the SH pass
+    Shader irradianceShader;
+    Shader prefilterShader;
+    Shader brdfLUTShader;
+    std::string lutCachePath;
+    std::string environmentCachePath;
+    
+    bool ready;
+    int bakeStep;               // Next step of the bake in progress, -1 when idle
+    uint32_t bakingVersion;     // Source version the bake in progress started from
+    uint32_t bakedVersion;
+    uint64_t bakingKey;
+    uint64_t cachedKey;         // Environment that is on disk, loaded or saved
+    
+    void bakeBRDFLUT();
+    void bakeStepFor(GLuint source, int step);
+    bool loadBRDFLUT();
+    bool saveBRDFLUT() const;
+    bool loadEnvironment(uint64_t key);
+    bool saveEnvironment(uint64_t key) const;
+};
@@ -0,0 +1,131 @@
+#include "InstanceBuffer.hpp"
+#include <thread>
+#include <algorithm>
+
+namespace {
+    // Below this many instances spawning threads costs more than it saves
+    const size_t PARALLEL_MATRIX_THRESHOLD = 4096;
+}
+
+InstanceBuffer::InstanceBuffer() : vbo(0), capacity(0), visibleCount(0), dirty(true), version(0)
+{
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    Cleanup();
+}
+
+void InstanceBuffer::Cleanup()
+{
+    if (vbo) {
+        glDeleteBuffers(1, &vbo);
+        vbo = 0;
+    }
+    capacity = 0;
+    visibleCount = 0;
+}
+
+void InstanceBuffer::AttachToVertexArray(GLuint vao)
+{
+    if (!vbo) {
+        glGenBuffers(1, &vbo);
+    }
+    
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    
+    // A mat4 attribute occupies four consecutive vec4 slots
+    for (GLuint column = 0; column < 4; ++column) {
+        GLuint location = INSTANCE_MATRIX_ATTRIBUTE + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                              reinterpret_cast<void*>(sizeof(glm::vec4) * column));
+        glVertexAttribDivisor(location, 1);
+    }
+    
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::SetTransforms(const std::vector<Transform>& instanceTransforms)
+{
+    transforms = instanceTransforms;
+    dirty = true;
+    ++version;
+}
+
+void InstanceBuffer::buildMatrices(size_t begin, size_t end)
+{
+    const BoundingSphere localSphere = localBounds.boundingSphere();
+    for (size_t i = begin; i < end; ++i) {
+        matrices[i] = transforms[i].getModelMatrix();
+        instanceSpheres[i] = localSphere.transformed(matrices[i]);
+        instanceBoxes[i] = localBounds.transformed(matrices[i]);
+    }
+}
+
+void InstanceBuffer::UpdateMatrices()
+{
+    if (!dirty) return;
+    
+    const size_t count = transforms.size();
+    matrices.resize(count);
+    instanceSpheres.resize(count);
+    instanceBoxes.resize(count);
+    
+    unsigned int workerCount = std::thread::hardware_concurrency();
+    if (count < PARALLEL_MATRIX_THRESHOLD || workerCount < 2) {
+        buildMatrices(0, count);
+    } else {
+        // Contiguous chunks, one per hardware thread; the calling thread takes the last one
+        size_t chunk = (count + workerCount - 1) / workerCount;
+        std::vector<std::thread> workers;
+        workers.reserve(workerCount - 1);
+        for (unsigned int w = 0; w + 1 < workerCount; ++w) {
+            size_t begin = w * chunk;
+            size_t end = std::min(count, begin + chunk);
+            if (begin >= end) break;
+            workers.emplace_back(&InstanceBuffer::buildMatrices, this, begin, end);
+        }
+        buildMatrices(std::min(count, (workerCount - 1) * chunk), count);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    
+    dirty = false;
+}
+
+GLsizei InstanceBuffer::UploadVisible(const glm::mat4& meshModel, const Frustum& frustum)
+{
+    UpdateMatrices();
+    
+    const size_t count = matrices.size();
+    culler.Clear();
+    for (size_t i = 0; i < count; ++i) {
+        culler.Add(instanceSpheres[i].transformed(meshModel), instanceBoxes[i].transformed(meshModel));
+    }
+    culler.Cull(frustum);
+    
+    visibleMatrices.clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (culler.IsVisible(static_cast<uint32_t>(i))) {
+            visibleMatrices.push_back(matrices[i]);
+        }
+    }
+    visibleCount = static_cast<GLsizei>(visibleMatrices.size());
+    if (visibleCount == 0 || !vbo) return visibleCount;
+    
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    size_t bytes = visibleMatrices.size() * sizeof(glm::mat4);
+    if (bytes > capacity) {
+        capacity = std::max(bytes, capacity * 2);
+    }
+    // Re-specifying the store orphans last frame's copy so the upload doesn't wait on its draws
+    glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, visibleMatrices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    return visibleCount;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "Transform.hpp"
+#include "Bounds.hpp"
+#include "Frustum.hpp"
+
+// First of the four consecutive vec4 attribute slots that carry the per-instance
+// model matrix (location 8..11 in the mesh vertex shaders).
+const GLuint INSTANCE_MATRIX_ATTRIBUTE = 8;
+
+// Per-instance transforms for one Mesh, fed to the vertex shader as an
+// instanced mat4 attribute. Matrices are rebuilt in a batch only when the
+// transforms change; each frame the instances are culled and the visible
+// matrices are packed and uploaded for a single instanced draw.
+class InstanceBuffer {
+private:
+    std::vector<Transform> transforms;
+    std::vector<glm::mat4> matrices;
+    std::vector<BoundingSphere> instanceSpheres;
+    std::vector<AABB> instanceBoxes;
+    std::vector<glm::mat4> visibleMatrices;
+    FrustumCuller culler;
+    
+    AABB localBounds;
+    GLuint vbo;
+    size_t capacity;
+    GLsizei visibleCount;
+    bool dirty;
+    uint32_t version;
+    
+    void buildMatrices(size_t begin, size_t end);
+    
+public:
+    InstanceBuffer();
+    ~InstanceBuffer();
+    
+    void Cleanup();
+    
+    // Adds the instance matrix attributes to a mesh VAO
+    void AttachToVertexArray(GLuint vao);
+    
+    void SetTransforms(const std::vector<Transform>& instanceTransforms);
+    // Returns the transforms for editing; matrices are rebuilt on the next update
+    std::vector<Transform>& EditTransforms() { dirty = true; ++version; return transforms; }
+    const std::vector<Transform>& GetTransforms() const { return transforms; }
+    
+    void SetLocalBounds(const AABB& bounds) { localBounds = bounds; dirty = true; ++version; }
+    
+    // Changes whenever the transforms or bounds may have, so cached passes can tell they moved
+    uint32_t GetVersion() const { return version; }
+    
+    // Rebuilds dirty matrices, split across threads for large instance counts
+    void UpdateMatrices();
+    
+    // Culls instances (placed by meshModel) against the frustum and uploads the visible ones
+    GLsizei UploadVisible(const glm::mat4& meshModel, const Frustum& frustum);
+    
+    GLsizei GetVisibleCount() const { return visibleCount; }
+    size_t GetInstanceCount() const { return transforms.size(); }
+};
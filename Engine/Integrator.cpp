@@ -1,8 +1,14 @@
 #include "Integrator.hpp"
+#include "TileRenderer.hpp"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <functional>
+#include <iostream>
 #include <limits>
 #include <random>
+#include <thread>
 #include <corecrt_math_defines.h>
 
 // Forward declarations for missing functions
@@ -10,7 +16,8 @@ Spectrum SurfaceInteraction::ComputeScatteringFunctions(const Ray& ray) {
     // Simplified implementation - compute material BSDF
     if (material) {
         // This would normally setup the BSDF based on material properties
-        bsdf = std::make_unique<LambertianReflection>(Spectrum::FromRGB(glm::vec3(0.7f)));
+        static const Spectrum DEFAULT_ALBEDO = Spectrum::FromRGB(glm::vec3(0.7f));
+        bsdf = std::make_unique<LambertianReflection>(DEFAULT_ALBEDO);
     }
     return Spectrum(0.0f);
 }
@@ -45,26 +52,121 @@ Spectrum Scene::SampleVolumeScattering(const Ray& ray, VolumeInteraction* vi, co
     return Spectrum(0.0f);
 }
 
+void Scene::IntersectN(const RayStream& rays, SurfaceInteraction* isects, uint8_t* hits) const {
+    for (size_t i = 0; i < rays.Size(); ++i) {
+        hits[i] = Intersect(rays.Get(i), &isects[i]) ? 1 : 0;
+    }
+}
+
+void Scene::OccludedN(const RayStream& rays, uint8_t* occluded) const {
+    for (size_t i = 0; i < rays.Size(); ++i) {
+        occluded[i] = IntersectP(rays.Get(i)) ? 1 : 0;
+    }
+}
+
 // Missing function implementations
-Spectrum EstimateDirectVolume(const VolumeInteraction& vi, const Scene& scene, std::mt19937& rng) {
+Spectrum EstimateDirectVolume(const VolumeInteraction& vi, const Scene& scene, Sampler& sampler) {
     // Simplified direct volume lighting
     return Spectrum(0.1f); // Ambient scattering
 }
 
+namespace {
+    // What differs between full-spectrum and hero-wavelength paths. Keyed on the mode rather
+    // than the spectrum type, which is the same for both in a 4-sample build.
+    template <bool HeroWavelengths> struct PathSpectra;
+    
+    template <> struct PathSpectra<false> {
+        using Type = Spectrum;
+        static const Spectrum& AtPath(const Spectrum& s, const SampledWavelengths&) { return s; }
+        static Spectrum SampleBSDF(const BRDF& bsdf, const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u,
+                                   float* pdf, const SampledWavelengths&) {
+            return bsdf.Sample_f(wo, wi, u, pdf);
+        }
+        static float RouletteWeight(const Spectrum& beta) { return beta.luminance(); }
+        static Spectrum Resolve(const Spectrum& L, const SampledWavelengths&) { return L; }
+    };
+    
+    template <> struct PathSpectra<true> {
+        using Type = HeroSpectrum;
+        static HeroSpectrum AtPath(const Spectrum& s, const SampledWavelengths& wavelengths) { return s.sample(wavelengths); }
+        static HeroSpectrum SampleBSDF(const BRDF& bsdf, const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u,
+                                       float* pdf, const SampledWavelengths& wavelengths) {
+            return bsdf.Sample_fHero(wo, wi, u, pdf, wavelengths);
+        }
+        // The samples are values at arbitrary wavelengths, which luminance() cannot weight
+        static float RouletteWeight(const HeroSpectrum& beta) { return beta.average(); }
+        static Spectrum Resolve(const HeroSpectrum& L, const SampledWavelengths& wavelengths) { return wavelengths.ToSpectrum(L); }
+    };
+    
+    // The BRDFs work in a frame with z along the shading normal
+    struct ShadingFrame {
+        glm::vec3 s, t, n;
+        
+        explicit ShadingFrame(const glm::vec3& normal) : n(normal) { SpectralUtils::CoordinateSystem(normal, &s, &t); }
+        glm::vec3 ToLocal(const glm::vec3& v) const { return glm::vec3(glm::dot(v, s), glm::dot(v, t), glm::dot(v, n)); }
+        glm::vec3 ToWorld(const glm::vec3& v) const { return v.x * s + v.y * t + v.z * n; }
+    };
+    
+    // One light sample's contribution at it if nothing is in the way, and the shadow ray that
+    // decides that; false when there is nothing to trace
+    bool SampleDirectLight(const SurfaceInteraction& it, const Scene& scene, const glm::vec2& uLight,
+                           Ray* shadowRay, Spectrum* contribution) {
+        LightSample lightSample;
+        Spectrum Li = scene.SampleLight(uLight, &lightSample);
+        if (lightSample.pdf <= 0.0f || Li.isBlack()) return false;
+        
+        // Point and spot lights leave wi to the receiver and fall off with distance
+        glm::vec3 wi = lightSample.wi;
+        float distance2 = 1.0f;
+        if (wi == glm::vec3(0.0f)) {
+            glm::vec3 toLight = lightSample.p - it.p;
+            distance2 = glm::dot(toLight, toLight);
+            if (distance2 <= 0.0f) return false;
+            wi = toLight / std::sqrt(distance2);
+        }
+        
+        float cosTheta = glm::dot(wi, it.n);
+        if (cosTheta <= 0.0f) return false;
+        
+        ShadingFrame frame(it.n);
+        Spectrum f = it.bsdf->f(frame.ToLocal(it.wo), frame.ToLocal(wi));
+        *contribution = f * Li * (cosTheta / (lightSample.pdf * distance2));
+        *shadowRay = it.SpawnRayTo(lightSample.p);
+        return true;
+    }
+}
+
 // PathIntegrator implementation
-PathIntegrator::PathIntegrator(int maxDepth, float rrThreshold) 
-    : maxDepth(maxDepth), rrThreshold(rrThreshold) {
+PathIntegrator::PathIntegrator(int maxDepth, float rrThreshold, SpectralMode spectralMode) 
+    : maxDepth(maxDepth), rrThreshold(rrThreshold), spectralMode(spectralMode) {
 }
 
-Spectrum PathIntegrator::Li(const Ray& ray, const Scene& scene, std::mt19937& rng, int depth) const {
-    Spectrum L(0.0f);
-    Spectrum beta(1.0f); // Path throughput
+Spectrum PathIntegrator::Li(const Ray& ray, const Scene& scene, Sampler& sampler, int depth) const {
+    if (spectralMode == SpectralMode::HeroWavelength) {
+        return TracePath<true>(ray, scene, sampler);
+    }
+    return TracePath<false>(ray, scene, sampler);
+}
+
+template <bool HeroWavelengths>
+Spectrum PathIntegrator::TracePath(const Ray& ray, const Scene& scene, Sampler& sampler) const {
+    using Path = PathSpectra<HeroWavelengths>;
+    
+    // One set of wavelengths for the whole path, drawn per camera ray
+    SampledWavelengths wavelengths = {};
+    if (HeroWavelengths) {
+        wavelengths = SampledWavelengths::SampleUniform(sampler.Get1D());
+    }
+    
+    typename Path::Type L(0.0f);
+    typename Path::Type beta(1.0f); // Path throughput
     Ray currentRay = ray;
     bool specularBounce = false;
     
     for (int bounces = 0; ; ++bounces) {
         // Intersect ray with scene
         SurfaceInteraction isect;
+        isect.wavelengths = HeroWavelengths ? &wavelengths : nullptr;
         bool foundIntersection = scene.Intersect(currentRay, &isect);
         
         // Skip volume scattering for simplified implementation
@@ -73,7 +175,7 @@ Spectrum PathIntegrator::Li(const Ray& ray, const Scene& scene, std::mt19937& rn
         if (!foundIntersection) {
             // Hit environment light - simplified
             if (bounces == 0 || specularBounce) {
-                L += beta * Spectrum(0.1f); // Simple environment light
+                L.addScaled(beta, 0.1f); // Simple environment light
             }
             break;
         }
@@ -88,23 +190,21 @@ Spectrum PathIntegrator::Li(const Ray& ray, const Scene& scene, std::mt19937& rn
         
         // Sample illumination from lights to find path contribution
         // Simplified - no surface emission for now
-        L += beta * EstimateDirect(isect, 
-            glm::vec2(std::uniform_real_distribution<float>(0, 1)(rng),
-                     std::uniform_real_distribution<float>(0, 1)(rng)),
-            glm::vec2(std::uniform_real_distribution<float>(0, 1)(rng),
-                     std::uniform_real_distribution<float>(0, 1)(rng)),
-            scene, rng);
+        // Dimensions are drawn in a fixed order per bounce, so low-discrepancy samplers line
+        // up the same decision across samples
+        glm::vec2 uLight = sampler.Get2D();
+        glm::vec2 uBSDF = sampler.Get2D();
+        L.addProduct(beta, Path::AtPath(EstimateDirect(isect, uLight, uBSDF, scene, sampler), wavelengths));
         
         // Sample BSDF to get new path direction
         glm::vec3 wo = -currentRay.direction, wi;
         float pdf;
-        glm::vec2 u(std::uniform_real_distribution<float>(0, 1)(rng),
-                   std::uniform_real_distribution<float>(0, 1)(rng));
+        glm::vec2 u = sampler.Get2D();
         
-        Spectrum f = isect.bsdf->Sample_f(wo, &wi, u, &pdf);
+        typename Path::Type f = Path::SampleBSDF(*isect.bsdf, wo, &wi, u, &pdf, wavelengths);
         if (f.isBlack() || pdf == 0.0f) break;
         
-        beta *= f * std::abs(glm::dot(wi, isect.n)) / pdf;
+        beta.mulScaled(f, std::abs(glm::dot(wi, isect.n)) / pdf);
         specularBounce = false; // Simplified - assume no delta functions
         currentRay = isect.SpawnRay(wi);
         
@@ -113,26 +213,181 @@ Spectrum PathIntegrator::Li(const Ray& ray, const Scene& scene, std::mt19937& rn
         
         // Russian roulette termination
         if (bounces > 3) {
-            float q = std::max(0.05f, 1.0f - beta.luminance());
-            if (std::uniform_real_distribution<float>(0, 1)(rng) < q) break;
+            float q = std::max(0.05f, 1.0f - Path::RouletteWeight(beta));
+            if (sampler.Get1D() < q) break;
             beta /= (1.0f - q);
         }
         
         if (bounces >= maxDepth) break;
     }
     
-    return L;
+    return Path::Resolve(L, wavelengths);
 }
 
 Spectrum PathIntegrator::EstimateDirect(const SurfaceInteraction& it, const glm::vec2& uLight,
-                                       const glm::vec2& uBSDF, const Scene& scene, std::mt19937& rng) const {
-    // Simplified direct lighting - just return ambient
-    return Spectrum(0.1f);
+                                       const glm::vec2& uBSDF, const Scene& scene, Sampler& sampler) const {
+    // The engine's lights are all delta lights, so there is no BSDF sample to weigh against
+    Ray shadowRay;
+    Spectrum direct;
+    if (!SampleDirectLight(it, scene, uLight, &shadowRay, &direct) || scene.IntersectP(shadowRay)) {
+        return Spectrum(0.0f);
+    }
+    return direct;
+}
+
+void PathIntegrator::LiN(const Ray* rays, const PathSamplePosition* positions, int count, const Scene& scene,
+                         Sampler& sampler, Spectrum* L) const {
+    if (spectralMode == SpectralMode::HeroWavelength) {
+        TracePaths<true>(rays, positions, count, scene, sampler, L);
+    } else {
+        TracePaths<false>(rays, positions, count, scene, sampler, L);
+    }
+}
+
+template <bool HeroWavelengths>
+void PathIntegrator::TracePaths(const Ray* rays, const PathSamplePosition* positions, int count, const Scene& scene,
+                                Sampler& sampler, Spectrum* L) const {
+    using Path = PathSpectra<HeroWavelengths>;
+    
+    // TracePath's locals, kept per path between stages. Each stage resumes the sampler where
+    // the path left it, so dimensions are drawn in the same order as in TracePath.
+    struct PathState {
+        PathSamplePosition position;
+        SampledWavelengths wavelengths;
+        typename Path::Type L;
+        typename Path::Type beta;
+        int bounces;
+    };
+    
+    std::vector<PathState> paths;
+    paths.reserve(count);
+    RayStream stream;
+    std::vector<int> live;
+    for (int i = 0; i < count; ++i) {
+        PathState path = { positions[i], SampledWavelengths(), typename Path::Type(0.0f), typename Path::Type(1.0f), 0 };
+        if (HeroWavelengths) {
+            sampler.StartPixelSample(path.position.pixel, path.position.sampleIndex, path.position.dimension);
+            path.wavelengths = SampledWavelengths::SampleUniform(sampler.Get1D());
+            path.position.dimension = sampler.GetDimension();
+        }
+        paths.push_back(path);
+        stream.Push(rays[i]);
+        live.push_back(i);
+    }
+    
+    std::vector<SurfaceInteraction> isects;
+    std::vector<uint8_t> hits;
+    RayStream nextStream;
+    std::vector<int> nextLive;
+    
+    // Shadow rays queued by the shade stage, with what each adds to its path if unoccluded
+    RayStream shadowStream;
+    std::vector<int> shadowPaths;
+    std::vector<typename Path::Type> shadowBeta;
+    std::vector<typename Path::Type> shadowLight;
+    std::vector<uint8_t> occluded;
+    
+    while (!live.empty()) {
+        // Intersect
+        isects.clear();
+        isects.resize(live.size());
+        for (size_t k = 0; k < live.size(); ++k) {
+            isects[k].wavelengths = HeroWavelengths ? &paths[live[k]].wavelengths : nullptr;
+        }
+        hits.assign(live.size(), 0);
+        scene.IntersectN(stream, isects.data(), hits.data());
+        
+        // Shade: direct light becomes a shadow ray, the BSDF sample the path's next ray
+        nextStream.Clear();
+        nextLive.clear();
+        shadowStream.Clear();
+        shadowPaths.clear();
+        shadowBeta.clear();
+        shadowLight.clear();
+        
+        for (size_t k = 0; k < live.size(); ++k) {
+            PathState& path = paths[live[k]];
+            Ray ray = stream.Get(k);
+            
+            // No delta BSDFs yet, so only camera rays see the environment, as in TracePath
+            if (!hits[k]) {
+                if (path.bounces == 0) {
+                    path.L.addScaled(path.beta, 0.1f);
+                }
+                continue;
+            }
+            
+            SurfaceInteraction& isect = isects[k];
+            isect.ComputeScatteringFunctions(ray);
+            if (!isect.bsdf) {
+                nextStream.Push(isect.SpawnRay(ray.direction));
+                nextLive.push_back(live[k]);
+                continue;
+            }
+            
+            sampler.StartPixelSample(path.position.pixel, path.position.sampleIndex, path.position.dimension);
+            glm::vec2 uLight = sampler.Get2D();
+            glm::vec2 uBSDF = sampler.Get2D();
+            
+            Ray shadowRay;
+            Spectrum direct;
+            if (SampleDirectLight(isect, scene, uLight, &shadowRay, &direct)) {
+                shadowStream.Push(shadowRay);
+                shadowPaths.push_back(live[k]);
+                shadowBeta.push_back(path.beta);
+                shadowLight.push_back(Path::AtPath(direct, path.wavelengths));
+            }
+            
+            glm::vec3 wo = -ray.direction, wi;
+            float pdf;
+            glm::vec2 u = sampler.Get2D();
+            typename Path::Type f = Path::SampleBSDF(*isect.bsdf, wo, &wi, u, &pdf, path.wavelengths);
+            
+            bool terminated = f.isBlack() || pdf == 0.0f;
+            if (!terminated) {
+                path.beta.mulScaled(f, std::abs(glm::dot(wi, isect.n)) / pdf);
+                if (path.bounces > 3) {
+                    float q = std::max(0.05f, 1.0f - Path::RouletteWeight(path.beta));
+                    if (sampler.Get1D() < q) {
+                        terminated = true;
+                    } else {
+                        path.beta /= (1.0f - q);
+                    }
+                }
+                terminated = terminated || path.bounces >= maxDepth;
+            }
+            path.position.dimension = sampler.GetDimension();
+            
+            if (!terminated) {
+                ++path.bounces;
+                nextStream.Push(isect.SpawnRay(wi));
+                nextLive.push_back(live[k]);
+            }
+        }
+        
+        // Shadow
+        if (shadowStream.Size() > 0) {
+            occluded.assign(shadowStream.Size(), 0);
+            scene.OccludedN(shadowStream, occluded.data());
+            for (size_t j = 0; j < shadowPaths.size(); ++j) {
+                if (!occluded[j]) {
+                    paths[shadowPaths[j]].L.addProduct(shadowBeta[j], shadowLight[j]);
+                }
+            }
+        }
+        
+        std::swap(stream, nextStream);
+        std::swap(live, nextLive);
+    }
+    
+    for (int i = 0; i < count; ++i) {
+        L[i] = Path::Resolve(paths[i].L, paths[i].wavelengths);
+    }
 }
 
 Ray PathIntegrator::GenerateCameraRay(int x, int y, int width, int height,
                                      const glm::mat4& cameraToWorld, float fov,
-                                     const glm::vec2& sample) const {
+                                     const glm::vec2& sample) {
     // Compute raster and camera sample positions
     glm::vec2 pFilm(x + sample.x, y + sample.y);
     glm::vec2 pCamera = glm::vec2(2.0f * pFilm.x / width - 1.0f,
@@ -157,43 +412,371 @@ Ray PathIntegrator::GenerateCameraRay(int x, int y, int width, int height,
 
 void PathIntegrator::RenderTile(int startX, int startY, int endX, int endY,
                                const Scene& scene, float* pixels, int width, int height,
-                               const glm::mat4& cameraToWorld, float fov) const {
+                               const glm::mat4& cameraToWorld, float fov,
+                               int samplesPerPixel, uint32_t seed) const {
+    TileRenderer::Settings settings;
+    settings.width = width;
+    settings.height = height;
+    settings.cameraToWorld = cameraToWorld;
+    settings.fov = fov;
+    settings.samplesPerPixel = samplesPerPixel;
+    settings.seed = seed;
+    
+    TileRenderer::Tile tile = { startX, startY, endX, endY, static_cast<uint32_t>(startY * width + startX) };
+    TileRenderer::RenderPathTile(tile, *this, scene, settings, pixels);
+}
+
+// MetropolisIntegrator implementation
+namespace {
+    // Bootstrap paths claimed per work unit
+    const int BOOTSTRAP_BATCH_SIZE = 256;
+    
+    // The chains' target density: luminance, which the splats divide back out
+    float ContributionWeight(const glm::vec3& rgb) {
+        return std::max(0.0f, glm::dot(rgb, glm::vec3(0.2126f, 0.7152f, 0.0722f)));
+    }
+}
+
+MetropolisIntegrator::MetropolisIntegrator(int maxDepth, float largeStepProbability, int chainCount,
+                                           int bootstrapSamples, float sigma, unsigned threadCount, uint32_t seed)
+    : maxDepth(maxDepth), largeStepProbability(largeStepProbability), chainCount(chainCount),
+      bootstrapSamples(bootstrapSamples), sigma(sigma), threadCount(threadCount), seed(seed) {
+}
+
+glm::vec3 MetropolisIntegrator::EvaluatePath(const Scene& scene, const PathIntegrator& paths, const FilmView& film,
+                                             MLTSampler& sampler, glm::ivec2* pixel) const {
+    // The first two dimensions place the sample on the film
+    glm::vec2 u = sampler.Get2D();
+    glm::vec2 pFilm(u.x * film.width, u.y * film.height);
+    pixel->x = std::min(static_cast<int>(pFilm.x), film.width - 1);
+    pixel->y = std::min(static_cast<int>(pFilm.y), film.height - 1);
+    
+    Ray ray = PathIntegrator::GenerateCameraRay(pixel->x, pixel->y, film.width, film.height,
+                                                film.cameraToWorld, film.fov, pFilm - glm::vec2(*pixel));
+    glm::vec3 rgb = paths.Li(ray, scene, sampler).toRGB();
+    
+    // A NaN would leave its chain stuck
+    if (!std::isfinite(rgb.x) || !std::isfinite(rgb.y) || !std::isfinite(rgb.z)) return glm::vec3(0.0f);
+    return rgb;
+}
+
+void MetropolisIntegrator::RunChain(const Scene& scene, const PathIntegrator& paths, const FilmView& film, int chain,
+                                    const std::vector<float>& bootstrapCdf, int64_t mutations,
+                                    std::vector<glm::vec3>& splats) const {
+    PCG32 rng(static_cast<uint64_t>(chain), seed);
+    
+    // Start on a bootstrap path picked in proportion to its contribution; its sampler stream
+    // replays it exactly
+    int bootstrapCount = static_cast<int>(bootstrapCdf.size()) - 1;
+    float u = rng.NextFloat();
+    int index = static_cast<int>(std::upper_bound(bootstrapCdf.begin(), bootstrapCdf.end(), u) - bootstrapCdf.begin()) - 1;
+    index = std::max(0, std::min(index, bootstrapCount - 1));
     
-    std::mt19937 rng(std::random_device{}());
+    MLTSampler sampler(static_cast<uint64_t>(index), sigma, largeStepProbability, seed);
+    glm::ivec2 currentPixel;
+    glm::vec3 current = EvaluatePath(scene, paths, film, sampler, &currentPixel);
+    float currentWeight = ContributionWeight(current);
+    sampler.Reseed(static_cast<uint64_t>(bootstrapCount) + chain);
     
-    for (int y = startY; y < endY; ++y) {
-        for (int x = startX; x < endX; ++x) {
-            Spectrum L(0.0f);
+    for (int64_t mutation = 0; mutation < mutations; ++mutation) {
+        sampler.StartIteration();
+        glm::ivec2 proposedPixel;
+        glm::vec3 proposed = EvaluatePath(scene, paths, film, sampler, &proposedPixel);
+        float proposedWeight = ContributionWeight(proposed);
+        float accept = currentWeight > 0.0f ? std::min(1.0f, proposedWeight / currentWeight) : 1.0f;
+        
+        // Expected-value splatting: both states get their share whichever one the chain keeps
+        if (accept > 0.0f && proposedWeight > 0.0f) {
+            splats[proposedPixel.y * film.width + proposedPixel.x] += proposed * (accept / proposedWeight);
+        }
+        if (accept < 1.0f && currentWeight > 0.0f) {
+            splats[currentPixel.y * film.width + currentPixel.x] += current * ((1.0f - accept) / currentWeight);
+        }
+        
+        if (rng.NextFloat() < accept) {
+            currentPixel = proposedPixel;
+            current = proposed;
+            currentWeight = proposedWeight;
+            sampler.Accept();
+        } else {
+            sampler.Reject();
+        }
+    }
+}
+
+void MetropolisIntegrator::Render(const Scene& scene, float* pixels, int width, int height,
+                                  const glm::mat4& cameraToWorld, float fov, int numSamples) const {
+    if (width <= 0 || height <= 0) return;
+    size_t pixelCount = static_cast<size_t>(width) * height;
+    std::fill(pixels, pixels + pixelCount * 3, 0.0f);
+    if (numSamples <= 0) return;
+    
+    auto startTime = std::chrono::steady_clock::now();
+    PathIntegrator paths(maxDepth);
+    FilmView film = { width, height, cameraToWorld, fov };
+    unsigned threads = threadCount != 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+    
+    auto runOnThreads = [](unsigned count, const std::function<void(unsigned)>& work) {
+        std::vector<std::thread> workers;
+        for (unsigned i = 1; i < count; ++i) {
+            workers.emplace_back(work, i);
+        }
+        work(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    };
+    
+    // Bootstrap: independent paths, each reproducible later from its index alone
+    int bootstrapCount = std::max(1, bootstrapSamples);
+    std::vector<float> bootstrapWeights(bootstrapCount);
+    std::atomic<int> nextBootstrap(0);
+    runOnThreads(std::min(threads, static_cast<unsigned>((bootstrapCount + BOOTSTRAP_BATCH_SIZE - 1) / BOOTSTRAP_BATCH_SIZE)),
+                 [&](unsigned) {
+        for (int begin = nextBootstrap.fetch_add(BOOTSTRAP_BATCH_SIZE); begin < bootstrapCount;
+             begin = nextBootstrap.fetch_add(BOOTSTRAP_BATCH_SIZE)) {
+            int end = std::min(begin + BOOTSTRAP_BATCH_SIZE, bootstrapCount);
+            for (int i = begin; i < end; ++i) {
+                MLTSampler sampler(static_cast<uint64_t>(i), sigma, largeStepProbability, seed);
+                glm::ivec2 pixel;
+                bootstrapWeights[i] = ContributionWeight(EvaluatePath(scene, paths, film, sampler, &pixel));
+            }
+        }
+    });
+    
+    std::vector<float> bootstrapCdf(bootstrapCount + 1, 0.0f);
+    double weightSum = 0.0;
+    for (int i = 0; i < bootstrapCount; ++i) {
+        weightSum += bootstrapWeights[i];
+    }
+    if (weightSum <= 0.0) {
+        std::cout << "MLT: bootstrap found no light; the image is black" << std::endl;
+        return;
+    }
+    double running = 0.0;
+    for (int i = 0; i < bootstrapCount; ++i) {
+        running += bootstrapWeights[i];
+        bootstrapCdf[i + 1] = static_cast<float>(running / weightSum);
+    }
+    float brightness = static_cast<float>(weightSum / bootstrapCount);
+    
+    // Chains are striped across threads, so each film sees a fixed set of chains
+    int64_t totalMutations = static_cast<int64_t>(numSamples) * static_cast<int64_t>(pixelCount);
+    int chains = static_cast<int>(std::max<int64_t>(1, std::min<int64_t>(chainCount, totalMutations)));
+    threads = std::min(threads, static_cast<unsigned>(chains));
+    std::vector<std::vector<glm::vec3>> films(threads, std::vector<glm::vec3>(pixelCount, glm::vec3(0.0f)));
+    
+    runOnThreads(threads, [&](unsigned thread) {
+        for (int chain = static_cast<int>(thread); chain < chains; chain += static_cast<int>(threads)) {
+            int64_t mutations = totalMutations * (chain + 1) / chains - totalMutations * chain / chains;
+            RunChain(scene, paths, film, chain, bootstrapCdf, mutations, films[thread]);
+        }
+    });
+    
+    // Each splat carries L / weight, so the splat density times the mean weight is the image
+    float scale = brightness / static_cast<float>(numSamples);
+    for (size_t i = 0; i < pixelCount; ++i) {
+        glm::vec3 rgb(0.0f);
+        for (const auto& threadFilm : films) {
+            rgb += threadFilm[i];
+        }
+        rgb = glm::max(rgb * scale, glm::vec3(0.0f));
+        
+        // Reinhard tone mapping, then gamma correction, as TileRenderer does
+        rgb = rgb / (rgb + glm::vec3(1.0f));
+        pixels[i * 3 + 0] = glm::clamp(std::pow(rgb.r, 1.0f / 2.2f), 0.0f, 1.0f);
+        pixels[i * 3 + 1] = glm::clamp(std::pow(rgb.g, 1.0f / 2.2f), 0.0f, 1.0f);
+        pixels[i * 3 + 2] = glm::clamp(std::pow(rgb.b, 1.0f / 2.2f), 0.0f, 1.0f);
+    }
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "MLT: " << chains << " chains on " << threads << " threads, " << totalMutations
+              << " mutations in " << seconds << " s" << std::endl;
+}
+
+// PhotonMappingIntegrator implementation
+namespace {
+    // Photons per work unit; small enough to balance threads, large enough to amortise the claim
+    const int PHOTON_BATCH_SIZE = 4096;
+}
+
+PhotonMappingIntegrator::PhotonMappingIntegrator(int nPhotons, int maxDepth, float searchRadius,
+                                                 int gatherPhotons, unsigned threadCount)
+    : nPhotons(nPhotons), maxDepth(maxDepth), searchRadius(searchRadius), gatherPhotons(gatherPhotons),
+      threadCount(threadCount) {
+}
+
+void PhotonMappingIntegrator::Preprocess(const Scene& scene) {
+    globalMap.Clear();
+    causticMap.Clear();
+    if (nPhotons <= 0) return;
+    
+    auto startTime = std::chrono::steady_clock::now();
+    
+    int batchCount = (nPhotons + PHOTON_BATCH_SIZE - 1) / PHOTON_BATCH_SIZE;
+    std::vector<PhotonBatch> batches(batchCount);
+    
+    unsigned threads = threadCount != 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, static_cast<unsigned>(batchCount));
+    
+    // Photon i is sample i of one Sobol "pixel", so emission is stratified across the whole set
+    std::unique_ptr<Sampler> prototype = Sampler::Create(Sampler::Type::Sobol, nPhotons);
+    std::atomic<int> nextBatch(0);
+    auto worker = [&]() {
+        std::unique_ptr<Sampler> sampler = prototype->Clone();
+        for (int batch = nextBatch++; batch < batchCount; batch = nextBatch++) {
+            int first = batch * PHOTON_BATCH_SIZE;
+            TracePhotons(scene, first, std::min(PHOTON_BATCH_SIZE, nPhotons - first), *sampler, batches[batch]);
+        }
+    };
+    
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    
+    size_t globalCount = 0, causticCount = 0;
+    for (const PhotonBatch& batch : batches) {
+        globalCount += batch.global.size();
+        causticCount += batch.caustic.size();
+    }
+    std::vector<PhotonMap::Photon> globalPhotons, causticPhotons;
+    globalPhotons.reserve(globalCount);
+    causticPhotons.reserve(causticCount);
+    for (PhotonBatch& batch : batches) {
+        globalPhotons.insert(globalPhotons.end(), batch.global.begin(), batch.global.end());
+        causticPhotons.insert(causticPhotons.end(), batch.caustic.begin(), batch.caustic.end());
+        batch = PhotonBatch();
+    }
+    
+    // Every emitted path counts, stored or not
+    float powerScale = 1.0f / static_cast<float>(nPhotons);
+    globalMap.Build(globalPhotons, powerScale);
+    causticMap.Build(causticPhotons, powerScale);
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Photon maps: " << nPhotons << " paths on " << threads << " threads, " << globalMap.Size()
+              << " global and " << causticMap.Size() << " caustic photons in " << seconds << " s" << std::endl;
+}
+
+void PhotonMappingIntegrator::TracePhotons(const Scene& scene, int firstPhoton, int photonCount,
+                                           Sampler& sampler, PhotonBatch& batch) const {
+    for (int i = firstPhoton; i < firstPhoton + photonCount; ++i) {
+        sampler.StartPixelSample(glm::ivec2(0, 0), i);
+        float uLight = sampler.Get1D();
+        glm::vec2 uPosition = sampler.Get2D();
+        glm::vec2 uDirection = sampler.Get2D();
+        
+        Ray ray;
+        Spectrum power(0.0f);
+        if (!scene.SampleLightEmission(uLight, uPosition, uDirection, &ray, &power) || power.isBlack()) continue;
+        
+        bool specularPath = true;
+        for (int depth = 0; depth < maxDepth; ++depth) {
+            SurfaceInteraction isect;
+            if (!scene.Intersect(ray, &isect)) break;
             
-            // Multiple samples per pixel for antialiasing
-            const int samplesPerPixel = 16;
-            for (int s = 0; s < samplesPerPixel; ++s) {
-                glm::vec2 pixelSample(
-                    std::uniform_real_distribution<float>(0, 1)(rng),
-                    std::uniform_real_distribution<float>(0, 1)(rng)
-                );
-                
-                Ray ray = GenerateCameraRay(x, y, width, height, cameraToWorld, fov, pixelSample);
-                L += Li(ray, scene, rng) / static_cast<float>(samplesPerPixel);
+            isect.ComputeScatteringFunctions(ray);
+            if (!isect.bsdf) {
+                ray = isect.SpawnRay(ray.direction);
+                continue;
             }
             
-            // Convert spectrum to RGB and store
-            glm::vec3 rgb = L.toRGB();
+            glm::vec3 wo = -ray.direction;
+            if (!isect.bsdf->isDelta()) {
+                // First hits are direct light, which Li takes from shadow rays instead
+                if (depth > 0) {
+                    PhotonMap::Photon photon = { isect.p, wo, power.toRGB() };
+                    (specularPath ? batch.caustic : batch.global).push_back(photon);
+                }
+                specularPath = false;
+            }
             
-            // Tone mapping (simple Reinhard)
-            rgb = rgb / (rgb + glm::vec3(1.0f));
+            ShadingFrame frame(isect.n);
+            glm::vec3 wi;
+            float pdf;
+            Spectrum f = isect.bsdf->Sample_f(frame.ToLocal(wo), &wi, sampler.Get2D(), &pdf);
+            if (f.isBlack() || pdf <= 0.0f) break;
             
-            // Gamma correction
-            rgb = glm::vec3(std::pow(rgb.r, 1.0f / 2.2f), std::pow(rgb.g, 1.0f / 2.2f), std::pow(rgb.b, 1.0f / 2.2f));
+            // Roulette on the throughput ratio, so surviving photons keep their power
+            Spectrum scattered = power * f * (std::abs(wi.z) / pdf);
+            float powerLuminance = power.luminance();
+            if (powerLuminance <= 0.0f) break;
+            float survival = std::min(1.0f, scattered.luminance() / powerLuminance);
+            if (survival <= 0.0f || sampler.Get1D() >= survival) break;
+            power = scattered / survival;
             
-            int pixelIndex = (y * width + x) * 3;
-            pixels[pixelIndex + 0] = std::max(0.0f, std::min(rgb.r, 1.0f));
-            pixels[pixelIndex + 1] = std::max(0.0f, std::min(rgb.g, 1.0f));
-            pixels[pixelIndex + 2] = std::max(0.0f, std::min(rgb.b, 1.0f));
+            ray = isect.SpawnRay(frame.ToWorld(wi));
         }
     }
 }
 
+Spectrum PhotonMappingIntegrator::Li(const Ray& ray, const Scene& scene, Sampler& sampler) const {
+    Spectrum L(0.0f);
+    Spectrum beta(1.0f);
+    Ray currentRay = ray;
+    
+    for (int depth = 0; depth < maxDepth; ++depth) {
+        SurfaceInteraction isect;
+        if (!scene.Intersect(currentRay, &isect)) {
+            L.addProduct(beta, scene.Le(currentRay));
+            break;
+        }
+        
+        isect.ComputeScatteringFunctions(currentRay);
+        if (!isect.bsdf) {
+            currentRay = isect.SpawnRay(currentRay.direction);
+            continue;
+        }
+        
+        // Specular chains are followed to the first diffuse surface, where the maps take over
+        if (isect.bsdf->isDelta()) {
+            ShadingFrame frame(isect.n);
+            glm::vec3 wi;
+            float pdf;
+            Spectrum f = isect.bsdf->Sample_f(frame.ToLocal(isect.wo), &wi, sampler.Get2D(), &pdf);
+            if (f.isBlack() || pdf <= 0.0f) break;
+            beta.mulScaled(f, std::abs(wi.z) / pdf);
+            currentRay = isect.SpawnRay(frame.ToWorld(wi));
+            continue;
+        }
+        
+        Spectrum direct = EstimateDirectLighting(isect, scene, sampler);
+        L.addProduct(beta, direct + EstimateIndirectLighting(isect));
+        break;
+    }
+    
+    return L;
+}
+
+Spectrum PhotonMappingIntegrator::EstimateDirectLighting(const SurfaceInteraction& it, const Scene& scene,
+                                                         Sampler& sampler) const {
+    Ray shadowRay;
+    Spectrum direct;
+    if (!SampleDirectLight(it, scene, sampler.Get2D(), &shadowRay, &direct) || scene.IntersectP(shadowRay)) {
+        return Spectrum(0.0f);
+    }
+    return direct;
+}
+
+Spectrum PhotonMappingIntegrator::EstimateIndirectLighting(const SurfaceInteraction& it) const {
+    ShadingFrame frame(it.n);
+    glm::vec3 woLocal = frame.ToLocal(it.wo);
+    const BRDF& bsdf = *it.bsdf;
+    auto brdf = [&bsdf, &frame, &woLocal](const glm::vec3& wi) { return bsdf.f(woLocal, frame.ToLocal(wi)); };
+    
+    // One per worker, so lookups do not allocate
+    thread_local std::vector<PhotonMap::Neighbour> heap;
+    
+    Spectrum L = causticMap.EstimateRadiance(it.p, it.n, searchRadius, gatherPhotons, brdf, heap);
+    L += globalMap.EstimateRadiance(it.p, it.n, searchRadius, gatherPhotons, brdf, heap);
+    return L;
+}
+
 // Subsurface scattering implementation
 SubsurfaceScattering::SubsurfaceScattering(const Spectrum& sigma_a, const Spectrum& sigma_s, float g)
     : sigma_a(sigma_a), sigma_s(sigma_s), g(g) {
@@ -243,7 +826,7 @@ Spectrum SubsurfaceScattering::Rd(float distance) const {
 VolumetricPathIntegrator::VolumetricPathIntegrator(int maxDepth) : maxDepth(maxDepth) {
 }
 
-Spectrum VolumetricPathIntegrator::Li(const Ray& ray, const Scene& scene, std::mt19937& rng) const {
+Spectrum VolumetricPathIntegrator::Li(const Ray& ray, const Scene& scene, Sampler& sampler) const {
     // Simplified - just return ambient
     return Spectrum(0.1f);
 }
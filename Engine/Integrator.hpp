@@ -6,6 +6,8 @@
 #include <vector>
 #include <random>
 #include "Mesh.hpp"
+#include "Sampler.hpp"
+#include "PhotonMap.hpp"
 
 // Ray structure for path tracing
 struct Ray {
@@ -21,6 +23,32 @@ struct Ray {
     glm::vec3 operator()(float t) const { return origin + t * direction; }
 };
 
+// Rays in structure-of-arrays form for Scene::IntersectN and OccludedN. Neighbouring rays
+// should be coherent (adjacent pixels, or shadow rays towards one light) for packets to pay off.
+struct RayStream {
+    std::vector<float> ox, oy, oz;
+    std::vector<float> dx, dy, dz;
+    std::vector<float> tMin, tMax;
+    
+    size_t Size() const { return ox.size(); }
+    
+    void Clear() {
+        ox.clear(); oy.clear(); oz.clear();
+        dx.clear(); dy.clear(); dz.clear();
+        tMin.clear(); tMax.clear();
+    }
+    
+    void Push(const Ray& ray) {
+        ox.push_back(ray.origin.x); oy.push_back(ray.origin.y); oz.push_back(ray.origin.z);
+        dx.push_back(ray.direction.x); dy.push_back(ray.direction.y); dz.push_back(ray.direction.z);
+        tMin.push_back(ray.tMin); tMax.push_back(ray.tMax);
+    }
+    
+    Ray Get(size_t i) const {
+        return Ray(glm::vec3(ox[i], oy[i], oz[i]), glm::vec3(dx[i], dy[i], dz[i]), tMin[i], tMax[i]);
+    }
+};
+
 // Surface interaction
 struct SurfaceInteraction {
     glm::vec3 p;           // Hit point
@@ -39,6 +67,10 @@ struct SurfaceInteraction {
     // BSDF at interaction point
     std::unique_ptr<BRDF> bsdf;
     
+    // Set on hero-wavelength paths, so materials can make dispersive interfaces terminate
+    // the secondary wavelengths
+    SampledWavelengths* wavelengths = nullptr;
+    
     // Compute scattered ray
     Spectrum ComputeScatteringFunctions(const Ray& ray);
     
@@ -76,10 +108,20 @@ public:
     virtual bool Intersect(const Ray& ray, SurfaceInteraction* isect) const = 0;
     virtual bool IntersectP(const Ray& ray) const = 0; // Shadow rays
     
+    // Stream forms: hits[i] and occluded[i] are set for every ray, isects[i] only where there is
+    // a hit. The defaults loop over Intersect and IntersectP.
+    virtual void IntersectN(const RayStream& rays, SurfaceInteraction* isects, uint8_t* hits) const;
+    virtual void OccludedN(const RayStream& rays, uint8_t* occluded) const;
+    
     // Light sampling
     virtual Spectrum SampleLight(const glm::vec2& u, LightSample* sample) const = 0;
     virtual float LightPdf(const LightSample& sample) const = 0;
     
+    // Photon emission: a ray leaving a light and the flux it carries, already divided by the
+    // sampling pdfs. Returns false when there is nothing to emit from.
+    virtual bool SampleLightEmission(float uLight, const glm::vec2& uPosition, const glm::vec2& uDirection,
+                                     Ray* ray, Spectrum* power) const { return false; }
+    
     // Environment lighting
     virtual Spectrum Le(const Ray& ray) const { return Spectrum(0.0f); }
     
@@ -92,39 +134,69 @@ protected:
     std::vector<std::unique_ptr<Mesh>> meshes;
 };
 
+// A camera path's place in its sampler, so a wavefront can park the path between stages
+struct PathSamplePosition {
+    glm::ivec2 pixel;
+    int sampleIndex;
+    int dimension;
+};
+
 // Path tracing integrator from PBR Chapter 14
 class PathIntegrator {
 public:
-    PathIntegrator(int maxDepth = 8, float rrThreshold = 1.0f);
+    // Full carries every Spectrum sample along each path; HeroWavelength carries
+    // SampledWavelengths::COUNT stratified wavelengths per camera ray and splats them back
+    enum class SpectralMode {
+        Full,
+        HeroWavelength
+    };
+    
+    PathIntegrator(int maxDepth = 8, float rrThreshold = 1.0f, SpectralMode spectralMode = SpectralMode::Full);
     
     // Main rendering function
-    Spectrum Li(const Ray& ray, const Scene& scene, std::mt19937& rng, int depth = 0) const;
+    Spectrum Li(const Ray& ray, const Scene& scene, Sampler& sampler, int depth = 0) const;
     
-    // Render a tile of the image
+    // Render a tile of the image on the calling thread; TileRenderer spreads whole images across cores.
+    // Samples are keyed by seed and pixel, so the result is reproducible.
     void RenderTile(int startX, int startY, int endX, int endY, 
                    const Scene& scene, float* pixels, int width, int height,
-                   const glm::mat4& cameraToWorld, float fov) const;
+                   const glm::mat4& cameraToWorld, float fov,
+                   int samplesPerPixel = 16, uint32_t seed = 0) const;
+    
+    // Wavefront form of Li over a batch of camera rays: all live paths advance through each
+    // stage (intersect, shade, shadow) together, so the scene is handed whole ray streams.
+    // positions[i] is where the sampler stood after generating rays[i]; L[i] matches Li(rays[i]).
+    void LiN(const Ray* rays, const PathSamplePosition* positions, int count, const Scene& scene,
+             Sampler& sampler, Spectrum* L) const;
     
     // Sample camera ray
-    Ray GenerateCameraRay(int x, int y, int width, int height, 
-                         const glm::mat4& cameraToWorld, float fov, 
-                         const glm::vec2& sample = glm::vec2(0.5f)) const;
+    static Ray GenerateCameraRay(int x, int y, int width, int height, 
+                                const glm::mat4& cameraToWorld, float fov, 
+                                const glm::vec2& sample = glm::vec2(0.5f));
     
 private:
     int maxDepth;
     float rrThreshold; // Russian roulette threshold
+    SpectralMode spectralMode;
+    
+    template <bool HeroWavelengths>
+    Spectrum TracePath(const Ray& ray, const Scene& scene, Sampler& sampler) const;
+    
+    template <bool HeroWavelengths>
+    void TracePaths(const Ray* rays, const PathSamplePosition* positions, int count, const Scene& scene,
+                    Sampler& sampler, Spectrum* L) const;
     
     // Direct lighting estimation
     Spectrum EstimateDirect(const SurfaceInteraction& it, const glm::vec2& uLight,
-                           const glm::vec2& uBSDF, const Scene& scene, std::mt19937& rng) const;
+                           const glm::vec2& uBSDF, const Scene& scene, Sampler& sampler) const;
     
     // Sample one light uniformly
     Spectrum SampleOneLight(const SurfaceInteraction& it, const Scene& scene, 
-                           std::mt19937& rng) const;
+                           Sampler& sampler) const;
     
     // Multiple importance sampling for light and BRDF
     Spectrum MISEstimate(const SurfaceInteraction& it, const glm::vec2& uLight,
-                        const glm::vec2& uBSDF, const Scene& scene, std::mt19937& rng) const;
+                        const glm::vec2& uBSDF, const Scene& scene, Sampler& sampler) const;
 };
 
 // Bidirectional path tracing for advanced effects
@@ -132,7 +204,7 @@ class BidirectionalPathIntegrator {
 public:
     BidirectionalPathIntegrator(int maxDepth = 8);
     
-    Spectrum Li(const Ray& ray, const Scene& scene, std::mt19937& rng) const;
+    Spectrum Li(const Ray& ray, const Scene& scene, Sampler& sampler) const;
     
 private:
     int maxDepth;
@@ -148,8 +220,8 @@ private:
     };
     
     // Generate light and camera subpaths
-    int GenerateCameraSubpath(const Ray& ray, const Scene& scene, std::vector<Vertex>& path, std::mt19937& rng) const;
-    int GenerateLightSubpath(const Scene& scene, std::vector<Vertex>& path, std::mt19937& rng) const;
+    int GenerateCameraSubpath(const Ray& ray, const Scene& scene, std::vector<Vertex>& path, Sampler& sampler) const;
+    int GenerateLightSubpath(const Scene& scene, std::vector<Vertex>& path, Sampler& sampler) const;
     
     // Connect subpaths
     Spectrum ConnectBDPT(const std::vector<Vertex>& cameraPath, const std::vector<Vertex>& lightPath,
@@ -161,81 +233,89 @@ class VolumetricPathIntegrator {
 public:
     VolumetricPathIntegrator(int maxDepth = 8);
     
-    Spectrum Li(const Ray& ray, const Scene& scene, std::mt19937& rng) const;
+    Spectrum Li(const Ray& ray, const Scene& scene, Sampler& sampler) const;
     
 private:
     int maxDepth;
     
     // Sample volume scattering
-    Spectrum SampleVolumeScattering(const Ray& ray, const Scene& scene, std::mt19937& rng) const;
+    Spectrum SampleVolumeScattering(const Ray& ray, const Scene& scene, Sampler& sampler) const;
     
     // Phase function sampling
     float HenyeyGreenstein(float cosTheta, float g) const;
     float SampleHenyeyGreenstein(float g, const glm::vec2& u) const;
 };
 
-// Metropolis Light Transport for difficult scenes
+// Metropolis Light Transport for difficult scenes: primary-sample-space MLT over the path
+// tracer. A bootstrap pass of independent paths estimates the image brightness and seeds
+// chainCount chains; those run on threadCount threads with a film buffer each, merged at the end.
 class MetropolisIntegrator {
 public:
-    MetropolisIntegrator(int maxDepth = 8, float largeStepProbability = 0.3f);
+    MetropolisIntegrator(int maxDepth = 8, float largeStepProbability = 0.3f, int chainCount = 1000,
+                         int bootstrapSamples = 100000, float sigma = 0.01f, unsigned threadCount = 0,
+                         uint32_t seed = 0);
     
+    // numSamples is mutations per pixel; pixels is width * height RGB, tone mapped like TileRenderer's
     void Render(const Scene& scene, float* pixels, int width, int height,
                const glm::mat4& cameraToWorld, float fov, int numSamples) const;
     
 private:
     int maxDepth;
     float largeStepProbability;
-    
-    // Path perturbation strategies
-    struct PathSample {
-        std::vector<glm::vec2> cameraSamples;
-        std::vector<glm::vec2> lightSamples;
-        std::vector<glm::vec2> bsdfSamples;
-        Spectrum L;
-        float pdf;
+    int chainCount;
+    int bootstrapSamples;
+    float sigma;            // Small-step standard deviation in primary sample space
+    unsigned threadCount;   // 0 uses every hardware thread
+    uint32_t seed;
+    
+    struct FilmView {
+        int width, height;
+        glm::mat4 cameraToWorld;
+        float fov;
     };
     
-    PathSample GeneratePath(const Scene& scene, const Ray& ray, std::mt19937& rng) const;
-    PathSample PerturbPath(const PathSample& oldPath, std::mt19937& rng) const;
-    float AcceptanceRatio(const PathSample& oldPath, const PathSample& newPath) const;
+    // RGB radiance of the path the sampler's current values describe, and the pixel it lands on
+    glm::vec3 EvaluatePath(const Scene& scene, const PathIntegrator& paths, const FilmView& film,
+                           MLTSampler& sampler, glm::ivec2* pixel) const;
+    
+    void RunChain(const Scene& scene, const PathIntegrator& paths, const FilmView& film, int chain,
+                  const std::vector<float>& bootstrapCdf, int64_t mutations, std::vector<glm::vec3>& splats) const;
 };
 
 // Photon mapping for caustics and global illumination
 class PhotonMappingIntegrator {
 public:
-    PhotonMappingIntegrator(int nPhotons = 1000000, int maxDepth = 8, float searchRadius = 0.1f);
+    PhotonMappingIntegrator(int nPhotons = 1000000, int maxDepth = 8, float searchRadius = 0.1f,
+                            int gatherPhotons = 64, unsigned threadCount = 0);
     
+    // Traces nPhotons light paths across threadCount threads (0 uses every hardware thread)
+    // and builds both maps; Li only reads them, so it is safe on every TileRenderer worker
     void Preprocess(const Scene& scene);
-    Spectrum Li(const Ray& ray, const Scene& scene, std::mt19937& rng) const;
+    Spectrum Li(const Ray& ray, const Scene& scene, Sampler& sampler) const;
+    
+    size_t GetGlobalPhotonCount() const { return globalMap.Size(); }
+    size_t GetCausticPhotonCount() const { return causticMap.Size(); }
     
 private:
     int nPhotons;
     int maxDepth;
     float searchRadius;
+    int gatherPhotons;
+    unsigned threadCount;
     
-    struct Photon {
-        glm::vec3 p;
-        glm::vec3 wi;
-        Spectrum phi; // Power
-    };
+    // Caustics are L S+ D paths, looked up at every diffuse hit; the global map holds the
+    // remaining indirect photons (direct light comes from shadow rays instead)
+    PhotonMap globalMap, causticMap;
     
-    std::vector<Photon> globalPhotons;
-    std::vector<Photon> causticPhotons;
-    
-    // K-d tree for photon storage
-    class PhotonMap {
-    public:
-        void Store(const std::vector<Photon>& photons);
-        Spectrum EstimateRadiance(const glm::vec3& p, const glm::vec3& n, float searchRadius, int maxPhotons) const;
-    private:
-        std::vector<Photon> photons;
-        // K-d tree implementation would go here
+    // One batch of photon paths, whichever thread traces it; batches are merged in order, so
+    // the maps do not depend on scheduling
+    struct PhotonBatch {
+        std::vector<PhotonMap::Photon> global;
+        std::vector<PhotonMap::Photon> caustic;
     };
     
-    PhotonMap globalMap, causticMap;
-    
-    void TracePhotons(const Scene& scene);
-    Spectrum EstimateDirectLighting(const SurfaceInteraction& it, const Scene& scene, std::mt19937& rng) const;
+    void TracePhotons(const Scene& scene, int firstPhoton, int photonCount, Sampler& sampler, PhotonBatch& batch) const;
+    Spectrum EstimateDirectLighting(const SurfaceInteraction& it, const Scene& scene, Sampler& sampler) const;
     Spectrum EstimateIndirectLighting(const SurfaceInteraction& it) const;
 };
 
@@ -0,0 +1,197 @@
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    // Queue of the calling thread: 0 outside the pool, worker i + 1 inside it
+    thread_local size_t localQueue = 0;
+
+    // Ranges per thread in ParallelFor, so a thread that finishes early can steal the rest
+    const size_t RANGES_PER_THREAD = 4;
+}
+
+JobSystem& JobSystem::Get()
+{
+    static JobSystem instance;
+    return instance;
+}
+
+JobSystem::JobSystem() : queuedCount(0), stopping(false)
+{
+}
+
+JobSystem::~JobSystem()
+{
+    Shutdown();
+}
+
+bool JobSystem::Init(unsigned threadCount)
+{
+    if (IsRunning()) {
+        return true;
+    }
+
+    if (threadCount == 0) {
+        unsigned hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    queues.clear();
+    for (unsigned i = 0; i <= threadCount; ++i) {
+        queues.emplace_back(new Queue());
+    }
+
+    stopping = false;
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&JobSystem::WorkerLoop, this, static_cast<size_t>(i));
+    }
+
+    std::cout << "Job system started with " << threadCount << " workers" << std::endl;
+    return true;
+}
+
+void JobSystem::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    // Workers drain the queues before they leave, so no counter is left waiting
+    for (std::thread& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
+
+void JobSystem::Run(const Job& job, JobCounter& counter)
+{
+    if (workers.empty()) {
+        job();
+        return;
+    }
+
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        Queue& queue = *queues[localQueue];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        Entry entry = { job, &counter };
+        queue.entries.push_back(entry);
+    }
+    queuedCount.fetch_add(1, std::memory_order_release);
+
+    // Taking the lock orders the count against a sleeper's check of it
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    while (!counter.IsDone()) {
+        if (RunOne()) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this, &counter] {
+            return counter.IsDone() || queuedCount.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grainSize, const RangeJob& job)
+{
+    if (count == 0) {
+        return;
+    }
+    if (workers.empty() || count <= grainSize) {
+        job(0, count);
+        return;
+    }
+
+    size_t ranges = (workers.size() + 1) * RANGES_PER_THREAD;
+    size_t rangeSize = (std::max)(grainSize, (count + ranges - 1) / ranges);
+
+    JobCounter counter;
+    for (size_t begin = rangeSize; begin < count; begin += rangeSize) {
+        size_t end = (std::min)(begin + rangeSize, count);
+        Run([&job, begin, end] { job(begin, end); }, counter);
+    }
+    job(0, (std::min)(rangeSize, count));
+    Wait(counter);
+}
+
+bool JobSystem::Pop(size_t self, Entry& entry)
+{
+    // Own queue newest first
+    {
+        Queue& queue = *queues[self];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.entries.empty()) {
+            entry = queue.entries.back();
+            queue.entries.pop_back();
+            return true;
+        }
+    }
+
+    // Then steal the oldest job of the next queue that has one
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        Queue& queue = *queues[(self + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.entries.empty()) {
+            entry = queue.entries.front();
+            queue.entries.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JobSystem::RunOne()
+{
+    if (queuedCount.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    Entry entry;
+    if (!Pop(localQueue, entry)) {
+        return false;
+    }
+    queuedCount.fetch_sub(1, std::memory_order_relaxed);
+
+    entry.job();
+    Finish(*entry.counter);
+    return true;
+}
+
+void JobSystem::Finish(JobCounter& counter)
+{
+    if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_all();
+}
+
+void JobSystem::WorkerLoop(size_t index)
+{
+    localQueue = index + 1;
+    Profiler::Get().SetThreadName("Job worker");
+
+    for (;;) {
+        if (RunOne()) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || queuedCount.load(std::memory_order_acquire) > 0; });
+        if (stopping && queuedCount.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Jobs still running from one batch; Wait() returns once it drops to zero. A counter must
+// outlive its jobs and be idle before it is reused.
+struct JobCounter {
+    std::atomic<int> pending;
+
+    JobCounter() : pending(0) {}
+    bool IsDone() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+// Work-stealing job pool. Every worker has its own queue: it takes its newest job first
+// (still warm in cache) and, when that runs dry, steals the oldest job from another queue.
+// Threads outside the pool submit to a shared queue. Waiting runs queued jobs instead of
+// blocking, so a job may start and wait on jobs of its own. Jobs must not throw.
+class JobSystem {
+public:
+    typedef std::function<void()> Job;
+    typedef std::function<void(size_t begin, size_t end)> RangeJob;
+
+    static JobSystem& Get();
+
+    // threadCount 0 picks one less than the hardware thread count; the thread that waits
+    // makes up the last one
+    bool Init(unsigned threadCount = 0);
+    void Shutdown();
+
+    void Run(const Job& job, JobCounter& counter);
+    void Wait(JobCounter& counter);
+
+    // Runs job over [0, count) in ranges of at least grainSize, on the pool and the calling
+    // thread, and returns once every range is done. Runs inline without workers.
+    void ParallelFor(size_t count, size_t grainSize, const RangeJob& job);
+
+    unsigned GetWorkerCount() const { return static_cast<unsigned>(workers.size()); }
+    bool IsRunning() const { return !workers.empty(); }
+
+private:
+    struct Entry {
+        Job job;
+        JobCounter* counter;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Entry> entries;
+    };
+
+    // Index 0 is the shared queue of threads outside the pool; worker i owns queue i + 1
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<int> queuedCount;
+
+    // Idle workers and waiters sleep here until a job is queued or a counter finishes
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping;
+
+    JobSystem();
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    bool Pop(size_t self, Entry& entry);
+    bool RunOne();
+    void Finish(JobCounter& counter);
+    void WorkerLoop(size_t index);
+};
@@ -1,7 +1,67 @@
 #include "Light.hpp"
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
 #include <string>
 
+namespace {
+    // Light slots whose uniform name hashes are precomputed; higher indices hash at runtime
+    const int kCachedLightSlots = 16;
+
+    // Hashes of "<singular>.<member>" for slot 0 and "<plural>[i].<member>" for the rest,
+    // matching the naming the PBR shaders use. Built once so uploads never format strings.
+    template <size_t MemberCount>
+    class LightUniformNames {
+    public:
+        LightUniformNames(const char* singular, const char* plural, const char* const (&members)[MemberCount])
+            : plural(plural), members(members) {
+            for (int slot = 0; slot < kCachedLightSlots; ++slot) {
+                for (size_t m = 0; m < MemberCount; ++m) {
+                    hashes[slot][m] = HashUniformName((prefix(singular, slot) + "." + members[m]).c_str());
+                }
+            }
+        }
+
+        uint32_t get(int slot, size_t member) const {
+            if (slot < kCachedLightSlots) return hashes[slot][member];
+            return HashUniformName((prefix(nullptr, slot) + "." + members[member]).c_str());
+        }
+
+    private:
+        std::string prefix(const char* singular, int slot) const {
+            if (slot == 0 && singular) return singular;
+            return std::string(plural) + "[" + std::to_string(slot) + "]";
+        }
+
+        const char* plural;
+        const char* const (&members)[MemberCount];
+        uint32_t hashes[kCachedLightSlots][MemberCount];
+    };
+
+    enum DirMember { DIR_DIRECTION, DIR_COLOR, DIR_INTENSITY };
+    const char* const kDirMembers[] = { "direction", "color", "intensity" };
+
+    enum PointMember { POINT_POSITION, POINT_COLOR, POINT_INTENSITY, POINT_CONSTANT, POINT_LINEAR, POINT_QUADRATIC };
+    const char* const kPointMembers[] = { "position", "color", "intensity", "constant", "linear", "quadratic" };
+
+    enum SpotMember { SPOT_POSITION, SPOT_DIRECTION, SPOT_COLOR, SPOT_INTENSITY, SPOT_INNER, SPOT_OUTER,
+                      SPOT_CONSTANT, SPOT_LINEAR, SPOT_QUADRATIC };
+    const char* const kSpotMembers[] = { "position", "direction", "color", "intensity", "innerCone", "outerCone",
+                                         "constant", "linear", "quadratic" };
+}
+
+float AttenuationRange(float peakBrightness, float constant, float linear, float quadratic) {
+    float target = peakBrightness * 256.0f;   // 1 / attenuation at the range
+    float range = MAX_LIGHT_RANGE;
+    if (quadratic > 0.0f) {
+        range = (-linear + std::sqrt((std::max)(linear * linear - 4.0f * quadratic * (constant - target), 0.0f))) /
+                (2.0f * quadratic);
+    } else if (linear > 0.0f) {
+        range = (target - constant) / linear;
+    }
+    return glm::clamp(range, 0.5f, MAX_LIGHT_RANGE);
+}
+
 Light::Light(LightType type) : Transform(), type(type), color(1.0f, 1.0f, 1.0f), intensity(1.0f), enabled(true) {
 }
 
@@ -15,17 +75,14 @@ DirectionalLight::DirectionalLight(const glm::vec3& dir, const glm::vec3& col, f
     intensity = intens;
 }
 
-void DirectionalLight::setUniforms(GLuint shaderProgram, int lightIndex) const {
+void DirectionalLight::setUniforms(const Shader& shader, int lightIndex) const {
     if (!enabled) return;
 
-    std::string prefix = "dirLight";
-    if (lightIndex > 0) {
-        prefix = "dirLights[" + std::to_string(lightIndex) + "]";
-    }
+    static const LightUniformNames<3> names("dirLight", "dirLights", kDirMembers);
 
-    GLint dirLoc = glGetUniformLocation(shaderProgram, (prefix + ".direction").c_str());
-    GLint colorLoc = glGetUniformLocation(shaderProgram, (prefix + ".color").c_str());
-    GLint intensityLoc = glGetUniformLocation(shaderProgram, (prefix + ".intensity").c_str());
+    GLint dirLoc = shader.getUniformLocation(names.get(lightIndex, DIR_DIRECTION));
+    GLint colorLoc = shader.getUniformLocation(names.get(lightIndex, DIR_COLOR));
+    GLint intensityLoc = shader.getUniformLocation(names.get(lightIndex, DIR_INTENSITY));
 
     if (dirLoc != -1) glUniform3fv(dirLoc, 1, glm::value_ptr(getDirection()));
     if (colorLoc != -1) glUniform3fv(colorLoc, 1, glm::value_ptr(color));
@@ -43,20 +100,21 @@ PointLight::PointLight(const glm::vec3& pos, const glm::vec3& col, float intens)
     intensity = intens;
 }
 
-void PointLight::setUniforms(GLuint shaderProgram, int lightIndex) const {
+float PointLight::getRange() const {
+    return AttenuationRange(intensity * (std::max)(color.r, (std::max)(color.g, color.b)), constant, linear, quadratic);
+}
+
+void PointLight::setUniforms(const Shader& shader, int lightIndex) const {
     if (!enabled) return;
 
-    std::string prefix = "pointLight";
-    if (lightIndex > 0) {
-        prefix = "pointLights[" + std::to_string(lightIndex) + "]";
-    }
+    static const LightUniformNames<6> names("pointLight", "pointLights", kPointMembers);
 
-    GLint posLoc = glGetUniformLocation(shaderProgram, (prefix + ".position").c_str());
-    GLint colorLoc = glGetUniformLocation(shaderProgram, (prefix + ".color").c_str());
-    GLint intensityLoc = glGetUniformLocation(shaderProgram, (prefix + ".intensity").c_str());
-    GLint constantLoc = glGetUniformLocation(shaderProgram, (prefix + ".constant").c_str());
-    GLint linearLoc = glGetUniformLocation(shaderProgram, (prefix + ".linear").c_str());
-    GLint quadraticLoc = glGetUniformLocation(shaderProgram, (prefix + ".quadratic").c_str());
+    GLint posLoc = shader.getUniformLocation(names.get(lightIndex, POINT_POSITION));
+    GLint colorLoc = shader.getUniformLocation(names.get(lightIndex, POINT_COLOR));
+    GLint intensityLoc = shader.getUniformLocation(names.get(lightIndex, POINT_INTENSITY));
+    GLint constantLoc = shader.getUniformLocation(names.get(lightIndex, POINT_CONSTANT));
+    GLint linearLoc = shader.getUniformLocation(names.get(lightIndex, POINT_LINEAR));
+    GLint quadraticLoc = shader.getUniformLocation(names.get(lightIndex, POINT_QUADRATIC));
 
     if (posLoc != -1) glUniform3fv(posLoc, 1, glm::value_ptr(getPosition()));
     if (colorLoc != -1) glUniform3fv(colorLoc, 1, glm::value_ptr(color));
@@ -79,23 +137,24 @@ SpotLight::SpotLight(const glm::vec3& pos, const glm::vec3& dir, const glm::vec3
     intensity = intens;
 }
 
-void SpotLight::setUniforms(GLuint shaderProgram, int lightIndex) const {
-    if (!enabled) return;
+float SpotLight::getRange() const {
+    return AttenuationRange(intensity * (std::max)(color.r, (std::max)(color.g, color.b)), constant, linear, quadratic);
+}
 
-    std::string prefix = "spotLight";
-    if (lightIndex > 0) {
-        prefix = "spotLights[" + std::to_string(lightIndex) + "]";
-    }
+void SpotLight::setUniforms(const Shader& shader, int lightIndex) const {
+    if (!enabled) return;
 
-    GLint posLoc = glGetUniformLocation(shaderProgram, (prefix + ".position").c_str());
-    GLint dirLoc = glGetUniformLocation(shaderProgram, (prefix + ".direction").c_str());
-    GLint colorLoc = glGetUniformLocation(shaderProgram, (prefix + ".color").c_str());
-    GLint intensityLoc = glGetUniformLocation(shaderProgram, (prefix + ".intensity").c_str());
-    GLint innerLoc = glGetUniformLocation(shaderProgram, (prefix + ".innerCone").c_str());
-    GLint outerLoc = glGetUniformLocation(shaderProgram, (prefix + ".outerCone").c_str());
-    GLint constantLoc = glGetUniformLocation(shaderProgram, (prefix + ".constant").c_str());
-    GLint linearLoc = glGetUniformLocation(shaderProgram, (prefix + ".linear").c_str());
-    GLint quadraticLoc = glGetUniformLocation(shaderProgram, (prefix + ".quadratic").c_str());
+    static const LightUniformNames<9> names("spotLight", "spotLights", kSpotMembers);
+
+    GLint posLoc = shader.getUniformLocation(names.get(lightIndex, SPOT_POSITION));
+    GLint dirLoc = shader.getUniformLocation(names.get(lightIndex, SPOT_DIRECTION));
+    GLint colorLoc = shader.getUniformLocation(names.get(lightIndex, SPOT_COLOR));
+    GLint intensityLoc = shader.getUniformLocation(names.get(lightIndex, SPOT_INTENSITY));
+    GLint innerLoc = shader.getUniformLocation(names.get(lightIndex, SPOT_INNER));
+    GLint outerLoc = shader.getUniformLocation(names.get(lightIndex, SPOT_OUTER));
+    GLint constantLoc = shader.getUniformLocation(names.get(lightIndex, SPOT_CONSTANT));
+    GLint linearLoc = shader.getUniformLocation(names.get(lightIndex, SPOT_LINEAR));
+    GLint quadraticLoc = shader.getUniformLocation(names.get(lightIndex, SPOT_QUADRATIC));
 
     if (posLoc != -1) glUniform3fv(posLoc, 1, glm::value_ptr(getPosition()));
     if (dirLoc != -1) glUniform3fv(dirLoc, 1, glm::value_ptr(getDirection()));
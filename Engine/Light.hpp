@@ -3,6 +3,15 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <GL/glew.h>
 #include "Transform.hpp"
+#include "Shader.hpp"
+
+// Local lights are treated as reaching no further than this, whatever their attenuation
+const float MAX_LIGHT_RANGE = 200.0f;
+
+// Distance where 1 / (constant + linear d + quadratic d^2) scales a light of this peak
+// brightness below 1/256, clamped to [0.5, MAX_LIGHT_RANGE]. Shadows and light culling
+// treat it as the light's radius.
+float AttenuationRange(float peakBrightness, float constant, float linear, float quadratic);
 
 enum class LightType {
     DIRECTIONAL,
@@ -34,7 +43,7 @@ public:
     }
     
     // Virtual methods for shader uniforms
-    virtual void setUniforms(GLuint shaderProgram, int lightIndex = 0) const = 0;
+    virtual void setUniforms(const Shader& shader, int lightIndex = 0) const = 0;
 
 protected:
     LightType type;
@@ -58,7 +67,7 @@ public:
         useTransformRotation = false;
     }
     
-    void setUniforms(GLuint shaderProgram, int lightIndex = 0) const override;
+    void setUniforms(const Shader& shader, int lightIndex = 0) const override;
 
 private:
     glm::vec3 baseDirection;
@@ -74,7 +83,9 @@ public:
     float linear;
     float quadratic;
 
-    void setUniforms(GLuint shaderProgram, int lightIndex = 0) const override;
+    float getRange() const;  // Where the attenuation fades out; see AttenuationRange
+
+    void setUniforms(const Shader& shader, int lightIndex = 0) const override;
 };
 
 class SpotLight : public Light {
@@ -102,7 +113,9 @@ public:
         useTransformRotation = false;
     }
     
-    void setUniforms(GLuint shaderProgram, int lightIndex = 0) const override;
+    float getRange() const;  // Where the attenuation fades out; see AttenuationRange
+    
+    void setUniforms(const Shader& shader, int lightIndex = 0) const override;
 
 private:
     glm::vec3 baseDirection;
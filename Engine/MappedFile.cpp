@@ -0,0 +1,62 @@
+#include "MappedFile.hpp"
+#include <windows.h>
+
+MappedFile::MappedFile() : fileHandle(nullptr), mappingHandle(nullptr), data(nullptr), size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+    
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    fileHandle = file;
+    
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        Close();
+        return false;
+    }
+    
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        Close();
+        return false;
+    }
+    mappingHandle = mapping;
+    
+    data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!data) {
+        Close();
+        return false;
+    }
+    
+    size = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (data) {
+        UnmapViewOfFile(data);
+        data = nullptr;
+    }
+    if (mappingHandle) {
+        CloseHandle(static_cast<HANDLE>(mappingHandle));
+        mappingHandle = nullptr;
+    }
+    if (fileHandle) {
+        CloseHandle(static_cast<HANDLE>(fileHandle));
+        fileHandle = nullptr;
+    }
+    size = 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. The view stays valid until
+// Close() or destruction, so callers can hand pointers into it straight to GL.
+class MappedFile {
+private:
+    void* fileHandle;
+    void* mappingHandle;
+    const unsigned char* data;
+    size_t size;
+    
+public:
+    MappedFile();
+    ~MappedFile();
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    bool Open(const std::string& path);
+    void Close();
+    
+    bool IsOpen() const { return data != nullptr; }
+    const unsigned char* Data() const { return data; }
+    size_t Size() const { return size; }
+};
@@ -1,40 +1,134 @@
 #include "Material.hpp"
+#include "ResourceCache.hpp"
 #include <glm/gtc/type_ptr.hpp>
 
+namespace {
+    // Uniform name hashes, folded at compile time for Shader::getUniformLocation
+    constexpr uint32_t UNIFORM_MATERIAL_ALBEDO = HashUniformName("material_albedo");
+    constexpr uint32_t UNIFORM_MATERIAL_METALLIC = HashUniformName("material_metallic");
+    constexpr uint32_t UNIFORM_MATERIAL_ROUGHNESS = HashUniformName("material_roughness");
+    constexpr uint32_t UNIFORM_MATERIAL_AO = HashUniformName("material_ao");
+    constexpr uint32_t UNIFORM_OBJECT_COLOR = HashUniformName("objectColor");
+    constexpr uint32_t UNIFORM_SELECTION_HIGHLIGHT = HashUniformName("selectionHighlight");
+    constexpr uint32_t UNIFORM_MATERIAL_DIFFUSE_TEXTURE = HashUniformName("material_diffuseTexture");
+    constexpr uint32_t UNIFORM_MATERIAL_NORMAL_TEXTURE = HashUniformName("material_normalTexture");
+    constexpr uint32_t UNIFORM_MATERIAL_SPECULAR_TEXTURE = HashUniformName("material_specularTexture");
+    constexpr uint32_t UNIFORM_MATERIAL_OCCLUSION_TEXTURE = HashUniformName("material_occlusionTexture");
+    constexpr uint32_t UNIFORM_MATERIAL_HAS_DIFFUSE_TEXTURE = HashUniformName("material_hasDiffuseTexture");
+    constexpr uint32_t UNIFORM_MATERIAL_HAS_NORMAL_TEXTURE = HashUniformName("material_hasNormalTexture");
+    constexpr uint32_t UNIFORM_MATERIAL_HAS_SPECULAR_TEXTURE = HashUniformName("material_hasSpecularTexture");
+    constexpr uint32_t UNIFORM_MATERIAL_HAS_OCCLUSION_TEXTURE = HashUniformName("material_hasOcclusionTexture");
+    constexpr uint32_t UNIFORM_MATERIAL_TYPE = HashUniformName("u_materialType");
+    constexpr uint32_t UNIFORM_HAS_ADVANCED_MATERIAL = HashUniformName("u_hasAdvancedMaterial");
+    constexpr uint32_t UNIFORM_DISNEY_SUBSURFACE = HashUniformName("u_disney_subsurface");
+    constexpr uint32_t UNIFORM_DISNEY_SHEEN = HashUniformName("u_disney_sheen");
+    constexpr uint32_t UNIFORM_DISNEY_SHEEN_TINT = HashUniformName("u_disney_sheenTint");
+    constexpr uint32_t UNIFORM_DISNEY_CLEARCOAT = HashUniformName("u_disney_clearcoat");
+    constexpr uint32_t UNIFORM_DISNEY_CLEARCOAT_GLOSS = HashUniformName("u_disney_clearcoatGloss");
+    constexpr uint32_t UNIFORM_DISNEY_SPECULAR_TINT = HashUniformName("u_disney_specularTint");
+    constexpr uint32_t UNIFORM_DISNEY_TRANSMISSION = HashUniformName("u_disney_transmission");
+    constexpr uint32_t UNIFORM_DISNEY_IOR = HashUniformName("u_disney_ior");
+    constexpr uint32_t UNIFORM_METAL_ETA = HashUniformName("u_metal_eta");
+    constexpr uint32_t UNIFORM_METAL_K = HashUniformName("u_metal_k");
+    constexpr uint32_t UNIFORM_GLASS_IOR = HashUniformName("u_glass_ior");
+    constexpr uint32_t UNIFORM_GLASS_TRANSMISSION = HashUniformName("u_glass_transmission");
+    constexpr uint32_t UNIFORM_SUBSURFACE_SIGMA_A = HashUniformName("u_subsurface_sigmaA");
+    constexpr uint32_t UNIFORM_SUBSURFACE_SIGMA_S = HashUniformName("u_subsurface_sigmaS");
+    constexpr uint32_t UNIFORM_SUBSURFACE_SCALE = HashUniformName("u_subsurface_scale");
+    constexpr uint32_t UNIFORM_EMISSION_COLOR = HashUniformName("u_emission_color");
+    constexpr uint32_t UNIFORM_EMISSION_POWER = HashUniformName("u_emission_power");
+    
+    uint32_t nextMaterialSortId = 0;
+}
+
 Material::Material() 
     : albedo(glm::vec3(0.2f, 0.4f, 0.8f)),  // Default to blue for visibility
       metallic(0.0f),
       roughness(0.5f),
       ao(1.0f),
       materialType(MaterialType::PBR_BASIC),
-      advancedMaterial(nullptr)
+      advancedMaterial(nullptr),
+      sortId(nextMaterialSortId++),
+      shader(std::make_shared<Shader>()),
+      variantDirty(false)
 {
 }
 
 Material::Material(const glm::vec3& albedo, float metallic, float roughness, float ao)
     : albedo(albedo), metallic(metallic), roughness(roughness), ao(ao),
-      materialType(MaterialType::PBR_BASIC), advancedMaterial(nullptr)
+      materialType(MaterialType::PBR_BASIC), advancedMaterial(nullptr),
+      sortId(nextMaterialSortId++), shader(std::make_shared<Shader>()), variantDirty(false)
 {
 }
 
 bool Material::Init()
 {
     // Use advanced shader by default for better material support
-    return shader.InitFromFiles("shaders/pbr_advanced.vert", "shaders/pbr_advanced.frag");
+    return InitWithShader("shaders/pbr_advanced.vert", "shaders/pbr_advanced.frag");
+}
+
+bool Material::InitWithShader(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines)
+{
+    this->vertexPath = vertexPath;
+    this->fragmentPath = fragmentPath;
+    baseDefines = defines;
+    return selectShaderVariant();
 }
 
-bool Material::InitWithShader(const std::string& vertexPath, const std::string& fragmentPath)
+bool Material::initFallbackShader()
 {
-    return shader.InitFromFiles(vertexPath, fragmentPath);
+    return InitWithShader("shaders/simple.vert", "shaders/simple.frag") || Init();
 }
 
-void Material::setUniforms(GLuint shaderProgram) const
+const Shader& Material::getShader() const
+{
+    // Textures and types are usually set after Init; compile only the variant that gets drawn
+    if (variantDirty) {
+        selectShaderVariant();
+    }
+    return *shader;
+}
+
+std::string Material::getPermutationDefines() const
+{
+    // Without an advanced material only the basic path has its parameters
+    MaterialType type = hasAdvancedMaterial() ? materialType : MaterialType::PBR_BASIC;
+    std::string defines = "MATERIAL_TYPE=" + std::to_string(static_cast<int>(type));
+    if (hasDiffuseTexture()) defines += ";HAS_DIFFUSE_TEXTURE";
+    if (hasNormalTexture()) defines += ";HAS_NORMAL_TEXTURE";
+    if (hasSpecularTexture()) defines += ";HAS_SPECULAR_TEXTURE";
+    if (hasOcclusionTexture()) defines += ";HAS_OCCLUSION_TEXTURE";
+    return defines;
+}
+
+bool Material::selectShaderVariant() const
+{
+    variantDirty = false;
+    if (vertexPath.empty()) {
+        return false;
+    }
+    
+    // Materials with the same permutation share one program through the cache
+    std::string defines = getPermutationDefines();
+    if (!baseDefines.empty()) {
+        defines = baseDefines + ";" + defines;
+    }
+    std::shared_ptr<Shader> program = ResourceCache::Get().GetShader(vertexPath, fragmentPath, defines);
+    if (!program) {
+        // Keeps the previous variant, if any
+        return false;
+    }
+    shader = program;
+    return true;
+}
+
+void Material::setUniforms(const Shader& shader) const
 {
     // Try PBR uniforms first
-    GLint albedoLoc = glGetUniformLocation(shaderProgram, "material_albedo");
-    GLint metallicLoc = glGetUniformLocation(shaderProgram, "material_metallic");
-    GLint roughnessLoc = glGetUniformLocation(shaderProgram, "material_roughness");
-    GLint aoLoc = glGetUniformLocation(shaderProgram, "material_ao");
+    GLint albedoLoc = shader.getUniformLocation(UNIFORM_MATERIAL_ALBEDO);
+    GLint metallicLoc = shader.getUniformLocation(UNIFORM_MATERIAL_METALLIC);
+    GLint roughnessLoc = shader.getUniformLocation(UNIFORM_MATERIAL_ROUGHNESS);
+    GLint aoLoc = shader.getUniformLocation(UNIFORM_MATERIAL_AO);
     
     if (albedoLoc != -1) glUniform3fv(albedoLoc, 1, glm::value_ptr(albedo));
     if (metallicLoc != -1) glUniform1f(metallicLoc, metallic);
@@ -42,8 +136,8 @@ void Material::setUniforms(GLuint shaderProgram) const
     if (aoLoc != -1) glUniform1f(aoLoc, ao);
     
     // Check for simple shader uniforms (Phong lighting)
-    GLint objectColorLoc = glGetUniformLocation(shaderProgram, "objectColor");
-    GLint selectionHighlightLoc = glGetUniformLocation(shaderProgram, "selectionHighlight");
+    GLint objectColorLoc = shader.getUniformLocation(UNIFORM_OBJECT_COLOR);
+    GLint selectionHighlightLoc = shader.getUniformLocation(UNIFORM_SELECTION_HIGHLIGHT);
     
     if (objectColorLoc != -1) {
         
@@ -62,14 +156,14 @@ void Material::setUniforms(GLuint shaderProgram) const
     }
     
     // Set texture uniforms
-    GLint diffuseTexLoc = glGetUniformLocation(shaderProgram, "material_diffuseTexture");
-    GLint normalTexLoc = glGetUniformLocation(shaderProgram, "material_normalTexture");
-    GLint specularTexLoc = glGetUniformLocation(shaderProgram, "material_specularTexture");
-    GLint occlusionTexLoc = glGetUniformLocation(shaderProgram, "material_occlusionTexture");
-    GLint hasDiffuseTexLoc = glGetUniformLocation(shaderProgram, "material_hasDiffuseTexture");
-    GLint hasNormalTexLoc = glGetUniformLocation(shaderProgram, "material_hasNormalTexture");
-    GLint hasSpecularTexLoc = glGetUniformLocation(shaderProgram, "material_hasSpecularTexture");
-    GLint hasOcclusionTexLoc = glGetUniformLocation(shaderProgram, "material_hasOcclusionTexture");
+    GLint diffuseTexLoc = shader.getUniformLocation(UNIFORM_MATERIAL_DIFFUSE_TEXTURE);
+    GLint normalTexLoc = shader.getUniformLocation(UNIFORM_MATERIAL_NORMAL_TEXTURE);
+    GLint specularTexLoc = shader.getUniformLocation(UNIFORM_MATERIAL_SPECULAR_TEXTURE);
+    GLint occlusionTexLoc = shader.getUniformLocation(UNIFORM_MATERIAL_OCCLUSION_TEXTURE);
+    GLint hasDiffuseTexLoc = shader.getUniformLocation(UNIFORM_MATERIAL_HAS_DIFFUSE_TEXTURE);
+    GLint hasNormalTexLoc = shader.getUniformLocation(UNIFORM_MATERIAL_HAS_NORMAL_TEXTURE);
+    GLint hasSpecularTexLoc = shader.getUniformLocation(UNIFORM_MATERIAL_HAS_SPECULAR_TEXTURE);
+    GLint hasOcclusionTexLoc = shader.getUniformLocation(UNIFORM_MATERIAL_HAS_OCCLUSION_TEXTURE);
     
     if (diffuseTexLoc != -1) glUniform1i(diffuseTexLoc, 0);
     if (normalTexLoc != -1) glUniform1i(normalTexLoc, 1);
@@ -102,53 +196,71 @@ void Material::bindTextures() const
     }
 }
 
+// Same units as bindTextures(), but skips textures that are already bound
+void Material::bindTextures(GLStateCache& stateCache) const
+{
+    if (hasDiffuseTexture()) stateCache.BindTexture2D(0, diffuseTexture->getID());
+    if (hasNormalTexture()) stateCache.BindTexture2D(1, normalTexture->getID());
+    if (hasSpecularTexture()) stateCache.BindTexture2D(2, specularTexture->getID());
+    if (hasOcclusionTexture()) stateCache.BindTexture2D(3, occlusionTexture->getID());
+}
+
 void Material::setDiffuseTexture(const std::string& texturePath)
 {
-    diffuseTexture = std::make_unique<Texture>(texturePath);
-    std::cout << "Set diffuse texture: " << texturePath << " (Valid: " << (diffuseTexture->isValid() ? "Yes" : "No") << ")" << std::endl;
+    diffuseTexture = ResourceCache::Get().GetTexture(texturePath);
+    variantDirty = true;
+    std::cout << "Set diffuse texture: " << texturePath << " (Valid: " << (diffuseTexture->isValid() ? "Yes" : "No")
+              << (diffuseTexture->isPending() ? ", streaming" : "") << ")" << std::endl;
 }
 
 void Material::setNormalTexture(const std::string& texturePath)
 {
-    normalTexture = std::make_unique<Texture>(texturePath);
-    std::cout << "Set normal texture: " << texturePath << " (Valid: " << (normalTexture->isValid() ? "Yes" : "No") << ")" << std::endl;
+    normalTexture = ResourceCache::Get().GetTexture(texturePath);
+    variantDirty = true;
+    std::cout << "Set normal texture: " << texturePath << " (Valid: " << (normalTexture->isValid() ? "Yes" : "No")
+              << (normalTexture->isPending() ? ", streaming" : "") << ")" << std::endl;
 }
 
 void Material::setSpecularTexture(const std::string& texturePath)
 {
-    specularTexture = std::make_unique<Texture>(texturePath);
-    std::cout << "Set specular texture: " << texturePath << " (Valid: " << (specularTexture->isValid() ? "Yes" : "No") << ")" << std::endl;
+    specularTexture = ResourceCache::Get().GetTexture(texturePath);
+    variantDirty = true;
+    std::cout << "Set specular texture: " << texturePath << " (Valid: " << (specularTexture->isValid() ? "Yes" : "No")
+              << (specularTexture->isPending() ? ", streaming" : "") << ")" << std::endl;
 }
 
 void Material::setOcclusionTexture(const std::string& texturePath)
 {
-    occlusionTexture = std::make_unique<Texture>(texturePath);
-    std::cout << "Set occlusion texture: " << texturePath << " (Valid: " << (occlusionTexture->isValid() ? "Yes" : "No") << ")" << std::endl;
+    occlusionTexture = ResourceCache::Get().GetTexture(texturePath);
+    variantDirty = true;
+    std::cout << "Set occlusion texture: " << texturePath << " (Valid: " << (occlusionTexture->isValid() ? "Yes" : "No")
+              << (occlusionTexture->isPending() ? ", streaming" : "") << ")" << std::endl;
 }
 
 void Material::setAdvancedMaterial(std::shared_ptr<AdvancedMaterial> advanced)
 {
     advancedMaterial = advanced;
+    variantDirty = true;
     if (advanced) {
         materialType = MaterialType::PBR_ADVANCED;
         std::cout << "Advanced material attached to basic material system" << std::endl;
     }
 }
 
-void Material::setUniformsAdvanced(GLuint shaderProgram) const
+void Material::setUniformsAdvanced(const Shader& shader) const
 {
     // Set basic PBR uniforms (always available)
-    setUniforms(shaderProgram);
+    setUniforms(shader);
     
-    // Set advanced material type uniform
-    GLint materialTypeLoc = glGetUniformLocation(shaderProgram, "u_materialType");
+    // Set advanced material type uniform; permuted shaders have it as MATERIAL_TYPE instead
+    GLint materialTypeLoc = shader.getUniformLocation(UNIFORM_MATERIAL_TYPE);
     if (materialTypeLoc != -1) {
         glUniform1i(materialTypeLoc, static_cast<int>(materialType));
     }
     
     // Set advanced material parameters based on type
     if (hasAdvancedMaterial()) {
-        GLint hasAdvancedLoc = glGetUniformLocation(shaderProgram, "u_hasAdvancedMaterial");
+        GLint hasAdvancedLoc = shader.getUniformLocation(UNIFORM_HAS_ADVANCED_MATERIAL);
         if (hasAdvancedLoc != -1) {
             glUniform1i(hasAdvancedLoc, 1);
         }
@@ -156,42 +268,42 @@ void Material::setUniformsAdvanced(GLuint shaderProgram) const
         // Set type-specific parameters
         switch (materialType) {
             case MaterialType::DISNEY_BRDF:
-                setDisneyBRDFUniforms(shaderProgram);
+                setDisneyBRDFUniforms(shader);
                 break;
             case MaterialType::METAL_MATERIAL:
-                setMetalMaterialUniforms(shaderProgram);
+                setMetalMaterialUniforms(shader);
                 break;
             case MaterialType::GLASS_MATERIAL:
-                setGlassMaterialUniforms(shaderProgram);
+                setGlassMaterialUniforms(shader);
                 break;
             case MaterialType::SUBSURFACE_MATERIAL:
-                setSubsurfaceMaterialUniforms(shaderProgram);
+                setSubsurfaceMaterialUniforms(shader);
                 break;
             case MaterialType::EMISSIVE_MATERIAL:
-                setEmissiveMaterialUniforms(shaderProgram);
+                setEmissiveMaterialUniforms(shader);
                 break;
             default:
                 break;
         }
     } else {
-        GLint hasAdvancedLoc = glGetUniformLocation(shaderProgram, "u_hasAdvancedMaterial");
+        GLint hasAdvancedLoc = shader.getUniformLocation(UNIFORM_HAS_ADVANCED_MATERIAL);
         if (hasAdvancedLoc != -1) {
             glUniform1i(hasAdvancedLoc, 0);
         }
     }
 }
 
-void Material::setDisneyBRDFUniforms(GLuint shaderProgram) const
+void Material::setDisneyBRDFUniforms(const Shader& shader) const
 {
     // Disney BRDF specific uniforms
-    GLint subsurfaceLoc = glGetUniformLocation(shaderProgram, "u_disney_subsurface");
-    GLint sheenLoc = glGetUniformLocation(shaderProgram, "u_disney_sheen");
-    GLint sheenTintLoc = glGetUniformLocation(shaderProgram, "u_disney_sheenTint");
-    GLint clearcoatLoc = glGetUniformLocation(shaderProgram, "u_disney_clearcoat");
-    GLint clearcoatGlossLoc = glGetUniformLocation(shaderProgram, "u_disney_clearcoatGloss");
-    GLint specularTintLoc = glGetUniformLocation(shaderProgram, "u_disney_specularTint");
-    GLint transmissionLoc = glGetUniformLocation(shaderProgram, "u_disney_transmission");
-    GLint iorLoc = glGetUniformLocation(shaderProgram, "u_disney_ior");
+    GLint subsurfaceLoc = shader.getUniformLocation(UNIFORM_DISNEY_SUBSURFACE);
+    GLint sheenLoc = shader.getUniformLocation(UNIFORM_DISNEY_SHEEN);
+    GLint sheenTintLoc = shader.getUniformLocation(UNIFORM_DISNEY_SHEEN_TINT);
+    GLint clearcoatLoc = shader.getUniformLocation(UNIFORM_DISNEY_CLEARCOAT);
+    GLint clearcoatGlossLoc = shader.getUniformLocation(UNIFORM_DISNEY_CLEARCOAT_GLOSS);
+    GLint specularTintLoc = shader.getUniformLocation(UNIFORM_DISNEY_SPECULAR_TINT);
+    GLint transmissionLoc = shader.getUniformLocation(UNIFORM_DISNEY_TRANSMISSION);
+    GLint iorLoc = shader.getUniformLocation(UNIFORM_DISNEY_IOR);
     
     // Set default Disney parameters (can be enhanced to read from AdvancedMaterial)
     if (subsurfaceLoc != -1) glUniform1f(subsurfaceLoc, 0.2f);
@@ -204,11 +316,11 @@ void Material::setDisneyBRDFUniforms(GLuint shaderProgram) const
     if (iorLoc != -1) glUniform1f(iorLoc, 1.5f);
 }
 
-void Material::setMetalMaterialUniforms(GLuint shaderProgram) const
+void Material::setMetalMaterialUniforms(const Shader& shader) const
 {
     // Metal material specific uniforms
-    GLint etaLoc = glGetUniformLocation(shaderProgram, "u_metal_eta");
-    GLint kLoc = glGetUniformLocation(shaderProgram, "u_metal_k");
+    GLint etaLoc = shader.getUniformLocation(UNIFORM_METAL_ETA);
+    GLint kLoc = shader.getUniformLocation(UNIFORM_METAL_K);
     
     // Default metal properties (Gold)
     if (etaLoc != -1) {
@@ -221,22 +333,22 @@ void Material::setMetalMaterialUniforms(GLuint shaderProgram) const
     }
 }
 
-void Material::setGlassMaterialUniforms(GLuint shaderProgram) const
+void Material::setGlassMaterialUniforms(const Shader& shader) const
 {
     // Glass material specific uniforms
-    GLint iorLoc = glGetUniformLocation(shaderProgram, "u_glass_ior");
-    GLint transmissionLoc = glGetUniformLocation(shaderProgram, "u_glass_transmission");
+    GLint iorLoc = shader.getUniformLocation(UNIFORM_GLASS_IOR);
+    GLint transmissionLoc = shader.getUniformLocation(UNIFORM_GLASS_TRANSMISSION);
     
     if (iorLoc != -1) glUniform1f(iorLoc, 1.5f);
     if (transmissionLoc != -1) glUniform1f(transmissionLoc, 0.95f);
 }
 
-void Material::setSubsurfaceMaterialUniforms(GLuint shaderProgram) const
+void Material::setSubsurfaceMaterialUniforms(const Shader& shader) const
 {
     // Subsurface scattering uniforms
-    GLint sigmaALoc = glGetUniformLocation(shaderProgram, "u_subsurface_sigmaA");
-    GLint sigmaSLoc = glGetUniformLocation(shaderProgram, "u_subsurface_sigmaS");
-    GLint scaleLoc = glGetUniformLocation(shaderProgram, "u_subsurface_scale");
+    GLint sigmaALoc = shader.getUniformLocation(UNIFORM_SUBSURFACE_SIGMA_A);
+    GLint sigmaSLoc = shader.getUniformLocation(UNIFORM_SUBSURFACE_SIGMA_S);
+    GLint scaleLoc = shader.getUniformLocation(UNIFORM_SUBSURFACE_SCALE);
     
     if (sigmaALoc != -1) {
         glm::vec3 sigmaA(0.0017f, 0.0025f, 0.0061f); // Skin absorption
@@ -249,11 +361,11 @@ void Material::setSubsurfaceMaterialUniforms(GLuint shaderProgram) const
     if (scaleLoc != -1) glUniform1f(scaleLoc, 1.0f);
 }
 
-void Material::setEmissiveMaterialUniforms(GLuint shaderProgram) const
+void Material::setEmissiveMaterialUniforms(const Shader& shader) const
 {
     // Emissive material uniforms
-    GLint emissionLoc = glGetUniformLocation(shaderProgram, "u_emission_color");
-    GLint emissionPowerLoc = glGetUniformLocation(shaderProgram, "u_emission_power");
+    GLint emissionLoc = shader.getUniformLocation(UNIFORM_EMISSION_COLOR);
+    GLint emissionPowerLoc = shader.getUniformLocation(UNIFORM_EMISSION_POWER);
     
     if (emissionLoc != -1) {
         glm::vec3 emission(1.0f, 0.8f, 0.6f); // Warm light
@@ -1,6 +1,7 @@
 #pragma once
 #include "Shader.hpp"
 #include "Texture.hpp"
+#include "GLStateCache.hpp"
 #include <glm/glm.hpp>
 #include <GL/glew.h>
 #include <memory>
@@ -26,25 +27,48 @@ private:
     float roughness;
     float ao;
     
-    std::unique_ptr<Texture> diffuseTexture;
-    std::unique_ptr<Texture> normalTexture;
-    std::unique_ptr<Texture> specularTexture;
-    std::unique_ptr<Texture> occlusionTexture;
+    // Shared through ResourceCache; materials using the same path hold the same texture
+    std::shared_ptr<Texture> diffuseTexture;
+    std::shared_ptr<Texture> normalTexture;
+    std::shared_ptr<Texture> specularTexture;
+    std::shared_ptr<Texture> occlusionTexture;
     
     // Material type and advanced material integration
     MaterialType materialType;
     std::shared_ptr<AdvancedMaterial> advancedMaterial;
     
-public:
-    Shader shader;
+    // Unique per instance, used to group draws in the render queue
+    uint32_t sortId;
+    
+    // Shared through ResourceCache; never null, but empty until Init succeeds. Holds the
+    // variant for the current type and textures, reselected after either changes.
+    mutable std::shared_ptr<Shader> shader;
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string baseDefines;
+    mutable bool variantDirty;
     
+    bool selectShaderVariant() const;
+    
+public:
     Material();
     Material(const glm::vec3& albedo, float metallic, float roughness, float ao);
     
     bool Init();
-    bool InitWithShader(const std::string& vertexPath, const std::string& fragmentPath);
-    void setUniforms(GLuint shaderProgram) const;
+    // The program is compiled per permutation: getPermutationDefines() is added to defines, so
+    // the uber shaders drop the branches this material never takes
+    bool InitWithShader(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines = std::string());
+    const Shader& getShader() const;
+    // For a program that failed to build: tries the simple shader, then the default PBR one
+    bool initFallbackShader();
+    
+    // "MATERIAL_TYPE=n" plus a HAS_*_TEXTURE flag per bound texture
+    std::string getPermutationDefines() const;
+    void setUniforms(const Shader& shader) const;
     void bindTextures() const;
+    void bindTextures(GLStateCache& stateCache) const;
+    
+    uint32_t getSortId() const { return sortId; }
     
     void setAlbedo(const glm::vec3& albedo) { this->albedo = albedo; }
     void setMetallic(float metallic) { this->metallic = metallic; }
@@ -66,8 +90,11 @@ public:
     bool hasSpecularTexture() const { return specularTexture && specularTexture->isValid(); }
     bool hasOcclusionTexture() const { return occlusionTexture && occlusionTexture->isValid(); }
     
+    std::string getDiffuseTexturePath() const { return hasDiffuseTexture() ? diffuseTexture->getFilePath() : std::string(); }
+    std::string getNormalTexturePath() const { return hasNormalTexture() ? normalTexture->getFilePath() : std::string(); }
+    
     // Material type management
-    void setMaterialType(MaterialType type) { materialType = type; }
+    void setMaterialType(MaterialType type) { materialType = type; variantDirty = true; }
     MaterialType getMaterialType() const { return materialType; }
     
     // Advanced material integration
@@ -76,14 +103,14 @@ public:
     bool hasAdvancedMaterial() const { return advancedMaterial != nullptr; }
     
     // Enhanced setUniforms that works with both basic PBR and advanced materials
-    void setUniformsAdvanced(GLuint shaderProgram) const;
+    void setUniformsAdvanced(const Shader& shader) const;
     
 private:
     // Helper methods for setting material-specific uniforms
-    void setDisneyBRDFUniforms(GLuint shaderProgram) const;
-    void setMetalMaterialUniforms(GLuint shaderProgram) const;
-    void setGlassMaterialUniforms(GLuint shaderProgram) const;
-    void setSubsurfaceMaterialUniforms(GLuint shaderProgram) const;
-    void setEmissiveMaterialUniforms(GLuint shaderProgram) const;
+    void setDisneyBRDFUniforms(const Shader& shader) const;
+    void setMetalMaterialUniforms(const Shader& shader) const;
+    void setGlassMaterialUniforms(const Shader& shader) const;
+    void setSubsurfaceMaterialUniforms(const Shader& shader) const;
+    void setEmissiveMaterialUniforms(const Shader& shader) const;
 };
 
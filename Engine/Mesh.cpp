@@ -1,44 +1,113 @@
 #include "Mesh.hpp"
+#include "CookedMesh.hpp"
+#include "MeshOptimizer.hpp"
+#include "JobSystem.hpp"
+#include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 
-Mesh::Mesh() : vao(0), vbo(0), ebo(0), isLoaded(false)
+namespace {
+    constexpr uint32_t UNIFORM_POSITION_OFFSET = HashUniformName("positionOffset");
+    constexpr uint32_t UNIFORM_POSITION_SCALE = HashUniformName("positionScale");
+    constexpr uint32_t UNIFORM_TEXCOORD_OFFSET = HashUniformName("texCoordOffset");
+    constexpr uint32_t UNIFORM_TEXCOORD_SCALE = HashUniformName("texCoordScale");
+    constexpr uint32_t UNIFORM_INSTANCED = HashUniformName("instanced");
+    
+    // Submeshes smaller than this are drawn at full detail only
+    const size_t MIN_LOD_INDEX_COUNT = 3 * 256;
+    // A level has to drop at least a quarter of the previous one's triangles to be kept
+    const float MAX_LOD_INDEX_RATIO = 0.75f;
+    
+    const size_t MAX_SHORT_INDEX_VERTICES = 65536;
+    
+    float MaxAxisScale(const glm::mat4& model)
+    {
+        float scale = (std::max)(glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+                                 (std::max)(glm::dot(glm::vec3(model[1]), glm::vec3(model[1])),
+                                            glm::dot(glm::vec3(model[2]), glm::vec3(model[2]))));
+        return std::sqrt(scale);
+    }
+}
+
+unsigned int SubMesh::selectLod(float distance, float pixelScale) const
 {
-    material = std::make_unique<Material>();
-    std::cout << "Creating default material with simple shader..." << std::endl;
-    if (!material->InitWithShader("shaders/simple.vert", "shaders/simple.frag")) {
-        std::cout << "Simple shader failed, trying PBR..." << std::endl;
-        if (!material->Init()) {
-            std::cout << "❌ Failed to initialize any shader in Mesh constructor!" << std::endl;
-        }
+    // Errors only grow along the chain, so the first level that is too coarse ends the search
+    unsigned int lod = 0;
+    while (lod + 1 < lodCount && lods[lod + 1].error * pixelScale <= distance) {
+        ++lod;
     }
-    std::cout << "Mesh constructor - material shader ID: " << material->shader.shaderProgram << std::endl;
+    return lod;
 }
 
-Mesh::Mesh(const std::string& filepath) : vao(0), vbo(0), ebo(0), isLoaded(false)
+unsigned int SubMesh::selectLod(const glm::mat4& model, const glm::vec3& cameraPosition, float lodScale) const
+{
+    float modelScale = MaxAxisScale(model);
+    glm::vec3 worldCenter = glm::vec3(model * glm::vec4(sphere.center, 1.0f));
+    float lodDistance = glm::length(worldCenter - cameraPosition) - sphere.radius * modelScale;
+    return lodDistance > 0.0f ? selectLod(lodDistance, lodScale * modelScale) : 0;
+}
+
+Mesh::Mesh() : vao(0), vbo(0), ebo(0), indexCount(0), indexType(GL_UNSIGNED_INT), isLoaded(false)
+{
+    materials.push_back(createDefaultMaterial());
+}
+
+Mesh::Mesh(const std::string& filepath) : vao(0), vbo(0), ebo(0), indexCount(0), indexType(GL_UNSIGNED_INT), isLoaded(false)
 {
-    material = std::make_unique<Material>();
     std::cout << "Creating material for file: " << filepath << std::endl;
+    materials.push_back(createDefaultMaterial());
+    loadFromFile(filepath);
+}
+
+Mesh::~Mesh()
+{
+    cleanup();
+}
+
+std::unique_ptr<Material> Mesh::createDefaultMaterial() const
+{
+    auto material = std::make_unique<Material>();
+    std::cout << "Creating default material with simple shader..." << std::endl;
     if (!material->InitWithShader("shaders/simple.vert", "shaders/simple.frag")) {
         std::cout << "Simple shader failed, trying PBR..." << std::endl;
         if (!material->Init()) {
-            std::cout << "❌ Failed to initialize any shader in filepath constructor!" << std::endl;
+            std::cout << "❌ Failed to initialize any shader for default material!" << std::endl;
         }
     }
-    std::cout << "Filepath constructor - material shader ID: " << material->shader.shaderProgram << std::endl;
-    loadFromFile(filepath);
+    std::cout << "Default material shader ID: " << material->getShader().shaderProgram << std::endl;
+    return material;
 }
 
-Mesh::~Mesh()
+void Mesh::setMaterial(std::unique_ptr<Material> mat)
 {
-    cleanup();
+    materials.clear();
+    materials.push_back(std::move(mat));
+    for (auto& subMesh : subMeshes) {
+        subMesh.materialIndex = 0;
+    }
 }
 
 bool Mesh::loadFromFile(const std::string& filepath)
 {
     cleanup();
     
+    // Extract directory for texture loading
+    size_t lastSlash = filepath.find_last_of("/\\");
+    if (lastSlash != std::string::npos) {
+        modelDirectory = filepath.substr(0, lastSlash);
+    } else {
+        modelDirectory = ".";
+    }
+    
+    // A cooked copy skips Assimp entirely; the import below is the fallback and re-cooks
+    if (loadCooked(filepath)) {
+        return true;
+    }
+    
     Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile(filepath, 
         aiProcess_Triangulate | 
@@ -59,33 +128,234 @@ bool Mesh::loadFromFile(const std::string& filepath)
     
     vertices.clear();
     indices.clear();
-    unsigned int vertexOffset = 0;
+    subMeshes.clear();
+    bounds = AABB();
     
-    // Extract directory for texture loading
-    size_t lastSlash = filepath.find_last_of("/\\");
-    if (lastSlash != std::string::npos) {
-        modelDirectory = filepath.substr(0, lastSlash);
-    } else {
-        modelDirectory = ".";
-    }
+    // Each scene material is loaded once; submeshes refer to it by index
+    loadMaterials(scene);
     
     for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
-        processMesh(scene->mMeshes[i], scene);
+        aiMesh* assimpMesh = scene->mMeshes[i];
+        unsigned int materialIndex = assimpMesh->mMaterialIndex < materials.size() ? assimpMesh->mMaterialIndex : 0;
+        processMesh(assimpMesh, materialIndex);
     }
     
+    std::stable_sort(subMeshes.begin(), subMeshes.end(), [](const SubMesh& a, const SubMesh& b) {
+        return a.materialIndex < b.materialIndex;
+    });
+    
+    std::cout << "Loaded " << subMeshes.size() << " submeshes with " << materials.size() << " materials" << std::endl;
+    
     if (vertices.empty() || indices.empty()) {
         std::cerr << "ERROR::MESH:: No valid mesh data loaded from: " << filepath << std::endl;
         return false;
     }
     
-    setupMesh();
+    optimizeGeometry();
+    
+    // The GPU copy is quantised, with 16-bit indices when every submesh fits them
+    std::vector<PackedVertex> packedVertices(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        packedVertices[i] = MeshOptimizer::Quantize(vertices[i], quantization);
+    }
+    std::vector<uint16_t> shortIndices;
+    const void* indexData = indices.data();
+    if (indexType == GL_UNSIGNED_SHORT) {
+        shortIndices.assign(indices.begin(), indices.end());
+        indexData = shortIndices.data();
+    }
+    
+    setupMesh(packedVertices.data(), packedVertices.size(), indexData, indices.size());
+    writeCooked(filepath, packedVertices, indexData);
+    isLoaded = true;
+    return true;
+}
+
+void Mesh::optimizeGeometry()
+{
+    // Per submesh, in parallel: cache order for each level of an LOD chain, then fetch order
+    // for the vertices they share
+    struct Optimized {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        SubMeshLod lods[MAX_MESH_LODS];
+        unsigned int lodCount;
+    };
+    std::vector<Optimized> results(subMeshes.size());
+    
+    JobSystem::Get().ParallelFor(subMeshes.size(), 1, [this, &results](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const SubMesh& subMesh = subMeshes[i];
+            Optimized& result = results[i];
+            result.vertices.assign(vertices.begin() + subMesh.baseVertex,
+                                   vertices.begin() + subMesh.baseVertex + subMesh.vertexCount);
+            std::vector<unsigned int> level(indices.begin() + subMesh.firstIndex,
+                                            indices.begin() + subMesh.firstIndex + subMesh.indexCount);
+            
+            // Each level is simplified from the one before, so their errors add up
+            float error = 0.0f;
+            result.lodCount = 0;
+            for (;;) {
+                MeshOptimizer::OptimizeVertexCache(level.data(), level.size(), result.vertices.size());
+                SubMeshLod& lod = result.lods[result.lodCount++];
+                lod.firstIndex = static_cast<unsigned int>(result.indices.size());
+                lod.indexCount = static_cast<unsigned int>(level.size());
+                lod.error = error;
+                result.indices.insert(result.indices.end(), level.begin(), level.end());
+                
+                if (result.lodCount == MAX_MESH_LODS || level.size() < MIN_LOD_INDEX_COUNT) break;
+                
+                std::vector<unsigned int> simplified;
+                float levelError = MeshOptimizer::Simplify(result.vertices.data(), result.vertices.size(), level.data(),
+                                                           level.size(), level.size() / 2, simplified);
+                if (simplified.size() > level.size() * MAX_LOD_INDEX_RATIO) break;
+                error += levelError;
+                level.swap(simplified);
+            }
+            
+            // The full-detail level comes first, so it decides the vertex order
+            MeshOptimizer::OptimizeVertexFetch(result.vertices, result.indices);
+        }
+    });
+    
+    vertices.clear();
+    indices.clear();
+    size_t lodIndexCount = 0;
+    size_t largestSubMesh = 0;
+    for (size_t i = 0; i < subMeshes.size(); ++i) {
+        SubMesh& subMesh = subMeshes[i];
+        Optimized& result = results[i];
+        unsigned int indexBase = static_cast<unsigned int>(indices.size());
+        
+        subMesh.baseVertex = static_cast<int>(vertices.size());
+        subMesh.lodCount = result.lodCount;
+        for (unsigned int lod = 0; lod < result.lodCount; ++lod) {
+            subMesh.lods[lod] = result.lods[lod];
+            subMesh.lods[lod].firstIndex += indexBase;
+        }
+        subMesh.firstIndex = subMesh.lods[0].firstIndex;
+        subMesh.indexCount = subMesh.lods[0].indexCount;
+        
+        vertices.insert(vertices.end(), result.vertices.begin(), result.vertices.end());
+        indices.insert(indices.end(), result.indices.begin(), result.indices.end());
+        lodIndexCount += result.indices.size() - subMesh.indexCount;
+        largestSubMesh = (std::max)(largestSubMesh, static_cast<size_t>(subMesh.vertexCount));
+    }
+    
+    indexType = largestSubMesh <= MAX_SHORT_INDEX_VERTICES ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    quantization = MeshOptimizer::ComputeQuantization(vertices.data(), vertices.size());
+    
+    std::cout << "Optimised mesh: " << vertices.size() << " vertices, " << (indices.size() - lodIndexCount) / 3
+              << " triangles plus " << lodIndexCount / 3 << " in LODs, "
+              << (indexType == GL_UNSIGNED_SHORT ? 16 : 32) << "-bit indices" << std::endl;
+}
+
+bool Mesh::loadCooked(const std::string& sourcePath)
+{
+    CookedMesh cooked;
+    if (!cooked.Open(CookedMesh::GetCookedPath(sourcePath), sourcePath)) {
+        return false;
+    }
+    
+    const CookedMeshHeader& header = cooked.GetHeader();
+    
+    subMeshes.clear();
+    const CookedSubMesh* cookedSubMeshes = cooked.GetSubMeshes();
+    for (uint32_t i = 0; i < header.subMeshCount; ++i) {
+        const CookedSubMesh& record = cookedSubMeshes[i];
+        SubMesh subMesh;
+        subMesh.firstIndex = record.firstIndex;
+        subMesh.indexCount = record.indexCount;
+        subMesh.baseVertex = record.baseVertex;
+        subMesh.vertexCount = record.vertexCount;
+        subMesh.materialIndex = record.materialIndex < header.materialCount ? record.materialIndex : 0;
+        subMesh.lodCount = (std::max)(1u, (std::min)(record.lodCount, MAX_MESH_LODS));
+        for (unsigned int lod = 0; lod < subMesh.lodCount; ++lod) {
+            subMesh.lods[lod].firstIndex = record.lods[lod].firstIndex;
+            subMesh.lods[lod].indexCount = record.lods[lod].indexCount;
+            subMesh.lods[lod].error = record.lods[lod].error;
+        }
+        subMesh.bounds = AABB(glm::vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]),
+                              glm::vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]));
+        subMesh.sphere = subMesh.bounds.boundingSphere();
+        subMeshes.push_back(subMesh);
+    }
+    bounds = AABB(glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]),
+                  glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]));
+    
+    if (header.materialCount > 0) {
+        materials.clear();
+        const CookedMaterial* cookedMaterials = cooked.GetMaterials();
+        for (uint32_t i = 0; i < header.materialCount; ++i) {
+            const CookedMaterial& record = cookedMaterials[i];
+            auto material = createDefaultMaterial();
+            material->setAlbedo(glm::vec3(record.albedo[0], record.albedo[1], record.albedo[2]));
+            material->setMetallic(record.metallic);
+            material->setRoughness(record.roughness);
+            material->setAO(record.ao);
+            if (record.diffuseTexture[0]) material->setDiffuseTexture(record.diffuseTexture);
+            if (record.normalTexture[0]) material->setNormalTexture(record.normalTexture);
+            materials.push_back(std::move(material));
+        }
+    }
+    
+    // Vertex and index data go from the mapping straight into GL buffers
+    quantization = cooked.GetQuantization();
+    indexType = header.indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    setupMesh(cooked.GetVertices(), static_cast<size_t>(header.vertexCount),
+              cooked.GetIndices(), static_cast<size_t>(header.indexCount));
+    
+    // Keep the CPU copy the Assimp path has too, for ray tracing (BVHScene)
+    const PackedVertex* packedVertices = cooked.GetVertices();
+    vertices.resize(static_cast<size_t>(header.vertexCount));
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        vertices[i] = MeshOptimizer::Dequantize(packedVertices[i], quantization);
+    }
+    if (indexType == GL_UNSIGNED_SHORT) {
+        const uint16_t* shortIndices = static_cast<const uint16_t*>(cooked.GetIndices());
+        indices.assign(shortIndices, shortIndices + header.indexCount);
+    } else {
+        const uint32_t* longIndices = static_cast<const uint32_t*>(cooked.GetIndices());
+        indices.assign(longIndices, longIndices + header.indexCount);
+    }
     isLoaded = true;
+    
+    std::cout << "Loaded cooked mesh for " << sourcePath << ": " << subMeshes.size() << " submeshes, "
+              << header.vertexCount << " vertices" << std::endl;
     return true;
 }
 
-void Mesh::processMesh(aiMesh* mesh, const aiScene* scene)
+void Mesh::writeCooked(const std::string& sourcePath, const std::vector<PackedVertex>& packedVertices,
+                       const void* indexData) const
 {
-    unsigned int vertexOffset = static_cast<unsigned int>(vertices.size());
+    std::vector<CookedMaterial> cookedMaterials;
+    for (const auto& material : materials) {
+        CookedMaterial record;
+        std::memset(&record, 0, sizeof(record));
+        glm::vec3 albedo = material->getAlbedo();
+        record.albedo[0] = albedo.r;
+        record.albedo[1] = albedo.g;
+        record.albedo[2] = albedo.b;
+        record.metallic = material->getMetallic();
+        record.roughness = material->getRoughness();
+        record.ao = material->getAO();
+        std::string diffusePath = material->getDiffuseTexturePath();
+        std::string normalPath = material->getNormalTexturePath();
+        std::memcpy(record.diffuseTexture, diffusePath.c_str(), (std::min)(diffusePath.size(), sizeof(record.diffuseTexture) - 1));
+        std::memcpy(record.normalTexture, normalPath.c_str(), (std::min)(normalPath.size(), sizeof(record.normalTexture) - 1));
+        cookedMaterials.push_back(record);
+    }
+    
+    CookedMesh::Write(CookedMesh::GetCookedPath(sourcePath), sourcePath, packedVertices, quantization, indexData,
+                      indices.size(), getIndexSize(), subMeshes, cookedMaterials, bounds);
+}
+
+void Mesh::processMesh(aiMesh* mesh, unsigned int materialIndex)
+{
+    SubMesh subMesh;
+    subMesh.firstIndex = static_cast<unsigned int>(indices.size());
+    subMesh.baseVertex = static_cast<int>(vertices.size());
+    subMesh.materialIndex = materialIndex;
     
     for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
         Vertex vertex;
@@ -115,31 +385,54 @@ void Mesh::processMesh(aiMesh* mesh, const aiScene* scene)
             std::cout << "Warning: Mesh has no texture coordinates!" << std::endl;
         }
         
+        subMesh.bounds.expand(vertex.position);
         vertices.push_back(vertex);
     }
+    subMesh.sphere = subMesh.bounds.boundingSphere();
     
     for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
         aiFace face = mesh->mFaces[i];
         for (unsigned int j = 0; j < face.mNumIndices; j++) {
-            indices.push_back(vertexOffset + face.mIndices[j]);
+            indices.push_back(face.mIndices[j]);
         }
     }
     
-    // Load material if available
-    std::cout << "Mesh material index: " << mesh->mMaterialIndex << std::endl;
+    subMesh.vertexCount = mesh->mNumVertices;
+    subMesh.indexCount = static_cast<unsigned int>(indices.size()) - subMesh.firstIndex;
+    
+    // Just the full-detail level until optimizeGeometry builds the chain
+    subMesh.lods[0].firstIndex = subMesh.firstIndex;
+    subMesh.lods[0].indexCount = subMesh.indexCount;
+    subMesh.lods[0].error = 0.0f;
+    subMesh.lodCount = 1;
+    if (subMesh.indexCount > 0) {
+        bounds.expand(subMesh.bounds);
+        subMeshes.push_back(subMesh);
+    }
+}
+
+void Mesh::loadMaterials(const aiScene* scene)
+{
     std::cout << "Scene has " << scene->mNumMaterials << " materials" << std::endl;
+    if (scene->mNumMaterials == 0) {
+        // Keep the default material so every submesh has something to draw with
+        if (materials.empty()) {
+            materials.push_back(createDefaultMaterial());
+        }
+        return;
+    }
     
-    if (mesh->mMaterialIndex >= 0 && mesh->mMaterialIndex < (int)scene->mNumMaterials) {
-        std::cout << "🔄 Loading material " << mesh->mMaterialIndex << " from scene" << std::endl;
+    materials.clear();
+    for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
+        std::cout << "🔄 Loading material " << i << " from scene" << std::endl;
+        auto material = createDefaultMaterial();
         // Pass scene pointer to material loader so it can access embedded textures
-        loadMaterialFromAssimp(scene->mMaterials[mesh->mMaterialIndex], scene, modelDirectory);
-        std::cout << "✅ Material loading complete" << std::endl;
-    } else {
-        std::cout << "❌ No valid material index for this mesh (index: " << mesh->mMaterialIndex << ", available: " << scene->mNumMaterials << ")" << std::endl;
+        loadMaterialFromAssimp(material.get(), scene->mMaterials[i], scene, modelDirectory);
+        materials.push_back(std::move(material));
     }
 }
 
-void Mesh::setupMesh()
+void Mesh::setupMesh(const PackedVertex* vertexData, size_t vertexCount, const void* indexData, size_t indexDataCount)
 {
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
@@ -147,31 +440,114 @@ void Mesh::setupMesh()
     
     glBindVertexArray(vao);
     
+    // Static geometry never changes after upload, so use immutable storage where available
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    if (GLEW_ARB_buffer_storage) {
+        glBufferStorage(GL_ARRAY_BUFFER, vertexCount * sizeof(PackedVertex), vertexData, 0);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(PackedVertex), vertexData, GL_STATIC_DRAW);
+    }
     
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    if (GLEW_ARB_buffer_storage) {
+        glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, indexDataCount * getIndexSize(), indexData, 0);
+    } else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexDataCount * getIndexSize(), indexData, GL_STATIC_DRAW);
+    }
+    indexCount = static_cast<GLsizei>(indexDataCount);
     
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    // Normalised integers; mesh_vertex.glsl scales them back with bindVertexDecode's ranges
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
     glEnableVertexAttribArray(0);
     
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
     glEnableVertexAttribArray(1);
     
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+    glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
     glEnableVertexAttribArray(2);
     
     glBindVertexArray(0);
+    
+    if (instanceBuffer) {
+        instanceBuffer->SetLocalBounds(bounds);
+        instanceBuffer->AttachToVertexArray(vao);
+    }
+}
+
+void Mesh::bind() const
+{
+    glBindVertexArray(vao);
+}
+
+void Mesh::unbind() const
+{
+    glBindVertexArray(0);
+}
+
+void Mesh::drawSubMesh(const SubMesh& subMesh, GLsizei instanceCount, unsigned int lod) const
+{
+    const SubMeshLod& range = subMesh.lods[(std::min)(lod, subMesh.lodCount - 1)];
+    const void* indexOffset = reinterpret_cast<const void*>(static_cast<uintptr_t>(range.firstIndex) * getIndexSize());
+    if (isInstanced() || instanceCount > 1) {
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(range.indexCount), indexType,
+                                          indexOffset, instanceCount, subMesh.baseVertex);
+    } else {
+        glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(range.indexCount), indexType,
+                                 indexOffset, subMesh.baseVertex);
+    }
+}
+
+void Mesh::bindVertexDecode(const Shader& shader) const
+{
+    GLint location = shader.getUniformLocation(UNIFORM_POSITION_OFFSET);
+    if (location != -1) glUniform3fv(location, 1, glm::value_ptr(quantization.positionOffset));
+    location = shader.getUniformLocation(UNIFORM_POSITION_SCALE);
+    if (location != -1) glUniform3fv(location, 1, glm::value_ptr(quantization.positionScale));
+    location = shader.getUniformLocation(UNIFORM_TEXCOORD_OFFSET);
+    if (location != -1) glUniform2fv(location, 1, glm::value_ptr(quantization.texCoordOffset));
+    location = shader.getUniformLocation(UNIFORM_TEXCOORD_SCALE);
+    if (location != -1) glUniform2fv(location, 1, glm::value_ptr(quantization.texCoordScale));
+    location = shader.getUniformLocation(UNIFORM_INSTANCED);
+    if (location != -1) glUniform1i(location, isInstanced() ? 1 : 0);
 }
 
+void Mesh::setInstances(const std::vector<Transform>& transforms)
+{
+    if (!instanceBuffer) {
+        instanceBuffer = std::make_unique<InstanceBuffer>();
+        if (vao) {
+            instanceBuffer->AttachToVertexArray(vao);
+        }
+    }
+    instanceBuffer->SetLocalBounds(bounds);
+    instanceBuffer->SetTransforms(transforms);
+}
+
+void Mesh::clearInstances()
+{
+    if (!instanceBuffer) return;
+    
+    if (vao) {
+        glBindVertexArray(vao);
+        for (GLuint column = 0; column < 4; ++column) {
+            glDisableVertexAttribArray(INSTANCE_MATRIX_ATTRIBUTE + column);
+        }
+        glBindVertexArray(0);
+    }
+    instanceBuffer.reset();
+}
+
+// Draws every submesh with whatever material state is currently bound
 void Mesh::render() const
 {
     if (!isValid()) return;
     
-    glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    GLsizei instanceCount = isInstanced() ? instanceBuffer->GetVisibleCount() : 1;
+    bind();
+    for (const auto& subMesh : subMeshes) {
+        drawSubMesh(subMesh, instanceCount);
+    }
+    unbind();
 }
 
 void Mesh::cleanup()
@@ -190,6 +566,10 @@ void Mesh::cleanup()
     }
     vertices.clear();
     indices.clear();
+    subMeshes.clear();
+    indexCount = 0;
+    indexType = GL_UNSIGNED_INT;
+    quantization = VertexQuantization();
     isLoaded = false;
 }
 
@@ -198,9 +578,9 @@ bool Mesh::fileExists(const std::string& path) {
     return file.good();
 }
 
-void Mesh::loadMaterialFromAssimp(const aiMaterial* assimpMaterial, const aiScene* scene, const std::string& directory)
+void Mesh::loadMaterialFromAssimp(Material* material, const aiMaterial* assimpMaterial, const aiScene* scene, const std::string& directory)
 {
-    if (!assimpMaterial) {
+    if (!material || !assimpMaterial) {
         std::cout << "ERROR: No material provided to loadMaterialFromAssimp" << std::endl;
         return;
     }
@@ -406,20 +786,15 @@ void Mesh::loadMaterialFromAssimp(const aiMaterial* assimpMaterial, const aiScen
     }
     
     // Ensure the material has a proper shader loaded
-    if (!material->shader.shaderProgram) {
-        std::cout << "Material shader not initialized - trying simple shader first" << std::endl;
-        if (!material->InitWithShader("shaders/simple.vert", "shaders/simple.frag")) {
-            std::cout << "❌ Failed to load simple shader, trying PBR..." << std::endl;
-            if (!material->Init()) {
-                std::cout << "❌ Failed to initialize any material shader!" << std::endl;
-            } else {
-                std::cout << "✅ PBR shader loaded as fallback" << std::endl;
-            }
+    if (!material->getShader().shaderProgram) {
+        std::cout << "Material shader not initialized - trying the fallback shaders" << std::endl;
+        if (!material->initFallbackShader()) {
+            std::cout << "❌ Failed to initialize any material shader!" << std::endl;
         } else {
-            std::cout << "✅ Simple shader loaded successfully" << std::endl;
+            std::cout << "✅ Fallback shader loaded" << std::endl;
         }
     } else {
-        std::cout << "✅ Material already has shader program: " << material->shader.shaderProgram << std::endl;
+        std::cout << "✅ Material already has shader program: " << material->getShader().shaderProgram << std::endl;
     }
     
     // Final material state check
@@ -430,7 +805,7 @@ void Mesh::loadMaterialFromAssimp(const aiMaterial* assimpMaterial, const aiScen
     std::cout << "Has Diffuse Texture: " << (material->hasDiffuseTexture() ? "Yes" : "No") << std::endl;
     std::cout << "Has Normal Texture: " << (material->hasNormalTexture() ? "Yes" : "No") << std::endl;
     std::cout << "Material Type: " << (int)material->getMaterialType() << std::endl;
-    std::cout << "Shader Program ID: " << material->shader.shaderProgram << std::endl;
+    std::cout << "Shader Program ID: " << material->getShader().shaderProgram << std::endl;
     
     std::cout << "=== MATERIAL LOADING DEBUG COMPLETE ===" << std::endl;
     
@@ -2,6 +2,8 @@
 #include "Transform.hpp"  
 #include "Vertex.hpp"
 #include "Material.hpp"
+#include "Bounds.hpp"
+#include "InstanceBuffer.hpp"
 #include <GL/glew.h>
 #include <vector>
 #include <string>
@@ -11,20 +13,75 @@
 #include <assimp/postprocess.h>
 #include <glm/glm.hpp>
 
+// Levels of detail per submesh, the full-detail one included
+const unsigned int MAX_MESH_LODS = 4;
+
+// One level of a submesh's LOD chain: its own range of the index buffer over the submesh's
+// vertices, and how far (model units) its surface strays from the full-detail one
+struct SubMeshLod {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    float error;
+};
+
+// Range of the shared index buffer drawn with a single material.
+// Indices are local to the submesh and offset by baseVertex at draw time.
+struct SubMesh {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    int baseVertex;
+    unsigned int vertexCount;
+    unsigned int materialIndex;
+    
+    // Model-space bounds, computed at load time
+    AABB bounds;
+    BoundingSphere sphere;
+    
+    // lods[0] is the full-detail range above; each further level has about half the triangles
+    SubMeshLod lods[MAX_MESH_LODS];
+    unsigned int lodCount;
+    
+    // Coarsest level whose error projects to less than the allowed pixels at this distance.
+    // pixelScale is the viewport height over 2 tan(fovY / 2), times the model's largest axis
+    // scale, over the pixels allowed.
+    unsigned int selectLod(float distance, float pixelScale) const;
+    
+    // The level for this submesh placed by model: distance is measured to the nearest point of
+    // the bounding sphere, and from inside it the full mesh is drawn. lodScale is pixelScale
+    // before the model's scale. SelectLod in gpu_cull.comp is the same code for GPU culling.
+    unsigned int selectLod(const glm::mat4& model, const glm::vec3& cameraPosition, float lodScale) const;
+};
+
 class Mesh : public Transform  
 {  
 private:
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
     GLuint vao, vbo, ebo;
+    GLsizei indexCount;
+    GLenum indexType;                   // GL_UNSIGNED_SHORT when every submesh fits in 16 bits
+    VertexQuantization quantization;    // Ranges the GPU copy's vertices are packed into
     bool isLoaded;
-    std::unique_ptr<Material> material;
+    
+    // Submeshes are kept sorted by materialIndex so consecutive draws share material state
+    std::vector<SubMesh> subMeshes;
+    std::vector<std::unique_ptr<Material>> materials;
+    AABB bounds;
     std::string modelDirectory;
     
-    void setupMesh();
+    // Set when the mesh is drawn as many copies through one instanced draw
+    std::unique_ptr<InstanceBuffer> instanceBuffer;
+    
+    void setupMesh(const PackedVertex* vertexData, size_t vertexCount, const void* indexData, size_t indexDataCount);
+    bool loadCooked(const std::string& sourcePath);
+    void writeCooked(const std::string& sourcePath, const std::vector<PackedVertex>& packedVertices,
+                     const void* indexData) const;
+    void optimizeGeometry();
     void loadMesh(const std::string& filepath);
-    void processMesh(aiMesh* mesh, const aiScene* scene);
-    void loadMaterialFromAssimp(const aiMaterial* assimpMaterial, const aiScene* scene, const std::string& directory);
+    void processMesh(aiMesh* mesh, unsigned int materialIndex);
+    void loadMaterials(const aiScene* scene);
+    void loadMaterialFromAssimp(Material* material, const aiMaterial* assimpMaterial, const aiScene* scene, const std::string& directory);
+    std::unique_ptr<Material> createDefaultMaterial() const;
     bool fileExists(const std::string& path);
 
 public:  
@@ -36,9 +93,38 @@ public:
     void render() const;
     void cleanup();
     
-    GLsizei getIndexCount() const { return static_cast<GLsizei>(indices.size()); }
-    bool isValid() const { return isLoaded && !indices.empty(); }
+    // Submesh drawing: bind once, then issue one draw per submesh
+    void bind() const;
+    void unbind() const;
+    // More than one instance of a plain mesh is an instanced draw too, for passes that index
+    // something else (shadow faces) with gl_InstanceID
+    void drawSubMesh(const SubMesh& subMesh, GLsizei instanceCount = 1, unsigned int lod = 0) const;
+    
+    // Sets the ranges mesh_vertex.glsl unpacks this mesh's vertices with, and whether it reads
+    // the instance matrix attribute; call with the program in use before drawing
+    void bindVertexDecode(const Shader& shader) const;
+    
+    // Instancing: the model transform places the whole set, each instance adds its own transform
+    void setInstances(const std::vector<Transform>& transforms);
+    void clearInstances();
+    bool isInstanced() const { return instanceBuffer != nullptr; }
+    InstanceBuffer* getInstanceBuffer() const { return instanceBuffer.get(); }
+    
+    GLuint getVAO() const { return vao; }
+    GLsizei getIndexCount() const { return indexCount; }
+    GLenum getIndexType() const { return indexType; }
+    size_t getIndexSize() const { return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t); }
+    bool isValid() const { return isLoaded && indexCount > 0; }
+    
+    const std::vector<SubMesh>& getSubMeshes() const { return subMeshes; }
+    
+    // CPU copy of the model-space geometry as floats; submesh indices are relative to baseVertex
+    const std::vector<Vertex>& getVertices() const { return vertices; }
+    const std::vector<unsigned int>& getIndices() const { return indices; }
+    const AABB& getBounds() const { return bounds; }
+    size_t getMaterialCount() const { return materials.size(); }
+    Material* getMaterial(size_t index = 0) const { return index < materials.size() ? materials[index].get() : nullptr; }
     
-    Material* getMaterial() const { return material.get(); }
-    void setMaterial(std::unique_ptr<Material> mat) { material = std::move(mat); }
+    // Replaces the material table with a single material shared by every submesh
+    void setMaterial(std::unique_ptr<Material> mat);
 };
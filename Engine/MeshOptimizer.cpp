@@ -0,0 +1,482 @@
+#include "MeshOptimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+
+namespace {
+    // Forsyth's scoring constants; 32 entries is a conservative guess at the cache of current GPUs
+    const int CACHE_SIZE = 32;
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+
+    const uint32_t NO_VERTEX = 0xFFFFFFFFu;
+
+    float VertexScore(int cachePosition, uint32_t remainingTriangles)
+    {
+        if (remainingTriangles == 0) {
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            // The last triangle's vertices score a little lower, so strips do not turn back on themselves
+            if (cachePosition < 3) {
+                score = LAST_TRIANGLE_SCORE;
+            } else {
+                float scaler = 1.0f / (CACHE_SIZE - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+
+        // Vertices with few triangles left are finished off before they are evicted
+        score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+        return score;
+    }
+
+    // Sum of squared distances to a set of planes, weighted by triangle area (Garland-Heckbert)
+    struct Quadric {
+        double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+        double weight;
+
+        Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0), weight(0) {}
+
+        static Quadric FromTriangle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+        {
+            Quadric q;
+            glm::dvec3 normal = glm::cross(glm::dvec3(p1 - p0), glm::dvec3(p2 - p0));
+            double length = glm::length(normal);
+            if (length <= 0.0) {
+                return q;
+            }
+            normal /= length;
+            double area = length * 0.5;
+            double d = -glm::dot(normal, glm::dvec3(p0));
+
+            q.a2 = normal.x * normal.x * area;
+            q.ab = normal.x * normal.y * area;
+            q.ac = normal.x * normal.z * area;
+            q.ad = normal.x * d * area;
+            q.b2 = normal.y * normal.y * area;
+            q.bc = normal.y * normal.z * area;
+            q.bd = normal.y * d * area;
+            q.c2 = normal.z * normal.z * area;
+            q.cd = normal.z * d * area;
+            q.d2 = d * d * area;
+            q.weight = area;
+            return q;
+        }
+
+        Quadric& operator+=(const Quadric& other)
+        {
+            a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+            b2 += other.b2; bc += other.bc; bd += other.bd;
+            c2 += other.c2; cd += other.cd; d2 += other.d2;
+            weight += other.weight;
+            return *this;
+        }
+
+        // Mean squared distance of p to the planes
+        double Evaluate(const glm::vec3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double sum = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+                       + b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+                       + c2 * z * z + 2.0 * cd * z + d2;
+            return weight > 0.0 ? (std::max)(sum, 0.0) / weight : 0.0;
+        }
+    };
+
+    struct Collapse {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+
+        bool operator>(const Collapse& other) const { return cost > other.cost; }
+    };
+
+    uint16_t QuantizeUnorm(float value)
+    {
+        return static_cast<uint16_t>(std::lround(glm::clamp(value, 0.0f, 1.0f) * 65535.0f));
+    }
+
+    int16_t QuantizeSnorm(float value)
+    {
+        return static_cast<int16_t>(std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    // Zero-width ranges keep a zero scale and quantise to 0
+    float NormalizeInRange(float value, float offset, float scale)
+    {
+        return scale > 0.0f ? (value - offset) / scale : 0.0f;
+    }
+
+    // Octahedral mapping: the unit sphere folded onto the [-1, 1] square
+    glm::vec2 EncodeOctahedral(glm::vec3 normal)
+    {
+        float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        if (sum <= 0.0f) {
+            return glm::vec2(0.0f);
+        }
+        normal /= sum;
+        glm::vec2 encoded(normal.x, normal.y);
+        if (normal.z < 0.0f) {
+            encoded = glm::vec2((1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f),
+                                (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f));
+        }
+        return encoded;
+    }
+
+    // Mirrors meshNormal() in mesh_vertex.glsl
+    glm::vec3 DecodeOctahedral(const glm::vec2& encoded)
+    {
+        glm::vec3 normal(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+        float fold = (std::max)(-normal.z, 0.0f);
+        normal.x += normal.x >= 0.0f ? -fold : fold;
+        normal.y += normal.y >= 0.0f ? -fold : fold;
+        return glm::normalize(normal);
+    }
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2 || vertexCount == 0) {
+        return;
+    }
+
+    // Triangles of each vertex; the first remaining[v] entries of its range are not yet emitted
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        remaining[indices[i]]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+    }
+    std::vector<uint32_t> adjacency(adjacencyOffsets[vertexCount]);
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int corner = 0; corner < 3; ++corner) {
+            adjacency[fill[indices[t * 3 + corner]]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        vertexScore[v] = VertexScore(-1, remaining[v]);
+    }
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+    }
+
+    std::vector<uint32_t> cache, nextCache;
+    cache.reserve(CACHE_SIZE + 3);
+    nextCache.reserve(CACHE_SIZE + 3);
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+
+    size_t searchCursor = 0;
+    size_t best = 0;
+    for (size_t t = 1; t < triangleCount; ++t) {
+        if (triangleScore[t] > triangleScore[best]) best = t;
+    }
+
+    while (output.size() < triangleCount * 3) {
+        // Nothing in the cache leads anywhere: continue with the next unemitted triangle in order
+        if (best == triangleCount) {
+            while (emitted[searchCursor]) ++searchCursor;
+            best = searchCursor;
+        }
+
+        const uint32_t* triangle = indices + best * 3;
+        emitted[best] = true;
+        nextCache.assign(triangle, triangle + 3);
+        for (int corner = 0; corner < 3; ++corner) {
+            uint32_t v = triangle[corner];
+            output.push_back(v);
+
+            uint32_t* first = &adjacency[adjacencyOffsets[v]];
+            uint32_t* last = first + remaining[v];
+            uint32_t* found = std::find(first, last, static_cast<uint32_t>(best));
+            std::swap(*found, *(last - 1));
+            remaining[v]--;
+        }
+
+        for (uint32_t v : cache) {
+            if (v != nextCache[0] && v != nextCache[1] && v != nextCache[2]) {
+                nextCache.push_back(v);
+            }
+        }
+
+        // Evicted vertices drop their cache bonus
+        for (size_t i = CACHE_SIZE; i < nextCache.size(); ++i) {
+            cachePosition[nextCache[i]] = -1;
+            vertexScore[nextCache[i]] = VertexScore(-1, remaining[nextCache[i]]);
+        }
+        if (nextCache.size() > static_cast<size_t>(CACHE_SIZE)) {
+            nextCache.resize(CACHE_SIZE);
+        }
+        for (size_t i = 0; i < nextCache.size(); ++i) {
+            cachePosition[nextCache[i]] = static_cast<int>(i);
+            vertexScore[nextCache[i]] = VertexScore(static_cast<int>(i), remaining[nextCache[i]]);
+        }
+
+        // Only triangles touching the cache changed score, and the best next one is among them
+        best = triangleCount;
+        float bestScore = -1.0f;
+        for (uint32_t v : nextCache) {
+            for (uint32_t i = 0; i < remaining[v]; ++i) {
+                uint32_t t = adjacency[adjacencyOffsets[v] + i];
+                const uint32_t* candidate = indices + t * 3;
+                triangleScore[t] = vertexScore[candidate[0]] + vertexScore[candidate[1]] + vertexScore[candidate[2]];
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+        cache.swap(nextCache);
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    std::vector<uint32_t> remap(vertices.size(), NO_VERTEX);
+    uint32_t next = 0;
+    for (uint32_t index : indices) {
+        if (remap[index] == NO_VERTEX) {
+            remap[index] = next++;
+        }
+    }
+    for (uint32_t& target : remap) {
+        if (target == NO_VERTEX) {
+            target = next++;
+        }
+    }
+
+    std::vector<Vertex> reordered(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        reordered[remap[v]] = vertices[v];
+    }
+    vertices.swap(reordered);
+    for (uint32_t& index : indices) {
+        index = remap[index];
+    }
+}
+
+float MeshOptimizer::Simplify(const Vertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+                              size_t targetIndexCount, std::vector<uint32_t>& result)
+{
+    std::vector<uint32_t> triangles(indices, indices + indexCount);
+    size_t triangleCount = indexCount / 3;
+    std::vector<bool> triangleAlive(triangleCount, true);
+    std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+    std::vector<Quadric> quadrics(vertexCount);
+
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const uint32_t* triangle = &triangles[t * 3];
+        Quadric quadric = Quadric::FromTriangle(vertices[triangle[0]].position, vertices[triangle[1]].position,
+                                                vertices[triangle[2]].position);
+        for (int corner = 0; corner < 3; ++corner) {
+            quadrics[triangle[corner]] += quadric;
+            vertexTriangles[triangle[corner]].push_back(static_cast<uint32_t>(t));
+        }
+    }
+
+    // An edge with one triangle is an open border or, since the importer splits vertices whose
+    // attributes differ, a UV or normal seam; its vertices are locked so neither can open up
+    std::vector<bool> locked(vertexCount, false);
+    {
+        std::vector<uint64_t> edges;
+        edges.reserve(triangleCount * 3);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (int corner = 0; corner < 3; ++corner) {
+                uint32_t a = triangles[t * 3 + corner];
+                uint32_t b = triangles[t * 3 + (corner + 1) % 3];
+                uint64_t key = (static_cast<uint64_t>((std::min)(a, b)) << 32) | (std::max)(a, b);
+                edges.push_back(key);
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        for (size_t i = 0; i < edges.size();) {
+            size_t end = i;
+            while (end < edges.size() && edges[end] == edges[i]) ++end;
+            if (end - i == 1) {
+                locked[static_cast<uint32_t>(edges[i] >> 32)] = true;
+                locked[static_cast<uint32_t>(edges[i] & 0xFFFFFFFFu)] = true;
+            }
+            i = end;
+        }
+    }
+
+    auto collapseCost = [&](uint32_t from, uint32_t to) {
+        Quadric combined = quadrics[from];
+        combined += quadrics[to];
+        return combined.Evaluate(vertices[to].position);
+    };
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+    auto pushEdge = [&](uint32_t from, uint32_t to) {
+        if (locked[from] || from == to) return;
+        Collapse collapse = { collapseCost(from, to), from, to };
+        heap.push(collapse);
+    };
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int corner = 0; corner < 3; ++corner) {
+            uint32_t a = triangles[t * 3 + corner];
+            uint32_t b = triangles[t * 3 + (corner + 1) % 3];
+            pushEdge(a, b);
+            pushEdge(b, a);
+        }
+    }
+
+    std::vector<bool> removed(vertexCount, false);
+    size_t liveIndexCount = triangleCount * 3;
+    double maxCost = 0.0;
+
+    while (liveIndexCount > targetIndexCount && !heap.empty()) {
+        Collapse collapse = heap.top();
+        heap.pop();
+        uint32_t from = collapse.from;
+        uint32_t to = collapse.to;
+        if (removed[from] || removed[to]) continue;
+
+        // Costs only grow as quadrics merge, so a stale entry is requeued at its current cost
+        double cost = collapseCost(from, to);
+        if (cost > collapse.cost * 1.0001 + 1e-12) {
+            collapse.cost = cost;
+            heap.push(collapse);
+            continue;
+        }
+
+        // The edge has to still exist, and no triangle that moves may turn over
+        bool connected = false;
+        bool flips = false;
+        const glm::vec3& fromPosition = vertices[from].position;
+        const glm::vec3& toPosition = vertices[to].position;
+        for (uint32_t t : vertexTriangles[from]) {
+            if (!triangleAlive[t]) continue;
+            const uint32_t* triangle = &triangles[t * 3];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+                connected = true;
+                continue;
+            }
+            int corner = triangle[0] == from ? 0 : (triangle[1] == from ? 1 : 2);
+            const glm::vec3& a = vertices[triangle[(corner + 1) % 3]].position;
+            const glm::vec3& b = vertices[triangle[(corner + 2) % 3]].position;
+            glm::vec3 before = glm::cross(a - fromPosition, b - fromPosition);
+            glm::vec3 after = glm::cross(a - toPosition, b - toPosition);
+            if (glm::dot(before, after) <= 0.0f) {
+                flips = true;
+                break;
+            }
+        }
+        if (!connected || flips) continue;
+
+        std::vector<uint32_t> moved;
+        for (uint32_t t : vertexTriangles[from]) {
+            if (!triangleAlive[t]) continue;
+            uint32_t* triangle = &triangles[t * 3];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+                triangleAlive[t] = false;
+                liveIndexCount -= 3;
+                continue;
+            }
+            for (int corner = 0; corner < 3; ++corner) {
+                if (triangle[corner] == from) triangle[corner] = to;
+            }
+            moved.push_back(t);
+        }
+        quadrics[to] += quadrics[from];
+        removed[from] = true;
+        vertexTriangles[from].clear();
+        maxCost = (std::max)(maxCost, cost);
+
+        std::vector<uint32_t>& around = vertexTriangles[to];
+        around.erase(std::remove_if(around.begin(), around.end(), [&](uint32_t t) { return !triangleAlive[t]; }),
+                     around.end());
+        around.insert(around.end(), moved.begin(), moved.end());
+
+        // Edges around the merged vertex have new costs and, from the moved triangles, new neighbours
+        for (uint32_t t : around) {
+            for (int corner = 0; corner < 3; ++corner) {
+                uint32_t neighbour = triangles[t * 3 + corner];
+                if (neighbour == to) continue;
+                pushEdge(to, neighbour);
+                pushEdge(neighbour, to);
+            }
+        }
+    }
+
+    result.clear();
+    result.reserve(liveIndexCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (triangleAlive[t]) {
+            result.insert(result.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+        }
+    }
+    return static_cast<float>(std::sqrt(maxCost));
+}
+
+VertexQuantization MeshOptimizer::ComputeQuantization(const Vertex* vertices, size_t vertexCount)
+{
+    VertexQuantization quantization;
+    if (vertexCount == 0) {
+        return quantization;
+    }
+
+    glm::vec3 positionMin = vertices[0].position, positionMax = vertices[0].position;
+    glm::vec2 texCoordMin = vertices[0].texCoords, texCoordMax = vertices[0].texCoords;
+    for (size_t i = 1; i < vertexCount; ++i) {
+        positionMin = glm::min(positionMin, vertices[i].position);
+        positionMax = glm::max(positionMax, vertices[i].position);
+        texCoordMin = glm::min(texCoordMin, vertices[i].texCoords);
+        texCoordMax = glm::max(texCoordMax, vertices[i].texCoords);
+    }
+
+    quantization.positionOffset = positionMin;
+    quantization.positionScale = positionMax - positionMin;
+    quantization.texCoordOffset = texCoordMin;
+    quantization.texCoordScale = texCoordMax - texCoordMin;
+    return quantization;
+}
+
+PackedVertex MeshOptimizer::Quantize(const Vertex& vertex, const VertexQuantization& quantization)
+{
+    PackedVertex packed;
+    for (int axis = 0; axis < 3; ++axis) {
+        packed.position[axis] = QuantizeUnorm(NormalizeInRange(vertex.position[axis], quantization.positionOffset[axis],
+                                                               quantization.positionScale[axis]));
+    }
+    packed.position[3] = 0;
+
+    glm::vec2 normal = EncodeOctahedral(vertex.normal);
+    packed.normal[0] = QuantizeSnorm(normal.x);
+    packed.normal[1] = QuantizeSnorm(normal.y);
+
+    for (int axis = 0; axis < 2; ++axis) {
+        packed.texCoords[axis] = QuantizeUnorm(NormalizeInRange(vertex.texCoords[axis], quantization.texCoordOffset[axis],
+                                                                quantization.texCoordScale[axis]));
+    }
+    return packed;
+}
+
+Vertex MeshOptimizer::Dequantize(const PackedVertex& vertex, const VertexQuantization& quantization)
+{
+    glm::vec3 position(vertex.position[0], vertex.position[1], vertex.position[2]);
+    glm::vec2 normal((std::max)(vertex.normal[0] / 32767.0f, -1.0f), (std::max)(vertex.normal[1] / 32767.0f, -1.0f));
+    glm::vec2 texCoords(vertex.texCoords[0], vertex.texCoords[1]);
+
+    return Vertex(quantization.positionOffset + quantization.positionScale * (position / 65535.0f),
+                  DecodeOctahedral(normal),
+                  quantization.texCoordOffset + quantization.texCoordScale * (texCoords / 65535.0f));
+}
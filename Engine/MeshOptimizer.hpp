@@ -0,0 +1,29 @@
+#pragma once
+#include "Vertex.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Import-time passes over one submesh's triangle list. Indices are local to the vertex array
+// passed with them, as they are for a SubMesh before baseVertex is added.
+namespace MeshOptimizer {
+    // Reorders triangles so vertices are reused while still in the post-transform cache
+    // (Forsyth's linear-speed algorithm). The triangles themselves are unchanged.
+    void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+    // Moves vertices into the order the indices first reach them, so the vertex fetch walks
+    // memory forwards, and rewrites the indices to match. Unreferenced vertices go last.
+    void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+    // Collapses edges in order of quadric error until at most targetIndexCount indices are
+    // left or nothing can go without tearing the mesh. Open borders, which include UV and
+    // normal seams, stay where they are. Only existing vertices are used, so the result
+    // indexes the same vertex array. Returns the largest distance the surface moved.
+    float Simplify(const Vertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+                   size_t targetIndexCount, std::vector<uint32_t>& result);
+
+    // Ranges covering every vertex, for Quantize
+    VertexQuantization ComputeQuantization(const Vertex* vertices, size_t vertexCount);
+    PackedVertex Quantize(const Vertex& vertex, const VertexQuantization& quantization);
+    Vertex Dequantize(const PackedVertex& vertex, const VertexQuantization& quantization);
+}
@@ -1,10 +1,64 @@
 #include "Ocean.hpp"
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <emmintrin.h>
+
+namespace {
+    // Sine and cosine of four angles. The range is reduced to [-pi/2, pi/2] and
+    // evaluated with Taylor polynomials; error stays below 1e-6 there.
+    void SinCos4(__m128 x, __m128& sinOut, __m128& cosOut)
+    {
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128 pi = _mm_set1_ps(3.14159265f);
+        
+        // Subtract the nearest multiple of 2*pi, split in two parts to keep precision
+        __m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.159154943f))));
+        x = _mm_sub_ps(x, _mm_mul_ps(turns, _mm_set1_ps(6.28318548f)));
+        x = _mm_sub_ps(x, _mm_mul_ps(turns, _mm_set1_ps(-1.74845553e-7f)));
+        
+        // sin(x) = sin(+-pi - x) and cos(x) = -cos(+-pi - x) fold the outer quarters in
+        __m128 fold = _mm_cmpgt_ps(_mm_andnot_ps(signMask, x), _mm_set1_ps(1.57079633f));
+        __m128 mirrored = _mm_sub_ps(_mm_or_ps(_mm_and_ps(x, signMask), pi), x);
+        x = _mm_or_ps(_mm_and_ps(fold, mirrored), _mm_andnot_ps(fold, x));
+        __m128 cosSign = _mm_or_ps(_mm_and_ps(fold, signMask), _mm_set1_ps(1.0f));
+        
+        __m128 x2 = _mm_mul_ps(x, x);
+        
+        __m128 s = _mm_set1_ps(-2.50521084e-8f);
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(2.75573192e-6f));
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-1.98412698e-4f));
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(8.33333333e-3f));
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-1.66666667e-1f));
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(1.0f));
+        sinOut = _mm_mul_ps(s, x);
+        
+        __m128 c = _mm_set1_ps(2.08767570e-9f);
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-2.75573192e-7f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(2.48015873e-5f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-1.38888889e-3f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(4.16666667e-2f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-0.5f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(1.0f));
+        cosOut = _mm_mul_ps(c, cosSign);
+    }
+}
+
+void Ocean::WaveSetSoA::clear()
+{
+    kx.clear(); kz.clear();
+    speed.clear(); phase.clear();
+    amplitude.clear();
+    chopX.clear(); chopZ.clear();
+    slopeX.clear(); slopeZ.clear();
+    slopeY.clear();
+}
 
 Ocean::Ocean() 
     : VAO(0), VBO(0), EBO(0), time(0.0f), isInitialized(false),
       dudvTexture(0), normalTexture(0), skyboxTexture(0) {
+    // Wave queries work before Initialize, against the default config
+    RebuildWaveSet();
 }
 
 Ocean::~Ocean() {
@@ -17,6 +71,7 @@ bool Ocean::Initialize(const OceanConfig& cfg) {
     }
     
     config = cfg;
+    RebuildWaveSet();
     
     std::cout << "Initializing Ocean System..." << std::endl;
     std::cout << "- Resolution: " << config.resolution << "x" << config.resolution << std::endl;
@@ -25,14 +80,21 @@ bool Ocean::Initialize(const OceanConfig& cfg) {
     
     // Initialize shader with simpler version to avoid flickering
     oceanShader = std::make_unique<Shader>();
-    if (!oceanShader->InitFromFiles("shaders/ocean_simple.vert", "shaders/ocean_simple.frag")) {
+    if (!oceanShader->InitFromFiles("shaders/ocean_simple.vert", "shaders/ocean_simple.frag",
+                                    config.useLOD ? OCEAN_LOD_DEFINE : "")) {
         std::cerr << "Failed to initialize ocean shader!" << std::endl;
         return false;
     }
     
-    // Generate mesh
-    GenerateMesh();
-    SetupVertexData();
+    if (config.useLOD) {
+        OceanLOD::Settings lodSettings;
+        lodSettings.maxWaveHeight = config.waveAmplitude;
+        if (!surfaceLOD.Initialize(lodSettings)) return false;
+    } else {
+        // Generate mesh
+        GenerateMesh();
+        SetupVertexData();
+    }
     CreateTextures();
     
     isInitialized = true;
@@ -70,6 +132,7 @@ void Ocean::Cleanup() {
     
     oceanShader.reset();
     oceanMaterial.reset();
+    surfaceLOD.Cleanup();
     isInitialized = false;
 }
 
@@ -113,9 +176,15 @@ void Ocean::Render(const glm::mat4& view, const glm::mat4& projection,
     // This prevents flickering from missing textures
     
     // Render mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    if (surfaceLOD.IsInitialized()) {
+        surfaceLOD.Select(viewPos, Frustum(projection * view));
+        glUniform1f(glGetUniformLocation(oceanShader->shaderProgram, "oceanSize"), config.size);
+        surfaceLOD.Draw(*oceanShader);
+    } else {
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+    }
     
     // Restore depth writing and disable blending
     glDepthMask(GL_TRUE);
@@ -124,42 +193,91 @@ void Ocean::Render(const glm::mat4& view, const glm::mat4& projection,
 
 void Ocean::SetConfig(const OceanConfig& cfg) {
     config = cfg;
-    if (isInitialized) {
+    RebuildWaveSet();
+    if (isInitialized && !surfaceLOD.IsInitialized()) {
         GenerateMesh();
         UpdateMeshData();
     }
 }
 
 float Ocean::SampleWaveHeight(float x, float z, float currentTime) const {
-    if (currentTime < 0.0f) currentTime = time;
-    
-    glm::vec2 pos(x, z);
-    std::vector<Wave> waves = GenerateWaveSet();
-    
+    glm::vec2 position(x, z);
     float height = 0.0f;
-    for (const auto& wave : waves) {
-        float c = sqrt(9.8f / wave.frequency);
-        glm::vec2 d = glm::normalize(wave.direction);
-        float theta = glm::dot(d, pos) * wave.frequency + currentTime * c + wave.phase;
-        height += wave.amplitude * sin(theta);
-    }
-    
+    SampleWaves(&position, 1, &height, nullptr, nullptr, currentTime);
     return height;
 }
 
 glm::vec3 Ocean::SampleWaveNormal(float x, float z, float currentTime) const {
+    glm::vec2 position(x, z);
+    glm::vec3 normal(0.0f, 1.0f, 0.0f);
+    SampleWaves(&position, 1, nullptr, &normal, nullptr, currentTime);
+    return normal;
+}
+
+// Per wave: theta = k.p + speed * t + phase, then
+//   displacement += (chop.x * cos, a * sin, chop.z * cos)
+//   normal       += (-slope.x * cos, -slopeY * sin, -slope.z * cos), starting from (0, 1, 0)
+// which is the closed form of the Gerstner tangent/binormal cross product.
+void Ocean::SampleWaves(const glm::vec2* positions, size_t count, float* heights,
+                        glm::vec3* normals, glm::vec3* displacements, float currentTime) const {
     if (currentTime < 0.0f) currentTime = time;
     
-    // Calculate normal using finite differences
-    const float epsilon = 0.1f;
-    float h0 = SampleWaveHeight(x, z, currentTime);
-    float hx = SampleWaveHeight(x + epsilon, z, currentTime);
-    float hz = SampleWaveHeight(x, z + epsilon, currentTime);
-    
-    glm::vec3 tangentX = glm::normalize(glm::vec3(epsilon, hx - h0, 0.0f));
-    glm::vec3 tangentZ = glm::normalize(glm::vec3(0.0f, hz - h0, epsilon));
+    const size_t waveCount = waveSet.size();
     
-    return glm::normalize(glm::cross(tangentZ, tangentX));
+    for (size_t i = 0; i < count; i += 4) {
+        const size_t lanes = (std::min)(count - i, static_cast<size_t>(4));
+        
+        // Deinterleave x/z; the tail is padded by repeating the last point
+        float px[4], pz[4];
+        for (size_t lane = 0; lane < 4; ++lane) {
+            const glm::vec2& p = positions[i + (std::min)(lane, lanes - 1)];
+            px[lane] = p.x;
+            pz[lane] = p.y;
+        }
+        __m128 x = _mm_loadu_ps(px);
+        __m128 z = _mm_loadu_ps(pz);
+        
+        __m128 height = _mm_setzero_ps();
+        __m128 dispX = _mm_setzero_ps();
+        __m128 dispZ = _mm_setzero_ps();
+        __m128 normalX = _mm_setzero_ps();
+        __m128 normalY = _mm_set1_ps(1.0f);
+        __m128 normalZ = _mm_setzero_ps();
+        
+        for (size_t w = 0; w < waveCount; ++w) {
+            __m128 theta = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(waveSet.kx[w])), _mm_mul_ps(z, _mm_set1_ps(waveSet.kz[w]))),
+                _mm_set1_ps(waveSet.speed[w] * currentTime + waveSet.phase[w]));
+            __m128 sinTheta, cosTheta;
+            SinCos4(theta, sinTheta, cosTheta);
+            
+            height = _mm_add_ps(height, _mm_mul_ps(sinTheta, _mm_set1_ps(waveSet.amplitude[w])));
+            dispX = _mm_add_ps(dispX, _mm_mul_ps(cosTheta, _mm_set1_ps(waveSet.chopX[w])));
+            dispZ = _mm_add_ps(dispZ, _mm_mul_ps(cosTheta, _mm_set1_ps(waveSet.chopZ[w])));
+            normalX = _mm_sub_ps(normalX, _mm_mul_ps(cosTheta, _mm_set1_ps(waveSet.slopeX[w])));
+            normalY = _mm_sub_ps(normalY, _mm_mul_ps(sinTheta, _mm_set1_ps(waveSet.slopeY[w])));
+            normalZ = _mm_sub_ps(normalZ, _mm_mul_ps(cosTheta, _mm_set1_ps(waveSet.slopeZ[w])));
+        }
+        
+        float h[4], dx[4], dz[4], nx[4], ny[4], nz[4];
+        _mm_storeu_ps(h, height);
+        if (heights) {
+            for (size_t lane = 0; lane < lanes; ++lane) heights[i + lane] = h[lane];
+        }
+        if (displacements) {
+            _mm_storeu_ps(dx, dispX);
+            _mm_storeu_ps(dz, dispZ);
+            for (size_t lane = 0; lane < lanes; ++lane) displacements[i + lane] = glm::vec3(dx[lane], h[lane], dz[lane]);
+        }
+        if (normals) {
+            __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, normalX), _mm_mul_ps(normalY, normalY)),
+                                                   _mm_mul_ps(normalZ, normalZ)));
+            _mm_storeu_ps(nx, _mm_div_ps(normalX, length));
+            _mm_storeu_ps(ny, _mm_div_ps(normalY, length));
+            _mm_storeu_ps(nz, _mm_div_ps(normalZ, length));
+            for (size_t lane = 0; lane < lanes; ++lane) normals[i + lane] = glm::vec3(nx[lane], ny[lane], nz[lane]);
+        }
+    }
 }
 
 void Ocean::GenerateMesh() {
@@ -376,36 +494,27 @@ std::vector<Ocean::Wave> Ocean::GenerateWaveSet() const {
     return waves;
 }
 
-glm::vec3 Ocean::CalculateGerstnerWave(const glm::vec2& position, const Wave& wave, 
-                                      float currentTime, glm::vec3& tangent, 
-                                      glm::vec3& binormal) const {
-    float c = sqrt(9.8f / wave.frequency);
-    glm::vec2 d = glm::normalize(wave.direction);
-    float f = wave.frequency;
-    float a = wave.amplitude;
-    float phi = wave.phase;
-    float q = wave.steepness / (wave.frequency * a * static_cast<float>(config.numWaves));
-    
-    float theta = glm::dot(d, position) * f + currentTime * c + phi;
-    float sinTheta = sin(theta);
-    float cosTheta = cos(theta);
-    
-    // Displacement
-    glm::vec3 displacement;
-    displacement.x = q * a * d.x * cosTheta;
-    displacement.z = q * a * d.y * cosTheta;
-    displacement.y = a * sinTheta;
-    
-    // Update tangent and binormal for normal calculation
-    tangent.x += -q * d.x * d.x * f * a * sinTheta;
-    tangent.y += d.x * f * a * cosTheta;
-    tangent.z += -q * d.x * d.y * f * a * sinTheta;
-    
-    binormal.x += -q * d.x * d.y * f * a * sinTheta;
-    binormal.y += d.y * f * a * cosTheta;
-    binormal.z += -q * d.y * d.y * f * a * sinTheta;
-    
-    return displacement;
+void Ocean::RebuildWaveSet() {
+    waveSet.clear();
+    
+    for (const Wave& wave : GenerateWaveSet()) {
+        glm::vec2 d = glm::normalize(wave.direction);
+        float f = wave.frequency;
+        float a = wave.amplitude;
+        // steepness is already divided by f * a * numWaves, so the crests never loop
+        float q = wave.steepness;
+        
+        waveSet.kx.push_back(d.x * f);
+        waveSet.kz.push_back(d.y * f);
+        waveSet.speed.push_back(sqrt(9.8f / f));
+        waveSet.phase.push_back(wave.phase);
+        waveSet.amplitude.push_back(a);
+        waveSet.chopX.push_back(q * a * d.x);
+        waveSet.chopZ.push_back(q * a * d.y);
+        waveSet.slopeX.push_back(f * a * d.x);
+        waveSet.slopeZ.push_back(f * a * d.y);
+        waveSet.slopeY.push_back(q * f * a);
+    }
 }
 
 // Ocean Factory Implementation
@@ -6,6 +6,7 @@
 #include <vector>
 #include "Shader.hpp"
 #include "Material.hpp"
+#include "OceanLOD.hpp"
 
 class Ocean {
 public:
@@ -22,6 +23,9 @@ public:
         float waveFrequency = 0.02f;
         int numWaves = 6;
         
+        // Camera-relative LOD patches out to the horizon instead of the fixed grid (read by Initialize)
+        bool useLOD = true;
+        
         // Visual properties
         glm::vec3 deepColor = glm::vec3(0.0f, 0.1f, 0.3f);
         glm::vec3 shallowColor = glm::vec3(0.1f, 0.6f, 0.8f);
@@ -44,6 +48,9 @@ private:
     std::vector<glm::vec2> texCoords;
     std::vector<unsigned int> indices;
     
+    // Replaces the mesh above when config.useLOD is set
+    OceanLOD surfaceLOD;
+    
     // Ocean properties
     OceanConfig config;
     float time;
@@ -53,6 +60,21 @@ private:
     GLuint dudvTexture;
     GLuint normalTexture;
     GLuint skyboxTexture;
+    
+    // Gerstner terms per wave as structure-of-arrays, so SampleWaves runs four
+    // points per SSE instruction. Rebuilt only when the config changes.
+    struct WaveSetSoA {
+        std::vector<float> kx, kz;           // Direction * frequency
+        std::vector<float> speed, phase;     // theta = k.p + speed * t + phase
+        std::vector<float> amplitude;
+        std::vector<float> chopX, chopZ;     // Horizontal displacement: q * a * d
+        std::vector<float> slopeX, slopeZ;   // Normal terms: f * a * d
+        std::vector<float> slopeY;           // q * f * a
+        
+        void clear();
+        size_t size() const { return amplitude.size(); }
+    };
+    WaveSetSoA waveSet;
 
 public:
     Ocean();
@@ -76,6 +98,12 @@ public:
     float SampleWaveHeight(float x, float z, float currentTime = -1.0f) const;
     glm::vec3 SampleWaveNormal(float x, float z, float currentTime = -1.0f) const;
     
+    // Batched Gerstner evaluation at count x/z positions. Any output may be null.
+    // Heights and normals are taken at the undisplaced position; displacements
+    // are the full Gerstner offset (x, y, z) of that point.
+    void SampleWaves(const glm::vec2* positions, size_t count, float* heights,
+                     glm::vec3* normals, glm::vec3* displacements, float currentTime = -1.0f) const;
+    
     // Utility functions
     bool IsInitialized() const { return isInitialized; }
     float GetCurrentTime() const { return time; }
@@ -102,9 +130,7 @@ private:
     };
     
     std::vector<Wave> GenerateWaveSet() const;
-    glm::vec3 CalculateGerstnerWave(const glm::vec2& position, const Wave& wave, 
-                                   float currentTime, glm::vec3& tangent, 
-                                   glm::vec3& binormal) const;
+    void RebuildWaveSet();
 };
 
 // Ocean factory for creating different ocean types
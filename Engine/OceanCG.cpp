@@ -29,7 +29,7 @@ OceanCG::~OceanCG() {
     Cleanup();
 }
 
-bool OceanCG::Initialize(int resolution, float size) {
+bool OceanCG::Initialize(int resolution, float size, bool useLOD) {
     if (isInitialized) {
         Cleanup();
     }
@@ -43,14 +43,19 @@ bool OceanCG::Initialize(int resolution, float size) {
     
     // Initialize shader following book's pattern
     oceanShader = std::make_unique<Shader>();
-    if (!oceanShader->InitFromFiles("shaders/ocean_cg.vert", "shaders/ocean_cg.frag")) {
+    if (!oceanShader->InitFromFiles("shaders/ocean_cg.vert", "shaders/ocean_cg.frag", useLOD ? OCEAN_LOD_DEFINE : "")) {
         std::cerr << "Failed to initialize ocean shader!" << std::endl;
         return false;
     }
     
     // Create ocean mesh
-    CreateOceanGrid();
-    SetupVertexAttributes();
+    if (useLOD) {
+        // Default culling bounds: wave parameters are usually set after Initialize
+        if (!surfaceLOD.Initialize()) return false;
+    } else {
+        CreateOceanGrid();
+        SetupVertexAttributes();
+    }
     
     isInitialized = true;
     std::cout << "Ocean system initialized successfully!" << std::endl;
@@ -73,6 +78,7 @@ void OceanCG::Cleanup() {
     }
     
     oceanShader.reset();
+    surfaceLOD.Cleanup();
     isInitialized = false;
 }
 
@@ -81,7 +87,7 @@ void OceanCG::Update(float deltaTime) {
     waves.time += deltaTime * waves.speed;
 }
 
-void OceanCG::Render(const glm::mat4& mvMatrix, const glm::mat4& projMatrix) {
+void OceanCG::Render(const glm::mat4& viewMatrix, const glm::mat4& projection, const glm::vec3& cameraPosition) {
     if (!isInitialized) return;
     
     // Enable enhanced blending for water transparency
@@ -93,12 +99,18 @@ void OceanCG::Render(const glm::mat4& mvMatrix, const glm::mat4& projMatrix) {
     oceanShader->use();
     
     // Set shader uniforms using book's approach
-    SetShaderUniforms(mvMatrix, projMatrix);
+    SetShaderUniforms(viewMatrix);
     
     // Render the ocean mesh
-    glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    if (surfaceLOD.IsInitialized()) {
+        surfaceLOD.Select(cameraPosition, Frustum(projection * viewMatrix));
+        glUniform1f(glGetUniformLocation(oceanShader->shaderProgram, "oceanSize"), gridSize);
+        surfaceLOD.Draw(*oceanShader);
+    } else {
+        glBindVertexArray(vao);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+    }
     
     // Restore depth writing and disable blending
     glDepthMask(GL_TRUE);
@@ -201,15 +213,12 @@ void OceanCG::SetupVertexAttributes() {
     glBindVertexArray(0);
 }
 
-void OceanCG::SetShaderUniforms(const glm::mat4& mvMatrix, const glm::mat4& projMatrix) {
+// View and projection come from the shared FrameData block; the ocean has no model transform
+void OceanCG::SetShaderUniforms(const glm::mat4& viewMatrix) {
     GLuint shaderProgram = oceanShader->shaderProgram;
     
-    // Matrix uniforms
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "mv_matrix"), 1, GL_FALSE, &mvMatrix[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "proj_matrix"), 1, GL_FALSE, &projMatrix[0][0]);
-    
     // Normal matrix calculation from the book
-    glm::mat4 normalMatrix = CalculateNormalMatrix(mvMatrix);
+    glm::mat4 normalMatrix = CalculateNormalMatrix(viewMatrix);
     glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "norm_matrix"), 1, GL_FALSE, &normalMatrix[0][0]);
     
     // Wave parameters
@@ -5,6 +5,7 @@
 #include <memory>
 #include <vector>
 #include "Shader.hpp"
+#include "OceanLOD.hpp"
 
 // Ocean implementation based on "Computer Graphics Programming in OpenGL with C++"
 // Follows the book's approach to procedural surfaces and displacement mapping
@@ -42,6 +43,9 @@ private:
     int gridResolution;
     float gridSize;
     
+    // Replaces the grid when initialised with useLOD
+    OceanLOD surfaceLOD;
+    
     // Rendering state
     WaveParameters waves;
     LightInfo light;
@@ -60,11 +64,13 @@ public:
     ~OceanCG();
     
     // Initialization following book's setup patterns
-    bool Initialize(int resolution = 100, float size = 100.0f);
+    // With useLOD the surface extends to the horizon; size then only sets the texture tiling
+    bool Initialize(int resolution = 100, float size = 100.0f, bool useLOD = true);
     void Cleanup();
     
-    // Rendering with book's matrix approach
-    void Render(const glm::mat4& mvMatrix, const glm::mat4& projMatrix);
+    // Rendering with book's matrix approach; the view is needed for the normal matrix,
+    // projection and camera position only for LOD patch selection
+    void Render(const glm::mat4& viewMatrix, const glm::mat4& projection, const glm::vec3& cameraPosition);
     
     // Animation update
     void Update(float deltaTime);
@@ -85,7 +91,7 @@ private:
     // Mesh generation following book's grid creation
     void CreateOceanGrid();
     void SetupVertexAttributes();
-    void SetShaderUniforms(const glm::mat4& mvMatrix, const glm::mat4& projMatrix);
+    void SetShaderUniforms(const glm::mat4& viewMatrix);
     
     // Book's normal matrix calculation
     glm::mat4 CalculateNormalMatrix(const glm::mat4& mvMatrix);
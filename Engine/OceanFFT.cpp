@@ -2,14 +2,116 @@
 #include <iostream>
 #include <cmath>
 #include <algorithm>
+#include <thread>
+#include <cstring>
+#include <limits>
 
 const float PI = 3.14159265359f;
 const float GRAVITY = 9.81f;
 
-OceanFFT::OceanFFT() 
-    : VAO(0), VBO(0), EBO(0), heightmapTexture(0), displacementTexture(0),
-      normalTexture(0), foamTexture(0), spectrumTexture(0), phaseTexture(0),
-      framebuffer(0), time(0.0f), isInitialized(false), rng(42), gaussianDist(0.0f, 1.0f) {
+namespace {
+    // Compute dispatches use 16x16 workgroups (local_size in the ocean_fft_*.comp shaders)
+    const int FFT_WORKGROUP_SIZE = 16;
+
+    constexpr uint32_t UNIFORM_N = HashUniformName("N");
+    constexpr uint32_t UNIFORM_TIME = HashUniformName("time");
+    constexpr uint32_t UNIFORM_GRAVITY = HashUniformName("gravity");
+    constexpr uint32_t UNIFORM_OCEAN_SIZE = HashUniformName("oceanSize");
+    constexpr uint32_t UNIFORM_STAGE = HashUniformName("stage");
+    constexpr uint32_t UNIFORM_CHOPPINESS = HashUniformName("choppiness");
+    constexpr uint32_t UNIFORM_ENABLE_CHOPPINESS = HashUniformName("enableChoppiness");
+    constexpr uint32_t UNIFORM_ENABLE_FOAM = HashUniformName("enableFoam");
+    constexpr uint32_t UNIFORM_FOAM_THRESHOLD = HashUniformName("foamThreshold");
+    constexpr uint32_t UNIFORM_AMPLITUDE = HashUniformName("amplitude");
+    constexpr uint32_t UNIFORM_WIND_SPEED = HashUniformName("windSpeed");
+    constexpr uint32_t UNIFORM_WIND_DIRECTION = HashUniformName("windDirection");
+    constexpr uint32_t UNIFORM_DAMPING = HashUniformName("damping");
+    constexpr uint32_t UNIFORM_SEED = HashUniformName("seed");
+    constexpr uint32_t UNIFORM_MIN_WAVENUMBER = HashUniformName("minWavenumber");
+    constexpr uint32_t UNIFORM_MAX_WAVENUMBER = HashUniformName("maxWavenumber");
+
+    // Rows per CPU worker below which threading costs more than it saves
+    const int MIN_ROWS_PER_WORKER = 32;
+
+    // Fixed-point steps used to undo choppy displacement; waves that do not fold converge in a few
+    const int DISPLACEMENT_INVERSION_STEPS = 3;
+
+    // A smaller cascade takes over the spectrum at this multiple of its own fundamental
+    // wavenumber, so the waves handed to it span several of its texels and none of its tile
+    const float CASCADE_BAND_START = 4.0f;
+
+    // Offsets the hash seed per cascade so tiles do not share their random phases
+    const uint32_t CASCADE_SEED_STEP = 0x9E3779B9u;
+
+    // PCG hash (Jarzynski & Olano 2020); must stay in sync with ocean_fft_initial_spectrum.comp
+    uint32_t PcgHash(uint32_t value)
+    {
+        uint32_t state = value * 747796405u + 2891336453u;
+        uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+
+    // Uniform in (0, 1), never 0 so the Box-Muller log stays finite
+    float HashToUnit(uint32_t value)
+    {
+        return (static_cast<float>(value >> 8u) + 0.5f) * (1.0f / 16777216.0f);
+    }
+
+    GLuint CreateFloatTexture(GLenum internalFormat, int width, int height, GLenum filter, GLenum wrap)
+    {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+        return texture;
+    }
+
+    // Filtered and tiling, for the maps the ocean vertex shader samples
+    GLuint CreateFloatTextureArray(GLenum internalFormat, int width, int height, int layers)
+    {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, internalFormat, width, height, layers);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        return texture;
+    }
+
+    // Swell, mid-size waves and ripples. The ratios are deliberately not integer
+    // fractions so the tile repeats of different cascades never line up.
+    void SetDefaultCascades(OceanFFT::OceanConfig& config)
+    {
+        config.cascadeCount = 3;
+        config.cascades[0].sizeRatio = 1.0f;
+        config.cascades[0].updateInterval = 4;
+        config.cascades[1].sizeRatio = 0.173f;
+        config.cascades[1].updateInterval = 2;
+        config.cascades[2].sizeRatio = 0.031f;
+        config.cascades[2].updateInterval = 1;
+    }
+}
+
+OceanFFT::Cascade::Cascade() {
+    layerTimes[0] = layerTimes[1] = 0.0f;
+    for (int i = 0; i < READBACK_RING_SIZE; i++) {
+        readbackBuffers[i] = 0;
+        readbackFences[i] = nullptr;
+    }
+}
+
+OceanFFT::OceanFFT()
+    : VAO(0), VBO(0), EBO(0), displacementMaps(0), surfaceMaps(0),
+      butterflyTexture(0), framebuffer(0), cascadeCount(1), frameIndex(0), timeStep(0.0f),
+      readbackTime(0.0f), time(0.0f), isInitialized(false),
+      gpuFFTAvailable(false), spectrumSeed(42), spectrumDirty(false) {
 }
 
 OceanFFT::~OceanFFT() {
@@ -28,15 +130,31 @@ bool OceanFFT::Initialize(const OceanConfig& cfg) {
         std::cerr << "Ocean FFT: Grid resolution must be a power of 2!" << std::endl;
         return false;
     }
+    if (config.N < FFT_WORKGROUP_SIZE) {
+        std::cerr << "Ocean FFT: Grid resolution must be at least " << FFT_WORKGROUP_SIZE << "!" << std::endl;
+        return false;
+    }
+    if (!ValidateCascades()) {
+        return false;
+    }
+    SetupCascades();
     
     std::cout << "Initializing FFT Ocean System..." << std::endl;
-    std::cout << "- Resolution: " << config.N << "x" << config.N << std::endl;
+    std::cout << "- Resolution: " << cascadeCount << " x " << config.N << "x" << config.N << std::endl;
     std::cout << "- Ocean Size: " << config.oceanSize << " meters" << std::endl;
+    for (int c = 0; c < cascadeCount; c++) {
+        std::cout << "- Cascade " << c << ": " << cascades[c].patchSize << " m tile, updated every "
+                  << cascades[c].updateInterval << " frame(s)" << std::endl;
+    }
     std::cout << "- Choppiness: " << (config.enableChoppiness ? "Enabled" : "Disabled") << std::endl;
     std::cout << "- Foam: " << (config.enableFoam ? "Enabled" : "Disabled") << std::endl;
     
     // Initialize components
-    if (!CreateGeometry()) return false;
+    if (config.useLOD) {
+        if (!surfaceLOD.Initialize()) return false;
+    } else if (!CreateGeometry()) {
+        return false;
+    }
     if (!CreateTextures()) return false;
     if (!CreateFramebuffers()) return false;
     if (!InitializeShaders()) return false;
@@ -52,22 +170,50 @@ bool OceanFFT::Initialize(const OceanConfig& cfg) {
 
 void OceanFFT::Cleanup() {
     // Clean up textures
-    if (heightmapTexture != 0) glDeleteTextures(1, &heightmapTexture);
-    if (displacementTexture != 0) glDeleteTextures(1, &displacementTexture);
-    if (normalTexture != 0) glDeleteTextures(1, &normalTexture);
-    if (foamTexture != 0) glDeleteTextures(1, &foamTexture);
-    if (spectrumTexture != 0) glDeleteTextures(1, &spectrumTexture);
-    if (phaseTexture != 0) glDeleteTextures(1, &phaseTexture);
+    if (displacementMaps != 0) glDeleteTextures(1, &displacementMaps);
+    if (surfaceMaps != 0) glDeleteTextures(1, &surfaceMaps);
+    if (butterflyTexture != 0) glDeleteTextures(1, &butterflyTexture);
+    displacementMaps = surfaceMaps = butterflyTexture = 0;
+    
+    for (int c = 0; c < MAX_CASCADES; c++) {
+        Cascade& cascade = cascades[c];
+        if (cascade.spectrumTexture != 0) glDeleteTextures(1, &cascade.spectrumTexture);
+        if (cascade.pingPongTexture != 0) glDeleteTextures(1, &cascade.pingPongTexture);
+        if (cascade.h0Texture != 0) glDeleteTextures(1, &cascade.h0Texture);
+        cascade.spectrumTexture = cascade.pingPongTexture = cascade.h0Texture = 0;
+        
+        // Clean up readback ring
+        for (int i = 0; i < READBACK_RING_SIZE; i++) {
+            if (cascade.readbackFences[i]) glDeleteSync(cascade.readbackFences[i]);
+            cascade.readbackFences[i] = nullptr;
+        }
+        if (cascade.readbackBuffers[0] != 0) glDeleteBuffers(READBACK_RING_SIZE, cascade.readbackBuffers);
+        for (int i = 0; i < READBACK_RING_SIZE; i++) {
+            cascade.readbackBuffers[i] = 0;
+        }
+        cascade.readbackHead = cascade.readbackPending = 0;
+        cascade.displacementLevels.clear();
+        cascade.initialSpectrum.clear();
+        cascade.latestLayer = 0;
+        cascade.stale = true;
+    }
+    frameIndex = 0;
     
     // Clean up framebuffer
     if (framebuffer != 0) glDeleteFramebuffers(1, &framebuffer);
+    framebuffer = 0;
     
     // Clean up geometry
     if (VAO != 0) glDeleteVertexArrays(1, &VAO);
     if (VBO != 0) glDeleteBuffers(1, &VBO);
     if (EBO != 0) glDeleteBuffers(1, &EBO);
+    VAO = VBO = EBO = 0;
+    surfaceLOD.Cleanup();
+    vertices.clear();
+    indices.clear();
     
     // Reset shaders
+    initialSpectrumShader.reset();
     spectrumShader.reset();
     fftHorizontalShader.reset();
     fftVerticalShader.reset();
@@ -75,41 +221,92 @@ void OceanFFT::Cleanup() {
     oceanVertexShader.reset();
     oceanFragmentShader.reset();
     
+    gpuFFTAvailable = false;
     isInitialized = false;
 }
 
 void OceanFFT::SetWaveParameters(const WaveParameters& params) {
     waveParams = params;
-    if (isInitialized) {
-        GenerateInitialSpectrum(); // Regenerate spectrum with new parameters
-    }
+    // Deferred so several changes in one frame (e.g. a weather system) cost one rebuild
+    spectrumDirty = isInitialized;
 }
 
 void OceanFFT::SetOceanConfig(const OceanConfig& cfg) {
+    if (!isInitialized) {
+        config = cfg;
+        return;
+    }
+    
+    // Reinitialize if the resolution, geometry mode or number of cascades changed
+    if (cfg.N != config.N || cfg.useLOD != config.useLOD || cfg.cascadeCount != config.cascadeCount) {
+        Initialize(cfg);
+        return;
+    }
+    
+    // Resized tiles only need a new spectrum; update rates apply from the next frame
+    bool resized = cfg.oceanSize != config.oceanSize;
+    for (int c = 0; c < cfg.cascadeCount; c++) {
+        resized = resized || cfg.cascades[c].sizeRatio != config.cascades[c].sizeRatio;
+    }
+    
+    OceanConfig previous = config;
     config = cfg;
-    if (isInitialized) {
-        // Reinitialize if resolution changed
-        if (cfg.N != config.N) {
-            Initialize(cfg);
-        }
+    if (!ValidateCascades()) {
+        config = previous;
+        return;
     }
+    SetupCascades();
+    spectrumDirty = spectrumDirty || resized;
 }
 
 void OceanFFT::Update(float deltaTime) {
     if (!isInitialized) return;
     
-    time += deltaTime * config.timeScale;
+    timeStep = deltaTime * config.timeScale;
+    time += timeStep;
     
-    // Update wave spectrum for current time
-    UpdateSpectrum(time);
+    if (spectrumDirty) {
+        GenerateInitialSpectrum();
+    }
     
-    // Perform FFT computation on GPU
-    ComputeFFT();
+    if (!gpuFFTAvailable) return;
+    
+    bool readbackLanded = false;
+    for (int c = 0; c < cascadeCount; c++) {
+        Cascade& cascade = cascades[c];
+        
+        // Pick up whichever earlier copy has finished
+        if (CollectReadback(cascade)) {
+            readbackLanded = true;
+        }
+        
+        // Offset by the index so cascades sharing an interval update on different frames
+        if (!cascade.stale && (frameIndex + c) % cascade.updateInterval != 0) continue;
+        
+        if (cascade.stale) {
+            // Give the blend a valid older layer to start from
+            SolveCascade(c, cascade.latestLayer, time);
+            cascade.stale = false;
+        }
+        
+        // Slow cascades solve for the time of their next update and blend towards it,
+        // so the surface moves continuously instead of stepping every few frames
+        float solveTime = cascade.updateInterval > 1 ? time + timeStep * cascade.updateInterval : time;
+        int layer = 1 - cascade.latestLayer;
+        SolveCascade(c, layer, solveTime);
+        cascade.latestLayer = layer;
+        QueueReadback(cascade, c * 2 + layer);
+    }
+    
+    if (readbackLanded) {
+        // The copies were queued a few frames ago; close enough for a timestamp
+        readbackTime = time;
+    }
+    frameIndex++;
 }
 
-void OceanFFT::Render(const glm::mat4& view, const glm::mat4& projection, 
-                      const glm::vec3& cameraPos, const glm::vec3& lightDir,
-                      const glm::vec3& lightColor, const glm::vec3& skyColor) {
+void OceanFFT::Render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition,
+                      const glm::vec3& skyColor) {
     if (!isInitialized) return;
     
     // Enable transparency
@@ -121,66 +318,171 @@ void OceanFFT::Render(const glm::mat4& view, const glm::mat4& projection,
     oceanVertexShader->use();
     
     // Set uniforms
-    SetShaderUniforms(view, projection, cameraPos, lightDir, lightColor, skyColor);
+    SetShaderUniforms(skyColor);
     
     // Bind textures
     BindTextures();
     
     // Render ocean mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    if (surfaceLOD.IsInitialized()) {
+        surfaceLOD.Select(cameraPosition, Frustum(projection * view));
+        surfaceLOD.Draw(*oceanVertexShader);
+    } else {
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+    }
     
     // Restore state
     glDepthMask(GL_TRUE);
     glDisable(GL_BLEND);
 }
 
-float OceanFFT::SampleHeight(float x, float z, float currentTime) const {
-    if (!isInitialized) return 0.0f;
+bool OceanFFT::HasReadback() const {
+    for (int c = 0; c < cascadeCount; c++) {
+        if (cascades[c].displacementLevels.empty()) return false;
+    }
+    return cascadeCount > 0;
+}
+
+// Every cascade has the same N, so they share one mip chain length
+int OceanFFT::GetReadbackLevelCount() const {
+    return HasReadback() ? static_cast<int>(cascades[0].displacementLevels.size()) : 0;
+}
+
+float OceanFFT::SampleHeight(float x, float z, int mipLevel) const {
+    float height = 0.0f;
+    glm::vec2 position(x, z);
+    SampleHeights(&position, &height, 1, mipLevel);
+    return height;
+}
+
+void OceanFFT::SampleHeights(const glm::vec2* positions, float* heights, size_t count, int mipLevel) const {
+    if (!HasReadback()) {
+        std::fill(heights, heights + count, 0.0f);
+        return;
+    }
     
-    if (currentTime < 0.0f) currentTime = time;
+    int level = ClampReadbackLevel(mipLevel);
+    for (size_t i = 0; i < count; i++) {
+        glm::vec2 source = FindUndisplacedPosition(level, positions[i].x, positions[i].y);
+        heights[i] = SampleSurface(level, source.x, source.y).y;
+    }
+}
+
+glm::vec3 OceanFFT::SampleNormal(float x, float z, int mipLevel) const {
+    if (!HasReadback()) return glm::vec3(0.0f, 1.0f, 0.0f);
     
-    // Convert world coordinates to grid coordinates
-    float u = (x / config.oceanSize + 0.5f) * config.N;
-    float v = (z / config.oceanSize + 0.5f) * config.N;
+    int level = ClampReadbackLevel(mipLevel);
+    glm::vec2 source = FindUndisplacedPosition(level, x, z);
     
-    // Bilinear interpolation would be implemented here
-    // For now, return a simple wave approximation
-    float waveHeight = 0.0f;
+    // Central differences one texel of the finest cascade apart at the sampled level
+    float spacing = cascades[cascadeCount - 1].patchSize / static_cast<float>(config.N >> level);
+    float left = SampleSurface(level, source.x - spacing, source.y).y;
+    float right = SampleSurface(level, source.x + spacing, source.y).y;
+    float back = SampleSurface(level, source.x, source.y - spacing).y;
+    float front = SampleSurface(level, source.x, source.y + spacing).y;
     
-    for (int i = 0; i < 8; i++) {
-        float freq = 0.01f * (1 << i);
-        float amp = waveParams.A / (1 << i);
-        waveHeight += amp * sin(x * freq + currentTime) * cos(z * freq + currentTime * 0.7f);
-    }
+    return glm::normalize(glm::vec3(left - right, 2.0f * spacing, back - front));
+}
+
+glm::vec2 OceanFFT::SampleDisplacement(float x, float z, int mipLevel) const {
+    if (!HasReadback() || !config.enableChoppiness) return glm::vec2(0.0f);
     
-    return waveHeight;
+    int level = ClampReadbackLevel(mipLevel);
+    glm::vec2 source = FindUndisplacedPosition(level, x, z);
+    glm::vec4 displacement = SampleSurface(level, source.x, source.y);
+    return glm::vec2(displacement.x, displacement.z) * waveParams.lambda;
 }
 
-glm::vec3 OceanFFT::SampleNormal(float x, float z, float currentTime) const {
-    if (!isInitialized) return glm::vec3(0.0f, 1.0f, 0.0f);
+// Matches GL_LINEAR + GL_REPEAT on the displacement maps, with texture coordinates
+// running from 0 at -patchSize/2 to 1 at +patchSize/2
+glm::vec4 OceanFFT::SampleReadback(const Cascade& cascade, int level, float x, float z) const {
+    const std::vector<glm::vec4>& texels = cascade.displacementLevels[level];
+    const int size = config.N >> level;
     
-    // Calculate normal using finite differences
-    const float epsilon = 0.1f;
-    float h0 = SampleHeight(x, z, currentTime);
-    float hx = SampleHeight(x + epsilon, z, currentTime);
-    float hz = SampleHeight(x, z + epsilon, currentTime);
+    float u = (x / cascade.patchSize + 0.5f) * size - 0.5f;
+    float v = (z / cascade.patchSize + 0.5f) * size - 0.5f;
+    float u0 = floor(u);
+    float v0 = floor(v);
+    float fu = u - u0;
+    float fv = v - v0;
     
-    glm::vec3 tangentX = glm::normalize(glm::vec3(epsilon, hx - h0, 0.0f));
-    glm::vec3 tangentZ = glm::normalize(glm::vec3(0.0f, hz - h0, epsilon));
+    int x0 = ((static_cast<int>(u0) % size) + size) % size;
+    int z0 = ((static_cast<int>(v0) % size) + size) % size;
+    int x1 = (x0 + 1) % size;
+    int z1 = (z0 + 1) % size;
     
-    return glm::normalize(glm::cross(tangentZ, tangentX));
+    glm::vec4 top = glm::mix(texels[z0 * size + x0], texels[z0 * size + x1], fu);
+    glm::vec4 bottom = glm::mix(texels[z1 * size + x0], texels[z1 * size + x1], fu);
+    return glm::mix(top, bottom, fv);
+}
+
+glm::vec4 OceanFFT::SampleSurface(int level, float x, float z) const {
+    glm::vec4 surface(0.0f);
+    for (int c = 0; c < cascadeCount; c++) {
+        surface += SampleReadback(cascades[c], level, x, z);
+    }
+    return surface;
 }
 
-glm::vec2 OceanFFT::SampleDisplacement(float x, float z, float currentTime) const {
-    if (!isInitialized || !config.enableChoppiness) return glm::vec2(0.0f);
+// The vertex shader moves grid point q to q + lambda * D(q), so the surface over
+// p comes from the q solving that equation; iterate q = p - lambda * D(q).
+glm::vec2 OceanFFT::FindUndisplacedPosition(int level, float x, float z) const {
+    glm::vec2 target(x, z);
+    if (!config.enableChoppiness) return target;
     
-    // Simplified displacement calculation
-    float dispX = waveParams.lambda * 0.1f * cos(x * 0.01f + currentTime);
-    float dispZ = waveParams.lambda * 0.1f * sin(z * 0.01f + currentTime * 0.8f);
+    glm::vec2 source = target;
+    for (int i = 0; i < DISPLACEMENT_INVERSION_STEPS; i++) {
+        glm::vec4 displacement = SampleSurface(level, source.x, source.y);
+        source = target - glm::vec2(displacement.x, displacement.z) * waveParams.lambda;
+    }
+    return source;
+}
+
+int OceanFFT::ClampReadbackLevel(int mipLevel) const {
+    return (std::max)(0, (std::min)(mipLevel, GetReadbackLevelCount() - 1));
+}
+
+bool OceanFFT::ValidateCascades() const {
+    if (config.cascadeCount < 1 || config.cascadeCount > MAX_CASCADES) {
+        std::cerr << "Ocean FFT: Cascade count must be between 1 and " << MAX_CASCADES << "!" << std::endl;
+        return false;
+    }
+    for (int c = 0; c < config.cascadeCount; c++) {
+        const CascadeConfig& cascade = config.cascades[c];
+        if (cascade.sizeRatio <= 0.0f || cascade.updateInterval < 1) {
+            std::cerr << "Ocean FFT: Cascade " << c << " needs a positive size and update interval!" << std::endl;
+            return false;
+        }
+        if (c > 0 && cascade.sizeRatio >= config.cascades[c - 1].sizeRatio) {
+            std::cerr << "Ocean FFT: Cascades must be ordered from largest to smallest tile!" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void OceanFFT::SetupCascades() {
+    cascadeCount = config.cascadeCount;
+    for (int c = 0; c < cascadeCount; c++) {
+        cascades[c].patchSize = config.oceanSize * config.cascades[c].sizeRatio;
+        cascades[c].updateInterval = config.cascades[c].updateInterval;
+    }
     
-    return glm::vec2(dispX, dispZ);
+    // Split the spectrum at each boundary, never past what the larger tile can resolve.
+    // Sizes are strictly decreasing, so the cut-offs increase from cascade to cascade.
+    for (int c = 0; c < cascadeCount; c++) {
+        Cascade& cascade = cascades[c];
+        cascade.minWavenumber = c == 0 ? 0.0f : cascades[c - 1].maxWavenumber;
+        if (c + 1 < cascadeCount) {
+            float nyquist = PI * config.N / cascade.patchSize;
+            float handover = CASCADE_BAND_START * 2.0f * PI / cascades[c + 1].patchSize;
+            cascade.maxWavenumber = (std::min)(nyquist, handover);
+        } else {
+            cascade.maxWavenumber = (std::numeric_limits<float>::max)();
+        }
+    }
 }
 
 bool OceanFFT::CreateGeometry() {
@@ -227,100 +529,306 @@ bool OceanFFT::CreateGeometry() {
     
     SetupVertexData();
     
-    std::cout << "Created FFT ocean grid: " << vertices.size()/5 << " vertices, " 
+    std::cout << "Created FFT ocean grid: " << vertices.size()/5 << " vertices, "
               << indices.size()/3 << " triangles" << std::endl;
     
     return true;
 }
 
 bool OceanFFT::CreateTextures() {
-    // Create heightmap texture
-    glGenTextures(1, &heightmapTexture);
-    glBindTexture(GL_TEXTURE_2D, heightmapTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, config.N, config.N, 0, GL_RG, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    
-    // Create displacement texture
-    if (config.enableChoppiness) {
-        glGenTextures(1, &displacementTexture);
-        glBindTexture(GL_TEXTURE_2D, displacementTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, config.N, config.N, 0, GL_RGBA, GL_FLOAT, nullptr);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    }
-    
-    // Create normal texture
-    glGenTextures(1, &normalTexture);
-    glBindTexture(GL_TEXTURE_2D, normalTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, config.N, config.N, 0, GL_RGBA, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    
-    // Create foam texture
-    if (config.enableFoam) {
-        glGenTextures(1, &foamTexture);
-        glBindTexture(GL_TEXTURE_2D, foamTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, config.N, config.N, 0, GL_RED, GL_FLOAT, nullptr);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    }
-    
-    // Create spectrum texture
-    glGenTextures(1, &spectrumTexture);
-    glBindTexture(GL_TEXTURE_2D, spectrumTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, config.N, config.N, 0, GL_RGBA, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // Outputs sampled by ocean_fft.vert, two layers per cascade
+    displacementMaps = CreateFloatTextureArray(GL_RGBA32F, config.N, config.N, cascadeCount * 2);
+    surfaceMaps = CreateFloatTextureArray(GL_RGBA32F, config.N, config.N, cascadeCount * 2);
+    
+    // FFT working set per cascade: the evolved spectrum and its ping-pong partner
+    for (int c = 0; c < cascadeCount; c++) {
+        Cascade& cascade = cascades[c];
+        cascade.spectrumTexture = CreateFloatTexture(GL_RGBA32F, config.N, config.N, GL_NEAREST, GL_CLAMP_TO_EDGE);
+        cascade.pingPongTexture = CreateFloatTexture(GL_RGBA32F, config.N, config.N, GL_NEAREST, GL_CLAMP_TO_EDGE);
+        cascade.h0Texture = CreateFloatTexture(GL_RGBA32F, config.N, config.N, GL_NEAREST, GL_CLAMP_TO_EDGE);
+        CreateReadbackBuffers(cascade);
+    }
+    
+    CreateButterflyTexture();
+    glBindTexture(GL_TEXTURE_2D, 0);
     
     return true;
 }
 
+void OceanFFT::CreateReadbackBuffers(Cascade& cascade) {
+    GLsizeiptr size = static_cast<GLsizeiptr>(config.N) * config.N * sizeof(glm::vec4);
+    glGenBuffers(READBACK_RING_SIZE, cascade.readbackBuffers);
+    for (int i = 0; i < READBACK_RING_SIZE; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, cascade.readbackBuffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+// glGetTexImage cannot pick one array layer before GL 4.5, so the layer is read
+// through the framebuffer; with a pack buffer bound, glReadPixels only queues the copy
+void OceanFFT::QueueReadback(Cascade& cascade, int layer) {
+    if (cascade.readbackPending == READBACK_RING_SIZE) {
+        // GPU is more than a ring behind; skip an update rather than wait
+        return;
+    }
+    
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    
+    int slot = (cascade.readbackHead + cascade.readbackPending) % READBACK_RING_SIZE;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, displacementMaps, 0, layer);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, cascade.readbackBuffers[slot]);
+    glReadPixels(0, 0, config.N, config.N, GL_RGBA, GL_FLOAT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    
+    cascade.readbackFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    cascade.readbackPending++;
+}
+
+// Returns true when a new copy replaced the cascade's CPU-side surface
+bool OceanFFT::CollectReadback(Cascade& cascade) {
+    // Retire every finished copy but only read the newest of them
+    int newest = -1;
+    while (cascade.readbackPending > 0) {
+        int slot = cascade.readbackHead;
+        GLenum status = glClientWaitSync(cascade.readbackFences[slot], 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) break;
+        
+        glDeleteSync(cascade.readbackFences[slot]);
+        cascade.readbackFences[slot] = nullptr;
+        cascade.readbackHead = (cascade.readbackHead + 1) % READBACK_RING_SIZE;
+        cascade.readbackPending--;
+        if (status != GL_WAIT_FAILED) newest = slot;
+    }
+    if (newest < 0) return false;
+    
+    bool collected = false;
+    size_t texelCount = static_cast<size_t>(config.N) * config.N;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, cascade.readbackBuffers[newest]);
+    const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, texelCount * sizeof(glm::vec4), GL_MAP_READ_BIT);
+    if (data) {
+        cascade.displacementLevels.resize(1);
+        cascade.displacementLevels[0].resize(texelCount);
+        std::memcpy(cascade.displacementLevels[0].data(), data, texelCount * sizeof(glm::vec4));
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        
+        BuildReadbackMips(cascade);
+        collected = true;
+    } else {
+        std::cerr << "Ocean FFT: failed to map displacement readback buffer" << std::endl;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return collected;
+}
+
+// 2x2 box filter down to 1x1; the map tiles, so every level stays periodic
+void OceanFFT::BuildReadbackMips(Cascade& cascade) {
+    std::vector<std::vector<glm::vec4>>& levels = cascade.displacementLevels;
+    int size = config.N;
+    size_t level = 0;
+    while (size > 1) {
+        int half = size / 2;
+        if (levels.size() <= level + 1) {
+            levels.emplace_back();
+        }
+        const std::vector<glm::vec4>& source = levels[level];
+        std::vector<glm::vec4>& target = levels[level + 1];
+        target.resize(static_cast<size_t>(half) * half);
+        
+        for (int z = 0; z < half; z++) {
+            const glm::vec4* row0 = &source[static_cast<size_t>(z * 2) * size];
+            const glm::vec4* row1 = row0 + size;
+            for (int x = 0; x < half; x++) {
+                target[static_cast<size_t>(z) * half + x] =
+                    (row0[x * 2] + row0[x * 2 + 1] + row1[x * 2] + row1[x * 2 + 1]) * 0.25f;
+            }
+        }
+        
+        size = half;
+        level++;
+    }
+}
+
+// Decimation-in-time radix-2 butterflies. Stage 0 reads bit-reversed inputs, so
+// the passes can run in place order without a separate reordering step.
+void OceanFFT::CreateButterflyTexture() {
+    const int log2N = GetLog2N();
+    std::vector<float> butterfly(static_cast<size_t>(log2N) * config.N * 4);
+    
+    for (int x = 0; x < config.N; x++) {
+        for (int stage = 0; stage < log2N; stage++) {
+            int span = 1 << stage;
+            bool topWing = (x % (span * 2)) < span;
+            
+            // Inverse transform, so the twiddle is exp(+2*pi*i*k/N)
+            int k = (x * (config.N >> (stage + 1))) % config.N;
+            float angle = 2.0f * PI * k / config.N;
+            
+            int i0, i1;
+            if (stage == 0) {
+                i0 = topWing ? ReverseBits(x, log2N) : ReverseBits(x - 1, log2N);
+                i1 = topWing ? ReverseBits(x + 1, log2N) : ReverseBits(x, log2N);
+            } else {
+                i0 = topWing ? x : x - span;
+                i1 = topWing ? x + span : x;
+            }
+            
+            float* texel = &butterfly[(static_cast<size_t>(x) * log2N + stage) * 4];
+            texel[0] = cos(angle);
+            texel[1] = sin(angle);
+            texel[2] = static_cast<float>(i0);
+            texel[3] = static_cast<float>(i1);
+        }
+    }
+    
+    butterflyTexture = CreateFloatTexture(GL_RGBA32F, log2N, config.N, GL_NEAREST, GL_CLAMP_TO_EDGE);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, log2N, config.N, GL_RGBA, GL_FLOAT, butterfly.data());
+}
+
+// Read framebuffer for the displacement readbacks
 bool OceanFFT::CreateFramebuffers() {
     glGenFramebuffers(1, &framebuffer);
     return true;
 }
 
 bool OceanFFT::InitializeShaders() {
-    // For now, create basic shaders - compute shaders will be added in next step
     oceanVertexShader = std::make_unique<Shader>();
-    if (!oceanVertexShader->InitFromFiles("shaders/ocean_fft.vert", "shaders/ocean_fft.frag")) {
+    if (!oceanVertexShader->InitFromFiles("shaders/ocean_fft.vert", "shaders/ocean_fft.frag",
+                                          config.useLOD ? OCEAN_LOD_DEFINE : "")) {
         std::cerr << "Failed to initialize FFT ocean shaders!" << std::endl;
         return false;
     }
     
+    // Missing compute support is not fatal: the surface stays flat but still renders
+    gpuFFTAvailable = false;
+    if (!Shader::IsComputeSupported()) {
+        std::cerr << "Ocean FFT: compute shaders not supported (needs OpenGL 4.3), ocean will be flat" << std::endl;
+        return true;
+    }
+    
+    initialSpectrumShader = std::make_unique<Shader>();
+    spectrumShader = std::make_unique<Shader>();
+    fftHorizontalShader = std::make_unique<Shader>();
+    fftVerticalShader = std::make_unique<Shader>();
+    combineMapsShader = std::make_unique<Shader>();
+    if (!initialSpectrumShader->InitComputeFromFile("shaders/ocean_fft_initial_spectrum.comp") ||
+        !spectrumShader->InitComputeFromFile("shaders/ocean_fft_spectrum.comp") ||
+        !fftHorizontalShader->InitComputeFromFile("shaders/ocean_fft_horizontal.comp") ||
+        !fftVerticalShader->InitComputeFromFile("shaders/ocean_fft_vertical.comp") ||
+        !combineMapsShader->InitComputeFromFile("shaders/ocean_fft_combine.comp")) {
+        std::cerr << "Ocean FFT: failed to build compute shaders, ocean will be flat" << std::endl;
+        return true;
+    }
+    
+    gpuFFTAvailable = true;
     return true;
 }
 
 void OceanFFT::GenerateInitialSpectrum() {
-    initialSpectrum.resize(config.N * config.N);
+    spectrumDirty = false;
+    for (int c = 0; c < cascadeCount; c++) {
+        cascades[c].stale = true;
+    }
+    
+    if (!gpuFFTAvailable) {
+        for (int c = 0; c < cascadeCount; c++) {
+            GenerateInitialSpectrumCPU(c);
+        }
+        return;
+    }
+    
+    const GLuint groups = config.N / FFT_WORKGROUP_SIZE;
+    glm::vec2 windNormalized = glm::normalize(waveParams.windDirection);
     
-    for (int m = 0; m < config.N; m++) {
+    initialSpectrumShader->use();
+    glUniform1i(initialSpectrumShader->getUniformLocation(UNIFORM_N), config.N);
+    glUniform1f(initialSpectrumShader->getUniformLocation(UNIFORM_AMPLITUDE), waveParams.A);
+    glUniform1f(initialSpectrumShader->getUniformLocation(UNIFORM_WIND_SPEED), glm::length(waveParams.windSpeed));
+    glUniform2fv(initialSpectrumShader->getUniformLocation(UNIFORM_WIND_DIRECTION), 1, &windNormalized[0]);
+    glUniform1f(initialSpectrumShader->getUniformLocation(UNIFORM_DAMPING), waveParams.damping);
+    glUniform1f(initialSpectrumShader->getUniformLocation(UNIFORM_GRAVITY), waveParams.gravity);
+    
+    for (int c = 0; c < cascadeCount; c++) {
+        const Cascade& cascade = cascades[c];
+        glUniform1f(initialSpectrumShader->getUniformLocation(UNIFORM_OCEAN_SIZE), cascade.patchSize);
+        glUniform1f(initialSpectrumShader->getUniformLocation(UNIFORM_MIN_WAVENUMBER), cascade.minWavenumber);
+        glUniform1f(initialSpectrumShader->getUniformLocation(UNIFORM_MAX_WAVENUMBER), cascade.maxWavenumber);
+        glUniform1ui(initialSpectrumShader->getUniformLocation(UNIFORM_SEED), GetCascadeSeed(c));
+        
+        glBindImageTexture(0, cascade.h0Texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        glDispatchCompute(groups, groups, 1);
+    }
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+// Same spectrum as the compute path, split across threads by rows. Only used
+// when compute shaders are unavailable.
+void OceanFFT::GenerateInitialSpectrumCPU(int cascade) {
+    Cascade& target = cascades[cascade];
+    target.initialSpectrum.resize(static_cast<size_t>(config.N) * config.N * 4);
+    
+    unsigned int workerCount = std::thread::hardware_concurrency();
+    workerCount = (std::min)(workerCount, static_cast<unsigned int>(config.N / MIN_ROWS_PER_WORKER));
+    if (workerCount < 2) {
+        GenerateSpectrumRows(cascade, 0, config.N);
+    } else {
+        // Contiguous row ranges, one per hardware thread; the calling thread takes the last one
+        int chunk = (config.N + workerCount - 1) / workerCount;
+        std::vector<std::thread> workers;
+        workers.reserve(workerCount - 1);
+        for (unsigned int w = 0; w + 1 < workerCount; ++w) {
+            int begin = w * chunk;
+            int end = (std::min)(config.N, begin + chunk);
+            if (begin >= end) break;
+            workers.emplace_back(&OceanFFT::GenerateSpectrumRows, this, cascade, begin, end);
+        }
+        GenerateSpectrumRows(cascade, (std::min)(config.N, static_cast<int>(workerCount - 1) * chunk), config.N);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    
+    if (target.h0Texture == 0) return;
+    
+    glBindTexture(GL_TEXTURE_2D, target.h0Texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, config.N, config.N, GL_RGBA, GL_FLOAT, target.initialSpectrum.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void OceanFFT::GenerateSpectrumRows(int cascade, int beginRow, int endRow) {
+    std::vector<float>& spectrum = cascades[cascade].initialSpectrum;
+    for (int m = beginRow; m < endRow; m++) {
         for (int n = 0; n < config.N; n++) {
-            glm::vec2 k = GetWaveVector(n, m);
+            // Each texel also evaluates its mirror, so rows never depend on each other
+            Complex h0 = GetInitialAmplitude(cascade, n, m);
+            Complex h0Minus = GetInitialAmplitude(cascade, (config.N - n) % config.N, (config.N - m) % config.N).conjugate();
             
-            if (glm::length(k) < 0.000001f) {
-                initialSpectrum[m * config.N + n] = Complex(0.0f, 0.0f);
-            } else {
-                float phillips = PhillipsSpectrum(k);
-                Complex gaussianRand = GetGaussianRandom();
-                
-                initialSpectrum[m * config.N + n] = gaussianRand * sqrt(phillips * 0.5f);
-            }
+            float* texel = &spectrum[(static_cast<size_t>(m) * config.N + n) * 4];
+            texel[0] = h0.real;
+            texel[1] = h0.imag;
+            texel[2] = h0Minus.real;
+            texel[3] = h0Minus.imag;
         }
     }
 }
 
+OceanFFT::Complex OceanFFT::GetInitialAmplitude(int cascade, int n, int m) const {
+    const Cascade& source = cascades[cascade];
+    glm::vec2 k = GetWaveVector(n, m, source.patchSize);
+    float kLength = glm::length(k);
+    if (kLength < 0.000001f || kLength < source.minWavenumber || kLength >= source.maxWavenumber) {
+        return Complex(0.0f, 0.0f);
+    }
+    
+    float amplitude = sqrt(PhillipsSpectrum(k) * 0.5f);
+    Complex gaussianRand = GetGaussianRandom(GetCascadeSeed(cascade), m * config.N + n);
+    return Complex(gaussianRand.real * amplitude, gaussianRand.imag * amplitude);
+}
+
 float OceanFFT::PhillipsSpectrum(const glm::vec2& k) const {
     float kLength = glm::length(k);
     if (kLength < 0.000001f) return 0.0f;
@@ -345,23 +853,91 @@ float OceanFFT::DispersionRelation(const glm::vec2& k) const {
     return sqrt(waveParams.gravity * glm::length(k));
 }
 
-OceanFFT::Complex OceanFFT::GetGaussianRandom() {
-    return Complex(gaussianDist(rng), gaussianDist(rng));
+OceanFFT::Complex OceanFFT::GetGaussianRandom(uint32_t seed, int index) const {
+    // Box-Muller over two hashed counters
+    uint32_t base = PcgHash(seed) ^ (static_cast<uint32_t>(index) * 2u);
+    float u1 = HashToUnit(PcgHash(base));
+    float u2 = HashToUnit(PcgHash(base + 1u));
+    float radius = sqrt(-2.0f * log(u1));
+    float theta = 2.0f * PI * u2;
+    return Complex(radius * cos(theta), radius * sin(theta));
 }
 
-void OceanFFT::UpdateSpectrum(float currentTime) {
-    // This would update the time-dependent spectrum
-    // For now, keep it simple
+// Cascade 0 keeps the plain seed, so a single-cascade ocean looks as it always did
+uint32_t OceanFFT::GetCascadeSeed(int cascade) const {
+    return spectrumSeed + static_cast<uint32_t>(cascade) * CASCADE_SEED_STEP;
 }
 
-void OceanFFT::ComputeFFT() {
-    // FFT computation will be implemented with compute shaders
-    // For now, this is a placeholder
+void OceanFFT::SolveCascade(int cascade, int layer, float currentTime) {
+    Cascade& target = cascades[cascade];
+    UpdateSpectrum(target, currentTime);
+    ComputeFFT(target, cascade * 2 + layer);
+    target.layerTimes[layer] = currentTime;
 }
 
-void OceanFFT::PerformFFTPass(GLuint inputTexture, GLuint outputTexture, 
-                             const Shader& shader, bool horizontal) {
-    // FFT pass implementation
+void OceanFFT::UpdateSpectrum(const Cascade& cascade, float currentTime) {
+    const GLuint groups = config.N / FFT_WORKGROUP_SIZE;
+    
+    spectrumShader->use();
+    glUniform1f(spectrumShader->getUniformLocation(UNIFORM_TIME), currentTime);
+    glUniform1f(spectrumShader->getUniformLocation(UNIFORM_GRAVITY), waveParams.gravity);
+    glUniform1f(spectrumShader->getUniformLocation(UNIFORM_OCEAN_SIZE), cascade.patchSize);
+    glUniform1i(spectrumShader->getUniformLocation(UNIFORM_N), config.N);
+    
+    glBindImageTexture(0, cascade.h0Texture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(1, cascade.spectrumTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glDispatchCompute(groups, groups, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+// Leaves the result in one layer of displacementMaps and surfaceMaps
+void OceanFFT::ComputeFFT(Cascade& cascade, int layer) {
+    const GLuint groups = config.N / FFT_WORKGROUP_SIZE;
+    
+    // Rows, then columns; each pass leaves its result in either texture
+    GLuint result = PerformFFTPass(cascade.spectrumTexture, cascade.pingPongTexture, *fftHorizontalShader, true);
+    GLuint scratch = result == cascade.spectrumTexture ? cascade.pingPongTexture : cascade.spectrumTexture;
+    result = PerformFFTPass(result, scratch, *fftVerticalShader, false);
+    
+    combineMapsShader->use();
+    glUniform1i(combineMapsShader->getUniformLocation(UNIFORM_N), config.N);
+    glUniform1f(combineMapsShader->getUniformLocation(UNIFORM_OCEAN_SIZE), cascade.patchSize);
+    glUniform1f(combineMapsShader->getUniformLocation(UNIFORM_CHOPPINESS), waveParams.lambda);
+    glUniform1i(combineMapsShader->getUniformLocation(UNIFORM_ENABLE_CHOPPINESS), config.enableChoppiness);
+    glUniform1i(combineMapsShader->getUniformLocation(UNIFORM_ENABLE_FOAM), config.enableFoam);
+    glUniform1f(combineMapsShader->getUniformLocation(UNIFORM_FOAM_THRESHOLD), config.foamThreshold);
+    
+    // Non-layered bindings expose a single array layer as an image2D
+    glBindImageTexture(0, result, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(1, displacementMaps, 0, GL_FALSE, layer, GL_WRITE_ONLY, GL_RGBA32F);
+    glBindImageTexture(2, surfaceMaps, 0, GL_FALSE, layer, GL_WRITE_ONLY, GL_RGBA32F);
+    glDispatchCompute(groups, groups, 1);
+    
+    // The ocean vertex shader samples the outputs as regular textures, and the readback copies one
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+GLuint OceanFFT::PerformFFTPass(GLuint inputTexture, GLuint outputTexture,
+                                const Shader& shader, bool horizontal) {
+    const GLuint groups = config.N / FFT_WORKGROUP_SIZE;
+    const int log2N = GetLog2N();
+    
+    shader.use();
+    glUniform1i(shader.getUniformLocation(UNIFORM_N), config.N);
+    glBindImageTexture(0, butterflyTexture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    
+    for (int stage = 0; stage < log2N; stage++) {
+        glUniform1i(shader.getUniformLocation(UNIFORM_STAGE), stage);
+        glBindImageTexture(1, inputTexture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        glDispatchCompute(groups, groups, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        
+        std::swap(inputTexture, outputTexture);
+    }
+    
+    // After the final swap the latest output is in inputTexture
+    return inputTexture;
 }
 
 void OceanFFT::SetupVertexData() {
@@ -389,57 +965,57 @@ void OceanFFT::SetupVertexData() {
 }
 
 void OceanFFT::BindTextures() {
-    if (heightmapTexture != 0) {
+    if (displacementMaps != 0) {
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, heightmapTexture);
-        glUniform1i(glGetUniformLocation(oceanVertexShader->shaderProgram, "heightmapTexture"), 0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, displacementMaps);
+        glUniform1i(glGetUniformLocation(oceanVertexShader->shaderProgram, "displacementMaps"), 0);
     }
     
-    if (displacementTexture != 0) {
+    if (surfaceMaps != 0) {
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, displacementTexture);
-        glUniform1i(glGetUniformLocation(oceanVertexShader->shaderProgram, "displacementTexture"), 1);
-    }
-    
-    if (normalTexture != 0) {
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, normalTexture);
-        glUniform1i(glGetUniformLocation(oceanVertexShader->shaderProgram, "normalTexture"), 2);
-    }
-    
-    if (foamTexture != 0) {
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, foamTexture);
-        glUniform1i(glGetUniformLocation(oceanVertexShader->shaderProgram, "foamTexture"), 3);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, surfaceMaps);
+        glUniform1i(glGetUniformLocation(oceanVertexShader->shaderProgram, "surfaceMaps"), 1);
     }
 }
 
-void OceanFFT::SetShaderUniforms(const glm::mat4& view, const glm::mat4& projection,
-                                 const glm::vec3& cameraPos, const glm::vec3& lightDir,
-                                 const glm::vec3& lightColor, const glm::vec3& skyColor) {
+// Camera matrices, camera position and sun come from the shared FrameData block
+void OceanFFT::SetShaderUniforms(const glm::vec3& skyColor) {
     GLuint shaderProgram = oceanVertexShader->shaderProgram;
     
     // Matrices
     glm::mat4 model = glm::mat4(1.0f);
     glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, &model[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, &view[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, &projection[0][0]);
     
     // Ocean parameters
     glUniform1f(glGetUniformLocation(shaderProgram, "time"), time);
     glUniform1f(glGetUniformLocation(shaderProgram, "oceanSize"), config.oceanSize);
     glUniform1f(glGetUniformLocation(shaderProgram, "choppiness"), waveParams.lambda);
+    glUniform1i(glGetUniformLocation(shaderProgram, "enableChoppiness"), config.enableChoppiness && gpuFFTAvailable);
+    
+    // Cascades; without compute support the maps are never written, so none are summed
+    float sizes[MAX_CASCADES] = {};
+    glm::vec3 layers[MAX_CASCADES];
+    for (int c = 0; c < cascadeCount; c++) {
+        const Cascade& cascade = cascades[c];
+        int newer = cascade.latestLayer;
+        int older = 1 - newer;
+        float span = cascade.layerTimes[newer] - cascade.layerTimes[older];
+        float blend = span > 0.0f ? glm::clamp((time - cascade.layerTimes[older]) / span, 0.0f, 1.0f) : 1.0f;
+        
+        sizes[c] = cascade.patchSize;
+        layers[c] = glm::vec3(static_cast<float>(c * 2 + older), static_cast<float>(c * 2 + newer), blend);
+    }
+    glUniform1i(glGetUniformLocation(shaderProgram, "cascadeCount"), gpuFFTAvailable ? cascadeCount : 0);
+    glUniform1fv(glGetUniformLocation(shaderProgram, "cascadeSizes"), cascadeCount, sizes);
+    glUniform3fv(glGetUniformLocation(shaderProgram, "cascadeLayers"), cascadeCount, &layers[0][0]);
     
     // Lighting
-    glUniform3fv(glGetUniformLocation(shaderProgram, "cameraPos"), 1, &cameraPos[0]);
-    glUniform3fv(glGetUniformLocation(shaderProgram, "lightDir"), 1, &lightDir[0]);
-    glUniform3fv(glGetUniformLocation(shaderProgram, "lightColor"), 1, &lightColor[0]);
     glUniform3fv(glGetUniformLocation(shaderProgram, "skyColor"), 1, &skyColor[0]);
 }
 
-glm::vec2 OceanFFT::GetWaveVector(int n, int m) const {
-    float kx = (2.0f * PI * (n - config.N / 2)) / config.oceanSize;
-    float kz = (2.0f * PI * (m - config.N / 2)) / config.oceanSize;
+glm::vec2 OceanFFT::GetWaveVector(int n, int m, float patchSize) const {
+    float kx = (2.0f * PI * (n - config.N / 2)) / patchSize;
+    float kz = (2.0f * PI * (m - config.N / 2)) / patchSize;
     return glm::vec2(kx, kz);
 }
 
@@ -456,6 +1032,12 @@ bool OceanFFT::IsPowerOfTwo(int value) const {
     return value > 0 && (value & (value - 1)) == 0;
 }
 
+int OceanFFT::GetLog2N() const {
+    int log2N = 0;
+    while ((1 << log2N) < config.N) log2N++;
+    return log2N;
+}
+
 // Factory implementations
 OceanFFT::WaveParameters OceanFFTFactory::CreateCalmSea() {
     OceanFFT::WaveParameters params;
@@ -495,19 +1077,21 @@ OceanFFT::WaveParameters OceanFFTFactory::CreateTropicalWaves() {
 
 OceanFFT::OceanConfig OceanFFTFactory::CreateHighDetailConfig() {
     OceanFFT::OceanConfig config;
-    config.N = 1024;
+    config.N = 256;
     config.oceanSize = 2000.0f;
     config.enableChoppiness = true;
     config.enableFoam = true;
+    SetDefaultCascades(config);
     return config;
 }
 
 OceanFFT::OceanConfig OceanFFTFactory::CreateMediumDetailConfig() {
     OceanFFT::OceanConfig config;
-    config.N = 512;
+    config.N = 128;
     config.oceanSize = 1000.0f;
     config.enableChoppiness = true;
     config.enableFoam = true;
+    SetDefaultCascades(config);
     return config;
 }
 
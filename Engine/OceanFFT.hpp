@@ -4,12 +4,17 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
 #include <complex>
-#include <random>
 #include <memory>
 #include "Shader.hpp"
+#include "OceanLOD.hpp"
 
 class OceanFFT {
 public:
+    // Displacement readbacks in flight; three frames keeps mapping off the GPU's critical path
+    static const int READBACK_RING_SIZE = 3;
+    // Must match MAX_CASCADES in ocean_fft.vert
+    static const int MAX_CASCADES = 4;
+    
     // Tessendorf wave parameters
     struct WaveParameters {
         float A = 0.0001f;          // Wave amplitude scaling factor
@@ -21,14 +26,25 @@ public:
         float gravity = 9.81f;      // Gravitational constant
     };
     
+    // One FFT tile in the cascade stack
+    struct CascadeConfig {
+        float sizeRatio = 1.0f;     // Tile size relative to oceanSize
+        int updateInterval = 1;     // Frames between FFT runs; above 1 the surface blends two solutions
+    };
+    
     // Ocean configuration
     struct OceanConfig {
-        int N = 512;                // Grid resolution (must be power of 2)
-        float oceanSize = 1000.0f;  // Physical size in meters
+        int N = 512;                // Grid resolution of every cascade (must be power of 2)
+        float oceanSize = 1000.0f;  // Physical size of the first (largest) cascade in meters
         float timeScale = 1.0f;     // Time animation speed multiplier
         bool enableChoppiness = true; // Enable horizontal displacement
         bool enableFoam = true;     // Enable foam generation
         float foamThreshold = 0.8f; // Foam generation threshold
+        bool useLOD = true;         // Tile the FFT patch over camera-relative LOD patches to the horizon
+        // Cascades ordered from largest to smallest tile; each owns its own band of the
+        // spectrum, so e.g. 3 x 128 can replace 1 x 512 for both swell and ripples
+        int cascadeCount = 1;
+        CascadeConfig cascades[MAX_CASCADES];
     };
     
     // Complex number for FFT calculations
@@ -55,18 +71,58 @@ public:
     };
 
 private:
+    // Per-cascade FFT state. Output maps live in the shared texture arrays at
+    // layers 2 * index and 2 * index + 1, alternating as the cascade updates.
+    struct Cascade {
+        float patchSize = 0.0f;
+        float minWavenumber = 0.0f;  // Spectrum band owned by this cascade
+        float maxWavenumber = 0.0f;
+        int updateInterval = 1;
+        
+        GLuint spectrumTexture = 0, pingPongTexture = 0;
+        GLuint h0Texture = 0;        // xy = h0(k), zw = conj(h0(-k)); rebuilt when the wave parameters change
+        
+        int latestLayer = 0;         // 0 or 1 within this cascade's pair
+        float layerTimes[2];         // Simulation time each layer was solved for
+        bool stale = true;           // Both layers need solving, e.g. after a spectrum rebuild
+        
+        // Filled only by the CPU fallback; same layout as h0Texture (4 floats per texel)
+        std::vector<float> initialSpectrum;
+        
+        // Async copies of the displacement layer for CPU-side height queries
+        GLuint readbackBuffers[READBACK_RING_SIZE];
+        GLsync readbackFences[READBACK_RING_SIZE];
+        int readbackHead = 0;    // Oldest copy still in flight
+        int readbackPending = 0; // Number of copies in flight
+        
+        // Latest completed readback (x = Dx, y = height, z = Dz) and its box-filtered mips;
+        // level 0 is N x N, empty until the first copy lands
+        std::vector<std::vector<glm::vec4>> displacementLevels;
+        
+        Cascade();
+    };
+    
     // Ocean parameters
     WaveParameters waveParams;
     OceanConfig config;
     
     // OpenGL resources
     GLuint VAO, VBO, EBO;
-    GLuint heightmapTexture, displacementTexture, normalTexture, foamTexture;
-    GLuint spectrumTexture, phaseTexture;
+    OceanLOD surfaceLOD;     // Used instead of the N x N grid when config.useLOD is set
+    GLuint displacementMaps; // 2D array, two layers per cascade: x = Dx, y = height, z = Dz
+    GLuint surfaceMaps;      // 2D array, same layers: x = dh/dx, y = dh/dz, z = foam
+    GLuint butterflyTexture; // log2(N) x N twiddle factors and input indices for the FFT stages
     GLuint framebuffer;
     
+    Cascade cascades[MAX_CASCADES];
+    int cascadeCount = 1;
+    int frameIndex = 0;      // Staggers cascade updates so they do not all land on one frame
+    float timeStep = 0.0f;   // Last scaled frame step, used to solve slow cascades ahead of time
+    float readbackTime = 0.0f;
+    
     // Compute shaders
-    std::unique_ptr<Shader> spectrumShader;      // Generate initial spectrum
+    std::unique_ptr<Shader> initialSpectrumShader; // Generate h0 from the wave parameters
+    std::unique_ptr<Shader> spectrumShader;      // Evolve the initial spectrum to the current time
     std::unique_ptr<Shader> fftHorizontalShader; // Horizontal FFT pass
     std::unique_ptr<Shader> fftVerticalShader;   // Vertical FFT pass
     std::unique_ptr<Shader> combineMapsShader;   // Combine height/displacement maps
@@ -76,17 +132,19 @@ private:
     std::unique_ptr<Shader> oceanFragmentShader;
     
     // CPU-side data
-    std::vector<Complex> initialSpectrum;
     std::vector<float> vertices;
     std::vector<unsigned int> indices;
     
     // Animation
     float time = 0.0f;
     bool isInitialized = false;
+    // False when compute shaders are unavailable; the ocean then renders flat
+    bool gpuFFTAvailable = false;
     
-    // Random number generation
-    std::mt19937 rng;
-    std::normal_distribution<float> gaussianDist;
+    // Seed for the hashed Gaussian draws behind h0
+    uint32_t spectrumSeed = 42;
+    // Set by SetWaveParameters; the spectrum is rebuilt once in the next Update
+    bool spectrumDirty = false;
 
 public:
     OceanFFT();
@@ -106,14 +164,27 @@ public:
     
     // Animation and rendering
     void Update(float deltaTime);
-    void Render(const glm::mat4& view, const glm::mat4& projection, 
-                const glm::vec3& cameraPos, const glm::vec3& lightDir,
-                const glm::vec3& lightColor, const glm::vec3& skyColor);
+    // Camera and sun state is read from the FrameData block bound by the renderer;
+    // the matrices and camera position here only drive LOD patch selection
+    void Render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition,
+                const glm::vec3& skyColor);
+    
+    // Wave sampling for physics/buoyancy. Queries sum the most recent GPU readback of
+    // every cascade, which trails the rendered surface by up to READBACK_RING_SIZE
+    // updates of that cascade; before the first one arrives (or without compute
+    // support) the surface is flat.
+    // x/z are world positions. Higher mip levels trade detail for cache-friendly lookups.
+    float SampleHeight(float x, float z, int mipLevel = 0) const;
+    glm::vec3 SampleNormal(float x, float z, int mipLevel = 0) const;
+    glm::vec2 SampleDisplacement(float x, float z, int mipLevel = 0) const;
+    void SampleHeights(const glm::vec2* positions, float* heights, size_t count, int mipLevel = 0) const;
     
-    // Wave sampling for physics/buoyancy
-    float SampleHeight(float x, float z, float currentTime = -1.0f) const;
-    glm::vec3 SampleNormal(float x, float z, float currentTime = -1.0f) const;
-    glm::vec2 SampleDisplacement(float x, float z, float currentTime = -1.0f) const;
+    bool HasReadback() const;
+    int GetReadbackLevelCount() const;
+    int GetCascadeCount() const { return cascadeCount; }
+    float GetCascadeSize(int cascade) const { return cascades[cascade].patchSize; }
+    // Simulation time of the surface the queries currently see
+    float GetReadbackTime() const { return readbackTime; }
     
 private:
     // Initialization helpers
@@ -121,30 +192,53 @@ private:
     bool CreateTextures();
     bool CreateFramebuffers();
     bool InitializeShaders();
+    bool ValidateCascades() const;
+    void SetupCascades();
     
     // Wave spectrum generation
     void GenerateInitialSpectrum();
+    void GenerateInitialSpectrumCPU(int cascade);
+    void GenerateSpectrumRows(int cascade, int beginRow, int endRow);
     float PhillipsSpectrum(const glm::vec2& k) const;
     float DispersionRelation(const glm::vec2& k) const;
-    Complex GetGaussianRandom();
+    Complex GetInitialAmplitude(int cascade, int n, int m) const;
+    // Deterministic standard normal pair for one texel, identical to the compute shader's
+    Complex GetGaussianRandom(uint32_t seed, int index) const;
+    uint32_t GetCascadeSeed(int cascade) const;
     
     // FFT computation
-    void UpdateSpectrum(float currentTime);
-    void ComputeFFT();
-    void PerformFFTPass(GLuint inputTexture, GLuint outputTexture, 
-                       const Shader& shader, bool horizontal);
+    // Evolves the spectrum to currentTime and writes the result into one output layer
+    void SolveCascade(int cascade, int layer, float currentTime);
+    void UpdateSpectrum(const Cascade& cascade, float currentTime);
+    void ComputeFFT(Cascade& cascade, int layer);
+    // Runs every butterfly stage along one axis, ping-ponging between the two
+    // textures; returns whichever one holds the result
+    GLuint PerformFFTPass(GLuint inputTexture, GLuint outputTexture,
+                          const Shader& shader, bool horizontal);
+    void CreateButterflyTexture();
+    
+    // Displacement readback
+    void CreateReadbackBuffers(Cascade& cascade);
+    void QueueReadback(Cascade& cascade, int layer);
+    bool CollectReadback(Cascade& cascade);
+    void BuildReadbackMips(Cascade& cascade);
+    glm::vec4 SampleReadback(const Cascade& cascade, int level, float x, float z) const;
+    // Sum of every cascade's readback at (x, z)
+    glm::vec4 SampleSurface(int level, float x, float z) const;
+    // Finds the undisplaced grid position that choppy displacement moves onto (x, z)
+    glm::vec2 FindUndisplacedPosition(int level, float x, float z) const;
+    int ClampReadbackLevel(int mipLevel) const;
     
     // Rendering helpers
     void SetupVertexData();
     void BindTextures();
-    void SetShaderUniforms(const glm::mat4& view, const glm::mat4& projection,
-                          const glm::vec3& cameraPos, const glm::vec3& lightDir,
-                          const glm::vec3& lightColor, const glm::vec3& skyColor);
+    void SetShaderUniforms(const glm::vec3& skyColor);
     
     // Utility functions
-    glm::vec2 GetWaveVector(int n, int m) const;
+    glm::vec2 GetWaveVector(int n, int m, float patchSize) const;
     unsigned int ReverseBits(unsigned int value, int numBits) const;
     bool IsPowerOfTwo(int value) const;
+    int GetLog2N() const;
 };
 
 // Factory for common ocean configurations
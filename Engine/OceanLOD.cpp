@@ -0,0 +1,270 @@
+#include "OceanLOD.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr uint32_t UNIFORM_LOD_GRID_RESOLUTION = HashUniformName("lodGridResolution");
+    constexpr uint32_t UNIFORM_LOD_MORPH_RANGES = HashUniformName("lodMorphRanges");
+    
+    const int GROUP_COUNT = 5;
+}
+
+OceanLOD::OceanLOD()
+    : vao(0), gridVBO(0), ebo(0), instanceVBO(0), instanceCapacity(0), quadrantIndexCount(0),
+      selectionCamera(0.0f), selectionFrustum(nullptr)
+{
+    for (int group = 0; group < GROUP_COUNT; ++group) {
+        groupOffsets[group] = 0;
+        groupCounts[group] = 0;
+    }
+}
+
+OceanLOD::~OceanLOD()
+{
+    Cleanup();
+}
+
+bool OceanLOD::Initialize(const Settings& lodSettings)
+{
+    Cleanup();
+    settings = lodSettings;
+    
+    if (settings.patchResolution < 2 || settings.patchResolution % 2 != 0) {
+        std::cerr << "Ocean LOD: patch resolution must be even and at least 2" << std::endl;
+        return false;
+    }
+    if (settings.levelCount < 1 || settings.levelCount > MAX_LEVELS) {
+        std::cerr << "Ocean LOD: level count must be between 1 and " << MAX_LEVELS << std::endl;
+        return false;
+    }
+    
+    computeRanges();
+    createGrid();
+    
+    std::cout << "Ocean LOD: " << settings.levelCount << " levels of " << settings.patchResolution << "x"
+              << settings.patchResolution << " patches, visible to " << GetVisibleDistance() << " m" << std::endl;
+    return true;
+}
+
+void OceanLOD::Cleanup()
+{
+    if (vao != 0) glDeleteVertexArrays(1, &vao);
+    if (gridVBO != 0) glDeleteBuffers(1, &gridVBO);
+    if (ebo != 0) glDeleteBuffers(1, &ebo);
+    if (instanceVBO != 0) glDeleteBuffers(1, &instanceVBO);
+    vao = gridVBO = ebo = instanceVBO = 0;
+    instanceCapacity = 0;
+    
+    for (int group = 0; group < GROUP_COUNT; ++group) {
+        selected[group].clear();
+        groupCounts[group] = 0;
+    }
+}
+
+void OceanLOD::computeRanges()
+{
+    ranges.resize(settings.levelCount);
+    morphRanges.resize(settings.levelCount);
+    
+    float previousRange = 0.0f;
+    for (int level = 0; level < settings.levelCount; ++level) {
+        ranges[level] = settings.finestPatchSize * static_cast<float>(1 << level) * settings.rangeMultiplier;
+        
+        float morphStart = previousRange + (ranges[level] - previousRange) * settings.morphStartRatio;
+        morphRanges[level] = glm::vec2(morphStart, 1.0f / (ranges[level] - morphStart));
+        previousRange = ranges[level];
+    }
+}
+
+// Indices are laid out quadrant by quadrant so a quarter patch is one contiguous range
+void OceanLOD::createGrid()
+{
+    const int resolution = settings.patchResolution;
+    const int half = resolution / 2;
+    
+    std::vector<glm::vec2> gridPositions;
+    gridPositions.reserve(static_cast<size_t>(resolution + 1) * (resolution + 1));
+    for (int z = 0; z <= resolution; ++z) {
+        for (int x = 0; x <= resolution; ++x) {
+            gridPositions.emplace_back(static_cast<float>(x) / resolution, static_cast<float>(z) / resolution);
+        }
+    }
+    
+    std::vector<unsigned int> indices;
+    indices.reserve(static_cast<size_t>(resolution) * resolution * 6);
+    for (int quadrant = 0; quadrant < 4; ++quadrant) {
+        int startX = (quadrant & 1) * half;
+        int startZ = (quadrant >> 1) * half;
+        for (int z = startZ; z < startZ + half; ++z) {
+            for (int x = startX; x < startX + half; ++x) {
+                unsigned int topLeft = z * (resolution + 1) + x;
+                unsigned int topRight = topLeft + 1;
+                unsigned int bottomLeft = (z + 1) * (resolution + 1) + x;
+                unsigned int bottomRight = bottomLeft + 1;
+                
+                indices.push_back(topLeft);
+                indices.push_back(bottomLeft);
+                indices.push_back(topRight);
+                
+                indices.push_back(topRight);
+                indices.push_back(bottomLeft);
+                indices.push_back(bottomRight);
+            }
+        }
+    }
+    quadrantIndexCount = static_cast<GLsizei>(half * half * 6);
+    
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &gridVBO);
+    glGenBuffers(1, &ebo);
+    glGenBuffers(1, &instanceVBO);
+    
+    glBindVertexArray(vao);
+    
+    glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+    glBufferData(GL_ARRAY_BUFFER, gridPositions.size() * sizeof(glm::vec2), gridPositions.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+    glEnableVertexAttribArray(0);
+    
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    
+    // Storage is allocated on the first Select
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glVertexAttribPointer(OCEAN_LOD_PATCH_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+    glEnableVertexAttribArray(OCEAN_LOD_PATCH_ATTRIBUTE);
+    glVertexAttribDivisor(OCEAN_LOD_PATCH_ATTRIBUTE, 1);
+    
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+AABB OceanLOD::getNodeBounds(float x, float z, float size) const
+{
+    // Choppy waves push vertices sideways by up to about the wave height
+    float margin = settings.maxWaveHeight;
+    return AABB(glm::vec3(x - margin, -settings.maxWaveHeight, z - margin),
+                glm::vec3(x + size + margin, settings.maxWaveHeight, z + size + margin));
+}
+
+bool OceanLOD::intersectsRange(const AABB& box, float range) const
+{
+    glm::vec3 closest = glm::clamp(selectionCamera, box.minPoint, box.maxPoint);
+    glm::vec3 offset = closest - selectionCamera;
+    return glm::dot(offset, offset) <= range * range;
+}
+
+// Returns false when the node lies outside its level's range, leaving the area to the parent
+bool OceanLOD::selectNode(float x, float z, int level)
+{
+    float size = settings.finestPatchSize * static_cast<float>(1 << level);
+    AABB bounds = getNodeBounds(x, z, size);
+    
+    if (!intersectsRange(bounds, ranges[level])) return false;
+    if (!selectionFrustum->intersects(bounds)) return true;
+    
+    if (level == 0 || !intersectsRange(bounds, ranges[level - 1])) {
+        selected[0].push_back(glm::vec4(x, z, size, static_cast<float>(level)));
+        return true;
+    }
+    
+    // The finer level covers part of this node; draw the remaining quarters at this level
+    float half = size * 0.5f;
+    for (int quadrant = 0; quadrant < 4; ++quadrant) {
+        float childX = x + (quadrant & 1) * half;
+        float childZ = z + (quadrant >> 1) * half;
+        if (!selectNode(childX, childZ, level - 1) &&
+            selectionFrustum->intersects(getNodeBounds(childX, childZ, half))) {
+            selected[1 + quadrant].push_back(glm::vec4(x, z, size, static_cast<float>(level)));
+        }
+    }
+    return true;
+}
+
+void OceanLOD::Select(const glm::vec3& cameraPosition, const Frustum& frustum)
+{
+    if (!IsInitialized()) return;
+    
+    for (int group = 0; group < GROUP_COUNT; ++group) {
+        selected[group].clear();
+    }
+    selectionCamera = cameraPosition;
+    selectionFrustum = &frustum;
+    
+    // Roots lie on a fixed world grid so patches never slide with the camera
+    const int topLevel = settings.levelCount - 1;
+    const float rootSize = settings.finestPatchSize * static_cast<float>(1 << topLevel);
+    const float range = ranges[topLevel];
+    const float startX = floor((cameraPosition.x - range) / rootSize) * rootSize;
+    const float startZ = floor((cameraPosition.z - range) / rootSize) * rootSize;
+    for (float z = startZ; z < cameraPosition.z + range; z += rootSize) {
+        for (float x = startX; x < cameraPosition.x + range; x += rootSize) {
+            selectNode(x, z, topLevel);
+        }
+    }
+    selectionFrustum = nullptr;
+    
+    // Pack the groups back to back; each draw picks its run with a base instance
+    size_t total = 0;
+    for (int group = 0; group < GROUP_COUNT; ++group) {
+        groupOffsets[group] = static_cast<GLint>(total);
+        groupCounts[group] = static_cast<GLsizei>(selected[group].size());
+        total += selected[group].size();
+    }
+    if (total == 0) return;
+    
+    if (total > instanceCapacity) {
+        instanceCapacity = (std::max)(total, instanceCapacity * 2);
+    }
+    
+    // Re-specifying orphans last frame's copy instead of waiting for the GPU to finish with it
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+    for (int group = 0; group < GROUP_COUNT; ++group) {
+        if (selected[group].empty()) continue;
+        glBufferSubData(GL_ARRAY_BUFFER, groupOffsets[group] * sizeof(glm::vec4),
+                        selected[group].size() * sizeof(glm::vec4), selected[group].data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void OceanLOD::Draw(const Shader& shader) const
+{
+    if (!IsInitialized()) return;
+    
+    glUniform1f(shader.getUniformLocation(UNIFORM_LOD_GRID_RESOLUTION), static_cast<float>(settings.patchResolution));
+    glUniform2fv(shader.getUniformLocation(UNIFORM_LOD_MORPH_RANGES), static_cast<GLsizei>(morphRanges.size()),
+                 &morphRanges[0][0]);
+    
+    glBindVertexArray(vao);
+    if (groupCounts[0] > 0) {
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, quadrantIndexCount * 4, GL_UNSIGNED_INT, (void*)0,
+                                            groupCounts[0], groupOffsets[0]);
+    }
+    for (int quadrant = 0; quadrant < 4; ++quadrant) {
+        GLsizei count = groupCounts[1 + quadrant];
+        if (count == 0) continue;
+        size_t indexOffset = static_cast<size_t>(quadrant) * quadrantIndexCount * sizeof(unsigned int);
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, quadrantIndexCount, GL_UNSIGNED_INT, (void*)indexOffset,
+                                            count, groupOffsets[1 + quadrant]);
+    }
+    glBindVertexArray(0);
+}
+
+size_t OceanLOD::GetPatchCount() const
+{
+    size_t count = 0;
+    for (int group = 0; group < GROUP_COUNT; ++group) {
+        count += selected[group].size();
+    }
+    return count;
+}
+
+size_t OceanLOD::GetVertexCount() const
+{
+    size_t full = static_cast<size_t>(settings.patchResolution + 1) * (settings.patchResolution + 1);
+    size_t quarter = static_cast<size_t>(settings.patchResolution / 2 + 1) * (settings.patchResolution / 2 + 1);
+    size_t quarters = GetPatchCount() - selected[0].size();
+    return selected[0].size() * full + quarters * quarter;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "Shader.hpp"
+#include "Frustum.hpp"
+
+// Define that switches the ocean vertex shaders to the LOD patch inputs (shaders/ocean_lod.glsl)
+const char* const OCEAN_LOD_DEFINE = "OCEAN_LOD";
+
+// Per-instance patch attribute (origin, size, level); location 0 holds the patch grid position
+const GLuint OCEAN_LOD_PATCH_ATTRIBUTE = 4;
+
+// Camera-relative ocean surface built from a quadtree of square patches
+// (Strugar's CDLOD). Every patch is the same (P+1)^2 vertex grid scaled to its
+// level; level 0 is the finest and each level doubles the patch size and the
+// distance it covers. Vertices morph towards the next coarser grid near the end
+// of their range, so levels meet without cracks or popping. Patches are
+// frustum culled on the CPU and drawn with one instanced call per patch shape.
+//
+// The vertex shader places the vertices; an ocean only needs to build its
+// program with OCEAN_LOD_DEFINE and call Draw() in place of its own grid.
+class OceanLOD {
+public:
+    // Matches OCEAN_LOD_MAX_LEVELS in shaders/ocean_lod.glsl
+    static const int MAX_LEVELS = 16;
+    
+    struct Settings {
+        int patchResolution = 32;        // Quads along one patch side (even)
+        int levelCount = 9;              // Level 0 .. levelCount - 1
+        float finestPatchSize = 8.0f;    // World size of a level 0 patch
+        float rangeMultiplier = 2.5f;    // Level L reaches rangeMultiplier * its patch size
+        float morphStartRatio = 0.7f;    // Fraction of a level's range before morphing starts
+        float maxWaveHeight = 10.0f;     // Vertical (and choppy horizontal) bound used for culling
+    };
+    
+private:
+    Settings settings;
+    
+    GLuint vao, gridVBO, ebo, instanceVBO;
+    size_t instanceCapacity;
+    GLsizei quadrantIndexCount;
+    
+    std::vector<float> ranges;        // Selection range per level
+    std::vector<glm::vec2> morphRanges; // Per level: morph start, 1 / morph length
+    
+    // Selected patches; index 0 holds whole patches, 1..4 the quadrants of
+    // patches whose other quadrants went to a finer level
+    std::vector<glm::vec4> selected[5];
+    GLint groupOffsets[5];
+    GLsizei groupCounts[5];
+    
+    glm::vec3 selectionCamera;
+    const Frustum* selectionFrustum;
+    
+    void createGrid();
+    void computeRanges();
+    bool selectNode(float x, float z, int level);
+    AABB getNodeBounds(float x, float z, float size) const;
+    bool intersectsRange(const AABB& box, float range) const;
+    
+public:
+    OceanLOD();
+    ~OceanLOD();
+    
+    bool Initialize(const Settings& lodSettings = Settings());
+    void Cleanup();
+    bool IsInitialized() const { return vao != 0; }
+    
+    // Picks and uploads this frame's patches around the camera
+    void Select(const glm::vec3& cameraPosition, const Frustum& frustum);
+    
+    // Sets the LOD uniforms on shader (already in use) and draws the selected patches
+    void Draw(const Shader& shader) const;
+    
+    const Settings& GetSettings() const { return settings; }
+    // Distance from the camera at which the surface ends
+    float GetVisibleDistance() const { return ranges.empty() ? 0.0f : ranges.back(); }
+    size_t GetPatchCount() const;
+    size_t GetVertexCount() const;
+};
@@ -1,5 +1,10 @@
 #include "OpenGL.hpp"
 #include "WindowWin.hpp"
+#include "ProgramBinaryCache.hpp"
+#include "Profiler.hpp"
+#include "JobSystem.hpp"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -8,7 +13,39 @@
 
 extern HWND hWndGlobal;
 
-OpenGL::OpenGL() : deltaTime(0.0f), frameCount(0), fps(0.0f)
+namespace {
+    // Uniform name hashes, folded at compile time for Shader::getUniformLocation
+    constexpr uint32_t UNIFORM_VIEW_POS = HashUniformName("viewPos");
+    constexpr uint32_t UNIFORM_LIGHT_POS = HashUniformName("lightPos");
+    constexpr uint32_t UNIFORM_LIGHT_COLOR = HashUniformName("lightColor");
+    constexpr uint32_t UNIFORM_NUM_DIR_LIGHTS = HashUniformName("numDirLights");
+    constexpr uint32_t UNIFORM_NUM_POINT_LIGHTS = HashUniformName("numPointLights");
+    constexpr uint32_t UNIFORM_NUM_SPOT_LIGHTS = HashUniformName("numSpotLights");
+    constexpr uint32_t UNIFORM_VIEW = HashUniformName("view");
+    constexpr uint32_t UNIFORM_PROJECTION = HashUniformName("projection");
+    constexpr uint32_t UNIFORM_MODEL = HashUniformName("model");
+    constexpr uint32_t UNIFORM_ENVIRONMENT_MAP = HashUniformName("environmentMap");
+    constexpr uint32_t UNIFORM_HAS_ENVIRONMENT_MAP = HashUniformName("hasEnvironmentMap");
+    constexpr uint32_t UNIFORM_BRDF_LUT = HashUniformName("brdfLUT");
+    constexpr uint32_t UNIFORM_SHADOW_CASCADES = HashUniformName("shadowCascades");
+    constexpr uint32_t UNIFORM_LOCAL_SHADOW_ATLAS = HashUniformName("localShadowAtlas");
+    
+    // Above the material units (0-3), so the cubemap and shadow maps stay bound for the whole mesh pass
+    const GLuint ENVIRONMENT_MAP_UNIT = 8;
+    const GLuint SHADOW_CASCADE_UNIT = 9;
+    const GLuint LOCAL_SHADOW_UNIT = 10;
+    const GLuint BRDF_LUT_UNIT = 11;
+    
+    const float SCENE_ASPECT = 1940.0f / 1080.0f;
+    
+    // Meshes per job when building a frame's model matrices
+    const size_t MODEL_GRAIN_SIZE = 64;
+    
+    // Screen-space error a mesh LOD may show before the next finer one is drawn
+    const float LOD_PIXEL_ERROR = 1.0f;
+}
+
+OpenGL::OpenGL() : deltaTime(0.0f), elapsedTime(0.0f), fixedTimestep(0.0f), environmentMap(0), frameCount(0), fps(0.0f)
 {
     QueryPerformanceFrequency(&frequency);
     QueryPerformanceCounter(&prevFrameTime);
@@ -17,6 +54,9 @@ OpenGL::OpenGL() : deltaTime(0.0f), frameCount(0), fps(0.0f)
 
 OpenGL::~OpenGL()
 {
+    Texture::SetAsyncLoader(nullptr);
+    textureLoader.Shutdown();
+    Profiler::Get().ReleaseGPU();
 }
 
 bool OpenGL::Init() {
@@ -25,8 +65,43 @@ bool OpenGL::Init() {
         return false;
     }
     
+    // Before any program is built, so every one can come from the binary cache
+    ProgramBinaryCache::Get().Initialize();
+    
+    if (!Profiler::Get().InitGPU()) {
+        std::cerr << "Profiler overlay disabled" << std::endl;
+    }
+    
     glEnable(GL_DEPTH_TEST);
     
+    if (!uniformBuffers.Init()) {
+        return false;
+    }
+    
+    if (textureLoader.Init()) {
+        Texture::SetAsyncLoader(&textureLoader);
+    }
+    
+    if (!sunShadows.Init()) {
+        std::cerr << "Sun shadows disabled" << std::endl;
+    }
+    
+    if (!localShadows.Init()) {
+        std::cerr << "Point and spot light shadows disabled" << std::endl;
+    }
+    
+    if (!clusteredLighting.Init(CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE)) {
+        std::cerr << "Clustered lighting disabled; point and spot lights will not be shaded" << std::endl;
+    }
+    
+    if (GPUCuller::IsSupported() && !gpuCuller.Init()) {
+        std::cerr << "GPU culling disabled; meshes are culled on the CPU" << std::endl;
+    }
+    
+    if (Shader::IsComputeSupported() && !imageBasedLighting.Init()) {
+        std::cerr << "Image-based lighting disabled" << std::endl;
+    }
+    
     typedef BOOL(WINAPI* PFNWGLSWAPINTERVALEXTPROC)(int);
     PFNWGLSWAPINTERVALEXTPROC wglSwapIntervalEXT = (PFNWGLSWAPINTERVALEXTPROC)wglGetProcAddress("wglSwapIntervalEXT");
     if (wglSwapIntervalEXT) wglSwapIntervalEXT(0);
@@ -39,8 +114,10 @@ bool OpenGL::Init() {
 
 void OpenGL::updateDeltaTime() {
     QueryPerformanceCounter(&currentFrameTime);
-    deltaTime = static_cast<float>(currentFrameTime.QuadPart - prevFrameTime.QuadPart) / frequency.QuadPart;
+    deltaTime = fixedTimestep > 0.0f ? fixedTimestep
+                                     : static_cast<float>(currentFrameTime.QuadPart - prevFrameTime.QuadPart) / frequency.QuadPart;
     prevFrameTime = currentFrameTime;
+    elapsedTime += deltaTime;
 }
 
 void OpenGL::updateFPS(HWND hWnd) {
@@ -51,19 +128,21 @@ void OpenGL::updateFPS(HWND hWnd) {
         frameCount = 0;
         lastFPSTime = now;
         
-        char fpsText[64];
-        sprintf_s(fpsText, "FPS: %.1f", fps);
+        char fpsText[96];
+        const Profiler& profiler = Profiler::Get();
+        sprintf_s(fpsText, "FPS: %.1f  CPU %.2f ms  GPU %.2f ms", fps, profiler.GetCPUFrameTime(), profiler.GetGPUFrameTime());
         SetWindowTextA(hWnd, fpsText);
     }
 }
 
+// Fallback path for programs that don't declare the shared uniform blocks
 void OpenGL::setLightUniforms(Material* material, Camera* camera, const std::vector<std::unique_ptr<Light>>& lights) {
-    GLint viewPosLoc = glGetUniformLocation(material->shader.shaderProgram, "viewPos");
+    GLint viewPosLoc = material->getShader().getUniformLocation(UNIFORM_VIEW_POS);
     if (viewPosLoc != -1) glUniform3fv(viewPosLoc, 1, glm::value_ptr(camera->getPosition()));
     
     // Check for simple shader lighting uniforms first
-    GLint lightPosLoc = glGetUniformLocation(material->shader.shaderProgram, "lightPos");
-    GLint lightColorLoc = glGetUniformLocation(material->shader.shaderProgram, "lightColor");
+    GLint lightPosLoc = material->getShader().getUniformLocation(UNIFORM_LIGHT_POS);
+    GLint lightColorLoc = material->getShader().getUniformLocation(UNIFORM_LIGHT_COLOR);
     
     if (lightPosLoc != -1 && lightColorLoc != -1 && !lights.empty()) {
         // Simple shader - use first enabled light
@@ -82,9 +161,9 @@ void OpenGL::setLightUniforms(Material* material, Camera* camera, const std::vec
     }
     
     // Set number of lights uniforms for PBR shaders
-    GLint numDirLightsLoc = glGetUniformLocation(material->shader.shaderProgram, "numDirLights");
-    GLint numPointLightsLoc = glGetUniformLocation(material->shader.shaderProgram, "numPointLights");
-    GLint numSpotLightsLoc = glGetUniformLocation(material->shader.shaderProgram, "numSpotLights");
+    GLint numDirLightsLoc = material->getShader().getUniformLocation(UNIFORM_NUM_DIR_LIGHTS);
+    GLint numPointLightsLoc = material->getShader().getUniformLocation(UNIFORM_NUM_POINT_LIGHTS);
+    GLint numSpotLightsLoc = material->getShader().getUniformLocation(UNIFORM_NUM_SPOT_LIGHTS);
     
     int dirLightCount = 0, pointLightCount = 0, spotLightCount = 0;
     
@@ -94,15 +173,15 @@ void OpenGL::setLightUniforms(Material* material, Camera* camera, const std::vec
         
         switch (light->getType()) {
             case LightType::DIRECTIONAL:
-                light->setUniforms(material->shader.shaderProgram, dirLightCount);
+                light->setUniforms(material->getShader(), dirLightCount);
                 dirLightCount++;
                 break;
             case LightType::POINT:
-                light->setUniforms(material->shader.shaderProgram, pointLightCount);
+                light->setUniforms(material->getShader(), pointLightCount);
                 pointLightCount++;
                 break;
             case LightType::SPOT:
-                light->setUniforms(material->shader.shaderProgram, spotLightCount);
+                light->setUniforms(material->getShader(), spotLightCount);
                 spotLightCount++;
                 break;
         }
@@ -114,23 +193,232 @@ void OpenGL::setLightUniforms(Material* material, Camera* camera, const std::vec
     if (numSpotLightsLoc != -1) glUniform1i(numSpotLightsLoc, spotLightCount);
 }
 
-void OpenGL::Render(Camera* camera, const std::vector<std::unique_ptr<Mesh>>& meshes, 
+void OpenGL::PrepareFrame(FrameSnapshot& frame, const std::vector<std::unique_ptr<Mesh>>& meshes) const {
+    PROFILE_SCOPE("Prepare frame");
+    
+    frame.meshModels.resize(meshes.size());
+    JobSystem::Get().ParallelFor(meshes.size(), MODEL_GRAIN_SIZE, [&frame, &meshes](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            frame.meshModels[i] = meshes[i]->getModelMatrix();
+        }
+    });
+    
+    // Plain meshes are left to the GPU culler when it runs
+    frame.culler.Clear();
+    if (gpuCuller.IsInitialized()) return;
+    
+    // Gather world-space bounds for every submesh and cull them in one batch
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const Mesh& mesh = *meshes[i];
+        if (!mesh.isValid() || mesh.isInstanced()) continue;
+        
+        const glm::mat4& model = frame.meshModels[i];
+        for (const SubMesh& subMesh : mesh.getSubMeshes()) {
+            frame.culler.Add(subMesh.sphere.transformed(model), subMesh.bounds.transformed(model));
+        }
+    }
+    Frustum frustum(frame.camera.getProjectionMatrix(SCENE_ASPECT) * frame.camera.getViewMatrix());
+    frame.culler.Cull(frustum);
+}
+
+void OpenGL::buildRenderQueue(const std::vector<std::unique_ptr<Mesh>>& meshes, const FrameSnapshot& frame,
+                              const Frustum& frustum, float lodScale) {
+    renderQueue.Clear();
+    
+    // Plain meshes were culled by the frame's simulation job, unless the GPU culler draws them
+    bool gpuDriven = gpuCuller.IsInitialized();
+    glm::vec3 cameraPosition = frame.camera.getPosition();
+    
+    uint32_t cullIndex = 0;
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex) {
+        const auto& mesh = meshes[meshIndex];
+        if (!mesh->isValid()) continue;
+        
+        const glm::mat4& model = frame.meshModels[meshIndex];
+        
+        // Instanced meshes are culled per instance and drawn as one batch per submesh, at full
+        // detail since the instances spread over any distance
+        if (mesh->isInstanced()) {
+            GLsizei instanceCount = mesh->getInstanceBuffer()->UploadVisible(model, frustum);
+            if (instanceCount == 0) continue;
+            
+            uint32_t transformIndex = renderQueue.AddTransform(model);
+            for (const SubMesh& subMesh : mesh->getSubMeshes()) {
+                Material* material = mesh->getMaterial(subMesh.materialIndex);
+                if (!material || !material->getShader().shaderProgram) continue;
+                
+                renderQueue.Submit(RenderPass::OPAQUE_PASS, mesh.get(), &subMesh, material, transformIndex, 0.0f, instanceCount);
+            }
+            continue;
+        }
+        if (gpuDriven) continue;
+        
+        uint32_t transformIndex = 0xFFFFFFFFu;
+        
+        for (const SubMesh& subMesh : mesh->getSubMeshes()) {
+            if (!frame.culler.IsVisible(cullIndex++)) continue;
+            
+            Material* material = mesh->getMaterial(subMesh.materialIndex);
+            if (!material || !material->getShader().shaderProgram) continue;
+            
+            if (transformIndex == 0xFFFFFFFFu) {
+                transformIndex = renderQueue.AddTransform(model);
+            }
+            
+            glm::vec3 worldCenter = glm::vec3(model * glm::vec4(subMesh.sphere.center, 1.0f));
+            float viewDepth = glm::length(worldCenter - cameraPosition);
+            
+            // Same selection as GPU culling, so toggling it does not change any LOD
+            unsigned int lod = subMesh.selectLod(model, cameraPosition, lodScale);
+            renderQueue.Submit(RenderPass::OPAQUE_PASS, mesh.get(), &subMesh, material, transformIndex, viewDepth, 1, lod);
+        }
+    }
+    
+    renderQueue.Sort();
+}
+
+void OpenGL::submitRenderQueue(Camera* camera, const glm::mat4& view, const glm::mat4& projection,
+                               const std::vector<std::unique_ptr<Light>>& lights) {
+    // Bound outside the cache, before it is reset; the cache only tracks 2D bindings
+    glActiveTexture(GL_TEXTURE0 + ENVIRONMENT_MAP_UNIT);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, environmentMap);
+    glActiveTexture(GL_TEXTURE0 + BRDF_LUT_UNIT);
+    glBindTexture(GL_TEXTURE_2D, environmentMap ? imageBasedLighting.getBRDFLUT() : 0);
+    sunShadows.BindForReading(GL_TEXTURE0 + SHADOW_CASCADE_UNIT);
+    localShadows.BindForReading(GL_TEXTURE0 + LOCAL_SHADOW_UNIT);
+    
+    // Other systems bind GL state directly between frames, so start from a clean slate
+    stateCache.Invalidate();
+    
+    const Material* boundMaterial = nullptr;
+    const Mesh* boundMesh = nullptr;
+    uint32_t boundTransform = 0xFFFFFFFFu;
+    
+    for (const RenderItem& item : renderQueue.GetItems()) {
+        Material* material = item.material;
+        const Shader& shader = material->getShader();
+        
+        // Uniforms live in the program object, so per-program state is only resent when the program changes
+        if (stateCache.UseProgram(shader.shaderProgram)) {
+            bindProgramState(shader, material, camera, view, projection, lights);
+            boundMaterial = nullptr;
+            boundMesh = nullptr;
+            boundTransform = 0xFFFFFFFFu;
+        }
+        
+        if (material != boundMaterial) {
+            // Use advanced material uniforms if available, otherwise fall back to basic
+            material->setUniformsAdvanced(shader);
+            material->bindTextures(stateCache);
+            boundMaterial = material;
+        }
+        
+        if (item.transformIndex != boundTransform) {
+            GLint modelLoc = shader.getUniformLocation(UNIFORM_MODEL);
+            if (modelLoc != -1) {
+                glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(renderQueue.GetTransform(item.transformIndex)));
+            }
+            boundTransform = item.transformIndex;
+        }
+        
+        if (item.mesh != boundMesh) {
+            item.mesh->bindVertexDecode(shader);
+            boundMesh = item.mesh;
+        }
+        
+        stateCache.BindVertexArray(item.mesh->getVAO());
+        item.mesh->drawSubMesh(*item.subMesh, item.instanceCount, item.lod);
+    }
+    
+    stateCache.BindVertexArray(0);
+}
+
+void OpenGL::submitGPUDraws(Camera* camera, const glm::mat4& view, const glm::mat4& projection,
+                            const std::vector<std::unique_ptr<Light>>& lights) {
+    const std::vector<GPUCuller::DrawGroup>& groups = gpuCuller.getGroups();
+    if (groups.empty()) return;
+    
+    // Runs after submitRenderQueue, so the cache and the shadow and environment units are current
+    gpuCuller.BindDrawBuffers();
+    const Material* boundMaterial = nullptr;
+    
+    for (size_t i = 0; i < groups.size(); ++i) {
+        Material* material = groups[i].material;
+        const Shader& shader = material->getShader();
+        
+        if (stateCache.UseProgram(shader.shaderProgram)) {
+            bindProgramState(shader, material, camera, view, projection, lights);
+            boundMaterial = nullptr;
+        }
+        if (material != boundMaterial) {
+            material->setUniformsAdvanced(shader);
+            material->bindTextures(stateCache);
+            boundMaterial = material;
+        }
+        
+        GLint modelLoc = shader.getUniformLocation(UNIFORM_MODEL);
+        if (modelLoc != -1) {
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(gpuCuller.getGroupModel(i)));
+        }
+        groups[i].mesh->bindVertexDecode(shader);
+        
+        stateCache.BindVertexArray(groups[i].mesh->getVAO());
+        gpuCuller.Draw(i);
+    }
+    
+    stateCache.BindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void OpenGL::bindProgramState(const Shader& shader, Material* material, Camera* camera, const glm::mat4& view,
+                              const glm::mat4& projection, const std::vector<std::unique_ptr<Light>>& lights) {
+    if (!shader.usesFrameData()) {
+        GLint viewLoc = shader.getUniformLocation(UNIFORM_VIEW);
+        GLint projLoc = shader.getUniformLocation(UNIFORM_PROJECTION);
+        if (viewLoc != -1) glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+        if (projLoc != -1) glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    }
+    if (!shader.usesLightData()) {
+        setLightUniforms(material, camera, lights);
+    }
+    GLint environmentLoc = shader.getUniformLocation(UNIFORM_ENVIRONMENT_MAP);
+    if (environmentLoc != -1) {
+        glUniform1i(environmentLoc, ENVIRONMENT_MAP_UNIT);
+        glUniform1i(shader.getUniformLocation(UNIFORM_HAS_ENVIRONMENT_MAP), environmentMap != 0);
+        glUniform1i(shader.getUniformLocation(UNIFORM_BRDF_LUT), BRDF_LUT_UNIT);
+    }
+    GLint shadowCascadesLoc = shader.getUniformLocation(UNIFORM_SHADOW_CASCADES);
+    if (shadowCascadesLoc != -1) {
+        glUniform1i(shadowCascadesLoc, SHADOW_CASCADE_UNIT);
+    }
+    GLint localShadowLoc = shader.getUniformLocation(UNIFORM_LOCAL_SHADOW_ATLAS);
+    if (localShadowLoc != -1) {
+        glUniform1i(localShadowLoc, LOCAL_SHADOW_UNIT);
+    }
+}
+
+void OpenGL::Render(FrameSnapshot& frame, const std::vector<std::unique_ptr<Mesh>>& meshes, 
                     const std::vector<std::unique_ptr<Light>>& lights, 
                     Ocean* ocean, CloudSystem* cloudSystem,
                     OceanCG* oceanCG, CloudsCG* cloudsCG, OceanFFT* oceanFFT) {
-    if (!camera) return;
-    
     updateDeltaTime();
     updateFPS(hWndGlobal);
     
-    camera->processKeyboard(deltaTime);
-    camera->processMouseMovement(hWndGlobal);
+    Profiler& profiler = Profiler::Get();
+    
+    // The snapshot's copy; the live camera already belongs to the next frame's simulation
+    Camera* camera = &frame.camera;
     
     glClearColor(0.6f, 0.8f, 1.0f, 1.0f); // Bright daytime sky blue
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
+    // Swap in any textures that finished decoding; this touches texture bindings, so it runs before the mesh pass
+    profiler.BeginPass("Texture uploads");
+    textureLoader.ProcessUploads();
+    profiler.EndPass();
+    
     glm::mat4 view = camera->getViewMatrix();
-    glm::mat4 projection = camera->getProjectionMatrix(1940.0f / 1080.0f);
+    glm::mat4 projection = camera->getProjectionMatrix(SCENE_ASPECT);
     
     // Extract lighting information for environmental systems
     glm::vec3 lightDir = glm::vec3(0.0f, -1.0f, 0.0f);  // Default downward light
@@ -138,70 +426,155 @@ void OpenGL::Render(Camera* camera, const std::vector<std::unique_ptr<Mesh>>& me
     glm::vec3 skyColor = glm::vec3(0.6f, 0.8f, 1.0f);   // Sky blue
     
     // Get actual light information from the first directional light
+    bool hasSun = false;
     for (const auto& light : lights) {
         if (light->enabled && light->getType() == LightType::DIRECTIONAL) {
             lightDir = dynamic_cast<DirectionalLight*>(light.get())->getDirection();
             lightColor = light->color * light->intensity;
+            hasSun = true;
             break;
         }
     }
     
+    // Refit the sun's cascades to this camera; only the ones whose contents changed are redrawn
+    profiler.BeginPass("Shadows");
+    ShadowDataBlock shadowData = {};
+    if (hasSun && sunShadows.IsInitialized()) {
+        sunShadows.Update(*camera, SCENE_ASPECT, lightDir, meshes);
+        shadowData = sunShadows.getShadowData();
+    }
+    
+    // Local light faces are redrawn only when their light or a caster in range moved, and
+    // only once the camera can see them
+    Frustum frustum(projection * view);
+    localShadows.Update(frustum, lights, meshes);
+    localShadows.writeShadowData(shadowData);
+    profiler.EndPass();
+    
+    // Camera and light state goes to the GPU once; every program reads it from the shared blocks
+    profiler.BeginCPU("Frame data");
+    FrameDataBlock frameData;
+    frameData.view = view;
+    frameData.projection = projection;
+    frameData.cameraPosition = camera->getPosition();
+    frameData.frameTime = elapsedTime;
+    frameData.sunDirection = lightDir;
+    frameData.padding0 = 0.0f;
+    frameData.sunColor = lightColor;
+    frameData.clusterDepthScale = clusteredLighting.getDepthScale();
+    frameData.clusterDepthBias = clusteredLighting.getDepthBias();
+    frameData.padding1[0] = frameData.padding1[1] = frameData.padding1[2] = 0.0f;
+    uniformBuffers.UpdateFrameData(frameData);
+    uniformBuffers.UpdateLightData(lights, &localShadows);
+    uniformBuffers.UpdateShadowData(shadowData);
+    profiler.EndCPU();
+    
+    // Bins the point and spot lights into view clusters; reads the camera from FrameData
+    profiler.BeginPass("Light culling");
+    clusteredLighting.Update(lights, &localShadows);
+    profiler.EndPass();
+    
+    // The cached sky is baked into the ambient lighting, a step per frame while it changes; it
+    // was last refreshed by the previous frame's skybox pass
+    profiler.BeginPass("IBL bake");
+    if (cloudsCG && cloudsCG->IsInitialized() && cloudsCG->GetEnvironmentMap()) {
+        imageBasedLighting.Update(cloudsCG->GetEnvironmentMap(), cloudsCG->GetEnvironmentVersion(), cloudsCG->GetSkyKey());
+    }
+    environmentMap = imageBasedLighting.IsReady() ? imageBasedLighting.getPrefilteredMap() : 0;
+    profiler.EndPass();
+    
+    // Plain meshes are culled on the GPU against the frustum and last frame's depth
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    
+    // Pixels a model-space unit covers at distance one, over the error allowed; picks mesh LODs
+    float lodScale = viewport[3] / (2.0f * std::tan(glm::radians(camera->getZoom()) * 0.5f)) / LOD_PIXEL_ERROR;
+    if (gpuCuller.IsInitialized()) {
+        profiler.BeginPass("GPU culling");
+        gpuCuller.Update(meshes);
+        gpuCuller.Cull(projection * view, camera->getPosition(), lodScale);
+        profiler.EndPass();
+    }
+    
     // Render regular meshes first (opaque objects)
-    for (const auto& mesh : meshes) {
-        if (mesh->isValid() && mesh->getMaterial()) {
-            Material* material = mesh->getMaterial();
-            
-            glUseProgram(material->shader.shaderProgram);
-            
-            GLint viewLoc = glGetUniformLocation(material->shader.shaderProgram, "view");
-            GLint projLoc = glGetUniformLocation(material->shader.shaderProgram, "projection");
-            GLint modelLoc = glGetUniformLocation(material->shader.shaderProgram, "model");
-            
-            if (viewLoc != -1) glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-            if (projLoc != -1) glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-            
-            // Use advanced material uniforms if available, otherwise fall back to basic
-            material->setUniformsAdvanced(material->shader.shaderProgram);
-            material->bindTextures();
-            setLightUniforms(material, camera, lights);
-            
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, mesh->position);
-            model = glm::rotate(model, glm::radians(mesh->rotation.x), glm::vec3(1, 0, 0));
-            model = glm::rotate(model, glm::radians(mesh->rotation.y), glm::vec3(0, 1, 0));
-            model = glm::rotate(model, glm::radians(mesh->rotation.z), glm::vec3(0, 0, 1));
-            model = glm::scale(model, mesh->scale);
-            
-            if (modelLoc != -1) glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-            
-            mesh->render();
-        }
+    profiler.BeginPass("Opaque");
+    buildRenderQueue(meshes, frame, frustum, lodScale);
+    submitRenderQueue(camera, view, projection, lights);
+    submitGPUDraws(camera, view, projection, lights);
+    profiler.EndPass();
+    
+    // Opaque depth is complete; it becomes next frame's occluders
+    if (gpuCuller.IsInitialized()) {
+        profiler.BeginPass("Hi-Z");
+        gpuCuller.BuildHiZ(viewport[2], viewport[3], projection * view);
+        profiler.EndPass();
     }
     
     // Render transparent ocean after all opaque objects (proper transparency order)
+    profiler.BeginPass("Ocean");
     if (ocean && ocean->IsInitialized()) {
         ocean->Render(view, projection, camera->getPosition(), lightDir, lightColor, skyColor);
     }
     
     // Render book-based ocean (transparent)
     if (oceanCG && oceanCG->IsInitialized()) {
-        oceanCG->Render(view, projection);
+        oceanCG->Render(view, projection, camera->getPosition());
     }
     
     // Render FFT-based ocean (transparent, most advanced)
     if (oceanFFT && oceanFFT->IsInitialized()) {
-        oceanFFT->Render(view, projection, camera->getPosition(), lightDir, lightColor, skyColor);
+        oceanFFT->Render(view, projection, camera->getPosition(), skyColor);
     }
+    profiler.EndPass();
     
     // Render volumetric clouds last (skybox, rendered after transparent objects)
+    profiler.BeginPass("Clouds");
     if (cloudSystem && cloudSystem->IsInitialized()) {
         cloudSystem->Render(view, projection, camera->getPosition(), lightDir, lightColor, skyColor);
     }
     
     // Render book-based clouds (skybox)
     if (cloudsCG && cloudsCG->IsInitialized()) {
-        cloudsCG->RenderSkybox(view, projection);
+        cloudsCG->RenderSkybox();
+    }
+    profiler.EndPass();
+    
+    // The overlay binds outside the cache
+    if (profiler.IsOverlayVisible()) {
+        profiler.DrawOverlay(viewport[2], viewport[3]);
+        stateCache.Invalidate();
     }
     
+    profiler.BeginCPU("Present");
+    SwapBuffers(hDCGlobal);
+    profiler.EndCPU();
+}
+
+void OpenGL::RenderProgressive(ProgressiveRenderer& renderer, float exposure) {
+    updateDeltaTime();
+    updateFPS(hWndGlobal);
+    
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    
+    if (!progressiveDisplay.IsInitialized() && !progressiveDisplay.Init(renderer.GetWidth(), renderer.GetHeight())) {
+        SwapBuffers(hDCGlobal);
+        return;
+    }
+    Profiler& profiler = Profiler::Get();
+    profiler.BeginPass("Progressive display");
+    progressiveDisplay.Update(renderer);
+    progressiveDisplay.Draw(exposure);
+    profiler.EndPass();
+    
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    profiler.DrawOverlay(viewport[2], viewport[3]);
+    
+    // The display and the overlay bind outside the cache
+    stateCache.Invalidate();
+    
+    profiler.BeginCPU("Present");
     SwapBuffers(hDCGlobal);
+    profiler.EndCPU();
 }
\ No newline at end of file
@@ -13,6 +13,17 @@
 #include "OceanCG.hpp"
 #include "CloudsCG.hpp"
 #include "OceanFFT.hpp"
+#include "UniformBuffers.hpp"
+#include "RenderQueue.hpp"
+#include "GLStateCache.hpp"
+#include "Frustum.hpp"
+#include "TextureLoader.hpp"
+#include "ProgressiveDisplay.hpp"
+#include "Shadow.hpp"
+#include "ClusteredLighting.hpp"
+#include "GPUCulling.hpp"
+#include "ImageBasedLighting.hpp"
+#include "FramePipeline.hpp"
 #include <windows.h>
 #include <glm/glm.hpp>
 
@@ -20,6 +31,40 @@ class OpenGL {
 private:
     LARGE_INTEGER frequency, prevFrameTime, currentFrameTime;
     float deltaTime;
+    float elapsedTime;
+    float fixedTimestep;    // Replaces the measured delta when above zero
+    
+    // Shared FrameData/LightData blocks, written once per frame
+    UniformBuffers uniformBuffers;
+    
+    // Mesh draws are collected, sorted by state and submitted through the cache
+    RenderQueue renderQueue;
+    GLStateCache stateCache;
+    
+    // Culls and draws plain meshes on the GPU when supported; the render queue then only
+    // carries instanced meshes
+    GPUCuller gpuCuller;
+    
+    // Material textures decode off-thread and are swapped in at the start of a frame
+    TextureLoader textureLoader;
+    
+    // Irradiance SH, prefiltered specular and BRDF LUT baked from the CloudsCG sky cache
+    ImageBasedLighting imageBasedLighting;
+    
+    // Prefiltered sky for the environmentMap sampler, 0 until the first bake
+    GLuint environmentMap;
+    
+    // Shadow cascades for the first directional light
+    CascadedShadowMap sunShadows;
+    
+    // Shadow faces for point and spot lights, cached between frames
+    ShadowAtlas localShadows;
+    
+    // Per-cluster point and spot light lists for the lit shaders
+    ClusteredLighting clusteredLighting;
+    
+    // Live view of a progressive path trace; replaces the raster frame while one is shown
+    ProgressiveDisplay progressiveDisplay;
     
     DWORD lastFPSTime;
     int frameCount;
@@ -28,18 +73,43 @@ private:
     void updateDeltaTime();
     void updateFPS(HWND hWnd);
     void setLightUniforms(Material* material, Camera* camera, const std::vector<std::unique_ptr<Light>>& lights);
+    void buildRenderQueue(const std::vector<std::unique_ptr<Mesh>>& meshes, const FrameSnapshot& frame,
+                          const Frustum& frustum, float lodScale);
+    void submitRenderQueue(Camera* camera, const glm::mat4& view, const glm::mat4& projection,
+                           const std::vector<std::unique_ptr<Light>>& lights);
+    void submitGPUDraws(Camera* camera, const glm::mat4& view, const glm::mat4& projection,
+                        const std::vector<std::unique_ptr<Light>>& lights);
+    // Per-program state for the mesh pass, sent when the program changes
+    void bindProgramState(const Shader& shader, Material* material, Camera* camera, const glm::mat4& view,
+                          const glm::mat4& projection, const std::vector<std::unique_ptr<Light>>& lights);
 
 public:
     OpenGL();
     ~OpenGL();
     
     bool Init();
-    void Render(Camera* camera, const std::vector<std::unique_ptr<Mesh>>& meshes, 
+    
+    // The CPU side of a frame, run by its simulation job while the previous frame renders:
+    // model matrices and frustum culling against frame.camera. Touches no GL state.
+    void PrepareFrame(FrameSnapshot& frame, const std::vector<std::unique_ptr<Mesh>>& meshes) const;
+    
+    // Draws from the snapshot; meshes and lights are only read
+    void Render(FrameSnapshot& frame, const std::vector<std::unique_ptr<Mesh>>& meshes, 
                 const std::vector<std::unique_ptr<Light>>& lights, 
                 Ocean* ocean = nullptr, CloudSystem* cloudSystem = nullptr,
                 OceanCG* oceanCG = nullptr, CloudsCG* cloudsCG = nullptr,
                 OceanFFT* oceanFFT = nullptr);
     
+    // Presents the renderer's current accumulation instead of the scene; the camera stays put
+    void RenderProgressive(ProgressiveRenderer& renderer, float exposure = 1.0f);
+    
     // Getter for delta time
     float getDeltaTime() const { return deltaTime; }
+    float getElapsedTime() const { return elapsedTime; }
+    
+    // Benchmark runs step time by a fixed amount
+    void SetFixedTimestep(float seconds) { fixedTimestep = seconds; }
+    
+    // True while material textures are still decoding or waiting to upload
+    bool IsStreaming() const { return textureLoader.GetPendingCount() > 0; }
 };
\ No newline at end of file
@@ -0,0 +1,288 @@
+#include "PhotonMap.hpp"
+#include <cmath>
+#include <future>
+#include <limits>
+#include <thread>
+
+namespace {
+    const uint32_t POSITION_BITS = 21;
+    const uint32_t POSITION_MAX = (1u << POSITION_BITS) - 1;
+
+    // RGB9E5 (EXT_texture_shared_exponent): 9-bit mantissas sharing a 5-bit exponent
+    const int RGB9E5_MANTISSA_BITS = 9;
+    const int RGB9E5_EXPONENT_BIAS = 15;
+    const int RGB9E5_MAX_EXPONENT = 31;
+    const float RGB9E5_MAX = 65408.0f;
+
+    uint32_t EncodeRGB9E5(const glm::vec3& rgb)
+    {
+        glm::vec3 c = glm::clamp(rgb, glm::vec3(0.0f), glm::vec3(RGB9E5_MAX));
+        float maxComponent = (std::max)(c.r, (std::max)(c.g, c.b));
+        if (!(maxComponent > 0.0f)) {
+            return 0;
+        }
+
+        int exponent;
+        std::frexp(maxComponent, &exponent);    // maxComponent = f * 2^exponent, f in [0.5, 1)
+        int shared = (std::max)(0, exponent + RGB9E5_EXPONENT_BIAS);
+        float denominator = std::ldexp(1.0f, shared - RGB9E5_EXPONENT_BIAS - RGB9E5_MANTISSA_BITS);
+        if (std::floor(maxComponent / denominator + 0.5f) >= (1 << RGB9E5_MANTISSA_BITS)) {
+            denominator *= 2.0f;
+            ++shared;
+        }
+        shared = (std::min)(shared, RGB9E5_MAX_EXPONENT);
+
+        uint32_t r = static_cast<uint32_t>(std::floor(c.r / denominator + 0.5f));
+        uint32_t g = static_cast<uint32_t>(std::floor(c.g / denominator + 0.5f));
+        uint32_t b = static_cast<uint32_t>(std::floor(c.b / denominator + 0.5f));
+        const uint32_t mantissaMax = (1u << RGB9E5_MANTISSA_BITS) - 1;
+        return (std::min)(r, mantissaMax) | ((std::min)(g, mantissaMax) << 9) | ((std::min)(b, mantissaMax) << 18) |
+               (static_cast<uint32_t>(shared) << 27);
+    }
+
+    glm::vec3 DecodeRGB9E5(uint32_t packed)
+    {
+        int shared = static_cast<int>(packed >> 27);
+        float scale = std::ldexp(1.0f, shared - RGB9E5_EXPONENT_BIAS - RGB9E5_MANTISSA_BITS);
+        return glm::vec3(static_cast<float>(packed & 0x1FF), static_cast<float>((packed >> 9) & 0x1FF),
+                         static_cast<float>((packed >> 18) & 0x1FF)) * scale;
+    }
+
+    float SignNotZero(float v)
+    {
+        return v < 0.0f ? -1.0f : 1.0f;
+    }
+
+    // Octahedral mapping (Cigolle et al. 2014), 8 bits per axis
+    uint16_t EncodeDirection(const glm::vec3& d)
+    {
+        float l1 = std::abs(d.x) + std::abs(d.y) + std::abs(d.z);
+        if (l1 <= 0.0f) {
+            return 0;
+        }
+        glm::vec2 v(d.x / l1, d.y / l1);
+        if (d.z < 0.0f) {
+            v = glm::vec2((1.0f - std::abs(v.y)) * SignNotZero(v.x), (1.0f - std::abs(v.x)) * SignNotZero(v.y));
+        }
+        uint32_t x = static_cast<uint32_t>(glm::clamp(std::floor((v.x * 0.5f + 0.5f) * 255.0f + 0.5f), 0.0f, 255.0f));
+        uint32_t y = static_cast<uint32_t>(glm::clamp(std::floor((v.y * 0.5f + 0.5f) * 255.0f + 0.5f), 0.0f, 255.0f));
+        return static_cast<uint16_t>(x | (y << 8));
+    }
+
+    glm::vec3 DecodeDirection(uint16_t packed)
+    {
+        glm::vec2 v(static_cast<float>(packed & 0xFF) / 255.0f * 2.0f - 1.0f,
+                    static_cast<float>(packed >> 8) / 255.0f * 2.0f - 1.0f);
+        glm::vec3 d(v.x, v.y, 1.0f - std::abs(v.x) - std::abs(v.y));
+        if (d.z < 0.0f) {
+            d.x = (1.0f - std::abs(v.y)) * SignNotZero(v.x);
+            d.y = (1.0f - std::abs(v.x)) * SignNotZero(v.y);
+        }
+        return glm::normalize(d);
+    }
+
+    // Photons in the left subtree of a complete, left-filled tree of count nodes
+    size_t LeftSubtreeSize(size_t count)
+    {
+        if (count <= 1) {
+            return 0;
+        }
+        size_t lastLevel = 1;
+        while (2 * lastLevel <= count) {
+            lastLevel *= 2;
+        }
+        size_t half = lastLevel / 2;
+        return (half - 1) + (std::min)(count - (lastLevel - 1), half);
+    }
+}
+
+PhotonMap::PhotonMap()
+    : boundsMin(0.0f), cellSize(1.0f), inverseCellSize(1.0f), powerUnit(1.0f)
+{
+}
+
+void PhotonMap::Clear()
+{
+    nodes.clear();
+    nodes.shrink_to_fit();
+}
+
+void PhotonMap::Build(std::vector<Photon>& photons, float powerScale, size_t parallelThreshold)
+{
+    Clear();
+    if (photons.empty()) {
+        return;
+    }
+
+    glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    double powerSum = 0.0;
+    for (Photon& photon : photons) {
+        photon.power *= powerScale;
+        boundsMin = glm::min(boundsMin, photon.p);
+        boundsMax = glm::max(boundsMax, photon.p);
+        powerSum += (std::max)(photon.power.r, (std::max)(photon.power.g, photon.power.b));
+    }
+
+    glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+    cellSize = extent / static_cast<float>(POSITION_MAX);
+    inverseCellSize = 1.0f / cellSize;
+
+    // Encoded relative to the mean photon, which keeps RGB9E5 near 1 where its precision is
+    float meanPower = static_cast<float>(powerSum / photons.size());
+    powerUnit = meanPower > 0.0f ? meanPower : 1.0f;
+
+    nodes.resize(photons.size());
+
+    // Enough parallel subtrees to keep every core busy, none smaller than the threshold
+    unsigned threads = (std::max)(1u, std::thread::hardware_concurrency());
+    int parallelDepth = 0;
+    while ((size_t(1) << parallelDepth) < 2 * threads && (photons.size() >> parallelDepth) > parallelThreshold) {
+        ++parallelDepth;
+    }
+
+    Balance(photons, 0, photons.size(), 0, parallelDepth);
+}
+
+void PhotonMap::Balance(std::vector<Photon>& photons, size_t begin, size_t end, size_t node, int parallelDepth)
+{
+    size_t count = end - begin;
+    if (count == 0) {
+        return;
+    }
+
+    // Split across the widest extent of this subtree's photons
+    glm::vec3 lo(std::numeric_limits<float>::max());
+    glm::vec3 hi(-std::numeric_limits<float>::max());
+    for (size_t i = begin; i < end; ++i) {
+        lo = glm::min(lo, photons[i].p);
+        hi = glm::max(hi, photons[i].p);
+    }
+    glm::vec3 extent = hi - lo;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    // The median that leaves the tree complete, so it fits the implicit layout
+    size_t median = begin + LeftSubtreeSize(count);
+    std::nth_element(photons.begin() + begin, photons.begin() + median, photons.begin() + end,
+                     [axis](const Photon& a, const Photon& b) { return a.p[axis] < b.p[axis]; });
+    nodes[node] = Encode(photons[median], axis);
+
+    if (parallelDepth > 0) {
+        std::future<void> left = std::async(std::launch::async, &PhotonMap::Balance, this, std::ref(photons),
+                                            begin, median, 2 * node + 1, parallelDepth - 1);
+        Balance(photons, median + 1, end, 2 * node + 2, parallelDepth - 1);
+        left.get();
+    } else {
+        Balance(photons, begin, median, 2 * node + 1, 0);
+        Balance(photons, median + 1, end, 2 * node + 2, 0);
+    }
+}
+
+PhotonMap::CompactPhoton PhotonMap::Encode(const Photon& photon, int axis) const
+{
+    // Rounding is monotonic, so the tree's ordering survives quantisation
+    glm::vec3 q = glm::clamp(glm::floor((photon.p - boundsMin) * inverseCellSize + 0.5f),
+                             glm::vec3(0.0f), glm::vec3(static_cast<float>(POSITION_MAX)));
+
+    CompactPhoton compact;
+    compact.position = static_cast<uint64_t>(q.x) | (static_cast<uint64_t>(q.y) << POSITION_BITS) |
+                       (static_cast<uint64_t>(q.z) << (2 * POSITION_BITS));
+    compact.power = EncodeRGB9E5(photon.power / powerUnit);
+    compact.direction = EncodeDirection(photon.wi);
+    compact.axis = static_cast<uint8_t>(axis);
+    compact.padding = 0;
+    return compact;
+}
+
+glm::vec3 PhotonMap::DecodePosition(uint64_t position) const
+{
+    glm::vec3 q(static_cast<float>(position & POSITION_MAX),
+                static_cast<float>((position >> POSITION_BITS) & POSITION_MAX),
+                static_cast<float>((position >> (2 * POSITION_BITS)) & POSITION_MAX));
+    return boundsMin + q * cellSize;
+}
+
+glm::vec3 PhotonMap::Position(uint32_t index) const
+{
+    return DecodePosition(nodes[index].position);
+}
+
+glm::vec3 PhotonMap::Direction(uint32_t index) const
+{
+    return DecodeDirection(nodes[index].direction);
+}
+
+glm::vec3 PhotonMap::Power(uint32_t index) const
+{
+    return DecodeRGB9E5(nodes[index].power) * powerUnit;
+}
+
+void PhotonMap::FindNearest(const glm::vec3& p, float maxDistance2, int k, std::vector<Neighbour>& heap) const
+{
+    heap.clear();
+    if (nodes.empty() || k <= 0) {
+        return;
+    }
+
+    // Far children wait here with their squared distance to the split plane; the tree is
+    // complete, so its depth is at most 32 for any index a uint32_t can address
+    struct StackEntry {
+        uint32_t node;
+        float planeDistance2;
+    };
+    StackEntry stack[64];
+    int stackSize = 0;
+
+    const uint32_t count = static_cast<uint32_t>(nodes.size());
+    float radius2 = maxDistance2;
+    uint32_t node = 0;
+
+    for (;;) {
+        const CompactPhoton& photon = nodes[node];
+        glm::vec3 position = DecodePosition(photon.position);
+        glm::vec3 offset = position - p;
+        float distance2 = glm::dot(offset, offset);
+
+        if (distance2 < radius2) {
+            Neighbour neighbour = { node, distance2 };
+            if (static_cast<int>(heap.size()) < k) {
+                heap.push_back(neighbour);
+                std::push_heap(heap.begin(), heap.end());
+            } else {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = neighbour;
+                std::push_heap(heap.begin(), heap.end());
+            }
+            if (static_cast<int>(heap.size()) == k) {
+                radius2 = heap.front().distance2;
+            }
+        }
+
+        uint32_t left = 2 * node + 1;
+        if (left < count) {
+            float delta = p[photon.axis] - position[photon.axis];
+            uint32_t nearChild = delta < 0.0f ? left : left + 1;
+            uint32_t farChild = delta < 0.0f ? left + 1 : left;
+            if (farChild < count && delta * delta < radius2) {
+                StackEntry entry = { farChild, delta * delta };
+                stack[stackSize++] = entry;
+            }
+            if (nearChild < count) {
+                node = nearChild;
+                continue;
+            }
+        }
+
+        // Pop the next far child that the shrinking radius has not ruled out
+        for (;;) {
+            if (stackSize == 0) {
+                return;
+            }
+            StackEntry entry = stack[--stackSize];
+            if (entry.planeDistance2 < radius2) {
+                node = entry.node;
+                break;
+            }
+        }
+    }
+}
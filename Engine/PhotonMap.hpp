@@ -0,0 +1,105 @@
+#pragma once
+#include "Spectrum.hpp"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Photon storage for PhotonMappingIntegrator: a left-balanced k-d tree kept implicitly in one
+// array (node i has children 2i + 1 and 2i + 2, so there are no pointers), searched for the k
+// nearest photons with a bounded max-heap. Photons are packed to 16 bytes.
+class PhotonMap {
+public:
+    // A photon as traced; only lives until Build packs it
+    struct Photon {
+        glm::vec3 p;
+        glm::vec3 wi;       // Towards where the photon came from
+        glm::vec3 power;    // Linear RGB flux
+    };
+
+    struct Neighbour {
+        uint32_t index;
+        float distance2;
+        bool operator<(const Neighbour& other) const { return distance2 < other.distance2; }
+    };
+
+    PhotonMap();
+
+    // Balances the photons into the tree, scaling their power by powerScale (1 / photons
+    // emitted). Subtrees above parallelThreshold photons are built on their own threads.
+    void Build(std::vector<Photon>& photons, float powerScale, size_t parallelThreshold = 65536);
+    void Clear();
+
+    size_t Size() const { return nodes.size(); }
+    bool Empty() const { return nodes.empty(); }
+
+    // Up to k photons within sqrt(maxDistance2) of p, as a heap with the farthest at the front
+    void FindNearest(const glm::vec3& p, float maxDistance2, int k, std::vector<Neighbour>& heap) const;
+
+    // Decoded photon at a tree index
+    glm::vec3 Position(uint32_t index) const;
+    glm::vec3 Direction(uint32_t index) const;
+    glm::vec3 Power(uint32_t index) const;
+
+    // Radiance reflected towards the viewer from the k nearest photons on the front side of n,
+    // with Jensen's cone filter. brdf(wi) gives the BRDF for light arriving from world-space wi.
+    template <typename BRDFFunction>
+    Spectrum EstimateRadiance(const glm::vec3& p, const glm::vec3& n, float searchRadius, int maxPhotons,
+                              const BRDFFunction& brdf, std::vector<Neighbour>& heap) const;
+
+private:
+    // 16 bytes: position quantised to 21 bits per axis across the map's bounds, power as
+    // RGB9E5 relative to the mean photon, then an octahedral direction at 8 bits per axis
+    struct CompactPhoton {
+        uint64_t position;
+        uint32_t power;
+        uint16_t direction;
+        uint8_t axis;       // Split axis at this node; unused for leaves
+        uint8_t padding;
+    };
+    static_assert(sizeof(CompactPhoton) == 16, "CompactPhoton should stay 16 bytes");
+
+    std::vector<CompactPhoton> nodes;
+    glm::vec3 boundsMin;
+    glm::vec3 cellSize;
+    glm::vec3 inverseCellSize;
+    float powerUnit;        // Power that RGB9E5 1.0 stands for
+
+    void Balance(std::vector<Photon>& photons, size_t begin, size_t end, size_t node, int parallelDepth);
+    CompactPhoton Encode(const Photon& photon, int axis) const;
+    glm::vec3 DecodePosition(uint64_t position) const;
+};
+
+template <typename BRDFFunction>
+Spectrum PhotonMap::EstimateRadiance(const glm::vec3& p, const glm::vec3& n, float searchRadius, int maxPhotons,
+                                     const BRDFFunction& brdf, std::vector<Neighbour>& heap) const
+{
+    // Cone filter weight 1 - d / (k r), normalised by 1 - 2 / (3k)
+    const float CONE_K = 1.1f;
+
+    FindNearest(p, searchRadius * searchRadius, maxPhotons, heap);
+    if (heap.empty()) {
+        return Spectrum(0.0f);
+    }
+
+    // A full heap shrinks the kernel to the farthest photon kept
+    float radius2 = static_cast<int>(heap.size()) == maxPhotons ? heap.front().distance2 : searchRadius * searchRadius;
+    float radius = std::sqrt(radius2);
+    if (radius <= 0.0f) {
+        return Spectrum(0.0f);
+    }
+
+    Spectrum L(0.0f);
+    for (const Neighbour& neighbour : heap) {
+        glm::vec3 wi = Direction(neighbour.index);
+        if (glm::dot(wi, n) <= 0.0f) {
+            continue;
+        }
+        float weight = 1.0f - std::sqrt(neighbour.distance2) / (CONE_K * radius);
+        L.addProduct(brdf(wi), Spectrum::FromRGB(Power(neighbour.index) * weight));
+    }
+
+    float area = 3.14159265f * radius2 * (1.0f - 2.0f / (3.0f * CONE_K));
+    return L / area;
+}
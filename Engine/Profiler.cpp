@@ -0,0 +1,666 @@
+#include "Profiler.hpp"
+#include <windows.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    constexpr uint32_t UNIFORM_VIEWPORT_SIZE = HashUniformName("u_viewportSize");
+    constexpr uint32_t UNIFORM_FONT = HashUniformName("u_font");
+
+    // Weight of the newest frame in the running averages
+    const float SMOOTHING = 0.05f;
+
+    // GPU and CPU clocks drift apart slowly; re-pair them every few seconds
+    const uint32_t CALIBRATION_INTERVAL = 600;
+
+    // ASCII 32-126 in a 16 x 6 grid; the last cell (DEL) is filled solid for bars and the panel
+    const int FIRST_GLYPH = 32;
+    const int GLYPH_COUNT = 96;
+    const int ATLAS_COLUMNS = 16;
+    const int ATLAS_ROWS = 6;
+    const int FONT_HEIGHT = 14;
+
+    const int OVERLAY_VERTEX_FLOATS = 8;    // Position, UV, RGBA
+    const float OVERLAY_MARGIN = 8.0f;
+    const float OVERLAY_PADDING = 6.0f;
+    const int TEXT_COLUMNS = 39;            // "%-22s%8s%8s" plus a gap before the bars
+    const float BAR_WIDTH = 200.0f;
+    const float BAR_RANGE_MS = 33.3f;       // A full bar; the marker sits at 60 Hz
+    const float FRAME_BUDGET_MS = 16.7f;
+
+    const float PANEL_COLOR[4] = { 0.0f, 0.0f, 0.0f, 0.65f };
+    const float TEXT_COLOR[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    const float HEADER_COLOR[4] = { 0.6f, 0.6f, 0.6f, 1.0f };
+    const float CPU_BAR_COLOR[4] = { 0.3f, 0.6f, 1.0f, 0.9f };
+    const float GPU_BAR_COLOR[4] = { 1.0f, 0.55f, 0.2f, 0.9f };
+    const float MARKER_COLOR[4] = { 1.0f, 0.2f, 0.2f, 0.8f };
+
+    void WriteJSONString(std::ostream& out, const char* text)
+    {
+        out << '"';
+        for (const char* c = text; *c; ++c) {
+            if (*c == '"' || *c == '\\') {
+                out << '\\' << *c;
+            } else if (static_cast<unsigned char>(*c) < 0x20) {
+                out << ' ';
+            } else {
+                out << *c;
+            }
+        }
+        out << '"';
+    }
+}
+
+void Profiler::ThreadBuffer::Push(const Event& event)
+{
+    uint64_t index = head.load(std::memory_order_relaxed);
+    events[index & (CPU_EVENT_CAPACITY - 1)] = event;
+    head.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::ThreadBuffer::Snapshot(std::vector<Event>& out) const
+{
+    uint64_t end = head.load(std::memory_order_acquire);
+    uint64_t begin = end > CPU_EVENT_CAPACITY ? end - CPU_EVENT_CAPACITY : 0;
+    size_t first = out.size();
+    for (uint64_t i = begin; i < end; ++i) {
+        out.push_back(events[i & (CPU_EVENT_CAPACITY - 1)]);
+    }
+
+    // Slots the writer reused during the copy hold newer events than their position says
+    uint64_t after = head.load(std::memory_order_acquire);
+    uint64_t oldestIntact = after > CPU_EVENT_CAPACITY ? after - CPU_EVENT_CAPACITY : 0;
+    if (oldestIntact > begin) {
+        size_t lapped = static_cast<size_t>((std::min)(oldestIntact, end) - begin);
+        out.erase(out.begin() + first, out.begin() + first + lapped);
+    }
+}
+
+Profiler& Profiler::Get()
+{
+    static Profiler instance;
+    return instance;
+}
+
+Profiler::Profiler()
+    : epoch(std::chrono::steady_clock::now()), frameThread(nullptr), frameNumber(0), frameStart(0),
+      timerQueries(false), debugGroups(false), gpuReady(false), gpuFrameIndex(0), gpuDepth(0), gpuClockOffset(0),
+      gpuFramesDropped(0), cpuFrameMs(0.0f), gpuFrameMs(0.0f), cpuTotalFrames(0), gpuTotalFrames(0),
+      gpuFrameTotal(0.0), overlayVisible(false), fontTexture(0), overlayVAO(0),
+      overlayVBO(0), glyphWidth(0), glyphHeight(0), atlasWidth(0), atlasHeight(0)
+{
+    gpuTrack.name = "GPU";
+    for (GPUFrame& frame : gpuFrames) {
+        std::fill(frame.queries, frame.queries + MAX_GPU_PASSES * 2, 0u);
+        frame.queryCount = 0;
+        frame.lastIssued = -1;
+        frame.frame = 0;
+    }
+}
+
+// GL objects are released by ReleaseGPU while the context is still current
+Profiler::~Profiler()
+{
+}
+
+uint64_t Profiler::Now() const
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+Profiler::ThreadBuffer& Profiler::LocalBuffer()
+{
+    // The profiler is a singleton, so one pointer per thread is enough
+    static thread_local ThreadBuffer* local = nullptr;
+    if (!local) {
+        std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        buffer->id = static_cast<uint32_t>(threads.size()) + 1;    // 0 is the GPU track
+        buffer->name = "Thread " + std::to_string(buffer->id);
+        local = buffer.get();
+        threads.push_back(std::move(buffer));
+    }
+    return *local;
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    ThreadBuffer& buffer = LocalBuffer();
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    buffer.name = name;
+}
+
+bool Profiler::InitGPU()
+{
+    ReleaseGPU();
+
+    timerQueries = GLEW_ARB_timer_query || GLEW_VERSION_3_3;
+    debugGroups = GLEW_KHR_debug || GLEW_VERSION_4_3;
+    if (timerQueries) {
+        for (GPUFrame& frame : gpuFrames) {
+            glGenQueries(MAX_GPU_PASSES * 2, frame.queries);
+            frame.queryCount = 0;
+            frame.lastIssued = -1;
+            frame.passes.clear();
+        }
+        CalibrateGPUClock();
+    } else {
+        std::cerr << "Profiler: timer queries unsupported; GPU passes will not be timed" << std::endl;
+    }
+    gpuFrameIndex = 0;
+    gpuDepth = 0;
+    gpuReady = true;
+
+    overlayShader = std::make_unique<Shader>();
+    if (!overlayShader->InitFromFiles("shaders/profiler_overlay.vert", "shaders/profiler_overlay.frag") ||
+        !BuildFontAtlas()) {
+        std::cerr << "Profiler: overlay unavailable" << std::endl;
+        overlayShader.reset();
+        return false;
+    }
+
+    glGenVertexArrays(1, &overlayVAO);
+    glGenBuffers(1, &overlayVBO);
+    glBindVertexArray(overlayVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, overlayVBO);
+    const GLsizei stride = OVERLAY_VERTEX_FLOATS * sizeof(float);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)(4 * sizeof(float)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void Profiler::ReleaseGPU()
+{
+    if (gpuReady && timerQueries) {
+        for (GPUFrame& frame : gpuFrames) {
+            glDeleteQueries(MAX_GPU_PASSES * 2, frame.queries);
+            std::fill(frame.queries, frame.queries + MAX_GPU_PASSES * 2, 0u);
+        }
+    }
+    if (fontTexture) glDeleteTextures(1, &fontTexture);
+    if (overlayVAO) glDeleteVertexArrays(1, &overlayVAO);
+    if (overlayVBO) glDeleteBuffers(1, &overlayVBO);
+    fontTexture = overlayVAO = overlayVBO = 0;
+    overlayShader.reset();
+    gpuReady = false;
+}
+
+void Profiler::CalibrateGPUClock()
+{
+    // Reads the GPU clock as the commands issued so far reach it; nothing waits for them
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    gpuClockOffset = static_cast<int64_t>(Now()) - static_cast<int64_t>(gpuNow);
+}
+
+void Profiler::BeginFrame()
+{
+    uint64_t now = Now();
+    ThreadBuffer& buffer = LocalBuffer();
+    if (frameThread.load(std::memory_order_relaxed) == &buffer && frameStart != 0) {
+        Event frameEvent = { "Frame", frameStart, now, 0, frameNumber.load(std::memory_order_relaxed) };
+        buffer.Push(frameEvent);
+
+        float frameMs = static_cast<float>(now - frameStart) * 1e-6f;
+        cpuFrameMs += (frameMs - cpuFrameMs) * SMOOTHING;
+        for (PassStats& stats : passes) {
+            stats.cpuMs += (stats.cpuPending - stats.cpuMs) * SMOOTHING;
+            stats.cpuTotal += stats.cpuPending;
+            stats.cpuPending = 0.0f;
+        }
+        ++cpuTotalFrames;
+    }
+    frameThread.store(&buffer, std::memory_order_relaxed);
+    frameStart = now;
+    uint32_t frame = frameNumber.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    if (!gpuReady || !timerQueries) {
+        return;
+    }
+
+    // A pass left open at the end of a frame is not carried into the next one
+    gpuDepth = 0;
+
+    // The set being reused was issued GPU_QUERY_FRAMES - 1 frames ago; if the GPU has still not
+    // finished it, its timings are dropped rather than waited for
+    gpuFrameIndex = (gpuFrameIndex + 1) % GPU_QUERY_FRAMES;
+    GPUFrame& gpuFrame = gpuFrames[gpuFrameIndex];
+    ResolveGPUFrame(gpuFrame);
+    gpuFrame.queryCount = 0;
+    gpuFrame.lastIssued = -1;
+    gpuFrame.passes.clear();
+    gpuFrame.frame = frame;
+
+    if (frame % CALIBRATION_INTERVAL == 0) {
+        CalibrateGPUClock();
+    }
+}
+
+bool Profiler::ResolveGPUFrame(GPUFrame& frame)
+{
+    if (frame.lastIssued < 0) {
+        return true;
+    }
+
+    // Timestamps land in submission order, so the newest being ready means they all are
+    GLint available = 0;
+    glGetQueryObjectiv(frame.queries[frame.lastIssued], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        if (gpuFramesDropped++ == 0) {
+            std::cerr << "Profiler: GPU is more than " << GPU_QUERY_FRAMES - 1
+                      << " frames behind; dropping its timings for those frames" << std::endl;
+        }
+        return false;
+    }
+
+    GLuint64 frameBegin = ~GLuint64(0);
+    GLuint64 frameEnd = 0;
+    for (const GPUPass& pass : frame.passes) {
+        if (!pass.closed) {
+            continue;
+        }
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(frame.queries[pass.query], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(frame.queries[pass.query + 1], GL_QUERY_RESULT, &end);
+        if (end < begin) {
+            continue;
+        }
+        frameBegin = (std::min)(frameBegin, begin);
+        frameEnd = (std::max)(frameEnd, end);
+
+        int64_t start = (std::max)(static_cast<int64_t>(begin) + gpuClockOffset, int64_t(0));
+        Event event = { pass.name, static_cast<uint64_t>(start), static_cast<uint64_t>(start) + (end - begin),
+                        pass.depth, frame.frame };
+        gpuTrack.Push(event);
+
+        PassStats& stats = FindPass(pass.name, pass.depth);
+        stats.timedOnGPU = true;
+        stats.gpuPending += static_cast<float>(end - begin) * 1e-6f;
+    }
+
+    if (frameEnd > frameBegin) {
+        float frameMs = static_cast<float>(frameEnd - frameBegin) * 1e-6f;
+        gpuFrameMs += (frameMs - gpuFrameMs) * SMOOTHING;
+        gpuFrameTotal += frameMs;
+    }
+    for (PassStats& stats : passes) {
+        stats.gpuMs += (stats.gpuPending - stats.gpuMs) * SMOOTHING;
+        stats.gpuTotal += stats.gpuPending;
+        stats.gpuPending = 0.0f;
+    }
+    ++gpuTotalFrames;
+    return true;
+}
+
+Profiler::PassStats& Profiler::FindPass(const char* name, uint32_t depth)
+{
+    // Equal literals from different translation units may not share an address
+    for (PassStats& stats : passes) {
+        if (stats.name == name || std::strcmp(stats.name, name) == 0) {
+            return stats;
+        }
+    }
+    PassStats stats = { name, depth, false, 0.0f, 0.0f, 0.0f, 0.0f, 0.0, 0.0 };
+    passes.push_back(stats);
+    return passes.back();
+}
+
+void Profiler::ResetTotals()
+{
+    for (PassStats& stats : passes) {
+        stats.cpuTotal = 0.0;
+        stats.gpuTotal = 0.0;
+    }
+    cpuTotalFrames = 0;
+    gpuTotalFrames = 0;
+    gpuFrameTotal = 0.0;
+}
+
+std::vector<Profiler::PassTotals> Profiler::GetPassTotals() const
+{
+    std::vector<PassTotals> totals;
+    for (const PassStats& stats : passes) {
+        PassTotals pass;
+        pass.name = stats.name;
+        pass.depth = stats.depth;
+        pass.cpuMs = cpuTotalFrames ? stats.cpuTotal / cpuTotalFrames : 0.0;
+        pass.gpuMs = !stats.timedOnGPU ? -1.0 : gpuTotalFrames ? stats.gpuTotal / gpuTotalFrames : 0.0;
+        totals.push_back(pass);
+    }
+    return totals;
+}
+
+double Profiler::GetMeanGPUFrameTime() const
+{
+    return gpuTotalFrames ? gpuFrameTotal / gpuTotalFrames : 0.0;
+}
+
+void Profiler::BeginCPU(const char* name)
+{
+    ThreadBuffer& buffer = LocalBuffer();
+    if (buffer.depth < MAX_DEPTH) {
+        buffer.openNames[buffer.depth] = name;
+        buffer.openStarts[buffer.depth] = Now();
+    }
+    ++buffer.depth;
+}
+
+void Profiler::EndCPU()
+{
+    ThreadBuffer& buffer = LocalBuffer();
+    if (buffer.depth == 0) {
+        return;
+    }
+    int depth = --buffer.depth;
+    if (depth >= MAX_DEPTH) {
+        return;
+    }
+
+    Event event = { buffer.openNames[depth], buffer.openStarts[depth], Now(), static_cast<uint32_t>(depth),
+                    frameNumber.load(std::memory_order_relaxed) };
+    buffer.Push(event);
+
+    // Only the render thread's scopes make up the overlay's frame
+    if (frameThread.load(std::memory_order_relaxed) == &buffer) {
+        FindPass(event.name, event.depth).cpuPending += static_cast<float>(event.end - event.start) * 1e-6f;
+    }
+}
+
+void Profiler::BeginPass(const char* name)
+{
+    BeginCPU(name);
+
+    if (debugGroups) {
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+    }
+
+    if (!gpuReady || !timerQueries) {
+        return;
+    }
+    int passIndex = -1;
+    GPUFrame& frame = gpuFrames[gpuFrameIndex];
+    if (frame.queryCount + 2 <= MAX_GPU_PASSES * 2) {
+        GPUPass pass = { name, static_cast<uint32_t>((std::min)(gpuDepth, MAX_DEPTH)), frame.queryCount, false };
+        glQueryCounter(frame.queries[pass.query], GL_TIMESTAMP);
+        frame.lastIssued = pass.query;
+        frame.queryCount += 2;
+        passIndex = static_cast<int>(frame.passes.size());
+        frame.passes.push_back(pass);
+    }
+    if (gpuDepth < MAX_DEPTH) {
+        gpuStack[gpuDepth] = passIndex;
+    }
+    ++gpuDepth;
+}
+
+void Profiler::EndPass()
+{
+    if (gpuReady && timerQueries && gpuDepth > 0) {
+        --gpuDepth;
+        int passIndex = gpuDepth < MAX_DEPTH ? gpuStack[gpuDepth] : -1;
+        GPUFrame& frame = gpuFrames[gpuFrameIndex];
+        if (passIndex >= 0 && passIndex < static_cast<int>(frame.passes.size())) {
+            GPUPass& pass = frame.passes[passIndex];
+            glQueryCounter(frame.queries[pass.query + 1], GL_TIMESTAMP);
+            frame.lastIssued = pass.query + 1;
+            pass.closed = true;
+        }
+    }
+
+    if (debugGroups) {
+        glPopDebugGroup();
+    }
+
+    EndCPU();
+}
+
+bool Profiler::BuildFontAtlas()
+{
+    // GDI rasterises a fixed-pitch font once; the overlay then only needs the coverage texture
+    HDC dc = CreateCompatibleDC(nullptr);
+    if (!dc) {
+        return false;
+    }
+    HFONT font = CreateFontA(-FONT_HEIGHT, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, ANSI_CHARSET, OUT_DEFAULT_PRECIS,
+                             CLIP_DEFAULT_PRECIS, NONANTIALIASED_QUALITY, FIXED_PITCH | FF_MODERN, "Consolas");
+    HGDIOBJ previousFont = SelectObject(dc, font);
+    TEXTMETRICA metrics = {};
+    GetTextMetricsA(dc, &metrics);
+    glyphWidth = metrics.tmAveCharWidth;
+    glyphHeight = metrics.tmHeight;
+    atlasWidth = glyphWidth * ATLAS_COLUMNS;
+    atlasHeight = glyphHeight * ATLAS_ROWS;
+
+    void* bits = nullptr;
+    HBITMAP bitmap = nullptr;
+    if (glyphWidth > 0 && glyphHeight > 0) {
+        BITMAPINFO info = {};
+        info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        info.bmiHeader.biWidth = atlasWidth;
+        info.bmiHeader.biHeight = -atlasHeight;     // Top-down, like the GL upload below
+        info.bmiHeader.biPlanes = 1;
+        info.bmiHeader.biBitCount = 32;
+        info.bmiHeader.biCompression = BI_RGB;
+        bitmap = CreateDIBSection(dc, &info, DIB_RGB_COLORS, &bits, nullptr, 0);
+    }
+    if (!bitmap || !bits) {
+        SelectObject(dc, previousFont);
+        DeleteObject(font);
+        DeleteDC(dc);
+        return false;
+    }
+
+    HGDIOBJ previousBitmap = SelectObject(dc, bitmap);
+    std::memset(bits, 0, static_cast<size_t>(atlasWidth) * atlasHeight * 4);
+    SetBkMode(dc, TRANSPARENT);
+    SetTextColor(dc, RGB(255, 255, 255));
+    for (int i = 0; i < GLYPH_COUNT - 1; ++i) {
+        char character = static_cast<char>(FIRST_GLYPH + i);
+        TextOutA(dc, (i % ATLAS_COLUMNS) * glyphWidth, (i / ATLAS_COLUMNS) * glyphHeight, &character, 1);
+    }
+    GdiFlush();
+
+    // White text, so any channel is the coverage
+    std::vector<uint8_t> coverage(static_cast<size_t>(atlasWidth) * atlasHeight);
+    const uint32_t* pixels = static_cast<const uint32_t*>(bits);
+    for (size_t i = 0; i < coverage.size(); ++i) {
+        coverage[i] = static_cast<uint8_t>((pixels[i] >> 8) & 0xFF);
+    }
+    int solidX = ((GLYPH_COUNT - 1) % ATLAS_COLUMNS) * glyphWidth;
+    int solidY = ((GLYPH_COUNT - 1) / ATLAS_COLUMNS) * glyphHeight;
+    for (int y = solidY; y < solidY + glyphHeight; ++y) {
+        std::fill(coverage.begin() + y * atlasWidth + solidX, coverage.begin() + y * atlasWidth + solidX + glyphWidth,
+                  uint8_t(255));
+    }
+
+    SelectObject(dc, previousBitmap);
+    SelectObject(dc, previousFont);
+    DeleteObject(bitmap);
+    DeleteObject(font);
+    DeleteDC(dc);
+
+    glGenTextures(1, &fontTexture);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, coverage.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+void Profiler::AddQuad(float x, float y, float width, float height, float u0, float v0, float u1, float v1,
+                       const float* color)
+{
+    const float corners[6][4] = {
+        { x, y, u0, v0 }, { x + width, y, u1, v0 }, { x + width, y + height, u1, v1 },
+        { x, y, u0, v0 }, { x + width, y + height, u1, v1 }, { x, y + height, u0, v1 }
+    };
+    for (const float* corner : corners) {
+        overlayVertices.insert(overlayVertices.end(), corner, corner + 4);
+        overlayVertices.insert(overlayVertices.end(), color, color + 4);
+    }
+}
+
+void Profiler::AddRect(float x, float y, float width, float height, const float* color)
+{
+    // Sample the middle of the solid cell so filtering never reaches a neighbour
+    float u = (((GLYPH_COUNT - 1) % ATLAS_COLUMNS) + 0.5f) / ATLAS_COLUMNS;
+    float v = (((GLYPH_COUNT - 1) / ATLAS_COLUMNS) + 0.5f) / ATLAS_ROWS;
+    AddQuad(x, y, width, height, u, v, u, v, color);
+}
+
+void Profiler::AddText(float x, float y, const char* text, const float* color)
+{
+    for (const char* c = text; *c; ++c, x += glyphWidth) {
+        int glyph = static_cast<unsigned char>(*c) - FIRST_GLYPH;
+        if (glyph <= 0 || glyph >= GLYPH_COUNT - 1) {
+            continue;
+        }
+        float u0 = static_cast<float>((glyph % ATLAS_COLUMNS) * glyphWidth) / atlasWidth;
+        float v0 = static_cast<float>((glyph / ATLAS_COLUMNS) * glyphHeight) / atlasHeight;
+        float u1 = u0 + static_cast<float>(glyphWidth) / atlasWidth;
+        float v1 = v0 + static_cast<float>(glyphHeight) / atlasHeight;
+        AddQuad(x, y, static_cast<float>(glyphWidth), static_cast<float>(glyphHeight), u0, v0, u1, v1, color);
+    }
+}
+
+void Profiler::DrawOverlay(int viewportWidth, int viewportHeight)
+{
+    if (!overlayVisible || !overlayShader || viewportWidth <= 0 || viewportHeight <= 0) {
+        return;
+    }
+
+    const float lineHeight = static_cast<float>(glyphHeight);
+    const float textLeft = OVERLAY_MARGIN + OVERLAY_PADDING;
+    const float barLeft = textLeft + TEXT_COLUMNS * glyphWidth;
+    const float panelWidth = TEXT_COLUMNS * glyphWidth + BAR_WIDTH + 2.0f * OVERLAY_PADDING;
+    const float panelHeight = (passes.size() + 2) * lineHeight + 2.0f * OVERLAY_PADDING;
+
+    overlayVertices.clear();
+    AddRect(OVERLAY_MARGIN, OVERLAY_MARGIN, panelWidth, panelHeight, PANEL_COLOR);
+
+    char line[128];
+    float y = OVERLAY_MARGIN + OVERLAY_PADDING;
+    if (timerQueries) {
+        snprintf(line, sizeof(line), "Frame  CPU %6.2f ms  GPU %6.2f ms", cpuFrameMs, gpuFrameMs);
+    } else {
+        snprintf(line, sizeof(line), "Frame  CPU %6.2f ms  GPU n/a", cpuFrameMs);
+    }
+    AddText(textLeft, y, line, TEXT_COLOR);
+    y += lineHeight;
+    snprintf(line, sizeof(line), "%-22s%8s%8s", "Pass", "CPU ms", "GPU ms");
+    AddText(textLeft, y, line, HEADER_COLOR);
+    y += lineHeight;
+
+    AddRect(barLeft + BAR_WIDTH * FRAME_BUDGET_MS / BAR_RANGE_MS, y, 1.0f, passes.size() * lineHeight, MARKER_COLOR);
+
+    // CPU on the top half of each row's bar, GPU on the bottom
+    const float barHeight = (lineHeight - 2.0f) * 0.5f;
+    for (const PassStats& stats : passes) {
+        char name[32];
+        snprintf(name, sizeof(name), "%*s%s", static_cast<int>((std::min)(stats.depth, 4u) * 2), "", stats.name);
+        if (stats.timedOnGPU) {
+            snprintf(line, sizeof(line), "%-22.22s%8.2f%8.2f", name, stats.cpuMs, stats.gpuMs);
+        } else {
+            snprintf(line, sizeof(line), "%-22.22s%8.2f%8s", name, stats.cpuMs, "-");
+        }
+        AddText(textLeft, y, line, TEXT_COLOR);
+
+        AddRect(barLeft, y + 1.0f, (std::min)(stats.cpuMs / BAR_RANGE_MS, 1.0f) * BAR_WIDTH, barHeight, CPU_BAR_COLOR);
+        if (stats.timedOnGPU) {
+            AddRect(barLeft, y + 1.0f + barHeight, (std::min)(stats.gpuMs / BAR_RANGE_MS, 1.0f) * BAR_WIDTH, barHeight,
+                    GPU_BAR_COLOR);
+        }
+        y += lineHeight;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, overlayVBO);
+    glBufferData(GL_ARRAY_BUFFER, overlayVertices.size() * sizeof(float), overlayVertices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    overlayShader->use();
+    glUniform2f(overlayShader->getUniformLocation(UNIFORM_VIEWPORT_SIZE), static_cast<float>(viewportWidth),
+                static_cast<float>(viewportHeight));
+    glUniform1i(overlayShader->getUniformLocation(UNIFORM_FONT), 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    glBindVertexArray(overlayVAO);
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(overlayVertices.size() / OVERLAY_VERTEX_FLOATS));
+    glBindVertexArray(0);
+
+    glDisable(GL_BLEND);
+    if (cullFace) glEnable(GL_CULL_FACE);
+    if (depthTest) glEnable(GL_DEPTH_TEST);
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path)
+{
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Profiler: cannot write " << path << std::endl;
+        return false;
+    }
+
+    // Complete ("X") events in microseconds, one track per thread plus the GPU
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    size_t eventCount = 0;
+    bool first = true;
+    std::vector<Event> events;
+    auto writeTrack = [&](const ThreadBuffer& track, const char* category) {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track.id
+             << ",\"args\":{\"name\":";
+        WriteJSONString(file, track.name.c_str());
+        file << "}}";
+        first = false;
+
+        events.clear();
+        track.Snapshot(events);
+        char timing[96];
+        for (const Event& event : events) {
+            file << ",\n{\"name\":";
+            WriteJSONString(file, event.name);
+            snprintf(timing, sizeof(timing), ",\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+                     static_cast<double>(event.start) * 1e-3, static_cast<double>(event.end - event.start) * 1e-3,
+                     event.frame);
+            file << ",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << track.id << timing;
+        }
+        eventCount += events.size();
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        writeTrack(gpuTrack, "gpu");
+        for (const std::unique_ptr<ThreadBuffer>& thread : threads) {
+            writeTrack(*thread, "cpu");
+        }
+    }
+    file << "\n]}\n";
+
+    if (!file) {
+        std::cerr << "Profiler: failed writing " << path << std::endl;
+        return false;
+    }
+    std::cout << "Profiler: wrote " << eventCount << " events to " << path << std::endl;
+    return true;
+}
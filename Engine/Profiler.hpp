@@ -0,0 +1,197 @@
+#pragma once
+#include <GL/glew.h>
+#include "Shader.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Default location of ExportChromeTrace, relative to the working directory like shaders/
+const char* const PROFILER_TRACE_PATH = "profile_trace.json";
+
+// Frame profiler. CPU scopes go into a ring buffer per thread that only its own thread writes,
+// so recording takes no lock; GPU passes are bracketed by GL_TIMESTAMP queries kept for a few
+// frames and read back only once available, so timing never waits on the GPU. Passes also
+// open KHR_debug groups for RenderDoc and Nsight. Names must be string literals (or otherwise
+// outlive the profiler); only their pointers are stored.
+class Profiler {
+public:
+    static const uint32_t CPU_EVENT_CAPACITY = 16384;   // Per thread, a power of two
+    static const int GPU_QUERY_FRAMES = 3;
+    static const int MAX_GPU_PASSES = 64;               // Per frame; later passes go untimed
+    static const int MAX_DEPTH = 32;
+
+    static Profiler& Get();
+
+    // Timer queries, debug groups and the overlay; needs a current context. CPU scopes work
+    // without it. False when the overlay could not be built; passes are still timed.
+    bool InitGPU();
+    void ReleaseGPU();
+
+    // Once per frame on the render thread, before any pass; collects finished queries and
+    // folds the last frame into the averages
+    void BeginFrame();
+
+    // Names the calling thread in the trace; one that never calls it is "Thread <n>"
+    void SetThreadName(const char* name);
+
+    void BeginCPU(const char* name);
+    void EndCPU();
+
+    // A CPU scope plus a GPU timer and debug group; render thread only
+    void BeginPass(const char* name);
+    void EndPass();
+
+    // Per-pass averages in the top-left corner, drawn over whatever is bound; depth testing and
+    // culling are restored afterwards and blending is left off
+    void DrawOverlay(int viewportWidth, int viewportHeight);
+    void SetOverlayVisible(bool visible) { overlayVisible = visible; }
+    bool IsOverlayVisible() const { return overlayVisible; }
+
+    // Everything still in the ring buffers, GPU passes on their own track, as JSON for
+    // chrome://tracing or Perfetto
+    bool ExportChromeTrace(const std::string& path = PROFILER_TRACE_PATH);
+
+    // Averaged frame times in milliseconds; GPU stays 0 without timer queries
+    float GetCPUFrameTime() const { return cpuFrameMs; }
+    float GetGPUFrameTime() const { return gpuFrameMs; }
+
+    // Plain means since ResetTotals, for reports; GPU frames resolve a couple of frames late
+    struct PassTotals {
+        std::string name;
+        uint32_t depth;
+        double cpuMs;
+        double gpuMs;           // Negative when the pass was never timed on the GPU
+    };
+    void ResetTotals();
+    std::vector<PassTotals> GetPassTotals() const;
+    double GetMeanGPUFrameTime() const;
+
+private:
+    struct Event {
+        const char* name;
+        uint64_t start;         // Nanoseconds since the profiler was created
+        uint64_t end;
+        uint32_t depth;
+        uint32_t frame;
+    };
+
+    // Readers copy the ring and then drop whatever the writer lapped while they were copying
+    struct ThreadBuffer {
+        std::vector<Event> events;
+        std::atomic<uint64_t> head;
+        std::string name;
+        uint32_t id;
+        int depth;
+        const char* openNames[MAX_DEPTH];
+        uint64_t openStarts[MAX_DEPTH];
+
+        ThreadBuffer() : events(CPU_EVENT_CAPACITY), head(0), id(0), depth(0) {}
+        void Push(const Event& event);
+        void Snapshot(std::vector<Event>& out) const;
+    };
+
+    struct GPUPass {
+        const char* name;
+        uint32_t depth;
+        int query;              // Begin timestamp; the end is the next query
+        bool closed;
+    };
+
+    struct GPUFrame {
+        GLuint queries[MAX_GPU_PASSES * 2];
+        int queryCount;
+        int lastIssued;         // Newest query with a timestamp written, -1 for none
+        std::vector<GPUPass> passes;
+        uint32_t frame;
+    };
+
+    // Smoothed per-pass times, in the order the passes were first seen
+    struct PassStats {
+        const char* name;
+        uint32_t depth;
+        bool timedOnGPU;
+        float cpuMs, gpuMs;
+        float cpuPending, gpuPending;   // This frame's totals, not yet averaged in
+        double cpuTotal, gpuTotal;      // Sums since ResetTotals
+    };
+
+    std::chrono::steady_clock::time_point epoch;
+
+    std::mutex threadsMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> threads;
+    std::atomic<ThreadBuffer*> frameThread;     // The thread that calls BeginFrame
+    std::atomic<uint32_t> frameNumber;
+    uint64_t frameStart;
+
+    // GPU passes land on this track once resolved, in CPU time
+    ThreadBuffer gpuTrack;
+
+    bool timerQueries;
+    bool debugGroups;
+    bool gpuReady;
+    GPUFrame gpuFrames[GPU_QUERY_FRAMES];
+    int gpuFrameIndex;
+    int gpuDepth;
+    int gpuStack[MAX_DEPTH];
+    int64_t gpuClockOffset;     // CPU time minus GPU time, in nanoseconds
+    uint32_t gpuFramesDropped;
+
+    std::vector<PassStats> passes;
+    float cpuFrameMs;
+    float gpuFrameMs;
+    uint32_t cpuTotalFrames, gpuTotalFrames;
+    double gpuFrameTotal;
+
+    bool overlayVisible;
+    std::unique_ptr<Shader> overlayShader;
+    GLuint fontTexture;
+    GLuint overlayVAO;
+    GLuint overlayVBO;
+    int glyphWidth, glyphHeight;
+    int atlasWidth, atlasHeight;
+    std::vector<float> overlayVertices;
+
+    Profiler();
+    ~Profiler();
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    uint64_t Now() const;
+    ThreadBuffer& LocalBuffer();
+    PassStats& FindPass(const char* name, uint32_t depth);
+    void CalibrateGPUClock();
+    bool ResolveGPUFrame(GPUFrame& frame);
+
+    bool BuildFontAtlas();
+    void AddQuad(float x, float y, float width, float height, float u0, float v0, float u1, float v1,
+                 const float* color);
+    void AddRect(float x, float y, float width, float height, const float* color);
+    void AddText(float x, float y, const char* text, const float* color);
+};
+
+// Times the enclosing block on the CPU
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) { Profiler::Get().BeginCPU(name); }
+    ~ProfileScope() { Profiler::Get().EndCPU(); }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+// Times the enclosing block on the CPU and the GPU
+class ProfilePassScope {
+public:
+    explicit ProfilePassScope(const char* name) { Profiler::Get().BeginPass(name); }
+    ~ProfilePassScope() { Profiler::Get().EndPass(); }
+    ProfilePassScope(const ProfilePassScope&) = delete;
+    ProfilePassScope& operator=(const ProfilePassScope&) = delete;
+};
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILER_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_PASS(name) ProfilePassScope PROFILER_CONCAT(profilePass, __LINE__)(name)
@@ -0,0 +1,207 @@
+#include "ProgramBinaryCache.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    const uint32_t PROGRAM_BINARY_MAGIC = 0x4E494250u; // "PBIN"
+    const uint32_t PROGRAM_BINARY_VERSION = 1;
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t driverHash;
+        uint64_t entryCount;
+    };
+
+    struct EntryHeader {
+        uint64_t key;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    // FNV-1a, 64-bit
+    uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t HashString(const char* text, uint64_t hash)
+    {
+        // The terminator separates consecutive strings, so "ab" + "c" differs from "a" + "bc"
+        return HashBytes(text ? text : "", text ? std::strlen(text) + 1 : 1, hash);
+    }
+}
+
+ProgramBinaryCache& ProgramBinaryCache::Get()
+{
+    static ProgramBinaryCache cache;
+    return cache;
+}
+
+ProgramBinaryCache::ProgramBinaryCache()
+    : driverHash(0), enabled(false), dirty(false), loaded(0), compiled(0), rejected(0)
+{
+}
+
+ProgramBinaryCache::~ProgramBinaryCache()
+{
+    Save();
+}
+
+bool ProgramBinaryCache::Initialize(const std::string& cachePath)
+{
+    path = cachePath;
+    entries.clear();
+    dirty = false;
+
+    GLint formatCount = 0;
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    }
+    enabled = formatCount > 0;
+    if (!enabled) {
+        std::cout << "Program binary cache disabled: the driver offers no binary formats" << std::endl;
+        return false;
+    }
+
+    // Binaries only load on the driver that wrote them
+    driverHash = HashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), 14695981039346656037ull);
+    driverHash = HashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), driverHash);
+    driverHash = HashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), driverHash);
+
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return true;
+    }
+    const uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+
+    FileHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != PROGRAM_BINARY_MAGIC || header.version != PROGRAM_BINARY_VERSION ||
+        header.driverHash != driverHash) {
+        std::cout << "Program binary cache is stale; programs will be recompiled" << std::endl;
+        dirty = true;
+        return true;
+    }
+
+    for (uint64_t i = 0; i < header.entryCount; ++i) {
+        EntryHeader entryHeader;
+        in.read(reinterpret_cast<char*>(&entryHeader), sizeof(entryHeader));
+        
+        // Lengths come from disk: one that runs past the end means the file is damaged, and
+        // nothing in it is trusted. Checked before allocating, so a bad length cannot throw.
+        uint64_t remaining = in ? fileSize - static_cast<uint64_t>(in.tellg()) : 0;
+        bool valid = in && entryHeader.length <= remaining;
+        if (valid) {
+            Entry& entry = entries[entryHeader.key];
+            entry.format = entryHeader.format;
+            entry.binary.resize(static_cast<size_t>(entryHeader.length));
+            valid = static_cast<bool>(in.read(reinterpret_cast<char*>(entry.binary.data()), entryHeader.length));
+        }
+        if (!valid) {
+            std::cout << "Program binary cache is damaged; programs will be recompiled" << std::endl;
+            entries.clear();
+            dirty = true;
+            return true;
+        }
+    }
+
+    std::cout << "Program binary cache: " << entries.size() << " programs in " << path << std::endl;
+    return true;
+}
+
+uint64_t ProgramBinaryCache::MakeKey(const GLenum* stages, const char* const* sources, int stageCount) const
+{
+    uint64_t key = driverHash;
+    for (int i = 0; i < stageCount; ++i) {
+        key = HashBytes(&stages[i], sizeof(GLenum), key);
+        key = HashString(sources[i], key);
+    }
+    // 0 means "no key" to the shaders
+    return key ? key : 1;
+}
+
+bool ProgramBinaryCache::Load(uint64_t key, GLuint program)
+{
+    auto it = entries.find(key);
+    if (!enabled || it == entries.end()) {
+        return false;
+    }
+
+    const Entry& entry = it->second;
+    glProgramBinary(program, entry.format, entry.binary.data(), static_cast<GLsizei>(entry.binary.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        // Drivers may refuse their own binaries after an update that kept the version string
+        entries.erase(it);
+        dirty = true;
+        ++rejected;
+        return false;
+    }
+
+    ++loaded;
+    return true;
+}
+
+void ProgramBinaryCache::Store(uint64_t key, GLuint program)
+{
+    if (!enabled) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    Entry& entry = entries[key];
+    entry.binary.resize(static_cast<size_t>(length));
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &entry.format, entry.binary.data());
+    if (written <= 0) {
+        entries.erase(key);
+        return;
+    }
+    entry.binary.resize(static_cast<size_t>(written));
+    dirty = true;
+    ++compiled;
+}
+
+bool ProgramBinaryCache::Save()
+{
+    if (!enabled || !dirty) return true;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Program binary cache: cannot write " << path << std::endl;
+        return false;
+    }
+
+    FileHeader header = { PROGRAM_BINARY_MAGIC, PROGRAM_BINARY_VERSION, driverHash, entries.size() };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& pair : entries) {
+        EntryHeader entryHeader = { pair.first, pair.second.format, static_cast<uint32_t>(pair.second.binary.size()) };
+        out.write(reinterpret_cast<const char*>(&entryHeader), sizeof(entryHeader));
+        out.write(reinterpret_cast<const char*>(pair.second.binary.data()),
+                  static_cast<std::streamsize>(pair.second.binary.size()));
+    }
+    if (!out) {
+        std::cerr << "Program binary cache: failed while writing " << path << std::endl;
+        return false;
+    }
+
+    dirty = false;
+    return true;
+}
+
+void ProgramBinaryCache::PrintReport() const
+{
+    std::cout << "Program binaries: " << loaded << " loaded, " << compiled << " compiled and stored";
+    if (rejected) {
+        std::cout << ", " << rejected << " rejected by the driver";
+    }
+    std::cout << std::endl;
+}
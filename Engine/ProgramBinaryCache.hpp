@@ -0,0 +1,51 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Default location of the cache, relative to the working directory like shaders/
+const char* const PROGRAM_BINARY_CACHE_PATH = "program_binaries.bin";
+
+// Linked program binaries (ARB_get_program_binary) kept between runs, so a program whose
+// sources have not changed is loaded instead of compiled. Entries are keyed by a hash of
+// every stage's final source (includes resolved, defines injected) and the GL vendor,
+// renderer and version strings; a file written by another driver is dropped whole. A
+// binary the driver rejects falls back to compiling and is replaced.
+class ProgramBinaryCache {
+public:
+    static ProgramBinaryCache& Get();
+
+    // Loads the file; needs a current context. Without binary support the cache stays off.
+    bool Initialize(const std::string& path = PROGRAM_BINARY_CACHE_PATH);
+    bool IsEnabled() const { return enabled; }
+
+    uint64_t MakeKey(const GLenum* stages, const char* const* sources, int stageCount) const;
+
+    // Loads the binary into program and checks that it links; false means compile instead
+    bool Load(uint64_t key, GLuint program);
+    // Takes the binary of a linked program (linked with the retrievable hint)
+    void Store(uint64_t key, GLuint program);
+
+    // Writes the file if anything was stored since it was loaded
+    bool Save();
+
+    void PrintReport() const;
+
+private:
+    struct Entry {
+        GLenum format;
+        std::vector<uint8_t> binary;
+    };
+
+    std::unordered_map<uint64_t, Entry> entries;
+    std::string path;
+    uint64_t driverHash;
+    bool enabled;
+    bool dirty;
+    size_t loaded, compiled, rejected;
+
+    ProgramBinaryCache();
+    ~ProgramBinaryCache();
+};
@@ -0,0 +1,198 @@
+#include "ProgressiveDisplay.hpp"
+#include <iostream>
+
+namespace {
+    constexpr uint32_t UNIFORM_IMAGE = HashUniformName("u_image");
+    constexpr uint32_t UNIFORM_EXPOSURE = HashUniformName("u_exposure");
+
+    // A second of stall means the driver has lost the fence; drop the frame rather than hang
+    const GLuint64 FENCE_TIMEOUT_NS = 1000000000ull;
+}
+
+ProgressiveDisplay::ProgressiveDisplay()
+    : texture(0), pixelBuffer(0), vao(0), width(0), height(0), regionSize(0), persistent(false),
+      mappedBuffer(nullptr), region(0)
+{
+    for (GLsync& fence : fences) {
+        fence = nullptr;
+    }
+}
+
+ProgressiveDisplay::~ProgressiveDisplay()
+{
+    Release();
+}
+
+bool ProgressiveDisplay::Init(int imageWidth, int imageHeight)
+{
+    Release();
+
+    if (imageWidth <= 0 || imageHeight <= 0) {
+        return false;
+    }
+
+    shader = std::make_unique<Shader>();
+    if (!shader->InitFromFiles("shaders/fullscreen.vert", "shaders/progressive_display.frag")) {
+        std::cerr << "ProgressiveDisplay: failed to build the display shader" << std::endl;
+        shader.reset();
+        return false;
+    }
+
+    width = imageWidth;
+    height = imageHeight;
+    regionSize = static_cast<size_t>(width) * height * 4 * sizeof(float);
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenBuffers(1, &pixelBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+
+    // Coherent persistent mapping: the renderer's rows are memcpy'd straight into GL memory
+    persistent = GLEW_ARB_buffer_storage != 0;
+    if (persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, regionSize * REGION_COUNT, nullptr, flags);
+        mappedBuffer = static_cast<float*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, regionSize * REGION_COUNT, flags));
+        if (!mappedBuffer) {
+            std::cerr << "ProgressiveDisplay: persistent map failed, falling back to orphaning" << std::endl;
+            glDeleteBuffers(1, &pixelBuffer);
+            glGenBuffers(1, &pixelBuffer);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+            persistent = false;
+        }
+    }
+    if (!persistent) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    glGenVertexArrays(1, &vao);
+    region = 0;
+    return true;
+}
+
+void ProgressiveDisplay::Release()
+{
+    for (GLsync& fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (pixelBuffer != 0) {
+        if (mappedBuffer) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            mappedBuffer = nullptr;
+        }
+        glDeleteBuffers(1, &pixelBuffer);
+        pixelBuffer = 0;
+    }
+    if (texture != 0) {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+    if (vao != 0) {
+        glDeleteVertexArrays(1, &vao);
+        vao = 0;
+    }
+    shader.reset();
+    width = height = 0;
+}
+
+void ProgressiveDisplay::Update(ProgressiveRenderer& renderer)
+{
+    if (!IsInitialized()) {
+        return;
+    }
+    if (renderer.GetWidth() != width || renderer.GetHeight() != height) {
+        if (!Init(renderer.GetWidth(), renderer.GetHeight())) {
+            return;
+        }
+    }
+
+    int firstRow = 0;
+    int rowCount = 0;
+    size_t regionOffset = 0;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+    if (persistent) {
+        // The region written three uploads ago has to be out of the GPU's hands first
+        GLsync& fence = fences[region];
+        if (fence) {
+            GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+            if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                return;
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        regionOffset = regionSize * region;
+        if (!renderer.CopyMean(mappedBuffer + regionOffset / sizeof(float), firstRow, rowCount)) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return;
+        }
+    } else {
+        // Orphan, so the map does not wait on the previous upload
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+        float* mapped = static_cast<float*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, regionSize,
+                                                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+        bool changed = mapped && renderer.CopyMean(mapped, firstRow, rowCount);
+        if (mapped) {
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        if (!changed) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return;
+        }
+    }
+
+    // The renderer's rows run top down; the shader flips, so rows go in at the same index
+    size_t rowOffset = regionOffset + static_cast<size_t>(firstRow) * width * 4 * sizeof(float);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, firstRow, width, rowCount, GL_RGBA, GL_FLOAT,
+                    reinterpret_cast<const void*>(rowOffset));
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (persistent) {
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        region = (region + 1) % REGION_COUNT;
+    }
+}
+
+void ProgressiveDisplay::Draw(float exposure)
+{
+    if (!IsInitialized()) {
+        return;
+    }
+
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+
+    shader->use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform1i(shader->getUniformLocation(UNIFORM_IMAGE), 0);
+    glUniform1f(shader->getUniformLocation(UNIFORM_EXPOSURE), exposure);
+
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (depthTest) {
+        glEnable(GL_DEPTH_TEST);
+    }
+}
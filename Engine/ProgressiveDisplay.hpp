@@ -0,0 +1,45 @@
+#pragma once
+#include <GL/glew.h>
+#include "Shader.hpp"
+#include "ProgressiveRenderer.hpp"
+#include <memory>
+
+// Shows a ProgressiveRenderer's accumulation in the viewport while it converges. Changed rows
+// are written straight into a persistently mapped pixel buffer (a ring of three image-sized
+// regions fenced against the GPU) and copied into an RGBA32F texture from there; without
+// ARB_buffer_storage the buffer is orphaned and mapped each upload instead. Tone mapping runs
+// in the fragment shader, so the texture stays linear HDR.
+class ProgressiveDisplay {
+public:
+    ProgressiveDisplay();
+    ~ProgressiveDisplay();
+
+    ProgressiveDisplay(const ProgressiveDisplay&) = delete;
+    ProgressiveDisplay& operator=(const ProgressiveDisplay&) = delete;
+
+    // (Re)creates the texture and pixel buffer for an image of this size
+    bool Init(int width, int height);
+    void Release();
+    bool IsInitialized() const { return texture != 0; }
+
+    // Uploads whatever the renderer finished since the last call; cheap when nothing changed
+    void Update(ProgressiveRenderer& renderer);
+
+    // Draws the image over the whole viewport; exposure scales the radiance before Reinhard
+    void Draw(float exposure = 1.0f);
+
+private:
+    static const int REGION_COUNT = 3;
+
+    GLuint texture;
+    GLuint pixelBuffer;
+    GLuint vao;
+    std::unique_ptr<Shader> shader;
+
+    int width, height;
+    size_t regionSize;
+    bool persistent;
+    float* mappedBuffer;            // Whole ring, persistent path only
+    GLsync fences[REGION_COUNT];
+    int region;
+};
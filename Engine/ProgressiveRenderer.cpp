@@ -0,0 +1,242 @@
+#include "ProgressiveRenderer.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace {
+    const glm::vec3 LUMINANCE_WEIGHTS(0.2126f, 0.7152f, 0.0722f);
+
+    // Standard error of the pixel's mean carried through the display's Reinhard curve, whose
+    // slope is 1 / (1 + L)^2: noise in highlights is compressed as much as the highlights are,
+    // and dark pixels are not held to a relative target they can never reach
+    float DisplayError(const glm::vec3& mean, float m2, uint32_t count)
+    {
+        if (count < 2) {
+            return std::numeric_limits<float>::infinity();
+        }
+
+        float varianceOfMean = m2 / (static_cast<float>(count - 1) * count);
+        float luminance = (std::max)(0.0f, glm::dot(mean, LUMINANCE_WEIGHTS));
+        float slope = 1.0f / ((1.0f + luminance) * (1.0f + luminance));
+        return std::sqrt((std::max)(0.0f, varianceOfMean)) * slope;
+    }
+
+    bool IsFinite(const glm::vec3& v)
+    {
+        return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
+    }
+}
+
+ProgressiveRenderer::ProgressiveRenderer()
+    : dirtyBegin(0), dirtyEnd(0), running(false), stopRequested(false), converged(false),
+      passCount(0), convergedTiles(0), finishedSeconds(0.0)
+{
+}
+
+ProgressiveRenderer::~ProgressiveRenderer()
+{
+    Stop();
+}
+
+bool ProgressiveRenderer::Start(const TileRenderer::RadianceFunction& radianceFunction, const Settings& renderSettings)
+{
+    Stop();
+
+    if (renderSettings.width <= 0 || renderSettings.height <= 0 || !radianceFunction) {
+        std::cerr << "ProgressiveRenderer: nothing to render" << std::endl;
+        return false;
+    }
+
+    settings = renderSettings;
+    settings.samplesPerPass = (std::max)(1, settings.samplesPerPass);
+
+    // Whole batches only, so every pass ends on a boundary of the sampler's index shuffle
+    int batches = (std::max)(1, (settings.minSamplesPerPixel + settings.samplesPerPass - 1) / settings.samplesPerPass);
+    settings.minSamplesPerPixel = batches * settings.samplesPerPass;
+    settings.maxSamplesPerPixel = (std::max)(settings.minSamplesPerPixel, settings.maxSamplesPerPixel);
+
+    if (settings.threadCount == 0) {
+        settings.threadCount = (std::max)(2u, std::thread::hardware_concurrency()) - 1;
+    }
+    radiance = radianceFunction;
+
+    size_t pixelCount = static_cast<size_t>(settings.width) * settings.height;
+    PixelStats empty = { glm::vec3(0.0f), 0.0f, 0 };
+    stats.assign(pixelCount, empty);
+
+    tileStates.clear();
+    for (const TileRenderer::Tile& tile : TileRenderer::MakeTiles(settings.width, settings.height, settings.tileSize)) {
+        TileState state = { tile, 0, std::numeric_limits<float>::infinity(), false };
+        tileStates.push_back(state);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(displayMutex);
+        displayMean.assign(pixelCount, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        dirtyBegin = 0;
+        dirtyEnd = settings.height;
+    }
+
+    stopRequested = false;
+    converged = false;
+    passCount = 0;
+    convergedTiles = 0;
+    finishedSeconds = 0.0;
+    startTime = std::chrono::steady_clock::now();
+    running = true;
+
+    std::cout << "Progressive render " << settings.width << "x" << settings.height << ": " << tileStates.size()
+              << " tiles, " << settings.minSamplesPerPixel << "-" << settings.maxSamplesPerPixel
+              << " spp, noise target " << settings.noiseTarget << std::endl;
+
+    thread = std::thread(&ProgressiveRenderer::RenderLoop, this);
+    return true;
+}
+
+void ProgressiveRenderer::Stop()
+{
+    stopRequested = true;
+    tileRenderer.Cancel();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+float ProgressiveRenderer::GetConvergedFraction() const
+{
+    return tileStates.empty() ? 0.0f : static_cast<float>(convergedTiles) / tileStates.size();
+}
+
+double ProgressiveRenderer::GetElapsedSeconds() const
+{
+    if (!running) {
+        return finishedSeconds;
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+bool ProgressiveRenderer::OutOfTime() const
+{
+    return settings.timeBudgetSeconds > 0.0f && GetElapsedSeconds() >= settings.timeBudgetSeconds;
+}
+
+bool ProgressiveRenderer::CopyMean(float* rgba, int& firstRow, int& rowCount)
+{
+    std::lock_guard<std::mutex> lock(displayMutex);
+    if (dirtyBegin >= dirtyEnd) {
+        return false;
+    }
+
+    size_t rowFloats = static_cast<size_t>(settings.width) * 4;
+    size_t offset = static_cast<size_t>(dirtyBegin) * rowFloats;
+    std::memcpy(rgba + offset, &displayMean[0].x + offset, (dirtyEnd - dirtyBegin) * rowFloats * sizeof(float));
+    firstRow = dirtyBegin;
+    rowCount = dirtyEnd - dirtyBegin;
+
+    dirtyBegin = settings.height;
+    dirtyEnd = 0;
+    return true;
+}
+
+void ProgressiveRenderer::RenderLoop()
+{
+    Profiler::Get().SetThreadName("Progressive renderer");
+    while (!stopRequested) {
+        PROFILE_SCOPE("Progressive pass");
+        std::vector<TileRenderer::Tile> active;
+        for (const TileState& state : tileStates) {
+            if (!state.converged) {
+                active.push_back(state.tile);
+            }
+        }
+        if (active.empty()) {
+            converged = true;
+            break;
+        }
+        if (OutOfTime()) {
+            break;
+        }
+
+        // Noisiest first, so a pass cut short by the budget has spent it where it showed most
+        std::stable_sort(active.begin(), active.end(), [this](const TileRenderer::Tile& a, const TileRenderer::Tile& b) {
+            return tileStates[a.index].error > tileStates[b.index].error;
+        });
+
+        tileRenderer.RunTiles(active, [this](const TileRenderer::Tile& tile) {
+            TileState& state = tileStates[tile.index];
+            int sampleCount = state.samples == 0 ? settings.minSamplesPerPixel : settings.samplesPerPass;
+            RenderTileSamples(state, (std::min)(sampleCount, settings.maxSamplesPerPixel - state.samples));
+            PublishTile(tile);
+        }, settings.threadCount, [this](int, int) {
+            return !stopRequested && !OutOfTime();
+        });
+        ++passCount;
+    }
+
+    finishedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    running = false;
+
+    std::cout << "Progressive render " << (converged ? "converged" : "stopped") << " after " << passCount
+              << " passes, " << finishedSeconds.load() << " s (" << convergedTiles << "/" << tileStates.size()
+              << " tiles at target)" << std::endl;
+}
+
+void ProgressiveRenderer::RenderTileSamples(TileState& state, int sampleCount)
+{
+    const TileRenderer::Tile& tile = state.tile;
+    std::unique_ptr<Sampler> sampler = Sampler::Create(settings.sampler, settings.samplesPerPass, settings.seed);
+
+    float errorSum = 0.0f;
+    for (int y = tile.startY; y < tile.endY; ++y) {
+        for (int x = tile.startX; x < tile.endX; ++x) {
+            PixelStats& pixel = stats[static_cast<size_t>(y) * settings.width + x];
+
+            for (int s = 0; s < sampleCount; ++s) {
+                // Indices continue where the last pass stopped, so the sampler keeps stratifying
+                sampler->StartPixelSample(glm::ivec2(x, y), state.samples + s);
+                Ray ray = PathIntegrator::GenerateCameraRay(x, y, settings.width, settings.height,
+                                                            settings.cameraToWorld, settings.fov, sampler->Get2D());
+                glm::vec3 rgb = radiance(ray, *sampler).toRGB();
+
+                // One NaN would stay in the mean for the rest of the render
+                if (!IsFinite(rgb)) {
+                    rgb = glm::vec3(0.0f);
+                }
+
+                // Welford: the colour's running mean, and M2 over its luminance for the variance
+                ++pixel.count;
+                float previousLuminance = glm::dot(pixel.mean, LUMINANCE_WEIGHTS);
+                pixel.mean += (rgb - pixel.mean) / static_cast<float>(pixel.count);
+                float luminance = glm::dot(rgb, LUMINANCE_WEIGHTS);
+                pixel.m2 += (luminance - previousLuminance) * (luminance - glm::dot(pixel.mean, LUMINANCE_WEIGHTS));
+            }
+
+            errorSum += DisplayError(pixel.mean, pixel.m2, pixel.count);
+        }
+    }
+
+    int pixelCount = (tile.endX - tile.startX) * (tile.endY - tile.startY);
+    state.samples += sampleCount;
+    state.error = errorSum / static_cast<float>((std::max)(1, pixelCount));
+    state.converged = state.samples >= settings.maxSamplesPerPixel ||
+                      (state.samples >= settings.minSamplesPerPixel && state.error <= settings.noiseTarget);
+    if (state.converged) {
+        ++convergedTiles;
+    }
+}
+
+void ProgressiveRenderer::PublishTile(const TileRenderer::Tile& tile)
+{
+    std::lock_guard<std::mutex> lock(displayMutex);
+    for (int y = tile.startY; y < tile.endY; ++y) {
+        size_t row = static_cast<size_t>(y) * settings.width;
+        for (int x = tile.startX; x < tile.endX; ++x) {
+            displayMean[row + x] = glm::vec4(stats[row + x].mean, 1.0f);
+        }
+    }
+    dirtyBegin = (std::min)(dirtyBegin, tile.startY);
+    dirtyEnd = (std::max)(dirtyEnd, tile.endY);
+}
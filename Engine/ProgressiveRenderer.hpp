@@ -0,0 +1,99 @@
+#pragma once
+#include "TileRenderer.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Progressive, adaptive front-end over TileRenderer. Samples go into a linear HDR buffer that
+// keeps each pixel's running mean and variance (Welford). After every pass the remaining noise
+// of each tile is estimated, and only tiles above the target get another batch of samples,
+// until all of them converge, the time budget runs out or Stop is called. The render runs on
+// a background thread; CopyMean hands the rows that changed to the display while it works.
+class ProgressiveRenderer {
+public:
+    struct Settings {
+        int width = 512;
+        int height = 512;
+        glm::mat4 cameraToWorld = glm::mat4(1.0f);
+        float fov = 45.0f;                // Vertical, degrees
+        int samplesPerPass = 4;           // Per pixel each time a tile is revisited; also the sampler's block size
+        int minSamplesPerPixel = 16;      // Taken by every tile before its variance is trusted
+        int maxSamplesPerPixel = 4096;
+        float noiseTarget = 0.004f;       // Standard error of the mean after Reinhard, about 1/255
+        float timeBudgetSeconds = 0.0f;   // 0 renders until every tile converges
+        int tileSize = 16;
+        unsigned threadCount = 0;         // 0 leaves one hardware thread to the render loop
+        Sampler::Type sampler = Sampler::Type::Sobol;
+        uint32_t seed = 0;
+    };
+
+    ProgressiveRenderer();
+    ~ProgressiveRenderer();
+
+    ProgressiveRenderer(const ProgressiveRenderer&) = delete;
+    ProgressiveRenderer& operator=(const ProgressiveRenderer&) = delete;
+
+    // Discards any previous accumulation and starts rendering in the background. The radiance
+    // function is copied, but whatever it references must live until Stop or the render ends.
+    bool Start(const TileRenderer::RadianceFunction& radiance, const Settings& settings);
+
+    // Cancels the current pass and waits for the workers; the accumulation is kept
+    void Stop();
+
+    bool IsRunning() const { return running; }
+    bool IsConverged() const { return converged; }
+    int GetPassCount() const { return passCount; }
+    float GetConvergedFraction() const;
+    double GetElapsedSeconds() const;
+
+    int GetWidth() const { return settings.width; }
+    int GetHeight() const { return settings.height; }
+
+    // Copies the mean of every row that changed since the last call into rgba, laid out as the
+    // whole image (width * height RGBA floats, top row first). Returns false when nothing changed.
+    // Meant for one consumer, the display, on any thread.
+    bool CopyMean(float* rgba, int& firstRow, int& rowCount);
+
+private:
+    struct PixelStats {
+        glm::vec3 mean;
+        float m2;           // Sum of squared luminance deviations
+        uint32_t count;
+    };
+
+    struct TileState {
+        TileRenderer::Tile tile;
+        int samples;
+        float error;
+        bool converged;
+    };
+
+    Settings settings;
+    TileRenderer::RadianceFunction radiance;
+    TileRenderer tileRenderer;
+
+    std::vector<PixelStats> stats;
+    std::vector<TileState> tileStates;
+
+    // Snapshot of the mean for the display, with the rows written since it last read
+    std::mutex displayMutex;
+    std::vector<glm::vec4> displayMean;
+    int dirtyBegin, dirtyEnd;
+
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<bool> stopRequested;
+    std::atomic<bool> converged;
+    std::atomic<int> passCount;
+    std::atomic<int> convergedTiles;
+    std::chrono::steady_clock::time_point startTime;
+    std::atomic<double> finishedSeconds;
+
+    void RenderLoop();
+    void RenderTileSamples(TileState& state, int sampleCount);
+    void PublishTile(const TileRenderer::Tile& tile);
+    bool OutOfTime() const;
+};
@@ -0,0 +1,333 @@
+#include "RGBToSpectrumTable.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+namespace {
+    const uint32_t RGB_TO_SPECTRUM_MAGIC = 0x43505352u; // "RSPC"
+    const uint32_t RGB_TO_SPECTRUM_VERSION = 1;
+
+    struct TableHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t resolution;
+        uint32_t padding;
+    };
+
+    const int FIT_SAMPLES = REFERENCE_SPECTRAL_SAMPLES;
+    const int MAX_ITERATIONS = 15;
+    const double MAX_COEFFICIENT = 200.0;
+
+    // The fit measures colour exactly as SampledSpectrum<60>::toRGB does, through the weight
+    // each reference sample carries into R, G and B
+    struct FitBasis {
+        double weights[3][FIT_SAMPLES];
+        double t[FIT_SAMPLES];
+    };
+
+    FitBasis MakeFitBasis()
+    {
+        using ReferenceSpectrum = SampledSpectrum<REFERENCE_SPECTRAL_SAMPLES>;
+        FitBasis basis;
+        for (int i = 0; i < FIT_SAMPLES; ++i) {
+            ReferenceSpectrum unit(0.0f);
+            unit[i] = 1.0f;
+            glm::vec3 rgb = unit.toRGB();
+            basis.weights[0][i] = rgb.r;
+            basis.weights[1][i] = rgb.g;
+            basis.weights[2][i] = rgb.b;
+            basis.t[i] = (ReferenceSpectrum::indexToWavelength(i) - LAMBDA_MIN) / (LAMBDA_MAX - LAMBDA_MIN);
+        }
+        return basis;
+    }
+
+    void EvaluateFit(const FitBasis& basis, const double c[3], double rgb[3])
+    {
+        rgb[0] = rgb[1] = rgb[2] = 0.0;
+        for (int i = 0; i < FIT_SAMPLES; ++i) {
+            double t = basis.t[i];
+            double x = (c[0] * t + c[1]) * t + c[2];
+            double s = 0.5 + x / (2.0 * std::sqrt(1.0 + x * x));
+            rgb[0] += basis.weights[0][i] * s;
+            rgb[1] += basis.weights[1][i] * s;
+            rgb[2] += basis.weights[2][i] * s;
+        }
+    }
+
+    // Solves a x = b by Cramer's rule; false when a is singular
+    bool Solve3x3(const double a[3][3], const double b[3], double x[3])
+    {
+        double det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+                     a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+                     a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+        if (std::abs(det) < 1e-15) {
+            return false;
+        }
+        for (int column = 0; column < 3; ++column) {
+            double m[3][3];
+            for (int r = 0; r < 3; ++r) {
+                for (int k = 0; k < 3; ++k) {
+                    m[r][k] = k == column ? b[r] : a[r][k];
+                }
+            }
+            x[column] = (m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                         m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                         m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0])) / det;
+        }
+        return true;
+    }
+
+    // Gauss-Newton on the linear RGB residual, starting from c (the neighbouring cell's
+    // solution, so the grid is walked outwards from a well-behaved brightness)
+    void FitCoefficients(const FitBasis& basis, const double target[3], double c[3])
+    {
+        const double STEP = 1e-5;
+
+        for (int iteration = 0; iteration < MAX_ITERATIONS; ++iteration) {
+            double current[3];
+            EvaluateFit(basis, c, current);
+            double residual[3] = { current[0] - target[0], current[1] - target[1], current[2] - target[2] };
+            if (residual[0] * residual[0] + residual[1] * residual[1] + residual[2] * residual[2] < 1e-12) {
+                break;
+            }
+
+            double jacobian[3][3];
+            for (int k = 0; k < 3; ++k) {
+                double shifted[3] = { c[0], c[1], c[2] };
+                shifted[k] += STEP;
+                double rgb[3];
+                EvaluateFit(basis, shifted, rgb);
+                for (int r = 0; r < 3; ++r) {
+                    jacobian[r][k] = (rgb[r] - current[r]) / STEP;
+                }
+            }
+
+            double delta[3];
+            if (!Solve3x3(jacobian, residual, delta)) {
+                break;
+            }
+            for (int k = 0; k < 3; ++k) {
+                c[k] -= delta[k];
+            }
+
+            // Colours outside what a reflectance can reach drive the sigmoid towards a step;
+            // capping the coefficients keeps those cells from running away
+            double largest = (std::max)(std::abs(c[0]), (std::max)(std::abs(c[1]), std::abs(c[2])));
+            if (largest > MAX_COEFFICIENT) {
+                for (int k = 0; k < 3; ++k) {
+                    c[k] *= MAX_COEFFICIENT / largest;
+                }
+            }
+        }
+    }
+
+    float SmoothStep(float x)
+    {
+        return x * x * (3.0f - 2.0f * x);
+    }
+
+    size_t CoefficientIndex(int channel, int z, int y, int x)
+    {
+        const size_t n = RGBToSpectrumTable::RESOLUTION;
+        return (((static_cast<size_t>(channel) * n + z) * n + y) * n + x) * 3;
+    }
+}
+
+std::once_flag RGBToSpectrumTable::ready;
+
+RGBToSpectrumTable::RGBToSpectrumTable()
+{
+    // Denser near black and near full brightness, where the fitted shapes change fastest
+    for (int i = 0; i < RESOLUTION; ++i) {
+        zNodes[i] = SmoothStep(SmoothStep(static_cast<float>(i) / (RESOLUTION - 1)));
+    }
+}
+
+RGBToSpectrumTable& RGBToSpectrumTable::Instance()
+{
+    static RGBToSpectrumTable table;
+    return table;
+}
+
+bool RGBToSpectrumTable::Initialize(const std::string& cachePath)
+{
+    bool ok = true;
+    std::call_once(ready, [&cachePath, &ok]() {
+        RGBToSpectrumTable& table = Instance();
+        if (table.Load(cachePath)) {
+            return;
+        }
+        table.Fit();
+        ok = table.Save(cachePath);
+    });
+    return ok;
+}
+
+const RGBToSpectrumTable& RGBToSpectrumTable::Get()
+{
+    std::call_once(ready, []() { Instance().Fit(); });
+    return Instance();
+}
+
+SigmoidPolynomial RGBToSpectrumTable::Lookup(const glm::vec3& color) const
+{
+    glm::vec3 rgb = glm::clamp(color, glm::vec3(0.0f), glm::vec3(1.0f));
+
+    // Greys are flat: the sigmoid of a constant
+    if (rgb.r == rgb.g && rgb.g == rgb.b) {
+        float v = rgb.r;
+        SigmoidPolynomial flat = { 0.0f, 0.0f, 0.0f };
+        flat.c2 = v <= 0.0f ? -std::numeric_limits<float>::infinity()
+                : v >= 1.0f ? std::numeric_limits<float>::infinity()
+                : (v - 0.5f) / std::sqrt(v * (1.0f - v));
+        return flat;
+    }
+
+    int channel = rgb.r > rgb.g ? (rgb.r > rgb.b ? 0 : 2) : (rgb.g > rgb.b ? 1 : 2);
+    float z = rgb[channel];
+    float x = rgb[(channel + 1) % 3] * (RESOLUTION - 1) / z;
+    float y = rgb[(channel + 2) % 3] * (RESOLUTION - 1) / z;
+
+    int xi = (std::min)(static_cast<int>(x), RESOLUTION - 2);
+    int yi = (std::min)(static_cast<int>(y), RESOLUTION - 2);
+    int zi = static_cast<int>(std::upper_bound(zNodes, zNodes + RESOLUTION, z) - zNodes) - 1;
+    zi = (std::max)(0, (std::min)(zi, RESOLUTION - 2));
+
+    float dx = x - xi;
+    float dy = y - yi;
+    float dz = (z - zNodes[zi]) / (zNodes[zi + 1] - zNodes[zi]);
+
+    float c[3];
+    for (int k = 0; k < 3; ++k) {
+        auto at = [&](int oz, int oy, int ox) { return coefficients[CoefficientIndex(channel, zi + oz, yi + oy, xi + ox) + k]; };
+        float x00 = at(0, 0, 0) + (at(0, 0, 1) - at(0, 0, 0)) * dx;
+        float x01 = at(0, 1, 0) + (at(0, 1, 1) - at(0, 1, 0)) * dx;
+        float x10 = at(1, 0, 0) + (at(1, 0, 1) - at(1, 0, 0)) * dx;
+        float x11 = at(1, 1, 0) + (at(1, 1, 1) - at(1, 1, 0)) * dx;
+        float y0 = x00 + (x01 - x00) * dy;
+        float y1 = x10 + (x11 - x10) * dy;
+        c[k] = y0 + (y1 - y0) * dz;
+    }
+
+    SigmoidPolynomial polynomial = { c[0], c[1], c[2] };
+    return polynomial;
+}
+
+bool RGBToSpectrumTable::Load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    TableHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != RGB_TO_SPECTRUM_MAGIC || header.version != RGB_TO_SPECTRUM_VERSION ||
+        header.resolution != RESOLUTION) {
+        std::cout << "RGB to spectrum: " << path << " is stale, refitting" << std::endl;
+        return false;
+    }
+
+    std::vector<float> loaded(CoefficientIndex(3, 0, 0, 0));
+    in.read(reinterpret_cast<char*>(loaded.data()), static_cast<std::streamsize>(loaded.size() * sizeof(float)));
+    if (!in) {
+        std::cerr << "RGB to spectrum: " << path << " is truncated, refitting" << std::endl;
+        return false;
+    }
+
+    coefficients.swap(loaded);
+    std::cout << "RGB to spectrum table loaded: " << path << std::endl;
+    return true;
+}
+
+bool RGBToSpectrumTable::Save(const std::string& path) const
+{
+    TableHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = RGB_TO_SPECTRUM_MAGIC;
+    header.version = RGB_TO_SPECTRUM_VERSION;
+    header.resolution = RESOLUTION;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "RGB to spectrum: cannot write cache " << path << std::endl;
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(coefficients.data()),
+              static_cast<std::streamsize>(coefficients.size() * sizeof(float)));
+    if (!out) {
+        std::cerr << "RGB to spectrum: failed while writing cache " << path << std::endl;
+        return false;
+    }
+
+    std::cout << "RGB to spectrum cache written: " << path << std::endl;
+    return true;
+}
+
+void RGBToSpectrumTable::Fit()
+{
+    auto startTime = std::chrono::steady_clock::now();
+    const FitBasis basis = MakeFitBasis();
+    coefficients.assign(CoefficientIndex(3, 0, 0, 0), 0.0f);
+
+    // Each (channel, y) row walks z outwards from a fifth of full brightness on its own
+    auto fitRow = [this, &basis](int row) {
+        int channel = row / RESOLUTION;
+        int yi = row % RESOLUTION;
+        float y = static_cast<float>(yi) / (RESOLUTION - 1);
+
+        for (int xi = 0; xi < RESOLUTION; ++xi) {
+            float x = static_cast<float>(xi) / (RESOLUTION - 1);
+            const int start = RESOLUTION / 5;
+
+            auto fitCell = [&](int zi, double c[3]) {
+                float z = zNodes[zi];
+                double target[3];
+                target[channel] = z;
+                target[(channel + 1) % 3] = x * z;
+                target[(channel + 2) % 3] = y * z;
+                FitCoefficients(basis, target, c);
+
+                size_t index = CoefficientIndex(channel, zi, yi, xi);
+                coefficients[index + 0] = static_cast<float>(c[0]);
+                coefficients[index + 1] = static_cast<float>(c[1]);
+                coefficients[index + 2] = static_cast<float>(c[2]);
+            };
+
+            double c[3] = { 0.0, 0.0, 0.0 };
+            for (int zi = start; zi < RESOLUTION; ++zi) {
+                fitCell(zi, c);
+            }
+            c[0] = c[1] = c[2] = 0.0;
+            for (int zi = start; zi >= 0; --zi) {
+                fitCell(zi, c);
+            }
+        }
+    };
+
+    const int rowCount = 3 * RESOLUTION;
+    unsigned threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threadCount; ++t) {
+        workers.emplace_back([&fitRow, t, threadCount, rowCount]() {
+            for (int row = static_cast<int>(t); row < rowCount; row += static_cast<int>(threadCount)) {
+                fitRow(row);
+            }
+        });
+    }
+    for (int row = 0; row < rowCount; row += static_cast<int>(threadCount)) {
+        fitRow(row);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "RGB to spectrum table fitted: " << RESOLUTION << "^3 x 3 in " << seconds << " s" << std::endl;
+}
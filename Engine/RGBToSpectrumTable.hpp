@@ -0,0 +1,55 @@
+#pragma once
+#include "Spectrum.hpp"
+#include <glm/glm.hpp>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Default location of the fitted table, relative to the working directory like shaders/
+const char* const RGB_TO_SPECTRUM_CACHE_PATH = "rgb_to_spectrum.bin";
+
+// Smooth spectrum from three coefficients (Jakob and Hanika 2019): a quadratic in wavelength
+// through a sigmoid, so fitted reflectances stay within [0, 1] at every wavelength
+struct SigmoidPolynomial {
+    float c0, c1, c2;   // Quadratic in t = (lambda - LAMBDA_MIN) / (LAMBDA_MAX - LAMBDA_MIN)
+
+    float operator()(float lambda) const
+    {
+        float t = (lambda - LAMBDA_MIN) / (LAMBDA_MAX - LAMBDA_MIN);
+        float x = (c0 * t + c1) * t + c2;
+        if (std::isinf(x)) {
+            return x > 0.0f ? 1.0f : 0.0f;
+        }
+        return 0.5f + x / (2.0f * std::sqrt(1.0f + x * x));
+    }
+};
+
+// What Spectrum::FromRGB uplifts colours with: sigmoid-polynomial coefficients fitted over a
+// 3 x RESOLUTION^3 grid of linear sRGB colours (one block per largest channel, brightness
+// spaced towards the ends) and interpolated trilinearly, so a conversion is one lookup plus a
+// sigmoid per sample. The fit takes a few seconds on every core; Initialize caches it on disk.
+class RGBToSpectrumTable {
+public:
+    static const int RESOLUTION = 64;
+
+    // Loads the table from cachePath, or fits it and writes it there. Call once at startup;
+    // without it, the first Get() fits the table and keeps it in memory only.
+    static bool Initialize(const std::string& cachePath = RGB_TO_SPECTRUM_CACHE_PATH);
+    static const RGBToSpectrumTable& Get();
+
+    // Components are clamped to [0, 1]; FromRGB scales brighter colours down first
+    SigmoidPolynomial Lookup(const glm::vec3& rgb) const;
+
+private:
+    float zNodes[RESOLUTION];
+    std::vector<float> coefficients;    // [largest channel][z][y][x][c0, c1, c2]
+
+    static RGBToSpectrumTable& Instance();
+    static std::once_flag ready;
+
+    RGBToSpectrumTable();
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+    void Fit();
+};
@@ -0,0 +1,55 @@
+#include "RenderQueue.hpp"
+#include "Mesh.hpp"
+#include <algorithm>
+#include <cstring>
+
+uint64_t RenderQueue::BuildSortKey(RenderPass pass, uint32_t programID, uint32_t materialID, float viewDepth)
+{
+    // Non-negative IEEE floats compare the same as their bit patterns
+    float depth = std::max(viewDepth, 0.0f);
+    uint32_t depthBits;
+    std::memcpy(&depthBits, &depth, sizeof(depthBits));
+    
+    // Transparent geometry has to be drawn back to front
+    if (pass == RenderPass::TRANSPARENT_PASS) {
+        depthBits = ~depthBits;
+    }
+    
+    return (static_cast<uint64_t>(pass) & 0xFull) << 60 |
+           (static_cast<uint64_t>(programID) & 0xFFFull) << 48 |
+           (static_cast<uint64_t>(materialID) & 0xFFFFull) << 32 |
+           static_cast<uint64_t>(depthBits);
+}
+
+void RenderQueue::Clear()
+{
+    items.clear();
+    transforms.clear();
+}
+
+uint32_t RenderQueue::AddTransform(const glm::mat4& model)
+{
+    transforms.push_back(model);
+    return static_cast<uint32_t>(transforms.size() - 1);
+}
+
+void RenderQueue::Submit(RenderPass pass, const Mesh* mesh, const SubMesh* subMesh, Material* material,
+                         uint32_t transformIndex, float viewDepth, GLsizei instanceCount, unsigned int lod)
+{
+    RenderItem item;
+    item.sortKey = BuildSortKey(pass, material->getShader().shaderProgram, material->getSortId(), viewDepth);
+    item.mesh = mesh;
+    item.subMesh = subMesh;
+    item.material = material;
+    item.transformIndex = transformIndex;
+    item.instanceCount = instanceCount;
+    item.lod = lod;
+    items.push_back(item);
+}
+
+void RenderQueue::Sort()
+{
+    std::sort(items.begin(), items.end(), [](const RenderItem& a, const RenderItem& b) {
+        return a.sortKey < b.sortKey;
+    });
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+class Mesh;
+class Material;
+struct SubMesh;
+
+enum class RenderPass : uint8_t {
+    OPAQUE_PASS = 0,
+    TRANSPARENT_PASS = 1
+};
+
+// One submesh draw. The key packs, from most to least significant:
+//   pass (4 bits) | shader program (12 bits) | material (16 bits) | depth (32 bits)
+// so sorting groups draws by program, then material, then distance.
+struct RenderItem {
+    uint64_t sortKey;
+    const Mesh* mesh;
+    const SubMesh* subMesh;
+    Material* material;
+    uint32_t transformIndex;
+    GLsizei instanceCount;
+    unsigned int lod;
+};
+
+class RenderQueue {
+private:
+    std::vector<RenderItem> items;
+    std::vector<glm::mat4> transforms;
+    
+public:
+    static uint64_t BuildSortKey(RenderPass pass, uint32_t programID, uint32_t materialID, float viewDepth);
+    
+    void Clear();
+    
+    // Transforms are stored once per object and shared by all of its submeshes
+    uint32_t AddTransform(const glm::mat4& model);
+    void Submit(RenderPass pass, const Mesh* mesh, const SubMesh* subMesh, Material* material,
+                uint32_t transformIndex, float viewDepth, GLsizei instanceCount = 1, unsigned int lod = 0);
+    void Sort();
+    
+    const std::vector<RenderItem>& GetItems() const { return items; }
+    const glm::mat4& GetTransform(uint32_t index) const { return transforms[index]; }
+    size_t Size() const { return items.size(); }
+};
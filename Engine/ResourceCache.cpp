@@ -0,0 +1,114 @@
+#include "ResourceCache.hpp"
+#include <iostream>
+#include <iomanip>
+
+ResourceCache::ResourceCache() : textureHits(0), textureMisses(0), shaderHits(0), shaderMisses(0)
+{
+}
+
+ResourceCache& ResourceCache::Get()
+{
+    static ResourceCache instance;
+    return instance;
+}
+
+std::string ResourceCache::makeShaderKey(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines)
+{
+    return vertexPath + "|" + fragmentPath + "|" + defines;
+}
+
+std::shared_ptr<Texture> ResourceCache::GetTexture(const std::string& path)
+{
+    auto it = textures.find(path);
+    if (it != textures.end()) {
+        if (std::shared_ptr<Texture> cached = it->second.lock()) {
+            ++textureHits;
+            return cached;
+        }
+    }
+
+    ++textureMisses;
+    auto texture = std::make_shared<Texture>();
+    texture->loadAsync(path);
+    textures[path] = texture;
+    return texture;
+}
+
+std::shared_ptr<Shader> ResourceCache::GetShader(const std::string& vertexPath, const std::string& fragmentPath,
+                                                 const std::string& defines)
+{
+    std::string key = makeShaderKey(vertexPath, fragmentPath, defines);
+    auto it = shaders.find(key);
+    if (it != shaders.end()) {
+        if (std::shared_ptr<Shader> cached = it->second.lock()) {
+            ++shaderHits;
+            return cached->isLinkFailed() ? nullptr : cached;
+        }
+    }
+
+    ++shaderMisses;
+    auto shader = std::make_shared<Shader>();
+    if (!shader->InitFromFiles(vertexPath, fragmentPath, defines)) {
+        return nullptr;
+    }
+    shaders[key] = shader;
+    return shader;
+}
+
+void ResourceCache::Prune()
+{
+    for (auto it = textures.begin(); it != textures.end();) {
+        it = it->second.expired() ? textures.erase(it) : std::next(it);
+    }
+    for (auto it = shaders.begin(); it != shaders.end();) {
+        it = it->second.expired() ? shaders.erase(it) : std::next(it);
+    }
+}
+
+size_t ResourceCache::GetTextureMemory() const
+{
+    size_t total = 0;
+    for (const auto& entry : textures) {
+        if (std::shared_ptr<Texture> texture = entry.second.lock()) {
+            total += texture->getMemorySize();
+        }
+    }
+    return total;
+}
+
+size_t ResourceCache::GetShaderMemory() const
+{
+    size_t total = 0;
+    for (const auto& entry : shaders) {
+        if (std::shared_ptr<Shader> shader = entry.second.lock()) {
+            total += shader->getProgramBinarySize();
+        }
+    }
+    return total;
+}
+
+void ResourceCache::PrintReport() const
+{
+    std::cout << "\n=== RESOURCE CACHE ===" << std::endl;
+
+    std::cout << "Textures (" << textureHits << " hits, " << textureMisses << " loads):" << std::endl;
+    for (const auto& entry : textures) {
+        std::shared_ptr<Texture> texture = entry.second.lock();
+        if (!texture) continue;
+        // lock() holds one extra reference for the duration of the report
+        std::cout << "  " << std::setw(8) << texture->getMemorySize() / 1024 << " KB  refs " << texture.use_count() - 1
+                  << "  " << texture->getWidth() << "x" << texture->getHeight()
+                  << (texture->isPending() ? " (streaming)" : "") << "  " << entry.first << std::endl;
+    }
+
+    std::cout << "Shaders (" << shaderHits << " hits, " << shaderMisses << " compiles):" << std::endl;
+    for (const auto& entry : shaders) {
+        std::shared_ptr<Shader> shader = entry.second.lock();
+        if (!shader) continue;
+        std::cout << "  " << std::setw(8) << shader->getProgramBinarySize() / 1024 << " KB  refs " << shader.use_count() - 1
+                  << "  program " << shader->shaderProgram << "  " << entry.first << std::endl;
+    }
+
+    std::cout << "Total: " << GetTextureMemory() / (1024 * 1024) << " MB textures, "
+              << GetShaderMemory() / 1024 << " KB programs" << std::endl;
+}
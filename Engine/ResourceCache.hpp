@@ -0,0 +1,43 @@
+#pragma once
+#include "Texture.hpp"
+#include "Shader.hpp"
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+// Hands out shared Texture and Shader objects keyed by path (plus defines for
+// shaders), so repeated requests reuse one GL object. The cache only holds weak
+// references: a resource is released when the last material drops it.
+class ResourceCache {
+private:
+    std::unordered_map<std::string, std::weak_ptr<Texture>> textures;
+    std::unordered_map<std::string, std::weak_ptr<Shader>> shaders;
+
+    size_t textureHits, textureMisses;
+    size_t shaderHits, shaderMisses;
+
+    ResourceCache();
+
+    static std::string makeShaderKey(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines);
+
+public:
+    static ResourceCache& Get();
+
+    // Textures load through Texture::loadAsync, so a miss returns a pending placeholder
+    std::shared_ptr<Texture> GetTexture(const std::string& path);
+
+    // Returns null when the program fails to compile; failures are not cached. Deferred links
+    // (Shader::BeginParallelCompile) report their errors later and are returned anyway, but an
+    // entry whose link has since failed is returned as null too.
+    std::shared_ptr<Shader> GetShader(const std::string& vertexPath, const std::string& fragmentPath,
+                                      const std::string& defines = std::string());
+
+    // Drops entries whose resources have already been released
+    void Prune();
+
+    size_t GetTextureMemory() const;
+    size_t GetShaderMemory() const;
+
+    // Per-resource path, reference count and size
+    void PrintReport() const;
+};
@@ -0,0 +1,527 @@
+#include "Sampler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+    const float ONE_MINUS_EPSILON = 0.99999994f;
+    const float UINT32_TO_UNIT = 2.3283064365386963e-10f; // 2^-32
+    const uint64_t PCG32_MULTIPLIER = 0x5851f42d4c957f2dULL;
+
+    // splitmix64's finaliser
+    uint64_t MixBits(uint64_t v)
+    {
+        v ^= v >> 31;
+        v *= 0x7fb5d329728ea185ULL;
+        v ^= v >> 27;
+        v *= 0x81dadef4bc2dd44dULL;
+        v ^= v >> 33;
+        return v;
+    }
+
+    uint64_t HashCombine(uint64_t hash, uint64_t value)
+    {
+        return MixBits(hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2)));
+    }
+
+    uint32_t ReverseBits32(uint32_t v)
+    {
+        v = (v << 16) | (v >> 16);
+        v = ((v & 0x00ff00ff) << 8) | ((v & 0xff00ff00) >> 8);
+        v = ((v & 0x0f0f0f0f) << 4) | ((v & 0xf0f0f0f0) >> 4);
+        v = ((v & 0x33333333) << 2) | ((v & 0xcccccccc) >> 2);
+        v = ((v & 0x55555555) << 1) | ((v & 0xaaaaaaaa) >> 1);
+        return v;
+    }
+
+    float ToUnitFloat(uint32_t v)
+    {
+        return (std::min)(v * UINT32_TO_UNIT, ONE_MINUS_EPSILON);
+    }
+
+    // Element i of a pseudo-random permutation of [0, length) picked by seed (Kensler 2013)
+    uint32_t PermutationElement(uint32_t i, uint32_t length, uint32_t seed)
+    {
+        uint32_t w = length - 1;
+        w |= w >> 1;
+        w |= w >> 2;
+        w |= w >> 4;
+        w |= w >> 8;
+        w |= w >> 16;
+        do {
+            i ^= seed;
+            i *= 0xe170893d;
+            i ^= seed >> 16;
+            i ^= (i & w) >> 4;
+            i ^= seed >> 8;
+            i *= 0x0929eb3f;
+            i ^= seed >> 23;
+            i ^= (i & w) >> 1;
+            i *= 1 | seed >> 27;
+            i *= 0x6935fa69;
+            i ^= (i & w) >> 11;
+            i *= 0x74dcb303;
+            i ^= (i & w) >> 2;
+            i *= 0x9e501cc3;
+            i ^= (i & w) >> 2;
+            i *= 0xc860a3df;
+            i &= w;
+            i ^= i >> 5;
+        } while (i >= length);
+        return (i + seed) % length;
+    }
+
+    // Shuffles sample indices within each run of samplesPerPixel, so samples past the
+    // nominal count (progressive rendering) still get distinct, well-spread indices
+    uint32_t ShuffledIndex(int sampleIndex, int samplesPerPixel, uint64_t hash)
+    {
+        uint32_t count = static_cast<uint32_t>((std::max)(1, samplesPerPixel));
+        uint32_t index = static_cast<uint32_t>(sampleIndex);
+        return index - index % count + PermutationElement(index % count, count, static_cast<uint32_t>(hash));
+    }
+
+    // The first two Sobol dimensions: van der Corput, and the one from polynomial x + 1
+    uint32_t SobolDimension0(uint32_t index)
+    {
+        return ReverseBits32(index);
+    }
+
+    uint32_t SobolDimension1(uint32_t index)
+    {
+        uint32_t result = 0;
+        for (uint32_t v = 1u << 31; index; index >>= 1, v ^= v >> 1) {
+            if (index & 1) result ^= v;
+        }
+        return result;
+    }
+
+    // Hash-based Owen scrambling (Laine-Karras, with Burley's and Vegdahl's constants): each
+    // bit is flipped depending only on the bits above it, which keeps the sequence's strata
+    uint32_t OwenScramble(uint32_t v, uint32_t seed)
+    {
+        v = ReverseBits32(v);
+        v ^= v * 0x3d20adea;
+        v += seed;
+        v *= (seed >> 16) | 1;
+        v ^= v * 0x05526c56;
+        v ^= v * 0x53a22864;
+        return ReverseBits32(v);
+    }
+
+    // Void-and-cluster (Ulichney 1993) on a torus: ranks every texel so that any threshold
+    // of the mask is a blue-noise point set
+    std::vector<float> GenerateBlueNoiseMask(int size)
+    {
+        const int count = size * size;
+        const float sigma = 1.5f;
+
+        std::vector<float> kernel(count);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                int dx = (std::min)(x, size - x);
+                int dy = (std::min)(y, size - y);
+                kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+            }
+        }
+
+        std::vector<uint8_t> pattern(count, 0);
+        std::vector<float> energy(count, 0.0f);
+        auto splat = [&](int index, float sign) {
+            int px = index % size;
+            int py = index / size;
+            for (int y = 0; y < size; ++y) {
+                const float* row = &kernel[((y - py + size) % size) * size];
+                for (int x = 0; x < size; ++x) {
+                    energy[y * size + x] += sign * row[(x - px + size) % size];
+                }
+            }
+        };
+        auto tightestCluster = [&]() {
+            int best = -1;
+            for (int i = 0; i < count; ++i) {
+                if (pattern[i] && (best < 0 || energy[i] > energy[best])) best = i;
+            }
+            return best;
+        };
+        auto largestVoid = [&]() {
+            int best = -1;
+            for (int i = 0; i < count; ++i) {
+                if (!pattern[i] && (best < 0 || energy[i] < energy[best])) best = i;
+            }
+            return best;
+        };
+
+        // Random initial points, relaxed by moving the tightest cluster into the largest void
+        // until that move would put the point back where it came from
+        int initialPoints = count / 10;
+        PCG32 rng(0x626c7565ULL, 0);
+        for (int placed = 0; placed < initialPoints;) {
+            int index = static_cast<int>(rng.NextUInt() % count);
+            if (!pattern[index]) {
+                pattern[index] = 1;
+                splat(index, 1.0f);
+                ++placed;
+            }
+        }
+        for (int iteration = 0; iteration < count; ++iteration) {
+            int cluster = tightestCluster();
+            pattern[cluster] = 0;
+            splat(cluster, -1.0f);
+            int hole = largestVoid();
+            pattern[hole] = 1;
+            splat(hole, 1.0f);
+            if (hole == cluster) break;
+        }
+
+        std::vector<int> ranks(count, 0);
+        std::vector<uint8_t> initialPattern = pattern;
+        std::vector<float> initialEnergy = energy;
+
+        // Ranks below the initial set: remove the tightest clusters one by one
+        for (int rank = initialPoints - 1; rank >= 0; --rank) {
+            int cluster = tightestCluster();
+            pattern[cluster] = 0;
+            splat(cluster, -1.0f);
+            ranks[cluster] = rank;
+        }
+
+        // Ranks above it: fill the largest voids. Past half full this selects the same texel
+        // as the tightest cluster of the minority zeros, so one loop covers both phases.
+        pattern = initialPattern;
+        energy = initialEnergy;
+        for (int rank = initialPoints; rank < count; ++rank) {
+            int hole = largestVoid();
+            pattern[hole] = 1;
+            splat(hole, 1.0f);
+            ranks[hole] = rank;
+        }
+
+        std::vector<float> mask(count);
+        for (int i = 0; i < count; ++i) {
+            mask[i] = (ranks[i] + 0.5f) / count;
+        }
+        return mask;
+    }
+
+    const std::vector<float>& BlueNoiseMask()
+    {
+        static const std::vector<float> mask = GenerateBlueNoiseMask(BlueNoiseSampler::MASK_SIZE);
+        return mask;
+    }
+}
+
+// Sampler
+
+Sampler::Sampler(int samplesPerPixel, uint32_t seed)
+    : samplesPerPixel((std::max)(1, samplesPerPixel)), seed(seed), pixel(0), sampleIndex(0), dimension(0)
+{
+}
+
+std::unique_ptr<Sampler> Sampler::Create(Type type, int samplesPerPixel, uint32_t seed)
+{
+    switch (type) {
+    case Type::Independent:
+        return std::unique_ptr<Sampler>(new IndependentSampler(samplesPerPixel, seed));
+    case Type::Stratified: {
+        // The squarest grid with at least samplesPerPixel strata
+        int xSamples = (std::max)(1, static_cast<int>(std::sqrt(static_cast<float>(samplesPerPixel))));
+        int ySamples = ((std::max)(1, samplesPerPixel) + xSamples - 1) / xSamples;
+        return std::unique_ptr<Sampler>(new StratifiedSampler(xSamples, ySamples, true, seed));
+    }
+    case Type::BlueNoise:
+        return std::unique_ptr<Sampler>(new BlueNoiseSampler(samplesPerPixel, seed));
+    case Type::Sobol:
+    default:
+        return std::unique_ptr<Sampler>(new SobolSampler(samplesPerPixel, seed));
+    }
+}
+
+void Sampler::StartPixelSample(const glm::ivec2& p, int index, int dim)
+{
+    pixel = p;
+    sampleIndex = index;
+    dimension = dim;
+}
+
+uint64_t Sampler::DimensionHash(int dim) const
+{
+    uint64_t hash = HashCombine(MixBits(seed), static_cast<uint32_t>(pixel.x));
+    hash = HashCombine(hash, static_cast<uint32_t>(pixel.y));
+    return HashCombine(hash, static_cast<uint32_t>(dim));
+}
+
+// PCG32
+
+void PCG32::SetSequence(uint64_t sequence, uint64_t offset)
+{
+    state = 0;
+    inc = (sequence << 1) | 1;
+    NextUInt();
+    state += offset;
+    NextUInt();
+}
+
+void PCG32::Advance(int64_t delta)
+{
+    // Jump ahead in O(log delta) (Brown 1994)
+    uint64_t currentMultiplier = PCG32_MULTIPLIER;
+    uint64_t currentIncrement = inc;
+    uint64_t accumulatedMultiplier = 1;
+    uint64_t accumulatedIncrement = 0;
+    uint64_t remaining = static_cast<uint64_t>(delta);
+    while (remaining > 0) {
+        if (remaining & 1) {
+            accumulatedMultiplier *= currentMultiplier;
+            accumulatedIncrement = accumulatedIncrement * currentMultiplier + currentIncrement;
+        }
+        currentIncrement = (currentMultiplier + 1) * currentIncrement;
+        currentMultiplier *= currentMultiplier;
+        remaining >>= 1;
+    }
+    state = accumulatedMultiplier * state + accumulatedIncrement;
+}
+
+uint32_t PCG32::NextUInt()
+{
+    uint64_t old = state;
+    state = old * PCG32_MULTIPLIER + inc;
+    uint32_t xorShifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+    uint32_t rotation = static_cast<uint32_t>(old >> 59);
+    return (xorShifted >> rotation) | (xorShifted << ((~rotation + 1) & 31));
+}
+
+float PCG32::NextFloat()
+{
+    return ToUnitFloat(NextUInt());
+}
+
+// IndependentSampler
+
+IndependentSampler::IndependentSampler(int samplesPerPixel, uint32_t seed) : Sampler(samplesPerPixel, seed)
+{
+}
+
+void IndependentSampler::StartPixelSample(const glm::ivec2& p, int index, int dim)
+{
+    Sampler::StartPixelSample(p, index, dim);
+    // One stream per pixel; each sample starts 2^16 draws further along it
+    rng.SetSequence(DimensionHash(0), MixBits(seed));
+    rng.Advance(static_cast<int64_t>(index) * 65536 + dim);
+}
+
+float IndependentSampler::Get1D()
+{
+    ++dimension;
+    return rng.NextFloat();
+}
+
+glm::vec2 IndependentSampler::Get2D()
+{
+    dimension += 2;
+    float x = rng.NextFloat();
+    float y = rng.NextFloat();
+    return glm::vec2(x, y);
+}
+
+std::unique_ptr<Sampler> IndependentSampler::Clone() const
+{
+    return std::unique_ptr<Sampler>(new IndependentSampler(*this));
+}
+
+// StratifiedSampler
+
+StratifiedSampler::StratifiedSampler(int xSamples, int ySamples, bool jitter, uint32_t seed)
+    : Sampler((std::max)(1, xSamples) * (std::max)(1, ySamples), seed),
+      xSamples((std::max)(1, xSamples)), ySamples((std::max)(1, ySamples)), jitter(jitter)
+{
+}
+
+void StratifiedSampler::StartPixelSample(const glm::ivec2& p, int index, int dim)
+{
+    Sampler::StartPixelSample(p, index, dim);
+    rng.SetSequence(DimensionHash(0), MixBits(seed));
+    rng.Advance(static_cast<int64_t>(index) * 65536 + dim);
+}
+
+float StratifiedSampler::Get1D()
+{
+    uint32_t stratum = ShuffledIndex(sampleIndex, samplesPerPixel, DimensionHash(dimension)) % samplesPerPixel;
+    ++dimension;
+    float delta = jitter ? rng.NextFloat() : 0.5f;
+    return (std::min)((stratum + delta) / samplesPerPixel, ONE_MINUS_EPSILON);
+}
+
+glm::vec2 StratifiedSampler::Get2D()
+{
+    uint32_t stratum = ShuffledIndex(sampleIndex, samplesPerPixel, DimensionHash(dimension)) % samplesPerPixel;
+    dimension += 2;
+    int x = stratum % xSamples;
+    int y = stratum / xSamples;
+    float dx = jitter ? rng.NextFloat() : 0.5f;
+    float dy = jitter ? rng.NextFloat() : 0.5f;
+    return glm::vec2((std::min)((x + dx) / xSamples, ONE_MINUS_EPSILON),
+                     (std::min)((y + dy) / ySamples, ONE_MINUS_EPSILON));
+}
+
+std::unique_ptr<Sampler> StratifiedSampler::Clone() const
+{
+    return std::unique_ptr<Sampler>(new StratifiedSampler(*this));
+}
+
+// SobolSampler
+
+SobolSampler::SobolSampler(int samplesPerPixel, uint32_t seed) : Sampler(samplesPerPixel, seed)
+{
+}
+
+float SobolSampler::Get1D()
+{
+    uint64_t hash = DimensionHash(dimension);
+    ++dimension;
+    uint32_t index = ShuffledIndex(sampleIndex, samplesPerPixel, hash);
+    return ToUnitFloat(OwenScramble(SobolDimension0(index), static_cast<uint32_t>(hash >> 32)));
+}
+
+glm::vec2 SobolSampler::Get2D()
+{
+    uint64_t hash = DimensionHash(dimension);
+    dimension += 2;
+    uint32_t index = ShuffledIndex(sampleIndex, samplesPerPixel, hash);
+    uint64_t scrambleSeeds = MixBits(hash);
+    return glm::vec2(ToUnitFloat(OwenScramble(SobolDimension0(index), static_cast<uint32_t>(scrambleSeeds))),
+                     ToUnitFloat(OwenScramble(SobolDimension1(index), static_cast<uint32_t>(scrambleSeeds >> 32))));
+}
+
+std::unique_ptr<Sampler> SobolSampler::Clone() const
+{
+    return std::unique_ptr<Sampler>(new SobolSampler(*this));
+}
+
+// BlueNoiseSampler
+
+BlueNoiseSampler::BlueNoiseSampler(int samplesPerPixel, uint32_t seed) : Sampler(samplesPerPixel, seed)
+{
+    // Build the mask now rather than inside the first worker to ask for it
+    BlueNoiseMask();
+}
+
+float BlueNoiseSampler::MaskValue(uint64_t hash) const
+{
+    // Every dimension reads the mask at its own toroidal offset, so dimensions decorrelate
+    // while neighbouring pixels keep the blue-noise relationship
+    const unsigned wrap = MASK_SIZE - 1;
+    unsigned x = (static_cast<unsigned>(pixel.x) + static_cast<unsigned>(hash)) & wrap;
+    unsigned y = (static_cast<unsigned>(pixel.y) + static_cast<unsigned>(hash >> 16)) & wrap;
+    return BlueNoiseMask()[y * MASK_SIZE + x];
+}
+
+float BlueNoiseSampler::Get1D()
+{
+    // Seed-only hash: the offsets must not vary per pixel, or the mask's structure is lost
+    uint64_t hash = HashCombine(MixBits(seed), static_cast<uint32_t>(dimension));
+    ++dimension;
+    double value = MaskValue(hash) + sampleIndex * 0.6180339887498949;
+    return (std::min)(static_cast<float>(value - std::floor(value)), ONE_MINUS_EPSILON);
+}
+
+glm::vec2 BlueNoiseSampler::Get2D()
+{
+    // R2 lattice (Roberts 2018), the 2D analogue of the golden-ratio sequence
+    uint64_t hash = HashCombine(MixBits(seed), static_cast<uint32_t>(dimension));
+    dimension += 2;
+    double x = MaskValue(hash) + sampleIndex * 0.7548776662466927;
+    double y = MaskValue(MixBits(hash)) + sampleIndex * 0.5698402909980532;
+    return glm::vec2((std::min)(static_cast<float>(x - std::floor(x)), ONE_MINUS_EPSILON),
+                     (std::min)(static_cast<float>(y - std::floor(y)), ONE_MINUS_EPSILON));
+}
+
+std::unique_ptr<Sampler> BlueNoiseSampler::Clone() const
+{
+    return std::unique_ptr<Sampler>(new BlueNoiseSampler(*this));
+}
+
+// MLTSampler
+
+MLTSampler::MLTSampler(uint64_t sequenceIndex, float sigma, float largeStepProbability, uint32_t seed)
+    : Sampler(1, seed), rng(sequenceIndex, MixBits(seed)), sigma(sigma), largeStepProbability(largeStepProbability),
+      currentIteration(0), lastLargeStepIteration(0), largeStep(true)
+{
+}
+
+void MLTSampler::StartIteration()
+{
+    ++currentIteration;
+    largeStep = rng.NextFloat() < largeStepProbability;
+    dimension = 0;
+}
+
+void MLTSampler::Accept()
+{
+    if (largeStep) {
+        lastLargeStepIteration = currentIteration;
+    }
+}
+
+void MLTSampler::Reject()
+{
+    for (PrimarySample& sample : samples) {
+        if (sample.lastModification == currentIteration) {
+            sample.value = sample.valueBackup;
+            sample.lastModification = sample.modificationBackup;
+        }
+    }
+    --currentIteration;
+}
+
+void MLTSampler::Reseed(uint64_t sequenceIndex)
+{
+    rng.SetSequence(sequenceIndex, MixBits(seed));
+}
+
+void MLTSampler::EnsureReady(int index)
+{
+    if (index >= static_cast<int>(samples.size())) {
+        samples.resize(index + 1);
+    }
+    PrimarySample& sample = samples[index];
+
+    // Not read since the last accepted large step, which would have redrawn it
+    if (sample.lastModification < lastLargeStepIteration) {
+        sample.value = rng.NextFloat();
+        sample.lastModification = lastLargeStepIteration;
+    }
+
+    sample.valueBackup = sample.value;
+    sample.modificationBackup = sample.lastModification;
+    if (largeStep) {
+        sample.value = rng.NextFloat();
+    } else {
+        // Every small step it missed, applied at once: their sum is one wider Gaussian
+        int64_t smallSteps = currentIteration - sample.lastModification;
+        float effectiveSigma = sigma * std::sqrt(static_cast<float>(smallSteps));
+        float u1 = 1.0f - rng.NextFloat();
+        float u2 = rng.NextFloat();
+        float normal = std::sqrt(-2.0f * std::log(u1)) * std::cos(6.28318531f * u2);
+        sample.value += normal * effectiveSigma;
+        sample.value -= std::floor(sample.value);
+    }
+    sample.lastModification = currentIteration;
+}
+
+float MLTSampler::Get1D()
+{
+    EnsureReady(dimension);
+    return (std::min)(samples[dimension++].value, ONE_MINUS_EPSILON);
+}
+
+glm::vec2 MLTSampler::Get2D()
+{
+    float x = Get1D();
+    float y = Get1D();
+    return glm::vec2(x, y);
+}
+
+std::unique_ptr<Sampler> MLTSampler::Clone() const
+{
+    return std::unique_ptr<Sampler>(new MLTSampler(*this));
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Sample generators for the offline integrators. A sampler is positioned on one sample of one
+// pixel with StartPixelSample, then hands out the dimensions of that sample in the order the
+// integrator consumes them. Values depend only on (seed, pixel, sample index, dimension), so
+// an image does not change with the tiling or the thread a pixel lands on.
+class Sampler {
+public:
+    enum class Type {
+        Independent,  // Uniform random; the baseline the others are compared against
+        Stratified,   // Jittered strata per dimension, shuffled independently
+        Sobol,        // Owen-scrambled (0,2)-sequence pairs; best with power-of-two spp
+        BlueNoise     // Rank-1 lattice shifted per pixel by a blue-noise mask
+    };
+
+    virtual ~Sampler() = default;
+
+    static std::unique_ptr<Sampler> Create(Type type, int samplesPerPixel, uint32_t seed = 0);
+
+    virtual void StartPixelSample(const glm::ivec2& pixel, int sampleIndex, int dimension = 0);
+    virtual float Get1D() = 0;
+    virtual glm::vec2 Get2D() = 0;
+
+    // Samplers hold per-sample state, so each worker thread needs its own
+    virtual std::unique_ptr<Sampler> Clone() const = 0;
+
+    int SamplesPerPixel() const { return samplesPerPixel; }
+
+    // Next dimension to be handed out; with the pixel and sample index it is enough to resume
+    // a sample later through StartPixelSample
+    int GetDimension() const { return dimension; }
+
+protected:
+    Sampler(int samplesPerPixel, uint32_t seed);
+
+    int samplesPerPixel;
+    uint32_t seed;
+
+    glm::ivec2 pixel;
+    int sampleIndex;
+    int dimension;
+
+    // Hash of the current pixel, the seed and a dimension; independent for every dimension
+    uint64_t DimensionHash(int dim) const;
+};
+
+// PCG32 (O'Neill 2014): small state, and Advance lets a sample start anywhere in a stream
+class PCG32 {
+public:
+    PCG32() : state(0x853c49e6748fea9bULL), inc(0xda3e39cb94b95bdbULL) {}
+    PCG32(uint64_t sequence, uint64_t offset) { SetSequence(sequence, offset); }
+
+    void SetSequence(uint64_t sequence, uint64_t offset);
+    void Advance(int64_t delta);
+
+    uint32_t NextUInt();
+    float NextFloat();
+
+private:
+    uint64_t state;
+    uint64_t inc;
+};
+
+class IndependentSampler : public Sampler {
+public:
+    IndependentSampler(int samplesPerPixel, uint32_t seed = 0);
+
+    void StartPixelSample(const glm::ivec2& pixel, int sampleIndex, int dimension = 0) override;
+    float Get1D() override;
+    glm::vec2 Get2D() override;
+    std::unique_ptr<Sampler> Clone() const override;
+
+private:
+    PCG32 rng;
+};
+
+class StratifiedSampler : public Sampler {
+public:
+    // Strata are a grid of xSamples * ySamples; 2D dimensions use the grid, 1D its count
+    StratifiedSampler(int xSamples, int ySamples, bool jitter = true, uint32_t seed = 0);
+
+    void StartPixelSample(const glm::ivec2& pixel, int sampleIndex, int dimension = 0) override;
+    float Get1D() override;
+    glm::vec2 Get2D() override;
+    std::unique_ptr<Sampler> Clone() const override;
+
+private:
+    int xSamples, ySamples;
+    bool jitter;
+    PCG32 rng;
+};
+
+// Padded Sobol: every dimension (or pair) draws from the first two Sobol dimensions with its
+// own index shuffle and Owen scramble, so it stays well stratified at any depth
+class SobolSampler : public Sampler {
+public:
+    SobolSampler(int samplesPerPixel, uint32_t seed = 0);
+
+    float Get1D() override;
+    glm::vec2 Get2D() override;
+    std::unique_ptr<Sampler> Clone() const override;
+};
+
+// Georgiev and Fajardo's blue-noise dithered sampling: a rank-1 lattice over the samples of a
+// pixel, offset by a tiled blue-noise mask, so the remaining error is spread at high spatial
+// frequencies that read as finer grain at low spp
+class BlueNoiseSampler : public Sampler {
+public:
+    BlueNoiseSampler(int samplesPerPixel, uint32_t seed = 0);
+
+    float Get1D() override;
+    glm::vec2 Get2D() override;
+    std::unique_ptr<Sampler> Clone() const override;
+
+    static constexpr int MASK_SIZE = 64;
+
+private:
+    float MaskValue(uint64_t hash) const;
+};
+
+// Primary sample space for Metropolis light transport (Kelemen et al. 2002). Every dimension is
+// a value in [0, 1) that each iteration mutates in place: a large step draws it afresh, a small
+// step perturbs it by a Gaussian and wraps it around. Values are only touched when a proposal
+// reads them, and Reject restores exactly those, so a proposal never copies the sample vector.
+class MLTSampler : public Sampler {
+public:
+    MLTSampler(uint64_t sequenceIndex, float sigma, float largeStepProbability, uint32_t seed = 0);
+
+    // Begins the next proposal at dimension 0 and decides whether it is a large step
+    void StartIteration();
+    void Accept();
+    void Reject();
+
+    // Moves mutations onto another random stream, so chains started from the same bootstrap
+    // path still diverge
+    void Reseed(uint64_t sequenceIndex);
+
+    float Get1D() override;
+    glm::vec2 Get2D() override;
+    std::unique_ptr<Sampler> Clone() const override;
+
+private:
+    struct PrimarySample {
+        float value = 0.0f;
+        float valueBackup = 0.0f;
+        int64_t lastModification = 0;
+        int64_t modificationBackup = 0;
+    };
+
+    PCG32 rng;
+    float sigma;
+    float largeStepProbability;
+    std::vector<PrimarySample> samples;
+    int64_t currentIteration;
+    int64_t lastLargeStepIteration;
+    bool largeStep;
+
+    void EnsureReady(int index);
+};
@@ -1,6 +1,8 @@
 #include "Shader.hpp"
+#include "ProgramBinaryCache.hpp"
+#include <algorithm>
 
-Shader::Shader() : vertexShader(0), fragmentShader(0), shaderProgram(0)
+Shader::Shader() : linkPending(false), binaryKey(0), hasFrameData(false), hasLightData(false), shaderProgram(0)
 {
 }
 
@@ -9,42 +11,260 @@ Shader::~Shader()
     cleanup();
 }
 
-bool Shader::Init(const char* vertexSource, const char* fragmentSource)
+bool Shader::deferLinks = false;
+
+std::vector<Shader*>& Shader::PendingLinks()
 {
-    cleanup();
-    
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexSource, nullptr);
-    glCompileShader(vertexShader);
-    if (!checkCompileErrors(vertexShader, "VERTEX")) {
-        return false;
+    static std::vector<Shader*> pending;
+    return pending;
+}
+
+namespace {
+    const char* StageName(GLenum stage)
+    {
+        switch (stage) {
+            case GL_VERTEX_SHADER: return "VERTEX";
+            case GL_GEOMETRY_SHADER: return "GEOMETRY";
+            case GL_FRAGMENT_SHADER: return "FRAGMENT";
+            case GL_COMPUTE_SHADER: return "COMPUTE";
+            default: return "UNKNOWN";
+        }
     }
+}
 
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentSource, nullptr);
-    glCompileShader(fragmentShader);
-    if (!checkCompileErrors(fragmentShader, "FRAGMENT")) {
+bool Shader::Init(const char* vertexSource, const char* fragmentSource, const char* geometrySource)
+{
+    if (geometrySource) {
+        const GLenum stages[] = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER };
+        const char* sources[] = { vertexSource, geometrySource, fragmentSource };
+        return buildProgram(stages, sources, 3);
+    }
+    const GLenum stages[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    const char* sources[] = { vertexSource, fragmentSource };
+    return buildProgram(stages, sources, 2);
+}
+
+bool Shader::InitCompute(const char* computeSource)
+{
+    cleanup();
+    
+    if (!IsComputeSupported()) {
+        std::cerr << "ERROR::SHADER::COMPUTE_NOT_SUPPORTED" << std::endl;
         return false;
     }
+    
+    const GLenum stage = GL_COMPUTE_SHADER;
+    return buildProgram(&stage, &computeSource, 1);
+}
 
+bool Shader::buildProgram(const GLenum* stages, const char* const* sources, int stageCount)
+{
+    cleanup();
+    
+    ProgramBinaryCache& binaryCache = ProgramBinaryCache::Get();
+    binaryKey = binaryCache.IsEnabled() ? binaryCache.MakeKey(stages, sources, stageCount) : 0;
+    
     shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
+    if (binaryKey && binaryCache.Load(binaryKey, shaderProgram)) {
+        reflectUniforms();
+        bindUniformBlocks();
+        return true;
+    }
+    if (binaryKey) {
+        // A rejected binary can leave the program unusable; compile into a fresh one
+        glDeleteProgram(shaderProgram);
+        shaderProgram = glCreateProgram();
+    }
+    
+    for (int i = 0; i < stageCount; ++i) {
+        GLuint shader = glCreateShader(stages[i]);
+        glShaderSource(shader, 1, &sources[i], nullptr);
+        glCompileShader(shader);
+        pendingStages.push_back(shader);
+        
+        // Deferred compiles are checked once the link is done, so nothing here waits on them
+        if (!deferLinks && !checkCompileErrors(shader, StageName(stages[i]))) {
+            cleanup();
+            return false;
+        }
+        glAttachShader(shaderProgram, shader);
+    }
+    
+    if (binaryKey) {
+        glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(shaderProgram);
-    if (!checkCompileErrors(shaderProgram, "PROGRAM")) {
+    linkPending = true;
+    
+    if (deferLinks) {
+        PendingLinks().push_back(this);
+        return true;
+    }
+    return finishLink();
+}
+
+bool Shader::finishLink() const
+{
+    if (!linkPending) {
+        return shaderProgram != 0;
+    }
+    linkPending = false;
+    
+    std::vector<Shader*>& pending = PendingLinks();
+    pending.erase(std::remove(pending.begin(), pending.end(), this), pending.end());
+    
+    GLint linked = GL_FALSE;
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        // Compile logs explain most link failures, so report those first
+        for (GLuint shader : pendingStages) {
+            GLint type = 0;
+            glGetShaderiv(shader, GL_SHADER_TYPE, &type);
+            checkCompileErrors(shader, StageName(static_cast<GLenum>(type)));
+        }
+        checkCompileErrors(shaderProgram, "PROGRAM");
+    }
+    
+    for (GLuint shader : pendingStages) {
+        glDeleteShader(shader);
+    }
+    pendingStages.clear();
+    
+    if (!linked) {
+        // Callers check shaderProgram, so a program that cannot be used must not look valid
+        glDeleteProgram(shaderProgram);
+        shaderProgram = 0;
         return false;
     }
+    
+    reflectUniforms();
+    bindUniformBlocks();
+    if (binaryKey) {
+        ProgramBinaryCache::Get().Store(binaryKey, shaderProgram);
+    }
+    
+    return true;
+}
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    vertexShader = 0;
-    fragmentShader = 0;
+void Shader::BeginParallelCompile()
+{
+    if (!IsParallelCompileSupported()) return;
+    
+    // Let the driver pick how many compiler threads to use
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+    } else {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+    }
+    deferLinks = true;
+}
 
-    return true;
+size_t Shader::FinishPendingLinks()
+{
+    deferLinks = false;
+    
+    // finishLink removes each shader from the list
+    std::vector<Shader*> pending = PendingLinks();
+    size_t failed = 0;
+    for (Shader* shader : pending) {
+        if (!shader->finishLink()) {
+            ++failed;
+        }
+    }
+    return failed;
+}
+
+void Shader::reflectUniforms() const
+{
+    uniformLocations.clear();
+    
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    
+    std::vector<GLchar> nameBuffer(static_cast<size_t>(maxNameLength) + 1);
+    for (GLint i = 0; i < uniformCount; ++i) {
+        GLsizei nameLength = 0;
+        GLint arraySize = 0;
+        GLenum type = 0;
+        glGetActiveUniform(shaderProgram, static_cast<GLuint>(i), static_cast<GLsizei>(nameBuffer.size()),
+                           &nameLength, &arraySize, &type, nameBuffer.data());
+        
+        std::string name(nameBuffer.data(), nameLength);
+        GLint location = glGetUniformLocation(shaderProgram, name.c_str());
+        if (location == -1) continue; // Uniform block members have no location
+        
+        uniformLocations[HashUniformName(name.c_str())] = location;
+        
+        // Arrays are reported once as "name[0]"; register the bare name and every element
+        const std::string firstElement = "[0]";
+        if (name.size() > firstElement.size() &&
+            name.compare(name.size() - firstElement.size(), firstElement.size(), firstElement) == 0) {
+            std::string baseName = name.substr(0, name.size() - firstElement.size());
+            uniformLocations[HashUniformName(baseName.c_str())] = location;
+            
+            for (GLint element = 1; element < arraySize; ++element) {
+                std::string elementName = baseName + "[" + std::to_string(element) + "]";
+                GLint elementLocation = glGetUniformLocation(shaderProgram, elementName.c_str());
+                if (elementLocation != -1) {
+                    uniformLocations[HashUniformName(elementName.c_str())] = elementLocation;
+                }
+            }
+        }
+    }
+}
+
+void Shader::bindUniformBlocks() const
+{
+    GLuint frameDataIndex = glGetUniformBlockIndex(shaderProgram, "FrameData");
+    hasFrameData = frameDataIndex != GL_INVALID_INDEX;
+    if (hasFrameData) {
+        glUniformBlockBinding(shaderProgram, frameDataIndex, FRAME_DATA_BINDING);
+    }
+    
+    GLuint lightDataIndex = glGetUniformBlockIndex(shaderProgram, "LightData");
+    hasLightData = lightDataIndex != GL_INVALID_INDEX;
+    if (hasLightData) {
+        glUniformBlockBinding(shaderProgram, lightDataIndex, LIGHT_DATA_BINDING);
+    }
+    
+    GLuint shadowDataIndex = glGetUniformBlockIndex(shaderProgram, "ShadowData");
+    if (shadowDataIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shaderProgram, shadowDataIndex, SHADOW_DATA_BINDING);
+    }
+    
+    GLuint iblDataIndex = glGetUniformBlockIndex(shaderProgram, "IBLData");
+    if (iblDataIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shaderProgram, iblDataIndex, IBL_DATA_BINDING);
+    }
+    
+    // Storage blocks need GL 4.3; programs that declare them cannot link without it anyway
+    if (!GLEW_VERSION_4_3 && !GLEW_ARB_program_interface_query) return;
+    
+    const struct { const char* name; GLuint binding; } storageBlocks[] = {
+        { "ClusterLights", CLUSTER_LIGHTS_BINDING },
+        { "ClusterGrid", CLUSTER_GRID_BINDING },
+        { "ClusterLightIndices", CLUSTER_INDICES_BINDING }
+    };
+    for (const auto& block : storageBlocks) {
+        GLuint index = glGetProgramResourceIndex(shaderProgram, GL_SHADER_STORAGE_BLOCK, block.name);
+        if (index != GL_INVALID_INDEX) {
+            glShaderStorageBlockBinding(shaderProgram, index, block.binding);
+        }
+    }
+}
+
+GLint Shader::getUniformLocation(uint32_t nameHash) const
+{
+    finishLink();
+    auto it = uniformLocations.find(nameHash);
+    return it != uniformLocations.end() ? it->second : -1;
 }
 
 void Shader::use() const
 {
+    finishLink();
     if (shaderProgram) {
         glUseProgram(shaderProgram);
     }
@@ -52,18 +272,22 @@ void Shader::use() const
 
 void Shader::cleanup()
 {
-    if (vertexShader) {
-        glDeleteShader(vertexShader);
-        vertexShader = 0;
+    if (linkPending) {
+        std::vector<Shader*>& pending = PendingLinks();
+        pending.erase(std::remove(pending.begin(), pending.end(), this), pending.end());
+        linkPending = false;
     }
-    if (fragmentShader) {
-        glDeleteShader(fragmentShader);
-        fragmentShader = 0;
+    for (GLuint shader : pendingStages) {
+        glDeleteShader(shader);
     }
+    pendingStages.clear();
     if (shaderProgram) {
         glDeleteProgram(shaderProgram);
         shaderProgram = 0;
     }
+    uniformLocations.clear();
+    hasFrameData = false;
+    hasLightData = false;
 }
 
 std::string Shader::loadShaderFromFile(const std::string& filePath)
@@ -88,6 +312,10 @@ std::string Shader::loadShaderFromFile(const std::string& filePath)
         // Convert stream into string
         shaderCode = shaderStream.str();
         
+        size_t lastSlash = filePath.find_last_of("/\\");
+        std::string directory = lastSlash != std::string::npos ? filePath.substr(0, lastSlash + 1) : std::string();
+        shaderCode = resolveIncludes(shaderCode, directory);
+        
         std::cout << "Successfully loaded shader: " << filePath << std::endl;
     }
     catch (std::ifstream::failure& e) {
@@ -98,7 +326,64 @@ std::string Shader::loadShaderFromFile(const std::string& filePath)
     return shaderCode;
 }
 
-bool Shader::InitFromFiles(const std::string& vertexPath, const std::string& fragmentPath)
+// Expands '#include "file"' lines, resolved relative to the including file.
+// GLSL has no include support of its own; this is only used for shared declarations.
+std::string Shader::resolveIncludes(const std::string& source, const std::string& directory)
+{
+    const std::string directive = "#include";
+    if (source.find(directive) == std::string::npos) {
+        return source;
+    }
+    
+    std::stringstream input(source);
+    std::stringstream output;
+    std::string line;
+    while (std::getline(input, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos && line.compare(start, directive.size(), directive) == 0) {
+            size_t open = line.find('"', start + directive.size());
+            size_t close = open != std::string::npos ? line.find('"', open + 1) : std::string::npos;
+            if (close != std::string::npos) {
+                output << loadShaderFromFile(directory + line.substr(open + 1, close - open - 1)) << "\n";
+                continue;
+            }
+            std::cerr << "ERROR::SHADER::MALFORMED_INCLUDE: " << line << std::endl;
+        }
+        output << line << "\n";
+    }
+    
+    return output.str();
+}
+
+std::string Shader::injectDefines(const std::string& source, const std::string& defines)
+{
+    if (defines.empty()) {
+        return source;
+    }
+    
+    std::string block;
+    std::stringstream list(defines);
+    std::string define;
+    while (std::getline(list, define, ';')) {
+        if (define.empty()) continue;
+        size_t equals = define.find('=');
+        if (equals == std::string::npos) {
+            block += "#define " + define + "\n";
+        } else {
+            block += "#define " + define.substr(0, equals) + " " + define.substr(equals + 1) + "\n";
+        }
+    }
+    
+    // #version has to stay the first statement
+    size_t versionLine = source.find("#version");
+    size_t insertAt = versionLine != std::string::npos ? source.find('\n', versionLine) : std::string::npos;
+    if (insertAt == std::string::npos) {
+        return block + source;
+    }
+    return source.substr(0, insertAt + 1) + block + source.substr(insertAt + 1);
+}
+
+bool Shader::InitFromFiles(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines)
 {
     std::string vertexCode = loadShaderFromFile(vertexPath);
     std::string fragmentCode = loadShaderFromFile(fragmentPath);
@@ -108,10 +393,54 @@ bool Shader::InitFromFiles(const std::string& vertexPath, const std::string& fra
         return false;
     }
     
+    vertexCode = injectDefines(vertexCode, defines);
+    fragmentCode = injectDefines(fragmentCode, defines);
+    
     return Init(vertexCode.c_str(), fragmentCode.c_str());
 }
 
-bool Shader::checkCompileErrors(GLuint shader, const std::string& type)
+bool Shader::InitFromFiles(const std::string& vertexPath, const std::string& geometryPath, const std::string& fragmentPath,
+                           const std::string& defines)
+{
+    std::string vertexCode = loadShaderFromFile(vertexPath);
+    std::string geometryCode = loadShaderFromFile(geometryPath);
+    std::string fragmentCode = loadShaderFromFile(fragmentPath);
+    
+    if (vertexCode.empty() || geometryCode.empty() || fragmentCode.empty()) {
+        std::cerr << "ERROR::SHADER::FAILED_TO_LOAD_SHADER_FILES" << std::endl;
+        return false;
+    }
+    
+    vertexCode = injectDefines(vertexCode, defines);
+    geometryCode = injectDefines(geometryCode, defines);
+    fragmentCode = injectDefines(fragmentCode, defines);
+    
+    return Init(vertexCode.c_str(), fragmentCode.c_str(), geometryCode.c_str());
+}
+
+bool Shader::InitComputeFromFile(const std::string& computePath, const std::string& defines)
+{
+    std::string computeCode = loadShaderFromFile(computePath);
+    if (computeCode.empty()) {
+        std::cerr << "ERROR::SHADER::FAILED_TO_LOAD_SHADER_FILES" << std::endl;
+        return false;
+    }
+    
+    computeCode = injectDefines(computeCode, defines);
+    return InitCompute(computeCode.c_str());
+}
+
+size_t Shader::getProgramBinarySize() const
+{
+    if (!shaderProgram) {
+        return 0;
+    }
+    GLint binaryLength = 0;
+    glGetProgramiv(shaderProgram, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    return static_cast<size_t>(binaryLength);
+}
+
+bool Shader::checkCompileErrors(GLuint shader, const std::string& type) const
 {
     GLint success;
     GLchar infoLog[1024];
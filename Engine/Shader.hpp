@@ -4,25 +4,108 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+// FNV-1a hash of a uniform name. Evaluated at compile time when used to
+// initialise a constexpr, so hot paths never hash or query strings per frame.
+constexpr uint32_t HashUniformName(const char* name, uint32_t hash = 2166136261u)
+{
+	return *name ? HashUniformName(name + 1, (hash ^ static_cast<uint8_t>(*name)) * 16777619u) : hash;
+}
+
+// Fixed binding points for the shared std140 blocks declared in shaders/uniform_blocks.glsl.
+// Every program that declares a block is bound to the same slot at link time, so the
+// buffers only need binding once per frame.
+enum UniformBlockBinding : GLuint
+{
+	FRAME_DATA_BINDING = 0,
+	LIGHT_DATA_BINDING = 1,
+	SHADOW_DATA_BINDING = 2,
+	IBL_DATA_BINDING = 3
+};
+
+// Fixed binding points for the std430 storage blocks in shaders/clustered_lights.glsl,
+// bound by name the same way as the uniform blocks
+enum StorageBlockBinding : GLuint
+{
+	CLUSTER_LIGHTS_BINDING = 0,
+	CLUSTER_GRID_BINDING = 1,
+	CLUSTER_INDICES_BINDING = 2
+};
 
 class Shader
 {
 private:
-	GLuint vertexShader;
-	GLuint fragmentShader;
+	// Stages compiled for a link that has not been checked yet; see BeginParallelCompile
+	mutable std::vector<GLuint> pendingStages;
+	mutable bool linkPending;
+	uint64_t binaryKey;     // ProgramBinaryCache key of the sources, 0 when the cache is off
+	
+	// Active uniform locations keyed by HashUniformName(), filled once after linking
+	mutable std::unordered_map<uint32_t, GLint> uniformLocations;
 	
-	bool checkCompileErrors(GLuint shader, const std::string& type);
+	mutable bool hasFrameData;
+	mutable bool hasLightData;
+	
+	static bool deferLinks;
+	static std::vector<Shader*>& PendingLinks();
+	
+	bool buildProgram(const GLenum* stages, const char* const* sources, int stageCount);
+	bool finishLink() const;
+	bool checkCompileErrors(GLuint shader, const std::string& type) const;
 	std::string loadShaderFromFile(const std::string& filePath);
+	std::string resolveIncludes(const std::string& source, const std::string& directory);
+	std::string injectDefines(const std::string& source, const std::string& defines);
+	void reflectUniforms() const;
+	void bindUniformBlocks() const;
 	
 public:
-	GLuint shaderProgram;
+	// Zero when the program failed to build; a deferred link can fail inside a const lookup
+	mutable GLuint shaderProgram;
 	
 	Shader();
 	~Shader();
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
 	
-	bool Init(const char* vertexSource, const char* fragmentSource);
-	bool InitFromFiles(const std::string& vertexPath, const std::string& fragmentPath);
+	// geometrySource is optional; layered passes use it to pick gl_Layer. Programs come from
+	// ProgramBinaryCache when their sources match a stored binary, otherwise they are compiled.
+	bool Init(const char* vertexSource, const char* fragmentSource, const char* geometrySource = nullptr);
+	bool InitCompute(const char* computeSource);
+	bool InitComputeFromFile(const std::string& computePath, const std::string& defines = std::string());
+	// defines is a ';'-separated list ("USE_SHADOWS;MAX_LIGHTS=8") inserted after #version
+	bool InitFromFiles(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines = std::string());
+	bool InitFromFiles(const std::string& vertexPath, const std::string& geometryPath, const std::string& fragmentPath,
+	                   const std::string& defines);
 	void use() const;
 	void cleanup();
+	
+	// Cached uniform lookup; returns -1 for names the program does not use
+	GLint getUniformLocation(uint32_t nameHash) const;
+	GLint getUniformLocation(const std::string& name) const { return getUniformLocation(HashUniformName(name.c_str())); }
+	
+	// True when the program reads camera/light state from the shared uniform blocks
+	bool usesFrameData() const { finishLink(); return hasFrameData; }
+	bool usesLightData() const { finishLink(); return hasLightData; }
+	
+	// Between these two calls, Init hands compiles and links to the driver's compiler threads
+	// (KHR/ARB_parallel_shader_compile) and returns without waiting, so assets load meanwhile.
+	// A deferred program is completed by its first use() or uniform lookup, or by
+	// FinishPendingLinks, which is also where its compile errors get reported. A program that
+	// fails is deleted and shaderProgram zeroed; FinishPendingLinks returns how many did.
+	static bool IsParallelCompileSupported() { return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile; }
+	static void BeginParallelCompile();
+	static size_t FinishPendingLinks();
+	
+	// False while a deferred link is still pending, even if it will fail
+	bool isLinkFailed() const { return !linkPending && !shaderProgram; }
+	
+	// Compute programs need GL 4.3 (the .comp shaders are #version 430)
+	static bool IsComputeSupported() { return GLEW_VERSION_4_3 || GLEW_ARB_compute_shader; }
+	
+	// Driver-side size of the linked program, as reported by GL_PROGRAM_BINARY_LENGTH
+	size_t getProgramBinarySize() const;
 };
 
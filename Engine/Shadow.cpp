@@ -3,6 +3,43 @@
 #include <corecrt_math_defines.h>
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace {
+    constexpr uint32_t UNIFORM_MODEL = HashUniformName("model");
+    constexpr uint32_t UNIFORM_CASCADE_MATRICES = HashUniformName("cascadeMatrices");
+    constexpr uint32_t UNIFORM_CASCADE_MASK = HashUniformName("cascadeMask");
+    constexpr uint32_t UNIFORM_FACE_MATRICES = HashUniformName("faceMatrices");
+    constexpr uint32_t UNIFORM_FACE_LAYERS = HashUniformName("faceLayers");
+    constexpr uint32_t UNIFORM_FACE_MASK = HashUniformName("faceMask");
+    
+    // Cascades cover this much more than their slice, so small camera moves reuse them
+    const float CASCADE_PADDING = 1.15f;
+    
+    // Clip space to [0, 1] texture coordinates and depth
+    const glm::mat4 CLIP_TO_TEXTURE = glm::mat4(
+        glm::vec4(0.5f, 0.0f, 0.0f, 0.0f),
+        glm::vec4(0.0f, 0.5f, 0.0f, 0.0f),
+        glm::vec4(0.0f, 0.0f, 0.5f, 0.0f),
+        glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+    
+    // Cube faces in GL order (+X, -X, +Y, -Y, +Z, -Z), which the shaders' face selection assumes
+    const glm::vec3 CUBE_FACE_DIRECTIONS[6] = {
+        glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3( 0.0f,  1.0f,  0.0f),
+        glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3( 0.0f,  0.0f, -1.0f)
+    };
+    const glm::vec3 CUBE_FACE_UPS[6] = {
+        glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3( 0.0f,  0.0f,  1.0f),
+        glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3( 0.0f, -1.0f,  0.0f)
+    };
+    
+    bool SphereIntersectsBox(const glm::vec3& center, float radius, const AABB& box) {
+        glm::vec3 closest = glm::clamp(center, box.minPoint, box.maxPoint);
+        glm::vec3 offset = closest - center;
+        return glm::dot(offset, offset) <= radius * radius;
+    }
+}
 
 // Base ShadowMap Implementation
 ShadowMap::ShadowMap() : frameBuffer(0), depthMap(0), width(0), height(0) {
@@ -101,88 +138,687 @@ glm::mat4 DirectionalShadowMap::getLightSpaceMatrix() const {
     return lightSpaceMatrix;
 }
 
-// PointShadowMap Implementation
-PointShadowMap::PointShadowMap(PointLight* light) 
-    : light(light), cubeMapTexture(0), near_plane(1.0f), far_plane(100.0f) {
-}
-
-bool PointShadowMap::Init(int w, int h) {
-    width = w;
-    height = h;
+// ShadowCasterTracker Implementation
+bool ShadowCasterTracker::Update(const std::vector<std::unique_ptr<Mesh>>& meshes, std::vector<AABB>& movedBounds) {
+    bool describable = true;
     
-    // Generate framebuffer for shadow mapping
-    glGenFramebuffers(1, &frameBuffer);
+    size_t index = 0;
+    for (const auto& mesh : meshes) {
+        if (!mesh->isValid()) continue;
+        
+        const InstanceBuffer* instances = mesh->getInstanceBuffer();
+        CasterState state;
+        state.mesh = mesh.get();
+        state.model = mesh->getModelMatrix();
+        state.instanceVersion = instances ? instances->GetVersion() : 0;
+        state.worldBounds = mesh->getBounds().transformed(state.model);
+        
+        if (index >= casters.size() || casters[index].mesh != state.mesh) {
+            casters.resize(index);
+            describable = false;
+        } else {
+            const CasterState& previous = casters[index];
+            if (previous.model != state.model || previous.instanceVersion != state.instanceVersion) {
+                // Instances can be anywhere, so there are no bounds to report
+                if (instances) {
+                    describable = false;
+                } else {
+                    movedBounds.push_back(previous.worldBounds);
+                    movedBounds.push_back(state.worldBounds);
+                }
+            }
+        }
+        
+        if (index < casters.size()) {
+            casters[index] = state;
+        } else {
+            casters.push_back(state);
+        }
+        ++index;
+    }
     
-    // Generate cube map texture for omnidirectional shadows
-    glGenTextures(1, &cubeMapTexture);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMapTexture);
+    if (index != casters.size()) {
+        casters.resize(index);
+        describable = false;
+    }
+    return describable;
+}
+
+// CascadedShadowMap Implementation
+CascadedShadowMap::CascadedShadowMap()
+    : depthArray(0), layeredFramebuffer(0), resolution(0), shadowDistance(CAMERA_FAR_PLANE), splitLambda(0.8f),
+      lightDirection(0.0f), lightView(1.0f), shadowData(), redrawnCascades(0) {
+    for (int i = 0; i < CASCADE_COUNT; ++i) {
+        layerFramebuffers[i] = 0;
+        cascades[i].valid = false;
+    }
+}
+
+CascadedShadowMap::~CascadedShadowMap() {
+    cleanup();
+}
+
+void CascadedShadowMap::cleanup() {
+    if (layeredFramebuffer) {
+        glDeleteFramebuffers(1, &layeredFramebuffer);
+        layeredFramebuffer = 0;
+    }
+    for (int i = 0; i < CASCADE_COUNT; ++i) {
+        if (layerFramebuffers[i]) {
+            glDeleteFramebuffers(1, &layerFramebuffers[i]);
+            layerFramebuffers[i] = 0;
+        }
+    }
+    if (depthArray) {
+        glDeleteTextures(1, &depthArray);
+        depthArray = 0;
+    }
+    depthShader.cleanup();
+    casterTracker.Clear();
+    invalidate();
+}
+
+bool CascadedShadowMap::Init(int res) {
+    cleanup();
+    resolution = res;
     
-    for (unsigned int i = 0; i < 6; ++i) {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, 
-                     width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    if (!depthShader.InitFromFiles("shaders/shadow_cascade.vert", "shaders/shadow_cascade.geom",
+                                   "shaders/shadow_depth.frag", std::string())) {
+        std::cerr << "ERROR::SHADOW::CASCADES:: Failed to build the cascade depth shader" << std::endl;
+        return false;
     }
     
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    // 32-bit float depth: with depth clamp, casters in front of a cascade all land on 0
+    glGenTextures(1, &depthArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, CASCADE_COUNT, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+    
+    // Hardware comparison, so each tap of the shader's PCF is already a bilinear 2x2 filter
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
     
-    // Attach cube map to framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cubeMapTexture, 0);
+    // Layered attachment for drawing; the geometry shader picks gl_Layer
+    glGenFramebuffers(1, &layeredFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, layeredFramebuffer);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0);
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
     
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "ERROR::SHADOW::CUBEMAP:: Framebuffer not complete!" << std::endl;
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glGenFramebuffers(CASCADE_COUNT, layerFramebuffers);
+    for (int i = 0; i < CASCADE_COUNT && complete; ++i) {
+        glBindFramebuffer(GL_FRAMEBUFFER, layerFramebuffers[i]);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, i);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    
+    if (!complete) {
+        std::cerr << "ERROR::SHADOW::CASCADES:: Framebuffer not complete!" << std::endl;
+        cleanup();
         return false;
     }
     
+    std::cout << "Cascaded shadow map initialized: " << CASCADE_COUNT << " x " << resolution << "x" << resolution << std::endl;
+    return true;
+}
+
+void CascadedShadowMap::invalidate() {
+    for (int i = 0; i < CASCADE_COUNT; ++i) {
+        cascades[i].valid = false;
+    }
+}
+
+void CascadedShadowMap::Update(const Camera& camera, float aspect, const glm::vec3& direction,
+                               const std::vector<std::unique_ptr<Mesh>>& meshes) {
+    redrawnCascades = 0;
+    if (!IsInitialized()) return;
+    
+    // A turned light changes every texel
+    glm::vec3 newDirection = glm::normalize(direction);
+    if (glm::length(newDirection - lightDirection) > 1e-5f) {
+        lightDirection = newDirection;
+        glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+        invalidate();
+    }
+    
+    uint32_t dirty = fitCascades(camera, aspect);
+    dirty |= trackCasters(meshes);
+    
+    if (dirty) {
+        drawCascades(dirty, meshes);
+    }
+    for (int i = 0; i < CASCADE_COUNT; ++i) {
+        if (dirty & (1u << i)) ++redrawnCascades;
+    }
+}
+
+uint32_t CascadedShadowMap::fitCascades(const Camera& camera, float aspect) {
+    const float nearPlane = CAMERA_NEAR_PLANE;
+    const float farPlane = (std::min)(shadowDistance, CAMERA_FAR_PLANE);
+    const float tanHalfFov = std::tan(glm::radians(camera.getZoom()) * 0.5f);
+    const glm::vec3 eye = camera.getPosition();
+    const glm::vec3 front = camera.getFront();
+    
+    uint32_t dirty = 0;
+    float sliceNear = nearPlane;
+    for (int i = 0; i < CASCADE_COUNT; ++i) {
+        // Practical split scheme: a blend of logarithmic and uniform split distances
+        float fraction = static_cast<float>(i + 1) / CASCADE_COUNT;
+        float logSplit = nearPlane * std::pow(farPlane / nearPlane, fraction);
+        float uniformSplit = nearPlane + (farPlane - nearPlane) * fraction;
+        float sliceFar = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+        
+        // Smallest sphere through the slice's corners; it does not change as the camera
+        // turns, so only translation moves the cascade
+        float nearCorner2 = sliceNear * sliceNear * tanHalfFov * tanHalfFov * (1.0f + aspect * aspect);
+        float farCorner2 = sliceFar * sliceFar * tanHalfFov * tanHalfFov * (1.0f + aspect * aspect);
+        float centerDepth = (sliceFar * sliceFar - sliceNear * sliceNear + farCorner2 - nearCorner2) /
+                            (2.0f * (sliceFar - sliceNear));
+        centerDepth = (std::min)(centerDepth, sliceFar);
+        float sliceRadius = std::sqrt((centerDepth - sliceNear) * (centerDepth - sliceNear) + nearCorner2);
+        sliceRadius = (std::max)(sliceRadius, std::sqrt(farCorner2 + (sliceFar - centerDepth) * (sliceFar - centerDepth)));
+        glm::vec3 center = glm::vec3(lightView * glm::vec4(eye + front * centerDepth, 1.0f));
+        
+        // Kept while the slice stays inside the padded sphere and the slice size is unchanged
+        Cascade& cascade = cascades[i];
+        bool reuse = cascade.valid && std::abs(sliceRadius - cascade.sliceRadius) <= 1e-3f * cascade.sliceRadius &&
+                     glm::length(center - cascade.center) + sliceRadius <= cascade.radius;
+        if (!reuse) {
+            cascade.sliceRadius = sliceRadius;
+            cascade.radius = sliceRadius * CASCADE_PADDING;
+            
+            // Whole texels only, so the rasterisation of static casters never shifts
+            float texel = 2.0f * cascade.radius / static_cast<float>(resolution);
+            cascade.center = glm::floor(center / texel + 0.5f) * texel;
+            
+            const glm::vec3& c = cascade.center;
+            float r = cascade.radius;
+            glm::mat4 projection = glm::ortho(c.x - r, c.x + r, c.y - r, c.y + r, -c.z - r, -c.z + r);
+            cascade.viewProjection = projection * lightView;
+            cascade.valid = true;
+            
+            casterFrusta[i] = Frustum(cascade.viewProjection);
+            casterFrusta[i].planes[Frustum::PLANE_NEAR] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            dirty |= 1u << i;
+        }
+        
+        shadowData.cascadeMatrices[i] = CLIP_TO_TEXTURE * cascade.viewProjection;
+        shadowData.cascadeSplits[i] = sliceFar;
+        shadowData.cascadeTexelSizes[i] = 2.0f * cascade.radius / static_cast<float>(resolution);
+        sliceNear = sliceFar;
+    }
+    shadowData.cascadeCount = CASCADE_COUNT;
+    
+    return dirty;
+}
+
+uint32_t CascadedShadowMap::trackCasters(const std::vector<std::unique_ptr<Mesh>>& meshes) {
+    const uint32_t allCascades = (1u << CASCADE_COUNT) - 1;
+    
+    // A plain mesh only dirties the cascades it left or entered
+    movedBounds.clear();
+    if (!casterTracker.Update(meshes, movedBounds)) {
+        return allCascades;
+    }
+    uint32_t dirty = 0;
+    for (const AABB& bounds : movedBounds) {
+        dirty |= overlappingCascades(bounds, allCascades);
+    }
+    return dirty;
+}
+
+uint32_t CascadedShadowMap::overlappingCascades(const AABB& worldBox, uint32_t mask) const {
+    uint32_t overlapping = 0;
+    for (int i = 0; i < CASCADE_COUNT; ++i) {
+        if ((mask & (1u << i)) && casterFrusta[i].intersects(worldBox)) {
+            overlapping |= 1u << i;
+        }
+    }
+    return overlapping;
+}
+
+void CascadedShadowMap::drawCascades(uint32_t mask, const std::vector<std::unique_ptr<Mesh>>& meshes) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    
+    // Clears only the layers being redrawn; the rest keep last frame's depth
+    for (int i = 0; i < CASCADE_COUNT; ++i) {
+        if (mask & (1u << i)) {
+            glBindFramebuffer(GL_FRAMEBUFFER, layerFramebuffers[i]);
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+    }
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, layeredFramebuffer);
+    glViewport(0, 0, resolution, resolution);
+    glEnable(GL_DEPTH_CLAMP);           // Casters between the light and a cascade still land in it
+    glEnable(GL_POLYGON_OFFSET_FILL);   // Slope-scaled bias; the main pass adds a normal offset
+    glPolygonOffset(2.0f, 1.0f);
+    
+    depthShader.use();
+    glm::mat4 matrices[CASCADE_COUNT];
+    for (int i = 0; i < CASCADE_COUNT; ++i) {
+        matrices[i] = cascades[i].viewProjection;
+    }
+    glUniformMatrix4fv(depthShader.getUniformLocation(UNIFORM_CASCADE_MATRICES), CASCADE_COUNT, GL_FALSE,
+                       glm::value_ptr(matrices[0]));
+    GLint modelLoc = depthShader.getUniformLocation(UNIFORM_MODEL);
+    GLint maskLoc = depthShader.getUniformLocation(UNIFORM_CASCADE_MASK);
+    
+    for (const auto& mesh : meshes) {
+        if (!mesh->isValid()) continue;
+        
+        glm::mat4 model = mesh->getModelMatrix();
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        mesh->bindVertexDecode(depthShader);
+        glBindVertexArray(mesh->getVAO());
+        
+        // Instances are culled per cascade, since one upload serves one frustum
+        if (InstanceBuffer* instances = mesh->getInstanceBuffer()) {
+            for (int i = 0; i < CASCADE_COUNT; ++i) {
+                if (!(mask & (1u << i))) continue;
+                GLsizei instanceCount = instances->UploadVisible(model, casterFrusta[i]);
+                if (instanceCount == 0) continue;
+                glUniform1i(maskLoc, 1 << i);
+                for (const SubMesh& subMesh : mesh->getSubMeshes()) {
+                    mesh->drawSubMesh(subMesh, instanceCount);
+                }
+            }
+            continue;
+        }
+        
+        for (const SubMesh& subMesh : mesh->getSubMeshes()) {
+            uint32_t subMeshMask = overlappingCascades(subMesh.bounds.transformed(model), mask);
+            if (!subMeshMask) continue;
+            glUniform1i(maskLoc, static_cast<GLint>(subMeshMask));
+            mesh->drawSubMesh(subMesh);
+        }
+    }
+    
+    glBindVertexArray(0);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_CLAMP);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void CascadedShadowMap::BindForReading(GLenum textureUnit) const {
+    glActiveTexture(textureUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+}
+
+// ShadowAtlas Implementation
+ShadowAtlas::ShadowAtlas()
+    : depthArray(0), layeredFramebuffer(0), tileSize(0), usedTiles(0), redrawnFaces(0) {
+    for (int i = 0; i < TILE_COUNT; ++i) {
+        layerFramebuffers[i] = 0;
+        faces[i].valid = false;
+    }
+}
+
+ShadowAtlas::~ShadowAtlas() {
+    cleanup();
+}
+
+void ShadowAtlas::cleanup() {
+    if (layeredFramebuffer) {
+        glDeleteFramebuffers(1, &layeredFramebuffer);
+        layeredFramebuffer = 0;
+    }
+    for (int i = 0; i < TILE_COUNT; ++i) {
+        if (layerFramebuffers[i]) {
+            glDeleteFramebuffers(1, &layerFramebuffers[i]);
+            layerFramebuffers[i] = 0;
+        }
+        faces[i].valid = false;
+    }
+    if (depthArray) {
+        glDeleteTextures(1, &depthArray);
+        depthArray = 0;
+    }
+    layeredShader.cleanup();
+    faceShader.cleanup();
+    shadows.clear();
+    casterTracker.Clear();
+    usedTiles = 0;
+}
+
+bool ShadowAtlas::Init(int size) {
+    cleanup();
+    tileSize = size;
+    
+    if (!faceShader.InitFromFiles("shaders/shadow_atlas.vert", "shaders/shadow_depth.frag")) {
+        std::cerr << "ERROR::SHADOW::ATLAS:: Failed to build the atlas depth shader" << std::endl;
+        return false;
+    }
+    
+    // Layered drawing needs gl_Layer in the vertex shader; without it faces go one per draw
+    const char* layerDefine = GLEW_ARB_shader_viewport_layer_array ? "LAYERED_ARB"
+                            : GLEW_AMD_vertex_shader_layer ? "LAYERED_AMD" : nullptr;
+    if (layerDefine && !layeredShader.InitFromFiles("shaders/shadow_atlas.vert", "shaders/shadow_depth.frag", layerDefine)) {
+        std::cerr << "Layered atlas shader failed; drawing shadow faces one at a time" << std::endl;
+    }
+    
+    glGenTextures(1, &depthArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, tileSize, tileSize, TILE_COUNT, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    
+    glGenFramebuffers(1, &layeredFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, layeredFramebuffer);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    
+    glGenFramebuffers(TILE_COUNT, layerFramebuffers);
+    for (int i = 0; i < TILE_COUNT && complete; ++i) {
+        glBindFramebuffer(GL_FRAMEBUFFER, layerFramebuffers[i]);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, i);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    depthMap = cubeMapTexture; // For compatibility
     
-    updateShadowTransforms();
+    if (!complete) {
+        std::cerr << "ERROR::SHADOW::ATLAS:: Framebuffer not complete!" << std::endl;
+        cleanup();
+        return false;
+    }
     
-    std::cout << "Point light shadow map initialized: " << width << "x" << height << std::endl;
+    std::cout << "Shadow atlas initialized: " << TILE_COUNT << " x " << tileSize << "x" << tileSize
+              << (layeredShader.shaderProgram ? " (layered)" : " (one face per draw)") << std::endl;
     return true;
 }
 
-void PointShadowMap::updateShadowTransforms() {
-    glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), (float)width / (float)height, near_plane, far_plane);
-    glm::vec3 lightPos = light->getPosition();
+int ShadowAtlas::allocateTiles(int count) {
+    // First fit; a point light's six faces stay contiguous so the shader can index them
+    for (int first = 0; first + count <= TILE_COUNT; ++first) {
+        uint64_t bits = (count == 64 ? ~0ull : ((1ull << count) - 1)) << first;
+        if ((usedTiles & bits) == 0) {
+            usedTiles |= bits;
+            return first;
+        }
+    }
+    return -1;
+}
+
+int ShadowAtlas::getFirstFace(const Light* light) const {
+    for (const LightShadow& shadow : shadows) {
+        if (shadow.light == light) return shadow.firstFace;
+    }
+    return -1;
+}
+
+void ShadowAtlas::updateFaces(LightShadow& shadow) {
+    // Slightly wider than the cone or cube face, so the shader's PCF stays inside the tile
+    float margin = 2.0f * std::atan(1.0f + 4.0f / static_cast<float>(tileSize)) - glm::radians(90.0f);
+    float nearPlane = (std::max)(0.05f, shadow.range * 0.001f);
     
-    shadowTransforms.clear();
-    shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-    shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-    shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)));
-    shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)));
-    shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-    shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
+    for (int i = 0; i < shadow.faceCount; ++i) {
+        glm::vec3 direction = shadow.faceCount == 6 ? CUBE_FACE_DIRECTIONS[i] : shadow.direction;
+        glm::vec3 up = shadow.faceCount == 6 ? CUBE_FACE_UPS[i]
+                     : std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        float fov = shadow.faceCount == 6 ? glm::radians(90.0f) + margin
+                  : (std::min)(2.0f * std::acos(glm::clamp(shadow.outerCone, -1.0f, 1.0f)) + margin, glm::radians(170.0f));
+        
+        Face& face = faces[shadow.firstFace + i];
+        face.viewProjection = glm::perspective(fov, 1.0f, nearPlane, shadow.range) *
+                              glm::lookAt(shadow.position, shadow.position + direction, up);
+        face.frustum = Frustum(face.viewProjection);
+        
+        // The pyramid from the light to the far plane's corners
+        glm::mat4 inverse = glm::inverse(face.viewProjection);
+        face.bounds = AABB();
+        face.bounds.expand(shadow.position);
+        for (int corner = 0; corner < 4; ++corner) {
+            glm::vec4 p = inverse * glm::vec4(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, 1.0f, 1.0f);
+            face.bounds.expand(glm::vec3(p) / p.w);
+        }
+        face.valid = false;
+    }
 }
 
-void PointShadowMap::BeginShadowPass() {
-    updateShadowTransforms(); // Update in case light moved
-    glViewport(0, 0, width, height);
-    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-    glClear(GL_DEPTH_BUFFER_BIT);
+void ShadowAtlas::Update(const Frustum& cameraFrustum, const std::vector<std::unique_ptr<Light>>& lights,
+                         const std::vector<std::unique_ptr<Mesh>>& meshes) {
+    redrawnFaces = 0;
+    if (!IsInitialized()) return;
+    
+    for (LightShadow& shadow : shadows) {
+        shadow.seen = false;
+    }
+    
+    for (const auto& light : lights) {
+        if (!light->enabled || light->getType() == LightType::DIRECTIONAL) continue;
+        
+        // What the faces depend on
+        LightShadow current = {};
+        current.light = light.get();
+        current.position = light->getPosition();
+        if (light->getType() == LightType::POINT) {
+            const PointLight* point = static_cast<const PointLight*>(light.get());
+            current.faceCount = 6;
+            current.range = point->getRange();
+        } else {
+            const SpotLight* spot = static_cast<const SpotLight*>(light.get());
+            current.faceCount = 1;
+            current.direction = spot->getDirection();
+            current.outerCone = spot->outerCone;
+            current.range = spot->getRange();
+        }
+        current.seen = true;
+        
+        auto existing = std::find_if(shadows.begin(), shadows.end(),
+                                     [&](const LightShadow& shadow) { return shadow.light == current.light; });
+        if (existing == shadows.end()) {
+            // Lights that find no room go without shadows until another light frees tiles
+            current.firstFace = allocateTiles(current.faceCount);
+            if (current.firstFace < 0) continue;
+            shadows.push_back(current);
+            updateFaces(shadows.back());
+            continue;
+        }
+        
+        if (existing->position != current.position || existing->direction != current.direction ||
+            existing->outerCone != current.outerCone || existing->range != current.range) {
+            current.firstFace = existing->firstFace;
+            *existing = current;
+            updateFaces(*existing);
+        }
+        existing->seen = true;
+    }
+    
+    // Free the tiles of lights that were removed or disabled
+    for (size_t i = 0; i < shadows.size();) {
+        if (shadows[i].seen) {
+            ++i;
+            continue;
+        }
+        uint64_t bits = ((1ull << shadows[i].faceCount) - 1) << shadows[i].firstFace;
+        usedTiles &= ~bits;
+        shadows[i] = shadows.back();
+        shadows.pop_back();
+    }
+    
+    // Casters that moved within a light's range invalidate all of its faces
+    movedBounds.clear();
+    bool describable = casterTracker.Update(meshes, movedBounds);
+    for (LightShadow& shadow : shadows) {
+        bool touched = !describable;
+        for (size_t i = 0; i < movedBounds.size() && !touched; ++i) {
+            touched = SphereIntersectsBox(shadow.position, shadow.range, movedBounds[i]);
+        }
+        if (touched) {
+            for (int i = 0; i < shadow.faceCount; ++i) {
+                faces[shadow.firstFace + i].valid = false;
+            }
+        }
+    }
+    
+    // Stale faces the camera cannot see wait until it can
+    drawList.clear();
+    for (const LightShadow& shadow : shadows) {
+        for (int i = 0; i < shadow.faceCount; ++i) {
+            int index = shadow.firstFace + i;
+            if (!faces[index].valid && cameraFrustum.intersects(faces[index].bounds)) {
+                drawList.push_back(index);
+            }
+        }
+    }
+    if (drawList.empty()) return;
+    
+    drawFaces(meshes);
+    for (int index : drawList) {
+        faces[index].valid = true;
+    }
+    redrawnFaces = static_cast<int>(drawList.size());
 }
 
-void PointShadowMap::EndShadowPass() {
+void ShadowAtlas::drawFaces(const std::vector<std::unique_ptr<Mesh>>& meshes) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    
+    for (int index : drawList) {
+        glBindFramebuffer(GL_FRAMEBUFFER, layerFramebuffers[index]);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+    
+    glViewport(0, 0, tileSize, tileSize);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 1.0f);
+    
+    if (layeredShader.shaderProgram) {
+        // Each instance of a draw is one face of the batch; faceMask leaves out faces the
+        // submesh cannot reach
+        glBindFramebuffer(GL_FRAMEBUFFER, layeredFramebuffer);
+        layeredShader.use();
+        GLint modelLoc = layeredShader.getUniformLocation(UNIFORM_MODEL);
+        GLint maskLoc = layeredShader.getUniformLocation(UNIFORM_FACE_MASK);
+        
+        for (size_t batchStart = 0; batchStart < drawList.size(); batchStart += BATCH_FACES) {
+            int batchSize = static_cast<int>((std::min)(drawList.size() - batchStart, static_cast<size_t>(BATCH_FACES)));
+            glm::mat4 matrices[BATCH_FACES];
+            GLint layers[BATCH_FACES];
+            for (int i = 0; i < batchSize; ++i) {
+                matrices[i] = faces[drawList[batchStart + i]].viewProjection;
+                layers[i] = drawList[batchStart + i];
+            }
+            glUniformMatrix4fv(layeredShader.getUniformLocation(UNIFORM_FACE_MATRICES), batchSize, GL_FALSE,
+                               glm::value_ptr(matrices[0]));
+            glUniform1iv(layeredShader.getUniformLocation(UNIFORM_FACE_LAYERS), batchSize, layers);
+            
+            for (const auto& mesh : meshes) {
+                if (!mesh->isValid() || mesh->isInstanced()) continue;
+                
+                glm::mat4 model = mesh->getModelMatrix();
+                bool bound = false;
+                for (const SubMesh& subMesh : mesh->getSubMeshes()) {
+                    AABB bounds = subMesh.bounds.transformed(model);
+                    GLint mask = 0;
+                    int instanceCount = 0;
+                    for (int i = 0; i < batchSize; ++i) {
+                        if (faces[layers[i]].frustum.intersects(bounds)) {
+                            mask |= 1 << i;
+                            instanceCount = i + 1;
+                        }
+                    }
+                    if (!mask) continue;
+                    
+                    if (!bound) {
+                        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+                        mesh->bindVertexDecode(layeredShader);
+                        glBindVertexArray(mesh->getVAO());
+                        bound = true;
+                    }
+                    glUniform1i(maskLoc, mask);
+                    mesh->drawSubMesh(subMesh, instanceCount);
+                }
+            }
+        }
+        
+        // Instanced meshes already spend gl_InstanceID on their instances
+        drawFacesOneByOne(meshes, true);
+    } else {
+        drawFacesOneByOne(meshes, false);
+    }
+    
+    glBindVertexArray(0);
+    glDisable(GL_POLYGON_OFFSET_FILL);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
 }
 
-void PointShadowMap::BindForReading(GLenum textureUnit) {
-    glActiveTexture(textureUnit);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMapTexture);
+void ShadowAtlas::drawFacesOneByOne(const std::vector<std::unique_ptr<Mesh>>& meshes, bool instancedOnly) {
+    faceShader.use();
+    GLint modelLoc = faceShader.getUniformLocation(UNIFORM_MODEL);
+    GLint matrixLoc = faceShader.getUniformLocation(UNIFORM_FACE_MATRICES);
+    
+    for (int index : drawList) {
+        const Face& face = faces[index];
+        glBindFramebuffer(GL_FRAMEBUFFER, layerFramebuffers[index]);
+        glUniformMatrix4fv(matrixLoc, 1, GL_FALSE, glm::value_ptr(face.viewProjection));
+        
+        for (const auto& mesh : meshes) {
+            if (!mesh->isValid() || (instancedOnly && !mesh->isInstanced())) continue;
+            
+            glm::mat4 model = mesh->getModelMatrix();
+            if (InstanceBuffer* instances = mesh->getInstanceBuffer()) {
+                GLsizei instanceCount = instances->UploadVisible(model, face.frustum);
+                if (instanceCount == 0) continue;
+                glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+                mesh->bindVertexDecode(faceShader);
+                glBindVertexArray(mesh->getVAO());
+                for (const SubMesh& subMesh : mesh->getSubMeshes()) {
+                    mesh->drawSubMesh(subMesh, instanceCount);
+                }
+                continue;
+            }
+            
+            bool bound = false;
+            for (const SubMesh& subMesh : mesh->getSubMeshes()) {
+                if (!face.frustum.intersects(subMesh.bounds.transformed(model))) continue;
+                if (!bound) {
+                    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+                    mesh->bindVertexDecode(faceShader);
+                    glBindVertexArray(mesh->getVAO());
+                    bound = true;
+                }
+                mesh->drawSubMesh(subMesh);
+            }
+        }
+    }
 }
 
-glm::mat4 PointShadowMap::getLightSpaceMatrix() const {
-    // Return first transform as default (not used for point lights)
-    return shadowTransforms.empty() ? glm::mat4(1.0f) : shadowTransforms[0];
+void ShadowAtlas::BindForReading(GLenum textureUnit) const {
+    glActiveTexture(textureUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
 }
 
-std::vector<glm::mat4> PointShadowMap::getLightSpaceMatrices() const {
-    return shadowTransforms;
+void ShadowAtlas::writeShadowData(ShadowDataBlock& shadowData) const {
+    for (const LightShadow& shadow : shadows) {
+        for (int i = 0; i < shadow.faceCount; ++i) {
+            int index = shadow.firstFace + i;
+            shadowData.localShadowMatrices[index] = CLIP_TO_TEXTURE * faces[index].viewProjection;
+        }
+    }
 }
\ No newline at end of file
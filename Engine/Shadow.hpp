@@ -6,6 +6,11 @@
 #include <vector>
 #include <corecrt_math_defines.h>
 #include "Light.hpp"
+#include "Camera.hpp"
+#include "Mesh.hpp"
+#include "Shader.hpp"
+#include "Frustum.hpp"
+#include "UniformBuffers.hpp"
 
 class ShadowMap {
 public:
@@ -53,24 +58,165 @@ private:
     float left, right, bottom, top;
 };
 
-class PointShadowMap : public ShadowMap {
+// Remembers where each mesh was when a cached shadow pass last looked, so the pass can tell
+// which of its maps a moved caster touches
+class ShadowCasterTracker {
 public:
-    PointShadowMap(PointLight* light);
+    // Compares the meshes against the previous call and appends the old and new world bounds
+    // of every plain mesh that moved. Returns false when that cannot describe the change:
+    // meshes were added or removed, or an instanced mesh moved or changed its instances.
+    bool Update(const std::vector<std::unique_ptr<Mesh>>& meshes, std::vector<AABB>& movedBounds);
+    void Clear() { casters.clear(); }
     
-    bool Init(int width = 1024, int height = 1024) override;
-    void BeginShadowPass() override;
-    void EndShadowPass() override;
-    void BindForReading(GLenum textureUnit) override;
-    glm::mat4 getLightSpaceMatrix() const override;
+private:
+    struct CasterState {
+        const Mesh* mesh;
+        glm::mat4 model;
+        uint32_t instanceVersion;
+        AABB worldBounds;
+    };
     
-    // Get all 6 face matrices for cube mapping
-    std::vector<glm::mat4> getLightSpaceMatrices() const;
+    std::vector<CasterState> casters;
+};
 
+// Sun shadows for the main pass. The camera frustum is split into CASCADE_COUNT slices, each
+// covered by an orthographic map in one layer of a depth texture array, and every cascade that
+// needs it is drawn in one layered pass. A cascade is fitted to a padded sphere around its
+// slice and snapped to whole texels, so it neither shimmers nor needs redrawing until the
+// slice leaves that sphere, a caster inside it moves, or the light turns.
+class CascadedShadowMap {
+public:
+    static const int CASCADE_COUNT = MAX_SHADOW_CASCADES;
+    
+    CascadedShadowMap();
+    ~CascadedShadowMap();
+    
+    bool Init(int resolution = 2048);
+    void cleanup();
+    bool IsInitialized() const { return depthArray != 0; }
+    
+    // Refits the cascades to the camera and redraws those whose contents changed.
+    // Leaves the default framebuffer bound with the caller's viewport.
+    void Update(const Camera& camera, float aspect, const glm::vec3& lightDirection,
+                const std::vector<std::unique_ptr<Mesh>>& meshes);
+    void BindForReading(GLenum textureUnit) const;
+    
+    // Redraws every cascade on the next Update
+    void invalidate();
+    
+    // Cascades cover [CAMERA_NEAR_PLANE, shadowDistance], split between logarithmic (lambda 1)
+    // and uniform (lambda 0) spacing
+    void setShadowDistance(float distance) { shadowDistance = distance; invalidate(); }
+    void setSplitLambda(float lambda) { splitLambda = lambda; invalidate(); }
+    
+    const ShadowDataBlock& getShadowData() const { return shadowData; }
+    int getResolution() const { return resolution; }
+    int getRedrawnCascades() const { return redrawnCascades; }   // By the last Update
+    
 private:
-    PointLight* light;
-    GLuint cubeMapTexture;
-    float near_plane, far_plane;
-    std::vector<glm::mat4> shadowTransforms;
+    struct Cascade {
+        glm::vec3 center;           // Snapped, in light view space
+        float radius;               // Padded radius the map covers
+        float sliceRadius;          // Radius of the slice it was fitted to
+        glm::mat4 viewProjection;
+        bool valid;
+    };
+    
+    GLuint depthArray;
+    GLuint layeredFramebuffer;
+    GLuint layerFramebuffers[CASCADE_COUNT];    // One layer each, for clearing only the cascades redrawn
+    Shader depthShader;
+    int resolution;
+    float shadowDistance;
+    float splitLambda;
+    
+    Cascade cascades[CASCADE_COUNT];
+    Frustum casterFrusta[CASCADE_COUNT];        // Without a near plane; depth clamp keeps casters in front
+    glm::vec3 lightDirection;
+    glm::mat4 lightView;
+    ShadowCasterTracker casterTracker;
+    std::vector<AABB> movedBounds;
+    ShadowDataBlock shadowData;
+    int redrawnCascades;
+    
+    uint32_t fitCascades(const Camera& camera, float aspect);
+    uint32_t trackCasters(const std::vector<std::unique_ptr<Mesh>>& meshes);
+    uint32_t overlappingCascades(const AABB& worldBox, uint32_t mask) const;
+    void drawCascades(uint32_t mask, const std::vector<std::unique_ptr<Mesh>>& meshes);
+};
+
+// Shadows for point and spot lights, sharing one depth texture array of equal tiles: a spot
+// light takes one tile, a point light six (its cube faces, as 90 degree perspectives). Each
+// face the pass redraws is one instance of a draw whose vertex shader picks gl_Layer, so
+// there is no geometry shader; without ARB_shader_viewport_layer_array (or the AMD
+// equivalent) faces are drawn one at a time. A face is only redrawn when it is in view and
+// its light, or a caster within the light's range, has moved since it was last drawn.
+class ShadowAtlas {
+public:
+    static const int TILE_COUNT = MAX_LOCAL_SHADOW_FACES;
+    static const int BATCH_FACES = 16;      // Faces per layered draw; matches shadow_atlas.vert
+    
+    ShadowAtlas();
+    ~ShadowAtlas();
+    
+    bool Init(int tileSize = 512);
+    void cleanup();
+    bool IsInitialized() const { return depthArray != 0; }
+    
+    // Allocates tiles for new lights, frees those of lights that went away and redraws the
+    // stale faces that cameraFrustum can see. Leaves the default framebuffer bound with the
+    // caller's viewport.
+    void Update(const Frustum& cameraFrustum, const std::vector<std::unique_ptr<Light>>& lights,
+                const std::vector<std::unique_ptr<Mesh>>& meshes);
+    void BindForReading(GLenum textureUnit) const;
+    
+    // First face of a light's tiles (the ones after it are its other cube faces), or -1 when
+    // the atlas had no room for it
+    int getFirstFace(const Light* light) const;
+    
+    // Fills the localShadowMatrices of the ShadowData block
+    void writeShadowData(ShadowDataBlock& shadowData) const;
+    
+    int getTileSize() const { return tileSize; }
+    int getRedrawnFaces() const { return redrawnFaces; }    // By the last Update
+    
+private:
+    struct Face {
+        glm::mat4 viewProjection;
+        Frustum frustum;
+        AABB bounds;            // Around the face's pyramid, for the camera test
+        bool valid;
+    };
+    
+    // A light's tiles and the state they were drawn with
+    struct LightShadow {
+        const Light* light;
+        int firstFace;
+        int faceCount;
+        glm::vec3 position;
+        glm::vec3 direction;
+        float outerCone;
+        float range;
+        bool seen;              // Still in the light list this frame
+    };
+    
+    GLuint depthArray;
+    GLuint layeredFramebuffer;
+    GLuint layerFramebuffers[TILE_COUNT];   // Single layers, for clears and unlayered draws
+    Shader layeredShader;                   // Only built when the vertex shader can write gl_Layer
+    Shader faceShader;
+    int tileSize;
+    
+    uint64_t usedTiles;
+    std::vector<LightShadow> shadows;
+    Face faces[TILE_COUNT];
+    ShadowCasterTracker casterTracker;
+    std::vector<AABB> movedBounds;
+    std::vector<int> drawList;
+    int redrawnFaces;
     
-    void updateShadowTransforms();
+    int allocateTiles(int count);
+    void updateFaces(LightShadow& shadow);
+    void drawFaces(const std::vector<std::unique_ptr<Mesh>>& meshes);
+    void drawFacesOneByOne(const std::vector<std::unique_ptr<Mesh>>& meshes, bool instancedOnly);
 };
\ No newline at end of file
@@ -1,11 +1,15 @@
 #include <corecrt_math_defines.h>
 #include "Spectrum.hpp"
+#include "RGBToSpectrumTable.hpp"
 #include <cmath>
 #include <random>
 #include <numeric>
 
+// Reference tables; each sample count averages them down to its own resolution
+namespace {
+
 // CIE color matching functions (sampled at 5nm intervals from 400-700nm)
-const std::array<float, SPECTRAL_SAMPLES> Spectrum::CIE_X = {
+const std::array<float, REFERENCE_SPECTRAL_SAMPLES> REFERENCE_CIE_X = {
     0.0143f, 0.0435f, 0.1344f, 0.2839f, 0.3483f, 0.3362f, 0.2908f, 0.1954f, 0.0956f, 0.0320f,
     0.0049f, 0.0093f, 0.0633f, 0.1655f, 0.2904f, 0.4334f, 0.5945f, 0.7621f, 0.9163f, 1.0263f,
     1.0622f, 1.0026f, 0.8544f, 0.6424f, 0.4479f, 0.2835f, 0.1649f, 0.0874f, 0.0468f, 0.0227f,
@@ -14,7 +18,7 @@ const std::array<float, SPECTRAL_SAMPLES> Spectrum::CIE_X = {
     0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f
 };
 
-const std::array<float, SPECTRAL_SAMPLES> Spectrum::CIE_Y = {
+const std::array<float, REFERENCE_SPECTRAL_SAMPLES> REFERENCE_CIE_Y = {
     0.0004f, 0.0012f, 0.0040f, 0.0116f, 0.0230f, 0.0380f, 0.0600f, 0.0910f, 0.1390f, 0.2080f,
     0.3230f, 0.5030f, 0.7100f, 0.8620f, 0.9540f, 0.9950f, 0.9950f, 0.9520f, 0.8700f, 0.7570f,
     0.6310f, 0.5030f, 0.3810f, 0.2650f, 0.1750f, 0.1070f, 0.0610f, 0.0320f, 0.0170f, 0.0082f,
@@ -23,7 +27,7 @@ const std::array<float, SPECTRAL_SAMPLES> Spectrum::CIE_Y = {
     0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f
 };
 
-const std::array<float, SPECTRAL_SAMPLES> Spectrum::CIE_Z = {
+const std::array<float, REFERENCE_SPECTRAL_SAMPLES> REFERENCE_CIE_Z = {
     0.0679f, 0.2074f, 0.6456f, 1.3856f, 1.7471f, 1.7721f, 1.6692f, 1.2876f, 0.8130f, 0.4652f,
     0.2720f, 0.1582f, 0.0782f, 0.0422f, 0.0203f, 0.0087f, 0.0039f, 0.0021f, 0.0017f, 0.0011f,
     0.0008f, 0.0003f, 0.0002f, 0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f, 0.0000f,
@@ -33,7 +37,7 @@ const std::array<float, SPECTRAL_SAMPLES> Spectrum::CIE_Z = {
 };
 
 // D65 standard illuminant
-const std::array<float, SPECTRAL_SAMPLES> Spectrum::D65_ILLUMINANT = {
+const std::array<float, REFERENCE_SPECTRAL_SAMPLES> REFERENCE_D65 = {
     82.75f, 87.12f, 91.49f, 92.46f, 93.43f, 90.06f, 86.68f, 95.77f, 104.86f, 110.94f,
     117.01f, 117.41f, 117.81f, 116.34f, 114.86f, 115.39f, 115.92f, 112.37f, 108.81f, 109.08f,
     109.35f, 108.58f, 107.80f, 106.30f, 104.79f, 106.24f, 107.69f, 106.05f, 104.41f, 104.23f,
@@ -42,199 +46,312 @@ const std::array<float, SPECTRAL_SAMPLES> Spectrum::D65_ILLUMINANT = {
     80.03f, 80.12f, 80.21f, 81.25f, 82.28f, 80.28f, 78.28f, 74.00f, 69.72f, 70.67f
 };
 
-// Color conversion matrices
-const glm::mat3 Spectrum::RGB_TO_XYZ = glm::mat3(
+// Color conversion matrices (linear sRGB, D65), written row by row; glm takes columns
+const glm::mat3 RGB_TO_XYZ = glm::transpose(glm::mat3(
     0.4124564f, 0.3575761f, 0.1804375f,
     0.2126729f, 0.7151522f, 0.0721750f,
     0.0193339f, 0.1191920f, 0.9503041f
-);
+));
 
-const glm::mat3 Spectrum::XYZ_TO_RGB = glm::mat3(
+const glm::mat3 XYZ_TO_RGB = glm::transpose(glm::mat3(
     3.2404542f, -1.5371385f, -0.4985314f,
     -0.9692660f,  1.8760108f,  0.0415560f,
     0.0556434f, -0.2040259f,  1.0572252f
-);
-
-// Spectrum implementation
-Spectrum::Spectrum(float value) {
-    samples.fill(value);
+));
+
+// Linear interpolation in a reference table at any wavelength; zero outside the range
+float InterpolateReference(const std::array<float, REFERENCE_SPECTRAL_SAMPLES>& table, float lambda) {
+    float x = (lambda - LAMBDA_MIN) / (LAMBDA_MAX - LAMBDA_MIN) * (REFERENCE_SPECTRAL_SAMPLES - 1);
+    if (x < 0.0f || x > REFERENCE_SPECTRAL_SAMPLES - 1) return 0.0f;
+    int i = (std::min)(static_cast<int>(x), REFERENCE_SPECTRAL_SAMPLES - 2);
+    float t = x - i;
+    return table[i] + (table[i + 1] - table[i]) * t;
+}
+
+// XYZ of the D65 white point at unit luminance; with XYZ_TO_RGB it is (1, 1, 1)
+const glm::vec3 D65_WHITE_XYZ(0.95047f, 1.0f, 1.08883f);
+
+// Scale from the integrals of D65 times each matching function to D65_WHITE_XYZ, at the spacing
+// InterpolateReference uses. Mapping exactly onto the white point (rather than only dividing
+// by the Y integral) also absorbs what the 400-700 nm range cuts off the matching functions.
+glm::vec3 D65WhiteScale() {
+    static const glm::vec3 scale = [] {
+        glm::vec3 sum(0.0f);
+        for (int i = 0; i < REFERENCE_SPECTRAL_SAMPLES; ++i) {
+            sum += REFERENCE_D65[i] * glm::vec3(REFERENCE_CIE_X[i], REFERENCE_CIE_Y[i], REFERENCE_CIE_Z[i]);
+        }
+        return D65_WHITE_XYZ / (sum * ((LAMBDA_MAX - LAMBDA_MIN) / (REFERENCE_SPECTRAL_SAMPLES - 1)));
+    }();
+    return scale;
 }
 
-Spectrum::Spectrum(const std::array<float, SPECTRAL_SAMPLES>& s) : samples(s) {
+// Brighter colours than a reflectance can hold (emission, IORs) are fitted at half their
+// peak and scaled back up, as pbrt's RGBUnboundedSpectrum does
+float UpliftScale(const glm::vec3& rgb) {
+    float peak = (std::max)(rgb.r, (std::max)(rgb.g, rgb.b));
+    return peak > 1.0f ? 2.0f * peak : 1.0f;
+}
 }
 
-Spectrum Spectrum::FromRGB(const glm::vec3& rgb) {
-    // Convert RGB to spectrum using Smits' method (simplified)
-    Spectrum result;
-    
-    // White point scaling
-    float white = std::max({rgb.r, rgb.g, rgb.b});
-    if (white > 0.0f) {
-        glm::vec3 normalized = rgb / white;
+// Spectrum implementation
+template <int N>
+const typename SampledSpectrum<N>::Tables& SampledSpectrum<N>::GetTables() {
+    // Box-average each reference table over the coarser bins; identity at the reference count
+    static const Tables tables = [] {
+        Tables t = {};
+        float scale = static_cast<float>(REFERENCE_SPECTRAL_SAMPLES) / N;
+        for (int i = 0; i < N; ++i) {
+            float begin = i * scale;
+            float end = begin + scale;
+            float x = 0.0f, y = 0.0f, z = 0.0f, d65 = 0.0f;
+            for (int r = static_cast<int>(begin); r < REFERENCE_SPECTRAL_SAMPLES && r < end; ++r) {
+                float overlap = (std::min)(end, r + 1.0f) - (std::max)(begin, static_cast<float>(r));
+                x += REFERENCE_CIE_X[r] * overlap;
+                y += REFERENCE_CIE_Y[r] * overlap;
+                z += REFERENCE_CIE_Z[r] * overlap;
+                d65 += REFERENCE_D65[r] * overlap;
+            }
+            t.cieX[i] = x / scale;
+            t.cieY[i] = y / scale;
+            t.cieZ[i] = z / scale;
+            t.d65[i] = d65 / scale;
+        }
         
-        // Simple RGB to spectrum conversion (could be improved with proper basis functions)
-        for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-            float lambda = indexToWavelength(i);
-            float r_weight = std::exp(-std::pow((lambda - 700.0f) / 100.0f, 2.0f));
-            float g_weight = std::exp(-std::pow((lambda - 546.1f) / 100.0f, 2.0f));
-            float b_weight = std::exp(-std::pow((lambda - 435.8f) / 100.0f, 2.0f));
-            
-            result[i] = white * (normalized.r * r_weight + normalized.g * g_weight + normalized.b * b_weight);
+        // Weight by D65 and normalise so a constant 1 lands on the white point, which folds
+        // the bin width in as well
+        glm::vec3 white(0.0f);
+        for (int i = 0; i < N; ++i) white += t.d65[i] * glm::vec3(t.cieX[i], t.cieY[i], t.cieZ[i]);
+        glm::vec3 weight = D65_WHITE_XYZ / white;
+        for (int i = 0; i < N; ++i) {
+            t.cieX[i] *= t.d65[i] * weight.x;
+            t.cieY[i] *= t.d65[i] * weight.y;
+            t.cieZ[i] *= t.d65[i] * weight.z;
         }
+        return t;
+    }();
+    return tables;
+}
+
+template <int N>
+SampledSpectrum<N> SampledSpectrum<N>::FromReference(const float* reference) {
+    if (IS_RGB) {
+        SampledSpectrum<REFERENCE_SPECTRAL_SAMPLES> full;
+        for (int i = 0; i < REFERENCE_SPECTRAL_SAMPLES; ++i) full[i] = reference[i];
+        glm::vec3 rgb = full.toRGB();
+        return FromRGB(rgb);
     }
     
+    SampledSpectrum result;
+    float scale = static_cast<float>(REFERENCE_SPECTRAL_SAMPLES) / N;
+    for (int i = 0; i < N; ++i) {
+        float begin = i * scale;
+        float end = begin + scale;
+        float sum = 0.0f;
+        for (int r = static_cast<int>(begin); r < REFERENCE_SPECTRAL_SAMPLES && r < end; ++r) {
+            sum += reference[r] * ((std::min)(end, r + 1.0f) - (std::max)(begin, static_cast<float>(r)));
+        }
+        result[i] = sum / scale;
+    }
     return result;
 }
 
-Spectrum Spectrum::FromBlackbody(float temperature) {
-    Spectrum result;
-    
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        float lambda = indexToWavelength(i) * 1e-9f; // Convert nm to m
-        result[i] = SpectralUtils::PlanckianLocus(lambda, temperature);
+template <int N>
+SampledSpectrum<N> SampledSpectrum<N>::FromRGB(const glm::vec3& rgb) {
+    SampledSpectrum result;
+    if (IS_RGB) {
+        result[0] = rgb.r;
+        result[1] = rgb.g;
+        result[2] = rgb.b;
+        return result;
     }
     
+    // One table lookup, then the fitted sigmoid at each sample
+    float scale = UpliftScale(rgb);
+    SigmoidPolynomial polynomial = RGBToSpectrumTable::Get().Lookup(rgb / scale);
+    for (int i = 0; i < N; ++i) {
+        result[i] = scale * polynomial(indexToWavelength(i));
+    }
     return result;
 }
 
-glm::vec3 Spectrum::toXYZ() const {
-    glm::vec3 xyz(0.0f);
-    float dlambda = (LAMBDA_MAX - LAMBDA_MIN) / SPECTRAL_SAMPLES;
-    
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        xyz.x += samples[i] * CIE_X[i] * dlambda;
-        xyz.y += samples[i] * CIE_Y[i] * dlambda;
-        xyz.z += samples[i] * CIE_Z[i] * dlambda;
+template <int N>
+SampledSpectrum<N> SampledSpectrum<N>::FromXYZ(const glm::vec3& xyz) {
+    return FromRGB(XYZ_TO_RGB * xyz);
+}
+
+template <int N>
+SampledSpectrum<N> SampledSpectrum<N>::FromBlackbody(float temperature) {
+    // Relative to D65 like every other spectrum, at unit luminance
+    SampledSpectrum<REFERENCE_SPECTRAL_SAMPLES> relative;
+    for (int i = 0; i < REFERENCE_SPECTRAL_SAMPLES; ++i) {
+        float lambda = SampledSpectrum<REFERENCE_SPECTRAL_SAMPLES>::indexToWavelength(i) * 1e-9f; // Convert nm to m
+        relative[i] = SpectralUtils::PlanckianLocus(lambda, temperature) / REFERENCE_D65[i];
     }
+    float luminance = relative.luminance();
     
-    return xyz;
+    float reference[REFERENCE_SPECTRAL_SAMPLES];
+    for (int i = 0; i < REFERENCE_SPECTRAL_SAMPLES; ++i) {
+        reference[i] = luminance > 0.0f ? relative[i] / luminance : 0.0f;
+    }
+    return FromReference(reference);
 }
 
-glm::vec3 Spectrum::toRGB() const {
-    glm::vec3 xyz = toXYZ();
-    return XYZ_TO_RGB * xyz;
+template <int N>
+SampledSpectrum<N> SampledSpectrum<N>::FromD65Illuminant() {
+    // Spectra are relative to D65, so D65 at unit luminance is flat
+    return SampledSpectrum(1.0f);
 }
 
-float Spectrum::luminance() const {
-    float y = 0.0f;
-    float dlambda = (LAMBDA_MAX - LAMBDA_MIN) / SPECTRAL_SAMPLES;
-    
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        y += samples[i] * CIE_Y[i] * dlambda;
+template <int N>
+glm::vec3 SampledSpectrum<N>::toXYZ() const {
+    if (IS_RGB) {
+        return RGB_TO_XYZ * glm::vec3(samples[0], samples[1], samples[2]);
     }
     
-    return y;
+    const Tables& tables = GetTables();
+    return glm::vec3(SpectrumKernels::Dot(samples, tables.cieX, PADDED_SAMPLES),
+                     SpectrumKernels::Dot(samples, tables.cieY, PADDED_SAMPLES),
+                     SpectrumKernels::Dot(samples, tables.cieZ, PADDED_SAMPLES));
 }
 
-// Spectrum operators
-Spectrum Spectrum::operator+(const Spectrum& other) const {
-    Spectrum result;
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        result[i] = samples[i] + other[i];
+template <int N>
+glm::vec3 SampledSpectrum<N>::toRGB() const {
+    if (IS_RGB) {
+        return glm::vec3(samples[0], samples[1], samples[2]);
     }
-    return result;
+    
+    glm::vec3 xyz = toXYZ();
+    return XYZ_TO_RGB * xyz;
 }
 
-Spectrum Spectrum::operator*(const Spectrum& other) const {
-    Spectrum result;
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        result[i] = samples[i] * other[i];
+template <int N>
+float SampledSpectrum<N>::luminance() const {
+    if (IS_RGB) {
+        return toXYZ().y;
     }
-    return result;
+    
+    return SpectrumKernels::Dot(samples, GetTables().cieY, PADDED_SAMPLES);
 }
 
-Spectrum Spectrum::operator*(float scalar) const {
-    Spectrum result;
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        result[i] = samples[i] * scalar;
-    }
-    return result;
+template <int N>
+float SampledSpectrum<N>::integrate() const {
+    return SpectrumKernels::Sum(samples, PADDED_SAMPLES) * (LAMBDA_MAX - LAMBDA_MIN) / N;
 }
 
-Spectrum Spectrum::operator-(const Spectrum& other) const {
-    Spectrum result;
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        result[i] = samples[i] - other[i];
-    }
-    return result;
+template <int N>
+float SampledSpectrum<N>::indexToWavelength(int index) {
+    return LAMBDA_MIN + (LAMBDA_MAX - LAMBDA_MIN) * index / (std::max)(N - 1, 1);
 }
 
-Spectrum Spectrum::operator/(float scalar) const {
-    Spectrum result;
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        result[i] = samples[i] / scalar;
-    }
-    return result;
+template <int N>
+float SampledSpectrum<N>::wavelengthToIndex(float lambda) {
+    return (lambda - LAMBDA_MIN) / (LAMBDA_MAX - LAMBDA_MIN) * (std::max)(N - 1, 1);
 }
 
-Spectrum Spectrum::operator/(const Spectrum& other) const {
-    Spectrum result;
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        result[i] = other[i] != 0.0f ? samples[i] / other[i] : 0.0f;
+template <int N>
+float SampledSpectrum<N>::evaluate(float lambda) const {
+    if (IS_RGB) {
+        glm::vec3 rgb(samples[0], samples[1], samples[2]);
+        float scale = UpliftScale(rgb);
+        return scale * RGBToSpectrumTable::Get().Lookup(rgb / scale)(lambda);
+    }
+    
+    float x = wavelengthToIndex(lambda);
+    if (x <= 0.0f) return samples[0];
+    if (x >= N - 1) return samples[N - 1];
+    int i = static_cast<int>(x);
+    float t = x - i;
+    return samples[i] + (samples[i + 1] - samples[i]) * t;
+}
+
+template <int N>
+SampledSpectrum<4> SampledSpectrum<N>::sample(const SampledWavelengths& wavelengths) const {
+    SampledSpectrum<4> result;
+    if (IS_RGB) {
+        // One lookup for all the wavelengths
+        glm::vec3 rgb(samples[0], samples[1], samples[2]);
+        float scale = UpliftScale(rgb);
+        SigmoidPolynomial polynomial = RGBToSpectrumTable::Get().Lookup(rgb / scale);
+        for (int i = 0; i < SampledWavelengths::COUNT; ++i) {
+            result[i] = scale * polynomial(wavelengths.lambda[i]);
+        }
+        return result;
+    }
+    for (int i = 0; i < SampledWavelengths::COUNT; ++i) {
+        result[i] = evaluate(wavelengths.lambda[i]);
     }
     return result;
 }
 
-// Assignment operators
-Spectrum& Spectrum::operator+=(const Spectrum& other) {
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        samples[i] += other[i];
-    }
-    return *this;
-}
+// RGB previews, hero-wavelength previews and the reference resolution
+template class SampledSpectrum<3>;
+template class SampledSpectrum<4>;
+template class SampledSpectrum<REFERENCE_SPECTRAL_SAMPLES>;
 
-Spectrum& Spectrum::operator-=(const Spectrum& other) {
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        samples[i] -= other[i];
+// SampledWavelengths implementation
+SampledWavelengths SampledWavelengths::SampleUniform(float u) {
+    SampledWavelengths result;
+    float range = LAMBDA_MAX - LAMBDA_MIN;
+    result.lambda[0] = LAMBDA_MIN + u * range;
+    for (int i = 1; i < COUNT; ++i) {
+        float lambda = result.lambda[0] + i * range / COUNT;
+        result.lambda[i] = lambda > LAMBDA_MAX ? lambda - range : lambda;
     }
-    return *this;
-}
-
-Spectrum& Spectrum::operator*=(const Spectrum& other) {
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        samples[i] *= other[i];
+    for (int i = 0; i < COUNT; ++i) {
+        result.pdf[i] = 1.0f / range;
     }
-    return *this;
+    return result;
 }
 
-Spectrum& Spectrum::operator*=(float scalar) {
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        samples[i] *= scalar;
+void SampledWavelengths::TerminateSecondary() {
+    if (SecondaryTerminated()) return;
+    for (int i = 1; i < COUNT; ++i) {
+        pdf[i] = 0.0f;
     }
-    return *this;
+    pdf[0] /= COUNT;
 }
 
-Spectrum& Spectrum::operator/=(float scalar) {
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        samples[i] /= scalar;
+bool SampledWavelengths::SecondaryTerminated() const {
+    for (int i = 1; i < COUNT; ++i) {
+        if (pdf[i] != 0.0f) return false;
     }
-    return *this;
+    return true;
 }
 
-float Spectrum::integrate() const {
-    float sum = 0.0f;
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        sum += samples[i];
+glm::vec3 SampledWavelengths::ToXYZ(const HeroSpectrum& values) const {
+    glm::vec3 xyz(0.0f);
+    for (int i = 0; i < COUNT; ++i) {
+        if (pdf[i] == 0.0f) continue;
+        float weight = values[i] * InterpolateReference(REFERENCE_D65, lambda[i]) / pdf[i];
+        xyz.x += InterpolateReference(REFERENCE_CIE_X, lambda[i]) * weight;
+        xyz.y += InterpolateReference(REFERENCE_CIE_Y, lambda[i]) * weight;
+        xyz.z += InterpolateReference(REFERENCE_CIE_Z, lambda[i]) * weight;
     }
-    return sum * (LAMBDA_MAX - LAMBDA_MIN) / SPECTRAL_SAMPLES;
+    return xyz * D65WhiteScale() / static_cast<float>(COUNT);
 }
 
-bool Spectrum::isBlack() const {
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        if (samples[i] != 0.0f) return false;
-    }
-    return true;
+glm::vec3 SampledWavelengths::ToRGB(const HeroSpectrum& values) const {
+    return XYZ_TO_RGB * ToXYZ(values);
 }
 
-void Spectrum::clamp(float min, float max) {
-    for (int i = 0; i < SPECTRAL_SAMPLES; ++i) {
-        if (samples[i] < min) samples[i] = min;
-        else if (samples[i] > max) samples[i] = max;
+Spectrum SampledWavelengths::ToSpectrum(const HeroSpectrum& values) const {
+    if (Spectrum::IS_RGB) {
+        return Spectrum::FromRGB(ToRGB(values));
     }
-}
-
-float Spectrum::indexToWavelength(int index) {
-    return LAMBDA_MIN + (LAMBDA_MAX - LAMBDA_MIN) * index / (SPECTRAL_SAMPLES - 1);
+    
+    // Each wavelength's estimate is shared between its two neighbouring samples
+    Spectrum result(0.0f);
+    float sampleWidth = (LAMBDA_MAX - LAMBDA_MIN) / SPECTRAL_SAMPLES;
+    for (int i = 0; i < COUNT; ++i) {
+        if (pdf[i] == 0.0f) continue;
+        float density = values[i] / (pdf[i] * COUNT * sampleWidth);
+        float x = glm::clamp(Spectrum::wavelengthToIndex(lambda[i]), 0.0f, static_cast<float>(SPECTRAL_SAMPLES - 1));
+        int index = (std::min)(static_cast<int>(x), SPECTRAL_SAMPLES - 2);
+        float t = x - index;
+        result[index] += density * (1.0f - t);
+        result[index + 1] += density * t;
+    }
+    return result;
 }
 
 // TrowbridgeReitzDistribution (GGX) implementation
@@ -297,6 +414,10 @@ FresnelConductor::FresnelConductor(const Spectrum& etaI, const Spectrum& etaT, c
     : etaI(etaI), etaT(etaT), k(k) {}
 
 Spectrum FresnelDielectric::Evaluate(float cosThetaI) const {
+    return Spectrum(Reflectance(cosThetaI));
+}
+
+float FresnelDielectric::Reflectance(float cosThetaI) const {
     cosThetaI = glm::clamp(cosThetaI, -1.0f, 1.0f);
     
     bool entering = cosThetaI > 0.0f;
@@ -306,7 +427,7 @@ Spectrum FresnelDielectric::Evaluate(float cosThetaI) const {
     float sinThetaI = std::sqrt(std::max(0.0f, 1 - cosThetaI * cosThetaI));
     float sinThetaT = etaI_local / etaT_local * sinThetaI;
     
-    if (sinThetaT >= 1) return Spectrum(1.0f); // Total internal reflection
+    if (sinThetaT >= 1) return 1.0f; // Total internal reflection
     
     float cosThetaT = std::sqrt(std::max(0.0f, 1 - sinThetaT * sinThetaT));
     
@@ -315,7 +436,7 @@ Spectrum FresnelDielectric::Evaluate(float cosThetaI) const {
     float Rperp = ((etaI_local * cosThetaI) - (etaT_local * cosThetaT)) /
                   ((etaI_local * cosThetaI) + (etaT_local * cosThetaT));
     
-    return Spectrum((Rparl * Rparl + Rperp * Rperp) / 2.0f);
+    return (Rparl * Rparl + Rperp * Rperp) / 2.0f;
 }
 
 // MicrofacetReflection constructor implementation
@@ -346,6 +467,25 @@ Spectrum FresnelConductor::Evaluate(float cosThetaI) const {
     return (rParl2 + rPerp2) * 0.5f;
 }
 
+HeroSpectrum FresnelConductor::EvaluateHero(float cosThetaI, const SampledWavelengths& wavelengths) const {
+    // Same as Evaluate, on the optical constants at the hero wavelengths
+    float clampedCosThetaI = glm::clamp(cosThetaI, -1.0f, 1.0f);
+    HeroSpectrum heroEtaI = etaI.sample(wavelengths);
+    HeroSpectrum eta = etaT.sample(wavelengths) / heroEtaI;
+    HeroSpectrum etaK = k.sample(wavelengths) / heroEtaI;
+    float cosThetaI2 = clampedCosThetaI * clampedCosThetaI;
+    HeroSpectrum tmp = (eta * eta + etaK * etaK);
+    HeroSpectrum rParl2 = (tmp - 2.0f * eta * clampedCosThetaI + cosThetaI2) /
+                          (tmp + 2.0f * eta * clampedCosThetaI + cosThetaI2);
+    HeroSpectrum rPerp2 = (tmp * cosThetaI2 - 2.0f * eta * clampedCosThetaI + 1.0f) /
+                          (tmp * cosThetaI2 + 2.0f * eta * clampedCosThetaI + 1.0f);
+    return (rParl2 + rPerp2) * 0.5f;
+}
+
+HeroSpectrum Fresnel::EvaluateHero(float cosThetaI, const SampledWavelengths& wavelengths) const {
+    return Evaluate(cosThetaI).sample(wavelengths);
+}
+
 // LambertianReflection constructor (j implementado acima, mas duplicado para garantir)
 LambertianReflection::LambertianReflection(const Spectrum& R) : R(R) {}
 
@@ -365,6 +505,16 @@ float MicrofacetReflection::Pdf(const glm::vec3& wo, const glm::vec3& wi) const
     return MonteCarlo::CosineHemispherePdf(SpectralUtils::CosTheta(wi));
 }
 
+HeroSpectrum MicrofacetReflection::fHero(const glm::vec3& wo, const glm::vec3& wi, const SampledWavelengths& wavelengths) const {
+    return R.sample(wavelengths);
+}
+HeroSpectrum MicrofacetReflection::Sample_fHero(const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u, float* pdf,
+                                                const SampledWavelengths& wavelengths) const {
+    *wi = MonteCarlo::CosineSampleHemisphere(u);
+    *pdf = MonteCarlo::CosineHemispherePdf(SpectralUtils::CosTheta(*wi));
+    return fHero(wo, *wi, wavelengths);
+}
+
 // MicrofacetTransmission methods (stubs)
 Spectrum MicrofacetTransmission::f(const glm::vec3& wo, const glm::vec3& wi) const {
     // Implementao simplificada: retorna T
@@ -377,6 +527,16 @@ Spectrum MicrofacetTransmission::Sample_f(const glm::vec3& wo, glm::vec3* wi, co
     return f(wo, *wi);
 }
 
+HeroSpectrum MicrofacetTransmission::fHero(const glm::vec3& wo, const glm::vec3& wi, const SampledWavelengths& wavelengths) const {
+    return T.sample(wavelengths);
+}
+HeroSpectrum MicrofacetTransmission::Sample_fHero(const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u, float* pdf,
+                                                  const SampledWavelengths& wavelengths) const {
+    *wi = MonteCarlo::CosineSampleHemisphere(u);
+    *pdf = MonteCarlo::CosineHemispherePdf(SpectralUtils::CosTheta(*wi));
+    return fHero(wo, *wi, wavelengths);
+}
+
 // BRDF default implementations
 Spectrum BRDF::Sample_f(const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u, float* pdf) const {
     *wi = MonteCarlo::CosineSampleHemisphere(u);
@@ -386,6 +546,13 @@ Spectrum BRDF::Sample_f(const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u,
 float BRDF::Pdf(const glm::vec3& wo, const glm::vec3& wi) const {
     return MonteCarlo::CosineHemispherePdf(SpectralUtils::CosTheta(wi));
 }
+HeroSpectrum BRDF::fHero(const glm::vec3& wo, const glm::vec3& wi, const SampledWavelengths& wavelengths) const {
+    return f(wo, wi).sample(wavelengths);
+}
+HeroSpectrum BRDF::Sample_fHero(const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u, float* pdf,
+                                const SampledWavelengths& wavelengths) const {
+    return Sample_f(wo, wi, u, pdf).sample(wavelengths);
+}
 
 // LambertianReflection implementations
 Spectrum LambertianReflection::f(const glm::vec3& wo, const glm::vec3& wi) const {
@@ -397,6 +564,16 @@ Spectrum LambertianReflection::Sample_f(const glm::vec3& wo, glm::vec3* wi, cons
     *pdf = Pdf(wo, *wi);
     return f(wo, *wi);
 }
+HeroSpectrum LambertianReflection::fHero(const glm::vec3& wo, const glm::vec3& wi, const SampledWavelengths& wavelengths) const {
+    return R.sample(wavelengths) * (1.0f / M_PI);
+}
+HeroSpectrum LambertianReflection::Sample_fHero(const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u, float* pdf,
+                                                const SampledWavelengths& wavelengths) const {
+    *wi = MonteCarlo::CosineSampleHemisphere(u);
+    if (wo.z < 0) wi->z *= -1;
+    *pdf = Pdf(wo, *wi);
+    return fHero(wo, *wi, wavelengths);
+}
 
 // Utility functions
 namespace SpectralUtils {
@@ -411,6 +588,14 @@ namespace SpectralUtils {
     glm::vec3 SphericalDirection(float sinTheta, float cosTheta, float phi) {
         return glm::vec3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
     }
+    // Branchless orthonormal basis around a unit vector (Duff et al. 2017)
+    void CoordinateSystem(const glm::vec3& v1, glm::vec3* v2, glm::vec3* v3) {
+        float sign = std::copysign(1.0f, v1.z);
+        float a = -1.0f / (sign + v1.z);
+        float b = v1.x * v1.y * a;
+        *v2 = glm::vec3(1.0f + sign * v1.x * v1.x * a, sign * b, -sign * v1.x);
+        *v3 = glm::vec3(b, sign + v1.y * v1.y * a, -v1.y);
+    }
     float PlanckianLocus(float lambda, float temperature) {
         const float h = 6.62607015e-34f; // Planck constant
         const float c = 299792458.0f;    // Speed of light
@@ -449,8 +634,3 @@ namespace MonteCarlo {
         return cosTheta / M_PI;
     }
 }
-
-// Global operators implementation
-Spectrum operator*(float scalar, const Spectrum& spectrum) {
-    return spectrum * scalar;
-}
\ No newline at end of file
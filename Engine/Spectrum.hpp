@@ -9,37 +9,205 @@
 #include <vector>
 #include <string>
 #include <limits>
+#include <immintrin.h>
 
 // Spectral rendering based on PBR book Chapter 5
-constexpr int SPECTRAL_SAMPLES = 60;
+//
+// Samples per Spectrum for the integrators and materials, fixed at build time: 60 for reference
+// renders, 4 for hero-wavelength previews, or 3 to carry linear RGB for quick previews
+#ifndef SPECTRUM_SAMPLE_COUNT
+#define SPECTRUM_SAMPLE_COUNT 60
+#endif
+
+constexpr int SPECTRAL_SAMPLES = SPECTRUM_SAMPLE_COUNT;
+constexpr int REFERENCE_SPECTRAL_SAMPLES = 60; // Resolution of the CIE and D65 tables
 constexpr float LAMBDA_MIN = 400.0f; // nm
 constexpr float LAMBDA_MAX = 700.0f; // nm
 
-class Spectrum {
+// Element-wise kernels over whole 4-float blocks. The AVX path is taken when the compiler
+// targets it (/arch:AVX). Loads are unaligned because std::vector only promises 8 or 16 bytes
+// before C++17; on data that is aligned they cost the same as aligned loads.
+namespace SpectrumKernels {
+    inline void Add(float* out, const float* a, const float* b, int count) {
+        int i = 0;
+#ifdef __AVX__
+        for (; i + 8 <= count; i += 8) _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+#endif
+        for (; i < count; i += 4) _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+
+    inline void Sub(float* out, const float* a, const float* b, int count) {
+        int i = 0;
+#ifdef __AVX__
+        for (; i + 8 <= count; i += 8) _mm256_storeu_ps(out + i, _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+#endif
+        for (; i < count; i += 4) _mm_storeu_ps(out + i, _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+
+    inline void Mul(float* out, const float* a, const float* b, int count) {
+        int i = 0;
+#ifdef __AVX__
+        for (; i + 8 <= count; i += 8) _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+#endif
+        for (; i < count; i += 4) _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+
+    // Lanes where b is zero come out as zero rather than inf/NaN
+    inline void SafeDiv(float* out, const float* a, const float* b, int count) {
+        int i = 0;
+#ifdef __AVX__
+        for (; i + 8 <= count; i += 8) {
+            __m256 vb = _mm256_loadu_ps(b + i);
+            __m256 nonZero = _mm256_cmp_ps(vb, _mm256_setzero_ps(), _CMP_NEQ_OQ);
+            _mm256_storeu_ps(out + i, _mm256_and_ps(nonZero, _mm256_div_ps(_mm256_loadu_ps(a + i), vb)));
+        }
+#endif
+        for (; i < count; i += 4) {
+            __m128 vb = _mm_loadu_ps(b + i);
+            __m128 nonZero = _mm_cmpneq_ps(vb, _mm_setzero_ps());
+            _mm_storeu_ps(out + i, _mm_and_ps(nonZero, _mm_div_ps(_mm_loadu_ps(a + i), vb)));
+        }
+    }
+
+    inline void Scale(float* out, const float* a, float scalar, int count) {
+        int i = 0;
+#ifdef __AVX__
+        __m256 s8 = _mm256_set1_ps(scalar);
+        for (; i + 8 <= count; i += 8) _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), s8));
+#endif
+        __m128 s4 = _mm_set1_ps(scalar);
+        for (; i < count; i += 4) _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), s4));
+    }
+
+    inline void Divide(float* out, const float* a, float scalar, int count) {
+        int i = 0;
+#ifdef __AVX__
+        __m256 s8 = _mm256_set1_ps(scalar);
+        for (; i + 8 <= count; i += 8) _mm256_storeu_ps(out + i, _mm256_div_ps(_mm256_loadu_ps(a + i), s8));
+#endif
+        __m128 s4 = _mm_set1_ps(scalar);
+        for (; i < count; i += 4) _mm_storeu_ps(out + i, _mm_div_ps(_mm_loadu_ps(a + i), s4));
+    }
+
+    // out += a * b
+    inline void MulAdd(float* out, const float* a, const float* b, int count) {
+        int i = 0;
+#ifdef __AVX__
+        for (; i + 8 <= count; i += 8) {
+            __m256 product = _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+            _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), product));
+        }
+#endif
+        for (; i < count; i += 4) {
+            __m128 product = _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), product));
+        }
+    }
+
+    // out += a * scalar
+    inline void ScaleAdd(float* out, const float* a, float scalar, int count) {
+        int i = 0;
+#ifdef __AVX__
+        __m256 s8 = _mm256_set1_ps(scalar);
+        for (; i + 8 <= count; i += 8) {
+            _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(_mm256_loadu_ps(a + i), s8)));
+        }
+#endif
+        __m128 s4 = _mm_set1_ps(scalar);
+        for (; i < count; i += 4) {
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(a + i), s4)));
+        }
+    }
+
+    inline void Clamp(float* out, float minValue, float maxValue, int count) {
+        __m128 lo = _mm_set1_ps(minValue);
+        __m128 hi = _mm_set1_ps(maxValue);
+        for (int i = 0; i < count; i += 4) {
+            _mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(out + i), lo), hi));
+        }
+    }
+
+    inline float HorizontalSum(__m128 v) {
+        __m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+    }
+
+    inline float Dot(const float* a, const float* b, int count) {
+        __m128 sum = _mm_setzero_ps();
+        for (int i = 0; i < count; i += 4) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        }
+        return HorizontalSum(sum);
+    }
+
+    inline float Sum(const float* a, int count) {
+        __m128 sum = _mm_setzero_ps();
+        for (int i = 0; i < count; i += 4) {
+            sum = _mm_add_ps(sum, _mm_loadu_ps(a + i));
+        }
+        return HorizontalSum(sum);
+    }
+
+    inline bool AllZero(const float* a, int count) {
+        __m128 any = _mm_setzero_ps();
+        for (int i = 0; i < count; i += 4) {
+            any = _mm_or_ps(any, _mm_cmpneq_ps(_mm_loadu_ps(a + i), _mm_setzero_ps()));
+        }
+        return _mm_movemask_ps(any) == 0;
+    }
+}
+
+struct SampledWavelengths;
+
+// N samples spread evenly over [LAMBDA_MIN, LAMBDA_MAX], or linear RGB when N is 3. Storage is
+// rounded up to whole SSE vectors and the padding lanes are kept at zero, so every operation
+// runs branch-free over the padded array. Operators are inline so chains of them in the
+// integrators compile down to a few vector instructions per block instead of calls.
+template <int N>
+class alignas(16) SampledSpectrum {
 public:
-    Spectrum(float value = 0.0f);
-    Spectrum(const std::array<float, SPECTRAL_SAMPLES>& samples);
+    static constexpr int SAMPLES = N;
+    static constexpr int PADDED_SAMPLES = (N + 3) & ~3;
+    static constexpr bool IS_RGB = N == 3;
+
+    SampledSpectrum(float value = 0.0f) {
+        for (int i = 0; i < PADDED_SAMPLES; ++i) samples[i] = i < N ? value : 0.0f;
+    }
+    SampledSpectrum(const std::array<float, N>& values) {
+        for (int i = 0; i < PADDED_SAMPLES; ++i) samples[i] = i < N ? values[i] : 0.0f;
+    }
     
     // Factory methods for common spectra
-    static Spectrum FromRGB(const glm::vec3& rgb);
-    static Spectrum FromXYZ(const glm::vec3& xyz);
-    static Spectrum FromBlackbody(float temperature); // Kelvin
-    static Spectrum FromD65Illuminant();
+    static SampledSpectrum FromRGB(const glm::vec3& rgb);
+    static SampledSpectrum FromXYZ(const glm::vec3& xyz);
+    static SampledSpectrum FromBlackbody(float temperature); // Kelvin
+    static SampledSpectrum FromD65Illuminant();
     
     // Spectral operations
-    Spectrum operator+(const Spectrum& other) const;
-    Spectrum operator-(const Spectrum& other) const;
-    Spectrum operator*(const Spectrum& other) const;
-    Spectrum operator*(float scalar) const;
-    Spectrum operator/(float scalar) const;
-    Spectrum operator/(const Spectrum& other) const;
+    SampledSpectrum operator+(const SampledSpectrum& other) const { SampledSpectrum r(NoInit{}); SpectrumKernels::Add(r.samples, samples, other.samples, PADDED_SAMPLES); return r; }
+    SampledSpectrum operator-(const SampledSpectrum& other) const { SampledSpectrum r(NoInit{}); SpectrumKernels::Sub(r.samples, samples, other.samples, PADDED_SAMPLES); return r; }
+    SampledSpectrum operator*(const SampledSpectrum& other) const { SampledSpectrum r(NoInit{}); SpectrumKernels::Mul(r.samples, samples, other.samples, PADDED_SAMPLES); return r; }
+    SampledSpectrum operator*(float scalar) const { SampledSpectrum r(NoInit{}); SpectrumKernels::Scale(r.samples, samples, scalar, PADDED_SAMPLES); r.zeroPadding(); return r; }
+    SampledSpectrum operator/(float scalar) const { SampledSpectrum r(NoInit{}); SpectrumKernels::Divide(r.samples, samples, scalar, PADDED_SAMPLES); r.zeroPadding(); return r; }
+    SampledSpectrum operator/(const SampledSpectrum& other) const { SampledSpectrum r(NoInit{}); SpectrumKernels::SafeDiv(r.samples, samples, other.samples, PADDED_SAMPLES); return r; }
     
     // Assignment operators
-    Spectrum& operator+=(const Spectrum& other);
-    Spectrum& operator-=(const Spectrum& other);
-    Spectrum& operator*=(const Spectrum& other);
-    Spectrum& operator*=(float scalar);
-    Spectrum& operator/=(float scalar);
+    SampledSpectrum& operator+=(const SampledSpectrum& other) { SpectrumKernels::Add(samples, samples, other.samples, PADDED_SAMPLES); return *this; }
+    SampledSpectrum& operator-=(const SampledSpectrum& other) { SpectrumKernels::Sub(samples, samples, other.samples, PADDED_SAMPLES); return *this; }
+    SampledSpectrum& operator*=(const SampledSpectrum& other) { SpectrumKernels::Mul(samples, samples, other.samples, PADDED_SAMPLES); return *this; }
+    SampledSpectrum& operator*=(float scalar) { SpectrumKernels::Scale(samples, samples, scalar, PADDED_SAMPLES); zeroPadding(); return *this; }
+    SampledSpectrum& operator/=(float scalar) { SpectrumKernels::Divide(samples, samples, scalar, PADDED_SAMPLES); zeroPadding(); return *this; }
+    
+    // Fused forms of the integrators' accumulations, without the temporary:
+    // L += a * b, L += a * k and beta *= f * k
+    SampledSpectrum& addProduct(const SampledSpectrum& a, const SampledSpectrum& b) { SpectrumKernels::MulAdd(samples, a.samples, b.samples, PADDED_SAMPLES); return *this; }
+    SampledSpectrum& addScaled(const SampledSpectrum& a, float scalar) { SpectrumKernels::ScaleAdd(samples, a.samples, scalar, PADDED_SAMPLES); zeroPadding(); return *this; }
+    SampledSpectrum& mulScaled(const SampledSpectrum& f, float scalar) {
+        SpectrumKernels::Mul(samples, samples, f.samples, PADDED_SAMPLES);
+        SpectrumKernels::Scale(samples, samples, scalar, PADDED_SAMPLES);
+        zeroPadding();
+        return *this;
+    }
     
     // Color space conversions
     glm::vec3 toRGB() const;
@@ -48,8 +216,13 @@ public:
     // Spectral utilities
     float integrate() const;
     float luminance() const;
-    bool isBlack() const;
-    void clamp(float min = 0.0f, float max = std::numeric_limits<float>::infinity());
+    float average() const { return SpectrumKernels::Sum(samples, PADDED_SAMPLES) / N; }
+    bool isBlack() const { return SpectrumKernels::AllZero(samples, PADDED_SAMPLES); }
+    void clamp(float min = 0.0f, float max = std::numeric_limits<float>::infinity()) {
+        // A range that excludes zero moves the padding lanes too
+        SpectrumKernels::Clamp(samples, min, max, PADDED_SAMPLES);
+        zeroPadding();
+    }
     
     // Sample access
     float& operator[](int i) { return samples[i]; }
@@ -59,20 +232,70 @@ public:
     static float wavelengthToIndex(float lambda);
     static float indexToWavelength(int index);
     
-private:
-    std::array<float, SPECTRAL_SAMPLES> samples;
+    // Value at any wavelength: interpolated between samples, or from FromRGB's fit in RGB builds
+    float evaluate(float lambda) const;
+    // Values at a path's hero wavelengths
+    SampledSpectrum<4> sample(const SampledWavelengths& wavelengths) const;
     
-    // Color matching functions and illuminants
-    static const std::array<float, SPECTRAL_SAMPLES> CIE_X;
-    static const std::array<float, SPECTRAL_SAMPLES> CIE_Y;
-    static const std::array<float, SPECTRAL_SAMPLES> CIE_Z;
-    static const std::array<float, SPECTRAL_SAMPLES> D65_ILLUMINANT;
-    
-    // RGB to spectrum conversion matrices
-    static const glm::mat3 RGB_TO_XYZ;
-    static const glm::mat3 XYZ_TO_RGB;
+private:
+    struct NoInit {};
+    explicit SampledSpectrum(NoInit) {}
+    
+    // A zero padding lane turns into NaN under 0/0 or 0*inf, so scalar kernels reset them
+    // afterwards; the loop is empty, and compiles away, when N is a multiple of 4
+    void zeroPadding() { for (int i = N; i < PADDED_SAMPLES; ++i) samples[i] = 0.0f; }
+    
+    alignas(16) float samples[PADDED_SAMPLES];
+    
+    // Color matching functions and D65, averaged down to this sample count and zero padded.
+    // The matching functions are premultiplied by D65 and scaled so a constant 1 is D65 white.
+    struct Tables {
+        alignas(16) float cieX[PADDED_SAMPLES];
+        alignas(16) float cieY[PADDED_SAMPLES];
+        alignas(16) float cieZ[PADDED_SAMPLES];
+        alignas(16) float d65[PADDED_SAMPLES];
+    };
+    static const Tables& GetTables();
+    
+    // A spectrum given at REFERENCE_SPECTRAL_SAMPLES, brought to this sample count
+    static SampledSpectrum FromReference(const float* reference);
 };
 
+// Instantiated in Spectrum.cpp for these counts only
+static_assert(SPECTRAL_SAMPLES == 3 || SPECTRAL_SAMPLES == 4 || SPECTRAL_SAMPLES == REFERENCE_SPECTRAL_SAMPLES,
+              "SPECTRUM_SAMPLE_COUNT must be 3, 4 or 60");
+
+using Spectrum = SampledSpectrum<SPECTRAL_SAMPLES>;
+
+// Hero-wavelength sampling (Wilkie et al. 2014): each camera path carries a few wavelengths, the
+// hero drawn uniformly and the rest spaced evenly after it, wrapping around the visible range.
+// Together they stratify the range, and BSDFs, Fresnel terms and emission are only evaluated
+// at those wavelengths.
+struct SampledWavelengths {
+    static constexpr int COUNT = 4;
+    
+    float lambda[COUNT]; // nm
+    float pdf[COUNT];    // Zero once a wavelength stops contributing
+    
+    static SampledWavelengths SampleUniform(float u);
+    
+    // Wavelength-dependent refraction sends each wavelength a different way; only the hero
+    // follows the path from then on, carrying the whole sample's weight
+    void TerminateSecondary();
+    bool SecondaryTerminated() const;
+    
+    // Monte Carlo estimates over the carried wavelengths, through the CIE tables
+    glm::vec3 ToXYZ(const SampledSpectrum<COUNT>& values) const;
+    glm::vec3 ToRGB(const SampledSpectrum<COUNT>& values) const;
+    
+    // Splats the estimate into a Spectrum whose toXYZ() matches ToXYZ(), so hero-wavelength
+    // radiance accumulates alongside full spectra
+    Spectrum ToSpectrum(const SampledSpectrum<COUNT>& values) const;
+};
+
+// Radiance along a path at its SampledWavelengths; convert it with those, not with toRGB()
+using HeroSpectrum = SampledSpectrum<SampledWavelengths::COUNT>;
+
 // Microfacet distribution functions from PBR Chapter 8
 class MicrofacetDistribution {
 public:
@@ -127,12 +350,15 @@ class Fresnel {
 public:
     virtual ~Fresnel() = default;
     virtual Spectrum Evaluate(float cosThetaI) const = 0;
+    // At the hero wavelengths only; the default samples the full evaluation
+    virtual HeroSpectrum EvaluateHero(float cosThetaI, const SampledWavelengths& wavelengths) const;
 };
 
 class FresnelConductor : public Fresnel {
 public:
     FresnelConductor(const Spectrum& etaI, const Spectrum& etaT, const Spectrum& k);
     Spectrum Evaluate(float cosThetaI) const override;
+    HeroSpectrum EvaluateHero(float cosThetaI, const SampledWavelengths& wavelengths) const override;
     
 private:
     Spectrum etaI, etaT, k;
@@ -142,14 +368,18 @@ class FresnelDielectric : public Fresnel {
 public:
     FresnelDielectric(float etaI, float etaT);
     Spectrum Evaluate(float cosThetaI) const override;
+    HeroSpectrum EvaluateHero(float cosThetaI, const SampledWavelengths&) const override { return HeroSpectrum(Reflectance(cosThetaI)); }
     
 private:
     float etaI, etaT;
+    
+    float Reflectance(float cosThetaI) const;
 };
 
 class FresnelNoOp : public Fresnel {
 public:
     Spectrum Evaluate(float) const override { return Spectrum(1.0f); }
+    HeroSpectrum EvaluateHero(float, const SampledWavelengths&) const override { return HeroSpectrum(1.0f); }
 };
 
 // Monte Carlo utilities from PBR Chapter 13
@@ -187,6 +417,12 @@ public:
     virtual Spectrum Sample_f(const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u, float* pdf) const;
     virtual float Pdf(const glm::vec3& wo, const glm::vec3& wi) const;
     
+    // Hero-wavelength forms, evaluated at the path's wavelengths only. The defaults sample the
+    // full spectrum; the BRDFs below override them to skip the other bins.
+    virtual HeroSpectrum fHero(const glm::vec3& wo, const glm::vec3& wi, const SampledWavelengths& wavelengths) const;
+    virtual HeroSpectrum Sample_fHero(const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u, float* pdf,
+                                      const SampledWavelengths& wavelengths) const;
+    
     // BRDF properties
     virtual bool isDelta() const { return false; }
     virtual bool hasSpecular() const { return false; }
@@ -200,6 +436,9 @@ public:
     
     Spectrum f(const glm::vec3& wo, const glm::vec3& wi) const override;
     Spectrum Sample_f(const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u, float* pdf) const override;
+    HeroSpectrum fHero(const glm::vec3& wo, const glm::vec3& wi, const SampledWavelengths& wavelengths) const override;
+    HeroSpectrum Sample_fHero(const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u, float* pdf,
+                              const SampledWavelengths& wavelengths) const override;
     
     bool hasDiffuse() const override { return true; }
     
@@ -229,6 +468,9 @@ public:
     
     Spectrum f(const glm::vec3& wo, const glm::vec3& wi) const override;
     Spectrum Sample_f(const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u, float* pdf) const override;
+    HeroSpectrum fHero(const glm::vec3& wo, const glm::vec3& wi, const SampledWavelengths& wavelengths) const override;
+    HeroSpectrum Sample_fHero(const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u, float* pdf,
+                              const SampledWavelengths& wavelengths) const override;
     float Pdf(const glm::vec3& wo, const glm::vec3& wi) const override;
     
     bool hasSpecular() const override { return true; }
@@ -247,6 +489,9 @@ public:
     
     Spectrum f(const glm::vec3& wo, const glm::vec3& wi) const override;
     Spectrum Sample_f(const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u, float* pdf) const override;
+    HeroSpectrum fHero(const glm::vec3& wo, const glm::vec3& wi, const SampledWavelengths& wavelengths) const override;
+    HeroSpectrum Sample_fHero(const glm::vec3& wo, glm::vec3* wi, const glm::vec2& u, float* pdf,
+                              const SampledWavelengths& wavelengths) const override;
     
 private:
     const Spectrum T;
@@ -286,4 +531,7 @@ namespace SpectralUtils {
 }
 
 // Global operators for Spectrum
-Spectrum operator*(float scalar, const Spectrum& spectrum);
\ No newline at end of file
+template <int N>
+inline SampledSpectrum<N> operator*(float scalar, const SampledSpectrum<N>& spectrum) {
+    return spectrum * scalar;
+}
\ No newline at end of file
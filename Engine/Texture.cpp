@@ -1,15 +1,19 @@
 #include "Texture.hpp"
+#include "TextureLoader.hpp"
+#include "CompressedImage.hpp"
 #include <iostream>
 
 // Include STB_IMAGE header - it should be available via vcpkg
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-Texture::Texture() : textureID(0), width(0), height(0), channels(0), isLoaded(false)
+TextureLoader* Texture::asyncLoader = nullptr;
+
+Texture::Texture() : textureID(0), width(0), height(0), channels(0), isLoaded(false), state(TextureState::UNLOADED), memorySize(0)
 {
 }
 
-Texture::Texture(const std::string& filePath) : textureID(0), width(0), height(0), channels(0), isLoaded(false)
+Texture::Texture(const std::string& filePath) : textureID(0), width(0), height(0), channels(0), isLoaded(false), state(TextureState::UNLOADED), memorySize(0)
 {
     loadFromFile(filePath);
 }
@@ -24,6 +28,12 @@ bool Texture::loadFromFile(const std::string& path)
     cleanup();
     this->filePath = path;
     
+    // A cooked DDS/KTX2 next to the source skips decoding and runtime mip generation
+    std::string compressedPath = CompressedImage::FindCompressedVariant(path);
+    if (!compressedPath.empty() && loadCompressed(compressedPath)) {
+        return true;
+    }
+    
     // Set STB_IMAGE to flip textures on Y axis to match OpenGL coordinate system
     stbi_set_flip_vertically_on_load(true);
     
@@ -78,12 +88,66 @@ bool Texture::loadFromFile(const std::string& path)
     glBindTexture(GL_TEXTURE_2D, 0);
     
     isLoaded = true;
+    state = TextureState::READY;
+    memorySize = EstimateMemorySize(width, height, channels);
     std::cout << "Successfully loaded texture: " << path 
               << " (" << width << "x" << height << ", " << channels << " channels, ID: " << textureID << ")" << std::endl;
     
     return true;
 }
 
+bool Texture::loadCompressed(const std::string& compressedPath)
+{
+    CompressedImage image;
+    if (!image.Load(compressedPath)) {
+        return false;
+    }
+    if (!CompressedImage::IsFormatSupported(image.GetInternalFormat())) {
+        std::cerr << "Compressed format not supported by this GPU, using the uncompressed source: " << compressedPath << std::endl;
+        return false;
+    }
+    
+    GLuint compressedID = image.Upload(image.GetData());
+    if (!compressedID) {
+        return false;
+    }
+    
+    adoptImage(compressedID, image.GetWidth(), image.GetHeight(), image.GetChannels(), image.GetPayloadSize());
+    std::cout << "Successfully loaded compressed texture: " << compressedPath
+              << " (" << width << "x" << height << ", " << image.GetLevelCount() << " mips, ID: " << textureID << ")" << std::endl;
+    return true;
+}
+
+bool Texture::loadAsync(const std::string& path)
+{
+    if (!asyncLoader || !asyncLoader->IsRunning()) {
+        return loadFromFile(path);
+    }
+    
+    cleanup();
+    this->filePath = path;
+    
+    // The fallback pattern doubles as the placeholder while the image decodes
+    createFallbackTexture(path);
+    state = TextureState::PENDING;
+    asyncLoader->Request(this, path);
+    return true;
+}
+
+void Texture::adoptImage(GLuint newTextureID, int newWidth, int newHeight, int newChannels, size_t newMemorySize)
+{
+    if (textureID) {
+        glDeleteTextures(1, &textureID);
+    }
+    textureID = newTextureID;
+    width = newWidth;
+    height = newHeight;
+    channels = newChannels;
+    memorySize = newMemorySize;
+    isLoaded = true;
+    state = TextureState::READY;
+}
+
 bool Texture::createFallbackTexture(const std::string& path)
 {
     // Generate texture for fallback
@@ -154,6 +218,8 @@ bool Texture::createFallbackTexture(const std::string& path)
     glBindTexture(GL_TEXTURE_2D, 0);
     
     isLoaded = true;
+    state = TextureState::FALLBACK;
+    memorySize = EstimateMemorySize(width, height, channels);
     std::cout << "Created fallback texture for: " << path << " (ID: " << textureID << ")" << std::endl;
     
     return true;
@@ -174,9 +240,14 @@ void Texture::unbind() const
 
 void Texture::cleanup()
 {
+    if (state == TextureState::PENDING && asyncLoader) {
+        asyncLoader->Cancel(this);
+    }
     if (textureID) {
         glDeleteTextures(1, &textureID);
         textureID = 0;
     }
     isLoaded = false;
+    state = TextureState::UNLOADED;
+    memorySize = 0;
 }
\ No newline at end of file
@@ -1,17 +1,40 @@
 #pragma once
 #include <GL/glew.h>
 #include <string>
+#include <cstdint>
+
+class TextureLoader;
+
+// PENDING textures show the fallback image until the loader swaps in the real one;
+// FALLBACK means the real image failed and the placeholder stays
+enum class TextureState : uint8_t { UNLOADED, PENDING, READY, FALLBACK };
 
 class Texture
 {
 private:
+    friend class TextureLoader;
+    
     GLuint textureID;
     std::string filePath;
     int width, height, channels;
     bool isLoaded;
+    TextureState state;
+    
+    // GPU storage including mips, for the resource cache report
+    size_t memorySize;
+    
+    // Set by the renderer once its loader threads are running; null loads synchronously
+    static TextureLoader* asyncLoader;
     
     // Helper method for creating fallback textures when image loading fails
     bool createFallbackTexture(const std::string& path);
+    
+    // Uploads a cooked DDS/KTX2 with its prebuilt mips; false leaves the texture untouched
+    bool loadCompressed(const std::string& compressedPath);
+    
+    // Called by TextureLoader on the render thread
+    void adoptImage(GLuint newTextureID, int newWidth, int newHeight, int newChannels, size_t newMemorySize);
+    void markLoadFailed() { state = TextureState::FALLBACK; }
 
 public:
     Texture();
@@ -19,6 +42,7 @@ public:
     ~Texture();
     
     bool loadFromFile(const std::string& filePath);
+    bool loadAsync(const std::string& filePath);
     void bind(GLenum textureUnit = GL_TEXTURE0) const;
     void unbind() const;
     void cleanup();
@@ -29,4 +53,17 @@ public:
     int getHeight() const { return height; }
     int getChannels() const { return channels; }
     const std::string& getFilePath() const { return filePath; }
+    size_t getMemorySize() const { return memorySize; }
+    TextureState getState() const { return state; }
+    bool isPending() const { return state == TextureState::PENDING; }
+    bool isReady() const { return state == TextureState::READY; }
+    
+    // Uncompressed 8-bit storage plus a full mip chain (about a third extra)
+    static size_t EstimateMemorySize(int width, int height, int channels)
+    {
+        return static_cast<size_t>(width) * height * channels * 4 / 3;
+    }
+    
+    static void SetAsyncLoader(TextureLoader* loader) { asyncLoader = loader; }
+    static TextureLoader* GetAsyncLoader() { return asyncLoader; }
 };
\ No newline at end of file
@@ -0,0 +1,366 @@
+#include "TextureLoader.hpp"
+#include "Texture.hpp"
+#include "CompressedImage.hpp"
+#include "Profiler.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <stb_image.h>
+
+namespace {
+    // Immutable storage needs sized internal formats
+    bool GetUploadFormat(int channels, GLenum& format, GLenum& internalFormat)
+    {
+        switch (channels) {
+            case 1: format = GL_RED;  internalFormat = GL_R8;    return true;
+            case 2: format = GL_RG;   internalFormat = GL_RG8;   return true;
+            case 3: format = GL_RGB;  internalFormat = GL_RGB8;  return true;
+            case 4: format = GL_RGBA; internalFormat = GL_RGBA8; return true;
+            default: return false;
+        }
+    }
+
+    GLsizei GetMipLevelCount(int width, int height)
+    {
+        GLsizei levels = 1;
+        int size = (std::max)(width, height);
+        while (size > 1) {
+            size >>= 1;
+            ++levels;
+        }
+        return levels;
+    }
+}
+
+TextureLoader::Job::Job(Texture* texture, const std::string& filePath)
+    : target(texture), path(filePath), pixels(nullptr), width(0), height(0), channels(0), cancelled(false),
+      stagingBuffer(0), fence(nullptr)
+{
+}
+
+TextureLoader::Job::~Job()
+{
+}
+
+TextureLoader::TextureLoader() : stopping(false)
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+    Shutdown();
+}
+
+bool TextureLoader::Init(unsigned threadCount)
+{
+    if (IsRunning()) {
+        return true;
+    }
+
+    if (threadCount == 0) {
+        unsigned hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    // stb keeps this flag in a global, so set it once before any worker decodes
+    stbi_set_flip_vertically_on_load(true);
+
+    stopping = false;
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&TextureLoader::workerLoop, this);
+    }
+
+    std::cout << "Texture loader started with " << threadCount << " decode threads" << std::endl;
+    return true;
+}
+
+void TextureLoader::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    // Anything still queued or staged keeps its fallback image
+    for (auto& job : uploadQueue) {
+        freePixels(*job);
+    }
+    for (auto& job : stagedJobs) {
+        releaseStaging(*job);
+        freePixels(*job);
+    }
+    stagedJobs.clear();
+    for (auto& entry : pendingJobs) {
+        entry.first->markLoadFailed();
+    }
+    decodeQueue.clear();
+    uploadQueue.clear();
+    pendingJobs.clear();
+
+    if (!freeStagingBuffers.empty()) {
+        glDeleteBuffers(static_cast<GLsizei>(freeStagingBuffers.size()), freeStagingBuffers.data());
+        freeStagingBuffers.clear();
+    }
+}
+
+void TextureLoader::Request(Texture* texture, const std::string& path)
+{
+    Cancel(texture);
+
+    auto job = std::make_shared<Job>(texture, path);
+    pendingJobs[texture] = job;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        decodeQueue.push_back(job);
+    }
+    queueCondition.notify_one();
+}
+
+void TextureLoader::Cancel(Texture* texture)
+{
+    auto it = pendingJobs.find(texture);
+    if (it == pendingJobs.end()) {
+        return;
+    }
+
+    // Workers still hold the job; the flag makes them and ProcessUploads drop it
+    it->second->cancelled = true;
+    pendingJobs.erase(it);
+}
+
+void TextureLoader::workerLoop()
+{
+    Profiler::Get().SetThreadName("Texture loader");
+    for (;;) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this] { return stopping || !decodeQueue.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = decodeQueue.front();
+            decodeQueue.pop_front();
+        }
+
+        if (job->cancelled) {
+            continue;
+        }
+        PROFILE_SCOPE("Decode texture");
+
+        // Prefer a cooked DDS/KTX2: it is a plain file read and already carries its mips
+        std::string compressedPath = CompressedImage::FindCompressedVariant(job->path);
+        if (!compressedPath.empty()) {
+            std::unique_ptr<CompressedImage> image(new CompressedImage());
+            if (image->Load(compressedPath) && CompressedImage::IsFormatSupported(image->GetInternalFormat())) {
+                job->compressed = std::move(image);
+                std::lock_guard<std::mutex> lock(queueMutex);
+                uploadQueue.push_back(job);
+                continue;
+            }
+        }
+
+        job->pixels = stbi_load(job->path.c_str(), &job->width, &job->height, &job->channels, 0);
+        if (!job->pixels) {
+            std::cerr << "ERROR::TEXTURE::FAILED_TO_LOAD: " << job->path << std::endl;
+            std::cerr << "STB_IMAGE Error: " << stbi_failure_reason() << std::endl;
+        }
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        uploadQueue.push_back(job);
+    }
+}
+
+size_t TextureLoader::ProcessUploads(size_t byteBudget)
+{
+    size_t uploaded = 0;
+
+    // Copies staged on earlier frames become textures once their fence has signalled; fences
+    // complete in order, so the first one still pending ends the pass
+    while (!stagedJobs.empty()) {
+        std::shared_ptr<Job> job = stagedJobs.front();
+        if (!job->cancelled && glClientWaitSync(job->fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            break;
+        }
+        stagedJobs.pop_front();
+
+        if (!job->cancelled) {
+            pendingJobs.erase(job->target);
+            if (job->compressed ? uploadCompressedJob(*job) : uploadJob(*job)) {
+                ++uploaded;
+            } else {
+                job->target->markLoadFailed();
+            }
+        }
+        releaseStaging(*job);
+        freePixels(*job);
+    }
+
+    size_t bytesUsed = 0;
+    while (bytesUsed < byteBudget && stagedJobs.size() < MAX_STAGED_UPLOADS) {
+        std::shared_ptr<Job> job;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (uploadQueue.empty()) {
+                break;
+            }
+            job = uploadQueue.front();
+            uploadQueue.pop_front();
+        }
+
+        if (job->cancelled) {
+            freePixels(*job);
+            continue;
+        }
+
+        // The job stays in pendingJobs while staged, so Cancel still reaches it
+        if (!stageJob(*job)) {
+            pendingJobs.erase(job->target);
+            job->target->markLoadFailed();
+            freePixels(*job);
+            continue;
+        }
+        bytesUsed += job->compressed ? job->compressed->GetDataSize()
+                                     : static_cast<size_t>(job->width) * job->height * job->channels;
+        stagedJobs.push_back(job);
+    }
+
+    return uploaded;
+}
+
+bool TextureLoader::stageJob(Job& job)
+{
+    const unsigned char* source = nullptr;
+    size_t size = 0;
+    if (job.compressed) {
+        source = job.compressed->GetData();
+        size = job.compressed->GetDataSize();
+    } else {
+        GLenum format, internalFormat;
+        if (!job.pixels) {
+            return false;
+        }
+        if (!GetUploadFormat(job.channels, format, internalFormat)) {
+            std::cerr << "ERROR::TEXTURE::UNSUPPORTED_CHANNEL_COUNT: " << job.channels << " in " << job.path << std::endl;
+            return false;
+        }
+        source = job.pixels;
+        size = static_cast<size_t>(job.width) * job.height * job.channels;
+    }
+
+    if (freeStagingBuffers.empty()) {
+        GLuint buffer = 0;
+        glGenBuffers(1, &buffer);
+        freeStagingBuffers.push_back(buffer);
+    }
+    job.stagingBuffer = freeStagingBuffers.back();
+    freeStagingBuffers.pop_back();
+
+    if (!fillStagingBuffer(job.stagingBuffer, source, size)) {
+        std::cerr << "ERROR::TEXTURE::PBO_MAP_FAILED: " << job.path << std::endl;
+        releaseStaging(job);
+        return false;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    job.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    // The PBO holds the only copy needed now; compressed jobs keep their level table
+    if (job.pixels) {
+        stbi_image_free(job.pixels);
+        job.pixels = nullptr;
+    }
+    return true;
+}
+
+void TextureLoader::releaseStaging(Job& job)
+{
+    if (job.fence) {
+        glDeleteSync(job.fence);
+        job.fence = nullptr;
+    }
+    if (job.stagingBuffer) {
+        freeStagingBuffers.push_back(job.stagingBuffer);
+        job.stagingBuffer = 0;
+    }
+}
+
+// Creates the texture from a staged job whose fence has signalled
+bool TextureLoader::uploadJob(Job& job)
+{
+    // stageJob already rejected unsupported channel counts
+    GLenum format, internalFormat;
+    GetUploadFormat(job.channels, format, internalFormat);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, job.stagingBuffer);
+
+    GLuint textureID = 0;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexStorage2D(GL_TEXTURE_2D, GetMipLevelCount(job.width, job.height), internalFormat, job.width, job.height);
+
+    // stb rows are tightly packed, which breaks the default 4-byte alignment for RGB and odd widths
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, job.width, job.height, format, GL_UNSIGNED_BYTE, nullptr);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    job.target->adoptImage(textureID, job.width, job.height, job.channels,
+                           Texture::EstimateMemorySize(job.width, job.height, job.channels));
+    std::cout << "Streamed in texture: " << job.path
+              << " (" << job.width << "x" << job.height << ", " << job.channels << " channels, ID: " << textureID << ")" << std::endl;
+    return true;
+}
+
+bool TextureLoader::uploadCompressedJob(Job& job)
+{
+    const CompressedImage& image = *job.compressed;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, job.stagingBuffer);
+
+    // Level offsets are relative to the start of the file, which is what the PBO holds
+    GLuint textureID = image.Upload(nullptr);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!textureID) {
+        return false;
+    }
+
+    job.target->adoptImage(textureID, image.GetWidth(), image.GetHeight(), image.GetChannels(), image.GetPayloadSize());
+    std::cout << "Streamed in compressed texture: " << job.path
+              << " (" << image.GetWidth() << "x" << image.GetHeight() << ", " << image.GetLevelCount() << " mips, ID: " << textureID << ")" << std::endl;
+    return true;
+}
+
+// Leaves the staging buffer bound to GL_PIXEL_UNPACK_BUFFER on success
+bool TextureLoader::fillStagingBuffer(GLuint buffer, const unsigned char* source, size_t size)
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+    void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size),
+                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!staging) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+    std::memcpy(staging, source, size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    return true;
+}
+
+void TextureLoader::freePixels(Job& job)
+{
+    if (job.pixels) {
+        stbi_image_free(job.pixels);
+        job.pixels = nullptr;
+    }
+    job.compressed.reset();
+}
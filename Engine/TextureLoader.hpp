@@ -0,0 +1,86 @@
+#pragma once
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+class Texture;
+class CompressedImage;
+
+// Decodes images on a pool of worker threads and uploads them on the render
+// thread. Requests return immediately; the Texture keeps its fallback image
+// until ProcessUploads() swaps in the real one. Uploads take two frames: pixels
+// are copied into a staging PBO and fenced, and the texture is only created
+// from it once the fence signals, so the transfer overlaps the frames between.
+class TextureLoader {
+public:
+    // Roughly one 2K RGBA image per frame; a larger image still goes through on its own
+    static const size_t DEFAULT_UPLOAD_BUDGET = 16 * 1024 * 1024;
+    // Staging buffers in flight at once; each holds one image until its texture is created
+    static const size_t MAX_STAGED_UPLOADS = 8;
+
+private:
+    struct Job {
+        Texture* target;
+        std::string path;
+        unsigned char* pixels;
+        int width, height, channels;
+        // Set instead of pixels when a cooked DDS/KTX2 was found
+        std::unique_ptr<CompressedImage> compressed;
+        std::atomic<bool> cancelled;
+        // Render thread only, while staged: the PBO holding the image and the fence after its copy
+        GLuint stagingBuffer;
+        GLsync fence;
+
+        Job(Texture* texture, const std::string& filePath);
+        ~Job();
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    std::deque<std::shared_ptr<Job>> decodeQueue;
+    std::deque<std::shared_ptr<Job>> uploadQueue;
+    bool stopping;
+
+    // Render thread only: the outstanding job for each texture, so it can be cancelled
+    std::unordered_map<Texture*, std::shared_ptr<Job>> pendingJobs;
+
+    // Render thread only: jobs copied into a staging PBO, in fence order, and the PBOs not in
+    // use. A PBO is orphaned before every copy, so reusing one never waits on its last upload.
+    std::deque<std::shared_ptr<Job>> stagedJobs;
+    std::vector<GLuint> freeStagingBuffers;
+
+    void workerLoop();
+    bool stageJob(Job& job);
+    bool uploadJob(Job& job);
+    bool uploadCompressedJob(Job& job);
+    bool fillStagingBuffer(GLuint buffer, const unsigned char* source, size_t size);
+    void releaseStaging(Job& job);
+    static void freePixels(Job& job);
+
+public:
+    TextureLoader();
+    ~TextureLoader();
+
+    // threadCount 0 picks one less than the hardware thread count
+    bool Init(unsigned threadCount = 0);
+    void Shutdown();
+
+    // Render thread only
+    void Request(Texture* texture, const std::string& path);
+    void Cancel(Texture* texture);
+
+    // Creates the textures staged on earlier frames whose copies have finished, then stages
+    // decoded images until byteBudget is spent; returns how many textures were swapped in
+    size_t ProcessUploads(size_t byteBudget = DEFAULT_UPLOAD_BUDGET);
+
+    size_t GetPendingCount() const { return pendingJobs.size(); }
+    bool IsRunning() const { return !workers.empty(); }
+};
@@ -0,0 +1,230 @@
+#include "TileRenderer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+TileRenderer::TileRenderer() : cancelled(false), completedTiles(0), totalTiles(0)
+{
+}
+
+std::vector<TileRenderer::Tile> TileRenderer::MakeTiles(int width, int height, int tileSize)
+{
+    tileSize = (std::max)(1, tileSize);
+
+    std::vector<Tile> tiles;
+    uint32_t index = 0;
+    for (int y = 0; y < height; y += tileSize) {
+        for (int x = 0; x < width; x += tileSize) {
+            Tile tile;
+            tile.startX = x;
+            tile.startY = y;
+            tile.endX = (std::min)(x + tileSize, width);
+            tile.endY = (std::min)(y + tileSize, height);
+            tile.index = index++;
+            tiles.push_back(tile);
+        }
+    }
+    return tiles;
+}
+
+bool TileRenderer::Render(const RadianceFunction& radiance, const Settings& settings, float* pixels,
+                          const ProgressCallback& progress)
+{
+    std::vector<Tile> tiles = MakeTiles(settings.width, settings.height, settings.tileSize);
+
+    std::cout << "Rendering " << settings.width << "x" << settings.height << " at " << settings.samplesPerPixel
+              << " spp: " << tiles.size() << " tiles" << std::endl;
+
+    bool completed = RunTiles(tiles, [&radiance, &settings, pixels](const Tile& tile) {
+        RenderTile(tile, radiance, settings, pixels);
+    }, settings.threadCount, progress);
+
+    if (!completed) {
+        std::cout << "Render cancelled after " << completedTiles << "/" << totalTiles << " tiles" << std::endl;
+    }
+    return completed;
+}
+
+bool TileRenderer::RenderIntegrator(const PathIntegrator& integrator, const Scene& scene, const Settings& settings,
+                                    float* pixels, const ProgressCallback& progress)
+{
+    std::vector<Tile> tiles = MakeTiles(settings.width, settings.height, settings.tileSize);
+
+    std::cout << "Rendering " << settings.width << "x" << settings.height << " at " << settings.samplesPerPixel
+              << " spp: " << tiles.size() << " tiles, ray streams" << std::endl;
+
+    bool completed = RunTiles(tiles, [&integrator, &scene, &settings, pixels](const Tile& tile) {
+        RenderPathTile(tile, integrator, scene, settings, pixels);
+    }, settings.threadCount, progress);
+
+    if (!completed) {
+        std::cout << "Render cancelled after " << completedTiles << "/" << totalTiles << " tiles" << std::endl;
+    }
+    return completed;
+}
+
+bool TileRenderer::RunTiles(const std::vector<Tile>& tiles, const TileFunction& work, unsigned threadCount,
+                            const ProgressCallback& progress)
+{
+    if (threadCount == 0) {
+        threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = (std::min)(threadCount, static_cast<unsigned>((std::max)(tiles.size(), size_t(1))));
+
+    // Contiguous runs per worker keep neighbouring tiles (and their cache lines) on one core
+    // until the work runs out and stealing starts
+    queues.clear();
+    for (unsigned i = 0; i < threadCount; ++i) {
+        queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+    }
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        queues[i * threadCount / tiles.size()]->tiles.push_back(tiles[i]);
+    }
+
+    cancelled = false;
+    completedTiles = 0;
+    totalTiles = static_cast<int>(tiles.size());
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&TileRenderer::WorkerLoop, this, static_cast<size_t>(i),
+                             std::cref(work), std::cref(progress));
+    }
+    WorkerLoop(0, work, progress);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    queues.clear();
+
+    return !cancelled;
+}
+
+float TileRenderer::GetProgress() const
+{
+    int total = totalTiles;
+    return total > 0 ? static_cast<float>(completedTiles) / total : 0.0f;
+}
+
+bool TileRenderer::PopTile(size_t worker, Tile& tile)
+{
+    {
+        WorkerQueue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tiles.empty()) {
+            tile = own.tiles.front();
+            own.tiles.pop_front();
+            return true;
+        }
+    }
+
+    // Steal from the far end of another queue, away from where its owner is working
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        WorkerQueue& victim = *queues[(worker + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tiles.empty()) {
+            tile = victim.tiles.back();
+            victim.tiles.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void TileRenderer::WorkerLoop(size_t worker, const TileFunction& work, const ProgressCallback& progress)
+{
+    Tile tile;
+    while (!cancelled && PopTile(worker, tile)) {
+        work(tile);
+
+        int completed = ++completedTiles;
+        if (progress) {
+            std::lock_guard<std::mutex> lock(progressMutex);
+            if (!progress(completed, totalTiles)) {
+                cancelled = true;
+            }
+        }
+    }
+}
+
+void TileRenderer::RenderTile(const Tile& tile, const RadianceFunction& radiance, const Settings& settings, float* pixels)
+{
+    std::unique_ptr<Sampler> sampler = Sampler::Create(settings.sampler, settings.samplesPerPixel, settings.seed);
+    float sampleWeight = 1.0f / static_cast<float>((std::max)(1, settings.samplesPerPixel));
+
+    for (int y = tile.startY; y < tile.endY; ++y) {
+        for (int x = tile.startX; x < tile.endX; ++x) {
+            Spectrum L(0.0f);
+
+            for (int s = 0; s < settings.samplesPerPixel; ++s) {
+                sampler->StartPixelSample(glm::ivec2(x, y), s);
+                Ray ray = PathIntegrator::GenerateCameraRay(x, y, settings.width, settings.height,
+                                                            settings.cameraToWorld, settings.fov, sampler->Get2D());
+                L.addScaled(radiance(ray, *sampler), sampleWeight);
+            }
+
+            StorePixel(L, x, y, settings, pixels);
+        }
+    }
+}
+
+void TileRenderer::RenderPathTile(const Tile& tile, const PathIntegrator& integrator, const Scene& scene,
+                                  const Settings& settings, float* pixels)
+{
+    std::unique_ptr<Sampler> sampler = Sampler::Create(settings.sampler, settings.samplesPerPixel, settings.seed);
+    float sampleWeight = 1.0f / static_cast<float>((std::max)(1, settings.samplesPerPixel));
+
+    int tileWidth = tile.endX - tile.startX;
+    int pixelCount = tileWidth * (tile.endY - tile.startY);
+    int64_t pathCount = static_cast<int64_t>(pixelCount) * settings.samplesPerPixel;
+    std::vector<Spectrum> film(pixelCount, Spectrum(0.0f));
+
+    std::vector<Ray> rays;
+    std::vector<PathSamplePosition> positions;
+    std::vector<Spectrum> radiance;
+    rays.reserve(WAVEFRONT_SIZE);
+    positions.reserve(WAVEFRONT_SIZE);
+
+    // Generate: path i is sample i / pixelCount of pixel i % pixelCount, so each pixel still
+    // accumulates its samples in order
+    for (int64_t first = 0; first < pathCount; first += WAVEFRONT_SIZE) {
+        int count = static_cast<int>((std::min)(pathCount - first, static_cast<int64_t>(WAVEFRONT_SIZE)));
+        rays.clear();
+        positions.clear();
+        for (int i = 0; i < count; ++i) {
+            int64_t path = first + i;
+            int local = static_cast<int>(path % pixelCount);
+            glm::ivec2 pixel(tile.startX + local % tileWidth, tile.startY + local / tileWidth);
+            PathSamplePosition position = { pixel, static_cast<int>(path / pixelCount), 0 };
+
+            sampler->StartPixelSample(pixel, position.sampleIndex);
+            rays.push_back(PathIntegrator::GenerateCameraRay(pixel.x, pixel.y, settings.width, settings.height,
+                                                             settings.cameraToWorld, settings.fov, sampler->Get2D()));
+            position.dimension = sampler->GetDimension();
+            positions.push_back(position);
+        }
+
+        radiance.resize(count);
+        integrator.LiN(rays.data(), positions.data(), count, scene, *sampler, radiance.data());
+        for (int i = 0; i < count; ++i) {
+            film[static_cast<int>((first + i) % pixelCount)].addScaled(radiance[i], sampleWeight);
+        }
+    }
+
+    for (int local = 0; local < pixelCount; ++local) {
+        StorePixel(film[local], tile.startX + local % tileWidth, tile.startY + local / tileWidth, settings, pixels);
+    }
+}
+
+void TileRenderer::StorePixel(const Spectrum& L, int x, int y, const Settings& settings, float* pixels)
+{
+    // Convert spectrum to RGB; Reinhard tone mapping, then gamma correction
+    glm::vec3 rgb = L.toRGB();
+    rgb = rgb / (rgb + glm::vec3(1.0f));
+    rgb = glm::vec3(std::pow(rgb.r, 1.0f / 2.2f), std::pow(rgb.g, 1.0f / 2.2f), std::pow(rgb.b, 1.0f / 2.2f));
+
+    int pixelIndex = (y * settings.width + x) * 3;
+    pixels[pixelIndex + 0] = (std::max)(0.0f, (std::min)(rgb.r, 1.0f));
+    pixels[pixelIndex + 1] = (std::max)(0.0f, (std::min)(rgb.g, 1.0f));
+    pixels[pixelIndex + 2] = (std::max)(0.0f, (std::min)(rgb.b, 1.0f));
+}
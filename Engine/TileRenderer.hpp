@@ -0,0 +1,110 @@
+#pragma once
+#include "Integrator.hpp"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Offline renderer front-end: splits the image into small tiles and renders them on a
+// work-stealing thread pool. Samples are keyed by (seed, pixel, sample index), so an image is
+// identical run to run whichever thread ends up rendering a tile.
+class TileRenderer {
+public:
+    struct Tile {
+        int startX, startY, endX, endY;
+        uint32_t index;
+    };
+
+    // Radiance arriving along a camera ray. Called from every worker at once, so it must
+    // not modify shared state (PhotonMappingIntegrator::Preprocess has to run beforehand).
+    // The sampler is positioned on the pixel sample, with the camera dimensions already drawn.
+    using RadianceFunction = std::function<Spectrum(const Ray& ray, Sampler& sampler)>;
+
+    // Called after each finished tile, one call at a time, from a worker thread; returning
+    // false cancels the render
+    using ProgressCallback = std::function<bool(int completedTiles, int totalTiles)>;
+
+    // Work for one tile, run on whichever worker pops it
+    using TileFunction = std::function<void(const Tile& tile)>;
+
+    struct Settings {
+        int width = 512;
+        int height = 512;
+        glm::mat4 cameraToWorld = glm::mat4(1.0f);
+        float fov = 45.0f;           // Vertical, degrees
+        int samplesPerPixel = 16;
+        int tileSize = 16;           // Small tiles keep the last few from serialising the end of a render
+        unsigned threadCount = 0;    // 0 uses every hardware thread
+        Sampler::Type sampler = Sampler::Type::Sobol;
+        uint32_t seed = 0;
+    };
+
+private:
+    // Camera rays per wavefront; bounds the path state a tile keeps at high sample counts
+    static const int WAVEFRONT_SIZE = 4096;
+
+    // Each worker pops from the front of its own queue and steals from the back of the others'
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Tile> tiles;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::atomic<bool> cancelled;
+    std::atomic<int> completedTiles;
+    std::atomic<int> totalTiles;
+    std::mutex progressMutex;
+
+    bool PopTile(size_t worker, Tile& tile);
+    static void StorePixel(const Spectrum& L, int x, int y, const Settings& settings, float* pixels);
+    void WorkerLoop(size_t worker, const TileFunction& work, const ProgressCallback& progress);
+
+public:
+    TileRenderer();
+
+    TileRenderer(const TileRenderer&) = delete;
+    TileRenderer& operator=(const TileRenderer&) = delete;
+
+    // Blocks until every tile is done, rendering on the calling thread as well; returns false
+    // when cancelled. pixels holds width * height RGB floats, tone mapped and gamma corrected.
+    bool Render(const RadianceFunction& radiance, const Settings& settings, float* pixels,
+                const ProgressCallback& progress = ProgressCallback());
+
+    // Runs work once for every tile on the same pool; Render is RunTiles over RenderTile.
+    // Returns false when cancelled.
+    bool RunTiles(const std::vector<Tile>& tiles, const TileFunction& work, unsigned threadCount,
+                  const ProgressCallback& progress = ProgressCallback());
+
+    // Any integrator with Li(ray, scene, sampler): PathIntegrator, BidirectionalPathIntegrator,
+    // VolumetricPathIntegrator or PhotonMappingIntegrator
+    template <typename IntegratorType>
+    bool RenderIntegrator(const IntegratorType& integrator, const Scene& scene, const Settings& settings,
+                          float* pixels, const ProgressCallback& progress = ProgressCallback())
+    {
+        return Render([&integrator, &scene](const Ray& ray, Sampler& sampler) {
+            return integrator.Li(ray, scene, sampler);
+        }, settings, pixels, progress);
+    }
+
+    // PathIntegrator gets the same image from ray streams: RenderPathTile instead of one Li call
+    // per sample, so camera and shadow rays reach the scene in coherent batches
+    bool RenderIntegrator(const PathIntegrator& integrator, const Scene& scene, const Settings& settings,
+                          float* pixels, const ProgressCallback& progress = ProgressCallback());
+
+    // Safe to call from any thread while Render is running
+    void Cancel() { cancelled = true; }
+    bool IsCancelled() const { return cancelled; }
+    float GetProgress() const;
+
+    // Renders one tile on the calling thread
+    static void RenderTile(const Tile& tile, const RadianceFunction& radiance, const Settings& settings, float* pixels);
+
+    // Renders one tile on the calling thread as wavefronts of PathIntegrator::LiN, sample
+    // index by sample index so that neighbouring rays come from neighbouring pixels
+    static void RenderPathTile(const Tile& tile, const PathIntegrator& integrator, const Scene& scene,
+                               const Settings& settings, float* pixels);
+    static std::vector<Tile> MakeTiles(int width, int height, int tileSize);
+};
@@ -1,4 +1,5 @@
 #include "Transform.hpp"
+#include <glm/gtc/matrix_transform.hpp>
 
 Transform::Transform()
 {
@@ -7,3 +8,13 @@ Transform::Transform()
 	scale = glm::vec3(1.0f, 1.0f, 1.0f);
 }
 
+glm::mat4 Transform::getModelMatrix() const
+{
+	glm::mat4 model = glm::mat4(1.0f);
+	model = glm::translate(model, position);
+	model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1, 0, 0));
+	model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0, 1, 0));
+	model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0, 0, 1));
+	model = glm::scale(model, scale);
+	return model;
+}
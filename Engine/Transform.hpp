@@ -11,5 +11,8 @@ public:
 
 	Transform();
 
+	// Translation * Rx * Ry * Rz * Scale, rotation in degrees
+	glm::mat4 getModelMatrix() const;
+
 };
 
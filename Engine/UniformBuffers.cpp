@@ -0,0 +1,141 @@
+#include "UniformBuffers.hpp"
+#include "Shadow.hpp"
+#include <iostream>
+
+UniformBuffers::UniformBuffers() : frameDataUBO(0), lightDataUBO(0), shadowDataUBO(0), lightData()
+{
+}
+
+UniformBuffers::~UniformBuffers()
+{
+    Cleanup();
+}
+
+bool UniformBuffers::Init()
+{
+    Cleanup();
+    
+    glGenBuffers(1, &frameDataUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameDataUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameDataBlock), nullptr, GL_DYNAMIC_DRAW);
+    
+    glGenBuffers(1, &lightDataUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, lightDataUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(LightDataBlock), nullptr, GL_DYNAMIC_DRAW);
+    
+    // Starts with no cascades, for frames that never write it
+    ShadowDataBlock noShadows = {};
+    glGenBuffers(1, &shadowDataUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, shadowDataUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(ShadowDataBlock), &noShadows, GL_DYNAMIC_DRAW);
+    
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    
+    if (frameDataUBO == 0 || lightDataUBO == 0 || shadowDataUBO == 0) {
+        std::cerr << "Failed to create uniform buffers" << std::endl;
+        return false;
+    }
+    
+    Bind();
+    return true;
+}
+
+void UniformBuffers::Cleanup()
+{
+    if (frameDataUBO) {
+        glDeleteBuffers(1, &frameDataUBO);
+        frameDataUBO = 0;
+    }
+    if (lightDataUBO) {
+        glDeleteBuffers(1, &lightDataUBO);
+        lightDataUBO = 0;
+    }
+    if (shadowDataUBO) {
+        glDeleteBuffers(1, &shadowDataUBO);
+        shadowDataUBO = 0;
+    }
+}
+
+void UniformBuffers::Bind() const
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, frameDataUBO);
+    glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_DATA_BINDING, lightDataUBO);
+    glBindBufferBase(GL_UNIFORM_BUFFER, SHADOW_DATA_BINDING, shadowDataUBO);
+}
+
+void UniformBuffers::UpdateFrameData(const FrameDataBlock& frameData)
+{
+    if (!frameDataUBO) return;
+    
+    glBindBuffer(GL_UNIFORM_BUFFER, frameDataUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameDataBlock), &frameData);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffers::UpdateShadowData(const ShadowDataBlock& shadowData)
+{
+    if (!shadowDataUBO) return;
+    
+    glBindBuffer(GL_UNIFORM_BUFFER, shadowDataUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ShadowDataBlock), &shadowData);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffers::UpdateLightData(const std::vector<std::unique_ptr<Light>>& lights, const ShadowAtlas* shadowAtlas)
+{
+    if (!lightDataUBO) return;
+    
+    lightData.numDirLights = 0;
+    lightData.numPointLights = 0;
+    lightData.numSpotLights = 0;
+    
+    for (const auto& light : lights) {
+        if (!light->enabled) continue;
+        
+        switch (light->getType()) {
+            case LightType::DIRECTIONAL: {
+                if (lightData.numDirLights >= MAX_DIR_LIGHTS) break;
+                DirectionalLightBlock& block = lightData.dirLights[lightData.numDirLights++];
+                block.direction = light->getDirection();
+                block.intensity = light->intensity;
+                block.color = light->color;
+                break;
+            }
+            case LightType::POINT: {
+                if (lightData.numPointLights >= MAX_POINT_LIGHTS) break;
+                const PointLight* pointLight = static_cast<const PointLight*>(light.get());
+                PointLightBlock& block = lightData.pointLights[lightData.numPointLights++];
+                block.position = pointLight->getPosition();
+                block.intensity = pointLight->intensity;
+                block.color = pointLight->color;
+                block.constant = pointLight->constant;
+                block.linear = pointLight->linear;
+                block.quadratic = pointLight->quadratic;
+                block.shadowFace = shadowAtlas ? shadowAtlas->getFirstFace(pointLight) : -1;
+                break;
+            }
+            case LightType::SPOT: {
+                if (lightData.numSpotLights >= MAX_SPOT_LIGHTS) break;
+                const SpotLight* spotLight = static_cast<const SpotLight*>(light.get());
+                SpotLightBlock& block = lightData.spotLights[lightData.numSpotLights++];
+                block.position = spotLight->getPosition();
+                block.intensity = spotLight->intensity;
+                block.direction = spotLight->getDirection();
+                block.innerCone = spotLight->innerCone;
+                block.color = spotLight->color;
+                block.outerCone = spotLight->outerCone;
+                block.constant = spotLight->constant;
+                block.linear = spotLight->linear;
+                block.quadratic = spotLight->quadratic;
+                block.shadowFace = shadowAtlas ? shadowAtlas->getFirstFace(spotLight) : -1;
+                break;
+            }
+        }
+    }
+    
+    // Only the used prefix of each array changes, but the block is small enough that
+    // a single upload beats tracking dirty ranges
+    glBindBuffer(GL_UNIFORM_BUFFER, lightDataUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LightDataBlock), &lightData);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+#include "Light.hpp"
+
+class ShadowAtlas;
+
+// CPU mirrors of the std140 blocks in shaders/uniform_blocks.glsl.
+// vec3 members occupy 16 bytes in std140, so each one is followed by a scalar or padding.
+struct FrameDataBlock {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 cameraPosition;
+    float frameTime;
+    glm::vec3 sunDirection;
+    float padding0;
+    glm::vec3 sunColor;
+    float clusterDepthScale;    // Depth slice of a view depth is log(depth) * scale + bias
+    float clusterDepthBias;
+    float padding1[3];
+};
+
+struct DirectionalLightBlock {
+    glm::vec3 direction;
+    float intensity;
+    glm::vec3 color;
+    float padding;
+};
+
+struct PointLightBlock {
+    glm::vec3 position;
+    float intensity;
+    glm::vec3 color;
+    float constant;
+    float linear;
+    float quadratic;
+    int shadowFace;     // First ShadowAtlas face, -1 without shadows
+    float padding;
+};
+
+struct SpotLightBlock {
+    glm::vec3 position;
+    float intensity;
+    glm::vec3 direction;
+    float innerCone;
+    glm::vec3 color;
+    float outerCone;
+    float constant;
+    float linear;
+    float quadratic;
+    int shadowFace;     // ShadowAtlas face, -1 without shadows
+};
+
+// Must match the MAX_*_LIGHTS defines in shaders/uniform_blocks.glsl
+const int MAX_DIR_LIGHTS = 4;
+const int MAX_POINT_LIGHTS = 32;
+const int MAX_SPOT_LIGHTS = 16;
+
+struct LightDataBlock {
+    int numDirLights;
+    int numPointLights;
+    int numSpotLights;
+    int padding;
+    DirectionalLightBlock dirLights[MAX_DIR_LIGHTS];
+    PointLightBlock pointLights[MAX_POINT_LIGHTS];
+    SpotLightBlock spotLights[MAX_SPOT_LIGHTS];
+};
+
+// Must match MAX_SHADOW_CASCADES and MAX_LOCAL_SHADOW_FACES in shaders/uniform_blocks.glsl
+const int MAX_SHADOW_CASCADES = 4;
+const int MAX_LOCAL_SHADOW_FACES = 64;
+
+// Sun cascades, written by CascadedShadowMap, then the ShadowAtlas faces of local lights
+struct ShadowDataBlock {
+    glm::mat4 cascadeMatrices[MAX_SHADOW_CASCADES];   // World to shadow texture space ([0, 1] in xyz)
+    glm::vec4 cascadeSplits;                          // View depth where each cascade ends
+    glm::vec4 cascadeTexelSizes;                      // World size of one texel, for normal offsets
+    int cascadeCount;                                 // 0 when the sun casts no shadows
+    int padding[3];
+    glm::mat4 localShadowMatrices[MAX_LOCAL_SHADOW_FACES];  // World to atlas tile, before the divide by w
+};
+
+static_assert(sizeof(FrameDataBlock) == 192, "FrameDataBlock must match the std140 FrameData layout");
+static_assert(sizeof(DirectionalLightBlock) == 32, "DirectionalLightBlock must match the std140 layout");
+static_assert(sizeof(PointLightBlock) == 48, "PointLightBlock must match the std140 layout");
+static_assert(sizeof(SpotLightBlock) == 64, "SpotLightBlock must match the std140 layout");
+static_assert(sizeof(ShadowDataBlock) == 4400, "ShadowDataBlock must match the std140 ShadowData layout");
+
+// Owns the FrameData, LightData and ShadowData UBOs. All are written once per frame and stay
+// bound to their fixed binding points, so every program reads the same camera and light state.
+class UniformBuffers {
+private:
+    GLuint frameDataUBO;
+    GLuint lightDataUBO;
+    GLuint shadowDataUBO;
+    LightDataBlock lightData;
+    
+public:
+    UniformBuffers();
+    ~UniformBuffers();
+    
+    bool Init();
+    void Cleanup();
+    
+    void UpdateFrameData(const FrameDataBlock& frameData);
+    // shadowAtlas, when given, supplies each local light's shadowFace
+    void UpdateLightData(const std::vector<std::unique_ptr<Light>>& lights, const ShadowAtlas* shadowAtlas = nullptr);
+    void UpdateShadowData(const ShadowDataBlock& shadowData);
+    
+    // Rebind to the fixed binding points (only needed if something else used them)
+    void Bind() const;
+    
+    const LightDataBlock& GetLightData() const { return lightData; }
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <cstdint>
 
 struct Vertex {
     glm::vec3 position;
@@ -10,4 +11,22 @@ struct Vertex {
     
     Vertex(const glm::vec3& pos, const glm::vec3& norm, const glm::vec2& tex)
         : position(pos), normal(norm), texCoords(tex) {}
-};
\ No newline at end of file
+};
+
+// What the GPU reads: half the size of Vertex. Positions and UVs are unorm16 over the
+// ranges in VertexQuantization, normals are octahedral snorm16. Decoded by mesh_vertex.glsl.
+struct PackedVertex {
+    uint16_t position[4];   // w unused, keeps the normal 8-byte aligned
+    int16_t normal[2];
+    uint16_t texCoords[2];
+};
+
+// Maps the unorm16 fields back to model space: value = offset + scale * unorm
+struct VertexQuantization {
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
+    glm::vec2 texCoordOffset;
+    glm::vec2 texCoordScale;
+    
+    VertexQuantization() : positionOffset(0.0f), positionScale(1.0f), texCoordOffset(0.0f), texCoordScale(1.0f) {}
+};
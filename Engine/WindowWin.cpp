@@ -6,8 +6,7 @@
 HDC hDCGlobal = NULL;
 HGLRC hRCGlobal = NULL;
 
-WindowWin::WindowWin() {
-    // Constructor can be used for initialization if needed
+WindowWin::WindowWin() : visible(true) {
 }
 
 WindowWin::~WindowWin() {
@@ -94,7 +93,7 @@ int WindowWin::WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
     hWndGlobal = CreateWindow(
         L"OpenGLWindowClass",
         L"Zero Game Engine",
-        WS_OVERLAPPEDWINDOW | WS_VISIBLE,
+        WS_OVERLAPPEDWINDOW | (visible ? WS_VISIBLE : 0),
         CW_USEDEFAULT,
         CW_USEDEFAULT,
         1940,
@@ -121,7 +120,7 @@ int WindowWin::WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
 
 bool WindowWin::Tick() {
     MSG msg;
-    bool done, result;
+    bool done;
 
 
     // Initialize the message structure.
@@ -131,34 +130,53 @@ bool WindowWin::Tick() {
     done = false;
     while (!done)
     {
-        // Handle the windows messages.
-        if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+        // Handle every window message queued since the last frame.
+        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
         {
+            if (msg.message == WM_QUIT)
+            {
+                done = true;
+                break;
+            }
             TranslateMessage(&msg);
             DispatchMessage(&msg);
         }
+        if (done)
+        {
+            break;
+        }
 
-        // If windows signals to end the application then exit out.
-        if (msg.message == WM_QUIT)
+        // A minimised window has nothing to show; sleep until a message restores it.
+        if (visible && IsIconic(hWndGlobal))
         {
-            done = true;
+            WaitMessage();
+            continue;
         }
-        else
+
+        // Wait out the frame period; a message cuts the wait short and is handled first.
+        if (!pacer.WaitForNextFrame())
         {
-            // Otherwise do the frame processing.
-            result = Engine::app->Tick();
-            if (!result)
-            {
-                done = true;
-            }
+            continue;
         }
 
+        // Otherwise do the frame processing.
+        if (!Engine::app->Tick())
+        {
+            done = true;
+        }
     }
     return static_cast<int>(msg.wParam);
 }
 
-bool WindowWin::Init() {
+double WindowWin::GetDisplayRefreshRate() const {
+    int refreshRate = hDCGlobal ? GetDeviceCaps(hDCGlobal, VREFRESH) : 0;
+    // 0 and 1 mean the hardware default
+    return refreshRate > 1 ? static_cast<double>(refreshRate) : 60.0;
+}
+
+bool WindowWin::Init(bool showWindow) {
 
+    visible = showWindow;
     HINSTANCE hInstance = GetModuleHandle(NULL);
     WinMain(hInstance, NULL, NULL, SW_SHOWDEFAULT);
     return true;
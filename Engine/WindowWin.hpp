@@ -1,6 +1,7 @@
 #pragma once  
 #include <windows.h>  
 #include <iostream>  
+#include "FramePacer.hpp"
 
 
 #ifndef WGL_CONTEXT_MAJOR_VERSION_ARB  
@@ -21,6 +22,8 @@ extern HGLRC hRCGlobal;
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);  
 
 class WindowWin {  
+	bool visible;
+	FramePacer pacer;
 
 public:  
 
@@ -28,7 +31,13 @@ public:
 	~WindowWin();
 	int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow);  
 	bool CreateModernContext(HWND hWnd);  
-	bool Init();  
+	// A hidden window still gets a context; headless benchmark runs use it
+	bool Init(bool visible = true);  
 	bool Tick();
+	
+	// Frames per second the loop is held to; zero or less runs unpaced
+	void SetFrameRateLimit(double framesPerSecond) { pacer.SetTargetRate(framesPerSecond); }
+	// The monitor's refresh rate, or 60 when the driver does not report one
+	double GetDisplayRefreshRate() const;
 
 };
\ No newline at end of file
@@ -1,10 +1,15 @@
 #include "App.hpp"
 
 
-int main(){
+int main(int argc, char** argv){
 
-	Engine::Init();
+	BenchmarkSettings settings;
+	if (!settings.Parse(argc, argv)) {
+		return 2;
+	}
+
+	bool succeeded = Engine::Init(settings);
 	Engine::Release();
 
-	return 0;
+	return succeeded ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,88 @@
+// Tileable noise shared by the cloud noise generators (cloud_noise_*.comp).
+// Positions are in lattice cells; every lattice wraps at `period` cells, so a
+// volume sampled over [0, period) tiles seamlessly. Octave n uses 2^n times
+// the position and the period, which keeps the whole FBM tileable.
+
+uniform uint seed;
+
+// 3D PCG (Jarzynski & Olano 2020): integer cell in, three independent words out
+uvec3 pcg3d(uvec3 v) {
+    v = v * 1664525u + 1013904223u;
+    v.x += v.y * v.z;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v ^= v >> 16u;
+    v.x += v.y * v.z;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    return v;
+}
+
+vec3 hashCell(ivec3 cell, int period) {
+    uvec3 wrapped = uvec3((cell % period + period) % period);
+    return vec3(pcg3d(wrapped ^ uvec3(seed, seed * 747796405u, seed * 2891336453u))) * (1.0 / 4294967295.0);
+}
+
+// Gradient noise in [-1, 1] with a quintic fade
+float perlin(vec3 p, int period) {
+    ivec3 cell = ivec3(floor(p));
+    vec3 f = p - vec3(cell);
+    vec3 fade = f * f * f * (f * (f * 6.0 - 15.0) + 10.0);
+    
+    float corners[8];
+    for (int i = 0; i < 8; i++) {
+        ivec3 offset = ivec3(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+        vec3 gradient = normalize(hashCell(cell + offset, period) * 2.0 - 1.0 + 1e-6);
+        corners[i] = dot(gradient, f - vec3(offset));
+    }
+    
+    float x00 = mix(corners[0], corners[1], fade.x);
+    float x10 = mix(corners[2], corners[3], fade.x);
+    float x01 = mix(corners[4], corners[5], fade.x);
+    float x11 = mix(corners[6], corners[7], fade.x);
+    return mix(mix(x00, x10, fade.y), mix(x01, x11, fade.y), fade.z) * 1.1547;
+}
+
+// Inverted cellular noise: 1 on a feature point, falling to 0 a cell away
+float worley(vec3 p, int period) {
+    ivec3 cell = ivec3(floor(p));
+    vec3 f = p - vec3(cell);
+    
+    float minDistance2 = 1.0;
+    for (int z = -1; z <= 1; z++) {
+        for (int y = -1; y <= 1; y++) {
+            for (int x = -1; x <= 1; x++) {
+                ivec3 offset = ivec3(x, y, z);
+                vec3 toFeature = vec3(offset) + hashCell(cell + offset, period) - f;
+                minDistance2 = min(minDistance2, dot(toFeature, toFeature));
+            }
+        }
+    }
+    return 1.0 - sqrt(minDistance2);
+}
+
+// Perlin FBM remapped to [0, 1]
+float perlinFbm(vec3 p, int period, int octaves) {
+    float value = 0.0;
+    float amplitude = 0.5;
+    float total = 0.0;
+    for (int i = 0; i < octaves; i++) {
+        value += amplitude * perlin(p, period);
+        total += amplitude;
+        amplitude *= 0.5;
+        p *= 2.0;
+        period *= 2;
+    }
+    return clamp(value / total * 0.5 + 0.5, 0.0, 1.0);
+}
+
+// Three Worley octaves, weighted as in Schneider's Nubis cloud noise
+float worleyFbm(vec3 p, int period) {
+    return worley(p, period) * 0.625 +
+           worley(p * 2.0, period * 2) * 0.25 +
+           worley(p * 4.0, period * 4) * 0.125;
+}
+
+float remap(float value, float fromMin, float fromMax, float toMin, float toMax) {
+    return toMin + (value - fromMin) / (fromMax - fromMin) * (toMax - toMin);
+}
@@ -1,7 +1,15 @@
 #version 420 core
 
+#ifdef CLOUDS_FULLSCREEN
+// Reduced-resolution pass (CloudSystem temporal mode): each fragment marches the
+// ray through one pixel of its 4x4 block of the full-resolution target
+uniform mat4 u_inverseViewProjection; // Rotation-only view, so unprojecting gives a direction
+uniform vec2 u_fullResolution;
+uniform vec2 u_jitterOffset;          // Pixel within each 4x4 block marched this frame
+#else
 in vec3 FragPos;
 in vec3 ViewRay;
+#endif
 
 out vec4 FragColor;
 
@@ -20,6 +28,7 @@ uniform float u_cloudSpeed;
 uniform float u_cloudHeight;
 uniform float u_cloudThickness;
 uniform vec3 u_windDirection;
+uniform vec3 u_volumeSize;         // Extent of the cloud volume, centred on the camera horizontally
 
 // Ray marching parameters
 uniform int u_numSteps;
@@ -31,8 +40,28 @@ uniform float u_noiseScale;
 uniform float u_noiseStrength;
 uniform int u_octaves;
 
+// Tileable volumes from CloudNoise; without them the noise is evaluated procedurally
+uniform sampler3D u_shapeNoise;    // r = Perlin-Worley, gba = Worley FBM octaves
+uniform sampler3D u_detailNoise;   // rgb = Worley FBM octaves
+uniform float u_shapeNoiseFrequency;
+uniform float u_detailNoiseFrequency;
+uniform bool u_hasNoiseVolumes;
+
+// Large-scale coverage (r channel); columns below WEATHER_CLEAR hold no cloud at all
+uniform sampler2D u_weatherMap;
+
 const float PI = 3.14159265359;
 
+// Weather map tiles at four base noise cells
+const float WEATHER_SCALE = 0.25;
+const float WEATHER_CLEAR = 0.35;
+const float WEATHER_RAMP = 0.2;
+
+// Rays stop once this little of the background still shows through
+const float MIN_TRANSMITTANCE = 0.01;
+// Steps taken at once through columns the weather map marks clear
+const int EMPTY_SPACE_STRIDE = 4;
+
 // 3D Noise functions for volumetric clouds
 float hash(float n) {
     return fract(sin(n) * 43758.5453);
@@ -87,22 +116,48 @@ float worleyNoise(vec3 pos) {
     return 1.0 - minDist;
 }
 
+float remap(float value, float fromMin, float fromMax, float toMin, float toMax) {
+    return toMin + (value - fromMin) / (fromMax - fromMin) * (toMax - toMin);
+}
+
+vec3 getWindPosition(vec3 pos) {
+    return pos + u_windDirection * u_time * u_cloudSpeed;
+}
+
+// 0 where the weather map keeps the sky clear, ramping to 1 inside cloudy regions
+float getWeatherMask(vec3 windPos) {
+    float coverage = texture(u_weatherMap, windPos.xz * u_cloudScale * WEATHER_SCALE).r;
+    return clamp(remap(coverage, WEATHER_CLEAR, WEATHER_CLEAR + WEATHER_RAMP, 0.0, 1.0), 0.0, 1.0);
+}
+
 // Cloud density calculation
 float getCloudDensity(vec3 pos) {
     // Move clouds with wind
-    vec3 windPos = pos + u_windDirection * u_time * u_cloudSpeed;
-    
-    // Base cloud shape using FBM
-    float baseNoise = fbm(windPos * u_cloudScale, u_octaves);
+    vec3 windPos = getWindPosition(pos);
+    float weatherMask = getWeatherMask(windPos);
+    if (weatherMask <= 0.0) return 0.0;
     
-    // Add detail with Worley noise
-    float detailNoise = worleyNoise(windPos * u_cloudScale * 4.0) * 0.5;
+    float baseNoise;
+    float detailNoise;
+    if (u_hasNoiseVolumes) {
+        // One fetch per volume instead of u_octaves value-noise octaves and a 27-cell Worley search
+        vec3 p = windPos * u_cloudScale;
+        baseNoise = texture(u_shapeNoise, p / u_shapeNoiseFrequency).r;
+        vec3 detail = texture(u_detailNoise, p * 4.0 / u_detailNoiseFrequency).rgb;
+        detailNoise = dot(detail, vec3(0.625, 0.25, 0.125)) * 0.5;
+    } else {
+        // Base cloud shape using FBM
+        baseNoise = fbm(windPos * u_cloudScale, u_octaves);
+        
+        // Add detail with Worley noise
+        detailNoise = worleyNoise(windPos * u_cloudScale * 4.0) * 0.5;
+    }
     
     // Combine noises
     float density = baseNoise + detailNoise * u_noiseStrength;
     
     // Apply coverage threshold
-    density = clamp(density - (1.0 - u_cloudCoverage), 0.0, 1.0) * u_cloudDensity;
+    density = clamp(density - (1.0 - u_cloudCoverage), 0.0, 1.0) * u_cloudDensity * weatherMask;
     
     // Height-based attenuation (clouds get thinner at edges)
     float heightFactor = 1.0 - abs(pos.y - u_cloudHeight) / (u_cloudThickness * 0.5);
@@ -119,6 +174,9 @@ float getScattering(vec3 pos, vec3 lightDir) {
     
     for(int i = 0; i < u_numLightSteps; i++) {
         density += getCloudDensity(pos + step * float(i));
+        
+        // Already fully shadowed; further samples cannot change the result
+        if (exp(-density * 0.1) < MIN_TRANSMITTANCE) break;
     }
     
     return exp(-density * 0.1); // Beer's law approximation
@@ -139,7 +197,14 @@ vec4 rayMarchClouds(vec3 rayStart, vec3 rayDir, float maxDist) {
     vec3 totalLighting = vec3(0.0);
     float transmittance = 1.0;
     
-    for(int i = 0; i < u_numSteps && transmittance > 0.01; i++) {
+    for(int i = 0; i < u_numSteps && transmittance > MIN_TRANSMITTANCE; i++) {
+        // Clear columns cannot hold cloud, so stride over them at a fraction of the cost
+        if (getWeatherMask(getWindPosition(pos)) <= 0.0) {
+            pos += step * float(EMPTY_SPACE_STRIDE);
+            i += EMPTY_SPACE_STRIDE - 1;
+            continue;
+        }
+        
         float density = getCloudDensity(pos);
         
         if(density > 0.01) {
@@ -195,17 +260,35 @@ bool rayBoxIntersection(vec3 rayStart, vec3 rayDir, vec3 boxMin, vec3 boxMax, ou
     return tNear <= tFar && tFar > 0.0;
 }
 
+vec3 getViewRay() {
+#ifdef CLOUDS_FULLSCREEN
+    vec2 fullPixel = floor(gl_FragCoord.xy) * 4.0 + u_jitterOffset + 0.5;
+    vec2 ndc = fullPixel / u_fullResolution * 2.0 - 1.0;
+    vec4 farPoint = u_inverseViewProjection * vec4(ndc, 1.0, 1.0);
+    return farPoint.xyz / farPoint.w;
+#else
+    return ViewRay;
+#endif
+}
+
 void main() {
-    vec3 rayDir = normalize(ViewRay);
+    vec3 rayDir = normalize(getViewRay());
     vec3 rayStart = viewPos;
     
     // Define cloud bounding box
-    vec3 cloudBoxMin = vec3(-500.0, u_cloudHeight - u_cloudThickness * 0.5, -500.0);
-    vec3 cloudBoxMax = vec3(500.0, u_cloudHeight + u_cloudThickness * 0.5, 500.0);
+    vec2 halfExtent = u_volumeSize.xz * 0.5;
+    vec3 cloudBoxMin = vec3(viewPos.x - halfExtent.x, u_cloudHeight - u_cloudThickness * 0.5, viewPos.z - halfExtent.y);
+    vec3 cloudBoxMax = vec3(viewPos.x + halfExtent.x, u_cloudHeight + u_cloudThickness * 0.5, viewPos.z + halfExtent.y);
     
     float tNear, tFar;
     if(!rayBoxIntersection(rayStart, rayDir, cloudBoxMin, cloudBoxMax, tNear, tFar)) {
+#ifdef CLOUDS_FULLSCREEN
+        // The offscreen target keeps every texel, so a miss is written as empty sky
+        FragColor = vec4(0.0);
+        return;
+#else
         discard; // Ray doesn't intersect cloud volume
+#endif
     }
     
     // Adjust ray start if camera is inside cloud volume
@@ -9,6 +9,11 @@ uniform vec3 skyColor;
 uniform float cloudCoverage;
 uniform float cloudDensity;
 
+#ifdef CLOUDS_CG_CACHED
+// Sky cache: the procedural sky below was baked into this cubemap by direction
+uniform samplerCube skyCache;
+#endif
+
 // 3D Procedural noise from the book (Chapter on procedural textures)
 // Implementation based on Perlin noise as described in the CG book
 
@@ -53,6 +58,11 @@ void main(void)
 {
     vec3 rayDir = normalize(tc);
     
+#ifdef CLOUDS_CG_CACHED
+    fragColor = vec4(texture(skyCache, rayDir).rgb, 1.0);
+    return;
+#endif
+    
     // Early exit for rays pointing downward (below horizon)
     if (rayDir.y < 0.0) {
         fragColor = vec4(skyColor, 1.0);
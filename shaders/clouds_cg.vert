@@ -1,18 +1,29 @@
 #version 430
 
+#include "uniform_blocks.glsl"
+
 layout (location=0) in vec3 vertPos;
 
-uniform mat4 mv_matrix;
-uniform mat4 proj_matrix;
 
 out vec3 tc;
 
+#ifdef CLOUDS_CG_BAKE
+// Sky cache: one cubemap face, 90 degree projection from the origin
+uniform mat4 faceViewProjection;
+#endif
+
 void main(void)
 {
+#ifdef CLOUDS_CG_BAKE
+    gl_Position = faceViewProjection * vec4(vertPos, 1.0);
+    tc = vertPos;
+    return;
+#endif
+    
     // Skybox technique from the book - Chapter on Environment Mapping
     // Remove translation from the view matrix for skybox effect
-    mat4 v3_matrix = mat4(mat3(mv_matrix));
-    vec4 pos = proj_matrix * v3_matrix * vec4(vertPos, 1.0);
+    mat4 v3_matrix = mat4(mat3(view));
+    vec4 pos = projection * v3_matrix * vec4(vertPos, 1.0);
     
     // Ensure the skybox is always at maximum depth
     gl_Position = pos.xyww;
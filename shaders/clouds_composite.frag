@@ -0,0 +1,14 @@
+#version 420 core
+
+// Blends the reconstructed cloud image over the sky; drawn with fullscreen.vert,
+// whose far-plane depth keeps it behind scene geometry.
+
+in vec2 ScreenUV;
+
+out vec4 FragColor;
+
+uniform sampler2D u_clouds;
+
+void main() {
+    FragColor = texture(u_clouds, ScreenUV);
+}
@@ -0,0 +1,57 @@
+#version 420 core
+
+// Rebuilds the full-resolution cloud image: the pixel of each 4x4 block marched this
+// frame is taken as it is, the other fifteen come from last frame's reconstruction,
+// reprojected and clamped to the freshly marched neighbourhood.
+
+in vec2 ScreenUV;
+
+out vec4 FragColor;
+
+uniform sampler2D u_currentClouds;       // This frame's march, one texel per 4x4 block
+uniform sampler2D u_history;             // Last frame's full-resolution result
+uniform mat4 u_inverseViewProjection;    // Rotation-only, this frame
+uniform mat4 u_previousViewProjection;   // Rotation-only, last frame
+uniform vec2 u_jitterOffset;
+uniform bool u_historyValid;
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 marchSize = textureSize(u_currentClouds, 0);
+    ivec2 block = min(pixel / 4, marchSize - 1);
+    vec4 current = texelFetch(u_currentClouds, block, 0);
+    
+    if (all(equal(pixel % 4, ivec2(u_jitterOffset))) || !u_historyValid) {
+        FragColor = current;
+        return;
+    }
+    
+    // Clouds sit kilometres away, so reprojecting the view direction alone ignores
+    // only a sub-pixel parallax from camera translation
+    vec2 ndc = ScreenUV * 2.0 - 1.0;
+    vec4 farPoint = u_inverseViewProjection * vec4(ndc, 1.0, 1.0);
+    vec3 direction = farPoint.xyz / farPoint.w;
+    vec4 previousClip = u_previousViewProjection * vec4(direction, 1.0);
+    vec2 previousUV = previousClip.xy / previousClip.w * 0.5 + 0.5;
+    
+    if (previousClip.w <= 0.0 || any(lessThan(previousUV, vec2(0.0))) || any(greaterThan(previousUV, vec2(1.0)))) {
+        // Disoccluded at the screen edge: fall back to the upsampled march
+        FragColor = current;
+        return;
+    }
+    
+    // Clamp to the 3x3 marched neighbourhood so moving clouds do not leave trails
+    vec4 neighbourMin = current;
+    vec4 neighbourMax = current;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            ivec2 neighbour = clamp(block + ivec2(x, y), ivec2(0), marchSize - 1);
+            vec4 neighbourColor = texelFetch(u_currentClouds, neighbour, 0);
+            neighbourMin = min(neighbourMin, neighbourColor);
+            neighbourMax = max(neighbourMax, neighbourColor);
+        }
+    }
+    
+    vec4 history = texture(u_history, previousUV);
+    FragColor = clamp(history, neighbourMin, neighbourMax);
+}
@@ -15,6 +15,12 @@ uniform float u_cloudCoverage;
 uniform float u_cloudHeight;
 uniform float u_cloudThickness;
 
+// Tileable noise volume from CloudNoise (r = Perlin-Worley, gba = Worley FBM octaves);
+// without it the octaves below are evaluated procedurally
+uniform sampler3D u_shapeNoise;
+uniform float u_shapeNoiseFrequency; // Lattice cells per tile of the volume's base octave
+uniform bool u_hasNoiseVolumes;
+
 // Simple noise function
 float hash(float n) {
     return fract(sin(n) * 43758.5453);
@@ -68,9 +74,16 @@ void main() {
         
         // Sample noise for cloud density
         vec3 noisePos = samplePos * 0.001 + vec3(u_time * 0.01, 0.0, u_time * 0.005);
-        float noise = noise3D(noisePos);
-        noise += noise3D(noisePos * 2.0) * 0.5;
-        noise += noise3D(noisePos * 4.0) * 0.25;
+        float noise;
+        if (u_hasNoiseVolumes) {
+            // One fetch covers all octaves; scaled so a lattice cell matches the procedural one
+            vec4 shape = texture(u_shapeNoise, noisePos / u_shapeNoiseFrequency);
+            noise = shape.r + shape.g * 0.5 + shape.b * 0.25;
+        } else {
+            noise = noise3D(noisePos);
+            noise += noise3D(noisePos * 2.0) * 0.5;
+            noise += noise3D(noisePos * 4.0) * 0.25;
+        }
         
         float cloudDensity = smoothstep(1.0 - u_cloudCoverage, 1.0, noise) * 0.1;
         
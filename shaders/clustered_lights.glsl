@@ -0,0 +1,66 @@
+// Point and spot lights binned into view clusters by light_cluster.comp.
+// Pulled in with #include "clustered_lights.glsl" after uniform_blocks.glsl; needs #version 430.
+// Layouts must match the std430 mirrors in Engine/ClusteredLighting.hpp.
+// The cull pass defines CLUSTER_WRITE to get writable lists.
+
+#define CLUSTER_COUNT_X 16
+#define CLUSTER_COUNT_Y 9
+#define CLUSTER_COUNT_Z 24
+#define CLUSTER_COUNT (CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z)
+
+#define LOCAL_LIGHT_POINT 0
+#define LOCAL_LIGHT_SPOT 1
+
+#ifdef CLUSTER_WRITE
+#define CLUSTER_LIST_ACCESS
+#else
+#define CLUSTER_LIST_ACCESS readonly
+#endif
+
+struct LocalLight {
+    vec3 position;
+    float range;        // Cull radius; attenuation is faded to zero there
+    vec3 color;
+    float intensity;
+    vec3 direction;     // Spot lights only
+    float innerCone;
+    float outerCone;
+    float constant;
+    float linear;
+    float quadratic;
+    int type;
+    int shadowFace;     // Atlas face (the first of six for point lights), -1 without shadows
+};
+
+layout(std430) readonly buffer ClusterLights {
+    uint localLightCount;
+    LocalLight localLights[];
+};
+
+// Per cluster: offset into clusterLightIndices, light count
+layout(std430) CLUSTER_LIST_ACCESS buffer ClusterGrid {
+    uvec2 clusterRanges[CLUSTER_COUNT];
+};
+
+layout(std430) CLUSTER_LIST_ACCESS buffer ClusterLightIndices {
+    uint clusterIndexCount;
+    uint clusterLightIndices[];
+};
+
+// Cluster of a world-space position: its screen tile, then its exponential depth slice
+uint ClusterIndex(vec3 worldPos) {
+    vec4 viewPos = view * vec4(worldPos, 1.0);
+    vec4 clipPos = projection * viewPos;
+    vec2 tile = clamp((clipPos.xy / clipPos.w * 0.5 + 0.5) * vec2(CLUSTER_COUNT_X, CLUSTER_COUNT_Y),
+                      vec2(0.0), vec2(CLUSTER_COUNT_X - 1, CLUSTER_COUNT_Y - 1));
+    float slice = clamp(log(max(-viewPos.z, 1e-4)) * clusterDepthScale + clusterDepthBias, 0.0, float(CLUSTER_COUNT_Z - 1));
+    return uint(tile.x) + CLUSTER_COUNT_X * (uint(tile.y) + CLUSTER_COUNT_Y * uint(slice));
+}
+
+// The light's own attenuation, windowed to reach zero at its range so culling never pops
+float LocalLightAttenuation(LocalLight light, float distance) {
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    float ratio = distance / light.range;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return attenuation * window * window;
+}
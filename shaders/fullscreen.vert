@@ -0,0 +1,12 @@
+#version 420 core
+
+// One oversized triangle covering the viewport; draw 3 vertices with an empty VAO.
+// Depth sits on the far plane, so with GL_LEQUAL the pass only lands on the sky.
+
+out vec2 ScreenUV;
+
+void main() {
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    ScreenUV = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 1.0, 1.0);
+}
@@ -0,0 +1,21 @@
+// Image-based lighting baked by ImageBasedLighting: irradiance as spherical harmonics in the
+// IBLData block, plus the prefiltered specular cubemap and the split-sum BRDF LUT that the
+// including shader declares. Pulled in with #include "ibl.glsl" after the #version line.
+
+layout(std140) uniform IBLData {
+    vec4 irradianceSH[9];   // Already convolved with the cosine lobe and divided by pi
+};
+
+// Diffuse irradiance / pi around n; times albedo, the ambient diffuse term
+vec3 IrradianceSH(vec3 n) {
+    vec3 e = irradianceSH[0].rgb * 0.282095
+           + irradianceSH[1].rgb * (0.488603 * n.y)
+           + irradianceSH[2].rgb * (0.488603 * n.z)
+           + irradianceSH[3].rgb * (0.488603 * n.x)
+           + irradianceSH[4].rgb * (1.092548 * n.x * n.y)
+           + irradianceSH[5].rgb * (1.092548 * n.y * n.z)
+           + irradianceSH[6].rgb * (0.315392 * (3.0 * n.z * n.z - 1.0))
+           + irradianceSH[7].rgb * (1.092548 * n.x * n.z)
+           + irradianceSH[8].rgb * (0.546274 * (n.x * n.x - n.y * n.y));
+    return max(e, vec3(0.0));
+}
@@ -0,0 +1,41 @@
+// Shared by the IBL bakes (ibl_*.comp): cube face directions and GGX importance sampling.
+// Pulled in with #include "ibl_sampling.glsl" after the #version line.
+
+const float PI = 3.14159265359;
+
+// Direction through uv ([-1, 1] across the face, v down the rows) of a cube face in
+// GL_TEXTURE_CUBE_MAP_POSITIVE_X + face order, matching how samplerCube picks texels
+vec3 CubeDirection(int face, vec2 uv) {
+    switch (face) {
+        case 0: return normalize(vec3( 1.0, -uv.y, -uv.x));
+        case 1: return normalize(vec3(-1.0, -uv.y,  uv.x));
+        case 2: return normalize(vec3( uv.x,  1.0,  uv.y));
+        case 3: return normalize(vec3( uv.x, -1.0, -uv.y));
+        case 4: return normalize(vec3( uv.x, -uv.y,  1.0));
+        default: return normalize(vec3(-uv.x, -uv.y, -1.0));
+    }
+}
+
+// Low-discrepancy point i of count: i / count and the radical inverse of i
+vec2 Hammersley(uint i, uint count) {
+    uint bits = i;
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return vec2(float(i) / float(count), float(bits) * 2.3283064365386963e-10);
+}
+
+// Half vector around N distributed like GGX with alpha = roughness^2, the lit shaders' convention
+vec3 ImportanceSampleGGX(vec2 xi, vec3 N, float roughness) {
+    float a = roughness * roughness;
+    float phi = 2.0 * PI * xi.x;
+    float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (a * a - 1.0) * xi.y));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+    
+    vec3 up = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, N));
+    vec3 bitangent = cross(N, tangent);
+    return normalize(tangent * (cos(phi) * sinTheta) + bitangent * (sin(phi) * sinTheta) + N * cosTheta);
+}
@@ -0,0 +1,37 @@
+// Quantised Mesh vertex (PackedVertex in Engine/Vertex.hpp), shared by every vertex shader
+// that draws Mesh geometry. Pulled in with #include "mesh_vertex.glsl"; Mesh::bindVertexDecode
+// sets the ranges and the instanced flag for each mesh. Positions and UVs arrive as unorm16 over those ranges,
+// normals as octahedral snorm16.
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 8) in mat4 aInstanceModel; // only enabled on instanced meshes
+
+uniform vec3 positionOffset = vec3(0.0);
+uniform vec3 positionScale = vec3(1.0);
+uniform vec2 texCoordOffset = vec2(0.0);
+uniform vec2 texCoordScale = vec2(1.0);
+uniform bool instanced = false;
+
+vec3 meshPosition() {
+    return positionOffset + positionScale * aPos;
+}
+
+// Unfolds the octahedron; mirrors DecodeOctahedral in Engine/MeshOptimizer.cpp
+vec3 meshNormal() {
+    vec3 n = vec3(aNormal, 1.0 - abs(aNormal.x) - abs(aNormal.y));
+    float fold = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -fold : fold, n.y >= 0.0 ? -fold : fold);
+    return normalize(n);
+}
+
+vec2 meshTexCoords() {
+    return texCoordOffset + texCoordScale * aTexCoords;
+}
+
+// A disabled attribute array reads the current generic value, which is undefined once an
+// instanced draw has used the slot, so plain meshes never read aInstanceModel at all
+mat4 meshInstanceModel() {
+    return instanced ? aInstanceModel : mat4(1.0);
+}
@@ -1,8 +1,15 @@
 #version 430
 
+#include "uniform_blocks.glsl"
+
+#ifdef OCEAN_LOD
+#include "ocean_lod.glsl"
+uniform float oceanSize;
+#else
 layout (location=0) in vec3 vertPos;
 layout (location=1) in vec3 vertNormal;
 layout (location=2) in vec2 vertTexCoord;
+#endif
 
 out vec3 varyingNormal;
 out vec3 varyingLightDir;
@@ -29,8 +36,6 @@ struct Material
 uniform vec4 globalAmbient;
 uniform PositionalLight light;
 uniform Material material;
-uniform mat4 mv_matrix;
-uniform mat4 proj_matrix;
 uniform mat4 norm_matrix;
 uniform float time;
 
@@ -41,6 +46,11 @@ uniform float waveSpeed;
 
 void main(void)
 {	
+#ifdef OCEAN_LOD
+    vec2 lodXZ = oceanLodPosition(cameraPosition);
+    vec3 vertPos = vec3(lodXZ.x, 0.0, lodXZ.y);
+    vec2 vertTexCoord = lodXZ / oceanSize + 0.5;
+#endif
     vec4 P = vec4(vertPos, 1.0);
     
     // Implement sinusoidal wave displacement as shown in the book
@@ -54,14 +64,14 @@ void main(void)
     float dz = cos((P.z / waveLength + time * waveSpeed * 0.7)) * (waveHeight * 0.5 / waveLength);
     vec3 waveNormal = normalize(vec3(-dx, 1.0, -dz));
     
-    varyingVertPos = (mv_matrix * P).xyz;
+    varyingVertPos = (view * P).xyz;
     varyingLightDir = light.position - varyingVertPos;
     varyingNormal = (norm_matrix * vec4(waveNormal, 1.0)).xyz;
     varyingHalfVector = normalize(normalize(varyingLightDir) + normalize(-varyingVertPos));
     
     // Calculate additional outputs for depth-based effects
     worldPos = P.xyz;
-    gl_Position = proj_matrix * mv_matrix * P;
+    gl_Position = projection * view * P;
     screenPos = gl_Position;
     
     // Calculate water depth (distance from original sea level)
@@ -1,5 +1,7 @@
 #version 420 core
 
+#include "uniform_blocks.glsl"
+
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
@@ -10,9 +12,6 @@ in float FoamFactor;
 out vec4 FragColor;
 
 // Lighting
-uniform vec3 cameraPos;
-uniform vec3 lightDir;
-uniform vec3 lightColor;
 uniform vec3 skyColor;
 
 // Ocean colors
@@ -86,7 +85,7 @@ void main() {
     // Normalize vectors
     vec3 normal = normalize(Normal);
     vec3 viewDirection = normalize(ViewDir);
-    vec3 lightDirection = normalize(-lightDir);
+    vec3 lightDirection = normalize(-sunDirection);
     
     // Calculate reflection vector
     vec3 reflectionVector = reflect(-viewDirection, normal);
@@ -107,7 +106,7 @@ void main() {
     
     // Calculate lighting
     float NdotL = max(dot(normal, lightDirection), 0.0);
-    vec3 diffuse = waterColor * lightColor * NdotL;
+    vec3 diffuse = waterColor * sunColor * NdotL;
     
     // Subsurface scattering
     vec3 subsurface = calculateSubsurface(lightDirection, viewDirection, normal);
@@ -119,7 +118,7 @@ void main() {
     finalColor = mix(finalColor, skyReflection, fresnel * 0.8);
     
     // Add specular highlights
-    finalColor += lightColor * specular * (1.0 + fresnel);
+    finalColor += sunColor * specular * (1.0 + fresnel);
     
     // Apply foam
     finalColor = mix(finalColor, foamColor, FoamFactor * 0.8);
@@ -1,7 +1,13 @@
 #version 420 core
 
+#include "uniform_blocks.glsl"
+
+#ifdef OCEAN_LOD
+#include "ocean_lod.glsl"
+#else
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec2 aTexCoord;
+#endif
 
 out vec3 FragPos;
 out vec3 Normal;
@@ -12,8 +18,6 @@ out float FoamFactor;
 
 // Matrices
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 // Ocean parameters
 uniform float time;
@@ -21,26 +25,51 @@ uniform float oceanSize;
 uniform float choppiness;
 uniform bool enableChoppiness;
 
-// Textures from FFT computation
-uniform sampler2D heightTexture;
-uniform sampler2D displacementTexture;
-uniform sampler2D normalTexture;
-uniform sampler2D foamTexture;
+// FFT cascades, largest tile first. Each cascade owns two layers of the arrays
+// so ones updated every few frames can blend between their last two solutions.
+const int MAX_CASCADES = 4;
+uniform int cascadeCount;
+uniform float cascadeSizes[MAX_CASCADES];
+uniform vec3 cascadeLayers[MAX_CASCADES]; // x = older layer, y = newer layer, z = blend weight
+
+uniform sampler2DArray displacementMaps; // x = Dx, y = height, z = Dz
+uniform sampler2DArray surfaceMaps;      // x = dh/dx, y = dh/dz, z = foam
 
-// Camera
-uniform vec3 cameraPos;
+vec4 sampleCascade(sampler2DArray maps, vec2 uv, vec3 layers) {
+    return mix(texture(maps, vec3(uv, layers.x)), texture(maps, vec3(uv, layers.y)), layers.z);
+}
 
 void main() {
+#ifdef OCEAN_LOD
+    // The FFT tiles repeat, so the surface continues past oceanSize out to the LOD range
+    vec2 lodXZ = oceanLodPosition(cameraPosition);
+    vec3 aPosition = vec3(lodXZ.x, 0.0, lodXZ.y);
+    TexCoords = lodXZ / oceanSize + 0.5;
+#else
     TexCoords = aTexCoord;
+#endif
     
-    // Sample height from FFT-generated heightmap
-    float height = texture(heightTexture, TexCoords).r;
-    
-    // Sample displacement for choppiness
+    // Each cascade tiles at its own size; heights, displacements and slopes add
+    float height = 0.0;
     vec3 displacement = vec3(0.0);
+    vec2 slope = vec2(0.0);
+    float foam = 0.0;
+    for (int i = 0; i < cascadeCount; i++) {
+        vec2 uv = aPosition.xz / cascadeSizes[i] + 0.5;
+        vec4 displace = sampleCascade(displacementMaps, uv, cascadeLayers[i]);
+        vec4 surface = sampleCascade(surfaceMaps, uv, cascadeLayers[i]);
+        
+        height += displace.y;
+        displacement += vec3(displace.x, 0.0, displace.z);
+        slope += surface.xy;
+        foam = max(foam, surface.z);
+    }
+    
+    // Apply choppiness to the horizontal displacement
     if (enableChoppiness) {
-        vec4 displace = texture(displacementTexture, TexCoords);
-        displacement = vec3(displace.x, 0.0, displace.z) * choppiness;
+        displacement *= choppiness;
+    } else {
+        displacement = vec3(0.0);
     }
     
     // Apply displacement to vertex position
@@ -54,17 +83,12 @@ void main() {
     ClipSpace = projection * viewPosition;
     gl_Position = ClipSpace;
     
-    // Sample normal from FFT-generated normal map
-    vec3 sampledNormal = texture(normalTexture, TexCoords).xyz;
-    // Convert from [0,1] range back to [-1,1]
-    sampledNormal = sampledNormal * 2.0 - 1.0;
-    
     // Transform normal to world space
-    Normal = mat3(transpose(inverse(model))) * sampledNormal;
+    vec3 surfaceNormal = normalize(vec3(-slope.x, 1.0, -slope.y));
+    Normal = mat3(transpose(inverse(model))) * surfaceNormal;
     
     // Calculate view direction
-    ViewDir = cameraPos - FragPos;
+    ViewDir = cameraPosition - FragPos;
     
-    // Sample foam factor
-    FoamFactor = texture(foamTexture, TexCoords).r;
-}
\ No newline at end of file
+    FoamFactor = foam;
+}
@@ -0,0 +1,25 @@
+// Camera-relative ocean LOD (CDLOD patches), shared by the ocean vertex shaders
+// when they are built with OCEAN_LOD. Pulled in with #include "ocean_lod.glsl";
+// attribute locations and limits must match Engine/OceanLOD.hpp.
+
+#define OCEAN_LOD_MAX_LEVELS 16
+
+layout(location = 0) in vec2 lodGridPosition;   // Patch-local grid position in [0, 1]
+layout(location = 4) in vec4 lodPatch;          // Per instance: xy = world x/z origin, z = size, w = level
+
+uniform float lodGridResolution;                   // Quads along one patch side
+uniform vec2 lodMorphRanges[OCEAN_LOD_MAX_LEVELS]; // Per level: x = morph start, y = 1 / morph length
+
+// World x/z of this vertex. Towards the end of its level's range every odd
+// vertex slides onto its even neighbour, so the patch matches the next coarser
+// level where they meet and no cracks open between rings.
+vec2 oceanLodPosition(vec3 cameraPos) {
+    vec2 worldXZ = lodPatch.xy + lodGridPosition * lodPatch.z;
+    vec2 morphRange = lodMorphRanges[int(lodPatch.w)];
+    
+    float distanceToCamera = distance(vec3(worldXZ.x, 0.0, worldXZ.y), cameraPos);
+    float morph = clamp((distanceToCamera - morphRange.x) * morphRange.y, 0.0, 1.0);
+    
+    vec2 oddOffset = fract(lodGridPosition * lodGridResolution * 0.5) * 2.0 / lodGridResolution;
+    return worldXZ - oddOffset * lodPatch.z * morph;
+}
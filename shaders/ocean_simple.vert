@@ -1,8 +1,13 @@
 #version 420 core
 
+#ifdef OCEAN_LOD
+#include "ocean_lod.glsl"
+uniform float oceanSize;
+#else
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+#endif
 
 out vec3 FragPos;
 out vec3 Normal;
@@ -20,6 +25,13 @@ uniform float u_time;
 uniform float u_waveAmplitude;
 
 void main() {
+#ifdef OCEAN_LOD
+    vec2 lodXZ = oceanLodPosition(viewPos);
+    vec3 aPos = vec3(lodXZ.x, 0.0, lodXZ.y);
+    vec3 aNormal = vec3(0.0, 1.0, 0.0);
+    vec2 aTexCoords = lodXZ / oceanSize + 0.5;
+#endif
+    
     // Simple animated waves to prevent complex shader issues
     vec3 worldPos = (model * vec4(aPos, 1.0)).xyz;
     
@@ -1,5 +1,7 @@
 #version 420 core
 
+#include "uniform_blocks.glsl"
+
 in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
@@ -22,13 +24,14 @@ uniform bool material_hasSpecularTexture;
 // Lighting
 uniform vec3 lightPos;
 uniform vec3 lightColor;
-uniform vec3 viewPos;
 
 // PBR Functions
 vec3 getNormalFromMap() {
     if(!material_hasNormalTexture) return normalize(Normal);
     
     vec3 tangentNormal = texture(material_normalTexture, TexCoords).xyz * 2.0 - 1.0;
+    // Rebuild Z so two-channel (BC5) normal maps work; a no-op for unit-length RGB maps
+    tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
     
     vec3 Q1 = dFdx(FragPos);
     vec3 Q2 = dFdy(FragPos);
@@ -100,7 +103,7 @@ void main() {
     float ao = material_ao;
     
     vec3 N = getNormalFromMap();
-    vec3 V = normalize(viewPos - FragPos);
+    vec3 V = normalize(cameraPosition - FragPos);
     
     // Calculate reflectance at normal incidence
     vec3 F0 = vec3(0.04);
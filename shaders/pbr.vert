@@ -1,22 +1,23 @@
 #version 420 core
 
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
-layout (location = 2) in vec2 aTexCoords;
+#include "uniform_blocks.glsl"
+#include "mesh_vertex.glsl"
 
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    TexCoords = aTexCoords;
+    mat4 world = model * meshInstanceModel();
+
+    vec3 position = meshPosition();
+
+    FragPos = vec3(world * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(world))) * meshNormal();
+    TexCoords = meshTexCoords();
     
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * world * vec4(position, 1.0);
 }
\ No newline at end of file
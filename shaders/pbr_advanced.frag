@@ -1,5 +1,7 @@
 #version 420 core
 
+#include "uniform_blocks.glsl"
+
 in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
@@ -18,14 +20,6 @@ uniform sampler2D material_diffuseTexture;
 uniform sampler2D material_normalTexture;
 uniform sampler2D material_specularTexture;
 uniform sampler2D material_occlusionTexture;
-uniform bool material_hasDiffuseTexture;
-uniform bool material_hasNormalTexture;
-uniform bool material_hasSpecularTexture;
-uniform bool material_hasOcclusionTexture;
-
-// Advanced material system uniforms
-uniform int u_materialType;
-uniform bool u_hasAdvancedMaterial;
 
 // Disney BRDF uniforms
 uniform float u_disney_subsurface;
@@ -54,46 +48,6 @@ uniform float u_subsurface_scale;
 uniform vec3 u_emission_color;
 uniform float u_emission_power;
 
-// Camera
-uniform vec3 viewPos;
-
-// Light structures
-struct DirectionalLight {
-    vec3 direction;
-    vec3 color;
-    float intensity;
-};
-
-struct PointLight {
-    vec3 position;
-    vec3 color;
-    float intensity;
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    vec3 color;
-    float intensity;
-    float innerCone;
-    float outerCone;
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-// Light arrays and counts
-uniform DirectionalLight dirLight;
-uniform PointLight pointLight;
-uniform SpotLight spotLight;
-
-uniform int numDirLights;
-uniform int numPointLights;
-uniform int numSpotLights;
-
 const float PI = 3.14159265359;
 
 // Material type constants
@@ -105,6 +59,12 @@ const float PI = 3.14159265359;
 #define MATERIAL_SUBSURFACE_MATERIAL 5
 #define MATERIAL_EMISSIVE_MATERIAL 6
 
+// Material::getPermutationDefines picks the type and the HAS_*_TEXTURE flags, so each
+// program only contains the path its materials take
+#ifndef MATERIAL_TYPE
+#define MATERIAL_TYPE MATERIAL_PBR_BASIC
+#endif
+
 // Advanced PBR functions
 float DistributionGGX(vec3 N, vec3 H, float roughness) {
     float a = roughness * roughness;
@@ -226,7 +186,8 @@ vec3 CalculateLighting(vec3 lightDir, vec3 lightColor, float lightIntensity, flo
     
     if (NdotL <= 0.0) return vec3(0.0);
     
-    if (u_hasAdvancedMaterial && u_materialType == MATERIAL_DISNEY_BRDF) {
+#if MATERIAL_TYPE == MATERIAL_DISNEY_BRDF
+    {
         // Disney BRDF
         vec3 diffuse = DisneyDiffuse(V, lightDir, H, albedo, roughness, u_disney_subsurface);
         
@@ -254,8 +215,9 @@ vec3 CalculateLighting(vec3 lightDir, vec3 lightColor, float lightIntensity, flo
         }
         
         return result;
-        
-    } else if (u_hasAdvancedMaterial && u_materialType == MATERIAL_METAL_MATERIAL) {
+    }
+#elif MATERIAL_TYPE == MATERIAL_METAL_MATERIAL
+    {
         // Metal BRDF with complex IOR
         float NDF = DistributionGGX(N, H, roughness);
         float G = GeometrySmith(N, V, lightDir, roughness);
@@ -266,8 +228,9 @@ vec3 CalculateLighting(vec3 lightDir, vec3 lightColor, float lightIntensity, flo
         vec3 specular = numerator / denominator;
         
         return specular * lightColor * lightIntensity * attenuation * NdotL;
-        
-    } else if (u_hasAdvancedMaterial && u_materialType == MATERIAL_SUBSURFACE_MATERIAL) {
+    }
+#elif MATERIAL_TYPE == MATERIAL_SUBSURFACE_MATERIAL
+    {
         // Subsurface scattering material
         vec3 subsurface = SubsurfaceScattering(albedo, u_subsurface_sigmaS, u_subsurface_sigmaA, u_subsurface_scale);
         
@@ -284,8 +247,9 @@ vec3 CalculateLighting(vec3 lightDir, vec3 lightColor, float lightIntensity, flo
         vec3 specular = numerator / denominator;
         
         return (kD * (albedo / PI + subsurface) + specular) * lightColor * lightIntensity * attenuation * NdotL;
-        
-    } else {
+    }
+#else
+    {
         // Standard PBR
         float NDF = DistributionGGX(N, H, roughness);
         float G = GeometrySmith(N, V, lightDir, roughness);
@@ -301,14 +265,18 @@ vec3 CalculateLighting(vec3 lightDir, vec3 lightColor, float lightIntensity, flo
         
         return (kD * albedo / PI + specular) * lightColor * lightIntensity * attenuation * NdotL;
     }
+#endif
 }
 
 vec3 GetNormal() {
     vec3 normal = normalize(Normal);
     
-    if (material_hasNormalTexture) {
+#ifdef HAS_NORMAL_TEXTURE
+    {
         // Sample normal map and convert from [0,1] to [-1,1]
         vec3 normalMap = texture(material_normalTexture, TexCoords).rgb * 2.0 - 1.0;
+        // Rebuild Z so two-channel (BC5) normal maps work; a no-op for unit-length RGB maps
+        normalMap.z = sqrt(max(1.0 - dot(normalMap.xy, normalMap.xy), 0.0));
         
         // Create TBN matrix
         vec3 N = normal;
@@ -318,17 +286,19 @@ vec3 GetNormal() {
         
         return normalize(TBN * normalMap);
     }
-    
+#else
     return normal;
+#endif
 }
 
 void main() {
     // Sample albedo texture
+#ifdef HAS_DIFFUSE_TEXTURE
+    vec3 albedo = texture(material_diffuseTexture, TexCoords).rgb;
+    albedo = pow(albedo, vec3(2.2)); // Convert from sRGB to linear
+#else
     vec3 albedo = material_albedo;
-    if(material_hasDiffuseTexture) {
-        albedo = texture(material_diffuseTexture, TexCoords).rgb;
-        albedo = pow(albedo, vec3(2.2)); // Convert from sRGB to linear
-    }
+#endif
     
     // Material properties
     float metallic = material_metallic;
@@ -336,17 +306,17 @@ void main() {
     float ao = material_ao;
     
     // Override with texture values if available
-    if(material_hasSpecularTexture) {
-        vec3 specularSample = texture(material_specularTexture, TexCoords).rgb;
-        roughness = 1.0 - specularSample.g; // Convert glossiness to roughness
-        metallic = specularSample.b;
-    }
+#ifdef HAS_SPECULAR_TEXTURE
+    vec3 specularSample = texture(material_specularTexture, TexCoords).rgb;
+    roughness = 1.0 - specularSample.g; // Convert glossiness to roughness
+    metallic = specularSample.b;
+#endif
     
     // Apply occlusion texture if available
-    if(material_hasOcclusionTexture) {
-        float occlusionSample = texture(material_occlusionTexture, TexCoords).r;
-        ao *= occlusionSample; // Multiply with base AO value
-    }
+#ifdef HAS_OCCLUSION_TEXTURE
+    float occlusionSample = texture(material_occlusionTexture, TexCoords).r;
+    ao *= occlusionSample; // Multiply with base AO value
+#endif
     
     // Ensure valid ranges
     roughness = clamp(roughness, 0.04, 1.0);
@@ -354,7 +324,7 @@ void main() {
     ao = clamp(ao, 0.0, 1.0);
     
     vec3 N = GetNormal();
-    vec3 V = normalize(viewPos - FragPos);
+    vec3 V = normalize(cameraPosition - FragPos);
     
     // Calculate reflectance at normal incidence
     vec3 F0 = vec3(0.04);
@@ -362,50 +332,50 @@ void main() {
     
     // Handle emissive materials
     vec3 emission = vec3(0.0);
-    if (u_hasAdvancedMaterial && u_materialType == MATERIAL_EMISSIVE_MATERIAL) {
-        emission = u_emission_color * u_emission_power;
-    }
+#if MATERIAL_TYPE == MATERIAL_EMISSIVE_MATERIAL
+    emission = u_emission_color * u_emission_power;
+#endif
     
     // Calculate lighting
     vec3 Lo = vec3(0.0);
     
     // Directional lights (SUN)
-    if (numDirLights > 0) {
-        vec3 lightDir = normalize(-dirLight.direction);
+    for (int i = 0; i < numDirLights; ++i) {
+        vec3 lightDir = normalize(-dirLights[i].direction);
         // Boost sun contribution for bright daytime look
-        vec3 sunContribution = CalculateLighting(lightDir, dirLight.color, dirLight.intensity, 1.0, N, V, albedo, metallic, roughness, F0);
+        vec3 sunContribution = CalculateLighting(lightDir, dirLights[i].color, dirLights[i].intensity, 1.0, N, V, albedo, metallic, roughness, F0);
         Lo += sunContribution * 1.2; // Extra boost for sun
     }
     
     // Point lights
-    if (numPointLights > 0) {
-        vec3 lightDir = normalize(pointLight.position - FragPos);
-        float distance = length(pointLight.position - FragPos);
-        float attenuation = 1.0 / (pointLight.constant + pointLight.linear * distance + pointLight.quadratic * (distance * distance));
+    for (int i = 0; i < numPointLights; ++i) {
+        vec3 lightDir = normalize(pointLights[i].position - FragPos);
+        float distance = length(pointLights[i].position - FragPos);
+        float attenuation = 1.0 / (pointLights[i].constant + pointLights[i].linear * distance + pointLights[i].quadratic * (distance * distance));
         
-        Lo += CalculateLighting(lightDir, pointLight.color, pointLight.intensity, attenuation, N, V, albedo, metallic, roughness, F0);
+        Lo += CalculateLighting(lightDir, pointLights[i].color, pointLights[i].intensity, attenuation, N, V, albedo, metallic, roughness, F0);
     }
     
     // Spot lights
-    if (numSpotLights > 0) {
-        vec3 lightDir = normalize(spotLight.position - FragPos);
-        float distance = length(spotLight.position - FragPos);
-        float attenuation = 1.0 / (spotLight.constant + spotLight.linear * distance + spotLight.quadratic * (distance * distance));
+    for (int i = 0; i < numSpotLights; ++i) {
+        vec3 lightDir = normalize(spotLights[i].position - FragPos);
+        float distance = length(spotLights[i].position - FragPos);
+        float attenuation = 1.0 / (spotLights[i].constant + spotLights[i].linear * distance + spotLights[i].quadratic * (distance * distance));
         
         // Spotlight intensity
-        float theta = dot(lightDir, normalize(-spotLight.direction));
-        float epsilon = spotLight.innerCone - spotLight.outerCone;
-        float intensity = clamp((theta - spotLight.outerCone) / epsilon, 0.0, 1.0);
+        float theta = dot(lightDir, normalize(-spotLights[i].direction));
+        float epsilon = spotLights[i].innerCone - spotLights[i].outerCone;
+        float intensity = clamp((theta - spotLights[i].outerCone) / epsilon, 0.0, 1.0);
         
-        Lo += CalculateLighting(lightDir, spotLight.color, spotLight.intensity, attenuation * intensity, N, V, albedo, metallic, roughness, F0);
+        Lo += CalculateLighting(lightDir, spotLights[i].color, spotLights[i].intensity, attenuation * intensity, N, V, albedo, metallic, roughness, F0);
     }
     
     // BRIGHT DAYTIME AMBIENT - simulating scattered skylight
     vec3 ambient = vec3(0.4) * albedo * ao; // Very bright ambient for daytime
-    if (u_hasAdvancedMaterial && u_materialType == MATERIAL_SUBSURFACE_MATERIAL) {
-        // Boost ambient for subsurface materials
-        ambient *= 2.0;
-    }
+#if MATERIAL_TYPE == MATERIAL_SUBSURFACE_MATERIAL
+    // Boost ambient for subsurface materials
+    ambient *= 2.0;
+#endif
     
     vec3 color = ambient + Lo + emission;
     
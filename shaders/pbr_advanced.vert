@@ -1,8 +1,8 @@
 #version 420 core
 
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
-layout (location = 2) in vec2 aTexCoords;
+#include "uniform_blocks.glsl"
+#include "mesh_vertex.glsl"
+
 layout (location = 3) in vec3 aTangent;
 layout (location = 4) in vec3 aBitangent;
 
@@ -13,20 +13,22 @@ out vec3 Tangent;
 out vec3 Bitangent;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    mat4 world = model * meshInstanceModel();
+
+    vec3 position = meshPosition();
+
+    FragPos = vec3(world * vec4(position, 1.0));
     
     // Transform normals and tangent space vectors
-    mat3 normalMatrix = mat3(transpose(inverse(model)));
-    Normal = normalMatrix * aNormal;
+    mat3 normalMatrix = mat3(transpose(inverse(world)));
+    Normal = normalMatrix * meshNormal();
     Tangent = normalMatrix * aTangent;
     Bitangent = normalMatrix * aBitangent;
     
-    TexCoords = aTexCoords;
+    TexCoords = meshTexCoords();
     
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * world * vec4(position, 1.0);
 }
\ No newline at end of file
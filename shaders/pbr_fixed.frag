@@ -1,5 +1,7 @@
 #version 420 core
 
+#include "uniform_blocks.glsl"
+
 in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
@@ -22,7 +24,6 @@ uniform bool material_hasSpecularTexture;
 // Lighting
 uniform vec3 lightPos;
 uniform vec3 lightColor;
-uniform vec3 viewPos;
 
 const float PI = 3.14159265359;
 
@@ -89,7 +90,7 @@ void main() {
     metallic = clamp(metallic, 0.0, 1.0);
     
     vec3 N = normalize(Normal);
-    vec3 V = normalize(viewPos - FragPos);
+    vec3 V = normalize(cameraPosition - FragPos);
     
     // Calculate reflectance at normal incidence
     vec3 F0 = vec3(0.04);
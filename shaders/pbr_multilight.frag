@@ -1,4 +1,7 @@
-#version 420 core
+#version 430 core
+
+#include "uniform_blocks.glsl"
+#include "clustered_lights.glsl"
 
 in vec3 Normal;
 in vec3 FragPos;
@@ -19,50 +22,6 @@ uniform bool material_hasDiffuseTexture;
 uniform bool material_hasNormalTexture;
 uniform bool material_hasSpecularTexture;
 
-// Camera
-uniform vec3 viewPos;
-
-// Light structures
-struct DirectionalLight {
-    vec3 direction;
-    vec3 color;
-    float intensity;
-};
-
-struct PointLight {
-    vec3 position;
-    vec3 color;
-    float intensity;
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    vec3 color;
-    float intensity;
-    float innerCone;
-    float outerCone;
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-// Light arrays and counts
-#define MAX_DIR_LIGHTS 4
-#define MAX_POINT_LIGHTS 8
-#define MAX_SPOT_LIGHTS 8
-
-uniform DirectionalLight dirLight;
-uniform PointLight pointLight;
-uniform SpotLight spotLight;
-
-uniform int numDirLights;
-uniform int numPointLights;
-uniform int numSpotLights;
-
 const float PI = 3.14159265359;
 
 // PBR functions
@@ -124,45 +83,22 @@ vec3 CalcDirLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 albedo
     return (kD * albedo / PI + specular) * light.color * light.intensity * NdotL;
 }
 
-// Calculate lighting contribution for point light
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, float metallic, float roughness, vec3 F0) {
-    vec3 lightDir = normalize(light.position - fragPos);
-    vec3 halfwayDir = normalize(viewDir + lightDir);
-    
-    // Attenuation
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-    
-    // BRDF
-    float NDF = DistributionGGX(normal, halfwayDir, roughness);
-    float G = GeometrySmith(normal, viewDir, lightDir, roughness);
-    vec3 F = fresnelSchlick(max(dot(halfwayDir, viewDir), 0.0), F0);
-    
-    vec3 kS = F;
-    vec3 kD = vec3(1.0) - kS;
-    kD *= 1.0 - metallic;
-    
-    vec3 numerator = NDF * G * F;
-    float denominator = 4.0 * max(dot(normal, viewDir), 0.0) * max(dot(normal, lightDir), 0.0) + 0.0001;
-    vec3 specular = numerator / denominator;
-    
-    float NdotL = max(dot(normal, lightDir), 0.0);
-    return (kD * albedo / PI + specular) * light.color * light.intensity * attenuation * NdotL;
-}
-
-// Calculate lighting contribution for spot light
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, float metallic, float roughness, vec3 F0) {
+// Calculate lighting contribution for a point or spot light from the fragment's cluster
+vec3 CalcLocalLight(LocalLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, float metallic, float roughness, vec3 F0) {
     vec3 lightDir = normalize(light.position - fragPos);
     vec3 halfwayDir = normalize(viewDir + lightDir);
     
     // Spotlight intensity
-    float theta = dot(lightDir, normalize(-light.direction));
-    float epsilon = light.innerCone - light.outerCone;
-    float intensity = clamp((theta - light.outerCone) / epsilon, 0.0, 1.0);
+    float spotFactor = 1.0;
+    if (light.type == LOCAL_LIGHT_SPOT) {
+        float theta = dot(lightDir, normalize(-light.direction));
+        float epsilon = light.innerCone - light.outerCone;
+        spotFactor = clamp((theta - light.outerCone) / epsilon, 0.0, 1.0);
+    }
     
     // Attenuation
     float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    float attenuation = LocalLightAttenuation(light, distance);
     
     // BRDF
     float NDF = DistributionGGX(normal, halfwayDir, roughness);
@@ -178,7 +114,7 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec
     vec3 specular = numerator / denominator;
     
     float NdotL = max(dot(normal, lightDir), 0.0);
-    return (kD * albedo / PI + specular) * light.color * light.intensity * intensity * attenuation * NdotL;
+    return (kD * albedo / PI + specular) * light.color * light.intensity * spotFactor * attenuation * NdotL;
 }
 
 void main() {
@@ -206,7 +142,7 @@ void main() {
     metallic = clamp(metallic, 0.0, 1.0);
     
     vec3 N = normalize(Normal);
-    vec3 V = normalize(viewPos - FragPos);
+    vec3 V = normalize(cameraPosition - FragPos);
     
     // Calculate reflectance at normal incidence
     vec3 F0 = vec3(0.04);
@@ -216,18 +152,14 @@ void main() {
     vec3 Lo = vec3(0.0);
     
     // Directional lights
-    if (numDirLights > 0) {
-        Lo += CalcDirLight(dirLight, N, V, albedo, metallic, roughness, F0);
-    }
-    
-    // Point lights
-    if (numPointLights > 0) {
-        Lo += CalcPointLight(pointLight, N, FragPos, V, albedo, metallic, roughness, F0);
+    for (int i = 0; i < numDirLights; ++i) {
+        Lo += CalcDirLight(dirLights[i], N, V, albedo, metallic, roughness, F0);
     }
     
-    // Spot lights
-    if (numSpotLights > 0) {
-        Lo += CalcSpotLight(spotLight, N, FragPos, V, albedo, metallic, roughness, F0);
+    // Point and spot lights, only those whose range reaches this fragment's cluster
+    uvec2 cluster = clusterRanges[ClusterIndex(FragPos)];
+    for (uint i = 0u; i < cluster.y; ++i) {
+        Lo += CalcLocalLight(localLights[clusterLightIndices[cluster.x + i]], N, FragPos, V, albedo, metallic, roughness, F0);
     }
     
     // Ambient lighting
@@ -1,9 +1,12 @@
-#version 420 core
+#version 430 core
+
+#include "uniform_blocks.glsl"
+#include "clustered_lights.glsl"
+#include "ibl.glsl"
 
 in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
-in vec4 FragPosLightSpace; // Position in light space for shadow mapping
 
 out vec4 FragColor;
 
@@ -13,68 +16,22 @@ uniform float material_metallic;
 uniform float material_roughness;
 uniform float material_ao;
 
-// Textures
+// Textures; Material::getPermutationDefines sets HAS_*_TEXTURE for the ones it binds
 uniform sampler2D material_diffuseTexture;
 uniform sampler2D material_normalTexture;
 uniform sampler2D material_specularTexture;
-uniform bool material_hasDiffuseTexture;
-uniform bool material_hasNormalTexture;
-uniform bool material_hasSpecularTexture;
 
-// Shadow mapping
-uniform sampler2D shadowMap;
-uniform samplerCube pointShadowMap;
-uniform bool hasShadowMap;
-uniform bool hasPointShadowMap;
+// Shadow mapping; the sun's cascades and the local lights' atlas faces are described by
+// the ShadowData block
+uniform sampler2DArrayShadow shadowCascades;
+uniform sampler2DArrayShadow localShadowAtlas;
 
-// Environment mapping for reflections
+// Image-based lighting: the sky prefiltered by roughness (one mip per step) and the split-sum
+// BRDF; hasEnvironmentMap is false until the first bake is done
 uniform samplerCube environmentMap;
+uniform sampler2D brdfLUT;
 uniform bool hasEnvironmentMap;
 
-// Camera
-uniform vec3 viewPos;
-
-// Light structures
-struct DirectionalLight {
-    vec3 direction;
-    vec3 color;
-    float intensity;
-};
-
-struct PointLight {
-    vec3 position;
-    vec3 color;
-    float intensity;
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    vec3 color;
-    float intensity;
-    float innerCone;
-    float outerCone;
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-// Light arrays and counts
-uniform DirectionalLight dirLight;
-uniform PointLight pointLight;
-uniform SpotLight spotLight;
-
-uniform int numDirLights;
-uniform int numPointLights;
-uniform int numSpotLights;
-
-// Point light shadow mapping
-uniform vec3 pointLightPos;
-uniform float pointShadowFarPlane;
-
 const float PI = 3.14159265359;
 
 // PBR functions
@@ -118,79 +75,73 @@ vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness) {
     return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 }
 
-// Shadow calculation for directional lights
-float ShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir) {
-    if (!hasShadowMap) return 0.0;
-    
-    // Perform perspective divide
-    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+// Shadow calculation for the sun, from the cascade covering this fragment's view depth
+float ShadowCalculation(vec3 fragPos, vec3 normal, vec3 lightDir) {
+    if (cascadeCount == 0) return 0.0;
     
-    // Transform to [0,1] range
-    projCoords = projCoords * 0.5 + 0.5;
+    float viewDepth = -(view * vec4(fragPos, 1.0)).z;
+    if (viewDepth > cascadeSplits[cascadeCount - 1]) return 0.0;
     
-    // Get closest depth value from light's perspective
-    float closestDepth = texture(shadowMap, projCoords.xy).r;
-    
-    // Get depth of current fragment from light's perspective
-    float currentDepth = projCoords.z;
+    int cascade = 0;
+    while (cascade < cascadeCount - 1 && viewDepth > cascadeSplits[cascade]) {
+        ++cascade;
+    }
     
-    // Calculate bias (to prevent shadow acne)
-    float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
+    // Normal offset of about a texel, more at grazing angles, to prevent shadow acne
+    float slope = 1.0 - max(dot(normal, lightDir), 0.0);
+    vec3 samplePos = fragPos + normal * cascadeTexelSizes[cascade] * (1.0 + 2.0 * slope);
+    vec3 projCoords = (cascadeMatrices[cascade] * vec4(samplePos, 1.0)).xyz;
     
-    // PCF (Percentage Closer Filtering)
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+    // PCF (Percentage Closer Filtering); every tap is a hardware 2x2 comparison
+    float lit = 0.0;
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowCascades, 0).xy);
     for(int x = -1; x <= 1; ++x) {
         for(int y = -1; y <= 1; ++y) {
-            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
-            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
+            lit += texture(shadowCascades, vec4(projCoords.xy + vec2(x, y) * texelSize, float(cascade), projCoords.z));
         }
     }
-    shadow /= 9.0;
-    
-    // Keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
-    if(projCoords.z > 1.0)
-        shadow = 0.0;
     
-    return shadow;
+    return 1.0 - lit / 9.0;
 }
 
-// Point light shadow calculation
-float PointShadowCalculation(vec3 fragPos, vec3 lightPos) {
-    if (!hasPointShadowMap) return 0.0;
-    
-    vec3 fragToLight = fragPos - lightPos;
-    float currentDepth = length(fragToLight);
-    
-    float shadow = 0.0;
-    float bias = 0.15;
-    int samples = 20;
-    float viewDistance = length(viewPos - fragPos);
-    float diskRadius = (1.0 + (viewDistance / pointShadowFarPlane)) / 25.0;
-    
-    // Sample directions for PCF
-    vec3 sampleOffsetDirections[20] = vec3[]
-    (
-       vec3( 1,  1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1,  1,  1), 
-       vec3( 1,  1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1,  1, -1),
-       vec3( 1,  1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1,  1,  0),
-       vec3( 1,  0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1,  0, -1),
-       vec3( 0,  1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0,  1, -1)
-    );
-    
-    for(int i = 0; i < samples; ++i) {
-        float closestDepth = texture(pointShadowMap, fragToLight + sampleOffsetDirections[i] * diskRadius).r;
-        closestDepth *= pointShadowFarPlane; // undo mapping [0,1]
-        if(currentDepth - bias > closestDepth)
-            shadow += 1.0;
+// Shadow calculation for point and spot lights from their faces in the atlas. A point light
+// owns six faces in cube map order, so the major axis of the light-to-fragment vector picks one.
+float LocalShadowCalculation(int firstFace, bool isPointLight, vec3 lightPos, vec3 fragPos, vec3 normal, vec3 lightDir) {
+    if (firstFace < 0) return 0.0;
+    
+    int face = firstFace;
+    vec3 fromLight = fragPos - lightPos;
+    if (isPointLight) {
+        vec3 a = abs(fromLight);
+        if (a.x >= a.y && a.x >= a.z) {
+            face += fromLight.x > 0.0 ? 0 : 1;
+        } else if (a.y >= a.z) {
+            face += fromLight.y > 0.0 ? 2 : 3;
+        } else {
+            face += fromLight.z > 0.0 ? 4 : 5;
+        }
     }
-    shadow /= float(samples);
     
-    return shadow;
+    // Texels grow with distance from the light, and so does the normal offset
+    vec2 texelSize = 1.0 / vec2(textureSize(localShadowAtlas, 0).xy);
+    float slope = 1.0 - max(dot(normal, lightDir), 0.0);
+    vec3 samplePos = fragPos + normal * length(fromLight) * texelSize.x * 2.0 * (1.0 + 2.0 * slope);
+    vec4 clipCoords = localShadowMatrices[face] * vec4(samplePos, 1.0);
+    vec3 projCoords = clipCoords.xyz / clipCoords.w;
+    if (projCoords.z > 1.0) return 0.0;
+    
+    float lit = 0.0;
+    for(int x = -1; x <= 1; ++x) {
+        for(int y = -1; y <= 1; ++y) {
+            lit += texture(localShadowAtlas, vec4(projCoords.xy + vec2(x, y) * texelSize, float(face), projCoords.z));
+        }
+    }
+    
+    return 1.0 - lit / 9.0;
 }
 
 // Calculate lighting contribution for directional light
-vec3 CalcDirLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 albedo, float metallic, float roughness, vec3 F0) {
+vec3 CalcDirLight(DirectionalLight light, bool castsShadow, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, float metallic, float roughness, vec3 F0) {
     vec3 lightDir = normalize(-light.direction);
     vec3 halfwayDir = normalize(viewDir + lightDir);
     
@@ -210,19 +161,28 @@ vec3 CalcDirLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 albedo
     float NdotL = max(dot(normal, lightDir), 0.0);
     
     // Calculate shadows
-    float shadow = ShadowCalculation(FragPosLightSpace, normal, lightDir);
+    float shadow = castsShadow ? ShadowCalculation(fragPos, normal, lightDir) : 0.0;
     
     return (1.0 - shadow) * (kD * albedo / PI + specular) * light.color * light.intensity * NdotL;
 }
 
-// Calculate lighting contribution for point light
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, float metallic, float roughness, vec3 F0) {
+// Calculate lighting contribution for a point or spot light from the fragment's cluster
+vec3 CalcLocalLight(LocalLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, float metallic, float roughness, vec3 F0) {
     vec3 lightDir = normalize(light.position - fragPos);
     vec3 halfwayDir = normalize(viewDir + lightDir);
     
+    // Spotlight intensity
+    float spotFactor = 1.0;
+    if (light.type == LOCAL_LIGHT_SPOT) {
+        float theta = dot(lightDir, normalize(-light.direction));
+        float epsilon = light.innerCone - light.outerCone;
+        spotFactor = clamp((theta - light.outerCone) / epsilon, 0.0, 1.0);
+        if (spotFactor <= 0.0) return vec3(0.0);
+    }
+    
     // Attenuation
     float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    float attenuation = LocalLightAttenuation(light, distance);
     
     // BRDF
     float NDF = DistributionGGX(normal, halfwayDir, roughness);
@@ -240,18 +200,19 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, v
     float NdotL = max(dot(normal, lightDir), 0.0);
     
     // Calculate shadows
-    float shadow = PointShadowCalculation(fragPos, light.position);
+    float shadow = LocalShadowCalculation(light.shadowFace, light.type == LOCAL_LIGHT_POINT, light.position, fragPos, normal, lightDir);
     
-    return (1.0 - shadow) * (kD * albedo / PI + specular) * light.color * light.intensity * attenuation * NdotL;
+    return (1.0 - shadow) * (kD * albedo / PI + specular) * light.color * light.intensity * spotFactor * attenuation * NdotL;
 }
 
 void main() {
     // Sample albedo texture
+#ifdef HAS_DIFFUSE_TEXTURE
+    vec3 albedo = texture(material_diffuseTexture, TexCoords).rgb;
+    albedo = pow(albedo, vec3(2.2)); // Convert from sRGB to linear
+#else
     vec3 albedo = material_albedo;
-    if(material_hasDiffuseTexture) {
-        albedo = texture(material_diffuseTexture, TexCoords).rgb;
-        albedo = pow(albedo, vec3(2.2)); // Convert from sRGB to linear
-    }
+#endif
     
     // Material properties
     float metallic = material_metallic;
@@ -259,18 +220,18 @@ void main() {
     float ao = material_ao;
     
     // Override with texture values if available
-    if(material_hasSpecularTexture) {
-        vec3 specularSample = texture(material_specularTexture, TexCoords).rgb;
-        roughness = 1.0 - specularSample.g; // Convert glossiness to roughness
-        metallic = specularSample.b;
-    }
+#ifdef HAS_SPECULAR_TEXTURE
+    vec3 specularSample = texture(material_specularTexture, TexCoords).rgb;
+    roughness = 1.0 - specularSample.g; // Convert glossiness to roughness
+    metallic = specularSample.b;
+#endif
     
     // Ensure valid ranges
     roughness = clamp(roughness, 0.04, 1.0);
     metallic = clamp(metallic, 0.0, 1.0);
     
     vec3 N = normalize(Normal);
-    vec3 V = normalize(viewPos - FragPos);
+    vec3 V = normalize(cameraPosition - FragPos);
     vec3 R = reflect(-V, N); // Reflection vector for environment mapping
     
     // Calculate reflectance at normal incidence
@@ -281,33 +242,35 @@ void main() {
     vec3 Lo = vec3(0.0);
     
     // Directional lights
-    if (numDirLights > 0) {
-        Lo += CalcDirLight(dirLight, N, V, albedo, metallic, roughness, F0);
+    // Only the first directional light (the sun) owns the shadow cascades
+    for (int i = 0; i < numDirLights; ++i) {
+        Lo += CalcDirLight(dirLights[i], i == 0, N, FragPos, V, albedo, metallic, roughness, F0);
     }
     
-    // Point lights
-    if (numPointLights > 0) {
-        Lo += CalcPointLight(pointLight, N, FragPos, V, albedo, metallic, roughness, F0);
+    // Point and spot lights, only those whose range reaches this fragment's cluster
+    uvec2 cluster = clusterRanges[ClusterIndex(FragPos)];
+    for (uint i = 0u; i < cluster.y; ++i) {
+        Lo += CalcLocalLight(localLights[clusterLightIndices[cluster.x + i]], N, FragPos, V, albedo, metallic, roughness, F0);
     }
     
     // Ambient lighting with image-based lighting (IBL)
     vec3 ambient = vec3(0.03) * albedo * ao;
     
-    // Add environment reflections for metallic surfaces
-    if (hasEnvironmentMap && metallic > 0.1) {
-        vec3 F = fresnelSchlickRoughness(max(dot(N, V), 0.0), F0, roughness);
-        vec3 envColor = texture(environmentMap, R).rgb;
+    // Split-sum specular from the prefiltered sky and SH irradiance for the diffuse part:
+    // three fetches and a polynomial instead of sampling the sky per fragment
+    if (hasEnvironmentMap) {
+        float NdotV = max(dot(N, V), 0.0);
+        vec3 F = fresnelSchlickRoughness(NdotV, F0, roughness);
+        vec3 kD = (1.0 - F) * (1.0 - metallic);
         
-        // Simple approximation for environment lighting
-        vec3 kS = F;
-        vec3 kD = 1.0 - kS;
-        kD *= 1.0 - metallic;
+        vec3 diffuse = IrradianceSH(N) * albedo;
         
-        vec3 irradiance = texture(environmentMap, N).rgb; // Very simplified irradiance
-        vec3 diffuse = irradiance * albedo;
+        float lod = roughness * float(textureQueryLevels(environmentMap) - 1);
+        vec3 prefiltered = textureLod(environmentMap, R, lod).rgb;
+        vec2 environmentBRDF = texture(brdfLUT, vec2(NdotV, roughness)).rg;
+        vec3 specular = prefiltered * (F * environmentBRDF.x + environmentBRDF.y);
         
-        // Combine environment reflections
-        ambient = (kD * diffuse + envColor * metallic) * ao;
+        ambient = (kD * diffuse + specular) * ao;
     }
     
     vec3 color = ambient + Lo;
@@ -0,0 +1,14 @@
+#version 420 core
+
+// The font atlas holds glyph coverage in red; bars sample its solid cell
+
+in vec2 TexCoord;
+in vec4 Color;
+
+out vec4 FragColor;
+
+uniform sampler2D u_font;
+
+void main() {
+    FragColor = vec4(Color.rgb, Color.a * texture(u_font, TexCoord).r);
+}
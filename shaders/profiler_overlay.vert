@@ -0,0 +1,19 @@
+#version 420 core
+
+// Profiler overlay: text and bars as screen-space quads, positioned in pixels from the top left
+
+layout(location = 0) in vec2 a_position;
+layout(location = 1) in vec2 a_texCoord;
+layout(location = 2) in vec4 a_color;
+
+uniform vec2 u_viewportSize;
+
+out vec2 TexCoord;
+out vec4 Color;
+
+void main() {
+    TexCoord = a_texCoord;
+    Color = a_color;
+    vec2 ndc = a_position / u_viewportSize * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+}
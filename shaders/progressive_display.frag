@@ -0,0 +1,19 @@
+#version 420 core
+
+// Shows the progressive path tracer's linear accumulation; drawn with fullscreen.vert.
+// The image is stored top row first, so V is flipped.
+
+in vec2 ScreenUV;
+
+out vec4 FragColor;
+
+uniform sampler2D u_image;
+uniform float u_exposure;
+
+void main() {
+    vec3 radiance = max(texture(u_image, vec2(ScreenUV.x, 1.0 - ScreenUV.y)).rgb * u_exposure, vec3(0.0));
+
+    // Reinhard, then gamma; the same curve the tile renderer bakes into its output
+    vec3 color = radiance / (radiance + vec3(1.0));
+    FragColor = vec4(pow(color, vec3(1.0 / 2.2)), 1.0);
+}
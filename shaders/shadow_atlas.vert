@@ -0,0 +1,36 @@
+#version 420 core
+
+// Depth for ShadowAtlas tiles. With LAYERED_ARB or LAYERED_AMD each instance is one face of
+// the batch and picks its layer here; otherwise the atlas binds one layer per draw and only
+// faceMatrices[0] is used, which leaves gl_InstanceID free for instanced meshes.
+
+#if defined(LAYERED_ARB)
+#extension GL_ARB_shader_viewport_layer_array : require
+#elif defined(LAYERED_AMD)
+#extension GL_AMD_vertex_shader_layer : require
+#endif
+
+#define BATCH_FACES 16
+
+#include "mesh_vertex.glsl"
+
+uniform mat4 faceMatrices[BATCH_FACES];
+uniform int faceLayers[BATCH_FACES];
+uniform int faceMask;
+uniform mat4 model;
+
+void main()
+{
+#if defined(LAYERED_ARB) || defined(LAYERED_AMD)
+    int face = gl_InstanceID;
+    gl_Layer = faceLayers[face];
+    if ((faceMask & (1 << face)) == 0) {
+        // Outside the clip volume, so the face's triangles are dropped before rasterising
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+    gl_Position = faceMatrices[face] * model * vec4(meshPosition(), 1.0);
+#else
+    gl_Position = faceMatrices[0] * model * meshInstanceModel() * vec4(meshPosition(), 1.0);
+#endif
+}
@@ -0,0 +1,12 @@
+#version 420 core
+
+// World-space positions for shadow_cascade.geom, which projects them into each cascade
+
+#include "mesh_vertex.glsl"
+
+uniform mat4 model;
+
+void main()
+{
+    gl_Position = model * meshInstanceModel() * vec4(meshPosition(), 1.0);
+}
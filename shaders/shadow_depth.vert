@@ -1,11 +1,11 @@
 #version 420 core
 
-layout (location = 0) in vec3 aPos;
+#include "mesh_vertex.glsl"
 
 uniform mat4 lightSpaceMatrix;
 uniform mat4 model;
 
 void main()
 {
-    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+    gl_Position = lightSpaceMatrix * model * vec4(meshPosition(), 1.0);
 }
\ No newline at end of file
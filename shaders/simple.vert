@@ -1,7 +1,5 @@
  #version 330 core
- layout (location = 0) in vec3 aPos;
- layout (location = 1) in vec3 aNormal;
- layout (location = 2) in vec2 aTexCoords;
+ #include "mesh_vertex.glsl"
 
  out vec3 FragPos;
  out vec3 Normal;
@@ -12,9 +10,10 @@
  uniform mat4 projection;
 
  void main() {
-     FragPos = vec3(model * vec4(aPos, 1.0));
-     Normal = mat3(transpose(inverse(model))) * aNormal;
-     TexCoords = aTexCoords;
+     mat4 world = model * meshInstanceModel();
+     FragPos = vec3(world * vec4(meshPosition(), 1.0));
+     Normal = mat3(transpose(inverse(world))) * meshNormal();
+     TexCoords = meshTexCoords();
 
      gl_Position = projection * view * vec4(FragPos, 1.0);
  }
\ No newline at end of file
@@ -0,0 +1,67 @@
+// Shared per-frame and per-light uniform blocks.
+// Pulled in with #include "uniform_blocks.glsl" after the #version line.
+// Layouts must match the std140 mirrors in Engine/UniformBuffers.hpp.
+
+#define MAX_DIR_LIGHTS 4
+#define MAX_POINT_LIGHTS 32
+#define MAX_SPOT_LIGHTS 16
+#define MAX_SHADOW_CASCADES 4
+#define MAX_LOCAL_SHADOW_FACES 64
+
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPosition;
+    float frameTime;
+    vec3 sunDirection;
+    vec3 sunColor;
+    float clusterDepthScale;    // See ClusterIndex in clustered_lights.glsl
+    float clusterDepthBias;
+};
+
+struct DirectionalLight {
+    vec3 direction;
+    float intensity;
+    vec3 color;
+};
+
+struct PointLight {
+    vec3 position;
+    float intensity;
+    vec3 color;
+    float constant;
+    float linear;
+    float quadratic;
+    int shadowFace;     // First of six atlas faces, -1 without shadows
+};
+
+struct SpotLight {
+    vec3 position;
+    float intensity;
+    vec3 direction;
+    float innerCone;
+    vec3 color;
+    float outerCone;
+    float constant;
+    float linear;
+    float quadratic;
+    int shadowFace;     // Atlas face, -1 without shadows
+};
+
+layout(std140) uniform LightData {
+    int numDirLights;
+    int numPointLights;
+    int numSpotLights;
+    DirectionalLight dirLights[MAX_DIR_LIGHTS];
+    PointLight pointLights[MAX_POINT_LIGHTS];
+    SpotLight spotLights[MAX_SPOT_LIGHTS];
+};
+
+// Sun cascades (cascadeCount is 0 when there are none), then the local lights' atlas faces
+layout(std140) uniform ShadowData {
+    mat4 cascadeMatrices[MAX_SHADOW_CASCADES];
+    vec4 cascadeSplits;
+    vec4 cascadeTexelSizes;
+    int cascadeCount;
+    mat4 localShadowMatrices[MAX_LOCAL_SHADOW_FACES];
+};
@@ -0,0 +1,517 @@
+// Offline texture cooker: converts the PNG/JPEG sources under textures_scene/
+// into block-compressed DDS files with a full mip chain, written next to the
+// source. Texture::loadFromFile and the async loader pick them up automatically.
+//
+//   *_normal             -> BC5 (X/Y only, the PBR shaders rebuild Z)
+//   *_occlusion          -> BC4
+//   everything else      -> BC7 (mode 6), or BC1/BC3 with --fast
+//
+// Rows are flipped before encoding so the result matches the engine's
+// vertically flipped stb path.
+//
+// Build (Developer Command Prompt, stb from vcpkg):
+//   cl /O2 /EHsc /std:c++14 tools\TextureCooker.cpp /I <vcpkg>\installed\x64-windows\include
+// Usage:
+//   TextureCooker [--fast] [--force] [directory or files...]   (default: textures_scene)
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace {
+    enum class BlockFormat { BC1, BC3, BC4, BC5, BC7 };
+
+    struct Image {
+        int width, height;
+        std::vector<uint8_t> rgba;
+    };
+
+    // ---------------------------------------------------------------- helpers
+
+    uint8_t ClampByte(int value)
+    {
+        return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+    }
+
+    void FetchBlock(const Image& image, int blockX, int blockY, uint8_t block[16][4])
+    {
+        for (int y = 0; y < 4; ++y) {
+            for (int x = 0; x < 4; ++x) {
+                int sx = (std::min)(blockX * 4 + x, image.width - 1);
+                int sy = (std::min)(blockY * 4 + y, image.height - 1);
+                const uint8_t* texel = &image.rgba[(static_cast<size_t>(sy) * image.width + sx) * 4];
+                std::memcpy(block[y * 4 + x], texel, 4);
+            }
+        }
+    }
+
+    // Endpoints along the principal axis of the block's colours (channelCount of RGBA)
+    void FindPrincipalEndpoints(const uint8_t block[16][4], int channelCount, float lo[4], float hi[4])
+    {
+        float mean[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < 16; ++i)
+            for (int c = 0; c < channelCount; ++c) mean[c] += block[i][c] / 16.0f;
+
+        float covariance[4][4] = {};
+        for (int i = 0; i < 16; ++i)
+            for (int a = 0; a < channelCount; ++a)
+                for (int b = 0; b < channelCount; ++b)
+                    covariance[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+
+        // A few power iterations are enough for a 4x4 block
+        float axis[4] = { 1, 1, 1, 1 };
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            float next[4] = { 0, 0, 0, 0 };
+            for (int a = 0; a < channelCount; ++a)
+                for (int b = 0; b < channelCount; ++b) next[a] += covariance[a][b] * axis[b];
+            float length = 0.0f;
+            for (int c = 0; c < channelCount; ++c) length += next[c] * next[c];
+            length = std::sqrt(length);
+            if (length < 1e-6f) break;
+            for (int c = 0; c < channelCount; ++c) axis[c] = next[c] / length;
+        }
+
+        float minProjection = 1e30f, maxProjection = -1e30f;
+        for (int i = 0; i < 16; ++i) {
+            float projection = 0.0f;
+            for (int c = 0; c < channelCount; ++c) projection += (block[i][c] - mean[c]) * axis[c];
+            minProjection = (std::min)(minProjection, projection);
+            maxProjection = (std::max)(maxProjection, projection);
+        }
+
+        for (int c = 0; c < 4; ++c) {
+            lo[c] = c < channelCount ? (std::max)(0.0f, (std::min)(255.0f, mean[c] + axis[c] * minProjection)) : 255.0f;
+            hi[c] = c < channelCount ? (std::max)(0.0f, (std::min)(255.0f, mean[c] + axis[c] * maxProjection)) : 255.0f;
+        }
+    }
+
+    // ---------------------------------------------------------------- BC1
+
+    uint16_t PackRGB565(const float color[4])
+    {
+        int r = static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f);
+        int g = static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f);
+        int b = static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f);
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void UnpackRGB565(uint16_t packed, int out[3])
+    {
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        out[0] = (r << 3) | (r >> 2);
+        out[1] = (g << 2) | (g >> 4);
+        out[2] = (b << 3) | (b >> 2);
+    }
+
+    void EncodeBC1(const uint8_t block[16][4], uint8_t* out)
+    {
+        float lo[4], hi[4];
+        FindPrincipalEndpoints(block, 3, lo, hi);
+        uint16_t c0 = PackRGB565(hi), c1 = PackRGB565(lo);
+        if (c0 < c1) std::swap(c0, c1);
+
+        uint32_t indices = 0;
+        if (c0 != c1) {
+            // c0 > c1 selects the four-colour palette
+            int palette[4][3];
+            UnpackRGB565(c0, palette[0]);
+            UnpackRGB565(c1, palette[1]);
+            for (int c = 0; c < 3; ++c) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            for (int i = 0; i < 16; ++i) {
+                int best = 0, bestError = 1 << 30;
+                for (int p = 0; p < 4; ++p) {
+                    int error = 0;
+                    for (int c = 0; c < 3; ++c) {
+                        int d = block[i][c] - palette[p][c];
+                        error += d * d;
+                    }
+                    if (error < bestError) { bestError = error; best = p; }
+                }
+                indices |= static_cast<uint32_t>(best) << (i * 2);
+            }
+        }
+
+        std::memcpy(out, &c0, 2);
+        std::memcpy(out + 2, &c1, 2);
+        std::memcpy(out + 4, &indices, 4);
+    }
+
+    // ---------------------------------------------------------------- BC4
+
+    void EncodeBC4(const uint8_t block[16][4], int channel, uint8_t* out)
+    {
+        int maxValue = 0, minValue = 255;
+        for (int i = 0; i < 16; ++i) {
+            maxValue = (std::max)(maxValue, static_cast<int>(block[i][channel]));
+            minValue = (std::min)(minValue, static_cast<int>(block[i][channel]));
+        }
+
+        // r0 > r1 selects the eight-value palette
+        int palette[8];
+        palette[0] = maxValue;
+        palette[1] = minValue;
+        for (int p = 2; p < 8; ++p) palette[p] = ((8 - p) * maxValue + (p - 1) * minValue) / 7;
+
+        uint64_t indices = 0;
+        if (maxValue != minValue) {
+            for (int i = 0; i < 16; ++i) {
+                int best = 0, bestError = 1 << 30;
+                for (int p = 0; p < 8; ++p) {
+                    int error = std::abs(block[i][channel] - palette[p]);
+                    if (error < bestError) { bestError = error; best = p; }
+                }
+                indices |= static_cast<uint64_t>(best) << (i * 3);
+            }
+        }
+
+        out[0] = static_cast<uint8_t>(maxValue);
+        out[1] = static_cast<uint8_t>(minValue);
+        for (int b = 0; b < 6; ++b) out[2 + b] = static_cast<uint8_t>(indices >> (b * 8));
+    }
+
+    // ---------------------------------------------------------------- BC7 mode 6
+
+    struct BitWriter {
+        uint64_t bits[2] = { 0, 0 };
+        int position = 0;
+
+        void Write(uint32_t value, int count)
+        {
+            for (int i = 0; i < count; ++i, ++position) {
+                if (value & (1u << i)) bits[position >> 6] |= 1ull << (position & 63);
+            }
+        }
+    };
+
+    const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // Quantises an endpoint to 7 bits per channel plus a shared p-bit
+    void QuantizeEndpointBC7(const float value[4], int quantized[4], int& pBit)
+    {
+        int bestError = 1 << 30;
+        for (int p = 0; p < 2; ++p) {
+            int candidate[4], error = 0;
+            for (int c = 0; c < 4; ++c) {
+                candidate[c] = (std::max)(0, (std::min)(127, static_cast<int>((value[c] - p) / 2.0f + 0.5f)));
+                int d = ((candidate[c] << 1) | p) - static_cast<int>(value[c] + 0.5f);
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                pBit = p;
+                std::memcpy(quantized, candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    void EncodeBC7(const uint8_t block[16][4], uint8_t* out)
+    {
+        float lo[4], hi[4];
+        FindPrincipalEndpoints(block, 4, lo, hi);
+
+        int endpoint[2][4], pBit[2];
+        QuantizeEndpointBC7(lo, endpoint[0], pBit[0]);
+        QuantizeEndpointBC7(hi, endpoint[1], pBit[1]);
+
+        int palette[16][4];
+        for (int w = 0; w < 16; ++w) {
+            for (int c = 0; c < 4; ++c) {
+                int e0 = (endpoint[0][c] << 1) | pBit[0];
+                int e1 = (endpoint[1][c] << 1) | pBit[1];
+                palette[w][c] = ((64 - BC7_WEIGHTS4[w]) * e0 + BC7_WEIGHTS4[w] * e1 + 32) >> 6;
+            }
+        }
+
+        int indices[16];
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestError = 1 << 30;
+            for (int w = 0; w < 16; ++w) {
+                int error = 0;
+                for (int c = 0; c < 4; ++c) {
+                    int d = block[i][c] - palette[w][c];
+                    error += d * d;
+                }
+                if (error < bestError) { bestError = error; best = w; }
+            }
+            indices[i] = best;
+        }
+
+        // The anchor index drops its high bit, so pixel 0 must use the lower half
+        if (indices[0] & 8) {
+            for (int c = 0; c < 4; ++c) std::swap(endpoint[0][c], endpoint[1][c]);
+            std::swap(pBit[0], pBit[1]);
+            for (int i = 0; i < 16; ++i) indices[i] = 15 - indices[i];
+        }
+
+        BitWriter writer;
+        writer.Write(1u << 6, 7); // mode 6
+        for (int c = 0; c < 4; ++c) {
+            writer.Write(static_cast<uint32_t>(endpoint[0][c]), 7);
+            writer.Write(static_cast<uint32_t>(endpoint[1][c]), 7);
+        }
+        writer.Write(static_cast<uint32_t>(pBit[0]), 1);
+        writer.Write(static_cast<uint32_t>(pBit[1]), 1);
+        writer.Write(static_cast<uint32_t>(indices[0]), 3);
+        for (int i = 1; i < 16; ++i) writer.Write(static_cast<uint32_t>(indices[i]), 4);
+
+        std::memcpy(out, writer.bits, 16);
+    }
+
+    // ---------------------------------------------------------------- mips
+
+    Image Downsample(const Image& source, bool normalMap)
+    {
+        Image result;
+        result.width = (std::max)(1, source.width / 2);
+        result.height = (std::max)(1, source.height / 2);
+        result.rgba.resize(static_cast<size_t>(result.width) * result.height * 4);
+
+        for (int y = 0; y < result.height; ++y) {
+            for (int x = 0; x < result.width; ++x) {
+                int sum[4] = { 0, 0, 0, 0 };
+                for (int dy = 0; dy < 2; ++dy) {
+                    for (int dx = 0; dx < 2; ++dx) {
+                        int sx = (std::min)(x * 2 + dx, source.width - 1);
+                        int sy = (std::min)(y * 2 + dy, source.height - 1);
+                        const uint8_t* texel = &source.rgba[(static_cast<size_t>(sy) * source.width + sx) * 4];
+                        for (int c = 0; c < 4; ++c) sum[c] += texel[c];
+                    }
+                }
+                uint8_t* target = &result.rgba[(static_cast<size_t>(y) * result.width + x) * 4];
+                for (int c = 0; c < 4; ++c) target[c] = static_cast<uint8_t>((sum[c] + 2) / 4);
+
+                // Averaged normals shrink; renormalise so distant mips keep their shading
+                if (normalMap) {
+                    float n[3];
+                    for (int c = 0; c < 3; ++c) n[c] = target[c] / 127.5f - 1.0f;
+                    float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                    if (length > 1e-4f) {
+                        for (int c = 0; c < 3; ++c) target[c] = ClampByte(static_cast<int>((n[c] / length + 1.0f) * 127.5f + 0.5f));
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    // ---------------------------------------------------------------- DDS
+
+    uint32_t GetDXGIFormat(BlockFormat format)
+    {
+        switch (format) {
+            case BlockFormat::BC1: return 71;
+            case BlockFormat::BC3: return 77;
+            case BlockFormat::BC4: return 80;
+            case BlockFormat::BC5: return 83;
+            default: return 98;
+        }
+    }
+
+    size_t GetBlockBytes(BlockFormat format)
+    {
+        return (format == BlockFormat::BC1 || format == BlockFormat::BC4) ? 8 : 16;
+    }
+
+    void EncodeLevel(const Image& image, BlockFormat format, std::vector<uint8_t>& output)
+    {
+        int blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+        size_t blockBytes = GetBlockBytes(format);
+        size_t start = output.size();
+        output.resize(start + static_cast<size_t>(blocksX) * blocksY * blockBytes);
+
+        uint8_t block[16][4];
+        uint8_t* out = &output[start];
+        for (int by = 0; by < blocksY; ++by) {
+            for (int bx = 0; bx < blocksX; ++bx, out += blockBytes) {
+                FetchBlock(image, bx, by, block);
+                switch (format) {
+                    case BlockFormat::BC1: EncodeBC1(block, out); break;
+                    case BlockFormat::BC3: EncodeBC4(block, 3, out); EncodeBC1(block, out + 8); break;
+                    case BlockFormat::BC4: EncodeBC4(block, 0, out); break;
+                    case BlockFormat::BC5: EncodeBC4(block, 0, out); EncodeBC4(block, 1, out + 8); break;
+                    case BlockFormat::BC7: EncodeBC7(block, out); break;
+                }
+            }
+        }
+    }
+
+    bool WriteDDS(const std::string& path, int width, int height, uint32_t mipCount, BlockFormat format,
+                  const std::vector<uint8_t>& payload)
+    {
+        uint32_t header[31] = {};
+        header[0] = 124;                                       // dwSize
+        header[1] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // CAPS|HEIGHT|WIDTH|PIXELFORMAT|MIPMAPCOUNT|LINEARSIZE
+        header[2] = static_cast<uint32_t>(height);
+        header[3] = static_cast<uint32_t>(width);
+        header[4] = static_cast<uint32_t>(((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format));
+        header[6] = mipCount;
+        header[18] = 32;                                       // ddspf.dwSize
+        header[19] = 0x4;                                      // DDPF_FOURCC
+        header[20] = 0x30315844;                               // "DX10"
+        header[26] = 0x1000 | 0x8 | 0x400000;                  // TEXTURE|COMPLEX|MIPMAP
+
+        uint32_t dx10[5] = { GetDXGIFormat(format), 3 /* TEXTURE2D */, 0, 1, 0 };
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) return false;
+        file.write("DDS ", 4);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(dx10), sizeof(dx10));
+        file.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+        return file.good();
+    }
+
+    // ---------------------------------------------------------------- driver
+
+    bool EndsWith(const std::string& text, const std::string& suffix)
+    {
+        if (text.size() < suffix.size()) return false;
+        std::string tail = text.substr(text.size() - suffix.size());
+        std::transform(tail.begin(), tail.end(), tail.begin(), [](char c) { return static_cast<char>(::tolower(c)); });
+        return tail == suffix;
+    }
+
+    bool IsSourceImage(const std::string& path)
+    {
+        return EndsWith(path, ".png") || EndsWith(path, ".jpg") || EndsWith(path, ".jpeg") || EndsWith(path, ".tga");
+    }
+
+    long long GetModifiedTime(const std::string& path)
+    {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0 ? static_cast<long long>(info.st_mtime) : -1;
+    }
+
+    std::vector<std::string> ListDirectory(const std::string& directory)
+    {
+        std::vector<std::string> files;
+#ifdef _WIN32
+        WIN32_FIND_DATAA findData;
+        HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &findData);
+        if (find != INVALID_HANDLE_VALUE) {
+            do {
+                if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) files.push_back(directory + "/" + findData.cFileName);
+            } while (FindNextFileA(find, &findData));
+            FindClose(find);
+        }
+#else
+        if (DIR* dir = opendir(directory.c_str())) {
+            while (dirent* entry = readdir(dir)) {
+                if (entry->d_name[0] != '.') files.push_back(directory + "/" + entry->d_name);
+            }
+            closedir(dir);
+        }
+#endif
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    bool CookTexture(const std::string& sourcePath, bool fast, bool force)
+    {
+        std::string stem = sourcePath.substr(0, sourcePath.find_last_of('.'));
+        std::string outputPath = stem + ".dds";
+        if (!force && GetModifiedTime(outputPath) >= GetModifiedTime(sourcePath)) {
+            std::cout << "up to date: " << outputPath << std::endl;
+            return true;
+        }
+
+        stbi_set_flip_vertically_on_load(true);
+        int width, height, channels;
+        uint8_t* pixels = stbi_load(sourcePath.c_str(), &width, &height, &channels, 4);
+        if (!pixels) {
+            std::cerr << "failed to load " << sourcePath << ": " << stbi_failure_reason() << std::endl;
+            return false;
+        }
+
+        Image level;
+        level.width = width;
+        level.height = height;
+        level.rgba.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+
+        bool hasAlpha = false;
+        for (size_t i = 3; i < level.rgba.size(); i += 4) {
+            if (level.rgba[i] != 255) { hasAlpha = true; break; }
+        }
+
+        bool normalMap = EndsWith(stem, "_normal");
+        BlockFormat format = BlockFormat::BC7;
+        if (normalMap) format = BlockFormat::BC5;
+        else if (EndsWith(stem, "_occlusion")) format = BlockFormat::BC4;
+        else if (fast) format = hasAlpha ? BlockFormat::BC3 : BlockFormat::BC1;
+
+        std::vector<uint8_t> payload;
+        uint32_t mipCount = 0;
+        for (;;) {
+            EncodeLevel(level, format, payload);
+            ++mipCount;
+            if (level.width == 1 && level.height == 1) break;
+            level = Downsample(level, normalMap);
+        }
+
+        if (!WriteDDS(outputPath, width, height, mipCount, format, payload)) {
+            std::cerr << "failed to write " << outputPath << std::endl;
+            return false;
+        }
+
+        static const char* FORMAT_NAMES[] = { "BC1", "BC3", "BC4", "BC5", "BC7" };
+        std::cout << sourcePath << " -> " << outputPath << " (" << width << "x" << height << ", "
+                  << FORMAT_NAMES[static_cast<int>(format)] << ", " << mipCount << " mips, "
+                  << payload.size() / 1024 << " KB)" << std::endl;
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool fast = false, force = false;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--fast") fast = true;
+        else if (argument == "--force") force = true;
+        else inputs.push_back(argument);
+    }
+    if (inputs.empty()) inputs.push_back("textures_scene");
+
+    std::vector<std::string> sources;
+    for (const auto& input : inputs) {
+        struct stat info;
+        if (stat(input.c_str(), &info) != 0) {
+            std::cerr << "not found: " << input << std::endl;
+            continue;
+        }
+        if (info.st_mode & S_IFDIR) {
+            for (const auto& file : ListDirectory(input)) {
+                if (IsSourceImage(file)) sources.push_back(file);
+            }
+        } else {
+            sources.push_back(input);
+        }
+    }
+
+    int failures = 0;
+    for (const auto& source : sources) {
+        if (!CookTexture(source, fast, force)) ++failures;
+    }
+    return failures == 0 ? 0 : 1;
+}